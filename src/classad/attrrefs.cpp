@@ -427,6 +427,8 @@ FindExpr(EvalState &state, ExprTree *&tree, ExprTree *&sig, bool wantSig) const
 						// cache the evaluated result in the outer state object.
 					EvalState tstate;
 					tstate.SetScopes(state.curAd);
+					tstate.matchLeft = state.matchLeft;
+					tstate.matchRight = state.matchRight;
 					rval = wantSig ? attrRef->Evaluate( tstate, val, sig )
 						: attrRef->Evaluate( tstate, val );
 					delete attrRef;
@@ -466,8 +468,9 @@ FindExpr(EvalState &state, ExprTree *&tree, ExprTree *&sig, bool wantSig) const
 		 */
 	if (!current) { return EVAL_UNDEF; }
 	int rc = current->LookupInScope( attributeStr, tree, state );
-	if ( !expr && !absolute && rc == EVAL_UNDEF && current->alternateScope ) {
-		rc = current->alternateScope->LookupInScope( attributeStr, tree, state );
+	const ClassAd *alternate;
+	if ( !expr && !absolute && rc == EVAL_UNDEF && ( alternate = state.AlternateScope( current ) ) ) {
+		rc = alternate->LookupInScope( attributeStr, tree, state );
 	}
 	return rc;
 }
@@ -773,6 +773,25 @@ LookupInScope(const string &name, ExprTree*& expr, EvalState &state) const
 		} else {
 			superScope = current->parentScope;
 		}
+
+			// The ads of a MatchContext are top-level ads, in which the
+			// names the context ads of a MatchClassAd would provide
+			// refer to the ads of the match.
+		if ( state.matchLeft && ( current == state.matchLeft || current == state.matchRight ) ) {
+			superScope = NULL;
+			const ClassAd *other = ( current == state.matchLeft ) ? state.matchRight : state.matchLeft;
+			if ( strcasecmp( name.c_str( ), "target" ) == 0 ||
+				 strcasecmp( name.c_str( ), "other" ) == 0 ) {
+				expr = (ClassAd*)other;
+			} else if ( strcasecmp( name.c_str( ), "LEFT" ) == 0 ) {
+				expr = (ClassAd*)state.matchLeft;
+			} else if ( strcasecmp( name.c_str( ), "RIGHT" ) == 0 ) {
+				expr = (ClassAd*)state.matchRight;
+			}
+			if ( expr ) {
+				return( EVAL_OK );
+			}
+		}
 		if ( getSpecialAttrNames().find(name) == getSpecialAttrNames().end() ) {
 			// continue searching from the superScope ...
 			current = superScope;
@@ -806,6 +825,18 @@ LookupInScope(const string &name, ExprTree*& expr, EvalState &state) const
 
 	return( EVAL_UNDEF );
 }
+
+const ClassAd *EvalState::
+AlternateScope( const ClassAd *ad ) const
+{
+	if ( matchLeft && ( ad == matchLeft || ad == matchRight ) ) {
+		if ( !_useOldClassAdSemantics ) {
+			return NULL;
+		}
+		return ( ad == matchLeft ) ? matchRight : matchLeft;
+	}
+	return ad->alternateScope;
+}
 // --- end lookup methods
 
 
@@ -834,6 +834,8 @@ class ClassAd : public ExprTree
 		friend 	class ExprTree;
 		friend 	class EvalState;
 		friend 	class ClassAdIterator;
+		friend 	class CompiledExpr;
+		friend 	class MatchContext;
 
 
 		bool _GetExternalReferences( const ExprTree *, const ClassAd *, 
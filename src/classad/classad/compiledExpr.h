@@ -0,0 +1,144 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef __CLASSAD_COMPILED_EXPR_H__
+#define __CLASSAD_COMPILED_EXPR_H__
+
+#include <string>
+#include <vector>
+#include "classad/exprTree.h"
+#include "classad/operators.h"
+
+namespace classad {
+
+/** An expression flattened into instructions for a small stack machine,
+	for expressions that are evaluated many times, such as the
+	Requirements and Rank of ads being matched.
+
+	Operators and literals are compiled into instructions, and subtrees
+	made only of literals and operators are folded into constants.
+	Attribute references of the form attr and scope.attr are given slots,
+	so that each name is looked up at most once per evaluation, and
+	attributes that are literals or references to other ads (such as
+	TARGET) are only evaluated once.
+	Everything else (function calls, lists, nested ads and more unusual
+	references) is evaluated by the ExprTree it was compiled from, so the
+	result of an evaluation is always the same as that of
+	ExprTree::Evaluate() on the source tree.
+
+	A CompiledExpr refers to parts of the tree it was compiled from; the
+	tree must not be modified or deleted while the CompiledExpr is in use.
+*/
+class CompiledExpr
+{
+	public:
+		CompiledExpr();
+		~CompiledExpr();
+
+		/** Compile an expression, replacing any previous contents.
+			@param tree The expression to compile.
+			@return false if tree is NULL.
+		*/
+		bool Compile( const ExprTree *tree );
+
+		/** Evaluate the expression in the context of an ad, as
+			ClassAd::EvaluateExpr() does with the source tree.
+			@param scope The ad to evaluate in.
+			@param result The result of the evaluation.
+			@return true if the evaluation succeeded.
+		*/
+		bool Evaluate( const ClassAd *scope, Value &result ) const;
+
+		/** Evaluate the expression with the given state, as
+			ExprTree::Evaluate() does with the source tree.
+		*/
+		bool Evaluate( EvalState &state, Value &result ) const;
+
+		/// The tree this was compiled from, or NULL.
+		const ExprTree *GetSource() const { return source; }
+
+		/// Number of instructions in the compiled program.
+		size_t NumInstructions() const { return code.size(); }
+
+		/// Number of subtrees that were folded into constants.
+		int NumFoldedConstants() const { return folded; }
+
+		/// Write a readable listing of the program, for debugging.
+		void Dump( std::string &buffer ) const;
+
+	private:
+		enum Opcode {
+			PUSH_CONST,		// push constants[arg]
+			PUSH_ATTR,		// push the value of attribute slot arg
+			PUSH_TREE,		// push the value of trees[arg]
+			OPERATE,		// pop the operands in mask, push op applied to them
+			SHORT_CIRCUIT,	// && and ||: if top decides op, replace it, goto arg
+			TERNARY_BRANCH,	// if top is boolean, pop it and goto arg or arg2
+			JUMP			// goto arg
+		};
+
+		struct Instruction {
+			Opcode opcode;
+			Operation::OpKind op;
+			int mask;		// which of the (up to 3) operands are present
+			int arg;
+			int arg2;
+		};
+
+			// An attribute looked up by name.  For attr, scope is -1;
+			// for scope.attr it is the slot of the unscoped reference
+			// that names the scope.  ref is the AttributeReference
+			// itself, used when the scope turns out to be a list.
+		struct AttrSlot {
+			std::string name;
+			int scope;
+			const ExprTree *ref;
+		};
+
+		struct SlotState;
+		struct Machine;
+
+		void Clear();
+		void Emit( const ExprTree *tree, int depth );
+		int Append( Opcode opcode, Operation::OpKind op = Operation::__NO_OP__,
+					int mask = 0, int arg = 0, int arg2 = 0 );
+		int AttrSlotFor( const std::string &name, int scope, const ExprTree *ref );
+		bool FoldConstant( const ExprTree *tree );
+		static bool IsConstant( const ExprTree *tree );
+		static bool IsFixedValue( const ExprTree *tree );
+		static const ExprTree *Unwrap( const ExprTree *tree );
+
+		bool EvaluateSlot( Machine &m, int slot, Value &val ) const;
+
+		const ExprTree				*source;
+		std::vector<Instruction>	code;
+		std::vector<Value>			constants;
+		std::vector<const ExprTree*> trees;
+		std::vector<AttrSlot>		slots;
+		int							max_depth;
+		int							folded;
+
+		CompiledExpr( const CompiledExpr & );
+		CompiledExpr &operator=( const CompiledExpr & );
+};
+
+} // classad
+
+#endif//__CLASSAD_COMPILED_EXPR_H__
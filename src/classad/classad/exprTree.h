@@ -52,6 +52,16 @@ class EvalState {
 		const ClassAd *rootAd;
 		const ClassAd *curAd;
 
+		// The two ads of a match being evaluated by a MatchContext, or
+		// NULL.  They stand in for the scopes a MatchClassAd would have
+		// set in the ads, so that the ads themselves are never changed.
+		const ClassAd *matchLeft;
+		const ClassAd *matchRight;
+
+		// The ad in which to look up unscoped references that can't be
+		// found in ad, if any (see ClassAd::alternateScope).
+		const ClassAd *AlternateScope( const ClassAd *ad ) const;
+
 		bool		flattenAndInline;	// NAC
 		bool		debug;
 		bool		inAttrRefScope;
@@ -208,6 +218,7 @@ class ExprTree
 		friend class ExprListIterator;
 		friend class ClassAd;
 		friend class CachedExprEnvelope;
+		friend class CompiledExpr;
 
 		/// Copy constructor
         ExprTree(const ExprTree &tree);
@@ -228,6 +228,65 @@ class MatchClassAd : public ClassAd
 		bool EvalMatchExpr(ExprTree *match_expr);
 };
 
+/** Evaluates the expressions of two ads in the context of a match
+	between them, as a MatchClassAd would, but without inserting the ads
+	into a match ad or setting their scopes.  The ads and their
+	expressions are only ever read, so any number of MatchContexts may
+	evaluate the same ads at the same time, from different threads,
+	provided nothing modifies the ads meanwhile.
+
+	Both ads are treated as top-level ads.  In either of them, TARGET and
+	OTHER refer to the other ad, LEFT and RIGHT to the left and right ads,
+	and (with old ClassAd semantics) unscoped references that can't be
+	found are looked up in the other ad.  The scope chain and recursion
+	limit of an evaluation live in its EvalState, on the stack.
+*/
+class MatchContext
+{
+	public:
+		MatchContext( const ClassAd *al, const ClassAd *ar ) : lad( al ), rad( ar ) { }
+
+		/** @return true if right and left ads match each other
+		 */
+		bool symmetricMatch() const;
+
+		/** @return true if the right ad matches the left ad's requirements
+		 */
+		bool rightMatchesLeft() const;
+
+		/** @return true if the left ad matches the right ad's requirements
+		 */
+		bool leftMatchesRight() const;
+
+		/** Evaluates an attribute of one of the ads, as
+			ClassAd::EvaluateAttr() does when the ad is in a MatchClassAd.
+			@param scope The left or the right ad.
+			@param attr The name of the attribute.
+			@param val The result of the evaluation.
+			@return false if the evaluation failed.
+		*/
+		bool EvaluateAttr( const ClassAd *scope, const std::string &attr, Value &val ) const;
+
+		/** Evaluates an expression in the scope of one of the ads, as
+			ClassAd::EvaluateExpr() does when the ad is in a MatchClassAd.
+			The expression's own parent scope is not used.
+			@param scope The left or the right ad.
+			@param expr The expression.
+			@param val The result of the evaluation.
+			@return false if the evaluation failed.
+		*/
+		bool EvaluateExpr( const ClassAd *scope, const ExprTree *expr, Value &val ) const;
+
+		const ClassAd *GetLeftAd() const { return lad; }
+		const ClassAd *GetRightAd() const { return rad; }
+
+	private:
+		void InitState( EvalState &state, const ClassAd *scope ) const;
+		bool EvalRequirements( const ClassAd *scope ) const;
+
+		const ClassAd *lad, *rad;
+};
+
 } // classad
 
 #endif
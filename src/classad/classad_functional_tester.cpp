@@ -71,6 +71,7 @@ class Parameters
 public: 
 	bool      debug;
     bool      verbose;
+    bool      compiled;
     bool      interactive;
     ifstream  *input_file;
 
@@ -148,6 +149,7 @@ void Parameters::ParseCommandLine(
 	// First we set up the defaults.
 	debug       = false;
     verbose     = false;
+    compiled    = false;
     interactive = true;
 	input_file  = NULL;
 
@@ -159,6 +161,8 @@ void Parameters::ParseCommandLine(
 		} else if (   !strcasecmp(argv[arg_index], "-v")
                    || !strcasecmp(argv[arg_index], "-verbose")) {
 			verbose = true;
+		} else if (!strcasecmp(argv[arg_index], "-compiled")) {
+			compiled = true;
 		} else {
 			if (input_file == NULL) {
                 interactive = false;
@@ -1354,13 +1358,40 @@ void print_expr(
 bool evaluate_expr(
     ExprTree   *tree, 
     Value      &value, 
-    Parameters &)
+    Parameters &parameters)
 {
     ClassAd classad;
     bool    success;
 
     classad.Insert("internal___", tree);
     success = classad.EvaluateAttr("internal___", value);
+
+    // With -compiled, every expression is also evaluated by a
+    // CompiledExpr, which must give exactly the same result.
+    if (parameters.compiled) {
+        CompiledExpr compiled;
+        Value        compiled_value;
+        bool         compiled_success;
+
+        compiled.Compile(classad.Lookup("internal___"));
+        compiled_success = compiled.Evaluate(&classad, compiled_value);
+        if (compiled_success != success
+            || (success && !compiled_value.SameAs(value))) {
+            string          expr_string, value_string, compiled_string;
+            ClassAdUnParser unparser;
+
+            unparser.Unparse(expr_string, tree);
+            unparser.Unparse(value_string, value);
+            unparser.Unparse(compiled_string, compiled_value);
+            // NaN is not the same as itself.
+            if (compiled_success != success || value_string != compiled_string) {
+                cout << "Compiled evaluation of " << expr_string << " gave "
+                     << compiled_string << " instead of " << value_string << endl;
+                success = false;
+            }
+        }
+    }
+
     classad.Remove("internal___");
     return success;
 }
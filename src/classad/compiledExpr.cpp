@@ -0,0 +1,592 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "classad/common.h"
+#include "classad/exprTree.h"
+#include "classad/attrrefs.h"
+#include "classad/classadCache.h"
+#include "classad/sink.h"
+#include "classad/compiledExpr.h"
+
+using namespace std;
+
+namespace classad {
+
+	// The result of looking up one attribute slot during an evaluation.
+	// The lookup of attr only depends on the ad the evaluation started in,
+	// which does not change during an evaluation, so it is done once.  The
+	// lookup of scope.attr also depends on the ad the scope evaluated to.
+struct CompiledExpr::SlotState {
+	SlotState() : looked_up(false), has_value(false), rc(ExprTree::EVAL_FAIL),
+		key(NULL), tree(NULL), found(NULL) {}
+
+	bool			looked_up;
+	bool			has_value;
+	int				rc;
+	const ClassAd	*key;		// for scope.attr, the ad that was searched
+	ExprTree		*tree;
+	const ClassAd	*found;		// the ad tree was found in
+	Value			value;		// the value of tree, if has_value
+};
+
+	// The stack and slots of one evaluation.  Most expressions fit in
+	// the fixed buffers, so evaluating them allocates nothing.
+struct CompiledExpr::Machine {
+	enum { INLINE_SIZE = 16 };
+
+	Machine( EvalState &s, size_t depth, size_t num_slots ) : state( s ) {
+		if( depth > INLINE_SIZE ) {
+			more_stack.resize( depth );
+			stack = &more_stack[0];
+		} else {
+			stack = inline_stack;
+		}
+		if( num_slots > INLINE_SIZE ) {
+			more_slots.resize( num_slots );
+			slots = &more_slots[0];
+		} else {
+			slots = inline_slots;
+		}
+	}
+
+	EvalState			&state;
+	Value				*stack;
+	SlotState			*slots;
+	Value				inline_stack[INLINE_SIZE];
+	SlotState			inline_slots[INLINE_SIZE];
+	vector<Value>		more_stack;
+	vector<SlotState>	more_slots;
+};
+
+
+CompiledExpr::
+CompiledExpr() : source( NULL ), max_depth( 0 ), folded( 0 )
+{
+}
+
+
+CompiledExpr::
+~CompiledExpr()
+{
+}
+
+
+void CompiledExpr::
+Clear()
+{
+	source = NULL;
+	code.clear();
+	constants.clear();
+	trees.clear();
+	slots.clear();
+	max_depth = 0;
+	folded = 0;
+}
+
+
+	// Is the value of tree the same each time it is evaluated in the
+	// same scope?  Literals and ads are, and so are references like
+	// .RIGHT and TARGET, since ads do not change during an evaluation.
+bool CompiledExpr::
+IsFixedValue( const ExprTree *tree )
+{
+	tree = Unwrap( tree );
+	while( tree && tree->GetKind() == ExprTree::ATTRREF_NODE ) {
+		ExprTree *expr;
+		string attr;
+		bool absolute;
+		((const AttributeReference*)tree)->GetComponents( expr, attr, absolute );
+		if( !expr ) {
+			return true;
+		}
+		tree = Unwrap( expr );
+	}
+	return tree && ( tree->GetKind() == ExprTree::LITERAL_NODE ||
+					 tree->GetKind() == ExprTree::CLASSAD_NODE );
+}
+
+
+const ExprTree *CompiledExpr::
+Unwrap( const ExprTree *tree )
+{
+	if( tree && tree->GetKind() == ExprTree::EXPR_ENVELOPE ) {
+		return ((const CachedExprEnvelope*)tree)->get();
+	}
+	return tree;
+}
+
+
+bool CompiledExpr::
+IsConstant( const ExprTree *tree )
+{
+	tree = Unwrap( tree );
+	if( !tree ) {
+		return false;
+	}
+	if( tree->GetKind() == ExprTree::LITERAL_NODE ) {
+		return true;
+	}
+	if( tree->GetKind() != ExprTree::OP_NODE ) {
+		return false;
+	}
+
+	Operation::OpKind op;
+	ExprTree *t1, *t2, *t3;
+	((const Operation*)tree)->GetComponents( op, t1, t2, t3 );
+	return ( !t1 || IsConstant( t1 ) ) &&
+		( !t2 || IsConstant( t2 ) ) &&
+		( !t3 || IsConstant( t3 ) );
+}
+
+
+bool CompiledExpr::
+FoldConstant( const ExprTree *tree )
+{
+	EvalState	state;
+	Value		val;
+
+		// Leave anything that fails to evaluate to the tree, so that the
+		// failure happens at the same point it would have.
+	if( !tree->Evaluate( state, val ) ) {
+		return false;
+	}
+	constants.push_back( val );
+	Append( PUSH_CONST, Operation::__NO_OP__, 0, (int)constants.size() - 1 );
+	return true;
+}
+
+
+int CompiledExpr::
+Append( Opcode opcode, Operation::OpKind op, int mask, int arg, int arg2 )
+{
+	Instruction inst;
+	inst.opcode = opcode;
+	inst.op = op;
+	inst.mask = mask;
+	inst.arg = arg;
+	inst.arg2 = arg2;
+	code.push_back( inst );
+	return (int)code.size() - 1;
+}
+
+
+int CompiledExpr::
+AttrSlotFor( const string &name, int scope, const ExprTree *ref )
+{
+	for( size_t i = 0; i < slots.size(); i++ ) {
+		if( slots[i].scope == scope &&
+			strcasecmp( slots[i].name.c_str(), name.c_str() ) == 0 ) {
+			return (int)i;
+		}
+	}
+	AttrSlot slot;
+	slot.name = name;
+	slot.scope = scope;
+	slot.ref = ref;
+	slots.push_back( slot );
+	return (int)slots.size() - 1;
+}
+
+
+	// Emit code that leaves the value of tree at position depth of
+	// the stack.  The code for each operator mirrors the order in which
+	// Operation::_Evaluate() evaluates its children.
+void CompiledExpr::
+Emit( const ExprTree *tree, int depth )
+{
+	if( depth + 1 > max_depth ) {
+		max_depth = depth + 1;
+	}
+
+	tree = Unwrap( tree );
+
+	switch( tree->GetKind() ) {
+	case ExprTree::LITERAL_NODE:
+		if( FoldConstant( tree ) ) {
+			return;
+		}
+		break;
+
+	case ExprTree::ATTRREF_NODE: {
+		ExprTree *expr;
+		string attr;
+		bool absolute;
+		((const AttributeReference*)tree)->GetComponents( expr, attr, absolute );
+		if( !absolute && !expr ) {
+			Append( PUSH_ATTR, Operation::__NO_OP__, 0, AttrSlotFor( attr, -1, tree ) );
+			return;
+		}
+		const ExprTree *base = Unwrap( expr );
+		if( !absolute && base && base->GetKind() == ExprTree::ATTRREF_NODE ) {
+			ExprTree *base_expr;
+			string base_attr;
+			bool base_absolute;
+			((const AttributeReference*)base)->GetComponents( base_expr, base_attr, base_absolute );
+			if( !base_expr && !base_absolute ) {
+				int scope = AttrSlotFor( base_attr, -1, base );
+				Append( PUSH_ATTR, Operation::__NO_OP__, 0, AttrSlotFor( attr, scope, tree ) );
+				return;
+			}
+		}
+		break;
+	}
+
+	case ExprTree::OP_NODE: {
+		Operation::OpKind op;
+		ExprTree *t1, *t2, *t3;
+		((const Operation*)tree)->GetComponents( op, t1, t2, t3 );
+
+		if( op != Operation::PARENTHESES_OP && IsConstant( tree ) &&
+			FoldConstant( tree ) ) {
+			folded++;
+			return;
+		}
+
+		if( op == Operation::PARENTHESES_OP ) {
+			Emit( t1, depth );
+			return;
+		}
+
+		if( !t1 ) {
+			break;
+		}
+		Emit( t1, depth );
+
+		if( op == Operation::LOGICAL_OR_OP || op == Operation::LOGICAL_AND_OP ) {
+			int sc = Append( SHORT_CIRCUIT, op );
+			if( t2 ) Emit( t2, depth + 1 );
+			Append( OPERATE, op, t2 ? 3 : 1 );
+			code[sc].arg = (int)code.size();
+			return;
+		}
+
+		if( op == Operation::TERNARY_OP ) {
+			int br = Append( TERNARY_BRANCH, op, 0, -1, -1 );
+			int mask = 1;
+			if( t2 ) { Emit( t2, depth + 1 ); mask |= 2; }
+			if( t3 ) { Emit( t3, depth + 1 + (t2 ? 1 : 0) ); mask |= 4; }
+			Append( OPERATE, op, mask );
+			vector<int> to_end;
+			to_end.push_back( Append( JUMP ) );
+
+			if( t2 ) {
+				code[br].arg = (int)code.size();
+				Emit( t2, depth );
+				to_end.push_back( Append( JUMP ) );
+			}
+			if( t2 && t3 ) {
+				code[br].arg2 = (int)code.size();
+				Emit( t3, depth );
+				to_end.push_back( Append( JUMP ) );
+			} else if( !t2 ) {
+				code[br].arg2 = (int)code.size();
+				Emit( t1, depth );
+				to_end.push_back( Append( JUMP ) );
+			}
+			for( size_t i = 0; i < to_end.size(); i++ ) {
+				code[to_end[i]].arg = (int)code.size();
+			}
+			return;
+		}
+
+		int mask = 1;
+		if( t2 ) { Emit( t2, depth + 1 ); mask |= 2; }
+		if( t3 ) { Emit( t3, depth + 1 + (t2 ? 1 : 0) ); mask |= 4; }
+		Append( OPERATE, op, mask );
+		return;
+	}
+
+	default:
+		break;
+	}
+
+		// Function calls, lists, nested ads, and references like .attr
+		// and expr.attr are evaluated as trees.
+	trees.push_back( tree );
+	Append( PUSH_TREE, Operation::__NO_OP__, 0, (int)trees.size() - 1 );
+}
+
+
+bool CompiledExpr::
+Compile( const ExprTree *tree )
+{
+	Clear();
+	if( !tree ) {
+		return false;
+	}
+	source = tree;
+	Emit( tree, 0 );
+	return true;
+}
+
+
+bool CompiledExpr::
+Evaluate( const ClassAd *scope, Value &result ) const
+{
+	EvalState	state;
+
+	state.SetScopes( scope );
+	return Evaluate( state, result );
+}
+
+
+	// Look up and evaluate an attribute slot as
+	// AttributeReference::_Evaluate() would, using what was found by
+	// earlier lookups of the same slot in this evaluation.
+bool CompiledExpr::
+EvaluateSlot( Machine &m, int slot_num, Value &val ) const
+{
+	const AttrSlot	&slot = slots[slot_num];
+	SlotState		&ss = m.slots[slot_num];
+	EvalState		&state = m.state;
+	const ClassAd	*curAd = state.curAd;
+
+	if( slot.scope < 0 ) {
+		if( !ss.looked_up ) {
+			ss.looked_up = true;
+			if( !curAd ) {
+				ss.rc = ExprTree::EVAL_UNDEF;
+			} else {
+				ss.rc = curAd->LookupInScope( slot.name, ss.tree, state );
+				const ClassAd *alternate;
+				if( ss.rc == ExprTree::EVAL_UNDEF && ( alternate = state.AlternateScope( curAd ) ) ) {
+					ss.rc = alternate->LookupInScope( slot.name, ss.tree, state );
+				}
+			}
+			ss.found = state.curAd;
+		}
+	} else {
+		Value	scope_val;
+		ClassAd	*ad = NULL;
+
+		if( !EvaluateSlot( m, slot.scope, scope_val ) ) {
+			return false;
+		}
+		if( scope_val.IsUndefinedValue() ) {
+			val.SetUndefinedValue();
+			return true;
+		}
+		if( scope_val.IsListValue() ) {
+				// Applying a reference to each ad in a list makes
+				// temporary trees; leave that to the reference itself.
+			return slot.ref->Evaluate( state, val );
+		}
+		if( !scope_val.IsClassAdValue( ad ) || !ad ) {
+			val.SetErrorValue();
+			return true;
+		}
+		if( !ss.looked_up || ss.key != ad ) {
+			ss.looked_up = true;
+			ss.has_value = false;
+			ss.key = ad;
+			ss.rc = ad->LookupInScope( slot.name, ss.tree, state );
+			ss.found = state.curAd;
+		}
+	}
+
+	switch( ss.rc ) {
+	case ExprTree::EVAL_FAIL:
+		state.curAd = curAd;
+		return false;
+
+	case ExprTree::EVAL_ERROR:
+		val.SetErrorValue();
+		state.curAd = curAd;
+		return true;
+
+	case ExprTree::EVAL_UNDEF:
+		val.SetUndefinedValue();
+		state.curAd = curAd;
+		return true;
+
+	default:
+		break;
+	}
+
+	if( ss.has_value ) {
+		val = ss.value;
+		state.curAd = curAd;
+		return true;
+	}
+
+	if( state.depth_remaining <= 0 ) {
+		val.SetErrorValue();
+		state.curAd = curAd;
+		return false;
+	}
+	state.depth_remaining--;
+	state.curAd = ss.found;
+
+	bool rval = ss.tree->Evaluate( state, val );
+
+	state.depth_remaining++;
+	state.curAd = curAd;
+
+	if( rval && IsFixedValue( ss.tree ) ) {
+		ss.value = val;
+		ss.has_value = true;
+	}
+	return rval;
+}
+
+
+bool CompiledExpr::
+Evaluate( EvalState &state, Value &result ) const
+{
+	if( !source ) {
+		result.SetErrorValue();
+		return false;
+	}
+
+		// Debug output is printed per node, which only the tree has.
+	if( state.debug ) {
+		return source->Evaluate( state, result );
+	}
+
+	Machine	m( state, max_depth, slots.size() );
+	int		sp = 0;		// number of values on the stack
+	size_t	pc = 0;
+	bool	b;
+
+	while( pc < code.size() ) {
+		const Instruction &inst = code[pc++];
+
+		switch( inst.opcode ) {
+		case PUSH_CONST:
+			m.stack[sp++] = constants[inst.arg];
+			break;
+
+		case PUSH_ATTR:
+			if( !EvaluateSlot( m, inst.arg, m.stack[sp++] ) ) {
+				result.SetErrorValue();
+				return false;
+			}
+			break;
+
+		case PUSH_TREE:
+			if( !trees[inst.arg]->Evaluate( state, m.stack[sp++] ) ) {
+				result.SetErrorValue();
+				return false;
+			}
+			break;
+
+		case OPERATE: {
+			int n = ( inst.mask & 1 ) + ( ( inst.mask >> 1 ) & 1 ) + ( ( inst.mask >> 2 ) & 1 );
+			Value *args = &m.stack[sp - n];
+			Value unused, val;
+			Value &v1 = ( inst.mask & 1 ) ? *args++ : unused;
+			Value &v2 = ( inst.mask & 2 ) ? *args++ : unused;
+			Value &v3 = ( inst.mask & 4 ) ? *args++ : unused;
+			int rval = Operation::_doOperation( inst.op, v1, v2, v3,
+							( inst.mask & 1 ) != 0, ( inst.mask & 2 ) != 0,
+							( inst.mask & 4 ) != 0, val, &state );
+			if( rval == Operation::SIG_NONE ) {
+				result.SetErrorValue();
+				return false;
+			}
+			sp -= n;
+			m.stack[sp++] = val;
+			break;
+		}
+
+		case SHORT_CIRCUIT: {
+			Value &top = m.stack[sp - 1];
+			if( top.IsBooleanValueEquiv( b ) &&
+				( inst.op == Operation::LOGICAL_OR_OP ? b : !b ) ) {
+				top.SetBooleanValue( b );
+				pc = inst.arg;
+			}
+			break;
+		}
+
+		case TERNARY_BRANCH: {
+			Value &top = m.stack[sp - 1];
+			if( top.IsBooleanValueEquiv( b ) ) {
+				if( b && inst.arg >= 0 ) {
+					sp--;
+					pc = inst.arg;
+				} else if( !b && inst.arg2 >= 0 ) {
+					sp--;
+					pc = inst.arg2;
+				}
+			}
+			break;
+		}
+
+		case JUMP:
+			pc = inst.arg;
+			break;
+		}
+	}
+
+	result = m.stack[0];
+	return true;
+}
+
+
+void CompiledExpr::
+Dump( string &buffer ) const
+{
+	static const char *names[] = {
+		"PUSH_CONST", "PUSH_ATTR", "PUSH_TREE", "OPERATE",
+		"SHORT_CIRCUIT", "TERNARY_BRANCH", "JUMP"
+	};
+	ClassAdUnParser	unp;
+	char			line[64];
+
+	for( size_t pc = 0; pc < code.size(); pc++ ) {
+		const Instruction &inst = code[pc];
+		snprintf( line, sizeof(line), "%3d %-14s ", (int)pc, names[inst.opcode] );
+		buffer += line;
+		switch( inst.opcode ) {
+		case PUSH_CONST:
+			unp.Unparse( buffer, constants[inst.arg] );
+			break;
+		case PUSH_ATTR: {
+			const AttrSlot &slot = slots[inst.arg];
+			if( slot.scope >= 0 ) {
+				buffer += slots[slot.scope].name;
+				buffer += '.';
+			}
+			buffer += slot.name;
+			break;
+		}
+		case PUSH_TREE:
+			unp.Unparse( buffer, trees[inst.arg] );
+			break;
+		case OPERATE:
+			snprintf( line, sizeof(line), "op=%d mask=%d", (int)inst.op, inst.mask );
+			buffer += line;
+			break;
+		case SHORT_CIRCUIT:
+		case JUMP:
+			snprintf( line, sizeof(line), "%d", inst.arg );
+			buffer += line;
+			break;
+		case TERNARY_BRANCH:
+			snprintf( line, sizeof(line), "%d %d", inst.arg, inst.arg2 );
+			buffer += line;
+			break;
+		}
+		buffer += '\n';
+	}
+}
+
+} // classad
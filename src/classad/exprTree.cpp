@@ -299,6 +299,8 @@ EvalState( )
 {
 	rootAd = NULL;
 	curAd  = NULL;
+	matchLeft = NULL;
+	matchRight = NULL;
 
 	depth_remaining = MAX_CLASSAD_RECURSION;
 	flattenAndInline = false;	// NAC
@@ -464,6 +464,90 @@ EvalMatchExpr(ExprTree *match_expr)
 	return false;
 }
 
+void MatchContext::
+InitState( EvalState &state, const ClassAd *scope ) const
+{
+	state.curAd = scope;
+	state.rootAd = scope;
+	state.matchLeft = lad;
+	state.matchRight = rad;
+}
+
+bool MatchContext::
+EvaluateAttr( const ClassAd *scope, const string &attr, Value &val ) const
+{
+	EvalState	state;
+	ExprTree	*tree;
+
+	if( !scope ) {
+		return false;
+	}
+	InitState( state, scope );
+	switch( scope->LookupInScope( attr, tree, state ) ) {
+		case ExprTree::EVAL_OK:
+			return( tree->Evaluate( state, val ) );
+
+		case ExprTree::EVAL_UNDEF:
+			val.SetUndefinedValue( );
+			return( true );
+
+		case ExprTree::EVAL_ERROR:
+			val.SetErrorValue( );
+			return( true );
+
+		default:
+			return false;
+	}
+}
+
+bool MatchContext::
+EvaluateExpr( const ClassAd *scope, const ExprTree *expr, Value &val ) const
+{
+	EvalState	state;
+
+	if( !scope || !expr ) {
+		return false;
+	}
+	InitState( state, scope );
+	return( expr->Evaluate( state, val ) );
+}
+
+bool MatchContext::
+EvalRequirements( const ClassAd *scope ) const
+{
+	Value val;
+	if( !EvaluateAttr( scope, ATTR_REQUIREMENTS, val ) ) {
+		return false;
+	}
+	bool result = false;
+	if( val.IsBooleanValueEquiv( result ) ) {
+		return result;
+	}
+	long long int_result = 0;
+	if( val.IsIntegerValue( int_result ) ) {
+		return int_result != 0;
+	}
+	return false;
+}
+
+bool MatchContext::
+symmetricMatch() const
+{
+	return EvalRequirements( rad ) && EvalRequirements( lad );
+}
+
+bool MatchContext::
+rightMatchesLeft() const
+{
+	return EvalRequirements( lad );
+}
+
+bool MatchContext::
+leftMatchesRight() const
+{
+	return EvalRequirements( rad );
+}
+
 bool MatchClassAd::
 symmetricMatch()
 {
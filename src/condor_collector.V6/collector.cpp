@@ -114,6 +114,8 @@ int CollectorDaemon::max_pending_query_workers = 50;
 int CollectorDaemon::max_query_worktime = 0;
 int CollectorDaemon::active_query_workers = 0;
 int CollectorDaemon::pending_query_workers = 0;
+CollectorQueryThreads *CollectorDaemon::query_threads = NULL;
+int CollectorDaemon::query_scan_threads = 1;
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
 bool CollectorDaemon::want_track_queries_by_subsys = false;
@@ -121,6 +123,13 @@ bool CollectorDaemon::want_track_queries_by_subsys = false;
 
 AdTransforms CollectorDaemon::m_forward_ad_xfm;
 
+// knobs that are read for every query or invalidation, looked up once per reconfig.
+// the query knob is read by the query worker threads, so it must not use param() directly.
+static param_bool_handle protect_collector_ads_knob("PROTECT_COLLECTOR_ADS", false);
+static param_bool_handle ignore_invalidate_knob("IGNORE_INVALIDATE", false);
+static param_bool_handle expire_invalidated_ads_knob("EXPIRE_INVALIDATED_ADS", false);
+static param_bool_handle housekeeping_on_invalidate_knob("HOUSEKEEPING_ON_INVALIDATE", true);
+
 //---------------------------------------------------------
 
 
@@ -316,6 +325,20 @@ void CollectorDaemon::Init()
 	viewCollectorTypes = NULL;
 	UpdateTimerId=-1;
 	collectorsToUpdate = NULL;
+
+	// Answer queries with a pool of threads instead of forked workers?
+	// This can only be chosen at startup.  It is set up before Config()
+	// so that Config() knows to turn off lazy parsing of updates.
+	int num_query_threads = param_integer("COLLECTOR_QUERY_WORKER_THREADS", 0, 0);
+	if ( num_query_threads > 0 && ! query_threads ) {
+		query_threads = new CollectorQueryThreads();
+		if ( ! query_threads->start(num_query_threads, query_thread_work, query_thread_done)) {
+			dprintf(D_ALWAYS, "Failed to start query threads, will fork query workers instead\n");
+			delete query_threads;
+			query_threads = NULL;
+		}
+	}
+
 	Config();
 
 	// install command handlers for queries
@@ -333,7 +356,7 @@ void CollectorDaemon::Init()
 		receive_query_cedar,"receive_query_cedar",READ);
 	daemonCore->Register_CommandWithPayload(QUERY_LICENSE_ADS,"QUERY_LICENSE_ADS",
 		receive_query_cedar,"receive_query_cedar",READ);
-	if(param_boolean("PROTECT_COLLECTOR_ADS", false)) {
+	if(protect_collector_ads_knob.get()) {
 		daemonCore->Register_CommandWithPayload(QUERY_COLLECTOR_ADS,"QUERY_COLLECTOR_ADS",
 			receive_query_cedar,"receive_query_cedar",ADMINISTRATOR);
 	} else {
@@ -398,6 +421,8 @@ void CollectorDaemon::Init()
 		receive_update,"receive_update",ADVERTISE_STARTD_PERM);
 	daemonCore->Register_CommandWithPayload(MERGE_STARTD_AD,"MERGE_STARTD_AD",
 		receive_update,"receive_update",NEGOTIATOR);
+	daemonCore->Register_CommandWithPayload(UPDATE_STARTD_AD_DELTA,"UPDATE_STARTD_AD_DELTA",
+		receive_update,"receive_update",ADVERTISE_STARTD_PERM);
 	daemonCore->Register_CommandWithPayload(UPDATE_SCHEDD_AD,"UPDATE_SCHEDD_AD",
 		receive_update,"receive_update",ADVERTISE_SCHEDD_PERM);
 	daemonCore->Register_CommandWithPayload(UPDATE_SUBMITTOR_AD,"UPDATE_SUBMITTOR_AD",
@@ -533,6 +558,14 @@ int CollectorDaemon::receive_query_cedar(int command,
 	// Initial query handler
 	whichAds = receive_query_public( command );
 
+	// A client following the change feed only wants the ads that changed
+	// since its last query.  The reply rides along in the query ad so that
+	// it gets to whichever worker sends the results.
+	if (cad->Lookup(ATTR_CHANGE_FEED_SINCE)) {
+		ClassAd *reply = collector.changeFeedReply(whichAds, *cad);
+		cad->Insert(ATTR_CHANGE_FEED_REPLY, reply);
+	}
+
 	is_locate = cad->Lookup(ATTR_LOCATION_QUERY) != NULL;
 	if (is_locate) { rt.runtime = &HandleLocate_runtime; }
 
@@ -565,6 +598,11 @@ int CollectorDaemon::receive_query_cedar(int command,
 	if ( max_query_workers < 1 ) {
 		handle_in_proc = true;
 	}
+	// Query threads can't publish fresh statistics into the collector's
+	// own ad, since the statistics live in the main thread.
+	if ( query_threads && whichAds == COLLECTOR_AD ) {
+		handle_in_proc = true;
+	}
 
 	// Set a deadline on the query socket if the admin specified one in the config,
 	// but if the socket came to us with a previous (shorter) deadline, honor it.
@@ -792,6 +830,19 @@ int CollectorDaemon::QueryReaper(int pid, int /* exit_status */ )
 		}
 	}  // end of while queue_entry == NULL
 
+	if ( query_threads ) {
+		start_query_thread( query_entry );
+
+		active_query_workers++;
+		collectorStats.global.ActiveQueryWorkers = active_query_workers;
+
+		dprintf(D_FULLDEBUG,
+				"QueryWorker: started %squery in a query thread ( max %d active %d pending %d )\n",
+				high_prio_query ? "high priority " : "",
+				max_query_workers, active_query_workers, pending_query_workers);
+		return 1;
+	}
+
 	// If we have made it here, we are allowed to fork another worker
 	// to handle the query represented by query_entry. Fork one!
 	// First stash a copy of query_entry->sock and query_entry->cad so 
@@ -840,11 +891,12 @@ int CollectorDaemon::QueryReaper(int pid, int /* exit_status */ )
 }
 
 
-int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Stream* sock)
+bool CollectorDaemon::query_filter_private_ads(AdTypes whichAds, Stream *sock)
 {
-	int return_status = TRUE;
-	double begin = condor_gettimestamp_double();
-	List<ClassAd> results;
+		// Always send private attributes in private ads.
+	if (whichAds == STARTD_PVT_AD) {
+		return false;
+	}
 
 		// If our peer is at least 8.9.3 and has NEGOTIATOR authz, then we'll
 		// trust it to handle our capabilities.
@@ -858,26 +910,61 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 			filter_private_ads = false;
 		}
 	}
+	return filter_private_ads;
+}
+
+int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Stream* sock)
+{
+	double begin = condor_gettimestamp_double();
+	List<ClassAd> results;
 
 	// Pull out relavent state from query_entry
 	pending_query_entry_t *query_entry = (pending_query_entry_t *) in_query_entry;
-	ClassAd *cad = query_entry->cad;
-	bool is_locate = query_entry->is_locate;
 	AdTypes whichAds = query_entry->whichAds;
 
-		// Always send private attributes in private ads.
-	if (whichAds == STARTD_PVT_AD) {
-		filter_private_ads = false;
-	}
+	bool filter_private_ads = query_filter_private_ads(whichAds, sock);
 
 	// Perform the query
 
 	if (whichAds != (AdTypes) -1) {
-		process_query_public (whichAds, cad, &results);
+		process_query_public (whichAds, query_entry->cad, &results);
 	}
 
-	double end_query = condor_gettimestamp_double();
+	query_summary_t summary;
+	summary.matched = __numAds__;
+	summary.skipped = __failed__;
+	summary.filter = __filter__;
+	summary.limit = __resultLimit__;
+	summary.begin = begin;
+	summary.end_query = condor_gettimestamp_double();
+	summary.in_query_thread = false;
+
+	return send_query_results(query_entry, sock, results, filter_private_ads, summary);
+
+	// All done.  Note that DaemonCore will supposedly free() the query_entry
+	// struct itself and also delete sock.
+}
+
+// Evaluate a query's projection expression against one result ad.
+// EvalString() would borrow the process-wide match ad and set the
+// result ad's scope pointers, neither of which a query thread may do,
+// so the match is evaluated through a MatchContext instead.
+static bool
+evalProjectionInThread(ClassAd *query, ClassAd *ad, std::string &projection)
+{
+	classad::MatchContext ctx(query, ad);
+	classad::Value val;
+	return ctx.EvaluateAttr(query, ATTR_PROJECTION, val) && val.IsStringValue(projection);
+}
+
+int CollectorDaemon::send_query_results(pending_query_entry_t *query_entry, Stream *sock,
+	List<ClassAd> &results, bool filter_private_ads, const query_summary_t &summary)
+{
+	int return_status = TRUE;
+	ClassAd *cad = query_entry->cad;
+	AdTypes whichAds = query_entry->whichAds;
 	double end_write = 0.0;
+	std::string requirements;
 
 	// send the results via cedar			
 	sock->timeout(QueryTimeout); // set up a network timeout of a longer duration
@@ -910,7 +997,7 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 		// is increased we do NOT want to put the high-verbosity attributes into
 		// our persistent collector ad.
 		ClassAd * stats_ad = NULL;
-		if ((whichAds == COLLECTOR_AD) && collector.isSelfAd(curr_ad)) {
+		if ((whichAds == COLLECTOR_AD) && ! summary.in_query_thread && collector.isSelfAd(curr_ad)) {
 			dprintf(D_ALWAYS,"Query includes collector's self ad\n");
 			// update stats in the collector ad before we return it.
 			std::string stats_config;
@@ -929,7 +1016,10 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 		if (evaluate_projection) {
 			proj.clear();
 			projection.clear();
-			if (EvalString(ATTR_PROJECTION, cad, curr_ad, projection) && ! projection.empty()) {
+			bool have_projection = summary.in_query_thread ?
+				evalProjectionInThread(cad, curr_ad, projection) :
+				EvalString(ATTR_PROJECTION, cad, curr_ad, projection);
+			if (have_projection && ! projection.empty()) {
 				StringTokenIterator list(projection);
 				const std::string * attr;
 				while ((attr = list.next_string())) { proj.insert(*attr); }
@@ -960,6 +1050,15 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 
 	} // end of while loop for next result ad to send
 
+	// the change feed reply, if the client asked for one, goes last
+	if (classad::ClassAd *reply = dynamic_cast<classad::ClassAd *>(cad->Lookup(ATTR_CHANGE_FEED_REPLY))) {
+		if (!sock->code(more) || !putClassAd(sock, *reply)) {
+			dprintf (D_ALWAYS, "Error sending change feed reply to client -- aborting\n");
+			return_status = 0;
+			goto END;
+		}
+	}
+
 	// end of query response ...
 	more = 0;
 	if (!sock->code(more))
@@ -975,28 +1074,154 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 
 	end_write = condor_gettimestamp_double();
 
+	if (summary.filter) {
+		ExprTreeToString(summary.filter, requirements);
+	}
 	dprintf (D_ALWAYS,
 			 "Query info: matched=%d; skipped=%d; query_time=%f; send_time=%f; type=%s; requirements={%s}; locate=%d; limit=%d; from=%s; peer=%s; projection={%s}; filter_private_ads=%d\n",
-			 __numAds__,
-			 __failed__,
-			 end_query - begin,
-			 end_write - end_query,
+			 summary.matched,
+			 summary.skipped,
+			 summary.end_query - summary.begin,
+			 end_write - summary.end_query,
 			 AdTypeToString(whichAds),
-			 ExprTreeToString(__filter__),
-			 is_locate,
-			 (__resultLimit__ == INT_MAX) ? 0 : __resultLimit__,
+			 requirements.c_str(),
+			 query_entry->is_locate,
+			 (summary.limit == INT_MAX) ? 0 : summary.limit,
 			 query_entry->subsys,
 			 sock->peer_description(),
 			 projection.c_str(),
 			 filter_private_ads);
 END:
-	
-	// All done.  Deallocate memory allocated in this method.  Note that DaemonCore 
-	// will supposedly free() the query_entry struct itself and also delete sock.
-
 	return return_status;
 }
 
+// A query being answered by a query thread.  The main thread fills in
+// everything the thread needs, including the candidate ads from a pinned
+// snapshot of the collector tables, so the thread never has to look at
+// collector or DaemonCore state.
+struct threaded_query_t {
+	CollectorDaemon::pending_query_entry_t *entry;
+	bool filter_private_ads;
+	ExprTree *filter;
+	std::string adType;
+	int limit;
+	unsigned long snapshot;
+	std::vector<ClassAd *> candidates;
+	double begin;
+};
+
+void CollectorDaemon::start_query_thread(pending_query_entry_t *query_entry)
+{
+	threaded_query_t *tq = new threaded_query_t;
+	tq->entry = query_entry;
+	tq->begin = condor_gettimestamp_double();
+	tq->filter_private_ads = query_filter_private_ads(query_entry->whichAds, query_entry->sock);
+	tq->filter = NULL;
+	tq->limit = INT_MAX;
+	if (query_entry->whichAds != (AdTypes) -1) {
+		tq->filter = prepare_query_filter(query_entry->whichAds, query_entry->cad, tq->adType, tq->limit);
+	}
+	tq->snapshot = collector.pinSnapshot();
+	if (tq->filter) {
+		collector.snapshotAds(query_entry->whichAds, tq->filter, tq->candidates);
+	}
+	query_threads->submit(tq);
+}
+
+// Returns 1 if the ad matches the query's filter, 0 if not, and -1 if it
+// is not of the type asked for.  Safe to call from any number of threads.
+static int
+query_thread_match(const threaded_query_t *tq, ClassAd *cad)
+{
+	if ( ! tq->adType.empty()) {
+		std::string type;
+		cad->LookupString( ATTR_MY_TYPE, type );
+		if ( strcasecmp( type.c_str(), tq->adType.c_str() ) != 0 ) {
+			return -1;
+		}
+	}
+
+	classad::MatchContext ctx(cad, NULL);
+	classad::Value result;
+	bool val;
+	return ctx.EvaluateExpr(cad, tq->filter, result) && result.IsBooleanValueEquiv(val) && val;
+}
+
+// runs in a query thread
+void CollectorDaemon::query_thread_work(void *job)
+{
+	threaded_query_t *tq = (threaded_query_t *) job;
+	List<ClassAd> results;
+
+	query_summary_t summary;
+	summary.matched = 0;
+	summary.skipped = 0;
+	summary.filter = tq->filter;
+	summary.limit = tq->limit;
+	summary.begin = tq->begin;
+	summary.in_query_thread = true;
+
+	if (tq->filter) {
+			// Matching only reads the filter and the ads, so a big scan
+			// with no limit is split among threads.  The results are
+			// still sent in table order.
+		long count = (long)tq->candidates.size();
+		int scan_threads = query_scan_threads;
+		if (tq->limit != INT_MAX || count < 1000) {
+			scan_threads = 1;
+		}
+		std::vector<char> matched;
+		if (scan_threads > 1) {
+			matched.resize(count);
+#pragma omp parallel for num_threads(scan_threads) schedule(dynamic, 256)
+			for (long ii = 0; ii < count; ii++) {
+				matched[ii] = query_thread_match(tq, tq->candidates[ii]);
+			}
+		}
+
+		for (long ii = 0; ii < count; ii++) {
+			int match = (scan_threads > 1) ? matched[ii] : query_thread_match(tq, tq->candidates[ii]);
+			if (match < 0) {
+				continue;
+			}
+			if (match) {
+				summary.matched++;
+				results.Append(tq->candidates[ii]);
+				if (summary.matched >= tq->limit) {
+					break;
+				}
+			} else {
+				summary.skipped++;
+			}
+		}
+		dprintf (D_ALWAYS, "(Sending %d ads in response to query)\n", summary.matched);
+	}
+	summary.end_query = condor_gettimestamp_double();
+
+	send_query_results(tq->entry, tq->entry->sock, results, tq->filter_private_ads, summary);
+}
+
+// runs in the main thread once query_thread_work() is done with a query
+void CollectorDaemon::query_thread_done(void *job)
+{
+	threaded_query_t *tq = (threaded_query_t *) job;
+
+	collector.releaseSnapshot(tq->snapshot);
+
+	delete tq->entry->sock;
+	delete tq->entry->cad;
+	free(tq->entry);
+	delete tq;
+
+	if (active_query_workers > 0) {
+		active_query_workers--;
+	}
+	collectorStats.global.ActiveQueryWorkers = active_query_workers;
+
+	// start the next pending query, if any
+	QueryReaper(-1, -1);
+}
+
 AdTypes
 CollectorDaemon::receive_query_public( int command )
 {
@@ -1273,6 +1498,10 @@ int CollectorDaemon::receive_update(int command, Stream* sock)
 		{
 			// Rejected by COLLECTOR_REQUIREMENTS in validateClassad(),
 			// which already does all the necessary logging.
+			// The same goes for -5, a delta update that doesn't apply
+			// to the ad we have, which mergeClassAdDelta() logged.  We
+			// don't keep the socket, so the daemon reconnects and sends
+			// us a full ad.
 		}
 
 		return FALSE;
@@ -1282,6 +1511,11 @@ int CollectorDaemon::receive_update(int command, Stream* sock)
 	CollectorEngine_ru_collect_runtime += rt.tick(rt_last);
 #endif
 
+	// Once applied, a delta update is as good as a full one
+	if (command == UPDATE_STARTD_AD_DELTA) {
+		command = UPDATE_STARTD_AD;
+	}
+
 	/* let the off-line plug-in have at it */
 	offline_plugin_.update ( command, *cad );
 
@@ -1502,35 +1736,34 @@ int CollectorDaemon::query_scanFunc (ClassAd *cad)
 }
 
 
-void CollectorDaemon::process_query_public (AdTypes whichAds,
-											ClassAd *query,
-											List<ClassAd>* results)
+// Work out the constraint, ad type and result limit of a query, rewriting
+// the query's Requirements as needed.  Returns the constraint to use, or
+// NULL if the query doesn't have a usable one.
+ExprTree *CollectorDaemon::prepare_query_filter (AdTypes whichAds,
+												ClassAd *query,
+												std::string &adType,
+												int &limit)
 {
-	// set up for hashtable scan
-	__query__ = query;
-	__numAds__ = 0;
-	__failed__ = 0;
-	__ClassAdResultList__ = results;
 	// An empty adType means don't check the MyType of the ads.
 	// This means either the command indicates we're only checking one
 	// type of ad, or the query's TargetType is "Any" (match all ad types).
-	__adType__ = "";
+	adType = "";
 	if ( whichAds == GENERIC_AD || whichAds == ANY_AD ) {
-		query->LookupString( ATTR_TARGET_TYPE, __adType__ );
-		if ( strcasecmp( __adType__.c_str(), "any" ) == 0 ) {
-			__adType__ = "";
+		query->LookupString( ATTR_TARGET_TYPE, adType );
+		if ( strcasecmp( adType.c_str(), "any" ) == 0 ) {
+			adType = "";
 		}
 	}
 
-	__filter__ = query->LookupExpr( ATTR_REQUIREMENTS );
-	if ( __filter__ == NULL ) {
+	ExprTree *filter = query->LookupExpr( ATTR_REQUIREMENTS );
+	if ( filter == NULL ) {
 		dprintf (D_ALWAYS, "Query missing %s\n", ATTR_REQUIREMENTS );
-		return;
+		return NULL;
 	}
 
-	__resultLimit__ = INT_MAX; // no limit
-	if ( ! query->LookupInteger(ATTR_LIMIT_RESULTS, __resultLimit__) || __resultLimit__ <= 0) {
-		__resultLimit__ = INT_MAX; // no limit
+	limit = INT_MAX; // no limit
+	if ( ! query->LookupInteger(ATTR_LIMIT_RESULTS, limit) || limit <= 0) {
+		limit = INT_MAX; // no limit
 	}
 
 	// See if we should exclude Collector Ads from generic queries.  Still
@@ -1538,17 +1771,17 @@ void CollectorDaemon::process_query_public (AdTypes whichAds,
 	// ADMINISTRATOR when PROTECT_COLLECTOR_ADS is true.  This setting is
 	// designed only for use at the UW, and as such this knob is not present
 	// in the param table.
-	if ((whichAds != COLLECTOR_AD) && param_boolean("PROTECT_COLLECTOR_ADS", false)) {
+	if ((whichAds != COLLECTOR_AD) && protect_collector_ads_knob.get()) {
 		dprintf(D_FULLDEBUG, "Received query with generic type; filtering collector ads\n");
 		MyString modified_filter;
 		modified_filter.formatstr("(%s) && (MyType =!= \"Collector\")",
-			ExprTreeToString(__filter__));
+			ExprTreeToString(filter));
 		query->AssignExpr(ATTR_REQUIREMENTS,modified_filter.Value());
-		__filter__ = query->LookupExpr(ATTR_REQUIREMENTS);
-		if ( __filter__ == NULL ) {
+		filter = query->LookupExpr(ATTR_REQUIREMENTS);
+		if ( filter == NULL ) {
 			dprintf (D_ALWAYS, "Failed to parse modified filter: %s\n", 
 				modified_filter.Value());
-			return;
+			return NULL;
 		}
 		dprintf(D_FULLDEBUG,"Query after modification: *%s*\n",modified_filter.Value());
 	}
@@ -1564,19 +1797,37 @@ void CollectorDaemon::process_query_public (AdTypes whichAds,
 		if (!checks_absent) {
 			MyString modified_filter;
 			modified_filter.formatstr("(%s) && (%s =!= True)",
-				ExprTreeToString(__filter__),ATTR_ABSENT);
+				ExprTreeToString(filter),ATTR_ABSENT);
 			query->AssignExpr(ATTR_REQUIREMENTS,modified_filter.Value());
-			__filter__ = query->LookupExpr(ATTR_REQUIREMENTS);
-			if ( __filter__ == NULL ) {
+			filter = query->LookupExpr(ATTR_REQUIREMENTS);
+			if ( filter == NULL ) {
 				dprintf (D_ALWAYS, "Failed to parse modified filter: %s\n", 
 					modified_filter.Value());
-				return;
+				return NULL;
 			}
 			dprintf(D_FULLDEBUG,"Query after modification: *%s*\n",modified_filter.Value());
 		}
 	}
 
-	if (!collector.walkHashTable (whichAds, query_scanFunc))
+	return filter;
+}
+
+void CollectorDaemon::process_query_public (AdTypes whichAds,
+											ClassAd *query,
+											List<ClassAd>* results)
+{
+	// set up for hashtable scan
+	__query__ = query;
+	__numAds__ = 0;
+	__failed__ = 0;
+	__ClassAdResultList__ = results;
+	__resultLimit__ = INT_MAX;
+	__filter__ = prepare_query_filter( whichAds, query, __adType__, __resultLimit__ );
+	if ( __filter__ == NULL ) {
+		return;
+	}
+
+	if (!collector.walkHashTable (whichAds, __filter__, query_scanFunc))
 	{
 		dprintf (D_ALWAYS, "Error sending query response\n");
 	}
@@ -1591,41 +1842,35 @@ void CollectorDaemon::process_query_public (AdTypes whichAds,
 // invalidated ads allows the offline plugin to decide if they should go
 // absent, instead.
 //
-int CollectorDaemon::expiration_scanFunc (ClassAd *cad)
+void CollectorDaemon::expiration_updateFunc (ClassAd *cad)
 {
-    return setAttrLastHeardFrom( cad, 1 );
+	cad->Assign( ATTR_LAST_HEARD_FROM, 1 );
 }
 
-int CollectorDaemon::invalidation_scanFunc (ClassAd *cad)
+void CollectorDaemon::invalidation_updateFunc (ClassAd *cad)
 {
-    return setAttrLastHeardFrom( cad, 0 );
+	cad->Assign( ATTR_LAST_HEARD_FROM, 0 );
 }
 
-int CollectorDaemon::setAttrLastHeardFrom (ClassAd* cad, unsigned long time)
+bool CollectorDaemon::invalidation_matchFunc (ClassAd* cad)
 {
 	if ( !__adType__.empty() ) {
 		std::string type = "";
 		cad->LookupString( ATTR_MY_TYPE, type );
 		if ( strcasecmp( type.c_str(), __adType__.c_str() ) != 0 ) {
-			return 1;
+			return false;
 		}
 	}
 
 	classad::Value result;
 	bool val;
-	if ( EvalExprTree( __filter__, cad, NULL, result ) &&
-		 result.IsBooleanValueEquiv(val) && val ) {
-
-		cad->Assign( ATTR_LAST_HEARD_FROM, time );
-        __numAds__++;
-    }
-
-    return 1;
+	return EvalExprTree( __filter__, cad, NULL, result ) &&
+		result.IsBooleanValueEquiv(val) && val;
 }
 
 void CollectorDaemon::process_invalidation (AdTypes whichAds, ClassAd &query, Stream *sock)
 {
-	if (param_boolean("IGNORE_INVALIDATE", false)) {
+	if (ignore_invalidate_knob.get()) {
 		dprintf(D_ALWAYS, "Ignoring invalidate (IGNORE_INVALIDATE=TRUE)\n");
 		return;
 	}
@@ -1635,7 +1880,7 @@ void CollectorDaemon::process_invalidation (AdTypes whichAds, ClassAd &query, St
 
 	bool query_contains_hash_key = false;
 
-    bool expireInvalidatedAds = param_boolean( "EXPIRE_INVALIDATED_ADS", false );
+    bool expireInvalidatedAds = expire_invalidated_ads_knob.get();
     if( expireInvalidatedAds ) {
         __numAds__ = collector.expire( whichAds, query, &query_contains_hash_key );
     } else {        
@@ -1668,12 +1913,12 @@ void CollectorDaemon::process_invalidation (AdTypes whichAds, ClassAd &query, St
 
         if (expireInvalidatedAds)
         {
-            collector.walkHashTable (whichAds, expiration_scanFunc);
+            __numAds__ += collector.updateHashTable (whichAds, invalidation_matchFunc, expiration_updateFunc);
             collector.invokeHousekeeper (whichAds);
-        } else if (param_boolean("HOUSEKEEPING_ON_INVALIDATE", true)) 
+        } else if (housekeeping_on_invalidate_knob.get()) 
 		{
 			// first set all the "LastHeardFrom" attributes to low values ...
-			collector.walkHashTable (whichAds, invalidation_scanFunc);
+			__numAds__ += collector.updateHashTable (whichAds, invalidation_matchFunc, invalidation_updateFunc);
 
 			// ... then invoke the housekeeper
 			collector.invokeHousekeeper (whichAds);
@@ -1841,6 +2086,12 @@ void CollectorDaemon::Config()
 	// This it temporary (for 8.7.0) just in case we need to turn off the new getClassAdEx options
 	collector.m_get_ad_options = param_integer("COLLECTOR_GETAD_OPTIONS", GET_CLASSAD_FAST | GET_CLASSAD_LAZY_PARSE);
 	collector.m_get_ad_options &= (GET_CLASSAD_LAZY_PARSE | GET_CLASSAD_FAST | GET_CLASSAD_NO_CACHE);
+	if (query_threads && (collector.m_get_ad_options & GET_CLASSAD_LAZY_PARSE)) {
+		// a lazily parsed attribute is parsed in place the first time it is
+		// looked up, which query threads can't be allowed to do.
+		dprintf(D_ALWAYS, "Disabling lazy parsing of updates because COLLECTOR_QUERY_WORKER_THREADS is set\n");
+		collector.m_get_ad_options &= ~GET_CLASSAD_LAZY_PARSE;
+	}
 	MyString opts;
 	if (collector.m_get_ad_options & GET_CLASSAD_FAST) { opts += "fast "; }
 	if (collector.m_get_ad_options & GET_CLASSAD_NO_CACHE) { opts += "no-cache "; }
@@ -1864,6 +2115,7 @@ void CollectorDaemon::Config()
 	init_classad(i);
 
     // set the appropriate parameters in the collector engine
+    collector.configQueryIndexes();
     collector.setClientTimeout( ClientTimeout );
     collector.scheduleHousekeeper( ClassadLifetime );
 
@@ -1955,6 +2207,7 @@ void CollectorDaemon::Config()
     max_query_workers = param_integer ("COLLECTOR_QUERY_WORKERS", 4, 0);
 	max_pending_query_workers = param_integer ("COLLECTOR_QUERY_WORKERS_PENDING", 50, 0);
 	max_query_worktime = param_integer("COLLECTOR_QUERY_MAX_WORKTIME",0,0);
+	query_scan_threads = param_integer("COLLECTOR_QUERY_SCAN_THREADS",1,1);
 	reserved_for_highprio_query_workers = param_integer("COLLECTOR_QUERY_WORKERS_RESERVE_FOR_HIGH_PRIO",1,0);
 
 	// max_query_workers had better be at least one greater than reserved_for_highprio_query_workers,
@@ -2003,6 +2256,11 @@ void CollectorDaemon::Config()
 
 void CollectorDaemon::Exit()
 {
+	if ( query_threads ) {
+		query_threads->stop();
+		delete query_threads;
+		query_threads = NULL;
+	}
 	// Clean up any workers that have exited but haven't been reaped yet.
 	// This can occur if the collector receives a query followed
 	// immediately by a shutdown command.  The worker will exit but
@@ -2025,6 +2283,11 @@ void CollectorDaemon::Exit()
 
 void CollectorDaemon::Shutdown()
 {
+	if ( query_threads ) {
+		query_threads->stop();
+		delete query_threads;
+		query_threads = NULL;
+	}
 	// Clean up any workers that have exited but haven't been reaped yet.
 	// This can occur if the collector receives a query followed
 	// immediately by a shutdown command.  The worker will exit but
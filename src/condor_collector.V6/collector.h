@@ -28,6 +28,7 @@
 #include "forkwork.h"
 
 #include "collector_engine.h"
+#include "collector_query_threads.h"
 #include "collector_stats.h"
 #include "dc_collector.h"
 #include "offline_plugin.h"
@@ -105,13 +106,15 @@ public:
     static int receive_update_expect_ack(int, Stream*);
 
 	static void process_query_public(AdTypes, ClassAd*, List<ClassAd>*);
+	static ExprTree *prepare_query_filter(AdTypes, ClassAd*, std::string &adType, int &limit);
 	static ClassAd * process_global_query( const char *constraint, void *arg );
 	static int select_by_match( ClassAd *cad );
 	static void process_invalidation(AdTypes, ClassAd&, Stream*);
 
 	static int query_scanFunc(ClassAd*);
-	static int invalidation_scanFunc(ClassAd*);
-	static int expiration_scanFunc(ClassAd*);
+	static bool invalidation_matchFunc(ClassAd*);
+	static void invalidation_updateFunc(ClassAd*);
+	static void expiration_updateFunc(ClassAd*);
 
 	static int reportStartdScanFunc(ClassAd*);
 	static int reportSubmittorScanFunc(ClassAd*);
@@ -167,6 +170,28 @@ public:
 	static int active_query_workers;
 	static int pending_query_workers;
 
+	// when COLLECTOR_QUERY_WORKER_THREADS is set, queries that would
+	// otherwise be forked are answered by these threads instead.
+	static CollectorQueryThreads *query_threads;
+	static int query_scan_threads;  // threads to split one big query's scan among
+	static void start_query_thread(pending_query_entry_t *query_entry);
+	static void query_thread_work(void *job);
+	static void query_thread_done(void *job);
+
+	// what send_query_results() logs about a query
+	struct query_summary_t {
+		int matched;
+		int skipped;
+		int limit;
+		ExprTree *filter;
+		double begin;
+		double end_query;
+		bool in_query_thread;
+	};
+	static bool query_filter_private_ads(AdTypes whichAds, Stream *sock);
+	static int send_query_results(pending_query_entry_t *query_entry, Stream *sock,
+		List<ClassAd> &results, bool filter_private_ads, const query_summary_t &summary);
+
 #ifdef TRACK_QUERIES_BY_SUBSYS
 	static bool want_track_queries_by_subsys;
 #endif
@@ -216,8 +241,6 @@ protected:
 
 private:
 
-	static int setAttrLastHeardFrom( ClassAd* cad, unsigned long time );
-
 	static AdTransforms m_forward_ad_xfm;
 };
 
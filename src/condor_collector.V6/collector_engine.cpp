@@ -18,6 +18,7 @@
  ***************************************************************/
 
 #include "condor_common.h"
+#include <algorithm>
 
 extern "C" void event_mgr (void);
 
@@ -38,12 +39,16 @@ extern "C" void event_mgr (void);
 
 static void killHashTable (CollectorHashTable &);
 static int killGenericHashTable(CollectorHashTable *);
-static void purgeHashTable (CollectorHashTable &);
+static bool changeFeedAdChanged(const ClassAd &ad, const ClassAd &update, bool replaces);
 
 int 	engine_clientTimeoutHandler (Service *);
 int 	engine_housekeepingHandler  (Service *);
 
 CollectorEngine::CollectorEngine (CollectorStats *stats ) :
+	m_snapshotEpoch(0),
+	m_changeFeedSeq(0),
+	m_changeFeedFloor(0),
+	m_changeFeedMaxRemovals(0),
 	StartdAds     (&adNameHashFunction),
 	StartdPrivateAds(&adNameHashFunction),
 	ScheddAds     (&adNameHashFunction),
@@ -61,6 +66,8 @@ CollectorEngine::CollectorEngine (CollectorStats *stats ) :
 	GenericAds    (&hashFunction),
 	__self_ad__(0)
 {
+	formatstr(m_changeFeedEpoch, "%d.%lld", (int)getpid(), (long long)time(NULL));
+
 	clientTimeout = 20;
 	machineUpdateInterval = 30;
 	m_forwardInterval = machineUpdateInterval / 3;
@@ -94,6 +101,11 @@ CollectorEngine::
 	killHashTable (GridAds);
 	GenericAds.walk(killGenericHashTable);
 
+	for (auto & retired : m_retiredAds) {
+		delete retired.second;
+	}
+	m_retiredAds.clear();
+
 	if(m_collector_requirements) {
 		delete m_collector_requirements;
 		m_collector_requirements = NULL;
@@ -146,6 +158,12 @@ scheduleHousekeeper (int timeout)
 
 	m_forwardFilteringEnabled = param_boolean( "COLLECTOR_FORWARD_FILTERING", false );
 
+	m_changeFeedMaxRemovals = param_integer( "COLLECTOR_CHANGE_FEED_MAX_REMOVALS", 100000, 0 );
+	while ( m_changeFeedRemovals.size() > m_changeFeedMaxRemovals ) {
+		m_changeFeedFloor = m_changeFeedRemovals.front().seq;
+		m_changeFeedRemovals.pop_front();
+	}
+
 	// cancel outstanding housekeeping requests
 	if (housekeeperTimerID != -1)
 	{
@@ -235,7 +253,11 @@ CollectorEngine::invalidateAds(AdTypes adType, ClassAd &query)
 				dprintf(D_ALWAYS,
 						"\t\t**** Invalidating ad: \"%s\"\n",
 						hkString.Value());
-				delete ad;
+				if (CollectorAttrIndex *index = queryIndex(*table)) {
+					index->remove(ad);
+				}
+				noteRemoval(*table, hk);
+				retireAd(ad);
 				count++;
 			}
 		}
@@ -311,6 +333,242 @@ walkHashTable (AdTypes adType, int (*scanFunction)(ClassAd *))
 }
 
 
+int CollectorEngine::
+walkHashTable (AdTypes adType, classad::ExprTree *constraint, int (*scanFunction)(ClassAd *))
+{
+	CollectorHashTable *table;
+	CollectorEngine::HashFunc func;
+	if (ANY_AD == adType || GENERIC_AD == adType || !LookupByAdType(adType, table, func)) {
+		return walkHashTable(adType, scanFunction);
+	}
+
+	CollectorAttrIndex *index = queryIndex(*table);
+	std::vector<ClassAd*> candidates;
+	std::string index_used;
+	if (!index || !index->plan(constraint, candidates, &index_used)) {
+		return walkHashTable(adType, scanFunction);
+	}
+
+	dprintf(D_FULLDEBUG, "Query index on %s narrowed %d %s ads to %d\n",
+			index_used.c_str(), table->getNumElements(),
+			AdTypeToString(adType), (int)candidates.size());
+
+	for (ClassAd *ad : candidates) {
+		if (!scanFunction(ad)) {
+			break;
+		}
+	}
+
+	return 1;
+}
+
+CollectorAttrIndex *CollectorEngine::
+queryIndex(const CollectorHashTable &table)
+{
+	if (m_queryIndexes.empty()) {
+		return NULL;
+	}
+	auto it = m_queryIndexes.find(&table);
+	if (it == m_queryIndexes.end()) {
+		return NULL;
+	}
+	return &it->second;
+}
+
+void CollectorEngine::
+configQueryIndexes()
+{
+	static const AdTypes indexedTypes[] = {
+		STARTD_AD, STARTD_PVT_AD, SCHEDD_AD, SUBMITTOR_AD, LICENSE_AD,
+		MASTER_AD, CKPT_SRVR_AD, COLLECTOR_AD, STORAGE_AD, ACCOUNTING_AD,
+		NEGOTIATOR_AD, HAD_AD, GRID_AD,
+	};
+
+	std::string default_attrs;
+	param(default_attrs, "COLLECTOR_QUERY_INDEX_ATTRS");
+
+	for (AdTypes adType : indexedTypes) {
+		CollectorHashTable *table;
+		CollectorEngine::HashFunc func;
+		if (!LookupByAdType(adType, table, func)) {
+			continue;
+		}
+
+			// COLLECTOR_QUERY_INDEX_ATTRS_<type> overrides the default
+			// for one table, e.g. COLLECTOR_QUERY_INDEX_ATTRS_MACHINE
+		std::string knob("COLLECTOR_QUERY_INDEX_ATTRS_");
+		knob += AdTypeToString(adType);
+		std::string attr_list;
+		if (!param(attr_list, knob.c_str())) {
+			attr_list = default_attrs;
+		}
+
+		std::vector<std::string> attrs;
+		StringList sl(attr_list.c_str());
+		sl.rewind();
+		for (const char *attr = sl.next(); attr; attr = sl.next()) {
+			attrs.push_back(attr);
+		}
+
+		if (attrs.empty()) {
+			m_queryIndexes.erase(table);
+			continue;
+		}
+
+		CollectorAttrIndex &index = m_queryIndexes[table];
+		if (index.enabled() && index.attributes() == attrs) {
+			continue;
+		}
+
+		dprintf(D_ALWAYS, "Indexing %s ads on %s\n", AdTypeToString(adType), attr_list.c_str());
+		index.setAttributes(attrs);
+		ClassAd *ad;
+		table->startIterations();
+		while (table->iterate(ad)) {
+			index.insert(ad);
+		}
+	}
+}
+
+void CollectorEngine::
+tablesForAdType(AdTypes adType, std::vector<CollectorHashTable *> &tables)
+{
+	CollectorHashTable *table;
+	CollectorEngine::HashFunc func;
+	if (ANY_AD == adType) {
+		CollectorHashTable *all[] = {
+			&AccountingAds, &StorageAds, &CkptServerAds, &LicenseAds,
+			&CollectorAds, &StartdAds, &ScheddAds, &MasterAds,
+			&SubmittorAds, &NegotiatorAds, &HadAds, &GridAds,
+		};
+		tables.insert(tables.end(), all, all + sizeof(all)/sizeof(all[0]));
+	} else if (GENERIC_AD != adType) {
+		if (LookupByAdType(adType, table, func)) {
+			tables.push_back(table);
+		}
+		return;
+	}
+
+	GenericAds.startIterations();
+	while (GenericAds.iterate(table)) {
+		tables.push_back(table);
+	}
+}
+
+int CollectorEngine::
+updateHashTable(AdTypes adType, bool (*matchFunction)(ClassAd *), void (*updateFunction)(ClassAd *))
+{
+	std::vector<CollectorHashTable *> tables;
+	tablesForAdType(adType, tables);
+
+	int count = 0;
+	for (CollectorHashTable *table : tables) {
+		ClassAd *ad;
+		AdNameHashKey hk;
+		table->startIterations();
+		while (table->iterate(hk, ad)) {
+			if (matchFunction(ad)) {
+				ad = modifiableAd(*table, hk, ad);
+				updateFunction(ad);
+				noteChange(*table, ad);
+				if (CollectorAttrIndex *index = queryIndex(*table)) {
+					index->update(ad);
+				}
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+unsigned long CollectorEngine::
+pinSnapshot()
+{
+	m_pinnedEpochs.insert(++m_snapshotEpoch);
+	return m_snapshotEpoch;
+}
+
+void CollectorEngine::
+releaseSnapshot(unsigned long epoch)
+{
+	auto it = m_pinnedEpochs.find(epoch);
+	if (it == m_pinnedEpochs.end()) {
+		dprintf(D_ALWAYS, "Releasing unknown query snapshot %lu\n", epoch);
+		return;
+	}
+	m_pinnedEpochs.erase(it);
+	freeRetiredAds();
+}
+
+void CollectorEngine::
+snapshotAds(AdTypes adType, classad::ExprTree *constraint, std::vector<ClassAd*> &ads)
+{
+	ads.clear();
+
+	std::vector<CollectorHashTable *> tables;
+	tablesForAdType(adType, tables);
+
+	if (tables.size() == 1 && ANY_AD != adType && GENERIC_AD != adType) {
+		CollectorAttrIndex *index = queryIndex(*tables[0]);
+		if (index && index->plan(constraint, ads)) {
+			return;
+		}
+	}
+
+	for (CollectorHashTable *table : tables) {
+		ads.reserve(ads.size() + table->getNumElements());
+		ClassAd *ad;
+		table->startIterations();
+		while (table->iterate(ad)) {
+			ads.push_back(ad);
+		}
+	}
+}
+
+// An ad retired at epoch E may be seen by any snapshot pinned at or
+// before E, so it can be freed once every pinned epoch is later than E.
+void CollectorEngine::
+retireAd(ClassAd *ad)
+{
+	if (m_pinnedEpochs.empty()) {
+		delete ad;
+		return;
+	}
+	m_retiredAds.emplace_back(m_snapshotEpoch, ad);
+}
+
+void CollectorEngine::
+freeRetiredAds()
+{
+	while ( ! m_retiredAds.empty()) {
+		if ( ! m_pinnedEpochs.empty() && m_retiredAds.front().first >= *m_pinnedEpochs.begin()) {
+			break;
+		}
+		delete m_retiredAds.front().second;
+		m_retiredAds.pop_front();
+	}
+}
+
+ClassAd *CollectorEngine::
+modifiableAd(CollectorHashTable &table, AdNameHashKey &hk, ClassAd *ad)
+{
+	if (m_pinnedEpochs.empty()) {
+		return ad;
+	}
+
+	ClassAd *copy = new ClassAd(*ad);
+	if (table.insert(hk, copy, true) == -1) {
+		EXCEPT("Error replacing ad");
+	}
+	if (CollectorAttrIndex *index = queryIndex(table)) {
+		index->remove(ad);
+		index->insert(copy);
+	}
+	if (isSelfAd(ad)) { __self_ad__ = copy; }
+	retireAd(ad);
+	return copy;
+}
+
 CollectorHashTable *CollectorEngine::findOrCreateTable(MyString &type)
 {
 	CollectorHashTable *table=0;
@@ -431,6 +689,7 @@ bool CollectorEngine::ValidateClassAd(int command,ClassAd *clientAd,Sock *sock)
 	  case MERGE_STARTD_AD:
 	  case UPDATE_STARTD_AD:
 	  case UPDATE_STARTD_AD_WITH_ACK:
+	  case UPDATE_STARTD_AD_DELTA:
 		  ipattr = ATTR_STARTD_IP_ADDR;
 		  break;
 	  case UPDATE_OWN_SUBMITTOR_AD:
@@ -555,7 +814,8 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 		repeatStartdAds = param_integer("COLLECTOR_REPEAT_STARTD_ADS",0);
 	}
 
-	if( !ValidateClassAd(command,clientAd,sock) ) {
+		// A delta is validated below, once we know what it applies to.
+	if( command != UPDATE_STARTD_AD_DELTA && !ValidateClassAd(command,clientAd,sock) ) {
 	    insert = -4;
 		return NULL;
 	}
@@ -686,6 +946,60 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 							  clientAd, hk, hashString, insert, from );
 		break;
 
+	  case UPDATE_STARTD_AD_DELTA:
+		if (!makeStartdAdHashKey (hk, clientAd))
+		{
+			dprintf (D_ALWAYS, "Could not make hashkey --- ignoring ad\n");
+			insert = -3;
+			retVal = 0;
+			break;
+		}
+		hashString.Build( hk );
+
+		{
+				// COLLECTOR_REQUIREMENTS are written against whole ads,
+				// so check them against the delta laid over our ad.
+			ClassAd *oldAd = NULL;
+			if (StartdAds.lookup(hk, oldAd) == 0) {
+				clientAd->ChainToAd(oldAd);
+			}
+			bool valid = ValidateClassAd(command, clientAd, sock);
+			clientAd->Unchain();
+			if (!valid) {
+				insert = -4;
+				retVal = 0;
+				break;
+			}
+		}
+
+		retVal=mergeClassAdDelta (StartdAds, "StartdAd     ", "Start",
+								  clientAd, hk, hashString, insert, from );
+		if (!retVal) {
+			break;
+		}
+
+		if (!sock)
+		{
+			dprintf (D_ALWAYS, "Want private ads, but no socket given!\n");
+			break;
+		}
+		if (!(pvtAd = new ClassAd))
+		{
+			EXCEPT ("Memory error!");
+		}
+		if( !getClassAdEx(sock, *pvtAd, m_get_ad_options) )
+		{
+			dprintf(D_FULLDEBUG,"\t(Could not get startd's private ad delta)\n");
+			delete pvtAd;
+			break;
+		}
+		if (!mergeClassAdDelta (StartdPrivateAds, "StartdPvtAd  ", "StartdPvt",
+								pvtAd, hk, hashString, insPvt, from ))
+		{
+			delete pvtAd;
+		}
+		break;
+
 	  case UPDATE_SCHEDD_AD:
 		if (!makeScheddAdHashKey (hk, clientAd))
 		{
@@ -957,7 +1271,11 @@ int CollectorEngine::remove (AdTypes t_AddType, const ClassAd & c_query, bool *q
 				hk.sprint( hkString );
 				iRet = !table->remove(hk);
 				dprintf (D_ALWAYS,"\t\t**** Removed(%d) ad(s): \"%s\"\n", iRet, hkString.Value() );
-				delete pAd;
+				if (CollectorAttrIndex *index = queryIndex(*table)) {
+					index->remove(pAd);
+				}
+				noteRemoval(*table, hk);
+				retireAd(pAd);
 			}
 		}
 	}
@@ -978,9 +1296,12 @@ int CollectorEngine::expire( AdTypes adType, const ClassAd & query, bool * query
 
             ClassAd * cAd = NULL;
             if( hTable->lookup( hKey, cAd ) != -1 ) {
+                cAd = modifiableAd( * hTable, hKey, cAd );
                 cAd->Assign( ATTR_LAST_HEARD_FROM, 1 );
                 
                 if( CollectorDaemon::offline_plugin_.expire( * cAd ) == true ) {
+                    noteChange( * hTable, cAd );
+                    noteRemoval( * hTable, hKey );
                     return rVal;
                 }
                 
@@ -995,7 +1316,11 @@ int CollectorEngine::expire( AdTypes adType, const ClassAd & query, bool * query
                 hKey.sprint( hkString );                
                 dprintf( D_ALWAYS, "\t\t**** Removed(%d) stale ad(s): \"%s\"\n", rVal, hkString.Value() );
 
-                delete cAd;
+                if( CollectorAttrIndex * index = queryIndex( * hTable ) ) {
+                    index->remove( cAd );
+                }
+                noteRemoval( * hTable, hKey );
+                retireAd( cAd );
             }
         }
     }
@@ -1011,7 +1336,16 @@ remove (AdTypes adType, AdNameHashKey &hk)
 	if (!LookupByAdType(adType, table, func)) {
 		return 0;
 	}
-	return !table->remove(hk);
+	CollectorAttrIndex *index = queryIndex(*table);
+	ClassAd *ad = NULL;
+	if (index && table->lookup(hk, ad) == 0) {
+		index->remove(ad);
+	}
+	int removed = !table->remove(hk);
+	if (removed) {
+		noteRemoval(*table, hk);
+	}
+	return removed;
 }
 
 void CollectorEngine::
@@ -1063,6 +1397,8 @@ updateClassAd (CollectorHashTable &hashTable,
 			collectorStats->update( label, NULL, new_ad );
 		}
 
+		noteChange(hashTable, new_ad);
+
 		// Now, store it away
 		if (hashTable.insert (hk, new_ad) == -1)
 		{
@@ -1075,6 +1411,10 @@ updateClassAd (CollectorHashTable &hashTable,
 			new_ad->Assign( ATTR_LAST_FORWARDED, (int)time(NULL) );
 		}
 
+		if (CollectorAttrIndex *index = queryIndex(hashTable)) {
+			index->insert(new_ad);
+		}
+
 		return new_ad;
 	}
 	else
@@ -1087,6 +1427,8 @@ updateClassAd (CollectorHashTable &hashTable,
 			collectorStats->update( label, old_ad, new_ad );
 		}
 
+		noteChange(hashTable, new_ad, old_ad);
+
 		// Now, finally, store the new ClassAd
 		if (hashTable.remove(hk) == -1) {
 			EXCEPT( "Error removing ad" );
@@ -1124,7 +1466,12 @@ updateClassAd (CollectorHashTable &hashTable,
 
 		if (isSelfAd(old_ad)) { __self_ad__ = new_ad; }
 
-		delete old_ad;
+		if (CollectorAttrIndex *index = queryIndex(hashTable)) {
+			index->remove(old_ad);
+			index->insert(new_ad);
+		}
+
+		retireAd(old_ad);
 
 		insert = 0;
 		return new_ad;
@@ -1166,14 +1513,282 @@ mergeClassAd (CollectorHashTable &hashTable,
 		new_ad_copy.Delete(ATTR_MY_TYPE);
 		new_ad_copy.Delete(ATTR_TARGET_TYPE);
 
+		bool changed = changeFeedAdChanged(*old_ad, new_ad_copy, false);
+
 		// Now, finally, merge the new ClassAd into the old one
+		old_ad = modifiableAd(hashTable, hk, old_ad);
 		MergeClassAds(old_ad,&new_ad_copy,true);
+		if (changed) {
+			noteChange(hashTable, old_ad);
+		}
+
+		if (CollectorAttrIndex *index = queryIndex(hashTable)) {
+			index->update(old_ad);
+		}
 	}
 	delete new_ad;
 	return old_ad;
 }
 
 
+// A delta update holds the current value of every attribute that has
+// changed since the full ad it is based on, and a list of the ones that
+// have been removed.  So it can be applied to any ad we got from that
+// full ad or a later delta, but not to anything older, newer, or from an
+// earlier run of the daemon.  We ignore those; the daemon sends a full ad
+// again when it reconnects, and periodically in any case.
+ClassAd * CollectorEngine::
+mergeClassAdDelta (CollectorHashTable &hashTable,
+				   const char *adType,
+				   const char *label,
+				   ClassAd *delta,
+				   AdNameHashKey &hk,
+				   const MyString &hashString,
+				   int  &insert,
+				   const condor_sockaddr& from )
+{
+	ClassAd		*old_ad = NULL;
+	long long	base_seq = -1, seq = -1, old_seq = -1;
+	long long	start_time = -1, old_start_time = -1;
+
+	insert = -5;
+
+	if ( hashTable.lookup (hk, old_ad) == -1 ) {
+		dprintf (D_ALWAYS, "%s: Ignoring delta update for ** \"%s\" because "
+				 "no existing ad matches.\n", adType, hashString.Value() );
+		return NULL;
+	}
+
+	delta->LookupInteger( ATTR_DELTA_BASE_SEQUENCE_NUMBER, base_seq );
+	delta->LookupInteger( ATTR_UPDATE_SEQUENCE_NUMBER, seq );
+	delta->LookupInteger( ATTR_DAEMON_START_TIME, start_time );
+	old_ad->LookupInteger( ATTR_UPDATE_SEQUENCE_NUMBER, old_seq );
+	old_ad->LookupInteger( ATTR_DAEMON_START_TIME, old_start_time );
+	if ( base_seq < 0 || start_time != old_start_time ||
+		 old_seq < base_seq || old_seq >= seq )
+	{
+		dprintf (D_ALWAYS, "%s: Ignoring delta update for ** \"%s\" "
+				 "(sequence %lld from %lld) because we have sequence %lld%s\n",
+				 adType, hashString.Value(), seq, base_seq, old_seq,
+				 start_time != old_start_time ? " from another daemon start" : "" );
+		return NULL;
+	}
+
+	dprintf (D_FULLDEBUG, "%s: Applying delta update for ... \"%s\"\n",
+			 adType, hashString.Value() );
+
+	if (strcmp(label, "StartdPvt") != 0) {
+		collectorStats->update( label, old_ad, delta );
+	}
+
+	StringList removed;
+	std::string removed_str;
+	if ( delta->LookupString( ATTR_DELTA_REMOVED_ATTRIBUTES, removed_str ) ) {
+		removed.initializeFromString( removed_str.c_str() );
+	}
+	delta->Delete( ATTR_DELTA_REMOVED_ATTRIBUTES );
+	delta->Delete( ATTR_DELTA_BASE_SEQUENCE_NUMBER );
+
+	time_t now = time(NULL);
+	delta->Assign( ATTR_LAST_HEARD_FROM, now );
+
+	if ( m_forwardFilteringEnabled && ( strcmp( label, "Start" ) == 0 || strcmp( label, "StartdPvt" ) == 0 ) ) {
+		bool forward = false;
+		int last_forwarded = 0;
+		old_ad->LookupInteger( ATTR_LAST_FORWARDED, last_forwarded );
+		if ( last_forwarded + m_forwardInterval < now ) {
+			forward = true;
+		} else {
+			classad::Value old_val;
+			classad::Value new_val;
+			const char *attr;
+			m_forwardWatchList.rewind();
+			while ( (attr = m_forwardWatchList.next()) ) {
+				if ( removed.contains_anycase( attr ) ) {
+					forward = old_ad->Lookup( attr ) != NULL;
+				} else if ( delta->Lookup( attr ) ) {
+					forward = old_ad->EvaluateAttr( attr, old_val ) &&
+						delta->EvaluateAttr( attr, new_val ) &&
+						!new_val.SameAs( old_val );
+				}
+				if ( forward ) {
+					break;
+				}
+			}
+		}
+		delta->Assign( ATTR_SHOULD_FORWARD, forward );
+		delta->Assign( ATTR_LAST_FORWARDED, forward ? (int)now : last_forwarded );
+	}
+
+		// mergeClassAd() deletes the delta
+	old_ad = mergeClassAd( hashTable, adType, label, delta, hk, hashString,
+						   insert, from );
+	if ( old_ad && ! removed.isEmpty() ) {
+		const char *attr;
+		bool changed = false;
+		removed.rewind();
+		while ( (attr = removed.next()) ) {
+			if ( old_ad->Delete( attr ) ) {
+				changed = true;
+			}
+		}
+		if ( changed ) {
+			noteChange( hashTable, old_ad );
+		}
+		if (CollectorAttrIndex *index = queryIndex(hashTable)) {
+			index->update(old_ad);
+		}
+	}
+	return old_ad;
+}
+
+
+AdTypes CollectorEngine::
+changeFeedType(const CollectorHashTable &table) const
+{
+	if (&table == &StartdAds) { return STARTD_AD; }
+	if (&table == &StartdPrivateAds) { return STARTD_PVT_AD; }
+	if (&table == &SubmittorAds) { return SUBMITTOR_AD; }
+	return NO_AD;
+}
+
+// Attributes that change with every update, whether or not anything about
+// the daemon did.  A change to only these doesn't send the ad to the
+// change feed clients again.
+static bool
+changeFeedIgnoresAttr(const std::string &attr)
+{
+	return strcasecmp(attr.c_str(), ATTR_CHANGE_FEED_AD_SEQUENCE) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_LAST_HEARD_FROM) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_UPDATE_SEQUENCE_NUMBER) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_MY_CURRENT_TIME) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_LAST_FORWARDED) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_SHOULD_FORWARD) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_UPDATESTATS_TOTAL) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_UPDATESTATS_SEQUENCED) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_UPDATESTATS_LOST) == 0 ||
+		strcasecmp(attr.c_str(), ATTR_UPDATESTATS_HISTORY) == 0;
+}
+
+// Returns true if update gives any attribute a value other than the one it
+// has in ad.  If update replaces ad, an attribute of ad that update doesn't
+// have is a change as well.
+static bool
+changeFeedAdChanged(const ClassAd &ad, const ClassAd &update, bool replaces)
+{
+	for (auto itr = update.begin(); itr != update.end(); ++itr) {
+		if (changeFeedIgnoresAttr(itr->first)) {
+			continue;
+		}
+		ExprTree *tree = ad.Lookup(itr->first);
+		if ( ! tree || ! tree->SameAs(itr->second)) {
+			return true;
+		}
+	}
+	if (replaces) {
+		for (auto itr = ad.begin(); itr != ad.end(); ++itr) {
+			if ( ! changeFeedIgnoresAttr(itr->first) && ! update.Lookup(itr->first)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Stamp ad with the next change sequence number.  If ad replaces old_ad
+// without changing anything that matters, it keeps old_ad's number instead,
+// so that a daemon's periodic updates aren't sent to the clients every time.
+void CollectorEngine::
+noteChange(const CollectorHashTable &table, ClassAd *ad, const ClassAd *old_ad)
+{
+	if (changeFeedType(table) == NO_AD) {
+		return;
+	}
+	long long seq;
+	if (old_ad && old_ad->LookupInteger(ATTR_CHANGE_FEED_AD_SEQUENCE, seq) &&
+		! changeFeedAdChanged(*old_ad, *ad, true))
+	{
+		ad->Assign(ATTR_CHANGE_FEED_AD_SEQUENCE, seq);
+		return;
+	}
+	ad->Assign(ATTR_CHANGE_FEED_AD_SEQUENCE, ++m_changeFeedSeq);
+}
+
+// Ads that become absent are also noted as removals, since most clients
+// don't see absent ads and would otherwise never learn they went away.
+void CollectorEngine::
+noteRemoval(const CollectorHashTable &table, const AdNameHashKey &hk)
+{
+	AdTypes adType = changeFeedType(table);
+	if (adType == NO_AD) {
+		return;
+	}
+	ChangeFeedRemoval removal;
+	removal.seq = ++m_changeFeedSeq;
+	removal.adType = adType;
+	MyString key;
+	hk.sprint(key);
+	removal.key = key.Value();
+	m_changeFeedRemovals.push_back(removal);
+	while (m_changeFeedRemovals.size() > m_changeFeedMaxRemovals) {
+		m_changeFeedFloor = m_changeFeedRemovals.front().seq;
+		m_changeFeedRemovals.pop_front();
+	}
+}
+
+ClassAd * CollectorEngine::
+changeFeedReply(AdTypes whichAds, ClassAd &query)
+{
+	long long since = -1;
+	std::string epoch;
+	query.LookupInteger(ATTR_CHANGE_FEED_SINCE, since);
+	query.LookupString(ATTR_CHANGE_FEED_EPOCH, epoch);
+
+	ClassAd *reply = new ClassAd;
+	SetMyTypeName(*reply, CHANGE_FEED_ADTYPE);
+	reply->Assign(ATTR_CHANGE_FEED_EPOCH, m_changeFeedEpoch);
+	reply->Assign(ATTR_CHANGE_FEED_SEQUENCE, m_changeFeedSeq);
+
+		// Anything we can't answer for gets the full set of ads
+	if (epoch != m_changeFeedEpoch || since < m_changeFeedFloor || since > m_changeFeedSeq ||
+		(whichAds != ANY_AD && whichAds != STARTD_AD && whichAds != STARTD_PVT_AD && whichAds != SUBMITTOR_AD))
+	{
+		reply->Assign(ATTR_CHANGE_FEED_RESET, true);
+		return reply;
+	}
+	reply->Assign(ATTR_CHANGE_FEED_RESET, false);
+
+	std::string requirements = "true";
+	ExprTree *tree = query.LookupExpr(ATTR_REQUIREMENTS);
+	if (tree) {
+		requirements = ExprTreeToString(tree);
+	}
+	formatstr(requirements, "(%s) && (%s > %lld)", std::string(requirements).c_str(),
+		ATTR_CHANGE_FEED_AD_SEQUENCE, since);
+	query.AssignExpr(ATTR_REQUIREMENTS, requirements.c_str());
+
+		// The removals are in sequence order, so only look at the ones
+		// since the client's last query.
+	std::string removed;
+	auto it = std::upper_bound(m_changeFeedRemovals.begin(), m_changeFeedRemovals.end(), since,
+		[](long long seq, const ChangeFeedRemoval &removal) { return seq < removal.seq; });
+	for ( ; it != m_changeFeedRemovals.end(); ++it) {
+		bool wanted = (whichAds == ANY_AD) ? (it->adType != STARTD_PVT_AD) : (it->adType == whichAds);
+		if ( ! wanted) {
+			continue;
+		}
+		if ( ! removed.empty()) {
+			removed += "\n";
+		}
+		removed += (it->adType == SUBMITTOR_AD) ? SUBMITTER_ADTYPE : STARTD_ADTYPE;
+		removed += " ";
+		removed += it->key;
+	}
+	reply->Assign(ATTR_CHANGE_FEED_REMOVED, removed);
+	return reply;
+}
+
+
 void
 CollectorEngine::
 housekeeper()
@@ -1243,8 +1858,10 @@ housekeeper()
 }
 
 void CollectorEngine::
-cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey) const
+cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey)
 {
+	CollectorAttrIndex *index = queryIndex(hashTable);
+
 	ClassAd  *ad;
 	int   	 timeStamp;
 	int		 max_lifetime;
@@ -1283,8 +1900,11 @@ cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey) con
 				   potentially mark the ad absent. if expire() returns false, then delete
 				   the ad as planned; if it return true, it was likely marked as absent,
 				   so then this ad should NOT be deleted. */
+				ad = modifiableAd( hashTable, hk, ad );
 				if ( CollectorDaemon::offline_plugin_.expire( *ad ) == true ) {
 					// plugin say to not delete this ad, so continue
+					noteChange( hashTable, ad );
+					noteRemoval( hashTable, hk );
 					continue;
 				} else {
 					dprintf (D_ALWAYS,"\t\t**** Removing stale ad: \"%s\"\n", hkString.Value() );
@@ -1294,7 +1914,13 @@ cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey) con
 			{
 				dprintf (D_ALWAYS, "\t\tError while removing ad\n");
 			}
-			delete ad;
+			else {
+				noteRemoval(hashTable, hk);
+			}
+			if (index) {
+				index->remove(ad);
+			}
+			retireAd(ad);
 		}
 	}
 }
@@ -1367,7 +1993,7 @@ CollectorEngine::LookupByAdType(AdTypes adType,
 }
 
 
-static void
+void CollectorEngine::
 purgeHashTable( CollectorHashTable &table )
 {
 	ClassAd* ad;
@@ -1376,8 +2002,13 @@ purgeHashTable( CollectorHashTable &table )
 	while( table.iterate(hk,ad) ) {
 		if( table.remove(hk) == -1 ) {
 			dprintf( D_ALWAYS, "\t\tError while removing ad\n" );
-		}		
-		delete ad;
+		} else {
+			noteRemoval(table, hk);
+		}
+		retireAd(ad);
+	}
+	if (CollectorAttrIndex *index = queryIndex(table)) {
+		index->clear();
 	}
 }
 
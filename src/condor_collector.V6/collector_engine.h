@@ -23,8 +23,14 @@
 #include "condor_classad.h"
 
 #include "collector_stats.h"
+#include "collector_index.h"
 #include "hashkey.h"
 
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+
 class CollectorEngine : public Service
 {
   public:
@@ -70,6 +76,34 @@ class CollectorEngine : public Service
 	// walk specified hash table with the given visit procedure
 	int walkHashTable (AdTypes, int (*)(ClassAd *));
 
+	// as walkHashTable, but when the table has a query index that can
+	// answer an equality conjunct of the constraint, only visit the ads
+	// that could possibly match.  The visit procedure must still evaluate
+	// the constraint.
+	int walkHashTable (AdTypes, classad::ExprTree *constraint, int (*)(ClassAd *));
+
+	// as walkHashTable, but for visits that modify ads.  updateFunction
+	// is called on each ad for which matchFunction returns true; if query
+	// snapshots are pinned, it is handed a private copy that replaces the
+	// ad in the table.  Returns the number of ads updated.
+	int updateHashTable (AdTypes, bool (*matchFunction)(ClassAd *), void (*updateFunction)(ClassAd *));
+
+	// (re)read COLLECTOR_QUERY_INDEX_ATTRS and rebuild the query indexes
+	void configQueryIndexes();
+
+	// Query snapshots, for answering queries outside of the main thread.
+	// While a snapshot is pinned, ads are never modified in place or
+	// deleted; instead they are copied on write and the old copy is
+	// retired until every snapshot that could still see it is released.
+	// snapshotAds() fills ads with the ads a query of the given type and
+	// constraint has to look at (narrowed by the query index when
+	// possible).  The pointers stay valid until releaseSnapshot() is
+	// called with the epoch returned by the pinSnapshot() call before it.
+	unsigned long pinSnapshot();
+	void releaseSnapshot(unsigned long epoch);
+	bool snapshotsActive() const { return ! m_pinnedEpochs.empty(); }
+	void snapshotAds(AdTypes, classad::ExprTree *constraint, std::vector<ClassAd*> &ads);
+
 	// Walk through a specific (non-generic, non-ANY) table using a lambda
 	template<typename T>
 	int walkConcreteTable(AdTypes adType, T scanFunction) {
@@ -109,10 +143,55 @@ class CollectorEngine : public Service
 		// returns true on success; false on failure (and sets error_desc)
 	bool setCollectorRequirements( char const *str, MyString &error_desc );
 
+	// The change feed, which lets a client (the negotiator) keep its own
+	// copy of the startd, private and submitter ads up to date by asking
+	// only for what changed since its last query.  Every change to those
+	// tables gets the next change sequence number; changed ads are stamped
+	// with it, and removals are remembered for a while.  If a query asks
+	// for the changes since a sequence number we can still answer for,
+	// changeFeedReply() narrows the query's Requirements to the ads that
+	// changed since then.  It returns the ad to send after the results,
+	// which tells the client where it is now, what was removed, and
+	// whether it has to start over from the full set of ads.
+	ClassAd *changeFeedReply(AdTypes whichAds, ClassAd &query);
+
   private:
 	typedef bool (*HashFunc) (AdNameHashKey &, const ClassAd *);
 
 	bool LookupByAdType(AdTypes, CollectorHashTable *&, HashFunc &);
+
+	// secondary attribute indexes, keyed by the table they index.
+	// returns NULL if the table has no index.
+	std::map<const CollectorHashTable *, CollectorAttrIndex> m_queryIndexes;
+	CollectorAttrIndex *queryIndex(const CollectorHashTable &table);
+
+	// the tables that hold ads of the given type (all of them for ANY_AD)
+	void tablesForAdType(AdTypes, std::vector<CollectorHashTable *> &tables);
+
+	// query snapshot bookkeeping, see pinSnapshot()
+	unsigned long m_snapshotEpoch;
+	std::multiset<unsigned long> m_pinnedEpochs;
+	std::deque<std::pair<unsigned long, ClassAd *> > m_retiredAds;
+	void retireAd(ClassAd *ad);
+	void freeRetiredAds();
+	// returns an ad that may be modified in place; either ad itself, or if
+	// snapshots are pinned, a copy of it that has replaced it in the table.
+	ClassAd *modifiableAd(CollectorHashTable &table, AdNameHashKey &hk, ClassAd *ad);
+
+	// change feed bookkeeping, see changeFeedReply()
+	struct ChangeFeedRemoval {
+		long long seq;
+		AdTypes adType;
+		std::string key;
+	};
+	std::string m_changeFeedEpoch;
+	long long m_changeFeedSeq;
+	long long m_changeFeedFloor;	// removals up to here have been forgotten
+	size_t m_changeFeedMaxRemovals;
+	std::deque<ChangeFeedRemoval> m_changeFeedRemovals;
+	AdTypes changeFeedType(const CollectorHashTable &table) const;
+	void noteChange(const CollectorHashTable &table, ClassAd *ad, const ClassAd *old_ad = NULL);
+	void noteRemoval(const CollectorHashTable &table, const AdNameHashKey &hk);
  
 	// the greater tables
 
@@ -154,7 +233,8 @@ class CollectorEngine : public Service
 
 	void  housekeeper ();
 	int  housekeeperTimerID;
-	void cleanHashTable (CollectorHashTable &, time_t, HashFunc) const;
+	void cleanHashTable (CollectorHashTable &, time_t, HashFunc);
+	void purgeHashTable (CollectorHashTable &);
 	ClassAd* updateClassAd(CollectorHashTable&,const char*, const char *,
 						   ClassAd*,AdNameHashKey&, const MyString &, int &, 
 						   const condor_sockaddr& );
@@ -168,6 +248,15 @@ class CollectorEngine : public Service
 							int  &insert,
 							const condor_sockaddr& /*from*/ );
 
+	ClassAd * mergeClassAdDelta (CollectorHashTable &hashTable,
+							const char *adType,
+							const char *label,
+							ClassAd *delta,
+							AdNameHashKey &hk,
+							const MyString &hashString,
+							int  &insert,
+							const condor_sockaddr& from );
+
 	// support for dynamically created tables
 	CollectorHashTable *findOrCreateTable(MyString &str);
 
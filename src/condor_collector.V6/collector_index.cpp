@@ -0,0 +1,210 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "compat_classad_util.h"
+#include "stl_string_utils.h"
+#include "collector_index.h"
+
+// keys recorded in m_ad_keys.  a bucketed ad is filed under 'v' followed
+// by the lower-cased value; an empty key means the ad lacks the attribute.
+static const char UNBUCKETED_KEY[] = "u";
+
+static void
+makeIndexKey( ClassAd *ad, const std::string & attr, std::string & key )
+{
+	key.clear();
+	classad::ExprTree *expr = ad->Lookup( attr );
+	if ( ! expr) {
+		return;
+	}
+	std::string value;
+	if ( ExprTreeIsLiteralString( expr, value ) ) {
+		lower_case( value );
+		key = "v";
+		key += value;
+	} else {
+		key = UNBUCKETED_KEY;
+	}
+}
+
+void
+CollectorAttrIndex::setAttributes( const std::vector<std::string> & attrs )
+{
+	m_ad_keys.clear();
+	m_attrs.clear();
+	m_attr_names.clear();
+	for ( const std::string & name : attrs ) {
+		bool dup = false;
+		for ( const std::string & have : m_attr_names ) {
+			if ( strcasecmp( have.c_str(), name.c_str() ) == 0 ) { dup = true; break; }
+		}
+		if (dup || name.empty()) continue;
+		m_attr_names.push_back( name );
+		m_attrs.emplace_back();
+		m_attrs.back().attr = name;
+	}
+}
+
+void
+CollectorAttrIndex::clear()
+{
+	m_ad_keys.clear();
+	for ( AttrIndex & ix : m_attrs ) {
+		ix.buckets.clear();
+		ix.unbucketed.clear();
+	}
+}
+
+void
+CollectorAttrIndex::insert( ClassAd *ad )
+{
+	if ( m_attrs.empty() || ! ad ) {
+		return;
+	}
+	if ( m_ad_keys.count( ad ) ) {
+		remove( ad );
+	}
+
+	std::vector<std::string> & keys = m_ad_keys[ad];
+	keys.resize( m_attrs.size() );
+	for ( size_t ii = 0; ii < m_attrs.size(); ++ii ) {
+		AttrIndex & ix = m_attrs[ii];
+		makeIndexKey( ad, ix.attr, keys[ii] );
+		if ( keys[ii].empty() ) {
+			continue;
+		} else if ( keys[ii] == UNBUCKETED_KEY ) {
+			ix.unbucketed.insert( ad );
+		} else {
+			ix.buckets[keys[ii]].insert( ad );
+		}
+	}
+}
+
+void
+CollectorAttrIndex::remove( ClassAd *ad )
+{
+	auto it = m_ad_keys.find( ad );
+	if ( it == m_ad_keys.end() ) {
+		return;
+	}
+
+	const std::vector<std::string> & keys = it->second;
+	for ( size_t ii = 0; ii < m_attrs.size() && ii < keys.size(); ++ii ) {
+		AttrIndex & ix = m_attrs[ii];
+		if ( keys[ii].empty() ) {
+			continue;
+		} else if ( keys[ii] == UNBUCKETED_KEY ) {
+			ix.unbucketed.erase( ad );
+		} else {
+			auto bucket = ix.buckets.find( keys[ii] );
+			if ( bucket != ix.buckets.end() ) {
+				bucket->second.erase( ad );
+				if ( bucket->second.empty() ) {
+					ix.buckets.erase( bucket );
+				}
+			}
+		}
+	}
+	m_ad_keys.erase( it );
+}
+
+// collect the  Attr == "string"  terms that are joined by && at the top
+// level of the constraint.
+static void
+findEqualityConjuncts( classad::ExprTree *tree,
+                       std::vector<std::pair<std::string, std::string> > & terms )
+{
+	tree = SkipExprParens( tree );
+	if ( ! tree) {
+		return;
+	}
+
+	if ( tree->GetKind() == classad::ExprTree::OP_NODE ) {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((classad::Operation*)tree)->GetComponents( op, t1, t2, t3 );
+		if ( op == classad::Operation::LOGICAL_AND_OP ) {
+			findEqualityConjuncts( t1, terms );
+			findEqualityConjuncts( t2, terms );
+			return;
+		}
+	}
+
+	classad::Operation::OpKind cmp_op;
+	std::string attr;
+	classad::Value value;
+	std::string str;
+	if ( ExprTreeIsAttrCmpLiteral( tree, cmp_op, attr, value ) &&
+	     ( cmp_op == classad::Operation::EQUAL_OP || cmp_op == classad::Operation::META_EQUAL_OP ) &&
+	     value.IsStringValue( str ) )
+	{
+		lower_case( str );
+		terms.emplace_back( attr, "v" + str );
+	}
+}
+
+bool
+CollectorAttrIndex::plan( classad::ExprTree *constraint, std::vector<ClassAd*> & candidates,
+                          std::string * index_used ) const
+{
+	if ( m_attrs.empty() || ! constraint ) {
+		return false;
+	}
+
+	std::vector<std::pair<std::string, std::string> > terms;
+	findEqualityConjuncts( constraint, terms );
+
+	// pick the term that leaves us with the fewest ads to evaluate
+	const AttrIndex * best_ix = NULL;
+	const AdSet * best_bucket = NULL;
+	size_t best_size = 0;
+	for ( const auto & term : terms ) {
+		for ( const AttrIndex & ix : m_attrs ) {
+			if ( strcasecmp( ix.attr.c_str(), term.first.c_str() ) != 0 ) {
+				continue;
+			}
+			auto bucket = ix.buckets.find( term.second );
+			const AdSet * ads = (bucket == ix.buckets.end()) ? NULL : &bucket->second;
+			size_t size = ix.unbucketed.size() + (ads ? ads->size() : 0);
+			if ( ! best_ix || size < best_size ) {
+				best_ix = &ix;
+				best_bucket = ads;
+				best_size = size;
+				if ( index_used ) {
+					formatstr( *index_used, "%s == \"%s\"", ix.attr.c_str(), term.second.c_str() + 1 );
+				}
+			}
+			break;
+		}
+	}
+
+	if ( ! best_ix ) {
+		return false;
+	}
+
+	candidates.clear();
+	candidates.reserve( best_size );
+	if ( best_bucket ) {
+		candidates.insert( candidates.end(), best_bucket->begin(), best_bucket->end() );
+	}
+	candidates.insert( candidates.end(), best_ix->unbucketed.begin(), best_ix->unbucketed.end() );
+	return true;
+}
@@ -0,0 +1,79 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _CONDOR_COLLECTOR_INDEX_H
+#define _CONDOR_COLLECTOR_INDEX_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "condor_classad.h"
+
+// Secondary index over one collector table.  For each configured
+// attribute, ads whose value for that attribute is a literal string are
+// bucketed by the lower-cased string.  Ads where the attribute is some
+// other expression can't be bucketed, so they are kept in a per-attribute
+// set that is always included in query candidates; ads that don't have
+// the attribute at all are left out, since an equality test against a
+// missing attribute can never be true.
+//
+// The index only narrows the set of ads a query has to look at; the
+// caller still evaluates the full query constraint on every candidate.
+class CollectorAttrIndex {
+public:
+	CollectorAttrIndex() {}
+
+	// Replace the set of indexed attributes. Forgets every ad; the
+	// caller is expected to re-insert the contents of the table.
+	void setAttributes(const std::vector<std::string> & attrs);
+	const std::vector<std::string> & attributes() const { return m_attr_names; }
+	bool enabled() const { return ! m_attrs.empty(); }
+
+	void insert(ClassAd *ad);
+	void remove(ClassAd *ad);
+	void update(ClassAd *ad) { remove(ad); insert(ad); }
+	void clear();
+
+	// Look for top-level conjuncts of the constraint of the form
+	// Attr == "string" (or =?=) on an indexed attribute.  If there are
+	// any, set candidates to the ads from the smallest matching bucket
+	// and return true.  Returns false if the index can't help, in which
+	// case the whole table must be scanned.
+	bool plan(classad::ExprTree *constraint, std::vector<ClassAd*> & candidates,
+	          std::string * index_used = NULL) const;
+
+private:
+	typedef std::unordered_set<ClassAd*> AdSet;
+	struct AttrIndex {
+		std::string attr;
+		std::unordered_map<std::string, AdSet> buckets;
+		AdSet unbucketed;
+	};
+
+	std::vector<std::string> m_attr_names;
+	std::vector<AttrIndex> m_attrs;
+
+	// the key each ad was filed under, one per indexed attribute, so that
+	// removal works even if the ad was modified in place since insert().
+	std::unordered_map<ClassAd*, std::vector<std::string> > m_ad_keys;
+};
+
+#endif
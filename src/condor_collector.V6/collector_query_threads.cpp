@@ -0,0 +1,173 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_daemon_core.h"
+#include "collector_query_threads.h"
+
+CollectorQueryThreads::CollectorQueryThreads()
+	: m_stopping(false)
+	, m_num_threads(0)
+	, m_notify_fd(-1)
+	, m_work(NULL)
+	, m_done_func(NULL)
+{
+	m_pipe_ends[0] = m_pipe_ends[1] = -1;
+}
+
+CollectorQueryThreads::~CollectorQueryThreads()
+{
+	stop();
+}
+
+bool
+CollectorQueryThreads::start(int num_threads, WorkFunc work, DoneFunc done)
+{
+	if (running() || num_threads <= 0) {
+		return false;
+	}
+
+#ifdef WIN32
+		// The workers wake the main thread by writing directly to the
+		// pipe's fd, which DaemonCore does not expose on Windows.
+	dprintf(D_ALWAYS, "Collector query threads are not supported on this platform\n");
+	return false;
+#else
+	if ( ! daemonCore->Create_Pipe(m_pipe_ends, true, false, true, true)) {
+		dprintf(D_ALWAYS, "Failed to create pipe for collector query threads\n");
+		return false;
+	}
+	if ( ! daemonCore->Get_Pipe_FD(m_pipe_ends[1], &m_notify_fd)) {
+		dprintf(D_ALWAYS, "Failed to get fd of collector query thread pipe\n");
+		daemonCore->Close_Pipe(m_pipe_ends[0]);
+		daemonCore->Close_Pipe(m_pipe_ends[1]);
+		m_pipe_ends[0] = m_pipe_ends[1] = -1;
+		return false;
+	}
+	daemonCore->Register_Pipe(m_pipe_ends[0], "Collector query threads",
+		(PipeHandlercpp)&CollectorQueryThreads::handleDonePipe,
+		"CollectorQueryThreads::handleDonePipe", this);
+
+	m_work = work;
+	m_done_func = done;
+	m_stopping = false;
+	for (int ii = 0; ii < num_threads; ++ii) {
+		m_threads.emplace_back(threadMain, this);
+		m_num_threads++;
+	}
+
+	dprintf(D_ALWAYS, "Started %d collector query threads\n", m_num_threads);
+	return true;
+#endif
+}
+
+void
+CollectorQueryThreads::submit(void *job)
+{
+	ASSERT(running());
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_pending.push_back(job);
+	}
+	m_wakeup.notify_one();
+}
+
+void
+CollectorQueryThreads::stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_stopping = true;
+	}
+	m_wakeup.notify_all();
+
+		// The workers use the snapshot and sockets that their jobs
+		// carry, so they must be gone before the collector is.
+	for (std::thread &thr : m_threads) {
+		if (thr.joinable()) {
+			thr.join();
+		}
+	}
+	if ( ! m_threads.empty()) {
+		dprintf(D_ALWAYS, "Stopped %d collector query threads\n", m_num_threads);
+	}
+	m_threads.clear();
+	m_num_threads = 0;
+
+	if (m_pipe_ends[0] != -1) {
+		daemonCore->Close_Pipe(m_pipe_ends[0]);
+		daemonCore->Close_Pipe(m_pipe_ends[1]);
+		m_pipe_ends[0] = m_pipe_ends[1] = -1;
+		m_notify_fd = -1;
+	}
+}
+
+void
+CollectorQueryThreads::threadMain(CollectorQueryThreads *pool)
+{
+	for (;;) {
+		void *job = NULL;
+		{
+			std::unique_lock<std::mutex> guard(pool->m_lock);
+			pool->m_wakeup.wait(guard, [pool] { return pool->m_stopping || ! pool->m_pending.empty(); });
+			if (pool->m_stopping) {
+				return;
+			}
+			job = pool->m_pending.front();
+			pool->m_pending.pop_front();
+		}
+
+		pool->m_work(job);
+
+		bool need_notify = false;
+		{
+			std::lock_guard<std::mutex> guard(pool->m_lock);
+			need_notify = pool->m_done.empty();
+			pool->m_done.push_back(job);
+		}
+			// One byte per batch of finished jobs is enough, since the
+			// handler drains the whole done queue.  If the pipe is full
+			// the main thread already has a wakeup pending.
+		if (need_notify) {
+			char c = 0;
+			if (write(pool->m_notify_fd, &c, 1) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+				dprintf(D_ALWAYS, "Failed to wake main thread from query thread, errno=%d\n", errno);
+			}
+		}
+	}
+}
+
+int
+CollectorQueryThreads::handleDonePipe(int pipe_end)
+{
+	char buf[64];
+	while (daemonCore->Read_Pipe(pipe_end, buf, sizeof(buf)) > 0) {
+	}
+
+	std::deque<void *> done;
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		done.swap(m_done);
+	}
+	for (void *job : done) {
+		m_done_func(job);
+	}
+	return TRUE;
+}
@@ -0,0 +1,77 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _CONDOR_COLLECTOR_QUERY_THREADS_H
+#define _CONDOR_COLLECTOR_QUERY_THREADS_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "condor_daemon_core.h"
+
+// A fixed pool of threads for answering collector queries in-process
+// instead of in a forked child.  Jobs are opaque pointers; the work
+// function runs in a pool thread and must not touch DaemonCore or any
+// collector state other than what the job carries.  When it returns, the
+// job is handed back to the main thread through a DaemonCore pipe, where
+// the done function is called.
+class CollectorQueryThreads : public Service {
+public:
+	typedef void (*WorkFunc)(void *job);
+	typedef void (*DoneFunc)(void *job);
+
+	CollectorQueryThreads();
+	~CollectorQueryThreads();
+
+	// Start num_threads workers.  Returns false if threads are not
+	// supported on this platform, or the pipe could not be created.
+	bool start(int num_threads, WorkFunc work, DoneFunc done);
+	bool running() const { return m_num_threads > 0; }
+	int size() const { return m_num_threads; }
+
+	void submit(void *job);
+
+	// Tell the workers to exit and wait for them.  Jobs that are
+	// already running are finished first; jobs still in the queue are
+	// never run, and their done function is not called.  After this
+	// the pool may be deleted.
+	void stop();
+
+private:
+	static void threadMain(CollectorQueryThreads *pool);
+	int handleDonePipe(int pipe_end);
+
+	std::mutex m_lock;
+	std::condition_variable m_wakeup;
+	std::deque<void *> m_pending;
+	std::deque<void *> m_done;
+	std::vector<std::thread> m_threads;
+	bool m_stopping;
+	int m_num_threads;
+	int m_pipe_ends[2];
+	int m_notify_fd;
+
+	WorkFunc m_work;
+	DoneFunc m_done_func;
+};
+
+#endif
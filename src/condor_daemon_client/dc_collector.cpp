@@ -31,6 +31,7 @@
 #include <algorithm>
 
 std::map< std::string, Timeslice > DCCollector::blacklist;
+unsigned long DCCollector::update_connections = 0;
 
 
 // Instantiate things
@@ -709,6 +710,7 @@ DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblo
 		delete update_rsock;
 		update_rsock = NULL;
 	}
+	update_connections++;
 	if(nonblocking) {
 		UpdateData *ud = new UpdateData(cmd, Sock::reli_sock, ad1, ad2, this, callback_fn, miscdata);
 			// Note that UpdateData automatically adds itself to the pending_update_list.
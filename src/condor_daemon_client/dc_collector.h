@@ -108,6 +108,13 @@ public:
 	time_t getStartTime() const { return startTime; }
 	time_t getReconfigTime() const { return reconfigTime; }
 
+		/** The number of TCP connections this process has started for
+			sending updates to any collector.  When it changes, a
+			collector may have lost the ads we sent it earlier (for
+			instance, because it restarted).
+		*/
+	static unsigned long updateConnections() { return update_connections; }
+
 		/** Request that the collector get an identity token from the specified
 		 *  schedd.
 		 */
@@ -144,6 +151,7 @@ private:
 
 	struct timeval m_blacklist_monitor_query_started;
 	static std::map< std::string, Timeslice > blacklist;
+	static unsigned long update_connections;
 
 	Timeslice &getBlacklistTimeslice();
 
@@ -2196,3 +2196,44 @@ DCSchedd::requestImpersonationTokenAsync(const std::string &identity,
 	}
 	return true;
 }
+
+
+MultiplexedShadowJobExitMsg::MultiplexedShadowJobExitMsg( int cluster, int proc, int exit_reason ):
+	DCMsg(MULTIPLEXED_SHADOW_JOB_EXIT),
+	m_cluster(cluster),
+	m_proc(proc),
+	m_exit_reason(exit_reason),
+	m_known_job(true)
+{
+}
+
+bool
+MultiplexedShadowJobExitMsg::writeMsg( DCMessenger * /*messenger*/, Sock *sock )
+{
+	int mypid = getpid();
+	return
+		sock->put(mypid) &&
+		sock->put(m_cluster) &&
+		sock->put(m_proc) &&
+		sock->put(m_exit_reason);
+}
+
+DCMsg::MessageClosureEnum
+MultiplexedShadowJobExitMsg::messageSent( DCMessenger *messenger, Sock *sock )
+{
+		// now wait for reply
+	messenger->startReceiveMsg(this,sock);
+	return MESSAGE_CONTINUING;
+}
+
+bool
+MultiplexedShadowJobExitMsg::readMsg( DCMessenger * /*messenger*/, Sock *sock )
+{
+	int known = 0;
+	if( !sock->get(known) ) {
+		sockFailed(sock);
+		return false;
+	}
+	m_known_job = known != 0;
+	return true;
+}
@@ -26,6 +26,7 @@
 #include "condor_io.h"
 #include "enum_utils.h"
 #include "daemon.h"
+#include "dc_message.h"
 #include "MyString.h"
 
 
@@ -503,5 +504,28 @@ private:
 
 };
 
+	// Used by a multiplexed shadow to report the exit reason of one
+	// of the jobs it hosts, without blocking its event loop.  Send it
+	// with DCSchedd::sendMsg(); once delivered, knownJob() says whether
+	// the schedd still knew about the job.
+class MultiplexedShadowJobExitMsg: public DCMsg {
+public:
+	MultiplexedShadowJobExitMsg( int cluster, int proc, int exit_reason );
+
+	bool writeMsg( DCMessenger *messenger, Sock *sock );
+	bool readMsg( DCMessenger *messenger, Sock *sock );
+	MessageClosureEnum messageSent( DCMessenger *messenger, Sock *sock );
+
+	int cluster() const { return m_cluster; }
+	int proc() const { return m_proc; }
+	int exitReason() const { return m_exit_reason; }
+	bool knownJob() const { return m_known_job; }
+
+private:
+	int m_cluster;
+	int m_proc;
+	int m_exit_reason;
+	bool m_known_job;
+};
 
 #endif /* _CONDOR_DC_SCHEDD_H */
@@ -62,6 +62,7 @@
 #include "daemon_keep_alive.h"
 
 #include <vector>
+#include <set>
 #include <memory>
 #include <deque>
 
@@ -76,6 +77,7 @@ class ProcFamilyInterface;
 
 template <class Key, class Value> class HashTable; // forward declaration
 class Probe;
+class Selector;
 
 #define USE_MIRON_PROBE_FOR_DC_RUNTIME_STATS
 
@@ -1127,6 +1129,26 @@ class DaemonCore : public Service
     time_t GetNextRuntime(int id) {return t.GetNextRuntime(id);}
 	//@}
 
+    /** A function that is called with the Service object of a C++
+        timer, socket, pipe, reaper or command handler just before the
+        handler is called.  A process that serves several independent
+        objects from one event loop (e.g. a multiplexed shadow) uses it
+        to point its process-wide state at the object being serviced.
+    */
+    typedef void (*ServiceContextHook)( Service * );
+
+    /** Set (or with NULL, clear) the ServiceContextHook.
+        @param hook The function to call before C++ handlers
+    */
+    void Set_Service_Context_Hook( ServiceContextHook hook ) { m_service_context_hook = hook; }
+
+    /** Call the ServiceContextHook, if any, for a handler's Service.
+        @param s The Service object of the handler about to be called
+    */
+    void Call_Service_Context_Hook( Service *s ) {
+        if ( m_service_context_hook && s ) { (*m_service_context_hook)( s ); }
+    }
+
     /** Not_Yet_Documented
         @param flag   Not_Yet_Documented
         @param indent Not_Yet_Documented
@@ -1599,6 +1621,7 @@ class DaemonCore : public Service
 	   stats_entry_recent<double> TimerRuntime;   //  total time spent handling timers
 	   stats_entry_recent<double> SocketRuntime;  //  total time spent handling socket messages
 	   stats_entry_recent<double> PipeRuntime;    //  total time spent handling pipe messages
+	   stats_entry_recent<double> PollSetupRuntime; // total time spent building the select/epoll interest set
 
 	   stats_entry_recent<int> Signals;        //  number of signals handlers called
 	   stats_entry_abs<int> TimersFired;    //  number of timer handlers called
@@ -1607,6 +1630,7 @@ class DaemonCore : public Service
 	   //stats_entry_recent<int64_t> SockBytes;      //  number of bytes passed though the socket (can we do this?)
 	   //stats_entry_recent<int64_t> PipeBytes;      //  number of bytes passed though the socket
 	   stats_entry_recent<int> DebugOuts;      //  number of dprintf calls that were written to output.
+	   stats_entry_recent<int> ParamLookups;   //  number of config table lookups by param() and its relatives
       #ifdef WIN32
 	   stats_entry_recent<int> AsyncPipe;      //  number of times async_pipe was signalled
       #endif
@@ -1715,6 +1739,7 @@ class DaemonCore : public Service
 	int m_super_dc_port;		// super user listen port
     int m_iMaxAcceptsPerCycle; ///< maximum number of inbound connections to accept per loop
 	int m_iMaxReapsPerCycle; // maximum number reapers to invoke per event loop
+	ServiceContextHook m_service_context_hook; // see Set_Service_Context_Hook()
 	int m_MaxTimeSkip;
 	int m_iMaxUdpMsgsPerCycle;	// max number of udp messages read per loop
 
@@ -1893,6 +1918,33 @@ class DaemonCore : public Service
 	int               nPendingSockets; // number of sockets waiting on timers or any other callbacks
     ExtArray<SockEnt> *sockTable; // socket table; grows dynamically if needed
 
+		// Persistent (epoll) selector used by Driver(), or NULL if
+		// Driver() rebuilds a select() fd_set every iteration.
+		// Registrations are pushed to it as sockets and pipes are
+		// registered and cancelled and as socket entries change state,
+		// so Driver() only looks at the entries that are ready or have
+		// reached their deadline.
+	Selector *m_driver_selector;
+	void SelectorForgetFd( int fd );
+		// Selector::IO_MASK bits that Driver() waits on for sockTable[i],
+		// or 0 if the entry should not be waited on right now.
+	int SockSelectInterest( int i );
+	static int HandlerTypeSelectInterest( HandlerType handler_type );
+		// Bring m_driver_selector's registration for sockTable[i] up to
+		// date.  force re-adds the fd even if its interest is unchanged,
+		// for when it may have been closed and the number reused.
+	void SyncSockSelector( int i, bool force = false );
+	void SyncAllSockSelector( bool force );
+		// Decide whether sockTable[i]'s handler should be called, after
+		// sel.execute().
+	void CheckSockReady( Selector &sel, int i, time_t now, bool superuser_command_arrived );
+	std::vector<int> m_selector_sock_fd;		// by sockTable index; -1 if none
+	std::vector<time_t> m_selector_sock_deadline;	// by sockTable index; 0 if none
+	std::vector<int> m_selector_fd_sock;		// by fd; sockTable index or -1
+	std::set<std::pair<time_t,int> > m_selector_deadlines;	// (deadline, index)
+	time_t m_selector_synced;	// last time every entry was synced
+	std::vector<int> m_ready_socks;	// entries Driver() checks this iteration
+
 		// number of file descriptors in use past which we should start
 		// avoiding the creation of new persistent sockets.  Do not use
 		// this value directly.  Call FileDescriptorSafetyLimit().
@@ -33,6 +33,8 @@
 #include "condor_constants.h"
 #include "dc_service.h"
 #include "condor_timeslice.h"
+#include <vector>
+#include <unordered_map>
 
 #ifdef WIN32
 #include <time.h>
@@ -84,7 +86,8 @@ struct tagTimer {
     /** Not_Yet_Documented */ TimerHandler             handler;
     /** Not_Yet_Documented */ TimerHandlercpp          handlercpp;
     /** Not_Yet_Documented */ class Service*    service; 
-    /** Not_Yet_Documented */ struct tagTimer*  next;
+    /** Slot in the TimerManager heap, or -1 if not queued */ int heap_index;
+    /** Insertion order, breaks ties between equal when */ uint64_t seq;
     /** Not_Yet_Documented */ char*             event_descrip;
     /** Not_Yet_Documented */ void*             data_ptr;
     /** Not_Yet_Documented */ Timeslice *       timeslice;
@@ -250,19 +253,37 @@ class TimerManager
                   unsigned   period          =  0,
 				  const Timeslice *timeslice = NULL);
 
-	void RemoveTimer( Timer *timer, Timer *prev );
+	void RemoveTimer( Timer *timer );
 	void InsertTimer( Timer *new_timer );
 	void DeleteTimer( Timer *timer );
-
 	/*
 	  @param id The id of the timer to find
-	  @param prev If not NULL, this will be set to previous timer in list
 	  @return pointer to timer with specified id or NULL if not found
 	 */
-	Timer *GetTimer( int id, Timer **prev );
+	Timer *GetTimer( int id );
+
+	/* Timers are kept in a binary min-heap ordered on (when, seq), so
+	   insert, reset and cancel are O(log n) no matter how many timers
+	   are registered.  Ordering equal "when" values by insertion sequence
+	   keeps the round-robin behavior of timers that constantly reset
+	   themselves to zero.  timer_index maps ids to every queued timer.
+	*/
+	static bool TimerBefore( const Timer *a, const Timer *b );
+	void HeapSiftUp( size_t idx );
+	void HeapSiftDown( size_t idx );
+	std::vector<Timer*> timer_heap;
+	std::unordered_map<int, Timer*> timer_index;
+	uint64_t timer_seq;
+
+	/* While Timeout() runs with no per-cycle limit, timers that are added
+	   or reset to a time that is already due are parked here instead of in
+	   the heap, so that we only invoke handlers that were due when
+	   Timeout() was entered.  They are moved into the heap on the way out.
+	*/
+	std::vector<Timer*> deferred_timers;
+	bool defer_due_timers;
+	time_t defer_due_cutoff;
 
-    Timer*  timer_list;
-	Timer*  list_tail;
     int     timer_ids;
     Timer*  in_timeout;
     bool    did_reset;
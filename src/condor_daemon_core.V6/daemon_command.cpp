@@ -652,6 +652,9 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::ReadCommand(
 			CondorVersionInfo ver_info( peer_version.c_str() );
 			m_sock->set_peer_version( &ver_info );
 		}
+		bool peer_binary_classads = false;
+		m_auth_info.LookupBool( ATTR_SEC_BINARY_CLASSADS, peer_binary_classads );
+		m_sock->set_peer_binary_classads( peer_binary_classads );
 
 		// look at the ad.  get the command number.
 		m_real_cmd = 0;
@@ -848,6 +851,8 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::ReadCommand(
 					}
 
 					m_policy->LookupString( ATTR_SEC_REMOTE_VERSION, peer_version );
+					peer_binary_classads = false;
+					m_policy->LookupBool( ATTR_SEC_BINARY_CLASSADS, peer_binary_classads );
 
 					bool tried_authentication=false;
 					m_policy->LookupBool(ATTR_SEC_TRIED_AUTHENTICATION,tried_authentication);
@@ -865,6 +870,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::ReadCommand(
 				} else {
 					m_sock->set_peer_version( NULL );
 				}
+				m_sock->set_peer_binary_classads( peer_binary_classads );
 
 				m_new_session = false;
 
@@ -910,6 +916,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::ReadCommand(
 
 				// add our version to the policy to be sent over
 				m_policy->Assign(ATTR_SEC_REMOTE_VERSION, CondorVersion());
+				m_policy->Assign(ATTR_SEC_BINARY_CLASSADS, true);
 
 				// handy policy vars
 				SecMan::sec_feat_act will_authenticate      = m_sec_man->sec_lookup_feat_act(*m_policy, ATTR_SEC_AUTHENTICATION);
@@ -1638,6 +1645,8 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::SendResponse
 		// it matters if the version is empty, so we must explicitly delete it
 		m_policy->Delete( ATTR_SEC_REMOTE_VERSION );
 		m_sec_man->sec_copy_attribute( *m_policy, m_auth_info, ATTR_SEC_REMOTE_VERSION );
+		m_policy->Delete( ATTR_SEC_BINARY_CLASSADS );
+		m_sec_man->sec_copy_attribute( *m_policy, m_auth_info, ATTR_SEC_BINARY_CLASSADS );
 		m_sec_man->sec_copy_attribute( *m_policy, pa_ad, ATTR_SEC_USER );
 		m_sec_man->sec_copy_attribute( *m_policy, pa_ad, ATTR_SEC_SID );
 		m_sec_man->sec_copy_attribute( *m_policy, pa_ad, ATTR_SEC_VALID_COMMANDS );
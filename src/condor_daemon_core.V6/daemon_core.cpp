@@ -102,6 +102,8 @@ CRITICAL_SECTION Big_fat_mutex; // coarse grained mutex for debugging purposes
 #include "condor_sockfunc.h"
 #include "condor_auth_passwd.h"
 
+#include <algorithm>
+
 #if defined ( HAVE_SCHED_SETAFFINITY ) && !defined ( WIN32 )
 #include <sched.h>
 #endif
@@ -413,6 +415,7 @@ DaemonCore::DaemonCore(int ComSize,int SigSize,
 	super_dc_ssock = NULL;
 	m_super_dc_port = -1;
 	m_iMaxReapsPerCycle = 1;
+	m_service_context_hook = NULL;
     m_iMaxAcceptsPerCycle = 1;
 
 	m_MaxTimeSkip = 60 * 20;  // 20 minutes
@@ -472,6 +475,8 @@ DaemonCore::DaemonCore(int ComSize,int SigSize,
 #endif
 
 	m_fake_create_thread = false;
+	m_driver_selector = NULL;
+	m_selector_synced = 0;
 
 	m_refresh_dns_timer = -1;
 
@@ -543,6 +548,9 @@ DaemonCore::~DaemonCore()
 		delete sockTable;
 	}
 
+	delete m_driver_selector;
+	m_driver_selector = NULL;
+
 	delete sec_man;
 
 	// Since we created these, we need to clean them up.
@@ -1705,6 +1713,7 @@ int DaemonCore::Register_Socket(Stream *iosock, const char* iosock_descrip,
 		}
 		if ( (*sockTable)[i].remove_asap && (*sockTable)[i].servicing_tid==0 ) {
 			(*sockTable)[i].iosock = NULL;
+			SyncSockSelector( i );
 			break;
 		}
 	}
@@ -1838,6 +1847,11 @@ int DaemonCore::Register_Socket(Stream *iosock, const char* iosock_descrip,
 	else
 		(*sockTable)[i].handler_descrip = strdup(EMPTY_DESCRIP);
 
+	// Push the new registration to a persistent selector right away;
+	// the fd may be a reused number the kernel no longer knows about,
+	// so force it to be (re)added.
+	SyncSockSelector( i, true );
+
 	// Increment the counter of total number of entries if we
 	// just filled our last slot.
 	if ( i == nSock  ) {
@@ -1923,11 +1937,15 @@ int DaemonCore::Cancel_Socket( Stream* insock, void *prev_entry)
 				nSock--;
 			}
 		}
+		// Stop waiting on the fd before the caller gets a chance to
+		// close it, or wait on the restored entry's fd again.
+		SyncSockSelector( i, prev_entry != NULL );
 	} else {
 		// Log a message
 		dprintf(D_DAEMONCORE,"Cancel_Socket: deferred cancel socket %d <%s> %p\n",
 				i,(*sockTable)[i].iosock_descrip, (*sockTable)[i].iosock );
 		(*sockTable)[i].remove_asap = true;
+		SyncSockSelector( i );
 	}
 
 	if ( !prev_entry ) {
@@ -2227,6 +2245,13 @@ int DaemonCore::Register_Pipe(int pipe_end, const char* pipe_descrip,
 	else
 		(*pipeTable)[i].handler_descrip = strdup(EMPTY_DESCRIP);
 
+#ifndef WIN32
+	if ( m_driver_selector ) {
+		m_driver_selector->set_fd_interest( (*pipeHandleTable)[index],
+				HandlerTypeSelectInterest( handler_type ), true );
+	}
+#endif
+
 	// Increment the counter of total number of entries
 	nPipe++;
 
@@ -2304,6 +2329,10 @@ int DaemonCore::Cancel_Pipe( int pipe_end )
 			"Cancel_Pipe: cancelled pipe end %d <%s> (entry=%d)\n",
 			pipe_end,(*pipeTable)[i].pipe_descrip, i );
 
+#ifndef WIN32
+	SelectorForgetFd( (*pipeHandleTable)[index] );
+#endif
+
 	// Remove entry, move the last one in the list into this spot
 	(*pipeTable)[i].index = -1;
 	free( (*pipeTable)[i].pipe_descrip );
@@ -3429,6 +3458,31 @@ void DaemonCore::Driver()
 		dprintf( D_ALWAYS, "Done with stdout & stderr tests\n" );
 	}
 
+#if !defined(WIN32)
+	if ( ! m_driver_selector && param_boolean( "DAEMON_CORE_USE_EPOLL", true ) ) {
+		m_driver_selector = new Selector;
+		if ( m_driver_selector->enable_persistent() ) {
+			dprintf( D_FULLDEBUG, "DaemonCore: using epoll to wait for socket and pipe activity\n" );
+				// Catch up with what was registered before now.
+			SyncAllSockSelector( true );
+			for ( i = 0; i < nPipe; i++ ) {
+				if ( (*pipeTable)[i].index != -1 ) {
+					m_driver_selector->set_fd_interest(
+							(*pipeHandleTable)[(*pipeTable)[i].index],
+							HandlerTypeSelectInterest( (*pipeTable)[i].handler_type ), true );
+				}
+			}
+		} else {
+			delete m_driver_selector;
+			m_driver_selector = NULL;
+		}
+	}
+#endif
+		// With a persistent selector, registrations survive from one
+		// iteration to the next and the loop below only pushes changes.
+		// Otherwise we rebuild a select() fd_set in our local selector.
+	Selector &main_selector = m_driver_selector ? *m_driver_selector : selector;
+
 	double runtime = _condor_debug_get_time_double();
 	double group_runtime = runtime;
     double pump_cycle_begin_time = runtime;
@@ -3527,52 +3581,39 @@ void DaemonCore::Driver()
         dc_stats.TimerRuntime += (runtime - group_runtime);
         group_runtime = runtime;
 
-		// Setup what socket descriptors to select on.  We recompute this
-		// every time because 1) some timeout handler may have removed/added
-		// sockets, and 2) it ain't that expensive....
-		selector.reset();
+		main_selector.reset();
 		min_deadline = 0;
-		for (i = 0; i < nSock; i++) {
-				// NOTE: keep the following logic for building the
-				// fdset in sync with DaemonCore::ServiceCommandSocket()
-
-				// if a valid entry not already being serviced, add to select
-			if ( (*sockTable)[i].iosock && 
-				 (*sockTable)[i].servicing_tid==0 &&
-				 (*sockTable)[i].remove_asap == false ) {	
-					// Setup our fdsets
-				if ( (*sockTable)[i].is_reverse_connect_pending ) {
-					// nothing to do; we are just allowing this socket
-					// to be registered so that it behaves like a socket
-					// that is doing a non-blocking connect
-					// CCBClient will eventually ensure that the
-					// socket's registered callback function is called
-					// We want to ignore the socket's deadline (below)
-					// because that is all taken care of by CCBClient.
+		if ( m_driver_selector ) {
+				// Registrations and state changes are pushed to the
+				// persistent selector as they happen.  Deadlines can
+				// also be changed by code that isn't a handler for the
+				// socket, which we'd never hear about, so look at every
+				// entry again once a second.
+			time_t now = time(NULL);
+			if ( now != m_selector_synced ) {
+				SyncAllSockSelector( false );
+				m_selector_synced = now;
+			}
+			if ( ! m_selector_deadlines.empty() ) {
+				min_deadline = m_selector_deadlines.begin()->first;
+			}
+		} else {
+			// Setup what socket descriptors to select on.  We recompute this
+			// every time because 1) some timeout handler may have removed/added
+			// sockets, and 2) it ain't that expensive....
+			for (i = 0; i < nSock; i++) {
+					// NOTE: keep the following logic for building the
+					// fdset in sync with DaemonCore::ServiceCommandSocket()
+				int interest = SockSelectInterest( i );
+				if ( interest == 0 ) {
+						// Not waited on right now: either the entry is
+						// being serviced by a thread or is about to be
+						// removed, or it is a reverse connect which
+						// CCBClient completes for us (so we also ignore
+						// its deadline below).
 					continue;
 				}
-				else if ( (*sockTable)[i].is_connect_pending ) {
-						// we want to be woken when a non-blocking
-						// connect is ready to write.  when connect
-						// is ready, select will set the writefd set
-						// on success, or the exceptfd set on failure.
-					selector.add_fd( (*sockTable)[i].iosock->get_file_desc(), Selector::IO_WRITE );
-					selector.add_fd( (*sockTable)[i].iosock->get_file_desc(), Selector::IO_EXCEPT );
-				} else {
-					int sockfd = (*sockTable)[i].iosock->get_file_desc();
-					switch( (*sockTable)[i].handler_type ) {
-					case HANDLE_READ:
-						selector.add_fd( sockfd, Selector::IO_READ );
-						break;
-					case HANDLE_WRITE:
-						selector.add_fd( sockfd, Selector::IO_WRITE );
-						break;
-					case HANDLE_READ_WRITE:
-						selector.add_fd( sockfd, Selector::IO_READ );
-						selector.add_fd( sockfd, Selector::IO_WRITE );
-						break;
-					}
-				}
+				main_selector.set_fd_interest( (*sockTable)[i].iosock->get_file_desc(), interest );
 
 					// If this socket times out sooner than
 					// our select timeout, adjust the select timeout.
@@ -3582,7 +3623,19 @@ void DaemonCore::Driver()
 						min_deadline = deadline;
 					}
 				}
-            }
+			}
+
+#if !defined(WIN32)
+			// Add the registered pipe fds into the list of descriptors to
+			// select on.
+			for (i = 0; i < nPipe; i++) {
+				if ( (*pipeTable)[i].index != -1 ) {	// if a valid entry....
+					int pipefd = (*pipeHandleTable)[(*pipeTable)[i].index];
+					main_selector.set_fd_interest( pipefd,
+							HandlerTypeSelectInterest( (*pipeTable)[i].handler_type ) );
+				}
+			}
+#endif
 		}
 
 		if( min_deadline ) {
@@ -3593,28 +3646,6 @@ void DaemonCore::Driver()
 			}
 		}
 
-#if !defined(WIN32)
-		// Add the registered pipe fds into the list of descriptors to
-		// select on.
-		for (i = 0; i < nPipe; i++) {
-			if ( (*pipeTable)[i].index != -1 ) {	// if a valid entry....
-				int pipefd = (*pipeHandleTable)[(*pipeTable)[i].index];
-				switch( (*pipeTable)[i].handler_type ) {
-				case HANDLE_READ:
-					selector.add_fd( pipefd, Selector::IO_READ );
-					break;
-				case HANDLE_WRITE:
-					selector.add_fd( pipefd, Selector::IO_WRITE );
-					break;
-				case HANDLE_READ_WRITE:
-					selector.add_fd( pipefd, Selector::IO_READ );
-					selector.add_fd( pipefd, Selector::IO_WRITE );
-					break;
-				}
-			}
-        }
-#endif
-
 
 		// Add the read side of async_pipe to the list of file descriptors to
 		// select on.  We write to async_pipe if a unix async signal
@@ -3623,11 +3654,16 @@ void DaemonCore::Driver()
 		if ( ! async_pipe[0].is_connected()) {
 			EXCEPT("DaemonCore:: async_pipe has been unexpectedly closed!");
 		} 
-		selector.add_fd( async_pipe[0].get_file_desc() , Selector::IO_READ );
+		main_selector.add_fd( async_pipe[0].get_file_desc() , Selector::IO_READ );
 #else
-		selector.add_fd( async_pipe[0], Selector::IO_READ );
+		main_selector.set_fd_interest( async_pipe[0], Selector::IO_READ_MASK );
 #endif
 
+		// accumulate time spent building the interest set as PollSetupRuntime
+		runtime = _condor_debug_get_time_double();
+		dc_stats.PollSetupRuntime += (runtime - group_runtime);
+		group_runtime = runtime;
+
 		// Let other threads run while we are waiting on select
 		CondorThreads::enable_parallel(true);
 
@@ -3646,7 +3682,7 @@ void DaemonCore::Driver()
 		LeaveCriticalSection(&Big_fat_mutex);
 #endif
 
-		selector.set_timeout( timeout );
+		main_selector.set_timeout( timeout );
 
 		errno = 0;
 		time_t time_before = time(NULL);
@@ -3659,7 +3695,7 @@ void DaemonCore::Driver()
 			dprintf(D_PERF_TRACE, "PERF: entering select. timeout=%d\n", (int)timeout);
 		}
 
-		selector.execute();
+		main_selector.execute();
 
 		// update statistics on time spent waiting in select.
 		runtime = _condor_debug_get_time_double();
@@ -3682,18 +3718,18 @@ void DaemonCore::Driver()
 		// set it to FALSE after we block the signals again.
 		async_sigs_unblocked = FALSE;
 
-		if ( selector.failed() ) {
+		if ( main_selector.failed() ) {
 			// not just interrupted by a signal...
 				dprintf(D_ALWAYS,"Socket Table:\n");
         		DumpSocketTable( D_ALWAYS );
 				dprintf(D_ALWAYS,"State of selector:\n");
-				selector.display();
+				main_selector.display();
 				EXCEPT("DaemonCore: select() returned an unexpected error: %d (%s)",tmpErrno,strerror(tmpErrno));
 		}
 #else
 		// Windoze
 		EnterCriticalSection(&Big_fat_mutex);
-		if ( selector.select_retval() == SOCKET_ERROR ) {
+		if ( main_selector.select_retval() == SOCKET_ERROR ) {
 			EXCEPT("select, error # = %d",WSAGetLastError());
 		}
 
@@ -3701,8 +3737,8 @@ void DaemonCore::Driver()
 		// extra error checking because we had problems with the pipe getting stuck
 		// in the signalled state in 7.5.5. 
 		unsigned int pipe_was_signalled = InterlockedExchange(&async_pipe_signal, 0);
-		if (selector.has_ready() &&
-			selector.fd_ready(async_pipe[0].get_file_desc(), Selector::IO_READ)) {
+		if (main_selector.has_ready() &&
+			main_selector.fd_ready(async_pipe[0].get_file_desc(), Selector::IO_READ)) {
 			dc_stats.AsyncPipe += 1;
 			if ( ! pipe_was_signalled) {
 				dprintf(D_ALWAYS, "DaemonCore: async_pipe is signalled, but async_pipe_signal is false.\n");
@@ -3731,7 +3767,7 @@ void DaemonCore::Driver()
 			// have questions ask matt.
 		if (IsDebugLevel(D_PERF_TRACE)) {
 			dprintf(D_PERF_TRACE, "PERF: leaving select\n");
-			selector.display();
+			main_selector.display();
 		}
 
 		// For now, do not let other threads run while we are processing
@@ -3740,8 +3776,8 @@ void DaemonCore::Driver()
 
 		runtime = group_runtime = _condor_debug_get_time_double();
 
-		if ( selector.has_ready() ||
-			 ( selector.timed_out() && 
+		if ( main_selector.has_ready() ||
+			 ( main_selector.timed_out() && 
 			   min_deadline && min_deadline < time(NULL) ) )
 		{
 			// Either socket activity has happened or a socket
@@ -3759,12 +3795,12 @@ void DaemonCore::Driver()
 			// from this one socket for this daemoncore cycle.
 			bool superuser_command_arrived = false;
 			if (super_dc_rsock &&
-				selector.fd_ready(super_dc_rsock->get_file_desc(), Selector::IO_READ))
+				main_selector.fd_ready(super_dc_rsock->get_file_desc(), Selector::IO_READ))
 			{
 				superuser_command_arrived = true;
 			}
 			if (super_dc_ssock &&
-				selector.fd_ready(super_dc_ssock->get_file_desc(), Selector::IO_READ))
+				main_selector.fd_ready(super_dc_ssock->get_file_desc(), Selector::IO_READ))
 			{
 				superuser_command_arrived = true;
 			}
@@ -3772,64 +3808,36 @@ void DaemonCore::Driver()
 				dprintf(D_ALWAYS,"Received a superuser command\n");
 			}
 
-			// scan through the socket table to find which ones select() set
-			for(i = 0; i < nSock; i++) {
-				if ( (*sockTable)[i].iosock && 
-					 (*sockTable)[i].servicing_tid==0 &&
-					 (*sockTable)[i].remove_asap == false ) 
-				{	// if a valid entry...
-					// figure out if we should call a handler.  to do this,
-					// if the socket was doing a connect(), we check the
-					// writefds and excepfds.  otherwise, check readfds.
-					(*sockTable)[i].call_handler = false;
-					time_t deadline = (*sockTable)[i].iosock->get_deadline();
-					bool sock_timed_out = ( deadline && deadline < now );
-
-					if ( superuser_command_arrived &&
-						 ((*sockTable)[i].iosock != super_dc_rsock &&
-						  (*sockTable)[i].iosock != super_dc_ssock) )
-					{
-						// do nothing for now, because we know there is a request pending
-						// on the suerperuser command socket, and this is not the
-						// superuser command socket.
-					}
-					else if ( (*sockTable)[i].is_reverse_connect_pending ) {
-						// nothing to do
+			// find the socket table entries whose handlers should be called
+			m_ready_socks.clear();
+			if ( m_driver_selector ) {
+					// Only the entries that epoll reported or whose
+					// deadline has passed.
+				const std::vector<int> &ready_fds = m_driver_selector->ready_fds();
+				for ( size_t k = 0; k < ready_fds.size(); k++ ) {
+					int fd = ready_fds[k];
+					if ( fd < (int)m_selector_fd_sock.size() && m_selector_fd_sock[fd] != -1 ) {
+						m_ready_socks.push_back( m_selector_fd_sock[fd] );
 					}
-					else if ( (*sockTable)[i].is_connect_pending ) {
-
-						if ( selector.fd_ready( (*sockTable)[i].iosock->get_file_desc(),
-												Selector::IO_WRITE ) ||
-							 selector.fd_ready( (*sockTable)[i].iosock->get_file_desc(),
-												Selector::IO_EXCEPT ) ||
-							 sock_timed_out )
-						{
-							// A connection pending socket has been
-							// set or the connection attempt has timed out.
-							// Only call handler if CEDAR confirms the
-							// connect algorithm has completed.
-
-							if ( ((Sock *)(*sockTable)[i].iosock)->
-							      do_connect_finish() != CEDAR_EWOULDBLOCK)
-							{
-								(*sockTable)[i].call_handler = true;
-							}
-						}
-					} else if ((*sockTable)[i].handler_type == HANDLE_READ || (*sockTable)[i].handler_type == HANDLE_READ_WRITE) {
-						if ( (selector.fd_ready( (*sockTable)[i].iosock->get_file_desc(), Selector::IO_READ ) ) ||
-							 sock_timed_out )
-						{
-							(*sockTable)[i].call_handler = true;
-						}
-					} else if ((*sockTable)[i].handler_type == HANDLE_WRITE || (*sockTable)[i].handler_type == HANDLE_READ_WRITE) {
-						if ( (selector.fd_ready( (*sockTable)[i].iosock->get_file_desc(), Selector::IO_WRITE ) ) ||
-							 sock_timed_out )
-						{
-							(*sockTable)[i].call_handler = true;
-						}
-					}
-				}	// end of if valid sock entry
-			}	// end of for loop through all sock entries
+				}
+				std::set<std::pair<time_t,int> >::iterator it;
+				for ( it = m_selector_deadlines.begin();
+					  it != m_selector_deadlines.end() && it->first < now; ++it )
+				{
+					m_ready_socks.push_back( it->second );
+				}
+					// Call the handlers in table order, as select() would.
+				std::sort( m_ready_socks.begin(), m_ready_socks.end() );
+				m_ready_socks.erase( std::unique( m_ready_socks.begin(), m_ready_socks.end() ),
+									 m_ready_socks.end() );
+			} else {
+				for ( i = 0; i < nSock; i++ ) {
+					m_ready_socks.push_back( i );
+				}
+			}
+			for ( size_t k = 0; k < m_ready_socks.size(); k++ ) {
+				CheckSockReady( main_selector, m_ready_socks[k], now, superuser_command_arrived );
+			}
 
 			runtime = _condor_debug_get_time_double();
 			dc_stats.SocketRuntime += (runtime - group_runtime);
@@ -3851,11 +3859,11 @@ void DaemonCore::Driver()
 #else
 					// For Unix, check if select set the bit
 					int pipefd = (*pipeHandleTable)[(*pipeTable)[i].index];
-					if ( selector.fd_ready( pipefd, Selector::IO_READ ) )
+					if ( main_selector.fd_ready( pipefd, Selector::IO_READ ) )
 					{
 						(*pipeTable)[i].call_handler = true;
 					}
-					if ( selector.fd_ready( pipefd, Selector::IO_WRITE ) )
+					if ( main_selector.fd_ready( pipefd, Selector::IO_WRITE ) )
 					{
 						(*pipeTable)[i].call_handler = true;
 					}
@@ -3931,7 +3939,10 @@ void DaemonCore::Driver()
 						else
 						if ( (*pipeTable)[i].handlercpp )
 							// a C++ handler
+						{
+							Call_Service_Context_Hook( (*pipeTable)[i].service );
 							((*pipeTable)[i].service->*( (*pipeTable)[i].handlercpp))(pipe_end);
+						}
 						else
 						{
 							// no handler registered
@@ -3979,9 +3990,10 @@ void DaemonCore::Driver()
 			dc_stats.PipeRuntime += (runtime - group_runtime);
 			group_runtime = runtime;
 
-			// Now loop through all sock entries, calling handlers if required.
-			for(i = 0; i < nSock; i++) {
-				if ( (*sockTable)[i].iosock ) {	// if a valid entry...
+			// Now loop through the sock entries, calling handlers if required.
+			for ( size_t k = 0; k < m_ready_socks.size(); k++ ) {
+				i = m_ready_socks[k];
+				if ( i < nSock && (*sockTable)[i].iosock ) {	// if a valid entry...
 
 					if ( (*sockTable)[i].call_handler ) {
 
@@ -4019,7 +4031,7 @@ void DaemonCore::Driver()
 
 					}	// if call_handler is True
 				}	// if valid entry in sockTable
-			}	// for 0 thru nSock checking if call_handler is true
+			}	// for each ready entry checking if call_handler is true
 
 			runtime = _condor_debug_get_time_double();
 			dc_stats.SocketRuntime += (runtime - group_runtime);
@@ -4034,6 +4046,184 @@ void DaemonCore::Driver()
 	}	// end of infinite for loop
 }
 
+int
+DaemonCore::HandlerTypeSelectInterest( HandlerType handler_type )
+{
+	switch( handler_type ) {
+	case HANDLE_READ:
+		return Selector::IO_READ_MASK;
+	case HANDLE_WRITE:
+		return Selector::IO_WRITE_MASK;
+	case HANDLE_READ_WRITE:
+		return Selector::IO_READ_MASK | Selector::IO_WRITE_MASK;
+	default:
+		break;
+	}
+	return 0;
+}
+
+int
+DaemonCore::SockSelectInterest( int i )
+{
+	if ( (*sockTable)[i].iosock == NULL ||
+		 (*sockTable)[i].servicing_tid != 0 ||
+		 (*sockTable)[i].remove_asap ||
+		 (*sockTable)[i].is_reverse_connect_pending )
+	{
+		return 0;
+	}
+	if ( (*sockTable)[i].is_connect_pending ) {
+			// we want to be woken when a non-blocking
+			// connect is ready to write.  when connect
+			// is ready, select will set the writefd set
+			// on success, or the exceptfd set on failure.
+		return Selector::IO_WRITE_MASK | Selector::IO_EXCEPT_MASK;
+	}
+	return HandlerTypeSelectInterest( (*sockTable)[i].handler_type );
+}
+
+void
+DaemonCore::SelectorForgetFd( int fd )
+{
+	if ( m_driver_selector && fd != -1 ) {
+		m_driver_selector->forget_fd( fd );
+	}
+}
+
+void
+DaemonCore::SyncSockSelector( int i, bool force )
+{
+	if ( ! m_driver_selector ) {
+		return;
+	}
+	if ( i >= (int)m_selector_sock_fd.size() ) {
+		m_selector_sock_fd.resize( i + 1, -1 );
+		m_selector_sock_deadline.resize( i + 1, 0 );
+	}
+
+	Sock *iosock = (*sockTable)[i].iosock;
+	int fd = iosock ? iosock->get_file_desc() : -1;
+
+		// The entry is gone, or its socket was closed and maybe
+		// reopened with a different number (a non-blocking connect
+		// failing over to another address does that).
+	int old_fd = m_selector_sock_fd[i];
+	if ( old_fd != -1 && old_fd != fd ) {
+		SelectorForgetFd( old_fd );
+		if ( m_selector_fd_sock[old_fd] == i ) {
+			m_selector_fd_sock[old_fd] = -1;
+		}
+		m_selector_sock_fd[i] = -1;
+	}
+
+	int interest = SockSelectInterest( i );
+	if ( fd != -1 ) {
+		m_driver_selector->set_fd_interest( fd, interest, force );
+		if ( fd >= (int)m_selector_fd_sock.size() ) {
+			m_selector_fd_sock.resize( fd + 1, -1 );
+		}
+		m_selector_fd_sock[fd] = i;
+		m_selector_sock_fd[i] = fd;
+	}
+
+		// Entries we don't wait on don't time out either.
+	time_t deadline = interest ? iosock->get_deadline() : 0;
+	time_t old_deadline = m_selector_sock_deadline[i];
+	if ( deadline != old_deadline ) {
+		if ( old_deadline ) {
+			m_selector_deadlines.erase( std::make_pair( old_deadline, i ) );
+		}
+		if ( deadline ) {
+			m_selector_deadlines.insert( std::make_pair( deadline, i ) );
+		}
+		m_selector_sock_deadline[i] = deadline;
+	}
+}
+
+void
+DaemonCore::SyncAllSockSelector( bool force )
+{
+	for ( int i = 0; i < nSock; i++ ) {
+		SyncSockSelector( i, force );
+	}
+		// Entries past nSock have been cancelled.
+	for ( int i = nSock; i < (int)m_selector_sock_fd.size(); i++ ) {
+		if ( m_selector_sock_fd[i] != -1 || m_selector_sock_deadline[i] ) {
+			SyncSockSelector( i, false );
+		}
+	}
+}
+
+void
+DaemonCore::CheckSockReady( Selector &sel, int i, time_t now, bool superuser_command_arrived )
+{
+	if ( i >= nSock ||
+		 (*sockTable)[i].iosock == NULL ||
+		 (*sockTable)[i].servicing_tid != 0 ||
+		 (*sockTable)[i].remove_asap )
+	{
+		return;
+	}
+
+	// figure out if we should call a handler.  to do this,
+	// if the socket was doing a connect(), we check the
+	// writefds and excepfds.  otherwise, check readfds.
+	(*sockTable)[i].call_handler = false;
+	int sockfd = (*sockTable)[i].iosock->get_file_desc();
+	time_t deadline = (*sockTable)[i].iosock->get_deadline();
+	bool sock_timed_out = ( deadline && deadline < now );
+
+	if ( superuser_command_arrived &&
+		 ((*sockTable)[i].iosock != super_dc_rsock &&
+		  (*sockTable)[i].iosock != super_dc_ssock) )
+	{
+		// do nothing for now, because we know there is a request pending
+		// on the suerperuser command socket, and this is not the
+		// superuser command socket.
+	}
+	else if ( (*sockTable)[i].is_reverse_connect_pending ) {
+		// nothing to do
+	}
+	else if ( (*sockTable)[i].is_connect_pending ) {
+
+		if ( sel.fd_ready( sockfd, Selector::IO_WRITE ) ||
+			 sel.fd_ready( sockfd, Selector::IO_EXCEPT ) ||
+			 sock_timed_out )
+		{
+			// A connection pending socket has been
+			// set or the connection attempt has timed out.
+			// Only call handler if CEDAR confirms the
+			// connect algorithm has completed.
+
+			if ( ((Sock *)(*sockTable)[i].iosock)->
+			      do_connect_finish() != CEDAR_EWOULDBLOCK)
+			{
+				(*sockTable)[i].call_handler = true;
+			}
+			else {
+				// CEDAR may have moved on to the next address,
+				// closing the fd and opening another, likely with
+				// the same number, which epoll has forgotten.
+				SyncSockSelector( i, true );
+			}
+		}
+	} else if ((*sockTable)[i].handler_type == HANDLE_READ || (*sockTable)[i].handler_type == HANDLE_READ_WRITE) {
+		if ( sel.fd_ready( sockfd, Selector::IO_READ ) || sock_timed_out )
+		{
+			(*sockTable)[i].call_handler = true;
+		}
+	} else if ((*sockTable)[i].handler_type == HANDLE_WRITE || (*sockTable)[i].handler_type == HANDLE_READ_WRITE) {
+		if ( sel.fd_ready( sockfd, Selector::IO_WRITE ) || sock_timed_out )
+		{
+			(*sockTable)[i].call_handler = true;
+		}
+	}
+
+		// We may be here because of a deadline we noted earlier that
+		// has since been moved.
+	SyncSockSelector( i );
+}
+
 bool
 DaemonCore::SocketIsRegistered( Stream *sock )
 {
@@ -4176,6 +4366,8 @@ DaemonCore::CallSocketHandler( int &i, bool default_to_HandleCommand )
 	    }
 	    CondorThreads::pool_add(DaemonCore::CallSocketHandler_worker_demarshall,args,
 								    pTid,(*sockTable)[i].handler_descrip);
+		    // Stop waiting on the socket while a thread services it.
+	    SyncSockSelector( i );
 
     }
 }
@@ -4228,6 +4420,7 @@ DaemonCore::CallSocketHandler_worker( int i, bool default_to_HandleCommand, Stre
 		result = (*( (*sockTable)[i].handler))((*sockTable)[i].iosock);
 	} else if ( (*sockTable)[i].handlercpp ) {
 			// a C++ handler
+		Call_Service_Context_Hook( (*sockTable)[i].service );
 		result = ((*sockTable)[i].service->*( (*sockTable)[i].handlercpp))((*sockTable)[i].iosock);
 		}
 
@@ -4278,6 +4471,9 @@ DaemonCore::CallSocketHandler_worker( int i, bool default_to_HandleCommand, Stre
 				// need to potentially add this sock to select
 				daemonCore->Wake_up_select();	
 		}
+			// The handler may have closed and reopened the socket, or
+			// moved its deadline.
+		SyncSockSelector( i, true );
 	}
 }
 
@@ -4460,8 +4656,10 @@ DaemonCore::CallCommandHandler(int req,Stream *stream,bool delete_stream,bool ch
 
 		if ( comTable[index].is_cpp ) {
 			// the handler is c++ and belongs to a 'Service' class
-			if ( comTable[index].handlercpp )
+			if ( comTable[index].handlercpp ) {
+				Call_Service_Context_Hook( comTable[index].service );
 				result = (comTable[index].service->*(comTable[index].handlercpp))(req,stream);
+			}
 		} else {
 			// the handler is in c (not c++), so pass a Service pointer
 			if ( comTable[index].handler )
@@ -9783,6 +9981,7 @@ DaemonCore::CallReaper(int reaper_id, char const *whatexited, pid_t pid, int exi
 	}
 	else if ( reaper->handlercpp ) {
 		// a C++ handler
+		Call_Service_Context_Hook( reaper->service );
 		(reaper->service->*(reaper->handlercpp))(pid,exit_status);
 	}
 
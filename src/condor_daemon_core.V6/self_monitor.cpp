@@ -41,6 +41,12 @@ static void self_monitor()
     daemonCore->monitor_data.CollectData();
     daemonCore->dc_stats.Tick(daemonCore->monitor_data.last_sample_time);
     daemonCore->dc_stats.DebugOuts += dprintf_getCount();
+
+    // param_lookup_count() is a running total, so add only the lookups since the last sample
+    static unsigned int last_param_lookups = 0;
+    unsigned int param_lookups = param_lookup_count();
+    daemonCore->dc_stats.ParamLookups += (int)(param_lookups - last_param_lookups);
+    last_param_lookups = param_lookups;
 }
 
 SelfMonitorData::SelfMonitorData()
@@ -227,6 +233,7 @@ void DaemonCore::Stats::Init(bool enable)
    DC_STATS_ADD_RECENT(Pool, TimerRuntime,    IF_BASICPUB);
    DC_STATS_ADD_RECENT(Pool, SocketRuntime,   IF_BASICPUB);
    DC_STATS_ADD_RECENT(Pool, PipeRuntime,     IF_BASICPUB);
+   DC_STATS_ADD_RECENT(Pool, PollSetupRuntime, IF_BASICPUB);
    DC_STATS_ADD_RECENT(Pool, Signals,       IF_BASICPUB);
    STATS_POOL_ADD_VAL(Pool, "DC", TimersFired, IF_BASICPUB);
    STATS_POOL_PUB_PEAK(Pool, "DC", TimersFired, IF_BASICPUB);
@@ -235,6 +242,7 @@ void DaemonCore::Stats::Init(bool enable)
    //DC_STATS_ADD_RECENT(Pool, SockBytes,     IF_BASICPUB);
    //DC_STATS_ADD_RECENT(Pool, PipeBytes,     IF_BASICPUB);
    DC_STATS_ADD_RECENT(Pool, DebugOuts,     IF_VERBOSEPUB);
+   DC_STATS_ADD_RECENT(Pool, ParamLookups,  IF_BASICPUB);
    DC_STATS_ADD_RECENT(Pool, PumpCycle,     IF_VERBOSEPUB);
    STATS_POOL_ADD_VAL(Pool, "DC", UdpQueueDepth,  IF_BASICPUB);
    STATS_POOL_PUB_PEAK(Pool, "DC", UdpQueueDepth,  IF_BASICPUB);
@@ -282,12 +290,14 @@ void DaemonCore::Stats::Init(bool enable)
    DC_STATS_PUB_DEBUG(Pool, TimerRuntime,    IF_BASICPUB);
    DC_STATS_PUB_DEBUG(Pool, SocketRuntime,   IF_BASICPUB);
    DC_STATS_PUB_DEBUG(Pool, PipeRuntime,     IF_BASICPUB);
+   DC_STATS_PUB_DEBUG(Pool, PollSetupRuntime, IF_BASICPUB);
    DC_STATS_PUB_DEBUG(Pool, Signals,       IF_BASICPUB);
    DC_STATS_PUB_DEBUG(Pool, SockMessages,  IF_BASICPUB);
    DC_STATS_PUB_DEBUG(Pool, PipeMessages,  IF_BASICPUB);
    //DC_STATS_PUB_DEBUG(Pool, SockBytes,     IF_BASICPUB);
    //DC_STATS_PUB_DEBUG(Pool, PipeBytes,     IF_BASICPUB);
    DC_STATS_PUB_DEBUG(Pool, DebugOuts,     IF_VERBOSEPUB);
+   DC_STATS_PUB_DEBUG(Pool, ParamLookups,  IF_BASICPUB);
    DC_STATS_PUB_DEBUG(Pool, PumpCycle,     IF_VERBOSEPUB);
 
 
@@ -353,6 +363,10 @@ void DaemonCore::Stats::Publish(ClassAd & ad, int flags) const
    }
    ad.Assign("RecentDaemonCoreDutyCycle", dDutyCycle);
 
+   if ((flags & IF_RECENTPUB) && RecentStatsLifetime > 0) {
+      ad.Assign("RecentDCParamLookupRate", (double)ParamLookups.recent / RecentStatsLifetime);
+   }
+
    Pool.Publish(ad, flags);
 }
 
@@ -365,6 +379,7 @@ void DaemonCore::Stats::Unpublish(ClassAd & ad) const
    ad.Delete("DCRecentWindowMax");
    ad.Delete("DaemonCoreDutyCycle");
    ad.Delete("RecentDaemonCoreDutyCycle");
+   ad.Delete("RecentDCParamLookupRate");
    Pool.Unpublish(ad);
 }
 
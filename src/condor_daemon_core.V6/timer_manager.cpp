@@ -24,7 +24,7 @@
 #include "condor_debug.h"
 #include "condor_daemon_core.h"
 #include "condor_config.h"
-#include <unordered_set>
+#include <algorithm>
 
 static const char* DEFAULT_INDENT = "DaemonCore--> ";
 
@@ -52,8 +52,9 @@ TimerManager::TimerManager()
 	{
 		EXCEPT("TimerManager object exists!");
 	}
-	timer_list = NULL;
-	list_tail = NULL;
+	timer_seq = 0;
+	defer_due_timers = false;
+	defer_due_cutoff = 0;
 	timer_ids = 0;
 	in_timeout = NULL;
 	_t = this; 
@@ -152,6 +153,8 @@ int TimerManager::NewTimer(Service* s, unsigned deltawhen,
 		new_timer->when = deltawhen + new_timer->period_started;
 	}
 	new_timer->data_ptr = NULL;
+	new_timer->heap_index = -1;
+	new_timer->seq = 0;
 	if ( event_descrip ) 
 		new_timer->event_descrip = strdup(event_descrip);
 	else
@@ -185,7 +188,7 @@ bool TimerManager::ResetTimerTimeslice(int id, Timeslice const &new_timeslice)
 
 bool TimerManager::GetTimerTimeslice(int id, Timeslice &timeslice)
 {
-	Timer *timer_ptr = GetTimer( id, NULL );
+	Timer *timer_ptr = GetTimer( id );
 	if( !timer_ptr || !timer_ptr->timeslice ) {
 		return false;
 	}
@@ -195,7 +198,7 @@ bool TimerManager::GetTimerTimeslice(int id, Timeslice &timeslice)
 
 time_t TimerManager::GetNextRuntime(int id)
 {
-	Timer *timer_ptr = GetTimer( id, NULL );
+	Timer *timer_ptr = GetTimer( id );
 	if (!timer_ptr) { return false; }
 
 	return timer_ptr->when;
@@ -205,21 +208,15 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 							 Timeslice const *new_timeslice)
 {
 	Timer*			timer_ptr;
-	Timer*			trail_ptr;
 
 	dprintf( D_DAEMONCORE,
 			 "In reset_timer(), id=%d, time=%d, period=%d\n",id,when,period);
-	if (timer_list == NULL) {
+	if (timer_index.empty()) {
 		dprintf( D_DAEMONCORE, "Reseting Timer from empty list!\n");
 		return -1;
 	}
 
-	timer_ptr = timer_list;
-	trail_ptr = NULL;
-	while ( timer_ptr && timer_ptr->id != id ) {
-		trail_ptr = timer_ptr;
-		timer_ptr = timer_ptr->next;
-	}
+	timer_ptr = GetTimer( id );
 
 	if ( timer_ptr == NULL ) {
 		dprintf( D_ALWAYS, "Timer %d not found\n",id );
@@ -278,7 +275,7 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 	}
 	timer_ptr->period = period;
 
-	RemoveTimer( timer_ptr, trail_ptr );
+	RemoveTimer( timer_ptr );
 	InsertTimer( timer_ptr );
 
 	if ( in_timeout == timer_ptr ) {
@@ -293,27 +290,21 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 int TimerManager::CancelTimer(int id)
 {
 	Timer*		timer_ptr;
-	Timer*		trail_ptr;
 
 	dprintf( D_DAEMONCORE, "In cancel_timer(), id=%d\n",id);
-	if (timer_list == NULL) {
+	if (timer_index.empty()) {
 		dprintf( D_DAEMONCORE, "Removing Timer from empty list!\n");
 		return -1;
 	}
 
-	timer_ptr = timer_list;
-	trail_ptr = NULL;
-	while ( timer_ptr && timer_ptr->id != id ) {
-		trail_ptr = timer_ptr;
-		timer_ptr = timer_ptr->next;
-	}
+	timer_ptr = GetTimer( id );
 
 	if ( timer_ptr == NULL ) {
 		dprintf( D_ALWAYS, "Timer %d not found\n",id );
 		return -1;
 	}
 
-	RemoveTimer( timer_ptr, trail_ptr );
+	RemoveTimer( timer_ptr );
 
 	if ( in_timeout == timer_ptr ) {
 		// We're inside the handler for this timer. Don't delete it,
@@ -329,11 +320,14 @@ int TimerManager::CancelTimer(int id)
 
 void TimerManager::CancelAllTimers()
 {
-	Timer		*timer_ptr;
-
-	while( timer_list != NULL ) {
-		timer_ptr = timer_list;
-		timer_list = timer_list->next;
+	std::vector<Timer*> doomed;
+	doomed.swap( timer_heap );
+	doomed.insert( doomed.end(), deferred_timers.begin(), deferred_timers.end() );
+	deferred_timers.clear();
+	timer_index.clear();
+
+	for( Timer *timer_ptr : doomed ) {
+		timer_ptr->heap_index = -1;
 		if( in_timeout == timer_ptr ) {
 				// We get here if somebody calls exit from inside a timer.
 			did_cancel = true;
@@ -342,8 +336,6 @@ void TimerManager::CancelAllTimers()
 			DeleteTimer( timer_ptr );
 		}
 	}
-	timer_list = NULL;
-	list_tail = NULL;
 }
 
 // Timeout() is called when a select() time out.  Returns number of seconds
@@ -361,10 +353,10 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 	if ( in_timeout != NULL ) {
 		dprintf(D_DAEMONCORE,"DaemonCore Timeout() called and in_timeout is non-NULL\n");
-		if ( timer_list == NULL ) {
+		if ( timer_heap.empty() ) {
 			result = 0;
 		} else {
-			result = (timer_list->when) - time(NULL);
+			result = (timer_heap[0]->when) - time(NULL);
 		}
 		if ( result < 0 ) {
 			result = 0;
@@ -374,7 +366,7 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 		
 	dprintf( D_DAEMONCORE, "In DaemonCore Timeout()\n");
 
-	if (timer_list == NULL) {
+	if (timer_index.empty()) {
 		dprintf( D_DAEMONCORE, "Empty timer list, nothing to do\n" );
 	}
 
@@ -383,63 +375,28 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 	DumpTimerList(D_DAEMONCORE | D_FULLDEBUG);
 
     // if we are going to not limit the number of timer handlers we invoke,
-    // make a set now of all timers that are ready to go... below we will
-    // use this set in order to NOT invoke new timers that are inserted by
-    // timer handlers themselves.
-    std::unordered_set<int> readyTimerIds;
+    // only invoke the timers that are ready to go right now.  InsertTimer()
+    // parks timers that are added or reset to an already-due time by the
+    // handlers below, so we aren't stuck here forever; they are moved back
+    // into the heap once we are done (we will deal with them next time
+    // through the daemoncore loop).
     if (max_timer_events_per_cycle == INT_MAX) {
-        in_timeout = timer_list;
-        while ((in_timeout != NULL) && (in_timeout->when <= now)) {
-            readyTimerIds.insert(in_timeout->id);
-            in_timeout = in_timeout->next;
-        }
-        in_timeout = NULL;
+        defer_due_timers = true;
+        defer_due_cutoff = now;
     }
 
 	// loop until all handlers that should have been called by now or before
 	// are invoked and renewed if periodic.  Remember that NewTimer and CancelTimer
-	// keep the timer_list happily sorted on "when" for us.  We use "now" as a 
+	// keep the timer heap ordered on "when" for us.  We use "now" as a 
 	// variable so that if some of these handler functions run for a long time,
 	// we do not sit in this loop forever.
 	// we make certain we do not call more than "max_fires" handlers in a 
 	// single timeout --- this ensures that timers don't starve out the rest
 	// of daemonCore if a timer handler resets itself to 0.
-	while( (timer_list != NULL) && (timer_list->when <= now ) &&
+	while( !timer_heap.empty() && (timer_heap[0]->when <= now ) &&
 		   (num_fires < max_timer_events_per_cycle))
 	{
-        in_timeout = timer_list;
-
-        // In this code block, if there is no limit on how many timer handlers we will invoke,
-        // we want to skip over timers that got  added or reset by other timer handlers to make
-        // certain we aren't stuck here forever. So we will only call timer handlers that
-        // were ready to fire when we first entered Timeout().
-        if (max_timer_events_per_cycle == INT_MAX) {
-            std::unordered_set<int>::iterator it;
-            bool call_handler = false;
-            // Skip handlers already invoked or added
-            do {
-                it = readyTimerIds.find(in_timeout->id);
-                if (it == readyTimerIds.end()) {
-                    // this timer was not ready when we first looked, so it must have been
-                    // added or reset by another timer callback.  in this case, skip this timer
-                    // callback (we will deal with it next time through the daemoncore loop).
-                    dprintf(D_DAEMONCORE, "Timer %d not fired (SKIPPED) cause added\n", in_timeout->id);
-                    in_timeout = in_timeout->next;
-                }
-                else {
-                    // this timer was ready to fire when we first looked at the timer list, so
-                    // we are going to go ahead and call its handler.  Erase it from our readyTimerIds
-                    // list, and then break out of loop to go ahead and call the handler.
-                    call_handler = true;
-                    readyTimerIds.erase(it);
-                }
-            } while ((!call_handler) && (in_timeout != NULL) && (in_timeout->when <= now));
-
-            if (!call_handler) {
-                // no timers left that we want to fire at this time, break out of outer while loop
-                break;
-            }
-        }  // end of block if max_timer_events_per_cycle == INT_MAX
+        in_timeout = timer_heap[0];
 
         num_fires++;
 
@@ -467,6 +424,9 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 		// it and pass the service* as a parameter.
 		if ( in_timeout->handlercpp ) {
 			// typedef int (*TimerHandlercpp)()
+			if ( daemonCore ) {
+				daemonCore->Call_Service_Context_Hook( in_timeout->service );
+			}
 			((in_timeout->service)->*(in_timeout->handlercpp))();
 		} else {
 			// typedef int (*TimerHandler)()
@@ -489,12 +449,14 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 			}
 		}
 
-		if (pruntime) {           
+		if (pruntime && daemonCore) {
 			*pruntime = daemonCore->dc_stats.AddRuntime(in_timeout->event_descrip, *pruntime);
 		}
 
         // Make sure we didn't leak our priv state
-		daemonCore->CheckPrivState();
+		if (daemonCore) {
+			daemonCore->CheckPrivState();
+		}
 
 		// Clear curr_dataptr
 		curr_dataptr = NULL;
@@ -510,12 +472,11 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 			// If a new timer was added at a time in the past
 			// (possible when resetting a timeslice timer), then
 			// it may have landed before the timer we just processed,
-			// meaning that we cannot assume prev==NULL in the call
-			// to RemoveTimer() below.
+			// meaning that it is not necessarily still at the top
+			// of the heap.
 
-			Timer *prev = NULL;
-			ASSERT( GetTimer(in_timeout->id,&prev) == in_timeout );
-			RemoveTimer( in_timeout, prev );
+			ASSERT( GetTimer(in_timeout->id) == in_timeout );
+			RemoveTimer( in_timeout );
 
 			if ( in_timeout->period > 0 || in_timeout->timeslice ) {
 				in_timeout->period_started = time(NULL);
@@ -538,16 +499,26 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 		}
 	}  // end of while loop
 
+	if ( defer_due_timers ) {
+		defer_due_timers = false;
+		for ( Timer *timer_ptr : deferred_timers ) {
+			timer_ptr->heap_index = (int)timer_heap.size();
+			timer_heap.push_back( timer_ptr );
+			HeapSiftUp( timer_ptr->heap_index );
+		}
+		deferred_timers.clear();
+	}
+
 
 	// set result to number of seconds until next event.  get an update on the
 	// time from time() in case the handlers we called above took significant time.
-	if ( timer_list == NULL ) {
+	if ( timer_heap.empty() ) {
 		// we set result to be -1 so that we do not busy poll.
 		// a -1 return value will tell the DaemonCore:Driver to use select with
 		// no timeout.
 		result = -1;
 	} else {
-		result = (timer_list->when) - time(NULL);
+		result = (timer_heap[0]->when) - time(NULL);
 		if (result < 0)
 			result = 0;
 	}
@@ -563,7 +534,6 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 void TimerManager::DumpTimerList(int flag, const char* indent)
 {
-	Timer		*timer_ptr;
 	const char	*ptmp;
 
 	// we want to allow flag to be "D_FULLDEBUG | D_DAEMONCORE",
@@ -580,7 +550,12 @@ void TimerManager::DumpTimerList(int flag, const char* indent)
 	dprintf(flag, "\n");
 	dprintf(flag, "%sTimers\n", indent);
 	dprintf(flag, "%s~~~~~~\n", indent);
-	for(timer_ptr = timer_list; timer_ptr != NULL; timer_ptr = timer_ptr->next)
+	// the heap is only partially ordered, so sort a copy for display
+	std::vector<Timer*> sorted( timer_heap );
+	sorted.insert( sorted.end(), deferred_timers.begin(), deferred_timers.end() );
+	std::sort( sorted.begin(), sorted.end(), TimerBefore );
+
+	for( Timer *timer_ptr : sorted )
 	{
 		if ( timer_ptr->event_descrip )
 			ptmp = timer_ptr->event_descrip;
@@ -648,68 +623,106 @@ void TimerManager::Start()
 	}
 }
 
-void TimerManager::RemoveTimer( Timer *timer, Timer *prev )
+bool TimerManager::TimerBefore( const Timer *a, const Timer *b )
 {
-	if ( timer == NULL || ( prev && prev->next != timer ) ||
-		 ( !prev && timer != timer_list ) ) {
-		EXCEPT( "Bad call to TimerManager::RemoveTimer()!" );
+	// Note: equal "when" values are ordered by insertion sequence, never
+	// by id -- this makes certain we "round-robin" across timers that
+	// constantly reset themselves to zero.
+	if ( a->when != b->when ) {
+		return a->when < b->when;
 	}
+	return a->seq < b->seq;
+}
+
+void TimerManager::HeapSiftUp( size_t idx )
+{
+	Timer *timer = timer_heap[idx];
+	while ( idx > 0 ) {
+		size_t parent = (idx - 1) / 2;
+		if ( !TimerBefore( timer, timer_heap[parent] ) ) {
+			break;
+		}
+		timer_heap[idx] = timer_heap[parent];
+		timer_heap[idx]->heap_index = (int)idx;
+		idx = parent;
+	}
+	timer_heap[idx] = timer;
+	timer->heap_index = (int)idx;
+}
+
+void TimerManager::HeapSiftDown( size_t idx )
+{
+	size_t count = timer_heap.size();
+	Timer *timer = timer_heap[idx];
+	for (;;) {
+		size_t child = 2 * idx + 1;
+		if ( child >= count ) {
+			break;
+		}
+		if ( child + 1 < count && TimerBefore( timer_heap[child + 1], timer_heap[child] ) ) {
+			child++;
+		}
+		if ( !TimerBefore( timer_heap[child], timer ) ) {
+			break;
+		}
+		timer_heap[idx] = timer_heap[child];
+		timer_heap[idx]->heap_index = (int)idx;
+		idx = child;
+	}
+	timer_heap[idx] = timer;
+	timer->heap_index = (int)idx;
+}
 
-	if ( timer == timer_list ) {
-		timer_list = timer_list->next;
+void TimerManager::RemoveTimer( Timer *timer )
+{
+	if ( timer == NULL || timer_index.erase( timer->id ) != 1 ) {
+		EXCEPT( "Bad call to TimerManager::RemoveTimer()!" );
 	}
-	if ( timer == list_tail ) {
-		list_tail = prev;
+
+	if ( timer->heap_index < 0 ) {
+		// parked by Timeout(), see InsertTimer()
+		std::vector<Timer*>::iterator it =
+			std::find( deferred_timers.begin(), deferred_timers.end(), timer );
+		ASSERT( it != deferred_timers.end() );
+		deferred_timers.erase( it );
+		return;
 	}
-	if ( prev ) {
-		prev->next = timer->next;
+
+	size_t idx = (size_t)timer->heap_index;
+	ASSERT( idx < timer_heap.size() && timer_heap[idx] == timer );
+	timer->heap_index = -1;
+
+	Timer *last = timer_heap.back();
+	timer_heap.pop_back();
+	if ( last != timer ) {
+		timer_heap[idx] = last;
+		last->heap_index = (int)idx;
+		if ( idx > 0 && TimerBefore( last, timer_heap[(idx - 1) / 2] ) ) {
+			HeapSiftUp( idx );
+		} else {
+			HeapSiftDown( idx );
+		}
 	}
 }
 
 void TimerManager::InsertTimer( Timer *new_timer )
 {
-	if ( timer_list == NULL ) {
-		// list is empty, place ours in front
-		timer_list = new_timer;
-		list_tail = new_timer;
-		new_timer->next = NULL;
+	new_timer->seq = timer_seq++;
+	timer_index[new_timer->id] = new_timer;
+
+	if ( defer_due_timers && new_timer->when <= defer_due_cutoff ) {
+		new_timer->heap_index = -1;
+		deferred_timers.push_back( new_timer );
+		return;
+	}
+
+	new_timer->heap_index = (int)timer_heap.size();
+	timer_heap.push_back( new_timer );
+	HeapSiftUp( new_timer->heap_index );
+
+	if ( new_timer->heap_index == 0 && daemonCore ) {
 			// since we have a new first timer, we must wake up select
 		daemonCore->Wake_up_select();
-	} else {
-		// list is not empty, so keep timer_list ordered from soonest to
-		// farthest (i.e. sorted on "when").
-		// Note: when doing the comparisons, we always use "<" instead
-		// of "<=" -- this makes certain we "round-robin" across 
-		// timers that constantly reset themselves to zero.
-		if ( new_timer->when < timer_list->when ) {
-			// make the this new timer first in line
-			new_timer->next = timer_list;
-			timer_list = new_timer;
-			// since we have a new first timer, we must wake up select
-			daemonCore->Wake_up_select();
-		} else if ( new_timer->when == TIME_T_NEVER ) {
-			// Our new timer goes to the very back of the list.
-			new_timer->next = NULL;
-			list_tail->next = new_timer;
-			list_tail = new_timer;
-		} else {
-			Timer* timer_ptr;
-			Timer* trail_ptr = NULL;
-			for (timer_ptr = timer_list; timer_ptr != NULL; 
-				 timer_ptr = timer_ptr->next ) 
-			{
-				if (new_timer->when < timer_ptr->when) {
-					break;
-				}
-				trail_ptr = timer_ptr;
-			}
-			ASSERT( trail_ptr );
-			new_timer->next = timer_ptr;
-			trail_ptr->next = new_timer;
-			if ( trail_ptr == list_tail ) {
-				list_tail = new_timer;
-			}
-		}
 	}
 }
 
@@ -735,18 +748,11 @@ void TimerManager::DeleteTimer( Timer *timer )
 	delete timer;
 }
 
-Timer *TimerManager::GetTimer( int id, Timer **prev )
+Timer *TimerManager::GetTimer( int id )
 {
-	Timer *timer_ptr = timer_list;
-	if( prev ) {
-		*prev = NULL;
+	std::unordered_map<int, Timer*>::const_iterator it = timer_index.find( id );
+	if ( it == timer_index.end() ) {
+		return NULL;
 	}
-	while ( timer_ptr && timer_ptr->id != id ) {
-		if( prev ) {
-			*prev = timer_ptr;
-		}
-		timer_ptr = timer_ptr->next;
-	}
-
-	return timer_ptr;
+	return it->second;
 }
@@ -47,7 +47,9 @@
 #include "extArray.h"
 #include "HashTable.h"
 #include <set>
+#include <map>
 #include "dagman_metrics.h"
+#include "dag_checkpoint.h"
 #include "enum_utils.h"
 #include <iostream>
 
@@ -123,6 +125,7 @@ Dag::Dag( /* const */ std::list<std::string> &dagFiles,
 	_maxJobsDeferredCount (0),
 	_maxIdleDeferredCount (0),
 	_catThrottleDeferredCount (0),
+	_batchedSubmitsThisCycle (0),
 	_prohibitMultiJobs	  (prohibitMultiJobs),
 	_submitDepthFirst	  (submitDepthFirst),
 	_defaultNodeLog		  (defaultNodeLog),
@@ -196,6 +199,10 @@ Dag::Dag( /* const */ std::list<std::string> &dagFiles,
 	_alwaysUpdateStatus = false;
 	_lastStatusUpdateTimestamp = 0;
 
+	_checkpointInterval = 0;
+	_lastCheckpointTime = 0;
+	_lastCheckpointOffset = -1;
+
 	_nextSubmitTime = 0;
 	_nextSubmitDelay = 1;
 	_recovery = false;
@@ -312,6 +319,12 @@ bool Dag::Bootstrap (bool recovery)
 
 	(void) MonitorLogFile();
 
+		// If we're not in recovery mode, the node log was just
+		// truncated, so any checkpoint is stale.
+	if ( !recovery ) {
+		RemoveCheckpoint();
+	}
+
     if (recovery) {
         debug_printf( DEBUG_NORMAL, "Running in RECOVERY mode... "
 					">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>\n" );
@@ -329,6 +342,9 @@ bool Dag::Bootstrap (bool recovery)
 		debug_cache_start_caching();
 
 		if( CondorLogFileCount() > 0 ) {
+				// If we have a checkpoint, we only need to read the
+				// events after it.
+			(void) RestoreCheckpoint();
 			if( !ProcessLogEvents( recovery ) ) {
 				_recovery = false;
 				debug_cache_stop_caching();
@@ -671,6 +687,10 @@ bool Dag::ProcessOneEvent (ULogEventOutcome outcome,
 			default:
 				break;
 			}
+
+				// Remember the node's state as of this event, in case
+				// we write a checkpoint.
+			job->SaveLoggedState();
 		}
 		break;
 
@@ -1624,7 +1644,14 @@ Dag::SubmitReadyJobs(const Dagman &dm)
 		// Jobs deferred by category throttles.
 	PrioritySimpleList<Job*> deferredJobs;
 
+		// Nodes waiting to be submitted together by SubmitNodeBatch(),
+		// and how many of them are in each throttled category.
+	std::vector<Job*> batch;
+	std::map<ThrottleByCategory::ThrottleInfo*, int> batchedByCategory;
+	bool batchFailed = false;
+
 	int numSubmitsThisCycle = 0;
+	_batchedSubmitsThisCycle = 0;
 
 		// Check whether we have to wait longer before submitting again
 		// (if a previous submit attempt failed).
@@ -1674,7 +1701,8 @@ Dag::SubmitReadyJobs(const Dagman &dm)
 		}
 	}
 
-	while( numSubmitsThisCycle < dm.max_submits_per_interval ) {
+	while( numSubmitsThisCycle + (int)batch.size() <
+				dm.max_submits_per_interval ) {
 
 //		PrintReadyQ( DEBUG_DEBUG_4 );
 
@@ -1684,7 +1712,8 @@ Dag::SubmitReadyJobs(const Dagman &dm)
     	}
 
     		// max jobs already submitted
-    	if( _maxJobsSubmitted && (_numJobsSubmitted >= _maxJobsSubmitted) ) {
+    	if( _maxJobsSubmitted &&
+					(_numJobsSubmitted + (int)batch.size() >= _maxJobsSubmitted) ) {
         	debug_printf( DEBUG_DEBUG_1,
                       	"Max jobs (%d) already running; "
 					  	"deferring submission of %d ready job%s.\n",
@@ -1736,7 +1765,8 @@ Dag::SubmitReadyJobs(const Dagman &dm)
 		ThrottleByCategory::ThrottleInfo *catThrottle = job->GetThrottleInfo();
 		if ( catThrottle &&
 					catThrottle->isSet() &&
-					catThrottle->_currentJobs >= catThrottle->_maxJobs ) {
+					catThrottle->_currentJobs + batchedByCategory[catThrottle] >=
+					catThrottle->_maxJobs ) {
 			debug_printf( DEBUG_DEBUG_1,
 						"Node %s deferred by category throttle (%s, %d)\n",
 						job->GetJobName(), catThrottle->_category->Value(),
@@ -1748,7 +1778,31 @@ Dag::SubmitReadyJobs(const Dagman &dm)
 			debug_printf(DEBUG_NORMAL, "Processing job: %s\n", job->GetJobName());
 			TerminateJob(job, false, false);
 			numSubmitsThisCycle++;
+		} else if ( CanBatchSubmit( dm, job ) ) {
+			batch.push_back( job );
+			if ( catThrottle ) {
+				batchedByCategory[catThrottle]++;
+			}
+			if ( (int)batch.size() >= dm.submit_batch_size ) {
+				numSubmitsThisCycle += SubmitNodeBatch( dm, batch,
+							batchFailed );
+				batchedByCategory.clear();
+				if ( batchFailed ) {
+					break; // break out of while loop
+				}
+			}
 		} else {
+				// Submit any batched nodes first, so nodes are still
+				// submitted in ready queue order.
+			if ( !batch.empty() ) {
+				numSubmitsThisCycle += SubmitNodeBatch( dm, batch,
+							batchFailed );
+				batchedByCategory.clear();
+				if ( batchFailed ) {
+					_readyQ->Prepend( job, -job->_effectivePriority );
+					break; // break out of while loop
+				}
+			}
 
 				// Note:  I'm not sure why we don't just use the default
 				// constructor here.  wenger 2015-09-25
@@ -1770,6 +1824,10 @@ Dag::SubmitReadyJobs(const Dagman &dm)
 		}
 	}
 
+	if ( !batch.empty() ) {
+		numSubmitsThisCycle += SubmitNodeBatch( dm, batch, batchFailed );
+	}
+
 	// if we didn't actually invoke condor_submit, and we submitted any jobs
 	// we should now send a reschedule command
 	if (numSubmitsThisCycle > 0 && !_dry_run)
@@ -3343,6 +3401,343 @@ Dag::DumpNodeStatus( bool held, bool removed )
 	_lastStatusUpdateTimestamp = startTime;
 }
 
+//-------------------------------------------------------------------------
+void
+Dag::SetCheckpointFile( const char *checkpointFile, int interval )
+{
+	_checkpointFile = checkpointFile;
+	_checkpointInterval = interval;
+}
+
+//-------------------------------------------------------------------------
+unsigned int
+Dag::NodeNamesHash() const
+{
+	unsigned int hash = DagCheckpoint::HASH_BASIS;
+	for ( auto it = _jobs.begin(); it != _jobs.end(); it++ ) {
+			// Include the terminating NUL so "ab","c" != "a","bc".
+		const char *name = (*it)->GetJobName();
+		hash = DagCheckpoint::Hash( name, strlen( name ) + 1, hash );
+	}
+	return hash;
+}
+
+//-------------------------------------------------------------------------
+/** Write the checkpoint file.  The checkpoint holds the state of each
+	node as of the last event we've read from the node log for it (see
+	Job::SaveLoggedState()), along with the state of the log reader, so
+	that recovery mode can restore the nodes and only read the events
+	after the checkpoint.
+*/
+void
+Dag::WriteCheckpoint( bool force )
+{
+	if ( _checkpointFile.empty() || _checkpointInterval <= 0 || _recovery ) {
+		return;
+	}
+
+	time_t startTime = time( NULL );
+	if ( !force && ( startTime - _lastCheckpointTime ) < _checkpointInterval ) {
+		return;
+	}
+
+	ReadUserLog::FileState logState;
+	ReadUserLog::InitFileState( logState );
+	CondorError errstack;
+	if ( !_condorLogRdr.getLogFileState( _defaultNodeLog, logState,
+				errstack ) ) {
+		debug_printf( DEBUG_VERBOSE, "DAG checkpoint not written: %s\n",
+					errstack.getFullText().c_str() );
+		ReadUserLog::UninitFileState( logState );
+		return;
+	}
+
+	DagCheckpoint ckpt;
+	unsigned long offset = 0;
+	ReadUserLogStateAccess stateAccess( logState );
+	bool gotOffset = stateAccess.getFileOffset( offset );
+	ckpt.logState.assign( (const char *)logState.buf, logState.size );
+	ReadUserLog::UninitFileState( logState );
+	ckpt.logOffset = offset;
+
+		// If we haven't read any events since the last checkpoint,
+		// the last checkpoint is still current.
+	if ( !gotOffset || ckpt.logOffset == _lastCheckpointOffset ) {
+		return;
+	}
+
+	if ( !DagCheckpoint::HashLogTail( _defaultNodeLog, ckpt.logOffset,
+				ckpt.logTailHash ) ) {
+		debug_printf( DEBUG_VERBOSE, "DAG checkpoint not written: can't "
+					"read node log %s\n", _defaultNodeLog );
+		return;
+	}
+
+	ckpt.nodeNamesHash = NodeNamesHash();
+	ckpt.nextJobstateSeqNum = Job::GetJobstateNextSequenceNum();
+	ckpt.fakeCondorID = get_fake_condorID();
+
+	ckpt.nodes.resize( _jobs.size() );
+	for ( size_t i = 0; i < _jobs.size(); i++ ) {
+		const Job *node = _jobs[i];
+		DagCheckpoint::NodeRecord &rec = ckpt.nodes[i];
+		rec.state = node->GetLoggedState();
+		if ( !rec.state.valid ) {
+			continue;
+		}
+
+			// These only change when we process an event for the node,
+			// so their current values are their values as of the last
+			// event.
+		rec.jobstateSeqNum = node->PeekJobstateSequenceNum();
+		rec.queuedProcs = node->_queuedNodeJobProcs;
+		rec.submittedProcs = node->_numSubmittedProcs;
+		rec.timesHeld = node->_timesHeld;
+		rec.procsOnHold = node->_jobProcsOnHold;
+		rec.isCluster = node->is_cluster;
+		rec.procEvents = node->GetProcEvents();
+		rec.errorText = node->error_text.Value();
+
+		const CondorID &id = rec.state.condorID;
+		if ( id == _defaultCondorId ) {
+			continue;
+		}
+		int procs = MAX( 1, MAX( rec.submittedProcs,
+					(int)rec.procEvents.size() ) );
+		for ( int proc = 0; proc < procs; proc++ ) {
+			DagCheckpoint::NodeRecord::ProcCounts procCounts;
+			procCounts.id = CondorID( id._cluster, proc, id._subproc );
+			if ( _checkCondorEvents.GetEventCounts( procCounts.id,
+						procCounts.counts ) ) {
+				rec.eventCounts.push_back( procCounts );
+			}
+		}
+	}
+
+	std::string errMsg;
+	if ( !ckpt.Write( _checkpointFile.c_str(), errMsg ) ) {
+		debug_printf( DEBUG_NORMAL, "Warning: can't write DAG checkpoint: "
+					"%s\n", errMsg.c_str() );
+		return;
+	}
+
+	debug_printf( DEBUG_VERBOSE, "Wrote DAG checkpoint %s (node log "
+				"offset %lld)\n", _checkpointFile.c_str(),
+				(long long)ckpt.logOffset );
+	_lastCheckpointTime = startTime;
+	_lastCheckpointOffset = ckpt.logOffset;
+}
+
+//-------------------------------------------------------------------------
+void
+Dag::RemoveCheckpoint()
+{
+	if ( _checkpointFile.empty() ) {
+		return;
+	}
+
+	if ( access( _checkpointFile.c_str(), F_OK ) == 0 ) {
+		_dagmanUtils.tolerant_unlink( _checkpointFile.c_str() );
+	}
+	_lastCheckpointOffset = -1;
+}
+
+//-------------------------------------------------------------------------
+bool
+Dag::RestoreCheckpoint()
+{
+	if ( _checkpointFile.empty() ||
+				access( _checkpointFile.c_str(), F_OK ) != 0 ) {
+		return false;
+	}
+
+		//
+		// Make sure the checkpoint matches the DAG and the node log
+		// before we change anything; if it doesn't, we just fall back
+		// to reading the whole log.
+		//
+	DagCheckpoint ckpt;
+	std::string errMsg;
+	if ( !ckpt.Read( _checkpointFile.c_str(), errMsg ) ) {
+		debug_printf( DEBUG_NORMAL, "Not using DAG checkpoint: %s\n",
+					errMsg.c_str() );
+		return false;
+	}
+
+	if ( ckpt.nodes.size() != _jobs.size() ||
+				ckpt.nodeNamesHash != NodeNamesHash() ) {
+		debug_printf( DEBUG_NORMAL, "Not using DAG checkpoint %s because "
+					"it was written for a different DAG\n",
+					_checkpointFile.c_str() );
+		return false;
+	}
+
+		// The final node is only started when the rest of the DAG
+		// finishes; let recovery mode sort that out from the log.
+	for ( size_t i = 0; i < _jobs.size(); i++ ) {
+		if ( _jobs[i] == _final_job && ckpt.nodes[i].state.valid ) {
+			debug_printf( DEBUG_NORMAL, "Not using DAG checkpoint %s "
+						"because the final node has started\n",
+						_checkpointFile.c_str() );
+			return false;
+		}
+	}
+
+	ReadUserLog::FileState logState;
+	ReadUserLog::InitFileState( logState );
+	bool logMatches = false;
+	if ( ckpt.logState.size() == (size_t)logState.size ) {
+		memcpy( logState.buf, ckpt.logState.data(), logState.size );
+		ReadUserLogStateAccess stateAccess( logState );
+		unsigned long offset = 0;
+		unsigned int tailHash = 0;
+		logMatches = stateAccess.isValid() &&
+					stateAccess.getFileOffset( offset ) &&
+					(int64_t)offset == ckpt.logOffset &&
+					DagCheckpoint::HashLogTail( _defaultNodeLog,
+					ckpt.logOffset, tailHash ) &&
+					tailHash == ckpt.logTailHash;
+	}
+
+	CondorError errstack;
+	if ( !logMatches ) {
+		debug_printf( DEBUG_NORMAL, "Not using DAG checkpoint %s because "
+					"it doesn't match node log %s\n",
+					_checkpointFile.c_str(), _defaultNodeLog );
+		ReadUserLog::UninitFileState( logState );
+		return false;
+	}
+	if ( !_condorLogRdr.setLogFileState( _defaultNodeLog, logState,
+				errstack ) ) {
+		debug_printf( DEBUG_NORMAL, "Not using DAG checkpoint %s: %s\n",
+					_checkpointFile.c_str(),
+					errstack.getFullText().c_str() );
+		ReadUserLog::UninitFileState( logState );
+		return false;
+	}
+	ReadUserLog::UninitFileState( logState );
+
+		//
+		// Now restore each node to the state recovery mode would have
+		// left it in after reading the log up to the checkpoint.
+		//
+	int restored = 0;
+	for ( size_t i = 0; i < _jobs.size(); i++ ) {
+		Job *node = _jobs[i];
+		const DagCheckpoint::NodeRecord &rec = ckpt.nodes[i];
+		if ( !rec.state.valid ) {
+			continue;
+		}
+		restored++;
+
+		node->retries = rec.state.retries;
+		node->retval = rec.state.retval;
+		if ( node->_scriptPost ) {
+			node->_scriptPost->_retValJob = rec.state.retValJob;
+		}
+		node->SetJobstateSequenceNum( rec.jobstateSeqNum );
+
+		for ( auto it = rec.eventCounts.begin();
+					it != rec.eventCounts.end(); it++ ) {
+			_checkCondorEvents.SetEventCounts( it->id, it->counts );
+		}
+
+			// Recovery mode resets the ID of a node that is going to
+			// be retried (see RestartNode()).
+		const CondorID &id = rec.state.condorID;
+		if ( !( id == _defaultCondorId ) &&
+					rec.state.status != Job::STATUS_READY ) {
+			node->SetCondorID( id );
+			bool isNoop = JobIsNoop( id );
+			HashTable<int, Job *> *ht = GetEventIDHash( isNoop );
+			Job *tmpNode = NULL;
+			if ( ht->lookup( GetIndexID( id ), tmpNode ) != 0 ) {
+				int insertResult = ht->insert( GetIndexID( id ), node );
+				ASSERT( insertResult == 0 );
+			}
+			if ( isNoop ) {
+				_recoveryMaxfakeID = MAX( _recoveryMaxfakeID,
+							GetIndexID( id ) );
+			}
+		}
+
+		node->_numSubmittedProcs = rec.submittedProcs;
+		node->_timesHeld = rec.timesHeld;
+
+		switch ( rec.state.status ) {
+		case Job::STATUS_DONE:
+			if ( node->GetStatus() != Job::STATUS_DONE ) {
+				TerminateJob( node, false, true );
+			}
+			break;
+
+		case Job::STATUS_SUBMITTED:
+		case Job::STATUS_POSTRUN:
+		case Job::STATUS_ERROR:
+			{
+			node->SetStatus( rec.state.status );
+			node->_queuedNodeJobProcs = rec.queuedProcs;
+			node->_jobProcsOnHold = rec.procsOnHold;
+			node->is_cluster = rec.isCluster;
+			node->SetProcEvents( rec.procEvents );
+
+				// Same conditions as UpdateJobCounts() in
+				// ProcessSubmitEvent() and DecrementProcCount()/
+				// ProcessClusterRemoveEvent().
+			bool counted = rec.submittedProcs > 0 && ( rec.isCluster ?
+						!rec.procEvents.empty() : rec.queuedProcs > 0 );
+			if ( counted ) {
+				UpdateJobCounts( node, 1 );
+				for ( auto it = rec.procEvents.begin();
+							it != rec.procEvents.end(); it++ ) {
+					if ( *it & IDLE_MASK ) {
+						_numIdleJobProcs++;
+					}
+				}
+			}
+
+			if ( rec.state.status == Job::STATUS_POSTRUN ) {
+				_postRunNodeCount++;
+			} else if ( rec.state.status == Job::STATUS_ERROR ) {
+				node->error_text = rec.errorText.c_str();
+					// A node that is in the ERROR state with none of
+					// its job procs in the queue isn't going to be
+					// retried, so it has failed.
+				if ( !counted ) {
+					_numNodesFailed++;
+					_metrics->NodeFinished( node->GetDagFile() != NULL,
+								false );
+					if ( _dagStatus == DAG_STATUS_OK ) {
+						_dagStatus = DAG_STATUS_NODE_FAILED;
+					}
+				}
+			}
+			}
+			break;
+
+		default:
+				// Nothing has happened to the node as far as the log
+				// is concerned (e.g., it is being retried).
+			break;
+		}
+
+		node->SaveLoggedState();
+	}
+
+	_recoveryMaxfakeID = MAX( _recoveryMaxfakeID, ckpt.fakeCondorID );
+	if ( ckpt.nextJobstateSeqNum > Job::GetJobstateNextSequenceNum() ) {
+		Job::SetJobstateNextSequenceNum( ckpt.nextJobstateSeqNum );
+	}
+	_lastCheckpointOffset = ckpt.logOffset;
+
+	debug_printf( DEBUG_NORMAL, "Restored %d node(s) from DAG checkpoint "
+				"%s; reading node log %s from offset %lld\n", restored,
+				_checkpointFile.c_str(), _defaultNodeLog,
+				(long long)ckpt.logOffset );
+
+	return true;
+}
+
 //-------------------------------------------------------------------------
 const char *
 Dag::EscapeClassadString( const char* strIn )
@@ -4305,14 +4700,7 @@ Dag::SubmitNodeJob( const Dagman &dm, Job *node, CondorID &condorID )
 	if (node->GetSubmitDesc()) { use_condor_submit = false; }
 
 		// Resetting the HTCondor ID here fixes PR 799.  wenger 2007-01-24.
-	if ( node->GetCluster() != _defaultCondorId._cluster ) {
-			// Remove the "previous" HTCondor ID for this node from
-			// the ID->node hash table.
-		int id = GetIndexID( node->GetID() );
-		int removeResult = GetEventIDHash( node->GetNoop() )->remove( id );
-		ASSERT( removeResult == 0 );
-	}
-	node->SetCondorID( _defaultCondorId );
+	ResetNodeCondorID( node );
 
 		// sleep for a specified time before submitting
 	if( dm.submit_delay != 0 ) {
@@ -4431,6 +4819,104 @@ Dag::SubmitNodeJob( const Dagman &dm, Job *node, CondorID &condorID )
 	return result;
 }
 
+//---------------------------------------------------------------------------
+void
+Dag::ResetNodeCondorID( Job *node )
+{
+	if ( node->GetCluster() != _defaultCondorId._cluster ) {
+			// Remove the "previous" HTCondor ID for this node from
+			// the ID->node hash table.
+		int id = GetIndexID( node->GetID() );
+		int removeResult = GetEventIDHash( node->GetNoop() )->remove( id );
+		ASSERT( removeResult == 0 );
+	}
+	node->SetCondorID( _defaultCondorId );
+}
+
+//---------------------------------------------------------------------------
+bool
+Dag::CanBatchSubmit( const Dagman &dm, Job *node ) const
+{
+	if ( dm.submit_batch_size <= 1 || dm.submit_delay != 0 || _dry_run ) {
+		return false;
+	}
+
+		// NOOP nodes don't submit anything, and nested DAG nodes may
+		// need condor_submit_dag -no_submit run first.
+	if ( node->GetNoop() || node->GetDagFile() != NULL ) {
+		return false;
+	}
+
+		// Only direct submission can be batched; condor_submit is run
+		// separately for each node.
+	return node->GetSubmitDesc() != NULL ||
+				!param_boolean( "DAGMAN_USE_CONDOR_SUBMIT", true );
+}
+
+//---------------------------------------------------------------------------
+int
+Dag::SubmitNodeBatch( const Dagman &dm, std::vector<Job*> &batch,
+			bool &failed )
+{
+	int numSubmitted = 0;
+	failed = false;
+
+		// None of the nodes have a DAG file (see CanBatchSubmit()), so
+		// this is the same as in SubmitNodeJob().
+	const char *batchName = dm._batchName == " " ? "" : dm._batchName.Value();
+	const char *batchId = dm._batchId == " " ? "" : dm._batchId.c_str();
+
+	std::vector<std::string> parents( batch.size() );
+	for ( size_t i = 0; i < batch.size(); i++ ) {
+		Job *node = batch[i];
+		ResetNodeCondorID( node );
+		if ( ! node->NoParents() ) {
+			parents[i].reserve( 2048 );
+			node->PrintParents( parents[i], 2000, this, "," );
+		}
+		debug_printf( DEBUG_NORMAL, "Submitting %s Node %s job(s)...\n",
+					node->JobTypeString(), node->GetJobName() );
+	}
+
+	debug_printf( DEBUG_VERBOSE, "Submitting %d nodes in one batch\n",
+				(int)batch.size() );
+	std::vector<CondorID> condorIDs;
+	if ( direct_condor_submit_batch( dm, batch, _defaultNodeLog, parents,
+				batchName, batchId, condorIDs ) ) {
+		for ( size_t i = 0; i < batch.size(); i++ ) {
+			batch[i]->_submitTries++;
+			ProcessSuccessfulSubmit( batch[i], condorIDs[i] );
+		}
+		numSubmitted = (int)batch.size();
+		_batchedSubmitsThisCycle += numSubmitted;
+
+	} else {
+			// Nothing from the batch was submitted; submit the nodes
+			// one at a time so that only the node(s) that really fail
+			// count as failed submits.
+		debug_printf( DEBUG_NORMAL, "Batch submit of %d nodes failed; "
+					"submitting them one at a time\n", (int)batch.size() );
+		for ( size_t i = 0; i < batch.size(); i++ ) {
+			Job *node = batch[i];
+			if ( failed ) {
+				_readyQ->Prepend( node, -node->_effectivePriority );
+				continue;
+			}
+			CondorID condorID( 0, 0, 0 );
+			if ( SubmitNodeJob( dm, node, condorID ) == SUBMIT_RESULT_OK ) {
+				ProcessSuccessfulSubmit( node, condorID );
+				numSubmitted++;
+			} else {
+				ProcessFailedSubmit( node, dm.max_submit_attempts );
+				failed = true;
+			}
+		}
+	}
+
+	batch.clear();
+	return numSubmitted;
+}
+
 //---------------------------------------------------------------------------
 void
 Dag::ProcessSuccessfulSubmit( Job *node, const CondorID &condorID )
@@ -26,6 +26,7 @@
 #include "scriptQ.h"
 #include "condor_constants.h"      /* from condor_includes/ directory */
 #include "HashTable.h"
+#include "OpenHashTable.h"
 #include "extArray.h"
 #include "condor_daemon_core.h"
 #include "read_multiple_logs.h"
@@ -478,6 +479,11 @@ class Dag {
 		*/
     int SubmitReadyJobs(const Dagman &dm);
 
+		/** @return the number of nodes that the last call to
+			SubmitReadyJobs() submitted in batches (see SubmitNodeBatch())
+		*/
+	int NumBatchedSubmitsLastCycle() const { return _batchedSubmitsThisCycle; }
+
 		/** Start the DAG's final node if there is one.  Note that this
 			method will not re-start the final node if it has already
 			been started.
@@ -595,6 +601,26 @@ class Dag {
 				int minUpdateTime, bool alwaysUpdate = false );
 	void DumpNodeStatus( bool held, bool removed );
 
+	/** Set the checkpoint file, which holds the state of the nodes as
+		of a point in the node log so that recovery mode only needs to
+		read the log after that point.
+		@param the checkpoint file
+		@param the minimum interval, in seconds, at which to write the
+			checkpoint (0 means never write it)
+	*/
+	void SetCheckpointFile( const char *checkpointFile, int interval );
+
+	/** Write the checkpoint file if there are new events since the last
+		checkpoint, and the checkpoint interval has passed.
+		@param write the checkpoint even if the interval hasn't passed
+	*/
+	void WriteCheckpoint( bool force );
+
+	/** Remove the checkpoint file (e.g., when the DAG exits, or when
+		we're not in recovery mode, so any checkpoint is stale).
+	*/
+	void RemoveCheckpoint();
+
 		/** Set the reject flag to true for this DAG; if it hasn't been
 			previously set, update the location info for the reject
 			directive.
@@ -945,6 +971,33 @@ class Dag {
 	*/	
 	void ProcessSuccessfulSubmit( Job *node, const CondorID &condorID );
 
+	/** Whether a node's job can be submitted in a batch with other
+		nodes' jobs (see SubmitNodeBatch()).
+		@param the appropriate Dagman object
+		@param the node to check
+		@return true iff the node can be batched
+	*/
+	bool CanBatchSubmit( const Dagman &dm, Job *node ) const;
+
+	/** Submit the HTCondor jobs for a batch of nodes in a single schedd
+		transaction, and do the post-processing for them.  If the batch
+		can't be submitted, the nodes are submitted one at a time
+		instead, stopping at the first failure; any nodes after that
+		are returned to the ready queue.
+		@param the appropriate Dagman object
+		@param the nodes to submit (cleared on return)
+		@param set to true if a submit failed
+		@return the number of nodes successfully submitted
+	*/
+	int SubmitNodeBatch( const Dagman &dm, std::vector<Job*> &batch,
+				bool &failed );
+
+	/** Forget the HTCondor ID of a node's previous job, if any, before
+		submitting it again.
+		@param the node
+	*/
+	void ResetNodeCondorID( Job *node );
+
 	/** Do the post-processing of a failed submit of a HTCondor job.
 		@param the node for which the job was just submitted
 		@param the maximum number of submit attempts allowed for a job.
@@ -1093,7 +1146,7 @@ private:
 
 	bool _provisioner_ready = false;
 
-	HashTable<MyString, Job *>		_nodeNameHash;
+	OpenHashTable<MyString, Job *>		_nodeNameHash;
 
 	HashTable<JobID_t, Job *>		_nodeIDHash;
 
@@ -1204,6 +1257,32 @@ private:
 		// Last time the status file was written.
 	time_t _lastStatusUpdateTimestamp;
 
+		// Name of the checkpoint file (empty if we don't checkpoint).
+	std::string _checkpointFile;
+
+		// Minimum time between checkpoints (0 means never write one).
+	int _checkpointInterval;
+
+		// Last time the checkpoint was written.
+	time_t _lastCheckpointTime;
+
+		// The node log offset as of the last checkpoint (-1 if we
+		// haven't written one).
+	int64_t _lastCheckpointOffset;
+
+	/** Restore the state of the nodes from the checkpoint file, and set
+		the log reader to read the events after the checkpoint.  Nothing
+		is changed if the checkpoint doesn't exist or doesn't match the
+		DAG and the node log.
+		@return true if the checkpoint was restored, false otherwise
+	*/
+	bool RestoreCheckpoint();
+
+	/** Hash the names of all nodes, in order, to check that a checkpoint
+		was written for this DAG.
+	*/
+	unsigned int NodeNamesHash() const;
+
 	CheckEvents	_checkCondorEvents;
 
 		// Total count of jobs deferred because of MaxJobs limit (note
@@ -1219,6 +1298,10 @@ private:
 		// Total count of jobs deferred because of node category throttles.
 	int		_catThrottleDeferredCount;
 
+		// Number of nodes the current (or last) submit cycle submitted
+		// in batches.
+	int		_batchedSubmitsThisCycle;
+
 		// whether or not to prohibit multiple job proc submitsn (e.g.,
 		// node jobs that create more than one job proc)
 	bool		_prohibitMultiJobs;
@@ -0,0 +1,330 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "condor_common.h"
+#include "condor_fsync.h"
+#include "condor_blkng_full_disk_io.h"
+#include "dagman_utils.h"
+#include "dag_checkpoint.h"
+
+// The checkpoint file is:
+//   the magic string and the format version
+//   the header fields (see DagCheckpoint)
+//   one NodeRecord for each node
+//   the hash of everything before it
+// Strings and vectors are written as a count followed by the data.
+static const char CHECKPOINT_MAGIC[8] = { 'D', 'A', 'G', 'C', 'K', 'P', 'T', '\n' };
+static const int CHECKPOINT_VERSION = 1;
+
+// Sanity limit on the counts in the file, so that a corrupt count
+// can't make us try to allocate a huge amount of memory.
+static const unsigned int MAX_CHECKPOINT_COUNT = 100000000;
+
+//---------------------------------------------------------------------------
+template <class T> static void
+PutValue( std::string &buf, const T &value )
+{
+	buf.append( (const char *)&value, sizeof(value) );
+}
+
+static void
+PutBytes( std::string &buf, const void *data, size_t len )
+{
+	PutValue( buf, (unsigned int)len );
+	buf.append( (const char *)data, len );
+}
+
+static void
+PutCondorID( std::string &buf, const CondorID &id )
+{
+	PutValue( buf, id._cluster );
+	PutValue( buf, id._proc );
+	PutValue( buf, id._subproc );
+}
+
+//---------------------------------------------------------------------------
+// Reads values from the checkpoint, checking that we don't run off the
+// end of the data; once a read fails, all subsequent reads fail.
+class CheckpointReader {
+public:
+	CheckpointReader( const std::string &buf ) : _buf( buf ), _pos( 0 ),
+				_ok( true ) {}
+
+	template <class T> bool Get( T &value ) {
+		if ( !_ok || _buf.size() - _pos < sizeof(value) ) {
+			return _ok = false;
+		}
+		memcpy( &value, _buf.data() + _pos, sizeof(value) );
+		_pos += sizeof(value);
+		return true;
+	}
+
+	bool GetCount( unsigned int &count ) {
+		if ( !Get( count ) || count > MAX_CHECKPOINT_COUNT ) {
+			return _ok = false;
+		}
+		return true;
+	}
+
+	bool GetString( std::string &str ) {
+		unsigned int len;
+		if ( !GetCount( len ) || _buf.size() - _pos < len ) {
+			return _ok = false;
+		}
+		str.assign( _buf, _pos, len );
+		_pos += len;
+		return true;
+	}
+
+	bool GetCondorID( CondorID &id ) {
+		return Get( id._cluster ) && Get( id._proc ) && Get( id._subproc );
+	}
+
+	bool Ok() const { return _ok; }
+	size_t Remaining() const { return _buf.size() - _pos; }
+
+private:
+	const std::string &_buf;
+	size_t _pos;
+	bool _ok;
+};
+
+//---------------------------------------------------------------------------
+unsigned int
+DagCheckpoint::Hash( const void *data, size_t len, unsigned int hash )
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for ( size_t i = 0; i < len; i++ ) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+//---------------------------------------------------------------------------
+bool
+DagCheckpoint::HashLogTail( const char *logFile, int64_t offset,
+			unsigned int &hash )
+{
+	int fd = safe_open_wrapper_follow( logFile, O_RDONLY );
+	if ( fd < 0 ) {
+		return false;
+	}
+
+	int64_t start = offset > CHECKPOINT_TAIL_SIZE ?
+				offset - CHECKPOINT_TAIL_SIZE : 0;
+	size_t len = (size_t)( offset - start );
+	char buf[CHECKPOINT_TAIL_SIZE];
+	bool result = false;
+	if ( lseek( fd, (off_t)start, SEEK_SET ) == (off_t)start &&
+				full_read( fd, buf, len ) == (ssize_t)len ) {
+		hash = Hash( buf, len );
+		result = true;
+	}
+
+	close( fd );
+	return result;
+}
+
+//---------------------------------------------------------------------------
+bool
+DagCheckpoint::Write( const char *filename, std::string &errMsg ) const
+{
+	std::string buf;
+	buf.append( CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC) );
+	PutValue( buf, CHECKPOINT_VERSION );
+
+	PutValue( buf, nodeNamesHash );
+	PutValue( buf, nextJobstateSeqNum );
+	PutValue( buf, fakeCondorID );
+	PutBytes( buf, logState.data(), logState.size() );
+	PutValue( buf, logOffset );
+	PutValue( buf, logTailHash );
+
+	PutValue( buf, (unsigned int)nodes.size() );
+	for ( const NodeRecord &node : nodes ) {
+		PutValue( buf, node.state.valid );
+		PutValue( buf, (int)node.state.status );
+		PutValue( buf, node.state.retries );
+		PutValue( buf, node.state.retval );
+		PutValue( buf, node.state.retValJob );
+		PutCondorID( buf, node.state.condorID );
+		PutValue( buf, node.jobstateSeqNum );
+		PutValue( buf, node.queuedProcs );
+		PutValue( buf, node.submittedProcs );
+		PutValue( buf, node.timesHeld );
+		PutValue( buf, node.procsOnHold );
+		PutValue( buf, node.isCluster );
+		PutBytes( buf, node.procEvents.data(), node.procEvents.size() );
+		PutBytes( buf, node.errorText.data(), node.errorText.size() );
+		PutValue( buf, (unsigned int)node.eventCounts.size() );
+		for ( const NodeRecord::ProcCounts &proc : node.eventCounts ) {
+			PutCondorID( buf, proc.id );
+			PutValue( buf, proc.counts );
+		}
+	}
+
+	PutValue( buf, Hash( buf.data(), buf.size() ) );
+
+		//
+		// Write to a temporary file, and then rename that to the
+		// "real" file, so that the "real" file is always complete.
+		//
+	std::string tmpFile( filename );
+	tmpFile += ".tmp";
+
+	DagmanUtils dagmanUtils;
+	dagmanUtils.tolerant_unlink( tmpFile.c_str() );
+	int fd = safe_open_wrapper_follow( tmpFile.c_str(),
+				O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if ( fd < 0 ) {
+		formatstr( errMsg, "can't open %s: %s", tmpFile.c_str(),
+					strerror( errno ) );
+		return false;
+	}
+
+	if ( full_write( fd, buf.data(), buf.size() ) != (ssize_t)buf.size() ||
+				condor_fsync( fd, tmpFile.c_str() ) != 0 ) {
+		formatstr( errMsg, "can't write %s: %s", tmpFile.c_str(),
+					strerror( errno ) );
+		close( fd );
+		dagmanUtils.tolerant_unlink( tmpFile.c_str() );
+		return false;
+	}
+	close( fd );
+
+		// Note:  we do tolerant_unlink because renaming over an
+		// existing file fails on Windows.
+	dagmanUtils.tolerant_unlink( filename );
+	if ( rename( tmpFile.c_str(), filename ) != 0 ) {
+		formatstr( errMsg, "can't rename %s to %s: %s", tmpFile.c_str(),
+					filename, strerror( errno ) );
+		dagmanUtils.tolerant_unlink( tmpFile.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+bool
+DagCheckpoint::Read( const char *filename, std::string &errMsg )
+{
+	std::string buf;
+	int fd = safe_open_wrapper_follow( filename, O_RDONLY );
+	if ( fd < 0 ) {
+		formatstr( errMsg, "can't open %s: %s", filename, strerror( errno ) );
+		return false;
+	}
+
+	char block[64 * 1024];
+	ssize_t len;
+	while ( (len = full_read( fd, block, sizeof(block) )) > 0 ) {
+		buf.append( block, len );
+	}
+	close( fd );
+	if ( len < 0 ) {
+		formatstr( errMsg, "can't read %s: %s", filename, strerror( errno ) );
+		return false;
+	}
+
+		// Check the magic string, the version and the hash of the
+		// whole file before we look at anything else.
+	unsigned int fileHash;
+	if ( buf.size() < sizeof(CHECKPOINT_MAGIC) + sizeof(int) +
+				sizeof(fileHash) ||
+				memcmp( buf.data(), CHECKPOINT_MAGIC,
+				sizeof(CHECKPOINT_MAGIC) ) != 0 ) {
+		formatstr( errMsg, "%s is not a DAG checkpoint", filename );
+		return false;
+	}
+	memcpy( &fileHash, buf.data() + buf.size() - sizeof(fileHash),
+				sizeof(fileHash) );
+	buf.resize( buf.size() - sizeof(fileHash) );
+	if ( Hash( buf.data(), buf.size() ) != fileHash ) {
+		formatstr( errMsg, "%s is corrupt", filename );
+		return false;
+	}
+
+	CheckpointReader reader( buf );
+	char magic[sizeof(CHECKPOINT_MAGIC)];
+	int version = 0;
+	reader.Get( magic );
+	reader.Get( version );
+	if ( version != CHECKPOINT_VERSION ) {
+		formatstr( errMsg, "%s has unsupported version %d", filename,
+					version );
+		return false;
+	}
+
+	unsigned int nodeCount = 0;
+	reader.Get( nodeNamesHash );
+	reader.Get( nextJobstateSeqNum );
+	reader.Get( fakeCondorID );
+	reader.GetString( logState );
+	reader.Get( logOffset );
+	reader.Get( logTailHash );
+	reader.GetCount( nodeCount );
+
+	nodes.clear();
+	while ( reader.Ok() && nodes.size() < nodeCount ) {
+		nodes.emplace_back();
+		NodeRecord &node = nodes.back();
+		int status = 0;
+		unsigned int procCount = 0;
+		std::string procEvents;
+		reader.Get( node.state.valid );
+		reader.Get( status );
+		reader.Get( node.state.retries );
+		reader.Get( node.state.retval );
+		reader.Get( node.state.retValJob );
+		reader.GetCondorID( node.state.condorID );
+		reader.Get( node.jobstateSeqNum );
+		reader.Get( node.queuedProcs );
+		reader.Get( node.submittedProcs );
+		reader.Get( node.timesHeld );
+		reader.Get( node.procsOnHold );
+		reader.Get( node.isCluster );
+		reader.GetString( procEvents );
+		reader.GetString( node.errorText );
+		reader.GetCount( procCount );
+		for ( unsigned int i = 0; reader.Ok() && i < procCount; i++ ) {
+			NodeRecord::ProcCounts proc;
+			reader.GetCondorID( proc.id );
+			reader.Get( proc.counts );
+			node.eventCounts.push_back( proc );
+		}
+
+		if ( status < Job::STATUS_NOT_READY || status > Job::STATUS_ERROR ) {
+			formatstr( errMsg, "%s has invalid node status %d", filename,
+						status );
+			return false;
+		}
+		node.state.status = (Job::status_t)status;
+		node.procEvents.assign( procEvents.begin(), procEvents.end() );
+	}
+
+	if ( !reader.Ok() || reader.Remaining() != 0 ) {
+		formatstr( errMsg, "%s is truncated or corrupt", filename );
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,124 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef _DAG_CHECKPOINT_H
+#define _DAG_CHECKPOINT_H
+
+// This class reads and writes the DAG checkpoint file (<dag file>.checkpoint).
+// The checkpoint holds the state of every node as of a given offset in the
+// default node log, so that recovery mode can restore that state and only
+// replay the events after that offset, instead of re-reading the whole log.
+// Dag::WriteCheckpoint() and Dag::RestoreCheckpoint() decide what goes in
+// the checkpoint and whether it still matches the DAG and the log.
+
+// Note: the checkpoint is a binary file in the native byte order; it is
+// only meant to be read by the DAGMan that wrote it (or by another
+// DAGMan for the same DAG on the same machine), and any checkpoint that
+// can't be read or doesn't match is ignored in favor of a full recovery.
+
+#include <string>
+#include <vector>
+#include "job.h"
+#include "check_events.h"
+
+class DagCheckpoint {
+public:
+		// The state of one node, in the order of Dag::_jobs.
+	struct NodeRecord {
+		Job::LoggedState state;
+		int jobstateSeqNum;
+		int queuedProcs;
+		int submittedProcs;
+		int timesHeld;
+		int procsOnHold;
+		bool isCluster;
+		std::vector<unsigned char> procEvents;
+		std::string errorText;
+
+			// Event checking counts for the node's job procs.
+		struct ProcCounts {
+			CondorID id;
+			CheckEvents::EventCounts counts;
+		};
+		std::vector<ProcCounts> eventCounts;
+
+		NodeRecord() : jobstateSeqNum(0), queuedProcs(0), submittedProcs(0),
+					timesHeld(0), procsOnHold(0), isCluster(false) {}
+	};
+
+	DagCheckpoint() : nodeNamesHash(0), nextJobstateSeqNum(0),
+				fakeCondorID(0), logOffset(0), logTailHash(0) {}
+
+		// Hash of the names of the nodes, in order, so we can tell
+		// whether the checkpoint was written for the same DAG.
+	unsigned int nodeNamesHash;
+	int nextJobstateSeqNum;
+	int fakeCondorID;
+
+		// The raw ReadUserLog::FileState of the default node log.
+	std::string logState;
+		// The offset of the log reader in the log, and the hash of the
+		// (up to) CHECKPOINT_TAIL_SIZE bytes of the log before it.
+	int64_t logOffset;
+	unsigned int logTailHash;
+
+	std::vector<NodeRecord> nodes;
+
+	/** Write the checkpoint; the file is written to a temporary file
+		that is then renamed, so the checkpoint is always complete.
+		@param The checkpoint file.
+		@param A string to hold the error message if we fail.
+		@return true if successful, false otherwise.
+	*/
+	bool Write( const char *filename, std::string &errMsg ) const;
+
+	/** Read a checkpoint.
+		@param The checkpoint file.
+		@param A string to hold the error message if we fail.
+		@return true if successful, false otherwise (including if
+			the file doesn't exist).
+	*/
+	bool Read( const char *filename, std::string &errMsg );
+
+	/** Hash a buffer (FNV-1a).
+		@param The data.
+		@param The length of the data.
+		@param The hash to continue from.
+		@return The hash.
+	*/
+	static unsigned int Hash( const void *data, size_t len,
+				unsigned int hash = HASH_BASIS );
+
+	/** Hash the (up to) CHECKPOINT_TAIL_SIZE bytes of a log file before
+		the given offset.
+		@param The log file.
+		@param The offset.
+		@param The hash (set only if we return true).
+		@return true if successful, false otherwise (including if
+			the log file is shorter than the offset).
+	*/
+	static bool HashLogTail( const char *logFile, int64_t offset,
+				unsigned int &hash );
+
+	static const unsigned int HASH_BASIS = 2166136261u;
+	static const int CHECKPOINT_TAIL_SIZE = 4096;
+};
+
+#endif /* #ifndef _DAG_CHECKPOINT_H */
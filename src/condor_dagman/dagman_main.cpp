@@ -117,6 +117,7 @@ Dagman::Dagman() :
 	submit_delay (0),
 	max_submit_attempts (6),
 	max_submits_per_interval (MAX_SUBMITS_PER_INT_DEFAULT), // so Coverity is happy
+	submit_batch_size (100),
 	aggressive_submit (false),
 	m_user_log_scan_interval (LOG_SCAN_INT_DEFAULT),
 	schedd_update_interval (SCHEDD_UPDATE_INTERVAL_DEFAULT),
@@ -146,6 +147,7 @@ Dagman::Dagman() :
 	_runPost(false),
 	_priority(0), // from config or command line
 	_claim_hold_time(20),
+	_checkpointInterval(300),
 	_doRecovery(false),
 	_suppressJobLogs(false),
 	_batchName(""),
@@ -240,6 +242,12 @@ Dagman::Config()
 	debug_printf( DEBUG_NORMAL, "DAGMAN_MAX_SUBMITS_PER_INTERVAL setting: %d\n",
 				max_submits_per_interval );
 
+	submit_batch_size =
+		param_integer( "DAGMAN_SUBMIT_BATCH_SIZE", submit_batch_size, 0,
+		1000 );
+	debug_printf( DEBUG_NORMAL, "DAGMAN_SUBMIT_BATCH_SIZE setting: %d\n",
+				submit_batch_size );
+
 	aggressive_submit =
 		param_boolean( "DAGMAN_AGGRESSIVE_SUBMIT", aggressive_submit );
 	debug_printf( DEBUG_NORMAL, "DAGMAN_AGGRESSIVE_SUBMIT setting: %s\n",
@@ -446,6 +454,11 @@ Dagman::Config()
 	debug_printf( DEBUG_NORMAL, "DAGMAN_HOLD_CLAIM_TIME setting: %d\n",
 				_claim_hold_time );
 
+	_checkpointInterval = param_integer( "DAGMAN_CHECKPOINT_INTERVAL",
+				_checkpointInterval, 0, INT_MAX );
+	debug_printf( DEBUG_NORMAL, "DAGMAN_CHECKPOINT_INTERVAL setting: %d\n",
+				_checkpointInterval );
+
 	char *debugSetting = param( "ALL_DEBUG" );
 	debug_printf( DEBUG_NORMAL, "ALL_DEBUG setting: %s\n",
 				debugSetting ? debugSetting : "" );
@@ -525,6 +538,7 @@ main_shutdown_fast()
 void main_shutdown_graceful() {
 	print_status( true );
 	dagman.dag->DumpNodeStatus( true, false );
+	dagman.dag->WriteCheckpoint( true );
 	dagman.dag->GetJobstateLog().WriteDagmanFinished( EXIT_RESTART );
 	// Don't report metrics here because we should restart.
 	dagman.CleanUp();
@@ -605,6 +619,7 @@ void main_shutdown_rescue( int exitVal, DagStatus dagStatus,
 	}
 	if (dagman.dag) dagman.dag->ReportMetrics( exitVal );
 	dagman.PublishStats();
+	if (dagman.dag) dagman.dag->RemoveCheckpoint();
 	dagmanUtils.tolerant_unlink( lockFileName.c_str() ); 
 	dagman.CleanUp();
 	inShutdownRescue = false;
@@ -629,6 +644,7 @@ void ExitSuccess() {
 	dagman.dag->GetJobstateLog().WriteDagmanFinished( EXIT_OKAY );
 	dagman.dag->ReportMetrics( EXIT_OKAY );
 	dagman.PublishStats();
+	dagman.dag->RemoveCheckpoint();
 	dagmanUtils.tolerant_unlink( lockFileName.c_str() ); 
 	dagman.CleanUp();
 	DC_Exit( EXIT_OKAY );
@@ -1231,6 +1247,8 @@ void main_init (int argc, char ** const argv) {
 	dagman.dag->SetMaxJobHolds( dagman._maxJobHolds );
 	dagman.dag->SetPostRun(dagman._runPost);
 	dagman.dag->SetDryRun(dash_dry_run);
+	dagman.dag->SetCheckpointFile( ( std::string( dagman.primaryDagFile.Value() )
+				+ ".checkpoint" ).c_str(), dagman._checkpointInterval );
 	if( dagman._priority != 0 ) {
 		dagman.dag->SetDagPriority(dagman._priority);
 	}
@@ -1731,6 +1749,12 @@ void condor_event_timer () {
 	justSubmitted = dagman.dag->SubmitReadyJobs(dagman);
 	submitCycleEndTime = condor_gettimestamp_double();
 	dagman._dagmanStats.SubmitCycleTime.Add(submitCycleEndTime - submitCycleStartTime);
+	if ( justSubmitted > 0 && submitCycleEndTime > submitCycleStartTime ) {
+		dagman._dagmanStats.SubmitRate.Add( justSubmitted /
+					(submitCycleEndTime - submitCycleStartTime) );
+		dagman._dagmanStats.BatchedSubmits.Add(
+					dagman.dag->NumBatchedSubmitsLastCycle() );
+	}
 	debug_printf( DEBUG_DEBUG_1, "Finished submit cycle\n" );
 	if( justSubmitted ) {
 			// Note: it would be nice to also have the proc submit
@@ -1789,6 +1813,7 @@ void condor_event_timer () {
 	}
 
 	dagman.dag->DumpNodeStatus( false, false );
+	dagman.dag->WriteCheckpoint( false );
 
 	ASSERT( dagman.dag->NumNodesDone( true ) + dagman.dag->NumNodesFailed()
 			<= dagman.dag->NumNodes( true ) );
@@ -96,6 +96,10 @@ class Dagman {
 		// maximum number of jobs to submit in a single periodic timer
 		// interval
 	int max_submits_per_interval;
+		// maximum number of nodes to submit in a single schedd
+		// transaction with direct submission (0 or 1 means submit
+		// each node in its own transaction)
+	int submit_batch_size;
 		// In "aggressive submit" mode, DAGMan overrides the timer interval
 		// which DaemonCore fires every m_user_log_scan_interval seconds. 
 		// The submit cycle will continue submitting jobs until there are no 
@@ -247,6 +251,10 @@ class Dagman {
 
 	int _claim_hold_time;
 
+		// Minimum time between writes of the DAG checkpoint file
+		// (0 means no checkpoint is written).
+	int _checkpointInterval;
+
 		// True iff -DoRecov is specified on the command line.
 	bool _doRecovery;
 
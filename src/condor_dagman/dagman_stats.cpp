@@ -31,6 +31,8 @@ void DagmanStats::Init() {
     Pool.AddProbe("LogProcessCycleTime", &LogProcessCycleTime, "LogProcessCycleTime", IS_CLS_PROBE);
     Pool.AddProbe("SleepCycleTime", &SleepCycleTime, "SleepCycleTime", IS_CLS_PROBE);
     Pool.AddProbe("SubmitCycleTime", &SubmitCycleTime, "SubmitCycleTime", IS_CLS_PROBE);
+    Pool.AddProbe("SubmitRate", &SubmitRate, "SubmitRate", IS_CLS_PROBE);
+    Pool.AddProbe("BatchedSubmits", &BatchedSubmits, "BatchedSubmits", IS_CLS_PROBE);
 }
 
 void DagmanStats::Publish(ClassAd &ad) const {
@@ -35,6 +35,12 @@
 		stats_entry_probe<double> LogProcessCycleTime;
 		stats_entry_probe<double> SleepCycleTime;
 		stats_entry_probe<double> SubmitCycleTime;
+			// Nodes submitted per second, for submit cycles that
+			// submitted any nodes.
+		stats_entry_probe<double> SubmitRate;
+			// Nodes submitted in batches, for submit cycles that
+			// submitted any nodes.
+		stats_entry_probe<double> BatchedSubmits;
 
 		StatisticsPool Pool;
 
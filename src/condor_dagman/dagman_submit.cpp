@@ -573,6 +573,149 @@ static void init_dag_vars(SubmitHash * submitHash,
 
 }
 
+//-------------------------------------------------------------------------
+// Open and parse a node's submit file up to its queue statement.
+// Returns 0 on success.
+static int
+parse_node_submit_file(Job* node, SubmitHash * submitHash,
+	MacroStreamFile & ms, std::string & queue_args, std::string & errmsg)
+{
+	const char* cmdFile = node->GetCmdFile();
+	char * qline = NULL;
+
+	// Start by populating the hash with some parameters
+	submitHash->init();
+	submitHash->setDisableFileChecks(true);
+	submitHash->setScheddVersion(CondorVersion());
+	// if (myproxy_password) submitHash.setMyProxyPassword(myproxy_password);
+
+	// open the submit file
+	if (! ms.open(cmdFile, false, submitHash->macros(), errmsg)) {
+		debug_printf(DEBUG_QUIET, "ERROR: submit attempt failed, errno=%d %s\n", errno, strerror(errno));
+		debug_printf(DEBUG_QUIET, "could not open submit file : %s - %s\n", cmdFile, errmsg.c_str());
+		return -1;
+	}
+
+	// set submit filename into the submit hash so that $(SUBMIT_FILE) works
+	submitHash->insert_submit_filename(cmdFile, ms.source());
+
+	// read the submit file until we get to the queue statement or end of file
+	int rval = submitHash->parse_up_to_q_line(ms, errmsg, &qline);
+	if (rval) {
+		return rval;
+	}
+
+	const char * args = NULL;
+	if (qline) {
+		args = submitHash->is_queue_statement(qline);
+	}
+	if ( ! args) {
+		// submit file had no queue statement
+		errmsg = "no QUEUE statement";
+		return -1;
+	}
+	queue_args = args;
+
+	return 0;
+}
+
+//-------------------------------------------------------------------------
+// Queue a node's job procs as a new cluster over the current schedd
+// connection (i.e., as part of its transaction).  hasItems is set to
+// whether the queue statement iterated over items.
+// Returns < 0 on error.
+static int
+queue_node_jobs(SubmitHash * submitHash, MacroStreamFile & ms,
+	const char * queue_args, CondorID & condorID, std::string & errmsg,
+	bool & hasItems)
+{
+	int cluster_id = NewCluster();
+	if (cluster_id <= 0) {
+		errmsg = "failed to get a ClusterId";
+		return cluster_id < 0 ? cluster_id : -1;
+	}
+
+	int proc_id = 0, item_index = 0, step = 0;
+
+	SubmitStepFromQArgs ssi(*submitHash);
+	JOB_ID_KEY jid(cluster_id, proc_id);
+	int rval = ssi.begin(jid, queue_args);
+	if (rval < 0) {
+		return rval;
+	}
+
+	rval = ssi.load_items(ms, false, errmsg);
+	if (rval < 0) {
+		return rval;
+	}
+	hasItems = ssi.has_items();
+
+	while ((rval = ssi.next(jid, item_index, step)) > 0) {
+		proc_id = NewProc(cluster_id);
+		if (proc_id != jid.proc) {
+			formatstr(errmsg, "expected next ProcId to be %d, but Schedd says %d", jid.proc, proc_id);
+			return -1;
+		}
+
+		ClassAd *proc_ad = submitHash->make_job_ad(jid, item_index, step, false, false, NULL, NULL);
+		if ( ! proc_ad) {
+			errmsg = "failed to create job classad";
+			return -1;
+		}
+
+		if (rval == 2) { // we need to send the cluster ad
+			classad::ClassAd * clusterad = proc_ad->GetChainedParentAd();
+			if (clusterad) {
+				rval = SendJobAttributes(JOB_ID_KEY(cluster_id, -1), *clusterad, SetAttribute_NoAck, submitHash->error_stack(), "Submit");
+				if (rval < 0) {
+					errmsg = "failed to send cluster classad";
+					return rval;
+				}
+			}
+			condorID._cluster = jid.cluster;
+			condorID._proc = jid.proc;
+			condorID._subproc = 0;
+		}
+
+		rval = SendJobAttributes(jid, *proc_ad, SetAttribute_NoAck, submitHash->error_stack(), "Submit");
+		if (rval < 0) {
+			errmsg = "failed to send proc ad";
+			return rval;
+		}
+	}
+
+	return rval;
+}
+
+//-------------------------------------------------------------------------
+// Log the errors (if rval < 0) or warnings from submitting a node.
+static void
+report_submit_errors(SubmitHash * submitHash, MacroStreamFile & ms,
+	int rval, const std::string & errmsg)
+{
+	if (rval < 0) {
+		debug_printf(DEBUG_QUIET, "ERROR: on Line %d of submit file: %s\n", ms.source().line, errmsg.c_str());
+		if (submitHash->error_stack()) {
+			std::string errstk(submitHash->error_stack()->getFullText());
+			if (! errstk.empty()) {
+				debug_printf(DEBUG_QUIET, "submit error: %s", errstk.c_str());
+			}
+			submitHash->error_stack()->clear();
+		}
+	}
+	else {
+		// If submit succeeded, we still need to log any warning messages
+		if (submitHash->error_stack()) {
+			submitHash->warn_unused(stderr, "DAGMAN");
+			std::string errstk(submitHash->error_stack()->getFullText());
+			if (!errstk.empty()) {
+				debug_printf(DEBUG_QUIET, "Submit warning: %s", errstk.c_str());
+			}
+			submitHash->error_stack()->clear();
+		}
+	}
+}
+
 //-------------------------------------------------------------------------
 bool
 direct_condor_submit(const Dagman &dm, Job* node,
@@ -582,8 +725,6 @@ direct_condor_submit(const Dagman &dm, Job* node,
 	const char *batchId,
 	CondorID& condorID)
 {
-	const char* cmdFile = node->GetCmdFile();
-
 	// Setup a SubmitHash object
 	// If this was defined inline in the dag file, it's already been parsed, set the pointer
 	// Otherwise we'll initialize and parse it in from the submit file later
@@ -600,48 +741,21 @@ direct_condor_submit(const Dagman &dm, Job* node,
 	}
 	int rval = 0;
 	bool success = false;
+	bool hasItems = false;
 	std::string errmsg;
 	Qmgr_connection * qmgr = NULL;
 	auto_free_ptr owner(my_username());
-	char * qline = NULL;
-	const char * queue_args = NULL;
+	std::string queue_args;
 	MacroStreamFile ms;
 
 	// If the submitDesc hash is not set, we need to parse it from the file
 	if (!node->GetSubmitDesc()) {
 		debug_printf(DEBUG_NORMAL, "Submitting node %s from file %s using direct job submission\n", node->GetJobName(), node->GetCmdFile());
 		submitHash = new SubmitHash();
-		// Start by populating the hash with some parameters
-		submitHash->init();
-		submitHash->setDisableFileChecks(true);
-		submitHash->setScheddVersion(CondorVersion());
-		// if (myproxy_password) submitHash.setMyProxyPassword(myproxy_password);
-
-		// open the submit file
-		if (! ms.open(cmdFile, false, submitHash->macros(), errmsg)) {
-			debug_printf(DEBUG_QUIET, "ERROR: submit attempt failed, errno=%d %s\n", errno, strerror(errno));
-			debug_printf(DEBUG_QUIET, "could not open submit file : %s - %s\n", cmdFile, errmsg.c_str());
-			goto finis;
-		}
-
-		// set submit filename into the submit hash so that $(SUBMIT_FILE) works
-		submitHash->insert_submit_filename(cmdFile, ms.source());
-
-		// read the submit file until we get to the queue statement or end of file
-		rval = submitHash->parse_up_to_q_line(ms, errmsg, &qline);
+		rval = parse_node_submit_file(node, submitHash, ms, queue_args, errmsg);
 		if (rval) {
 			goto finis;
 		}
-
-		if (qline) {
-			queue_args = submitHash->is_queue_statement(qline);
-		}
-		if ( ! queue_args) {
-			// submit file had no queue statement
-			errmsg = "no QUEUE statement";
-			rval = -1;
-			goto finis;
-		}
 	}
 	else {
 		debug_printf(DEBUG_NORMAL, "Submitting node %s from inline description using direct job submission\n", node->GetJobName());
@@ -655,62 +769,12 @@ direct_condor_submit(const Dagman &dm, Job* node,
 
 	qmgr = ConnectQ(NULL);
 	if (qmgr) {
-		int cluster_id = NewCluster();
-		if (cluster_id <= 0) {
-			errmsg = "failed to get a ClusterId";
-			rval = cluster_id;
-			goto finis;
-		}
-
-		int proc_id = 0, item_index = 0, step = 0;
-
-		SubmitStepFromQArgs ssi(*submitHash);
-		JOB_ID_KEY jid(cluster_id, proc_id);
-		rval = ssi.begin(jid, queue_args);
+		rval = queue_node_jobs(submitHash, ms,
+			node->GetSubmitDesc() ? NULL : queue_args.c_str(),
+			condorID, errmsg, hasItems);
 		if (rval < 0) {
 			goto finis;
 		}
-
-		rval = ssi.load_items(ms, false, errmsg);
-		if (rval < 0) {
-			goto finis;
-		}
-
-		while ((rval = ssi.next(jid, item_index, step)) > 0) {
-			proc_id = NewProc(cluster_id);
-			if (proc_id != jid.proc) {
-				formatstr(errmsg, "expected next ProcId to be %d, but Schedd says %d", jid.proc, proc_id);
-				rval = -1;
-				goto finis;
-			}
-
-			ClassAd *proc_ad = submitHash->make_job_ad(jid, item_index, step, false, false, NULL, NULL);
-			if ( ! proc_ad) {
-				errmsg = "failed to create job classad";
-				rval = -1;
-				goto finis;
-			}
-
-			if (rval == 2) { // we need to send the cluster ad
-				classad::ClassAd * clusterad = proc_ad->GetChainedParentAd();
-				if (clusterad) {
-					rval = SendJobAttributes(JOB_ID_KEY(cluster_id, -1), *clusterad, SetAttribute_NoAck, submitHash->error_stack(), "Submit");
-					if (rval < 0) {
-						errmsg = "failed to send cluster classad";
-						goto finis;
-					}
-				}
-				condorID._cluster = jid.cluster;
-				condorID._proc = jid.proc;
-				condorID._subproc = 0;
-			}
-
-			rval = SendJobAttributes(jid, *proc_ad, SetAttribute_NoAck, submitHash->error_stack(), "Submit");
-			if (rval < 0) {
-				errmsg = "failed to send proc ad";
-				goto finis;
-			}
-		}
 		// commit transaction and disconnect queue
 		CondorError errstack;
 		success = DisconnectQ(qmgr, true, &errstack); qmgr = NULL;
@@ -730,27 +794,7 @@ finis:
 	}
 	// report errors from submit
 	//
-	if (rval < 0) {
-		debug_printf(DEBUG_QUIET, "ERROR: on Line %d of submit file: %s\n", ms.source().line, errmsg.c_str());
-		if (submitHash->error_stack()) {
-			std::string errstk(submitHash->error_stack()->getFullText());
-			if (! errstk.empty()) {
-				debug_printf(DEBUG_QUIET, "submit error: %s", errstk.c_str());
-			}
-			submitHash->error_stack()->clear();
-		}
-	}
-	else {
-		// If submit succeeded, we still need to log any warning messages
-		if (submitHash->error_stack()) {
-			submitHash->warn_unused(stderr, "DAGMAN");
-			std::string errstk(submitHash->error_stack()->getFullText());
-			if (!errstk.empty()) {
-				debug_printf(DEBUG_QUIET, "Submit warning: %s", errstk.c_str());
-			}
-			submitHash->error_stack()->clear();
-		}
-	}
+	report_submit_errors(submitHash, ms, rval, errmsg);
 
 	if (!tmpDir.Cd2MainDir(errMsg)) {
 		debug_printf(DEBUG_QUIET,
@@ -762,6 +806,139 @@ finis:
 	return success;
 }
 
+//-------------------------------------------------------------------------
+// The settings that decide which submit keywords init_dag_vars() sets for
+// a node; a parsed submit file can only be reused for the next node if
+// they are the same, otherwise keywords set for the previous node (e.g.,
+// a VARS value or hold) would leak into this one.
+static std::string
+submit_reuse_key(const Dagman &dm, Job* node, const std::string & parents)
+{
+	std::string key;
+	formatstr(key, "%s\n%s\n%d%d%d%d", node->GetCmdFile(), node->GetDirectory(),
+		node->_effectivePriority != 0, node->GetHold(),
+		( ! node->NoChildren()) && dm._claim_hold_time > 0, ! parents.empty());
+	for (auto it = node->varsFromDag.begin(); it != node->varsFromDag.end(); ++it) {
+		key += '\n';
+		key += it->_name;
+	}
+	return key;
+}
+
+//-------------------------------------------------------------------------
+bool
+direct_condor_submit_batch(const Dagman &dm,
+	const std::vector<Job*> & nodes,
+	const char *workflowLogFile,
+	const std::vector<std::string> & parents,
+	const char *batchName,
+	const char *batchId,
+	std::vector<CondorID> & condorIDs)
+{
+	ASSERT(nodes.size() == parents.size());
+	condorIDs.assign(nodes.size(), CondorID());
+
+	Qmgr_connection * qmgr = ConnectQ(NULL);
+	if ( ! qmgr) {
+		debug_printf(DEBUG_QUIET, "ERROR: could not connect to the schedd to submit %d nodes\n",
+			(int)nodes.size());
+		return false;
+	}
+
+	int rval = 0;
+	std::string errmsg;
+	auto_free_ptr owner(my_username());
+
+	// The most recently parsed submit file, which consecutive nodes
+	// with the same submit_reuse_key() submit from without parsing
+	// it again.
+	std::unique_ptr<SubmitHash> parsedHash;
+	std::unique_ptr<MacroStreamFile> parsedMs;
+	std::string parsedKey;
+	std::string parsedQueueArgs;
+	bool parsedReusable = false;
+
+	for (size_t ix = 0; ix < nodes.size() && rval >= 0; ++ix) {
+		Job* node = nodes[ix];
+
+		TmpDir		tmpDir;
+		MyString	errMsg;
+		const char* directory = node->GetDirectory();
+		if (!tmpDir.Cd2TmpDir(directory, errMsg)) {
+			debug_printf(DEBUG_QUIET,
+				"Could not change to node directory %s: %s\n",
+				directory, errMsg.Value());
+			rval = -1;
+			break;
+		}
+
+		SubmitHash* submitHash = node->GetSubmitDesc();
+		MacroStreamFile inlineMs;
+		MacroStreamFile* ms = &inlineMs;
+		const char* queue_args = NULL;
+		if ( ! submitHash) {
+			std::string key = submit_reuse_key(dm, node, parents[ix]);
+			if (parsedReusable && key == parsedKey) {
+				debug_printf(DEBUG_NORMAL, "Submitting node %s from file %s using direct job submission (reusing parsed submit file)\n", node->GetJobName(), node->GetCmdFile());
+				parsedHash->reset();
+			} else {
+				debug_printf(DEBUG_NORMAL, "Submitting node %s from file %s using direct job submission\n", node->GetJobName(), node->GetCmdFile());
+				parsedMs.reset(new MacroStreamFile());
+				parsedHash.reset(new SubmitHash());
+				parsedKey = key;
+				parsedReusable = false;
+				rval = parse_node_submit_file(node, parsedHash.get(), *parsedMs, parsedQueueArgs, errmsg);
+				if (rval > 0) { rval = -rval; }
+			}
+			submitHash = parsedHash.get();
+			ms = parsedMs.get();
+			queue_args = parsedQueueArgs.c_str();
+		} else {
+			debug_printf(DEBUG_NORMAL, "Submitting node %s from inline description using direct job submission\n", node->GetJobName());
+		}
+
+		if (rval >= 0) {
+			// set submit keywords defined by dagman and VARS
+			init_dag_vars(submitHash, dm, node, workflowLogFile, MyString(parents[ix]), batchName, batchId);
+
+			submitHash->init_base_ad(time(NULL), owner);
+
+			bool hasItems = true;
+			rval = queue_node_jobs(submitHash, *ms, queue_args, condorIDs[ix], errmsg, hasItems);
+			if (submitHash == parsedHash.get()) {
+				// Items are read from the submit file after the queue
+				// statement, so only a file without them can be reused.
+				parsedReusable = ! hasItems;
+			}
+		}
+
+		report_submit_errors(submitHash, *ms, rval, errmsg);
+
+		if (!tmpDir.Cd2MainDir(errMsg)) {
+			debug_printf(DEBUG_QUIET,
+				"Could not change to original directory: %s\n",
+				errMsg.Value());
+			rval = -1;
+		}
+	}
+
+	if (rval < 0) {
+		// abort the transaction, so none of the nodes are submitted.
+		DisconnectQ(qmgr, false);
+		return false;
+	}
+
+	// commit transaction and disconnect queue
+	CondorError errstack;
+	bool success = DisconnectQ(qmgr, true, &errstack);
+	if (!success) {
+		debug_printf(DEBUG_NORMAL, "Failed to submit batch of %d nodes: %s\n",
+			(int)nodes.size(), errstack.getFullText().c_str());
+	}
+
+	return success;
+}
+
 bool send_reschedule(const Dagman & /*dm*/)
 {
 	if (param_boolean("DAGMAN_USE_CONDOR_SUBMIT", true))
@@ -22,6 +22,8 @@
 #define DAGMAN_SUBMIT_H
 
 #include "condor_id.h"
+#include <string>
+#include <vector>
 
 /** Submits a job to condor using popen().  This is a very primitive method
     to submitting a job, and SHOULD be replacable by a HTCondor Submit API.
@@ -69,6 +71,29 @@ bool direct_condor_submit(const Dagman &dm, Job* node,
 	const char *batchId,
 	CondorID& condorID);
 
+/** Submits the jobs of several nodes directly to the schedd over a single
+	connection and a single transaction; each node is still its own cluster.
+	Consecutive nodes with the same submit file (and the same set of VARS)
+	share one parse of that file.  If submitting any node fails, the
+	transaction is aborted, so either all of the nodes are submitted or
+	none of them are.
+	@param dm the appropriate Dagman object
+	@param nodes the nodes to submit
+	@param workflowLogFile the default log file name
+	@param parents the parent node names of each node (same order as nodes)
+	@param batchName the batch name to use for the jobs
+	@param batchId the batch ID to use for the jobs
+	@param condorIDs will hold the ID for each node's job (if successful)
+	@return true on success, false on failure
+*/
+bool direct_condor_submit_batch(const Dagman &dm,
+	const std::vector<Job*> &nodes,
+	const char *workflowLogFile,
+	const std::vector<std::string> &parents,
+	const char *batchName,
+	const char *batchId,
+	std::vector<CondorID> &condorIDs);
+
 bool send_reschedule(const Dagman &dm);
 
 void set_fake_condorID( int subprocID );
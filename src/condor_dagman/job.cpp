@@ -1478,6 +1478,22 @@ Job::GetJobstateJobTag()
 	return _jobTag;
 }
 
+//---------------------------------------------------------------------------
+void
+Job::SaveLoggedState()
+{
+	_loggedState.valid = true;
+		// Recovery mode re-runs PRE scripts that were running (they
+		// aren't logged), so a node whose PRE script is running is
+		// just ready as far as the log is concerned.
+	_loggedState.status = ( _Status == STATUS_PRERUN ) ? STATUS_READY :
+				_Status;
+	_loggedState.retries = retries;
+	_loggedState.retval = retval;
+	_loggedState.retValJob = _scriptPost ? _scriptPost->_retValJob : -1;
+	_loggedState.condorID = _CondorID;
+}
+
 //---------------------------------------------------------------------------
 int
 Job::GetJobstateSequenceNum()
@@ -352,6 +352,37 @@ class Job {
 	*/
 	void SetProcEvent( int proc, int event );
 
+	/** Get/set the events we've gotten for each proc (see _gotEvents);
+		used to checkpoint and restore the node.
+	*/
+	const std::vector<unsigned char> & GetProcEvents() const
+		{ return _gotEvents; }
+	void SetProcEvents( const std::vector<unsigned char> &events )
+		{ _gotEvents = events; }
+
+	/** The part of the node's state that can change without anything
+		being written to the log (e.g., when a PRE script runs or a job is
+		submitted), as it was right after the last log event for this
+		node was processed.  This is what recovery mode would rebuild
+		from the log, so it is what the DAG checkpoint saves.
+	*/
+	struct LoggedState {
+		bool valid; // false if no event has been processed for this node
+		status_t status;
+		int retries;
+		int retval;
+		int retValJob; // only meaningful if the node has a POST script
+		CondorID condorID;
+		LoggedState() : valid(false), status(STATUS_READY), retries(0),
+					retval(0), retValJob(-1) {}
+	};
+
+	/** Save the current state as the logged state; call this after
+		processing a log event for this node.
+	*/
+	void SaveLoggedState();
+	const LoggedState & GetLoggedState() const { return _loggedState; }
+
 		/** Is the specified node a child of this node?
 			@param child Pointer to the node to check for childhood.
 			@return true: specified node is our child, false: otherwise
@@ -494,12 +525,23 @@ class Job {
 	*/
 	void ResetJobstateSequenceNum() { _jobstateSeqNum = 0; }
 
+	/** Set the jobstate.log sequence number for this node (when
+		restoring it from a checkpoint).
+	*/
+	void SetJobstateSequenceNum( int seqNum ) { _jobstateSeqNum = seqNum; }
+
+	/** Get the jobstate.log sequence number for this node without
+		assigning one (0 if none has been assigned).
+	*/
+	int PeekJobstateSequenceNum() const { return _jobstateSeqNum; }
+
 	/** Set the master jobstate.log sequence number.
 		@param The next sequence number that should be given out.
 	*/
 	static void SetJobstateNextSequenceNum( int nextSeqNum ) {
 		_nextJobstateSeqNum = nextSeqNum;
 	}
+	static int GetJobstateNextSequenceNum() { return _nextJobstateSeqNum; }
 
 	/** Set the last event time for this job to be the time of the given
 		event (this is used as the time for jobstate.log pseudo-events like
@@ -747,6 +789,9 @@ private:
 		// The time of the most recent event related to this job.
 	time_t _lastEventTime;
 
+		// See SaveLoggedState().
+	LoggedState _loggedState;
+
 		// This node's category; points to an object "owned" by the
 		// ThrottleByCategory object.
 	ThrottleByCategory::ThrottleInfo *_throttleInfo;
@@ -48,6 +48,7 @@ public:
 	void alloc_buf();
 	void dealloc_buf();
 	void grow_buf(int new_sz);
+	void shrink_buf(int new_sz);
 
 	inline int max_size() const { return _dta_maxsz; }
 	inline int num_untouched() const { return _dta_sz - _dta_pt; }
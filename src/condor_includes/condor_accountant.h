@@ -118,6 +118,9 @@ private:
   
   void RemoveMatch(const std::string& ResourceName, time_t T);
 
+  void CheckAcctLogSize(); // truncate the log if it has grown too large
+  void AcctLogTruncated(); // allow the log to grow after a truncation
+
   void LoadLimits(ClassAdListDoesNotDeleteAds &resourceList);
   void ClearLimits();
   void DumpLimits();
@@ -143,6 +146,7 @@ private:
   float HalfLifePeriod;     // The time in sec in which the priority is halved by aging
   std::string LogFileName;      // Name of Log file
   int	MaxAcctLogSize;		// Max size of log file
+  bool  BackgroundLogRotation; // truncate the log in the background
   bool  DiscountSuspendedResources;
   bool  UseSlotWeights; 
 
@@ -50,6 +50,7 @@
 #define GATEWAY_ADTYPE			"Gateway"
 #define CLUSTER_ADTYPE	 		"Cluster"
 #define GRID_ADTYPE			"Grid"
+#define CHANGE_FEED_ADTYPE		"ChangeFeed"
 #define BOGUS_ADTYPE		"Bogus"
 
 // Enumerated list of ad types (for the query object)
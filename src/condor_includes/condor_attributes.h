@@ -88,6 +88,13 @@
 #define ATTR_CKPT_OPSYS  "CkptOpSys"
 #define ATTR_PAIRED_CLAIM_ID  "PairedClaimId"
 #define ATTR_CHECKPOINT_SIG  "CheckpointSig"
+#define ATTR_CHANGE_FEED_AD_SEQUENCE  "ChangeFeedAdSequence"
+#define ATTR_CHANGE_FEED_EPOCH  "ChangeFeedEpoch"
+#define ATTR_CHANGE_FEED_REMOVED  "ChangeFeedRemoved"
+#define ATTR_CHANGE_FEED_REPLY  "ChangeFeedReply"
+#define ATTR_CHANGE_FEED_RESET  "ChangeFeedReset"
+#define ATTR_CHANGE_FEED_SEQUENCE  "ChangeFeedSequence"
+#define ATTR_CHANGE_FEED_SINCE  "ChangeFeedSince"
 #define ATTR_CHILD_CLAIM_IDS "ChildClaimIds"
 #define ATTR_CLAIM_ID  "ClaimId"
 #define ATTR_CLAIM_IDS  "ClaimIds"
@@ -163,6 +170,8 @@
 #define ATTR_DAGMAN_MAXPOSTSCRIPTS "DAGMan_MaxPostScripts"
 #define ATTR_DAGMAN_MAXHOLDSCRIPTS "DAGMan_MaxHoldScripts"
 #define ATTR_DEFERRAL_OFFSET  "DeferralOffset"
+#define ATTR_DELTA_BASE_SEQUENCE_NUMBER  "DeltaBaseSequenceNumber"
+#define ATTR_DELTA_REMOVED_ATTRIBUTES  "DeltaRemovedAttributes"
 #define ATTR_DEFERRAL_PREP_TIME  "DeferralPrepTime"
 #define ATTR_DEFERRAL_TIME  "DeferralTime"
 #define ATTR_DEFERRAL_WINDOW  "DeferralWindow"
@@ -277,6 +286,7 @@
 #define ATTR_HAS_RECONNECT  "HasReconnect"
 #define ATTR_HAS_REMOTE_SYSCALLS  "HasRemoteSyscalls"
 #define ATTR_HAS_SELF_CHECKPOINT_TRANSFERS "HasSelfCheckpointTransfers"
+#define ATTR_HAS_SHADOW_MULTIPLEX  "HasShadowMultiplex"
 #define ATTR_HAS_SINGULARITY "HasSingularity"
 #define ATTR_HAS_TDP  "HasTDP"
 #define ATTR_HAS_TRANSFER_INPUT_REMAPS "HasTransferInputRemaps"
@@ -808,6 +818,7 @@
 #define ATTR_PUBLIC_INPUT_FILES  "PublicInputFiles"
 #define ATTR_MAX_TRANSFER_INPUT_MB "MaxTransferInputMB"
 #define ATTR_MAX_TRANSFER_OUTPUT_MB "MaxTransferOutputMB"
+#define ATTR_PARALLEL_TRANSFER_STREAMS "ParallelTransferStreams"
 #define ATTR_TRANSFER_INTERMEDIATE_FILES  "TransferIntermediate"
 #define ATTR_TRANSFER_OUTPUT_FILES  "TransferOutput"
 #define ATTR_TRANSFER_OUTPUT_REMAPS  "TransferOutputRemaps"
@@ -881,6 +892,7 @@
 #define ATTR_SEC_SUBSYSTEM  "Subsystem"
 #define ATTR_SEC_REMOTE_VERSION  "RemoteVersion"
 #define ATTR_SEC_SHORT_VERSION  "ShortVersion"
+#define ATTR_SEC_BINARY_CLASSADS  "BinaryClassAds"
 #define ATTR_SEC_SERVER_ENDPOINT  "ServerEndpoint"
 #define ATTR_SEC_SERVER_COMMAND_SOCK  "ServerCommandSock"
 #define ATTR_SEC_SERVER_PID  "ServerPid"
@@ -1093,6 +1105,8 @@ extern const char ATTR_SEC_AUTHENTICATED_USER [];
 #define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE_SUSTAINED  "LastNegotiationCycleMatchRateSustained"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PIES  "LastNegotiationCyclePies"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PIE_SPINS  "LastNegotiationCyclePieSpins"
+#define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_LIST_CACHE_HITS  "LastNegotiationCycleMatchListCacheHits"
+#define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_LIST_CACHE_MISSES  "LastNegotiationCycleMatchListCacheMisses"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_DURATION  "LastNegotiationCyclePrefetchDuration"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_CPU_TIME  "LastNegotiationCyclePrefetchCpuTime"
 #define ATTR_LAST_NEGOTIATION_CYCLE_SCHEDDS_OUT_OF_TIME  "LastNegotiationCycleScheddsOutOfTime"
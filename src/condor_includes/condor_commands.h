@@ -188,6 +188,7 @@ NAMETABLE_DIRECTIVE:TABLE:DCTranslation
 // Get the SubmitterCeiling
 #define GET_CEILING (SCHED_VERS+124)
 #define SET_CEILING (SCHED_VERS+125)
+#define MULTIPLEXED_SHADOW_JOB_EXIT (SCHED_VERS+126) // schedd: a multiplexed shadow reports the exit reason of one of its jobs
 
 
 // values used for "HowFast" in the draining request
@@ -354,6 +355,10 @@ const int UPDATE_OWN_SUBMITTOR_AD = 80;
 // Request a collector to retrieve an identity token from a schedd.
 const int IMPERSONATION_TOKEN_REQUEST = 81;
 
+// A startd ad holding only the attributes that changed since a full
+// UPDATE_STARTD_AD, to be applied to the ad the collector already has.
+const int UPDATE_STARTD_AD_DELTA = 82;
+
 /* these comments are used to control command_table_generator.pl
 NAMETABLE_DIRECTIVE:END_SECTION:collector
 */
@@ -462,6 +467,7 @@ NAMETABLE_DIRECTIVE:END_SECTION:collector
 #define FILETRANSFER_BASE 61000
 #define FILETRANS_UPLOAD (FILETRANSFER_BASE+0)
 #define FILETRANS_DOWNLOAD (FILETRANSFER_BASE+1)
+#define FILETRANS_STREAM (FILETRANSFER_BASE+2)
 
 
 /*
@@ -482,6 +488,8 @@ NAMETABLE_DIRECTIVE:END_SECTION:collector
 #define GIVE_MATCHES 	       (DCSHADOW_BASE+3)  // for MPI & parallel shadow
 //#define RECEIVE_JOBAD		   (DCSHADOW_BASE+4)	/* Not used */
 #define UPDATE_JOBAD		   (DCSHADOW_BASE+5)
+#define SHADOW_MUX_START_JOB   (DCSHADOW_BASE+6)  // for multiplexed shadow: host another job
+#define SHADOW_MUX_SIGNAL_JOB  (DCSHADOW_BASE+7)  // for multiplexed shadow: signal one hosted job
 
 
 /*
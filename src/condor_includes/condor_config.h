@@ -31,6 +31,7 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <atomic>
 
 typedef std::vector<const char *> MACRO_SOURCES;
 class CondorError;
@@ -235,6 +236,72 @@ typedef struct macro_eval_context_ex : macro_eval_context {
 	bool string_is_double_param(const char * string, double& result, ClassAd *me = NULL, ClassAd *target = NULL, const char * name=NULL, int* err_reason=NULL);
 	bool string_is_long_param(const char * string, long long& result, ClassAd *me = NULL, ClassAd *target = NULL, const char * name=NULL, int* err_reason=NULL);
 
+	// A param handle holds the parsed value of one config knob, so that code that reads the knob
+	// for every request does not pay for a lookup, macro expansion and parse on each read.
+	// Handles are meant to be declared at file scope, like this
+	//    static param_bool_handle allow_pslot_preemption("ALLOW_PSLOT_PREEMPTION", false);
+	//    if (allow_pslot_preemption.get()) { ... }
+	// The value is looked up on the first get() and again at the end of every config load.
+	// Each refresh replaces the value with a single atomic store, so get() is safe to call
+	// from any thread, but handles should only be constructed and destroyed by the main thread.
+	class param_handle {
+	public:
+		const char * name() const { return m_name; }
+		// look up the value of every param handle again, called by the config code after each config load.
+		static void refresh_all();
+		// look up the value of the handles for the given knob again, called when a single knob is changed.
+		static void refresh_named(const char * name);
+	protected:
+		param_handle(const char * name);
+		virtual ~param_handle();
+		virtual void refresh() = 0; // look up the knob and store the parsed value
+		void check_loaded() const { if ( ! m_loaded.load(std::memory_order_acquire)) { const_cast<param_handle*>(this)->load(); } }
+		const char * m_name;
+	private:
+		void load() { refresh(); m_loaded.store(true, std::memory_order_release); }
+		param_handle * m_next; // link in the list of all handles
+		std::atomic<bool> m_loaded;
+		// handles hold a pointer into the registry list, so they cannot be copied
+		param_handle(const param_handle &) = delete;
+		param_handle & operator=(const param_handle &) = delete;
+	};
+
+	class param_bool_handle : public param_handle {
+	public:
+		param_bool_handle(const char * name, bool default_value) : param_handle(name), m_default(default_value), m_value(default_value) {}
+		bool get() const { check_loaded(); return m_value.load(std::memory_order_relaxed); }
+	protected:
+		virtual void refresh() { m_value.store(param_boolean(m_name, m_default), std::memory_order_relaxed); }
+		bool m_default;
+		std::atomic<bool> m_value;
+	};
+
+	class param_int_handle : public param_handle {
+	public:
+		param_int_handle(const char * name, int default_value, int min_value = INT_MIN, int max_value = INT_MAX)
+			: param_handle(name), m_default(default_value), m_min(min_value), m_max(max_value), m_value(default_value) {}
+		int get() const { check_loaded(); return m_value.load(std::memory_order_relaxed); }
+	protected:
+		virtual void refresh() { m_value.store(param_integer(m_name, m_default, m_min, m_max), std::memory_order_relaxed); }
+		int m_default, m_min, m_max;
+		std::atomic<int> m_value;
+	};
+
+	class param_double_handle : public param_handle {
+	public:
+		param_double_handle(const char * name, double default_value, double min_value = -DBL_MAX, double max_value = DBL_MAX)
+			: param_handle(name), m_default(default_value), m_min(min_value), m_max(max_value), m_value(default_value) {}
+		double get() const { check_loaded(); return m_value.load(std::memory_order_relaxed); }
+	protected:
+		virtual void refresh() { m_value.store(param_double(m_name, m_default, m_min, m_max), std::memory_order_relaxed); }
+		double m_default, m_min, m_max;
+		std::atomic<double> m_value;
+	};
+
+	// returns the number of times the config table has been searched by param() and its relatives
+	// since the process started. DaemonCore publishes the rate as RecentDCParamLookupRate.
+	unsigned int param_lookup_count();
+
 	// A convenience function for use with trinary parameters.
 	bool param_true( const char * name );
 
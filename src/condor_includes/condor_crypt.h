@@ -26,6 +26,8 @@
 
 #include "CryptKey.h"
 
+struct evp_cipher_ctx_st;   // EVP_CIPHER_CTX from openssl/evp.h
+
 struct StreamCryptoState {
     // The IV is a 16-byte random number.  The first 4 bytes are modified with
     // a message counter to ensure it is unique.
@@ -76,6 +78,12 @@ public:
 //
     StreamCryptoState m_stream_crypto_state;
 
+    // keyed AES-GCM cipher contexts, kept for the life of the state so
+    // that each message only has to install a new IV.  created on first
+    // use by Condor_Crypt_AESGCM.
+    evp_cipher_ctx_st *m_enc_ctx{nullptr};
+    evp_cipher_ctx_st *m_dec_ctx{nullptr};
+
 private:
     Condor_Crypto_State() {ASSERT("PRIVATE CONSTRUCTOR CALLED\n");} ;
     Condor_Crypto_State(Condor_Crypto_State&) {ASSERT("PRIVATE COPY CONSTRUCTOR CALLED\n");};
@@ -27,6 +27,7 @@ class Condor_Crypt_AESGCM : public Condor_Crypt_Base {
 
  public:
     static void initState(StreamCryptoState *ss);
+    static void freeContexts(Condor_Crypto_State *cs);
 
     bool encrypt(Condor_Crypto_State *,
                  const unsigned char *,
@@ -58,6 +59,9 @@ class Condor_Crypt_AESGCM : public Condor_Crypt_Base {
 
     virtual int ciphertext_size_with_cs(int plaintext_size, StreamCryptoState *ss) const;
 
+ private:
+    static evp_cipher_ctx_st *getContext(Condor_Crypto_State *cs, bool encrypt);
+
 };
 
 #endif
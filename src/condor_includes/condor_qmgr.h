@@ -138,6 +138,14 @@ int SetJobFactory(int cluster_id, int qnum, const char * factory_filename, const
 // spool the materialize item data, getting back the filename of the spooled file and number of items that were sent.
 int SendMaterializeData(int cluster_id, int flags, int (*next)(void* pv, std::string&item), void* pv, MyString & filename, int* pnum_items);
 
+// create procs first_proc_id and up in the active cluster in a single message, returns the number of procs created.
+// cluster_ad, when not NULL, is set into the cluster ad before the procs are created.  Each row of proc_rows holds
+// the unparsed value of the attribute named in the same position of columns, an empty cell means no value for that proc.
+// the schedd sets ProcId for each proc and fails the whole message if a proc id is not the expected one.
+int BulkSubmit(int cluster_id, int first_proc_id, const classad::ClassAd * cluster_ad,
+	const std::vector<std::string> & columns, const std::vector< std::vector<std::string> > & proc_rows,
+	SetAttributeFlags_t saflags);
+
 // send a cluster ad or proc ad as a series of SetAttribute calls.
 // this function does a *shallow* iterate of the given ad, ignoring attributes in the chained parent ad (if any)
 // since the chained parent attributes should be sent only once, and using a different key.
@@ -269,6 +277,12 @@ void CommitNonDurableTransactionOrDieTrying();
 void CommitTransactionOrDieTrying();
 int CommitTransactionAndLive( SetAttributeFlags_t flags, CondorError * errstack )
 	WARN_UNUSED_RESULT;
+/** Like CommitTransactionAndLive, but for a qmgmt client's commit.  With
+    job queue group commit the sync is left to the I/O thread, so the reply
+    to the client must be held back until JobQueueSyncPending() is false.
+*/
+int CommitClientTransaction( SetAttributeFlags_t flags, CondorError * errstack )
+	WARN_UNUSED_RESULT;
 
 
 int AbortTransaction();
@@ -29,6 +29,9 @@
 #include "condor_md.h"
 
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <openssl/evp.h>
 
@@ -57,6 +60,10 @@ class Condor_MD_MAC;
 #define PUT_FILE_MAX_BYTES_EXCEEDED -5
 #define GET_FILE_MAX_BYTES_EXCEEDED -5
 
+// This special file descriptor number must not be a valid fd number.
+// It is used to make get_file() consume transferred data without writing it.
+const int GET_FILE_NULL_FD = -10;
+
 class BlockingModeGuard;
 
 class ReliSock : public Sock {
@@ -194,6 +201,11 @@ public:
     /// returns -1 on failure, 0 for ok
 	int put_file( filesize_t *size, int fd, filesize_t offset=0, filesize_t max_bytes=-1, class DCTransferQueue *xfer_q=NULL );
 
+	// Whether put_file() and get_file() may use sendfile() and splice().
+	// Unless this is called, they look up ENABLE_ZERO_COPY_FILE_TRANSFER
+	// each time, which a socket used off the main thread must not do.
+	void set_zero_copy( bool enable ) { m_zero_copy = enable ? 1 : 0; }
+
 	// This is used internally to recover sanity on the stream after
 	// failing to open a file.  The remote side will see this as a zero-sized file.
 	// returns -1 on failure, 0 for ok
@@ -286,6 +298,17 @@ public:
 
 	bool is_closed() const {return rcv_msg.m_closed;}
 
+		// State of the binary ClassAd encoding on this connection, which
+		// putClassAd() and getClassAd() use when both ends support it.
+		// Each end interns the attribute names it sends, and the other
+		// end rebuilds the same table as it receives them.
+	struct ClassAdWireState {
+		int use_binary{-1};		// -1 until decided when the first ad is sent
+		std::unordered_map<std::string, int> sent_names;
+		std::vector<std::string> received_names;
+	};
+	ClassAdWireState & classad_wire_state() { return m_classad_wire; }
+
 	// serialize and deserialize
 	const char * serialize(const char *);	// restore state from buffer
 	char * serialize() const;	// save state into buffer
@@ -316,6 +339,17 @@ protected:
 	*/
 
 	int prepare_for_nobuffering( stream_coding = stream_unknown);
+#if defined(LINUX)
+		// Move file data between fd and the socket without copying it
+		// through user space; used by put_file() and get_file() when the
+		// stream is not encrypted.
+	int put_file_sendfile( int fd, filesize_t offset, filesize_t bytes_to_send,
+						   filesize_t &total, class DCTransferQueue *xfer_q );
+	int get_file_splice( int &fd, filesize_t bytes_to_receive, filesize_t &total,
+						 char *buf, int buf_size, int &retval, int &saved_errno,
+						 class DCTransferQueue *xfer_q );
+#endif
+	bool use_zero_copy() const;
 	int perform_authenticate( bool with_key, KeyInfo *& key, 
 							  const char* methods, CondorError* errstack,
 							  int auth_timeout, bool non_blocking, char **method_used );
@@ -418,6 +452,8 @@ protected:
 	bool m_final_recv_header{false};
 	bool m_finished_send_header{false};
 	bool m_finished_recv_header{false};
+	int m_zero_copy{-1};	// -1 means ask the config each time
+	ClassAdWireState m_classad_wire;
 	char * serializeMsgInfo() const;
 	const char * serializeMsgInfo(const char * buf);
 
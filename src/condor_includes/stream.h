@@ -504,6 +504,11 @@ public:
 	/// Set the peer's version.
 	void set_peer_version(CondorVersionInfo const *version);
 
+	/// True if the peer said in the security handshake that it
+	/// can read the binary ClassAd encoding.
+	bool get_peer_binary_classads() const { return m_peer_binary_classads; }
+	void set_peer_binary_classads(bool val) { m_peer_binary_classads = val; }
+
 	/** Get this stream's type.
         @return the type of this stream
     */
@@ -589,6 +594,7 @@ protected:
 	int decrypt_buf_len;
 	char *m_peer_description_str;
 	CondorVersionInfo *m_peer_version;
+	bool m_peer_binary_classads;
 
 	time_t m_deadline_time;
 	static int timeout_multiplier;
@@ -95,6 +95,16 @@ Buf::grow_buf(int new_sz)
 	_dta_maxsz = new_sz;
 }
 
+	// Frees the data of an empty buffer that has grown past new_sz, so
+	// that the next alloc_buf() allocates new_sz bytes.
+void
+Buf::shrink_buf(int new_sz)
+{
+	if (new_sz >= _dta_maxsz || !empty()) return;
+	dealloc_buf();
+	_dta_maxsz = new_sz;
+}
+
 int Buf::write(
 	char const *peer_description,
 	SOCKET	sockd,
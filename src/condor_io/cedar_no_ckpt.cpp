@@ -47,15 +47,127 @@
 #include "dc_transfer_queue.h"
 #include "limit_directory_access.h"
 
+#include "selector.h"
+
 #ifdef WIN32
 #include <mswsock.h>	// For TransmitFile()
 #endif
+#if defined(LINUX)
+#include <sys/sendfile.h>
+#endif
 
 const unsigned int PUT_FILE_EOM_NUM = 666;
 
-// This special file descriptor number must not be a valid fd number.
-// It is used to make get_file() consume transferred data without writing it.
-const int GET_FILE_NULL_FD = -10;
+// Largest size and alignment of the buffer put_file() and get_file()
+// use when the data has to be copied through user space.
+const int FILE_XFER_BUFFER_SIZE = 1024 * 1024;
+const int FILE_XFER_BUFFER_ALIGN = 4096;
+
+// Most bytes handed to sendfile() in one call, so that the transfer
+// queue still gets regular progress reports.
+const int ZERO_COPY_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// A page-aligned buffer for file data, big enough for bytes (up to
+// FILE_XFER_BUFFER_SIZE), so that small files don't pay for a big one.
+class FileXferBuffer {
+public:
+	FileXferBuffer( filesize_t bytes ) : m_buf(NULL) {
+		m_size = (int) MIN( (filesize_t) FILE_XFER_BUFFER_SIZE, MAX( bytes, (filesize_t) 1 ) );
+		m_size = (m_size + FILE_XFER_BUFFER_ALIGN - 1) & ~(FILE_XFER_BUFFER_ALIGN - 1);
+#ifdef WIN32
+		m_buf = _aligned_malloc( m_size, FILE_XFER_BUFFER_ALIGN );
+#else
+		if( posix_memalign( &m_buf, FILE_XFER_BUFFER_ALIGN, m_size ) != 0 ) {
+			m_buf = NULL;
+		}
+#endif
+		if( !m_buf ) {
+			EXCEPT( "Out of memory allocating file transfer buffer" );
+		}
+	}
+	~FileXferBuffer() {
+#ifdef WIN32
+		_aligned_free( m_buf );
+#else
+		free( m_buf );
+#endif
+	}
+	char *data() { return (char *)m_buf; }
+	int size() const { return m_size; }
+private:
+	void *m_buf;
+	int m_size;
+
+	FileXferBuffer( const FileXferBuffer & );
+	FileXferBuffer &operator=( const FileXferBuffer & );
+};
+
+// Write data received by get_file() to fd.  If the write fails, fd is
+// set to GET_FILE_NULL_FD, so that the rest of the file is consumed
+// without being written.  Returns the number of bytes consumed.
+static int
+write_file_data( int &fd, const char *buf, int nbytes, int &retval, int &saved_errno )
+{
+	int rval;
+	int written;
+	for( written=0; written<nbytes; ) {
+		rval = ::write( fd, &buf[written], (nbytes-written) );
+		if( rval < 0 ) {
+			saved_errno = errno;
+			dprintf( D_ALWAYS,
+					 "ReliSock::get_file: write() returned %d: %s "
+					 "(errno=%d)\n", rval, strerror(errno), errno );
+
+
+				// Continue reading data, but throw it all away.
+				// In this way, we keep the wire protocol in a
+				// well defined state.
+			fd = GET_FILE_NULL_FD;
+			retval = GET_FILE_WRITE_FAILED;
+			written = nbytes;
+			break;
+		} else if( rval == 0 ) {
+				/*
+				  write() shouldn't really return 0 at all.
+				  apparently it can do so if we asked it to write
+				  0 bytes (which we're not going to do) or if the
+				  file is closed (which we're also not going to
+				  do).  so, for now, if we see it, we want to just
+				  break out of this loop.  in the future, we might
+				  do more fancy stuff to handle this case, but
+				  we're probably never going to see this anyway.
+				*/
+			dprintf( D_ALWAYS,
+					 "ReliSock::get_file: write() returned 0: "
+					 "wrote %d out of %d bytes (errno=%d %s)\n",
+					 written, nbytes, errno, strerror(errno) );
+			break;
+		} else {
+			written += rval;
+		}
+	}
+	return written;
+}
+
+#if defined(LINUX)
+// Wait for at most timeout seconds (forever if timeout is 0) for the
+// socket to be ready for io.  Returns false on timeout or error.
+static bool
+wait_for_socket( int sock, Selector::IO_FUNC io, int timeout )
+{
+	if( timeout <= 0 ) {
+		return true;
+	}
+	Selector selector;
+	selector.add_fd( sock, io );
+	selector.add_fd( sock, Selector::IO_EXCEPT );
+	selector.set_timeout( timeout );
+	do {
+		selector.execute();
+	} while( selector.signalled() );
+	return !selector.timed_out() && !selector.failed();
+}
+#endif
 
 int
 ReliSock::get_file( filesize_t *size, const char *destination,
@@ -135,13 +247,11 @@ ReliSock::get_file( filesize_t *size, const char *destination,
 	return result;
 }
 
-MSC_DISABLE_WARNING(6262) // function uses 64k of stack
 int
 ReliSock::get_file( filesize_t *size, int fd,
 					bool flush_buffers, bool append, filesize_t max_bytes,
 					DCTransferQueue *xfer_q)
 {
-	char buf[65536];
 	filesize_t filesize, bytes_to_receive;
 	unsigned int eom_num;
 	filesize_t total = 0;
@@ -176,15 +286,36 @@ ReliSock::get_file( filesize_t *size, int fd,
 		  RSC in the syscall library.  this code isn't like that.
 		*/
 
+	FileXferBuffer xfer_buf( bytes_to_receive );
+	char *buf = xfer_buf.data();
+	bool net_failed = false;
+
+#if defined(LINUX)
+		// If the data is not encrypted, move it from the socket to the
+		// file in the kernel.  This stops at the first sign of trouble
+		// with the file, leaving the rest to the loop below.
+	if( bytes_to_receive > 0 && fd != GET_FILE_NULL_FD && !append &&
+		!get_encryption() && (max_bytes < 0 || bytes_to_receive <= max_bytes) &&
+		use_zero_copy() )
+	{
+		struct stat st;
+		if( fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) ) {
+			net_failed = get_file_splice( fd, bytes_to_receive, total,
+			                              buf, xfer_buf.size(),
+			                              retval, saved_errno, xfer_q ) < 0;
+		}
+	}
+#endif
+
 	// Now, read it all in & save it
-	while( total < bytes_to_receive ) {
+	while( !net_failed && total < bytes_to_receive ) {
 		struct timeval t1,t2;
 		if( xfer_q ) {
 			condor_gettimestamp(t1);
 		}
 
 		int	iosize =
-			(int) MIN( (filesize_t) sizeof(buf), bytes_to_receive - total );
+			(int) MIN( (filesize_t) xfer_buf.size(), bytes_to_receive - total );
 		int	nbytes = get_bytes_nobuffer( buf, iosize, 0 );
 
 		if( xfer_q ) {
@@ -204,44 +335,7 @@ ReliSock::get_file( filesize_t *size, int fd,
 			continue;
 		}
 
-		int rval;
-		int written;
-		for( written=0; written<nbytes; ) {
-			rval = ::write( fd, &buf[written], (nbytes-written) );
-			if( rval < 0 ) {
-				saved_errno = errno;
-				dprintf( D_ALWAYS,
-						 "ReliSock::get_file: write() returned %d: %s "
-						 "(errno=%d)\n", rval, strerror(errno), errno );
-
-
-					// Continue reading data, but throw it all away.
-					// In this way, we keep the wire protocol in a
-					// well defined state.
-				fd = GET_FILE_NULL_FD;
-				retval = GET_FILE_WRITE_FAILED;
-				written = nbytes;
-				break;
-			} else if( rval == 0 ) {
-					/*
-					  write() shouldn't really return 0 at all.
-					  apparently it can do so if we asked it to write
-					  0 bytes (which we're not going to do) or if the
-					  file is closed (which we're also not going to
-					  do).  so, for now, if we see it, we want to just
-					  break out of this loop.  in the future, we might
-					  do more fancy stuff to handle this case, but
-					  we're probably never going to see this anyway.
-					*/
-				dprintf( D_ALWAYS,
-						 "ReliSock::get_file: write() returned 0: "
-						 "wrote %d out of %d bytes (errno=%d %s)\n",
-						 written, nbytes, errno, strerror(errno) );
-				break;
-			} else {
-				written += rval;
-			}
-		}
+		int written = write_file_data( fd, buf, nbytes, retval, saved_errno );
 		if( xfer_q ) {
 			condor_gettimestamp(t1);
 				// reuse t2 above as start time for file write
@@ -309,7 +403,139 @@ ReliSock::get_file( filesize_t *size, int fd,
 	errno = saved_errno;
 	return retval;
 }
-MSC_RESTORE_WARNING(6262) // function uses 64k of stack
+
+bool
+ReliSock::use_zero_copy() const
+{
+	if ( m_zero_copy >= 0 ) {
+		return m_zero_copy != 0;
+	}
+	return param_boolean( "ENABLE_ZERO_COPY_FILE_TRANSFER", true );
+}
+
+#if defined(LINUX)
+int
+ReliSock::get_file_splice( int &fd, filesize_t bytes_to_receive, filesize_t &total,
+						   char *buf, int buf_size, int &retval, int &saved_errno,
+						   DCTransferQueue *xfer_q )
+{
+	int pipefd[2];
+	if( pipe( pipefd ) < 0 ) {
+		dprintf( D_FULLDEBUG, "ReliSock::get_file: pipe() failed, errno=%d %s\n",
+				 errno, strerror(errno) );
+		return 0;
+	}
+		// The more the pipe holds, the fewer splice() calls we need.
+		// The default maximum allowed is the size of our buffer.
+	(void) fcntl( pipefd[1], F_SETPIPE_SZ, FILE_XFER_BUFFER_SIZE );
+
+	if ( !prepare_for_nobuffering(stream_decode) ) {
+		dprintf( D_ALWAYS, "ReliSock::get_file: failed to drain buffers!\n" );
+		::close( pipefd[0] );
+		::close( pipefd[1] );
+		return -1;
+	}
+
+	int result = 0;
+	while( total < bytes_to_receive ) {
+		if( !wait_for_socket( _sock, Selector::IO_READ, _timeout ) ) {
+			dprintf( D_ALWAYS, "ReliSock::get_file: timed out reading from %s\n",
+					 peer_description() );
+			result = -1;
+			break;
+		}
+
+		struct timeval t1,t2;
+		if( xfer_q ) {
+			condor_gettimestamp(t1);
+		}
+
+		size_t chunk = (size_t) MIN( (filesize_t) FILE_XFER_BUFFER_SIZE, bytes_to_receive - total );
+		ssize_t nbytes = splice( _sock, NULL, pipefd[1], NULL, chunk,
+		                         SPLICE_F_MOVE | SPLICE_F_MORE );
+		if( nbytes < 0 ) {
+			if( errno == EINTR || errno == EAGAIN ) {
+				continue;
+			}
+			if( (errno == EINVAL || errno == ENOSYS) && total == 0 ) {
+				dprintf( D_FULLDEBUG, "ReliSock::get_file: splice() not supported "
+						 "(errno=%d %s), copying instead\n", errno, strerror(errno) );
+				break;
+			}
+			dprintf( D_ALWAYS, "ReliSock::get_file: splice() from %s failed, errno=%d %s\n",
+					 peer_description(), errno, strerror(errno) );
+			result = -1;
+			break;
+		}
+		if( nbytes == 0 ) {
+			dprintf( D_ALWAYS, "ReliSock::get_file: connection closed by %s\n",
+					 peer_description() );
+			result = -1;
+			break;
+		}
+		_bytes_recvd += nbytes;
+
+		if( xfer_q ) {
+			condor_gettimestamp(t2);
+			xfer_q->AddUsecNetRead(timersub_usec(t2, t1));
+		}
+
+		ssize_t left = nbytes;
+		while( left > 0 ) {
+			ssize_t moved = splice( pipefd[0], NULL, fd, NULL, left, SPLICE_F_MOVE );
+			if( moved < 0 && errno == EINTR ) {
+				continue;
+			}
+			if( moved <= 0 ) {
+				break;
+			}
+			left -= moved;
+		}
+		filesize_t written = nbytes - left;
+
+		bool file_failed = left > 0;
+		if( file_failed ) {
+				// The file would not take the data this way (or at
+				// all).  Pass what is still in the pipe through the
+				// buffer, so that a write failure is handled just as
+				// it is when not splicing.
+			dprintf( D_FULLDEBUG, "ReliSock::get_file: splice() to file failed, "
+					 "errno=%d %s\n", errno, strerror(errno) );
+			while( left > 0 ) {
+				int nrd = ::read( pipefd[0], buf, (size_t) MIN( left, (ssize_t) buf_size ) );
+				if( nrd < 0 && errno == EINTR ) {
+					continue;
+				}
+				if( nrd <= 0 ) {
+					EXCEPT( "ReliSock::get_file: failed to read back from pipe, errno=%d", errno );
+				}
+				if( fd == GET_FILE_NULL_FD ) {
+					written += nrd;
+				} else {
+					written += write_file_data( fd, buf, nrd, retval, saved_errno );
+				}
+				left -= nrd;
+			}
+		}
+
+		if( xfer_q ) {
+			condor_gettimestamp(t1);
+			xfer_q->AddUsecFileWrite(timersub_usec(t1, t2));
+			xfer_q->AddBytesReceived(written);
+			xfer_q->ConsiderSendingReport(t1.tv_sec);
+		}
+
+		total += written;
+		if( file_failed ) {
+			break;
+		}
+	}
+
+	::close( pipefd[0] );
+	::close( pipefd[1] );
+	return result;
+}
+#endif
 
 int
 ReliSock::put_empty_file( filesize_t *size )
@@ -372,7 +598,6 @@ ReliSock::put_file( filesize_t *size, const char *source, filesize_t offset, fil
 	return result;
 }
 
-MSC_DISABLE_WARNING(6262) // function uses 64k of stack
 int
 ReliSock::put_file( filesize_t *size, int fd, filesize_t offset, filesize_t max_bytes, DCTransferQueue *xfer_q )
 {
@@ -437,6 +662,12 @@ ReliSock::put_file( filesize_t *size, int fd, filesize_t offset, filesize_t max_
 		lseek( fd, offset, SEEK_SET );
 	}
 
+#if defined(LINUX)
+	if ( bytes_to_send > 0 ) {
+		(void) posix_fadvise( fd, offset, bytes_to_send, POSIX_FADV_SEQUENTIAL );
+	}
+#endif
+
 	// Log what's going on
 	dprintf(D_FULLDEBUG,
 			"put_file: sending " FILESIZE_T_FORMAT " bytes\n", bytes_to_send );
@@ -490,10 +721,21 @@ ReliSock::put_file( filesize_t *size, int fd, filesize_t offset, filesize_t max_
 		}
 #endif
 
-		char buf[65536];
+#if defined(LINUX)
+		// On Linux, if we don't need encryption, let the kernel send the
+		// file straight from the page cache.
+		if ( (!get_encryption()) && use_zero_copy() ) {
+			if ( put_file_sendfile( fd, offset, bytes_to_send, total, xfer_q ) < 0 ) {
+				return -1;
+			}
+		}
+#endif
+
+		FileXferBuffer xfer_buf( bytes_to_send - total );
+		char *buf = xfer_buf.data();
 		int nbytes, nrd;
 
-		// On Unix, always send the file using put_bytes_nobuffer().
+		// Otherwise, send the file using put_bytes_nobuffer().
 		// Note that on Win32, we use this method as well if encryption 
 		// is required.
 		while (total < bytes_to_send) {
@@ -504,7 +746,7 @@ ReliSock::put_file( filesize_t *size, int fd, filesize_t offset, filesize_t max_
 			}
 
 			// Be very careful about where the cast to size_t happens; see gt#4150
-			nrd = ::read(fd, buf, (size_t)((bytes_to_send-total) < (int)sizeof(buf) ? bytes_to_send-total : sizeof(buf)));
+			nrd = ::read(fd, buf, (size_t)((bytes_to_send-total) < xfer_buf.size() ? bytes_to_send-total : xfer_buf.size()));
 
 			if( xfer_q ) {
 				condor_gettimestamp(t2);
@@ -570,7 +812,73 @@ ReliSock::put_file( filesize_t *size, int fd, filesize_t offset, filesize_t max_
 	*size = filesize;
 	return 0;
 }
-MSC_RESTORE_WARNING(6262) // function uses 64k of stack
+
+#if defined(LINUX)
+int
+ReliSock::put_file_sendfile( int fd, filesize_t offset, filesize_t bytes_to_send,
+							 filesize_t &total, DCTransferQueue *xfer_q )
+{
+	// First drain outgoing buffers
+	if ( !prepare_for_nobuffering(stream_encode) ) {
+		dprintf(D_ALWAYS,
+				"ReliSock: put_file: failed to drain buffers!\n");
+		return -1;
+	}
+
+	off_t pos = offset;
+	while ( total < bytes_to_send ) {
+		if ( !wait_for_socket( _sock, Selector::IO_WRITE, _timeout ) ) {
+			dprintf( D_ALWAYS, "ReliSock::put_file: timed out writing to %s\n",
+					 peer_description() );
+			return -1;
+		}
+
+		struct timeval t1;
+		if( xfer_q ) {
+			condor_gettimestamp(t1);
+		}
+
+		size_t chunk = (size_t) MIN( (filesize_t) ZERO_COPY_CHUNK_SIZE, bytes_to_send - total );
+		ssize_t nbytes = sendfile( _sock, fd, &pos, chunk );
+		if ( nbytes < 0 ) {
+			if ( errno == EINTR || errno == EAGAIN ) {
+				continue;
+			}
+			if ( (errno == EINVAL || errno == ENOSYS) && total == 0 ) {
+				dprintf( D_FULLDEBUG, "ReliSock::put_file: sendfile() not supported "
+						 "(errno=%d %s), copying instead\n", errno, strerror(errno) );
+				break;
+			}
+			dprintf( D_ALWAYS, "ReliSock::put_file: sendfile() to %s failed, errno=%d %s\n",
+					 peer_description(), errno, strerror(errno) );
+			return -1;
+		}
+		if ( nbytes == 0 ) {
+				// The file is shorter than it was; our caller will
+				// notice that it comes up short.
+			break;
+		}
+
+		if( xfer_q ) {
+			struct timeval t2;
+			condor_gettimestamp(t2);
+				// We don't know how much of the time was spent reading
+				// from disk vs. writing to the network, so we just report
+				// it all as network i/o time.
+			xfer_q->AddUsecNetWrite(timersub_usec(t2, t1));
+			xfer_q->AddBytesSent(nbytes);
+			xfer_q->ConsiderSendingReport(t2.tv_sec);
+		}
+		total += nbytes;
+		_bytes_sent += nbytes;
+	}
+
+		// sendfile() does not move the file offset; leave it where the
+		// copying loop in put_file() expects it.
+	lseek( fd, offset + total, SEEK_SET );
+	return 0;
+}
+#endif
 
 int
 ReliSock::get_file_with_permissions( filesize_t *size, 
@@ -100,6 +100,7 @@ Condor_Crypto_State::Condor_Crypto_State(Protocol proto, KeyInfo &key) :
 Condor_Crypto_State::~Condor_Crypto_State() {
     if(m_ivec) free(m_ivec);
     if(m_method_key_data) free(m_method_key_data);
+    Condor_Crypt_AESGCM::freeContexts(this);
 }
 
 void Condor_Crypto_State::reset() {
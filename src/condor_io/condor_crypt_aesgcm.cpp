@@ -50,6 +50,58 @@ void Condor_Crypt_AESGCM::initState(StreamCryptoState* stream_state)
 	}	
 }
 
+// this function is static
+void Condor_Crypt_AESGCM::freeContexts(Condor_Crypto_State *cs)
+{
+	if (cs->m_enc_ctx) {
+		EVP_CIPHER_CTX_free(cs->m_enc_ctx);
+		cs->m_enc_ctx = nullptr;
+	}
+	if (cs->m_dec_ctx) {
+		EVP_CIPHER_CTX_free(cs->m_dec_ctx);
+		cs->m_dec_ctx = nullptr;
+	}
+}
+
+// Returns the cipher context kept in the crypto state for one direction,
+// creating it and running the key setup on first use.  The caller only
+// needs to install a fresh IV before each message.
+EVP_CIPHER_CTX *Condor_Crypt_AESGCM::getContext(Condor_Crypto_State *cs, bool encrypt)
+{
+	EVP_CIPHER_CTX *&ctx = encrypt ? cs->m_enc_ctx : cs->m_dec_ctx;
+	if (ctx) {
+		return ctx;
+	}
+
+	std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> new_ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+	if (!new_ctx) {
+		dprintf(D_ALWAYS, "Condor_Crypt_AESGCM: ERROR: Failed to allocate new EVP method.\n");
+		return nullptr;
+	}
+
+	if (1 != EVP_CipherInit_ex(new_ctx.get(), EVP_aes_256_gcm(), NULL, NULL, NULL, encrypt ? 1 : 0)) {
+		dprintf(D_ALWAYS, "Condor_Crypt_AESGCM: ERROR: Failed to create AES-GCM-256 mode.\n");
+		return nullptr;
+	}
+
+	if (1 != EVP_CIPHER_CTX_ctrl(new_ctx.get(), EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, NULL)) {
+		dprintf(D_ALWAYS, "Condor_Crypt_AESGCM: ERROR: Failed to set IV length to %d.\n", IV_SIZE);
+		return nullptr;
+	}
+
+	const unsigned char *kdp = cs->m_keyInfo.getKeyData();
+	dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM DUMP : about to init %s key %0x %0x %0x %0x.\n",
+		encrypt ? "encrypt" : "decrypt", *(kdp), *(kdp + 15), *(kdp + 16), *(kdp + 31));
+
+	if (1 != EVP_CipherInit_ex(new_ctx.get(), NULL, NULL, kdp, NULL, encrypt ? 1 : 0)) {
+		dprintf(D_ALWAYS, "Condor_Crypt_AESGCM: ERROR: Failed to initialize key.\n");
+		return nullptr;
+	}
+
+	ctx = new_ctx.release();
+	return ctx;
+}
+
 int Condor_Crypt_AESGCM::ciphertext_size_with_cs(int plaintext_size, StreamCryptoState * stream_state) const
 {
     int ct_sz = plaintext_size;
@@ -91,22 +143,6 @@ bool Condor_Crypt_AESGCM::encrypt(Condor_Crypto_State *cs,
     // Authentication tag is an additional 16 bytes; IV is 16 bytes
     output_len += MAC_SIZE + (sending_IV ? IV_SIZE : 0);
 
-    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
-    if (!ctx) {
-        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to allocate new EVP method.\n");
-        return false;
-    }
-
-    if (1 != EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, NULL, NULL)) {
-        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to create AES-GCM-256 mode.\n");
-        return false;
-    }
-
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, NULL)) {
-        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to set IV length.\n");
-        return false;
-    }
-
     // here we do the math to change the IV.  we take the lowest 4 bytes, treat
     // it as an int, add the message counter, and put it back.  this guarantees
     // the IV changes from packet to packet.  if we max out, we don't want to
@@ -147,12 +183,15 @@ bool Condor_Crypt_AESGCM::encrypt(Condor_Crypto_State *cs,
         return false;
     }
 
-    const unsigned char *kdp = cs->m_keyInfo.getKeyData();
-    dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::encrypt DUMP : about to init key %0x %0x %0x %0x.\n",
-        *(kdp), *(kdp + 15), *(kdp + 16), *(kdp + 31));
+    // The key schedule is computed once per crypto state; each message
+    // only installs its own IV into the saved context.
+    EVP_CIPHER_CTX *ctx = getContext(cs, true);
+    if (!ctx) {
+        return false;
+    }
 
-    if (1 != EVP_EncryptInit_ex(ctx.get(), NULL, NULL, cs->m_keyInfo.getKeyData(), iv)) {
-        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to initialize key and IV.\n");
+    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv)) {
+        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to initialize IV.\n");
         return false;
     }
 
@@ -160,13 +199,13 @@ bool Condor_Crypt_AESGCM::encrypt(Condor_Crypto_State *cs,
     int len;
     dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::encrypt DUMP : We have %d bytes of AAD data: %s...\n",
         aad_len, debug_hex_dump(hexdbg, reinterpret_cast<const char *>(aad), std::min(16, aad_len)));
-    if (aad && (1 != EVP_EncryptUpdate(ctx.get(), NULL, &len, aad, aad_len))) {
+    if (aad && (1 != EVP_EncryptUpdate(ctx, NULL, &len, aad, aad_len))) {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to authenticate caller input data.\n");
         return false;
     }
 
     dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::encrypt DUMP : We have %d bytes of plaintext\n", input_len);
-    if (1 != EVP_EncryptUpdate(ctx.get(), output + (sending_IV ? IV_SIZE : 0),
+    if (1 != EVP_EncryptUpdate(ctx, output + (sending_IV ? IV_SIZE : 0),
         &len, input, input_len))
     {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to encrypt plaintext buffer.\n");
@@ -175,7 +214,7 @@ bool Condor_Crypt_AESGCM::encrypt(Condor_Crypto_State *cs,
     dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::encrypt DUMP : First %d bytes written to ciphertext.\n", len);
 
     int len2;
-    if (1 != EVP_EncryptFinal_ex(ctx.get(), output + (sending_IV ? IV_SIZE : 0) + len, &len2)) {
+    if (1 != EVP_EncryptFinal_ex(ctx, output + (sending_IV ? IV_SIZE : 0) + len, &len2)) {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to finalize cipher text.\n");
         return false;
     }
@@ -208,7 +247,7 @@ bool Condor_Crypt_AESGCM::encrypt(Condor_Crypto_State *cs,
         *(output + output_len - MAC_SIZE - 1));
 
     // extract the tag directly into the output stream to be given to CEDAR
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, MAC_SIZE, output + output_len - MAC_SIZE)) {
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, MAC_SIZE, output + output_len - MAC_SIZE)) {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::encrypt: ERROR: Failed to get tag.\n");
         return false;
     }
@@ -231,8 +270,6 @@ bool Condor_Crypt_AESGCM::decrypt(Condor_Crypto_State *cs,
                                   unsigned char *        output, 
                                   int&                   output_len)
 {
-    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
-
     dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::decrypt **********************\n");
     dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::decrypt with input buffer %d.\n", input_len);
     StreamCryptoState *stream_state = &(cs->m_stream_crypto_state);
@@ -246,23 +283,13 @@ bool Condor_Crypt_AESGCM::decrypt(Condor_Crypto_State *cs,
         return false;
     }
 
-    if (!ctx) {
-        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: Failed to initialize EVP object.\n");
-        return false;
-    }
-
-    if (!EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, NULL, NULL)) {
-        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: Failed to initialize AES-GCM-256 mode.\n");
-        return false;
-    }
-
-    if (!EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, NULL)) {
-        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: Failed to initialize IV length to %d.\n", IV_SIZE);
+    if (cs->m_keyInfo.getProtocol() != CONDOR_AESGCM) {
+        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: failed due to the wrong protocol.\n");
         return false;
     }
 
-    if (cs->m_keyInfo.getProtocol() != CONDOR_AESGCM) {
-        dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: failed due to the wrong protocol.\n");
+    EVP_CIPHER_CTX *ctx = getContext(cs, false);
+    if (!ctx) {
         return false;
     }
 
@@ -295,10 +322,6 @@ bool Condor_Crypt_AESGCM::decrypt(Condor_Crypto_State *cs,
     memcpy(iv, &ctr_encoded, sizeof(ctr_encoded));
     memcpy(iv + sizeof(ctr_encoded), stream_state->m_iv_dec.iv + sizeof(ctr_encoded), IV_SIZE - sizeof(ctr_encoded));
 
-    const unsigned char *kdp = cs->m_keyInfo.getKeyData();
-    dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::decrypt DUMP : about to init key %0x %0x %0x %0x.\n",
-        *(kdp), *(kdp + 15), *(kdp + 16), *(kdp + 31));
-
     // for debugging, hexdbg at different times needs to hold hex
     // representation of IV, MAC, or initial AAD bytes.  currently
     // none are larger than 16 so the 128 is plenty.
@@ -307,7 +330,7 @@ bool Condor_Crypt_AESGCM::decrypt(Condor_Crypto_State *cs,
         debug_hex_dump(hexdbg,
         reinterpret_cast<const char *>(iv), IV_SIZE));
 
-    if (!EVP_DecryptInit_ex(ctx.get(), NULL, NULL, kdp, iv)) {
+    if (!EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, iv)) {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: failed due to failed init.\n");
         return false;
     }
@@ -315,7 +338,7 @@ bool Condor_Crypt_AESGCM::decrypt(Condor_Crypto_State *cs,
     int len;
     dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::decrypt DUMP : We have %d bytes of AAD data: %s...\n",
         aad_len, debug_hex_dump(hexdbg, reinterpret_cast<const char *>(aad), std::min(16, aad_len)));
-    if (aad && !EVP_DecryptUpdate(ctx.get(), NULL, &len, aad, aad_len)) {
+    if (aad && !EVP_DecryptUpdate(ctx, NULL, &len, aad, aad_len)) {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: failed when authenticating user AAD.\n");
         return false;
     }
@@ -330,7 +353,7 @@ bool Condor_Crypt_AESGCM::decrypt(Condor_Crypto_State *cs,
         return false;
     }
 
-    if (!EVP_DecryptUpdate(ctx.get(), output, &len, input + (receiving_IV ? IV_SIZE : 0), input_len - (receiving_IV ? IV_SIZE : 0) - MAC_SIZE)) {
+    if (!EVP_DecryptUpdate(ctx, output, &len, input + (receiving_IV ? IV_SIZE : 0), input_len - (receiving_IV ? IV_SIZE : 0) - MAC_SIZE)) {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: failed due to failed cipher text update.\n");
         return false;
     }
@@ -356,7 +379,7 @@ bool Condor_Crypt_AESGCM::decrypt(Condor_Crypto_State *cs,
         *(output + len - 2),
         *(output + len - 1));
 
-    if (!EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, MAC_SIZE, const_cast<unsigned char *>(input + input_len - MAC_SIZE))) {
+    if (!EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, MAC_SIZE, const_cast<unsigned char *>(input + input_len - MAC_SIZE))) {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: failed due to failed set of tag.\n");
         return false;
     }
@@ -366,7 +389,7 @@ bool Condor_Crypt_AESGCM::decrypt(Condor_Crypto_State *cs,
         debug_hex_dump(hex2, reinterpret_cast<const char*>(input + input_len - MAC_SIZE), MAC_SIZE));
 
     dprintf(D_NETWORK | D_VERBOSE, "Condor_Crypt_AESGCM::decrypt DUMP : about to finalize output (len is %i).\n", len);
-    if (!EVP_DecryptFinal_ex(ctx.get(), output + len, &len)) {
+    if (!EVP_DecryptFinal_ex(ctx, output + len, &len)) {
         dprintf(D_ALWAYS, "Condor_Crypt_AESGCM::decrypt: ERROR: failed due to finalize decryption and check of tag.\n");
        return false;
     }
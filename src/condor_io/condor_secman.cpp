@@ -1695,9 +1695,13 @@ SecManStartCommand::sendAuthInfo_inner()
 		CondorVersionInfo ver_info(m_remote_version.c_str());
 		m_sock->set_peer_version(&ver_info);
 	}
+	bool peer_binary_classads = false;
+	m_auth_info.LookupBool( ATTR_SEC_BINARY_CLASSADS, peer_binary_classads );
+	m_sock->set_peer_binary_classads( peer_binary_classads );
 
-	// fill in our version
+	// fill in our version, and that we can read binary ClassAds
 	m_auth_info.Assign(ATTR_SEC_REMOTE_VERSION,CondorVersion());
+	m_auth_info.Assign(ATTR_SEC_BINARY_CLASSADS, true);
 
 	// fill in return address, if we are a daemon
 	char const* dcss = global_dc_sinful();
@@ -1985,6 +1989,11 @@ SecManStartCommand::receiveAuthInfo_inner()
 				CondorVersionInfo ver_info(m_remote_version.c_str());
 				m_sock->set_peer_version(&ver_info);
 			}
+			m_auth_info.Delete(ATTR_SEC_BINARY_CLASSADS);
+			m_sec_man.sec_copy_attribute( m_auth_info, auth_response, ATTR_SEC_BINARY_CLASSADS );
+			bool peer_binary_classads = false;
+			m_auth_info.LookupBool(ATTR_SEC_BINARY_CLASSADS, peer_binary_classads);
+			m_sock->set_peer_binary_classads(peer_binary_classads);
 			m_sec_man.sec_copy_attribute( m_auth_info, auth_response, ATTR_SEC_ENACT );
 			m_sec_man.sec_copy_attribute( m_auth_info, auth_response, ATTR_SEC_AUTHENTICATION_METHODS_LIST );
 			m_sec_man.sec_copy_attribute( m_auth_info, auth_response, ATTR_SEC_AUTHENTICATION_METHODS );
@@ -35,6 +35,9 @@
 #define MAX_HEADER_SIZE MAC_SIZE + NORMAL_HEADER_SIZE
 
 #define MAX_MESSAGE_SIZE (1024*1024)
+	// AES-GCM packets are coalesced up to this much plaintext, well below
+	// the 1MB packet limit enforced by receivers
+#define AESGCM_MAX_PACKET_SIZE (256*1024)
 
 /**************************************************************/
 
@@ -99,6 +102,8 @@ ReliSock::ReliSock(const ReliSock & orig) : Sock(orig),
 	ASSERT(buf);
 	serialize(buf);			// put the state into the new sock
 	delete [] buf;
+		// the peer expects the clone to know the names it has sent
+	m_classad_wire = orig.m_classad_wire;
 }
 
 Stream *
@@ -140,6 +145,7 @@ ReliSock::close()
 	m_final_recv_header = false;
 	m_send_md_ctx.reset();
 	m_recv_md_ctx.reset();
+	m_classad_wire = ClassAdWireState();
 
 	// then invoke close() in parent class to close fd etc
 	return Sock::close();
@@ -646,6 +652,19 @@ ReliSock::put_bytes_after_encryption(const void *dta, int sz) {
 	int		header_size = isOutgoing_Hash_on() ? MAX_HEADER_SIZE:NORMAL_HEADER_SIZE;
 	for(nw=0;;) {
 		
+		if (snd_msg.buf.full() && get_encryption() &&
+			crypto_state_->m_keyInfo.getProtocol() == CONDOR_AESGCM &&
+			snd_msg.buf.max_size() < AESGCM_MAX_PACKET_SIZE)
+		{
+				// AES-GCM pays a fixed cost per packet for the IV setup
+				// and tag, so grow the packet instead of sending it in
+				// CONDOR_IO_BUF_SIZE pieces; most messages are then
+				// encrypted with a single call at end_of_message().
+				// snd_packet() shrinks it back once the message is sent.
+			snd_msg.buf.grow_buf(MIN(MAX(2 * snd_msg.buf.max_size(), CONDOR_IO_BUF_SIZE),
+			                         AESGCM_MAX_PACKET_SIZE));
+		}
+
 		if (snd_msg.buf.full()) {
 			int retval = snd_msg.snd_packet(peer_description(), _sock, FALSE, _timeout);
 			// This would block and the user asked us to work non-buffered - force the
@@ -1259,6 +1278,9 @@ int ReliSock::SndMsg::snd_packet( char const *peer_description, int _sock, int e
         
 	if( end ) {
 		buf.dealloc_buf(); // save space, now that we are done sending
+			// an AES-GCM message may have grown the packet, start the
+			// next one at the usual size again
+		buf.shrink_buf(CONDOR_IO_BUF_SIZE);
 	}
 	return TRUE;
 }
@@ -58,6 +58,7 @@ Stream :: Stream() :
 	decrypt_buf_len(0),
 	m_peer_description_str(NULL),
 	m_peer_version(NULL),
+	m_peer_binary_classads(false),
 	m_deadline_time(0),
 	ignore_timeout_multiplier(false)
 {
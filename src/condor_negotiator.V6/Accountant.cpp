@@ -84,6 +84,7 @@ Accountant::Accountant():
   HalfLifePeriod = 1.0f;
   LastUpdateTime = 0;
   MaxAcctLogSize = 1000000;
+  BackgroundLogRotation = false;
   NiceUserPriorityFactor = 1e10;
   RemoteUserPriorityFactor = 1e7;
   hgq_root_group = NULL;
@@ -155,6 +156,7 @@ void Accountant::Initialize(GroupEntry* root_group)
   }
 
   MaxAcctLogSize = param_integer("MAX_ACCOUNTANT_DATABASE_SIZE",1000000);
+  BackgroundLogRotation = param_boolean("CLASSAD_LOG_BACKGROUND_ROTATION", false);
 
   tmp = param("SPOOL");
   if(tmp) {
@@ -842,28 +844,54 @@ void Accountant::UpdatePriorities()
 
   AcctLog->CommitTransaction();
 
+  CheckAcctLogSize();
+}
+
+void Accountant::CheckAcctLogSize()
+{
+  // Finish a truncation that is running in the background
+  if( AcctLog->BackgroundTruncLogInProgress() ) {
+	  bool rotated = false;
+	  if( !AcctLog->PollBackgroundTruncLog(&rotated) && rotated ) {
+		  AcctLogTruncated();
+	  }
+	  return;
+  }
+
   // Check if the log needs to be truncated
   struct stat statbuf;
   if( stat(LogFileName.c_str(),&statbuf) ) {
     dprintf( D_ALWAYS, "ERROR in Accountant::UpdatePriorities - "
 			 "can't stat database (%s)", LogFileName.c_str() );
   } else if( statbuf.st_size > MaxAcctLogSize ) {
+	  if( BackgroundLogRotation && AcctLog->BeginBackgroundTruncLog() ) {
+		  dprintf( D_ACCOUNTANT, "Accountant::UpdatePriorities - "
+				   "truncating database in the background (prev size=%lu)\n",
+				   (unsigned long)statbuf.st_size );
+		  return;
+	  }
 	  AcctLog->TruncLog();
 	  dprintf( D_ACCOUNTANT, "Accountant::UpdatePriorities - "
 			   "truncating database (prev size=%lu)\n", 
 			   (unsigned long)statbuf.st_size ); 
-		  // Now that we truncated, check the size, and allow it to
-		  // grow to at least double in size before truncating again.
-	  if( stat(LogFileName.c_str(),&statbuf) ) {
-		  dprintf( D_ALWAYS, "ERROR in Accountant::UpdatePriorities - "
-				   "can't stat database (%s)", LogFileName.c_str() );
-	  } else {
-		  if( statbuf.st_size * 2 > MaxAcctLogSize ) {
-			  MaxAcctLogSize = statbuf.st_size * 2;
-			  dprintf( D_ACCOUNTANT, "Database has grown, expanding "
-					   "MAX_ACCOUNTANT_DATABASE_SIZE to %d\n", 
-					   MaxAcctLogSize );
-		  }
+	  AcctLogTruncated();
+  }
+}
+
+void Accountant::AcctLogTruncated()
+{
+	  // Now that we truncated, check the size, and allow it to
+	  // grow to at least double in size before truncating again.
+  struct stat statbuf;
+  if( stat(LogFileName.c_str(),&statbuf) ) {
+	  dprintf( D_ALWAYS, "ERROR in Accountant::UpdatePriorities - "
+			   "can't stat database (%s)", LogFileName.c_str() );
+  } else {
+	  if( statbuf.st_size * 2 > MaxAcctLogSize ) {
+		  MaxAcctLogSize = statbuf.st_size * 2;
+		  dprintf( D_ACCOUNTANT, "Database has grown, expanding "
+				   "MAX_ACCOUNTANT_DATABASE_SIZE to %d\n", 
+				   MaxAcctLogSize );
 	  }
   }
 }
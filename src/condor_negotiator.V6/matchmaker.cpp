@@ -21,6 +21,7 @@
 #include <math.h>
 #include <float.h>
 #include <set>
+#include <unordered_map>
 #include "condor_state.h"
 #include "condor_debug.h"
 #include "condor_config.h"
@@ -41,6 +42,7 @@
 #include "condor_daemon_core.h"
 #include "selector.h"
 #include "consumption_policy.h"
+#include "hashkey.h"
 #include "condor_classad.h"
 #include "subsystem_info.h"
 #include "authentication.h"
@@ -78,6 +80,12 @@ typedef int (*lessThanFunc)(ClassAd*, ClassAd*, void*);
 char const *RESOURCES_IN_USE_BY_USER_FN_NAME = "ResourcesInUseByUser";
 char const *RESOURCES_IN_USE_BY_USERS_GROUP_FN_NAME = "ResourcesInUseByUsersGroup";
 
+// knobs that are read for every request or every match, looked up once per reconfig
+static param_bool_handle allow_pslot_preemption_knob("ALLOW_PSLOT_PREEMPTION", false);
+static param_bool_handle negotiator_depth_first_knob("NEGOTIATOR_DEPTH_FIRST", false);
+static param_bool_handle ignore_user_priorities_knob("NEGOTIATOR_IGNORE_USER_PRIORITIES", false);
+static param_int_handle negotiator_num_threads_knob("NEGOTIATOR_NUM_THREADS", 1);
+
 GCC_DIAG_OFF(float-equal)
 
 class NegotiationCycleStats
@@ -118,6 +126,9 @@ public:
     int pies;
     int pie_spins;
 
+    int matchlist_cache_hits;
+    int matchlist_cache_misses;
+
     // set of unique active schedd, id by sinful strings:
     std::set<std::string> active_schedds;
 
@@ -155,6 +166,8 @@ NegotiationCycleStats::NegotiationCycleStats():
 	rejections(0),
     pies(0),
     pie_spins(0),
+    matchlist_cache_hits(0),
+    matchlist_cache_misses(0),
     active_schedds(),
     active_submitters(),
     submitters_share_limit(),
@@ -390,9 +403,9 @@ Matchmaker ()
 	stashedAds = new AdHash(hashFunction);
 
 	MatchList = NULL;
-	cachedAutoCluster = -1;
-	cachedName = NULL;
-	cachedAddr = NULL;
+	matchListCacheEntries = 0;
+	matchListCacheMaxLists = 1;
+	matchListCacheMaxEntries = INT_MAX;
 
 	want_globaljobprio = false;
 	want_matchlist_caching = false;
@@ -400,6 +413,7 @@ Matchmaker ()
 	ConsiderPreemption = true;
 	ConsiderEarlyPreemption = false;
 	want_nonblocking_startd_contact = true;
+	m_useChangeFeed = false;
 
 	completedLastCycleTime = (time_t) 0;
 
@@ -432,9 +446,6 @@ Matchmaker ()
 	rejForConcurrencyLimit = 0;
 	rejForSubmitterCeiling = 0;
 
-	cachedPrio = 0;
-	cachedOnlyForStartdRank = false;
-
 		// just assign default values
 	want_inform_startd = true;
 	preemption_req_unstable = true;
@@ -474,11 +485,7 @@ Matchmaker::
 	delete NegotiatorPreJobRank;
 	delete NegotiatorPostJobRank;
 	delete sockCache;
-	if (MatchList) {
-		delete MatchList;
-	}
-	if ( cachedName ) free(cachedName);
-	if ( cachedAddr ) free(cachedAddr);
+	purgeMatchListCache();
 
 	free(NegotiatorName);
 	if (publicAd) delete publicAd;
@@ -768,6 +775,8 @@ reinitialize ()
 
 	want_globaljobprio = param_boolean("USE_GLOBAL_JOB_PRIOS",false);
 	want_matchlist_caching = param_boolean("NEGOTIATOR_MATCHLIST_CACHING",true);
+	matchListCacheMaxLists = param_integer("NEGOTIATOR_MATCHLIST_CACHE_SIZE",16,1);
+	matchListCacheMaxEntries = param_integer("NEGOTIATOR_MATCHLIST_CACHE_MAX_ENTRIES",1000000,0);
 	PublishCrossSlotPrios = param_boolean("NEGOTIATOR_CROSS_SLOT_PRIOS", false);
 	ConsiderPreemption = param_boolean("NEGOTIATOR_CONSIDER_PREEMPTION",true);
 	ConsiderEarlyPreemption = param_boolean("NEGOTIATOR_CONSIDER_EARLY_PREEMPTION",false);
@@ -838,6 +847,12 @@ reinitialize ()
 	m_JobConstraintStr.clear();
 	param(m_JobConstraintStr, "NEGOTIATOR_JOB_CONSTRAINT");
 
+		// The cached ads were filtered and prepared using the old
+		// settings, so start over with fresh ones.
+	m_useChangeFeed = param_boolean("NEGOTIATOR_USE_COLLECTOR_CHANGE_FEED", false);
+	m_publicFeed.clear();
+	m_privateFeed.clear();
+
 	num_negotiation_cycle_stats = param_integer("NEGOTIATION_CYCLE_STATS_LENGTH",3,0,MAX_NEGOTIATION_CYCLE_STATS);
 	ASSERT( num_negotiation_cycle_stats <= MAX_NEGOTIATION_CYCLE_STATS );
 
@@ -1320,8 +1335,10 @@ compute_significant_attrs(ClassAdListDoesNotDeleteAds & startdAds)
 			sample_startd_ad = new ClassAd(*startd_ad);
 		}
 		classad::ClassAd::const_iterator attr_it;
-		for ( attr_it = startd_ad->begin(); attr_it != startd_ad->end(); attr_it++ ) {
-			startd_ad->GetExternalReferences( attr_it->second, external_references, true );
+		for ( const classad::ClassAd *scan = startd_ad; scan; scan = scan->GetChainedParentAd() ) {
+			for ( attr_it = scan->begin(); attr_it != scan->end(); attr_it++ ) {
+				startd_ad->GetExternalReferences( attr_it->second, external_references, true );
+			}
 		}
 	}	// while startd_ad
 
@@ -1562,8 +1579,7 @@ negotiationTime ()
 
 	// We need to nuke our MatchList from the previous negotiation cycle,
 	// since a different set of machines may now be available.
-	if (MatchList) delete MatchList;
-	MatchList = NULL;
+	purgeMatchListCache();
 
 	ScheddsTimeInCycle.clear();
 
@@ -2542,6 +2558,11 @@ trimStartdAds_ShutdownLogic(ClassAdListDoesNotDeleteAds &startdAds)
 			myCurrentTime = now;
 			ad->LookupInteger(ATTR_MY_CURRENT_TIME,myCurrentTime);
 			ExprTree *old_currtime = ad->Remove(ATTR_CURRENT_TIME);
+			if ( old_currtime && ad->GetChainedParentAd() &&
+				 old_currtime == ad->GetChainedParentAd()->Lookup(ATTR_CURRENT_TIME) ) {
+				// a chained ad hands back the parent's expression, which stays in the parent
+				old_currtime = old_currtime->Copy();
+			}
 			ad->Assign(ATTR_CURRENT_TIME,myCurrentTime + threshold); // change time
 
 			// Now that CurrentTime is set into the future, evaluate
@@ -2745,14 +2766,24 @@ obtainAdsFromCollector (
     //
 	CondorQuery publicQuery(ANY_AD);
 	std::string constraint;
-	if (!m_SubmitterConstraintStr.empty()) {
+	if (m_useChangeFeed) {
+			// The slot and submitter constraints are applied as the
+			// ads arrive, since an ad that stops matching them has to
+			// reach us for us to drop it.
+		publicQuery.addORConstraint("(MyType == \"Submitter\")");
+		publicQuery.addORConstraint("(MyType == \"Machine\")");
+		addChangeFeedToQuery(publicQuery, m_publicFeed);
+		addChangeFeedToQuery(privateQuery, m_privateFeed);
+	} else if (!m_SubmitterConstraintStr.empty()) {
 		formatstr(constraint, "((MyType == \"Submitter\") && (%s))",
 		          m_SubmitterConstraintStr.c_str());
 		publicQuery.addORConstraint(constraint.c_str());
 	} else {
 		publicQuery.addORConstraint("(MyType == \"Submitter\")");
 	}
-    if (strSlotConstraint && strSlotConstraint[0]) {
+    if (m_useChangeFeed) {
+		// already done
+    } else if (strSlotConstraint && strSlotConstraint[0]) {
         formatstr(constraint, "((MyType == \"Machine\") && (%s))", strSlotConstraint);
         publicQuery.addORConstraint(constraint.c_str());
     } else {
@@ -2763,7 +2794,9 @@ obtainAdsFromCollector (
 	// Ask for that projection.
 
 	if (!ConsiderPreemption) {
-		const char *projectionString =
+		// MyAddress is needed to find the ad in the change feed cache.
+		const char *projectionString = m_useChangeFeed ?
+			"ifThenElse(State == \"Claimed\",\"Name MyType MyAddress State Activity StartdIpAddr AccountingGroup Owner RemoteUser Requirements SlotWeight ConcurrencyLimits\",\"\") " :
 			"ifThenElse(State == \"Claimed\",\"Name MyType State Activity StartdIpAddr AccountingGroup Owner RemoteUser Requirements SlotWeight ConcurrencyLimits\",\"\") ";
 		publicQuery.setDesiredAttrsExpr(projectionString);
 
@@ -2788,6 +2821,25 @@ obtainAdsFromCollector (
 		return false;
 	}
 
+	ClassAdListDoesNotDeleteAds cachedPvtAdList;
+	if (m_useChangeFeed) {
+		bool fresh_private = applyChangeFeed(startdPvtAdList, m_privateFeed, false);
+		bool fresh_public = applyChangeFeed(allAds, m_publicFeed, true);
+		dprintf(D_ALWAYS, "  Change feed: %s private ads, %s public ads\n",
+			fresh_private ? "fetched all" : "updated", fresh_public ? "fetched all" : "updated");
+
+			// The cycle modifies the ads it is given, so each cached ad
+			// gets an empty ad chained to it to hold the changes.
+		for (auto &entry : m_publicFeed.ads) {
+			ClassAd *ad = new ClassAd();
+			ad->ChainToAd(entry.second);
+			allAds.Insert(ad);
+		}
+		for (auto &entry : m_privateFeed.ads) {
+			cachedPvtAdList.Insert(entry.second);
+		}
+	}
+
 	dprintf(D_ALWAYS, "  Sorting %d ads ...\n",allAds.MyLength());
 
 	allAds.Open();
@@ -2813,33 +2865,10 @@ obtainAdsFromCollector (
 				continue;
 			}
 
-			// Next, let's transform the ad. The first thing we might
-			// do is replace the Requirements attribute with whatever
-			// we find in NegotiatorRequirements
-			ExprTree  *negReqTree, *reqTree;
-			const char *subReqs;
-			subReqs = NULL;
-			negReqTree = reqTree = NULL;
-			negReqTree = ad->LookupExpr(ATTR_NEGOTIATOR_REQUIREMENTS);
-			if ( negReqTree != NULL ) {
-
-				// Save the old requirements expression
-				reqTree = ad->LookupExpr(ATTR_REQUIREMENTS);
-				if( reqTree != NULL ) {
-					// Now, put the old requirements back into the ad
-					// (note: ExprTreeToString uses a static buffer, so do not
-					//        deallocate the buffer it returns)
-					std::string attrn = "Saved";
-					attrn += ATTR_REQUIREMENTS;
-					subReqs = ExprTreeToString(reqTree);
-					ad->AssignExpr(attrn, subReqs);
-				}
-		
-				// Get the requirements expression we're going to
-				// subsititute in, and convert it to a string...
-				// Sadly, this might be the best interface :(
-				subReqs = ExprTreeToString(negReqTree);
-				ad->AssignExpr(ATTR_REQUIREMENTS, subReqs);
+			// Next, let's transform the ad; ads from the change feed
+			// cache were transformed when they arrived.
+			if ( ! m_useChangeFeed) {
+				TransformMachineAdRequirements(ad);
 			}
 
 			if( reevaluate_ad && newSequence != -1 ) {
@@ -2904,7 +2933,8 @@ obtainAdsFromCollector (
 					MapEntry *me = new MapEntry;
 					me->sequenceNum = newSequence;
 					me->remoteHost = strdup(remoteHost);
-					me->oldAd = new ClassAd(*ad);
+					me->oldAd = new ClassAd();
+					me->oldAd->CopyFromChain(*ad);
 					stashedAds->insert(adID, me);
 				} else {
 					/*
@@ -2941,7 +2971,9 @@ obtainAdsFromCollector (
 				ad->AssignExpr(ATTR_SLOT_WEIGHT, slotWeightStr);
 			}
 
-			OptimizeMachineAdForMatchmaking( ad );
+			if ( ! m_useChangeFeed) {
+				OptimizeMachineAdForMatchmaking( ad );
+			}
 
 			startdAds.Insert(ad);
 		} else if( !strcmp(GetMyTypeName(*ad),SUBMITTER_ADTYPE) ) {
@@ -3038,7 +3070,7 @@ obtainAdsFromCollector (
 
 	// Map slot names to slot Classads, used by pslotMultiMatch() to
 	// quickly find a given dslot ad.
-	if (param_boolean("ALLOW_PSLOT_PREEMPTION", false))  {
+	if (allow_pslot_preemption_knob.get())  {
 		ClassAd *ad;
 		std::string name;
 		startdAds.Open();
@@ -3049,7 +3081,7 @@ obtainAdsFromCollector (
 		}
 	}
 
-	MakeClaimIdHash(startdPvtAdList,claimIds);
+	MakeClaimIdHash(m_useChangeFeed ? cachedPvtAdList : startdPvtAdList, claimIds);
 
 	dprintf(D_ALWAYS, "Got ads: %d public and %lu private\n",
 	        allAds.MyLength(),claimIds.size());
@@ -3060,6 +3092,147 @@ obtainAdsFromCollector (
 	return true;
 }
 
+void
+Matchmaker::TransformMachineAdRequirements(ClassAd *ad)
+{
+	// Replace the Requirements attribute with whatever
+	// we find in NegotiatorRequirements
+	ExprTree  *negReqTree, *reqTree;
+	const char *subReqs;
+	subReqs = NULL;
+	negReqTree = reqTree = NULL;
+	negReqTree = ad->LookupExpr(ATTR_NEGOTIATOR_REQUIREMENTS);
+	if ( negReqTree != NULL ) {
+
+		// Save the old requirements expression
+		reqTree = ad->LookupExpr(ATTR_REQUIREMENTS);
+		if( reqTree != NULL ) {
+			// Now, put the old requirements back into the ad
+			// (note: ExprTreeToString uses a static buffer, so do not
+			//        deallocate the buffer it returns)
+			std::string attrn = "Saved";
+			attrn += ATTR_REQUIREMENTS;
+			subReqs = ExprTreeToString(reqTree);
+			ad->AssignExpr(attrn, subReqs);
+		}
+
+		// Get the requirements expression we're going to
+		// subsititute in, and convert it to a string...
+		// Sadly, this might be the best interface :(
+		subReqs = ExprTreeToString(negReqTree);
+		ad->AssignExpr(ATTR_REQUIREMENTS, subReqs);
+	}
+}
+
+void
+Matchmaker::ChangeFeedCache::clear()
+{
+	for (auto &entry : ads) {
+		delete entry.second;
+	}
+	ads.clear();
+	epoch.clear();
+	sequence = -1;
+}
+
+void
+Matchmaker::addChangeFeedToQuery(CondorQuery &query, const ChangeFeedCache &cache)
+{
+	std::string value;
+	formatstr(value, "%lld", cache.sequence);
+	query.addExtraAttribute(ATTR_CHANGE_FEED_SINCE, value.c_str());
+	QuoteAdStringValue(cache.epoch.c_str(), value);
+	query.addExtraAttribute(ATTR_CHANGE_FEED_EPOCH, value.c_str());
+}
+
+// Fold the results of a change feed query into the cache, taking
+// ownership of the ads in results.  Returns true if the collector sent
+// all of the ads rather than just the changes.
+bool
+Matchmaker::applyChangeFeed(ClassAdList &results, ChangeFeedCache &cache, bool machine_ads_are_public)
+{
+	ClassAd *ad;
+	ClassAd *reply = NULL;
+	results.Open();
+	while ((ad = results.Next())) {
+		if (strcmp(GetMyTypeName(*ad), CHANGE_FEED_ADTYPE) == 0) {
+			reply = ad;
+			results.Remove(ad);
+			break;
+		}
+	}
+
+		// A collector that doesn't know about the change feed sends
+		// everything, just as if it had told us to start over.
+	bool reset = true;
+	std::string removed;
+	if (reply) {
+		reply->LookupBool(ATTR_CHANGE_FEED_RESET, reset);
+		reply->LookupString(ATTR_CHANGE_FEED_REMOVED, removed);
+	}
+	if (reset) {
+		cache.clear();
+	} else {
+		StringTokenIterator keys(removed, 100, "\n");
+		const std::string *key;
+		while ((key = keys.next_string())) {
+			auto it = cache.ads.find(*key);
+			if (it != cache.ads.end()) {
+				delete it->second;
+				cache.ads.erase(it);
+			}
+		}
+	}
+	if (reply) {
+		reply->LookupString(ATTR_CHANGE_FEED_EPOCH, cache.epoch);
+		reply->LookupInteger(ATTR_CHANGE_FEED_SEQUENCE, cache.sequence);
+		delete reply;
+	}
+
+	results.Open();
+	while ((ad = results.Next())) {
+		results.Remove(ad);
+
+		const char *mytype = machine_ads_are_public ? GetMyTypeName(*ad) : STARTD_ADTYPE;
+		bool is_machine = strcmp(mytype, STARTD_ADTYPE) == 0;
+		AdNameHashKey hk;
+		if ( ! (is_machine ? makeStartdAdHashKey(hk, ad) : makeScheddAdHashKey(hk, ad))) {
+			delete ad;
+			continue;
+		}
+		MyString hkString;
+		hk.sprint(hkString);
+		std::string key = mytype;
+		key += " ";
+		key += hkString.Value();
+
+		auto it = cache.ads.find(key);
+		if (it != cache.ads.end()) {
+			delete it->second;
+			cache.ads.erase(it);
+		}
+
+		if (machine_ads_are_public) {
+			const char *constraint = is_machine ? strSlotConstraint : m_SubmitterConstraintStr.c_str();
+			if (constraint && constraint[0] && ! EvalExprBool(ad, constraint)) {
+				delete ad;
+				continue;
+			}
+			if (is_machine) {
+				TransformMachineAdRequirements(ad);
+				double slot_weight;
+				if (!ad->LookupFloat(ATTR_SLOT_WEIGHT, slot_weight)) {
+					ad->AssignExpr(ATTR_SLOT_WEIGHT, slotWeightStr);
+				}
+				OptimizeMachineAdForMatchmaking(ad);
+			}
+		}
+		cache.ads[key] = ad;
+	}
+
+	return reset;
+}
+
 void
 Matchmaker::OptimizeMachineAdForMatchmaking(ClassAd *ad)
 {
@@ -3099,12 +3272,12 @@ Matchmaker::OptimizeJobAdForMatchmaking(ClassAd *ad)
 std::map<std::string, std::vector<std::string> > childClaimHash;
 
 void
-Matchmaker::MakeClaimIdHash(ClassAdList &startdPvtAdList, ClaimIdHash &claimIds)
+Matchmaker::MakeClaimIdHash(ClassAdListDoesNotDeleteAds &startdPvtAdList, ClaimIdHash &claimIds)
 {
 	ClassAd *ad;
 	startdPvtAdList.Open();
 
-	bool pslotPreempt = param_boolean("ALLOW_PSLOT_PREEMPTION", false);
+	bool pslotPreempt = allow_pslot_preemption_knob.get();
 	childClaimHash.clear();
 
 	while( (ad = startdPvtAdList.Next()) ) {
@@ -3961,8 +4134,10 @@ negotiate(char const* groupName, char const *submitterName, const ClassAd *submi
 
 			// 2e(iii). if the matchmaking protocol failed, do not consider the
 			//			startd again for this negotiation cycle.
-			if (result == MM_BAD_MATCH)
+			if (result == MM_BAD_MATCH) {
 				startdAds.Remove (offer);
+				offerConsumed(offer);
+			}
 
 			// 2e(iv).  if the matchmaking protocol failed to talk to the
 			//			schedd, invalidate the connection and return
@@ -4013,6 +4188,7 @@ negotiate(char const* groupName, char const *submitterName, const ClassAd *submi
     		offer->LookupBool(ATTR_WANT_AD_REVAULATE, reevaluate_ad);
     		if (reevaluate_ad) {
     			reeval(offer);
+    			offerChanged(offer);
         		// Shuffle this resource to the end of the list.  This way, if
         		// two resources with the same RANK match, we'll hand them out
         		// in a round-robin way
@@ -4022,13 +4198,14 @@ negotiate(char const* groupName, char const *submitterName, const ClassAd *submi
                 // 2g.  Delete ad from list so that it will not be considered again in
 		        // this negotiation cycle
     			startdAds.Remove(offer);
+    			offerConsumed(offer);
     		}
             // traditional match cost is just slot weight expression
             match_cost = accountant.GetSlotWeight(offer);
         }
         dprintf(D_FULLDEBUG, "Match completed, match cost= %g\n", match_cost);
 
-		if (param_boolean("NEGOTIATOR_DEPTH_FIRST", false)) {
+		if (negotiator_depth_first_knob.get()) {
 			schedd_will_match = jobsInSlot(request, *offer);
 		}
 
@@ -4275,21 +4452,39 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 	request.LookupInteger(ATTR_AUTO_CLUSTER_ID, requestAutoCluster);
 
 		// If this incoming job is from the same user, same schedd,
-		// and is in the same autocluster, and we have a MatchList cache,
-		// then we can just pop off
-		// the top entry in our MatchList if we have one.  The
+		// and is in the same autocluster as a job we have a MatchList
+		// cached for, then we can just pop off
+		// the top entry in that MatchList if we have one.  The
 		// MatchList is essentially just a sorted cache of the machine
 		// ads that match jobs of this type (i.e. same autocluster).
-	if ( MatchList &&
-		 cachedAutoCluster != -1 &&
-		 cachedAutoCluster == requestAutoCluster &&
-		 cachedPrio == preemptPrio &&
-		 cachedOnlyForStartdRank == only_for_startdrank &&
-		 strcmp(cachedName,submitterName)==0 &&
-		 strcmp(cachedAddr,scheddAddr)==0 &&
-		 MatchList->cache_still_valid(request,PreemptionReq,PreemptionRank,
+	MatchList = NULL;
+	std::list<MatchListCacheEntry>::iterator cached = matchListCache.end();
+	if ( requestAutoCluster != -1 ) {
+		for ( cached = matchListCache.begin(); cached != matchListCache.end(); ++cached ) {
+			if ( cached->autoCluster == requestAutoCluster &&
+				 cached->preemptPrio == preemptPrio &&
+				 cached->onlyForStartdRank == only_for_startdrank &&
+				 cached->submitterName == submitterName &&
+				 cached->scheddAddr == scheddAddr ) {
+				break;
+			}
+		}
+	}
+	if ( cached != matchListCache.end() &&
+		 ! cached->matchList->cache_still_valid(request,PreemptionReq,PreemptionRank,
 					preemption_req_unstable,preemption_rank_unstable) )
 	{
+		matchListCacheEntries -= cached->matchList->capacity();
+		delete cached->matchList;
+		matchListCache.erase(cached);
+		cached = matchListCache.end();
+	}
+	if ( cached != matchListCache.end() )
+	{
+		matchListCache.splice(matchListCache.begin(), matchListCache, cached);
+		MatchList = cached->matchList;
+		negotiation_cycle_stats[0]->matchlist_cache_hits++;
+
 		// we can use cached information.  pop off the best
 		// candidate from our sorted list.
 		while( (cached_bestSoFar = MatchList->pop_candidate(candidateDslotClaims)) ) {
@@ -4338,11 +4533,12 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 		return cached_bestSoFar;
 	}
 
-		// Delete our old MatchList, since we know that if we made it here
-		// we no longer are dealing with a job from the same autocluster.
-		// (someday we will store it in case we see another job with
-		// the same autocluster, but we aren't that smart yet...)
-	DeleteMatchList();
+		// Slot ads mutated for pslot preemption must be restored before
+		// we look at them for a different request, which means giving
+		// up the cached lists that refer to the mutated ads.
+	if ( ! unmutatedSlotAds.empty() ) {
+		DeleteMatchList();
+	}
 
 		// Create a new MatchList cache if desired via config file,
 		// and the job ad contains autocluster info,
@@ -4351,12 +4547,16 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 		 requestAutoCluster != -1 &&	// job ad contains autocluster info
 		 startdAds.Length() > 0 )		// machines available
 	{
-		MatchList = new MatchListType( startdAds.Length() );
-		cachedAutoCluster = requestAutoCluster;
-		cachedPrio = preemptPrio;
-		cachedOnlyForStartdRank = only_for_startdrank;
-		cachedName = strdup(submitterName);
-		cachedAddr = strdup(scheddAddr);
+		MatchListCacheEntry entry;
+		entry.autoCluster = requestAutoCluster;
+		entry.submitterName = submitterName;
+		entry.scheddAddr = scheddAddr;
+		entry.preemptPrio = preemptPrio;
+		entry.onlyForStartdRank = only_for_startdrank;
+		entry.matchList = new MatchListType( startdAds.Length(), this );
+		matchListCache.push_front(entry);
+		MatchList = entry.matchList;
+		negotiation_cycle_stats[0]->matchlist_cache_misses++;
 	}
 
 
@@ -4368,13 +4568,16 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 	rejPreemptForRank = 0;
 	rejForSubmitterLimit = 0;
 
-	bool allow_pslot_preemption = param_boolean("ALLOW_PSLOT_PREEMPTION", false);
+	bool allow_pslot_preemption = allow_pslot_preemption_knob.get();
 	double allocatedWeight = 0.0;
 		// Set up for parallel matchmaking, if enabled
 	std::vector<ClassAd *> par_candidates;
 	std::vector<ClassAd *> par_matches;
+	std::vector<double> par_ranks;
+		// the request's Rank of each matching candidate
+	std::unordered_map<const ClassAd *, double> par_matched;
 
-	int num_threads =  param_integer("NEGOTIATOR_NUM_THREADS", 1);
+	int num_threads = negotiator_num_threads_knob.get();
 	if (num_threads > 1) {
 		startdAds.Open();
 		par_candidates.reserve(startdAds.Length());
@@ -4382,7 +4585,11 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 			par_candidates.push_back(candidate);
 		}
 		startdAds.Close();
-		ParallelIsAMatch(&request, par_candidates, par_matches, num_threads, false);
+		ParallelIsAMatch(&request, par_candidates, par_matches, num_threads, false, &par_ranks);
+		par_matched.reserve(par_matches.size());
+		for (size_t i = 0; i < par_matches.size(); i++) {
+			par_matched[par_matches[i]] = par_ranks[i];
+		}
 	}
 
 	// scan the offer ads
@@ -4437,9 +4644,7 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
         // the resource
 		bool is_a_match = false;
 		if (num_threads > 1) {
-			is_a_match = cp_sufficient &&
-				(par_matches.end() !=
-					std::find(par_matches.begin(), par_matches.end(), candidate));
+			is_a_match = cp_sufficient && par_matched.count(candidate);
 		} else {
 			is_a_match = cp_sufficient && IsAMatch(&request, candidate);
 		}
@@ -4606,7 +4811,9 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 			}
 		}
 
-		calculateRanks(request, candidate, candidatePreemptState, candidateRankValue, candidatePreJobRankValue, candidatePostJobRankValue, candidatePreemptRankValue);
+		auto par_match = par_matched.find(candidate);
+		calculateRanks(request, candidate, candidatePreemptState, candidateRankValue, candidatePreJobRankValue, candidatePostJobRankValue, candidatePreemptRankValue,
+			par_match != par_matched.end() ? &par_match->second : NULL);
 
 		if ( MatchList ) {
 			MatchList->add_candidate(
@@ -4699,6 +4906,9 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 			MatchList->sort();
 			dprintf(D_FULLDEBUG,"Finished sorting MatchList\n");
 		}
+		MatchList->shrink();
+		matchListCacheEntries += MatchList->capacity();
+		trimMatchListCache();
 		// Pop top candidate off the list to hand out as best match
 		bestSoFar = MatchList->pop_candidate(bestDslotClaims);
 	}
@@ -4828,7 +5038,8 @@ calculateRanks(ClassAd &request,
                double &candidateRankValue,
                double &candidatePreJobRankValue,
                double &candidatePostJobRankValue,
-               double &candidatePreemptRankValue
+               double &candidatePreemptRankValue,
+               const double *requestRankValue
               )
 {
 	if (m_staticRanks) {
@@ -4849,9 +5060,12 @@ calculateRanks(ClassAd &request,
 		"NEGOTIATOR_PRE_JOB_RANK",NegotiatorPreJobRank,
 		request, candidate);
 
-	// calculate the request's rank of the candidate
+	// calculate the request's rank of the candidate, unless that was
+	// done along with the parallel match
 	double tmp;
-	if(!EvalFloat(ATTR_RANK, &request, candidate, tmp)) {
+	if (requestRankValue) {
+		tmp = *requestRankValue;
+	} else if(!EvalFloat(ATTR_RANK, &request, candidate, tmp)) {
 		tmp = 0.0;
 	}
 	candidateRankValue = tmp;
@@ -5127,6 +5341,7 @@ matchmakingProtocol (ClassAd &request, ClassAd *offer,
         // At this point the match is fully vetted so we can also deduct
         // the resource assets.
         offer->Assign(CP_MATCH_COST, cp_deduct_assets(request, *offer));
+        offerChanged(offer);
 
 		if (MatchList)
 		{
@@ -5178,7 +5393,7 @@ Matchmaker::calculateSubmitterLimit(
 	submitterUsage = accountant.GetWeightedResourcesUsed( submitterName );
 	submitterShare = maxPrioValue/(submitterPrio*normalFactor);
 
-	if ( param_boolean("NEGOTIATOR_IGNORE_USER_PRIORITIES",false) ) {
+	if ( ignore_user_priorities_knob.get() ) {
 		submitterLimit = DBL_MAX;
 	} else {
 		submitterLimit = (submitterShare*slotWeightTotal)-submitterUsage;
@@ -5430,14 +5645,16 @@ reeval(ClassAd *ad)
 	ad->Assign("CurMatches", cur_matches);
 	if(oldAdEntry) {
 		delete(oldAdEntry->oldAd);
-		oldAdEntry->oldAd = new ClassAd(*ad);
+		oldAdEntry->oldAd = new ClassAd();
+		oldAdEntry->oldAd->CopyFromChain(*ad);
 	}
 }
 
 Matchmaker::MatchListType::
-MatchListType(int maxlen)
+MatchListType(int maxlen, const Matchmaker *owner)
 {
 	ASSERT(maxlen > 0);
+	m_owner = owner;
 	AdListArray = new AdListEntry[maxlen];
 	ASSERT(AdListArray);
 	adListMaxLen = maxlen;
@@ -5486,15 +5703,25 @@ peek_candidate()
 }
 #endif
 
+	// Entries for slots that were handed out to another request since
+	// the list was built are skipped.
+bool Matchmaker::MatchListType::
+skip_entry(const AdListEntry &entry) const
+{
+	return !entry.ad || m_owner->isOfferConsumed(entry.ad);
+}
+
 ClassAd* Matchmaker::MatchListType::
 pop_candidate(std::string &dslot_claims)
 {
 	ClassAd* candidate = NULL;
 
 	while ( adListHead < adListLen && !candidate ) {
-		candidate = AdListArray[adListHead].ad;
-		if ( candidate ) {
+		if ( !skip_entry(AdListArray[adListHead]) ) {
+			candidate = AdListArray[adListHead].ad;
 			dslot_claims = AdListArray[adListHead].DslotClaims;
+				// another list may have set this since we added the ad
+			candidate->Assign(ATTR_PREEMPT_STATE_, int(AdListArray[adListHead].PreemptStateValue));
 		}
 		adListHead++;
 	}
@@ -5524,6 +5751,7 @@ insert_candidate(ClassAd * candidate,
 	new_entry.PreemptRankValue = candidatePreemptRankValue;
 	new_entry.PreemptStateValue = candidatePreemptState;
 	new_entry.DslotClaims.clear();
+	new_entry.OfferVersion = m_owner->offerVersion(candidate);
 
 		// Hand-rolled insertion sort; as the list was previously sorted,
 		// we know this will be O(n).
@@ -5547,6 +5775,19 @@ cache_still_valid(ClassAd &request, ExprTree *preemption_req, ExprTree *preempti
 {
 	AdListEntry* next_entry = NULL;
 
+	// A slot that is still available but was changed by a match since
+	// it was added (e.g. a partitionable slot that gave up resources)
+	// may no longer match, or may rank differently.
+	for ( int i = adListHead; i < adListLen; i++ ) {
+		if ( !skip_entry(AdListArray[i]) &&
+			 AdListArray[i].OfferVersion != m_owner->offerVersion(AdListArray[i].ad) )
+		{
+			dprintf(D_FULLDEBUG,
+				"Cache invalidated due to a changed slot ad\n");
+			return false;
+		}
+	}
+
 	if ( !preemption_req_unstable && !preemption_rank_unstable ) {
 		return true;
 	}
@@ -5558,7 +5799,9 @@ cache_still_valid(ClassAd &request, ExprTree *preemption_req, ExprTree *preempti
 		int temp_adListHead = adListHead;
 
 		while ( temp_adListHead < adListLen && !candidate ) {
-			candidate = AdListArray[temp_adListHead].ad;
+			if ( !skip_entry(AdListArray[temp_adListHead]) ) {
+				candidate = AdListArray[temp_adListHead].ad;
+			}
 			temp_adListHead++;
 		}
 
@@ -5672,6 +5915,7 @@ add_candidate(ClassAd * candidate,
 	AdListArray[adListLen].PreemptRankValue = candidatePreemptRankValue;
 	AdListArray[adListLen].PreemptStateValue = candidatePreemptState;
 	AdListArray[adListLen].DslotClaims = candidateDslotClaims;
+	AdListArray[adListLen].OfferVersion = m_owner->offerVersion(candidate);
 
     // This hack allows me to avoid mucking with the pseudo-que-like semantics of MatchListType,
     // which ought to be replaced with something cleaner like std::deque<AdListEntry>
@@ -5685,20 +5929,8 @@ add_candidate(ClassAd * candidate,
 
 void Matchmaker::DeleteMatchList()
 {
-	// Delete our MatchList
-	if( MatchList ) {
-		delete MatchList;
-		MatchList = NULL;
-	}
-	cachedAutoCluster = -1;
-	if ( cachedName ) {
-		free(cachedName);
-		cachedName = NULL;
-	}
-	if ( cachedAddr ) {
-		free(cachedAddr);
-		cachedAddr = NULL;
-	}
+	// Delete our MatchList, and all the cached ones
+	purgeMatchListCache();
 
 	// And anytime we clear out our MatchList, we also want to restore
 	// any pslot ads that got mutated as part of pslot preemption back to their
@@ -5710,6 +5942,59 @@ void Matchmaker::DeleteMatchList()
 	unmutatedSlotAds.clear();
 }
 
+void Matchmaker::purgeMatchListCache()
+{
+	for (auto i = matchListCache.begin(); i != matchListCache.end(); i++) {
+		delete i->matchList;
+	}
+	matchListCache.clear();
+	matchListCacheEntries = 0;
+	MatchList = NULL;
+	consumedOffers.clear();
+	changedOfferVersions.clear();
+}
+
+	// Drop the least recently used match lists until the cache is
+	// within its limits.  The list in use now is always kept.
+void Matchmaker::trimMatchListCache()
+{
+	while ( matchListCache.size() > 1 &&
+			( (int)matchListCache.size() > matchListCacheMaxLists ||
+			  matchListCacheEntries > matchListCacheMaxEntries ) )
+	{
+		MatchListCacheEntry &oldest = matchListCache.back();
+		ASSERT( oldest.matchList != MatchList );
+		matchListCacheEntries -= oldest.matchList->capacity();
+		delete oldest.matchList;
+		matchListCache.pop_back();
+	}
+}
+
+void Matchmaker::offerConsumed(ClassAd *offer)
+{
+	if ( ! matchListCache.empty() ) {
+		consumedOffers.insert(offer);
+	}
+}
+
+void Matchmaker::offerChanged(ClassAd *offer)
+{
+	if ( ! matchListCache.empty() ) {
+		changedOfferVersions[offer]++;
+	}
+}
+
+bool Matchmaker::isOfferConsumed(const ClassAd *offer) const
+{
+	return consumedOffers.count(offer) != 0;
+}
+
+int Matchmaker::offerVersion(const ClassAd *offer) const
+{
+	auto i = changedOfferVersions.find(offer);
+	return i == changedOfferVersions.end() ? 0 : i->second;
+}
+
 int Matchmaker::MatchListType::
 sort_compare(const void* elem1, const void* elem2)
 {
@@ -5792,6 +6077,21 @@ sort()
 	already_sorted = true;
 }
 
+void Matchmaker::MatchListType::
+shrink()
+{
+	if ( adListLen >= adListMaxLen ) {
+		return;
+	}
+	AdListEntry *shorter = new AdListEntry[adListLen];
+	for ( int i = 0; i < adListLen; i++ ) {
+		shorter[i] = AdListArray[i];
+	}
+	delete [] AdListArray;
+	AdListArray = shorter;
+	adListMaxLen = adListLen;
+}
+
 
 void Matchmaker::
 init_public_ad()
@@ -6035,6 +6335,8 @@ Matchmaker::publishNegotiationCycleStats( ClassAd *ad )
         ATTR_LAST_NEGOTIATION_CYCLE_REJECTIONS,
         ATTR_LAST_NEGOTIATION_CYCLE_PIES,
         ATTR_LAST_NEGOTIATION_CYCLE_PIE_SPINS,
+        ATTR_LAST_NEGOTIATION_CYCLE_MATCH_LIST_CACHE_HITS,
+        ATTR_LAST_NEGOTIATION_CYCLE_MATCH_LIST_CACHE_MISSES,
         ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_DURATION,
         ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_CPU_TIME,
         ATTR_LAST_NEGOTIATION_CYCLE_CPU_TIME,
@@ -6089,6 +6391,8 @@ Matchmaker::publishNegotiationCycleStats( ClassAd *ad )
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_ACTIVE_SUBMITTER_COUNT, i, (int)s->active_submitters.size());
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PIES, i, s->pies );
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PIE_SPINS, i, s->pie_spins );
+		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_MATCH_LIST_CACHE_HITS, i, s->matchlist_cache_hits );
+		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_MATCH_LIST_CACHE_MISSES, i, s->matchlist_cache_misses );
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_DURATION, i, s->prefetch_duration );
 		// TODO Should we truncate these to integer values?
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_CPU_TIME, i, s->prefetch_cpu_time );
@@ -33,6 +33,8 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
+#include <list>
 #include <algorithm>
 
 typedef struct MapEntry {
@@ -92,7 +94,7 @@ class Matchmaker : public Service
 		void forwardAccountingData(std::set<std::string> &names);
 		void forwardGroupAccounting(CollectorList *cl, GroupEntry *ge);
 
-		void calculateRanks(ClassAd &request, ClassAd *offer, PreemptState candidatePreemptState, double &candidateRankValue, double &candidatePreJobRankValue, double &candidatePostJobRankValue, double &candidatePreemptRankValue);
+		void calculateRanks(ClassAd &request, ClassAd *offer, PreemptState candidatePreemptState, double &candidateRankValue, double &candidatePreJobRankValue, double &candidatePostJobRankValue, double &candidatePreemptRankValue, const double *requestRankValue = NULL);
 
 		void setDryRun(bool d) {m_dryrun = d;}
 		bool getDryRun() const {return m_dryrun;}
@@ -112,6 +114,22 @@ class Matchmaker : public Service
 		
 		// auxillary functions
 		bool obtainAdsFromCollector (ClassAdList &allAds, ClassAdListDoesNotDeleteAds &startdAds, ClassAdListDoesNotDeleteAds &submitterAds, std::set<std::string> &submitterNames, ClaimIdHash &claimIds );	
+		void TransformMachineAdRequirements(ClassAd *ad);
+
+		// Local copies of the collector's ads, kept up to date from the
+		// collector's change feed when NEGOTIATOR_USE_COLLECTOR_CHANGE_FEED
+		// is true, so that each cycle only fetches and prepares the ads
+		// that changed.  Keyed by MyType and the collector's hash key.
+		struct ChangeFeedCache {
+			ChangeFeedCache() : sequence(-1) {}
+			~ChangeFeedCache() { clear(); }
+			void clear();
+			std::string epoch;
+			long long sequence;
+			std::map<std::string, ClassAd *> ads;
+		};
+		void addChangeFeedToQuery(CondorQuery &query, const ChangeFeedCache &cache);
+		bool applyChangeFeed(ClassAdList &results, ChangeFeedCache &cache, bool machine_ads_are_public);
 		char * compute_significant_attrs(ClassAdListDoesNotDeleteAds & startdAds);
 		bool consolidate_globaljobprio_submitter_ads(ClassAdListDoesNotDeleteAds & submitterAds) const;
 
@@ -265,7 +283,7 @@ class Matchmaker : public Service
 			// rewrite the requirements expression to make matchmaking faster
 		void OptimizeJobAdForMatchmaking(ClassAd *ad);
 
-		void MakeClaimIdHash(ClassAdList &startdPvtAdList, ClaimIdHash &claimIds);
+		void MakeClaimIdHash(ClassAdListDoesNotDeleteAds &startdPvtAdList, ClaimIdHash &claimIds);
 		void addRemoteUserPrios( ClassAd* ad );
 		void addRemoteUserPrios( ClassAdListDoesNotDeleteAds &cal );
 		void insertNegotiatorMatchExprs(ClassAd *ad);
@@ -341,6 +359,10 @@ class Matchmaker : public Service
 		std::string m_SubmitterConstraintStr;
 		std::string m_JobConstraintStr;
 
+		bool m_useChangeFeed;
+		ChangeFeedCache m_publicFeed;
+		ChangeFeedCache m_privateFeed;
+
 		bool m_staticRanks;
 
 		StringList NegotiatorMatchExprNames;
@@ -403,6 +425,7 @@ class Matchmaker : public Service
 				PreemptRankValue = -(FLT_MAX);
 				PreemptStateValue = (Matchmaker::PreemptState)-1;
 				ad = NULL;
+				OfferVersion = 0;
 			}			  
 			double			RankValue;
 			double			PreJobRankValue;
@@ -411,6 +434,7 @@ class Matchmaker : public Service
 			PreemptState	PreemptStateValue;
 			MyString			DslotClaims;
 			ClassAd *ad;
+			int				OfferVersion;	// see offerVersion()
 		};
 
 		/** This class is just like ClassAdList, expept that it will
@@ -432,6 +456,16 @@ class Matchmaker : public Service
 		};
 
 		void DeleteMatchList();
+		void purgeMatchListCache();
+
+			// Called when a slot ad is handed out and removed from the
+			// startd ads of this cycle, and when a slot ad that is still
+			// available is modified by a match, so that cached match
+			// lists holding the ad do not use it.
+		void offerConsumed(ClassAd *offer);
+		void offerChanged(ClassAd *offer);
+		bool isOfferConsumed(const ClassAd *offer) const;
+		int offerVersion(const ClassAd *offer) const;
 
 		// List of matches.
 		// This list is essentially a list of sorted matching
@@ -444,6 +478,8 @@ class Matchmaker : public Service
 		// same autocluster, we can just pop the next candidate
 		// off of this list instead of traversing through all the
 		// machine ads and resorting.
+		// Lists for several autoclusters are kept in the match list
+		// cache below.
 		class MatchListType
 		{
 		public:
@@ -485,9 +521,12 @@ class Matchmaker : public Service
 					PreemptState candidatePreemptState,
 					const std::string &candidateDslotClaims);
 			void sort();
+				// Free the unused part of the list once it is complete.
+			void shrink();
 			int length() const { return adListLen - adListHead; }
+			int capacity() const { return adListMaxLen; }
 
-			MatchListType(int maxlen);
+			MatchListType(int maxlen, const Matchmaker *owner);
 			~MatchListType();
 
 			void increment_rejForSubmitterLimit() { m_rejForSubmitterLimit++; }
@@ -497,6 +536,8 @@ class Matchmaker : public Service
 			
 			// AdListEntry* peek_candidate();
 			static int sort_compare(const void*, const void*);
+			bool skip_entry(const AdListEntry &entry) const;
+			const Matchmaker *m_owner;
 			AdListEntry* AdListArray;			
 			int adListMaxLen;	// max length of AdListArray
 			int adListLen;		// current length of AdListArray
@@ -515,12 +556,27 @@ class Matchmaker : public Service
 			
 			
 		};
+		// The match list for the request being negotiated, if any.
 		MatchListType* MatchList;
-		int cachedAutoCluster;
-		char* cachedName;
-		char* cachedAddr;
-		double cachedPrio;
-		bool cachedOnlyForStartdRank;
+
+		// Match lists built for recent requests, most recently used
+		// first.  A list is reused for a later request with the same
+		// key.  All of them are purged at the start of each pie spin.
+		struct MatchListCacheEntry {
+			int autoCluster;
+			std::string submitterName;
+			std::string scheddAddr;
+			double preemptPrio;
+			bool onlyForStartdRank;
+			MatchListType *matchList;
+		};
+		std::list<MatchListCacheEntry> matchListCache;
+		int matchListCacheEntries;		// sum of capacity() of cached lists
+		int matchListCacheMaxLists;		// NEGOTIATOR_MATCHLIST_CACHE_SIZE
+		int matchListCacheMaxEntries;	// NEGOTIATOR_MATCHLIST_CACHE_MAX_ENTRIES
+		std::set<const ClassAd*> consumedOffers;
+		std::map<const ClassAd*, int> changedOfferVersions;
+		void trimMatchListCache();
 
         // set at startup/restart/reinit
         GroupEntry* hgq_root_group;
@@ -239,6 +239,19 @@ static void HandleFlushJobQueueLogTimer();
 static int dirty_notice_interval = 0;
 static void PeriodicDirtyAttributeNotification();
 static void ScheduleJobQueueLogFlush();
+static bool job_queue_group_commit = false;
+static int job_queue_group_commit_window = 0;
+static int job_queue_group_commit_pipe = -1;
+static int bulk_submit_max_procs = 10000;
+static int bulk_submit_max_columns = 1000;
+static int bulk_submit_max_bytes = 64*1024*1024;
+static bool background_job_queue_cleaning = false;
+static int clean_job_queue_timer_id = -1;
+static void ConfigureJobQueueGroupCommit();
+
+// knobs read for every new proc or queue query, looked up once per reconfig
+static param_bool_handle global_job_id_with_time_knob("GLOBAL_JOB_ID_WITH_TIME", true);
+static param_bool_handle condor_q_only_my_jobs_knob("CONDOR_Q_ONLY_MY_JOBS", true);
 
 bool qmgmt_all_users_trusted = false;
 static std::vector<std::string> super_users;
@@ -421,6 +434,7 @@ ConstructClassAdLogTableEntry<JobQueueJob*>::Delete(ClassAd* &ad) const
 			// in which case the actual destruction would be delayed until the transaction commit. i.e. here...
 			IncrementLiveJobCounter(scheduler.liveJobCounts, job->Universe(), job->Status(), -1);
 			if (job->ownerinfo) { IncrementLiveJobCounter(job->ownerinfo->live, job->Universe(), job->Status(), -1); }
+			scheduler.uncountJob(job);
 
 			if (job->Cluster()) {
 				job->Cluster()->DetachJob(job);
@@ -483,6 +497,7 @@ int GetSchedulerCapabilities(int /*mask*/, ClassAd & reply)
 {
 	reply.Assign( "LateMaterialize", scheduler.getAllowLateMaterialize() );
 	reply.Assign("LateMaterializeVersion", 2);
+	reply.Assign("BulkSubmit", true);
 	dprintf(D_ALWAYS, "GetSchedulerCapabilities called, returning\n");
 	dPrintAd(D_ALWAYS, reply);
 	return 0;
@@ -971,6 +986,7 @@ QmgmtPeer::QmgmtPeer()
 	transaction = NULL;
 	allow_protected_attr_changes_by_superuser = true;
 	readonly = false;
+	reply_deferred = false;
 
 	unset();
 }
@@ -1273,6 +1289,74 @@ InitQmgmt()
 
 	flush_job_queue_log_delay = param_integer("SCHEDD_JOB_QUEUE_LOG_FLUSH_DELAY",5,0);
 	dirty_notice_interval = param_integer("SCHEDD_JOB_QUEUE_NOTIFY_UPDATES",30,0);
+
+	job_queue_group_commit = param_boolean("SCHEDD_JOB_QUEUE_GROUP_COMMIT", false);
+	job_queue_group_commit_window = param_integer("SCHEDD_JOB_QUEUE_GROUP_COMMIT_WINDOW", 2, 0, 1000);
+
+	bulk_submit_max_procs = param_integer("SCHEDD_BULK_SUBMIT_MAX_PROCS", 10000, 1);
+	bulk_submit_max_columns = param_integer("SCHEDD_BULK_SUBMIT_MAX_COLUMNS", 1000, 1);
+	bulk_submit_max_bytes = param_integer("SCHEDD_BULK_SUBMIT_MAX_BYTES", 64*1024*1024, 1);
+	background_job_queue_cleaning = param_boolean("CLASSAD_LOG_BACKGROUND_ROTATION", false);
+	if (JobQueue) {
+		ConfigureJobQueueGroupCommit();
+	}
+}
+
+static int
+HandleJobQueueGroupCommitPipe(int pipe_end)
+{
+		// drain the wakeups, then collect every sync that has completed
+	char buf[64];
+	while (daemonCore->Read_Pipe(pipe_end, buf, sizeof(buf)) > 0) {}
+
+	std::vector<ClassAdLogGroupCommit::Batch> batches;
+	JobQueue->ProcessCompletedSyncs(&batches);
+	for (auto & batch : batches) {
+		scheduler.stats.JobQueueGroupCommitSize += batch.commits;
+		scheduler.stats.JobQueueSyncTime += batch.sync_time;
+	}
+	return TRUE;
+}
+
+static void
+ConfigureJobQueueGroupCommit()
+{
+	if ( ! job_queue_group_commit) {
+		JobQueue->DisableGroupCommit();
+		return;
+	}
+
+#ifdef WIN32
+	dprintf(D_ALWAYS, "SCHEDD_JOB_QUEUE_GROUP_COMMIT is not supported on this platform, ignoring it.\n");
+#else
+	if (job_queue_group_commit_pipe < 0) {
+		int pipe_ends[2];
+		int write_fd = -1;
+		if ( ! daemonCore->Create_Pipe(pipe_ends, true, false, true, true) ||
+			 ! daemonCore->Get_Pipe_FD(pipe_ends[1], &write_fd)) {
+			dprintf(D_ALWAYS, "Failed to create the job queue group commit pipe, group commit is disabled.\n");
+			return;
+		}
+		if (daemonCore->Register_Pipe(pipe_ends[0], "job queue group commit",
+				HandleJobQueueGroupCommitPipe, "HandleJobQueueGroupCommitPipe") < 0) {
+			dprintf(D_ALWAYS, "Failed to register the job queue group commit pipe, group commit is disabled.\n");
+			daemonCore->Close_Pipe(pipe_ends[0]);
+			daemonCore->Close_Pipe(pipe_ends[1]);
+			return;
+		}
+		job_queue_group_commit_pipe = write_fd;
+	}
+	if ( ! JobQueue->GroupCommitEnabled()) {
+		dprintf(D_ALWAYS, "Using group commit for the job queue log, window is %d ms\n", job_queue_group_commit_window);
+	}
+	JobQueue->EnableGroupCommit(job_queue_group_commit_window, job_queue_group_commit_pipe);
+#endif
+}
+
+bool
+JobQueueSyncPending()
+{
+	return JobQueue && JobQueue->SyncPending();
 }
 
 void
@@ -2044,6 +2128,8 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 	if( spool_cur_version != SPOOL_CUR_VERSION_SCHEDD_SUPPORTS ) {
 		WriteSpoolVersion(spool.Value(),SPOOL_MIN_VERSION_SCHEDD_WRITES,SPOOL_CUR_VERSION_SCHEDD_SUPPORTS);
 	}
+
+	ConfigureJobQueueGroupCommit();
 }
 
 
@@ -2057,6 +2143,37 @@ CleanJobQueue()
 	}
 }
 
+static void
+PollJobQueueCleaning()
+{
+	bool rotated = false;
+	if ( ! JobQueue || ! JobQueue->PollBackgroundTruncLog(&rotated)) {
+		daemonCore->Cancel_Timer(clean_job_queue_timer_id);
+		clean_job_queue_timer_id = -1;
+		if ( ! rotated) {
+			JobQueueDirty = true; // try again next time
+		}
+	}
+}
+
+	// the QUEUE_CLEAN_INTERVAL timer.  unlike CleanJobQueue, this
+	// may clean the job queue in the background.
+void
+PeriodicCleanJobQueue()
+{
+	if ( ! JobQueueDirty || JobQueue->BackgroundTruncLogInProgress()) {
+		return;
+	}
+	if (background_job_queue_cleaning && JobQueue->BeginBackgroundTruncLog()) {
+		dprintf(D_ALWAYS, "Cleaning job queue in the background...\n");
+		JobQueueDirty = false;
+		clean_job_queue_timer_id = daemonCore->Register_Timer(1, 1,
+			PollJobQueueCleaning, "PollJobQueueCleaning");
+		return;
+	}
+	CleanJobQueue();
+}
+
 
 void
 DestroyJobQueue( void )
@@ -2262,6 +2379,128 @@ int QmgmtHandleSendMaterializeData(int cluster_id, ReliSock * sock, MyString & s
 	return rval;
 }
 
+// set one attribute for the CONDOR_BulkSubmit RPC the way the CONDOR_SetAttribute RPC would.
+static int BulkSubmitSetAttribute(int cluster_id, int proc_id, const char * attr, const char * value, SetAttributeFlags_t flags, CondorError * err)
+{
+	// We do NOT want to include MyProxy password in the ClassAd (since it's a secret)
+	if (strcmp(attr, ATTR_MYPROXY_PASSWORD) == 0) {
+		return SetMyProxyPassword(cluster_id, proc_id, value);
+	}
+	return SetAttribute(cluster_id, proc_id, attr, value, flags, err);
+}
+
+// returns true if a CONDOR_BulkSubmit of num_procs rows of num_columns columns, whose
+// column names and cells add up to bytes, is within the SCHEDD_BULK_SUBMIT_MAX_* limits.
+// the byte limit also counts a std::string for every cell, so a table of empty cells
+// can't be large either.  the receiver checks this as it reads the request, so pass 0
+// for what it has not read yet.
+bool BulkSubmitWithinLimits(int num_procs, int num_columns, size_t bytes)
+{
+	if (num_procs < 0 || num_procs > bulk_submit_max_procs ||
+		num_columns < 0 || num_columns > bulk_submit_max_columns) {
+		return false;
+	}
+	size_t table_bytes = (size_t)num_procs * num_columns * sizeof(std::string);
+	return table_bytes + bytes <= (size_t)bulk_submit_max_bytes;
+}
+
+// handle the CONDOR_BulkSubmit RPC
+// this function sets the cluster ad attributes (if any) and then creates num_procs procs in the active cluster.
+// cells holds num_procs rows of columns.size() unparsed values, an empty cell means that the proc does not set that attribute.
+// everything is done inside the client's transaction, so the whole batch goes into the job queue log
+// with the client's CommitTransaction.  returns the number of procs created, or the NewProc error code.
+//
+int QmgmtHandleBulkSubmit(int cluster_id, int first_proc_id, const ClassAd * cluster_ad,
+	const std::vector<std::string> & columns, const std::vector<std::string> & cells, int num_procs,
+	SetAttributeFlags_t flags, CondorError * err, int &terrno)
+{
+	terrno = 0;
+	if ((cluster_id != active_cluster_num) || (cluster_id < 1)) {
+		terrno = EACCES;
+		dprintf(D_ALWAYS, "Failing remote BulkSubmit %d because it is not the active cluster\n", cluster_id);
+		return -1;
+	}
+
+	size_t num_columns = columns.size();
+	if (num_procs < 0 || cells.size() != (size_t)num_procs * num_columns) {
+		terrno = EINVAL;
+		dprintf(D_ALWAYS, "Failing remote BulkSubmit %d because the proc table is malformed\n", cluster_id);
+		return -1;
+	}
+	size_t bytes = 0;
+	for (const auto & column : columns) { bytes += column.size(); }
+	for (const auto & cell : cells) { bytes += cell.size(); }
+	if ( ! BulkSubmitWithinLimits(num_procs, (int)num_columns, bytes)) {
+		terrno = EINVAL;
+		dprintf(D_ALWAYS, "Failing remote BulkSubmit %d because it is larger than the SCHEDD_BULK_SUBMIT_MAX_* limits\n", cluster_id);
+		return -1;
+	}
+
+	// every proc in the batch is acknowledged by the single reply, so NoAck has no meaning here.
+	flags &= ~SetAttribute_NoAck;
+
+	double begin = _condor_debug_get_time_double();
+
+	if (cluster_ad) {
+		classad::ClassAdUnParser unparser;
+		unparser.SetOldClassAd( true, true );
+		std::string rhs;
+
+		errno = 0;
+		if (SetAttributeInt(cluster_id, -1, ATTR_CLUSTER_ID, cluster_id, flags) < 0) {
+			terrno = errno;
+			return -1;
+		}
+		for (auto it = cluster_ad->begin(); it != cluster_ad->end(); ++it) {
+			rhs.clear();
+			unparser.Unparse(rhs, it->second);
+			errno = 0;
+			if (BulkSubmitSetAttribute(cluster_id, -1, it->first.c_str(), rhs.c_str(), flags, err) < 0) {
+				terrno = errno;
+				dprintf(D_ALWAYS, "Failing remote BulkSubmit %d because %s could not be set in the cluster ad\n", cluster_id, it->first.c_str());
+				return -1;
+			}
+		}
+	}
+
+	for (int ix = 0; ix < num_procs; ++ix) {
+		errno = 0;
+		int proc_id = NewProc(cluster_id);
+		if (proc_id < 0) {
+			terrno = errno;
+			return proc_id;
+		}
+		if (proc_id != first_proc_id + ix) {
+			terrno = EINVAL;
+			dprintf(D_ALWAYS, "Failing remote BulkSubmit %d because proc %d was created when %d was expected\n",
+				cluster_id, proc_id, first_proc_id + ix);
+			return -1;
+		}
+
+		errno = 0;
+		if (SetAttributeInt(cluster_id, proc_id, ATTR_PROC_ID, proc_id, flags) < 0) {
+			terrno = errno;
+			return -1;
+		}
+		const std::string * row = &cells[ix * num_columns];
+		for (size_t col = 0; col < num_columns; ++col) {
+			if (row[col].empty()) continue;
+			errno = 0;
+			if (BulkSubmitSetAttribute(cluster_id, proc_id, columns[col].c_str(), row[col].c_str(), flags, err) < 0) {
+				terrno = errno;
+				dprintf(D_ALWAYS, "Failing remote BulkSubmit %d because %s could not be set in proc %d\n",
+					cluster_id, columns[col].c_str(), proc_id);
+				return -1;
+			}
+		}
+	}
+
+	scheduler.stats.BulkSubmitProcs += num_procs;
+	scheduler.stats.BulkSubmitRuntime += _condor_debug_get_time_double() - begin;
+
+	return num_procs;
+}
+
 // handle the CONDOR_SetJobFactory RPC
 // This function writes the submit digest_text into SPOOL in a file whose name is based on the cluster id
 // the filename argument is not used (it was used during 8.7 development, but abandoned in favor of spooling the digest)
@@ -2826,10 +3065,12 @@ unsetQSock()
 }
 
 
+static int handle_q_requests();
+static int handle_q_resume(Stream *sock);
+
 int
 handle_q(int cmd, Stream *sock)
 {
-	int	rval;
 	bool all_good;
 
 	all_good = setQSock((ReliSock*)sock);
@@ -2850,6 +3091,60 @@ handle_q(int cmd, Stream *sock)
 
 	BeginTransaction();
 
+	return handle_q_requests();
+}
+
+	// Called once the job queue log has been synced for a connection whose
+	// commit reply was deferred by group commit.  Finish the reply and
+	// then wait for the client's next request.
+static void
+send_deferred_q_reply(QmgmtPeer *peer)
+{
+	ReliSock *sock = peer->getReliSock();
+	peer->setReplyDeferred(false);
+	if ( ! sock->end_of_message()) {
+		dprintf(D_ALWAYS, "QMGR failed to send commit reply to %s\n", sock->peer_description());
+		delete peer;
+		delete sock;
+		return;
+	}
+	if (daemonCore->Register_Socket(sock, "QMGMT connection", handle_q_resume, "handle_q_resume", ALLOW) < 0) {
+		dprintf(D_ALWAYS, "QMGR failed to register connection from %s\n", sock->peer_description());
+		delete peer;
+		delete sock;
+		return;
+	}
+	daemonCore->Register_DataPtr(peer);
+}
+
+	// socket handler for a connection that was set aside by handle_q_requests
+static int
+handle_q_resume(Stream *sock)
+{
+	QmgmtPeer *peer = (QmgmtPeer *)daemonCore->GetDataPtr();
+	daemonCore->Cancel_Socket(sock);
+
+	if (Q_SOCK || ! setQmgmtConnectionInfo(peer)) {
+		// should never happen
+		dprintf(D_ALWAYS, "QMGR unable to resume connection from %s\n", sock->peer_description());
+		delete peer;
+		delete sock;
+		return KEEP_STREAM;
+	}
+
+	if (handle_q_requests() != KEEP_STREAM) {
+		delete sock;
+	}
+	return KEEP_STREAM;
+}
+
+	// process requests on Q_SOCK until the client goes away.  returns KEEP_STREAM
+	// if the connection was set aside to wait for a group commit, in which case the
+	// request loop is picked up again by handle_q_resume.
+static int
+handle_q_requests()
+{
+	int	rval;
 	bool may_fork = false;
 	ForkStatus fork_status = FORK_FAILED;
 	do {
@@ -2863,6 +3158,14 @@ handle_q(int cmd, Stream *sock)
 				break;
 			}
 		}
+
+		if( rval >= 0 && fork_status != FORK_CHILD && Q_SOCK->getReplyDeferred() ) {
+				// the reply to a commit is waiting on the job queue log sync,
+				// so park this connection and go back to the main loop.
+			QmgmtPeer *peer = getQmgmtConnectionInfo();
+			JobQueue->WhenDurable([peer]() { send_deferred_q_reply(peer); });
+			return KEEP_STREAM;
+		}
 	} while(rval >= 0);
 
 
@@ -3132,7 +3435,7 @@ int NewProcInternal(int cluster_id, int proc_id)
 	gjid += std::to_string( cluster_id );
 	gjid += ".";
 	gjid += std::to_string( proc_id );
-	if (param_boolean("GLOBAL_JOB_ID_WITH_TIME", true)) {
+	if (global_job_id_with_time_knob.get()) {
 		int now = (int)time(0);
 		gjid += "#";
 		gjid += std::to_string( now );
@@ -3640,7 +3943,7 @@ SetAttributeByConstraint(const char *constraint_str, const char *attr_name,
 
 	// if the only-my-jobs knob is off, strip the onlymyjobs flag and
 	// just let the transaction fail if they try and change something that they shouldn't
-	if ( ! param_boolean("CONDOR_Q_ONLY_MY_JOBS", true)) {
+	if ( ! condor_q_only_my_jobs_knob.get()) {
 		flags &= ~SetAttribute_OnlyMyJobs;
 	}
 
@@ -5634,7 +5937,7 @@ AddSessionAttributes(const std::list<std::string> &new_ad_keys)
 	}
 }
 
-int CommitTransactionInternal( bool durable, CondorError * errorStack );
+int CommitTransactionInternal( bool durable, CondorError * errorStack, bool defer_sync = false );
 
 void
 CommitTransactionOrDieTrying() {
@@ -5662,9 +5965,9 @@ CommitNonDurableTransactionOrDieTrying() {
 	}
 }
 
-int
-CommitTransactionAndLive( SetAttributeFlags_t flags,
-                          CondorError * errorStack )
+static int
+CommitTransactionWithFlags( SetAttributeFlags_t flags,
+                            CondorError * errorStack, bool defer_sync )
 {
 	bool durable = !(flags & NONDURABLE);
 	if( (durable && flags != 0) || ((!durable) && flags != NONDURABLE) ) {
@@ -5675,10 +5978,40 @@ CommitTransactionAndLive( SetAttributeFlags_t flags,
 		dprintf( D_ALWAYS | D_BACKTRACE, "ERROR: CommitTransaction() called with NULL error stack.\n" );
 	}
 
-	return CommitTransactionInternal( durable, errorStack );
+	return CommitTransactionInternal( durable, errorStack, defer_sync );
+}
+
+int
+CommitTransactionAndLive( SetAttributeFlags_t flags,
+                          CondorError * errorStack )
+{
+	return CommitTransactionWithFlags( flags, errorStack, false );
+}
+
+int
+CommitClientTransaction( SetAttributeFlags_t flags,
+                         CondorError * errorStack )
+{
+	return CommitTransactionWithFlags( flags, errorStack, true );
+}
+
+// Call this just before committing a transaction, it tells the schedd which attributes
+// of each job the transaction changes, so that periodic policy evaluation can skip the jobs it did not touch.
+//
+static void NotePeriodicExprAttrsChanged(const std::set<std::string> & ad_keys)
+{
+	JobQueueKey job_id;
+	for (const auto & key : ad_keys) {
+		if ( ! job_id.set(key.c_str()) || job_id.cluster <= 0) continue; // ignore the header ad and jobsets
+
+		classad::References attrs;
+		if (JobQueue->AddAttrNamesFromTransaction(job_id, attrs)) {
+			scheduler.periodicExprAttrsChanged(job_id, attrs);
+		}
+	}
 }
 
-int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
+int CommitTransactionInternal( bool durable, CondorError * errorStack, bool defer_sync ) {
 
 	std::list<std::string> new_ad_keys;
 	
@@ -5725,9 +6058,17 @@ int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
 	// so we can clear the trigger bit here.
 	triggers &= ~catSpoolingHold;
 
-	if (triggers) {
-		JobQueue->GetTransactionKeys(ad_keys);
+	// the schedd's job counts need to know about every ad in the transaction, not just the ones with triggers
+	JobQueue->GetTransactionKeys(ad_keys);
+
+	if (scheduler.periodicExprsIncremental()) {
+		NotePeriodicExprAttrsChanged(ad_keys);
+		for (const auto & key : new_ad_keys) {
+			scheduler.periodicExprJobChanged(JobQueueKey(key.c_str()));
+		}
+	}
 
+	if (triggers) {
 		// before we commit the transaction, if there were changes to a cluster ad
 		// update the EditedClusterAttrs for that cluster
 		if (triggers & catPostSubmitClusterChange) {
@@ -5759,7 +6100,12 @@ int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
 		ScheduleJobQueueLogFlush();
 	}
 	else {
-		JobQueue->CommitTransaction(commit_comment);
+		if (defer_sync) {
+			JobQueue->CommitDeferredSyncTransaction(commit_comment);
+		} else {
+			JobQueue->CommitTransaction(commit_comment);
+		}
+		scheduler.stats.JobQueueCommits += 1;
 	}
 
 	// Now that we've commited for sure, up the TotalJobsCount
@@ -5966,6 +6312,8 @@ int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
 		DoSetAttributeCallbacks(ad_keys, triggers);
 	}
 
+	scheduler.jobCountsChanged(ad_keys);
+
 	xact_start_time = 0;
 	return 0;
 }
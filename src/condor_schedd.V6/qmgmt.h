@@ -58,6 +58,10 @@ class QmgmtPeer {
 		bool getAllowProtectedAttrChanges() const { return allow_protected_attr_changes_by_superuser; }
 		bool setReadOnly(bool val);
 		bool getReadOnly() const { return readonly; }
+			// set when the end of message of a commit reply is held back
+			// until the job queue log has been synced (group commit).
+		void setReplyDeferred(bool val) { reply_deferred = val; }
+		bool getReplyDeferred() const { return reply_deferred; }
 
 		ReliSock *getReliSock() const { return sock; };
 		const CondorVersionInfo *get_peer_version() const { return sock->get_peer_version(); };
@@ -78,6 +82,7 @@ class QmgmtPeer {
 		char *owner;  
 		bool allow_protected_attr_changes_by_superuser;
 		bool readonly;
+		bool reply_deferred;
 		char * fquser;  // owner@domain
 		char *myendpoint; 
 		condor_sockaddr addr;
@@ -191,6 +196,10 @@ public:
 	// DO NOT FREE FROM HERE!
 	struct SubmitterData * submitterdata;
 	struct OwnerInfo * ownerinfo;
+	// what count_a_job() last added to the schedd's job counts for this job, owned by the scheduler
+	struct JobCountsEntry * counted;
+	// when the scheduler next evaluates the periodic policy of this job, when that is done incrementally
+	time_t policy_deadline;
 protected:
 	JobQueueCluster * parent; // job pointer back to the 
 	qelm qe;
@@ -207,6 +216,8 @@ public:
 		, autocluster_id(0)
 		, submitterdata(NULL)
 		, ownerinfo(NULL)
+		, counted(NULL)
+		, policy_deadline(0)
 		, parent(NULL)
 	{}
 	virtual ~JobQueueJob() {};
@@ -270,6 +281,9 @@ public:
 	int getNumNotRunning() const { return num_idle + num_held; }
 
 	bool HasAttachedJobs() { return ! qe.empty(); }
+	// walk the attached jobs, NextJob returns NULL after the last one
+	JobQueueJob * FirstJob() { return NextJob(NULL); }
+	JobQueueJob * NextJob(JobQueueJob * job) { qelm * q = job ? job->qe.next() : qe.next(); return (q == &qe) ? NULL : q->as<JobQueueJob>(); }
 	void AttachJob(JobQueueJob * job);
 	void DetachJob(JobQueueJob * job);
 	void DetachAllJobs(); // When you absolutely positively need to free this class...
@@ -335,6 +349,7 @@ void SetMaxHistoricalLogs(int max_historical_logs);
 time_t GetOriginalJobQueueBirthdate();
 void DestroyJobQueue( void );
 int handle_q(int, Stream *sock);
+bool JobQueueSyncPending();
 void dirtyJobQueue( void );
 bool SendDirtyJobAdNotification(const PROC_ID& job_id);
 
@@ -390,6 +405,12 @@ JobQueueJob* GetNextDirtyJobByConstraint(const char *constraint, int initScan);
 int NewProcInternal(int cluster_id, int proc_id);
 // call NewProcInternal, and then SetAttribute on all of the attributes in job that are not the same as ClusterAd
 int NewProcFromAd (const classad::ClassAd * job, int ProcId, JobQueueCluster * ClusterAd, SetAttributeFlags_t flags);
+// true if a BulkSubmit RPC of this size is within the SCHEDD_BULK_SUBMIT_MAX_* limits
+bool BulkSubmitWithinLimits(int num_procs, int num_columns, size_t bytes);
+// called by qmgmt_recievers to handle the BulkSubmit RPC call
+int QmgmtHandleBulkSubmit(int cluster_id, int first_proc_id, const ClassAd * cluster_ad,
+	const std::vector<std::string> & columns, const std::vector<std::string> & cells, int num_procs,
+	SetAttributeFlags_t flags, CondorError * err, int &terrno);
 #endif
 
 void * BeginJobAggregation(const char * projection, bool create_if_not, const char * constraint);
@@ -560,6 +581,7 @@ void InitQmgmt();
 void InitJobQueue(const char *job_queue_name,int max_historical_logs);
 void PostInitJobQueue();
 void CleanJobQueue();
+void PeriodicCleanJobQueue();
 bool setQSock( ReliSock* rsock );
 void unsetQSock();
 void MarkJobClean(PROC_ID job_id);
@@ -550,6 +550,92 @@ do_Q_request(QmgmtPeer &Q_PEER, bool &may_fork)
 		return 0;
 	} break;
 
+	case CONDOR_BulkSubmit:
+	  {
+		int cluster_id = -1;
+		int first_proc_id = -1;
+		int has_cluster_ad = 0;
+		int num_columns = 0;
+		int num_procs = 0;
+		int terrno = 0;
+		SetAttributePublicFlags_t wflags = 0;
+		ClassAd cluster_ad;
+		std::vector<std::string> columns;
+		std::vector<std::string> cells;
+		if (!g_transaction_error) g_transaction_error.reset(new CondorError());
+
+		assert( syscall_sock->code(cluster_id) );
+		dprintf( D_SYSCALLS, "	cluster_id = %d\n", cluster_id );
+		assert( syscall_sock->code(first_proc_id) );
+		dprintf( D_SYSCALLS, "	first_proc_id = %d\n", first_proc_id );
+		assert( syscall_sock->code(wflags) );
+		assert( syscall_sock->code(has_cluster_ad) );
+		if (has_cluster_ad) {
+			assert( getClassAd(syscall_sock, cluster_ad) );
+		}
+			// the sizes come from the client, so check them against our limits
+			// before allocating anything, and give up on the rest of the
+			// request as soon as it goes over.
+		bool too_big = false;
+		size_t bytes = 0;
+		assert( syscall_sock->code(num_columns) );
+		if ( ! BulkSubmitWithinLimits(0, num_columns, 0)) {
+			too_big = true;
+		} else {
+			columns.resize(num_columns);
+			for (int ix = 0; ix < num_columns && ! too_big; ++ix) {
+				assert( syscall_sock->code(columns[ix]) );
+				bytes += columns[ix].size();
+				too_big = ! BulkSubmitWithinLimits(0, num_columns, bytes);
+			}
+		}
+		if ( ! too_big) {
+			assert( syscall_sock->code(num_procs) );
+			dprintf( D_SYSCALLS, "	num_procs = %d, num_columns = %d\n", num_procs, num_columns );
+			too_big = ! BulkSubmitWithinLimits(num_procs, num_columns, bytes);
+		}
+		if ( ! too_big) {
+			cells.reserve((size_t)num_procs * num_columns);
+			std::string cell;
+			for (int row = 0; row < num_procs && ! too_big; ++row) {
+				for (int ix = 0; ix < num_columns && ! too_big; ++ix) {
+					assert( syscall_sock->code(cell) );
+					bytes += cell.size();
+					too_big = ! BulkSubmitWithinLimits(num_procs, num_columns, bytes);
+					cells.push_back(cell);
+				}
+			}
+		}
+
+		if (too_big) {
+				// discard the rest of the request
+			syscall_sock->end_of_message();
+			dprintf( D_ALWAYS, "Failing remote BulkSubmit %d because it is larger than the SCHEDD_BULK_SUBMIT_MAX_* limits\n", cluster_id );
+			rval = -1;
+			terrno = EINVAL;
+		} else {
+			assert( syscall_sock->end_of_message() );
+
+			SetAttributeFlags_t flags = (SetAttributeFlags_t)(wflags & SetAttribute_PublicFlagsMask);
+			rval = QmgmtHandleBulkSubmit(cluster_id, first_proc_id, has_cluster_ad ? &cluster_ad : NULL,
+				columns, cells, num_procs, flags, g_transaction_error.get(), terrno);
+		}
+		dprintf( D_SYSCALLS, "\trval = %d, errno = %d\n", rval, terrno );
+		if ( rval > 0 ) {
+			dprintf( D_AUDIT, *syscall_sock,
+					 "Submitting new jobs %d.%d through %d.%d\n",
+					 cluster_id, first_proc_id, cluster_id, first_proc_id + rval - 1 );
+		}
+
+		syscall_sock->encode();
+		assert( syscall_sock->code(rval) );
+		if( rval < 0 ) {
+			assert( syscall_sock->code(terrno) );
+		}
+		assert( syscall_sock->end_of_message() );
+		return 0;
+	}
+
 	case CONDOR_GetCapabilities: {
 		int mask;
 		assert( syscall_sock->code(mask) );
@@ -672,7 +758,7 @@ do_Q_request(QmgmtPeer &Q_PEER, bool &may_fork)
 		} else {
 			errstack.reset(new CondorError());
 			errno = 0;
-			rval = CommitTransactionAndLive( flags, errstack.get() );
+			rval = CommitClientTransaction( flags, errstack.get() );
 			terrno = errno;
 		}
 		dprintf( D_SYSCALLS, "\tflags = %d, rval = %d, errno = %d\n", flags, rval, terrno );
@@ -710,6 +796,14 @@ do_Q_request(QmgmtPeer &Q_PEER, bool &may_fork)
 			assert( putClassAd( syscall_sock, reply ) );
 		}
 
+		if( rval >= 0 && !(flags & NONDURABLE) && JobQueueSyncPending() ) {
+				// group commit: the client is not told that the transaction
+				// is committed until it is on disk, handle_q sends the
+				// end of message once the job queue log has been synced.
+			Q_PEER.setReplyDeferred(true);
+			return 0;
+		}
+
 		assert( syscall_sock->end_of_message() );;
 		return 0;
 	}
@@ -338,6 +338,55 @@ int SendMaterializeData(int cluster_id, int flags, int (*next)(void* pv, std::st
 
 }
 
+int BulkSubmit(int cluster_id, int first_proc_id, const classad::ClassAd * cluster_ad,
+	const std::vector<std::string> & columns, const std::vector< std::vector<std::string> > & proc_rows,
+	SetAttributeFlags_t flags_in)
+{
+	int	rval = -1;
+	int num_procs = (int)proc_rows.size();
+	int num_columns = (int)columns.size();
+	int has_cluster_ad = cluster_ad ? 1 : 0;
+	SetAttributePublicFlags_t flags = (flags_in & SetAttribute_PublicFlagsMask);
+	const std::string empty;
+
+	CurrentSysCall = CONDOR_BulkSubmit;
+
+	qmgmt_sock->encode();
+	neg_on_error( qmgmt_sock->code(CurrentSysCall) );
+	neg_on_error( qmgmt_sock->code(cluster_id) );
+	neg_on_error( qmgmt_sock->code(first_proc_id) );
+	neg_on_error( qmgmt_sock->code(flags) );
+	neg_on_error( qmgmt_sock->code(has_cluster_ad) );
+	if (cluster_ad) {
+		neg_on_error( putClassAd(qmgmt_sock, *cluster_ad) );
+	}
+	neg_on_error( qmgmt_sock->code(num_columns) );
+	for (int ix = 0; ix < num_columns; ++ix) {
+		neg_on_error( qmgmt_sock->put(columns[ix]) );
+	}
+	neg_on_error( qmgmt_sock->code(num_procs) );
+	for (int row = 0; row < num_procs; ++row) {
+		// rows may be shorter than the column list when a later proc added a column
+		const std::vector<std::string> & cells = proc_rows[row];
+		for (int ix = 0; ix < num_columns; ++ix) {
+			neg_on_error( qmgmt_sock->put(ix < (int)cells.size() ? cells[ix] : empty) );
+		}
+	}
+	neg_on_error( qmgmt_sock->end_of_message() );
+
+	qmgmt_sock->decode();
+	neg_on_error( qmgmt_sock->code(rval) );
+	if( rval < 0 ) {
+		neg_on_error( qmgmt_sock->code(terrno) );
+		neg_on_error( qmgmt_sock->end_of_message() );
+		errno = terrno;
+		return rval;
+	}
+	neg_on_error( qmgmt_sock->end_of_message() );
+
+	return rval;
+}
+
 #if 0
 int
 DestroyClusterByConstraint( char *constraint )
@@ -638,6 +638,15 @@ Scheduler::Scheduler() :
 	SchedUniverseJobsRunning = 0;
 	LocalUniverseJobsIdle = 0;
 	LocalUniverseJobsRunning = 0;
+	m_countAllJobs = true;
+	m_jobCountsGeneration = 0;
+	m_lastCountAllJobs = 0;
+	m_countAllJobsInterval = 0;
+	m_checkJobCounts = false;
+	m_periodicExprIncremental = false;
+	m_periodicExprWalkAll = true;
+	m_shadowMultiplex = false;
+	m_shadowMultiplexMaxJobs = 100;
 	LocalUnivExecuteDir = NULL;
 	ReservedSwap = 0;
 	SwapSpace = 0;
@@ -813,6 +822,14 @@ Scheduler::~Scheduler()
 		}
 		delete shadowsByPid;
 	}
+	std::map<int, MultiplexedShadow>::iterator mux;
+	for( mux = m_multiplexedShadows.begin(); mux != m_multiplexedShadows.end(); ++mux ) {
+		std::set<shadow_rec*>::iterator it;
+		for( it = mux->second.jobs.begin(); it != mux->second.jobs.end(); ++it ) {
+			delete *it;
+		}
+	}
+	m_multiplexedShadows.clear();
 	if (spoolJobFileWorkers) {
 		spoolJobFileWorkers->startIterations();
 		ExtArray<PROC_ID> * rec;
@@ -1368,58 +1385,88 @@ Scheduler::count_jobs()
 	time_t AbsentSubmitterUpdateRate = param_integer("ABSENT_SUBMITTER_UPDATE_RATE", 60*5); // 5 min
 	time_t AbsentOwnerLifetime = param_integer("ABSENT_OWNER_LIFETIME", 60*5);
 
-	JobsRunning = 0;
-	JobsIdle = 0;
-	JobsHeld = 0;
-	JobsTotalAds = 0;
 	JobsFlocked = 0;
-	JobsRemoved = 0;
-	SchedUniverseJobsIdle = 0;
-	SchedUniverseJobsRunning = 0;
-	LocalUniverseJobsIdle = 0;
-	LocalUniverseJobsRunning = 0;
-	stats.JobsRunning = 0;
-	stats.JobsRunningRuntimes = 0;
-	stats.JobsRunningSizes = 0;
-	scheduler.OtherPoolStats.ResetJobsRunning();
 
 	time_t current_time = time(0);
 
-	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
-		OwnerInfo & Owner = it->second;
-		Owner.num.clear_counters();	// clear the jobs counters 
-	}
-
-	FlockPools.clear();
+	std::unordered_set<std::string> flock_pools;
 	if (FlockCollectors) {
 		FlockCollectors->rewind();
 		Daemon *daemon;
 		while (FlockCollectors->next(daemon)) {
 			auto col = static_cast<DCCollector*>(daemon);
-			FlockPools.insert(col->name());
+			flock_pools.insert(col->name());
 		}
 	}
+	if (flock_pools != FlockPools) {
+			// the per-pool idle counts of a job depend on the default flock pools.
+		FlockPools.swap(flock_pools);
+		m_countAllJobs = true;
+	}
+
+	SubmitterMap.Cleanup(time(NULL));
+
+		// The per-job counts are kept up to date as jobs change (see jobCountsChanged),
+		// so usually we only need to count the jobs that changed since last time.
+		// Walk the whole queue when something that all jobs depend on changed,
+		// when there are per-pool stats to collect, and every so often anyway
+		// in case something got missed.
+	bool count_all = m_countAllJobs || OtherPoolStats.AnyEnabled() ||
+		m_countAllJobsInterval <= 0 || current_time - m_lastCountAllJobs >= m_countAllJobsInterval;
+	if (count_all) {
+		count_all_jobs();
+	} else if (m_checkJobCounts) {
+		check_job_counts();
+	} else {
+		count_changed_jobs();
+	}
+
+	JobsRunning = m_queuedCounts.JobsRunning;
+	JobsIdle = m_queuedCounts.JobsIdle;
+	JobsHeld = m_queuedCounts.JobsHeld;
+	JobsTotalAds = m_queuedCounts.JobsTotalAds;
+	JobsRemoved = m_queuedCounts.JobsRemoved;
+	SchedUniverseJobsIdle = m_queuedCounts.SchedUniverseJobsIdle;
+	SchedUniverseJobsRunning = m_queuedCounts.SchedUniverseJobsRunning;
+	LocalUniverseJobsIdle = m_queuedCounts.LocalUniverseJobsIdle;
+	LocalUniverseJobsRunning = m_queuedCounts.LocalUniverseJobsRunning;
+
+	stats.JobsRunning = m_queuedCounts.StatsJobsRunning;
+	stats.JobsRunningSizes = 0;
+	for (const auto & it : m_queuedCounts.StatsRunningSizes) {
+		stats.JobsRunningSizes.Add(it.first, it.second);
+	}
+	stats.JobsRunningRuntimes = 0;
+	stats.JobsRunningRuntimes.Add(0, m_queuedCounts.StatsJobsNoStartDate);
+	for (const auto & it : m_queuedCounts.StatsStartDates) {
+		stats.JobsRunningRuntimes.Add(current_time - it.first, it.second);
+	}
+
+	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
+		OwnerInfo & Owner = it->second;
+		Owner.num = Owner.queued;
+		if (Owner.num.Hits > 0) { Owner.LastHitTime = current_time; }
+	}
 
 	for (SubmitterDataMap::iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
 		SubmitterData & SubDat = it->second;
-		SubDat.num.clear_job_counters();	// clear the jobs counters 
+		SubDat.num = SubDat.queued;
+		if (SubDat.num.Hits > 0) { SubDat.LastHitTime = current_time; }
 		SubDat.PrioSet.clear();
-		SubDat.flock.clear();
+		for (const auto & prio : SubDat.queued_prios) {
+			SubDat.PrioSet.insert(prio.first);
+		}
+		SubDat.flock = SubDat.queued_flock;
 		for (const auto &entry : FlockPools) {
-			SubDat.flock[entry] = SubmitterFlockCounters();
+			SubDat.flock.insert({entry, SubmitterFlockCounters()});
 		}
 	}
-	SubmitterMap.Cleanup(time(NULL));
-
-	GridJobOwners.clear();
 
-		// Clear out the DedicatedScheduler's list of idle dedicated
-		// job cluster ids, since we're about to re-create it.
+		// Re-create the DedicatedScheduler's list of idle dedicated job cluster ids.
 	dedicated_scheduler.clearDedicatedClusters();
-
-		// inserts/finds an entry in Owners for each job
-		// updates SubmitterCounters: Hits, JobsIdle, WeightedJobsIdle & JobsHeld
-	WalkJobQueue(count_a_job);
+	for (const auto & it : m_queuedDedicatedClusters) {
+		dedicated_scheduler.addDedicatedCluster(it.first);
+	}
 
 	if( dedicated_scheduler.hasDedicatedClusters() ) {
 			// We found some dedicated clusters to service.  Wake up
@@ -1488,7 +1535,7 @@ Scheduler::count_jobs()
 		OwnerInfo & owner_info = it->second;
 		// If this Owner has any jobs in the queue or match records,
 		// we don't want to remove the entry.
-		if (owner_info.num.Hits > 0) continue;
+		if (owner_info.num.Hits > 0 || owner_info.queued.Hits > 0) continue;
 
 		// expire and mark for removal Owners that have not had any hits (i.e jobs in the queue)
 		if ( ! owner_info.LastHitTime) {
@@ -1887,7 +1934,7 @@ Scheduler::count_jobs()
 		SubmitterData & SubDat = it->second;
 		// If this Owner has any jobs in the queue or match records,
 		// we don't want to send the, so we continue to the next
-		if (SubDat.num.Hits > 0) continue;
+		if (SubDat.num.Hits > 0 || SubDat.queued.Hits > 0) continue;
 
 		if (user_is_the_new_owner) {
 			submitter_name = SubDat.Name();
@@ -2872,17 +2919,33 @@ Scheduler::guessJobSlotWeight(JobQueueJob * job)
 	return job_weight;
 }
 
+// add a job's contribution to a per-key count, dropping keys that go back to zero.
+template <typename K>
+static void
+add_job_count(std::map<K, int> & counts, const K & key, int increment)
+{
+	auto it = counts.emplace(key, 0).first;
+	it->second += increment;
+	if ( ! it->second) {
+		counts.erase(it);
+	}
+}
+
+static void
+add_flock_idle(std::unordered_map<std::string, SubmitterFlockCounters> & flock, const std::string & pool, int idle, int weighted_idle)
+{
+	auto it = flock.insert({pool, SubmitterFlockCounters()}).first;
+	it->second.JobsIdle += idle;
+	it->second.WeightedJobsIdle += weighted_idle;
+	if ( ! it->second.JobsIdle && ! it->second.WeightedJobsIdle) {
+		flock.erase(it);
+	}
+}
+
 int
 count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 {
 	int		status;
-#if 1  // cache ownerdata pointer in job object
-#else
-	int		niceUser;
-	MyString owner_buf;
-	char const*	owner;
-	MyString domain;
-#endif
 	int		cur_hosts;
 	int		max_hosts;
 	int		universe;
@@ -2894,6 +2957,15 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 		return 0;
 	}
 
+		// take back out whatever we counted for this job the last time.
+	if (job->counted) {
+		if (job->counted->generation == scheduler.m_jobCountsGeneration) {
+			scheduler.apply_job_counts(*job->counted, -1);
+		}
+		delete job->counted;
+		job->counted = NULL;
+	}
+
 	if (job->LookupInteger(ATTR_JOB_STATUS, status) == 0) {
 		dprintf(D_ALWAYS, "Job has no %s attribute.  Ignoring...\n",
 				ATTR_JOB_STATUS);
@@ -2946,24 +3018,27 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 	}
 	
 
-	// because we set job->ownerdata to NULL above, this will refresh
-	// the job->ownerdata pointer. we do this in case the accounting group
-	// or niceness has been queue-edited or otherwise changed.
+	// this will refresh the job->submitterdata pointer. we do this in case
+	// the accounting group or niceness has been queue-edited or otherwise changed.
 	SubmitterData * SubData = NULL;
 	OwnerInfo * OwnInfo = scheduler.get_submitter_and_owner(job, SubData);
 	if ( ! OwnInfo) {
 		dprintf(D_ALWAYS, "Job has no %s attribute.  Ignoring...\n", ATTR_OWNER);
 		return 0;
 	}
-		// Keep track of unique owners per submitter.
-	SubData->owners.insert(OwnInfo->name);
 
-	// increment our count of the number of job ads in the queue
-	scheduler.JobsTotalAds++;
+	// remember everything about the job that goes into the counts, so that
+	// we can take it back out again when the job changes.
+	JobCountsEntry * entry = new JobCountsEntry;
+	entry->generation = scheduler.m_jobCountsGeneration;
+	entry->submitter = SubData;
+	entry->owner = OwnInfo;
+	entry->status = status;
+	entry->universe = universe;
+	entry->cur_hosts = cur_hosts;
+	entry->max_hosts = max_hosts;
 
     time_t now = time(NULL);
-    OwnInfo->LastHitTime = now;
-    SubData->LastHitTime = now;
 
     ScheddOtherStats * other_stats = NULL;
     if (scheduler.OtherPoolStats.AnyEnabled()) {
@@ -2971,87 +3046,25 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
     }
     #define OTHER for (ScheddOtherStats * po = other_stats; po; po = po->next) (po->stats)
 
-    if (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT) {
-        /*
-         * Not all universes track CurrentHosts and MaxHosts; if there's no information,
-         * simply increment Running or Idle by 1.
-         */
-        if ((status == RUNNING || status == TRANSFERRING_OUTPUT) && !cur_hosts)
-        {
-                scheduler.JobsRunning += 1;
-        }
-        else if ((status == IDLE) && !max_hosts)
-        {
-                scheduler.JobsIdle += 1;
-        }
-        else
-        {
-                scheduler.JobsRunning += cur_hosts;
-                scheduler.JobsIdle += (max_hosts - cur_hosts);
-        }
+        // if job is not idle, then update statistics for running jobs
+    if (status == RUNNING || status == TRANSFERRING_OUTPUT) {
+        OTHER.JobsRunning += 1;
+
+        job->LookupInteger("ImageSize_RAW", entry->image_size);
+        OTHER.JobsRunningSizes += (int64_t)entry->image_size * 1024;
 
-            // if job is not idle, then update statistics for running jobs
-        if (status == RUNNING || status == TRANSFERRING_OUTPUT) {
-            scheduler.stats.JobsRunning += 1;
-            OTHER.JobsRunning += 1;
-
-            int job_image_size = 0;
-            job->LookupInteger("ImageSize_RAW", job_image_size);
-            scheduler.stats.JobsRunningSizes += (int64_t)job_image_size * 1024;
-            OTHER.JobsRunningSizes += (int64_t)job_image_size * 1024;
-
-            int job_start_date = 0;
-            int job_running_time = 0;
-            if (job->LookupInteger(ATTR_JOB_START_DATE, job_start_date))
-                job_running_time = (now - job_start_date);
-            scheduler.stats.JobsRunningRuntimes += job_running_time;
-            OTHER.JobsRunningRuntimes += job_running_time;
+        int job_running_time = 0;
+        if (job->LookupInteger(ATTR_JOB_START_DATE, entry->start_date)) {
+            entry->has_start_date = true;
+            job_running_time = (now - entry->start_date);
         }
-    } else if (status == HELD) {
-        scheduler.JobsHeld++;
-    } else if (status == REMOVED) {
-        scheduler.JobsRemoved++;
+        OTHER.JobsRunningRuntimes += job_running_time;
     }
     #undef OTHER
 
-	// update per-submitter and per-owner counters
-	SubmitterCounters * Counters = &SubData->num;
-	RealOwnerCounters * OwnerCounts = &OwnInfo->num;
-
-	// Hits also counts matchrecs, which aren't jobs. (hits is sort of a reference count)
-	Counters->Hits += 1;
-	Counters->JobsCounted += 1;
-	
-	OwnerCounts->Hits += 1;
-	OwnerCounts->JobsCounted += 1;
-
 	if ( (universe != CONDOR_UNIVERSE_GRID) &&	// handle Globus below...
 		 (!service_this_universe(universe,job))  )
 	{
-			// Deal with all the Universes which we do not service, expect
-			// for Globus, which we deal with below.
-		if (universe == CONDOR_UNIVERSE_SCHEDULER)
-		{
-			// Count REMOVED or HELD jobs that are in the process of being
-			// killed. cur_hosts tells us which these are.
-			scheduler.SchedUniverseJobsRunning += cur_hosts;
-			scheduler.SchedUniverseJobsIdle += (max_hosts - cur_hosts);
-			OwnerCounts->SchedulerJobsRunning += cur_hosts;
-			OwnerCounts->SchedulerJobsIdle += (max_hosts - cur_hosts);
-			Counters->SchedulerJobsRunning += cur_hosts;
-			Counters->SchedulerJobsIdle += (max_hosts - cur_hosts);
-		}
-		if (universe == CONDOR_UNIVERSE_LOCAL)
-		{
-			// Count REMOVED or HELD jobs that are in the process of being
-			// killed. cur_hosts tells us which these are.
-			scheduler.LocalUniverseJobsRunning += cur_hosts;
-			scheduler.LocalUniverseJobsIdle += (max_hosts - cur_hosts);
-			OwnerCounts->LocalJobsRunning += cur_hosts;
-			OwnerCounts->LocalJobsIdle += (max_hosts - cur_hosts);
-			Counters->LocalJobsRunning += cur_hosts;
-			Counters->LocalJobsIdle += (max_hosts - cur_hosts);
-		}
 			// We want to record the cluster id of all idle MPI and parallel
 		    // jobs
 
@@ -3067,16 +3080,18 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 				job->LookupInteger( ATTR_PROC_ID, proc );
 					// Don't add all the procs in the cluster, just the first
 				if( proc == 0) {
-					dedicated_scheduler.addDedicatedCluster( cluster );
+					entry->dedicated_cluster = cluster;
 				}
 			}
 		}
 
-		// bailout now, since all the crud below is only for jobs
-		// which the schedd needs to service
+		scheduler.apply_job_counts(*entry, 1);
+		job->counted = entry;
 		return 0;
 	} 
 
+	entry->serviced = true;
+
 	if ( universe == CONDOR_UNIVERSE_GRID ) {
 		// for Globus, count jobs in UNSUBMITTED state by owner.
 		// later we make certain there is a grid manager daemon
@@ -3108,52 +3123,43 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 			}
 		}
 
-#if 1   // cache ownerdata pointer in job object
 		std::string real_owner, domain;
 		job->LookupString(ATTR_OWNER,real_owner); // we can't get here if the job has no ATTR_OWNER
 		job->LookupString(ATTR_NT_DOMAIN, domain);
-#endif
+
+		entry->grid = true;
+		entry->grid_user = UserIdentity(real_owner.c_str(),domain.c_str(),job);
+
 		// Don't count HELD jobs that aren't externally (gridmanager) managed
 		// Don't count jobs that the gridmanager has said it's completely
 		// done with.
-		UserIdentity userident(real_owner.c_str(),domain.c_str(),job);
 		if ( ( status != HELD || job_managed != false ) &&
 			 job_managed_done == false ) 
 		{
-			GridJobCounts * gridcounts = scheduler.GetGridJobCounts(userident);
-			ASSERT(gridcounts);
-			gridcounts->GridJobs++;
+			entry->grid_jobs = 1;
 		}
 		if ( status != HELD && job_managed == 0 && job_managed_done == 0 ) 
 		{
-			GridJobCounts * gridcounts = scheduler.GetGridJobCounts(userident);
-			ASSERT(gridcounts);
-			gridcounts->UnmanagedGridJobs++;
-		}
-			// If we do not need to do matchmaking on this job (i.e.
-			// service this globus universe job), than we can bailout now.
-		if (!want_service) {
-			return 0;
+			entry->unmanaged_grid_jobs = 1;
 		}
+		entry->serviced = want_service;
 		status = real_status;	// set status back for below logic...
 	}
 
-	if (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT) {
+		// the rest is only for jobs that we do matchmaking for
+	if (entry->serviced && (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT)) {
 
 			// Update Owner array PrioSet iff knob USE_GLOBAL_JOB_PRIOS is true
 			// and iff job is looking for more matches (max-hosts - cur_hosts)
 		if ( param_boolean("USE_GLOBAL_JOB_PRIOS",false) &&
 			 ((max_hosts - cur_hosts) > 0) )
 		{
-			int job_prio;
-			if ( job->LookupInteger(ATTR_JOB_PRIO,job_prio) ) {
-				SubData->PrioSet.insert( job_prio );
+			if ( job->LookupInteger(ATTR_JOB_PRIO,entry->prio) ) {
+				entry->has_prio = true;
 			}
 		}
-			// Update Owners array JobsIdle
+
 		int job_idle = (max_hosts - cur_hosts);
-		OwnerCounts->JobsIdle += job_idle;
-		Counters->JobsIdle += job_idle;
 
 			// If we're biasing by slot weight, and the job is idle, and everything parsed...
 		int job_idle_weight;
@@ -3174,38 +3180,155 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 			// here: either max_hosts == cur_hosts || !scheduler.m_use_slot_weights
 			job_idle_weight = request_cpus * job_idle;
 		}
-		Counters->WeightedJobsIdle += job_idle_weight;
+		entry->idle_weight = job_idle_weight;
 
-			// Update per-flock jobs idle
+			// Remember the per-flock targets for jobs idle
 		std::string flock_targets;
-		bool include_default_flock = param_boolean("FLOCK_BY_DEFAULT", true);
+		entry->default_flock = param_boolean("FLOCK_BY_DEFAULT", true);
 		if (job->EvaluateAttrString(ATTR_FLOCK_TO, flock_targets)) {
 			StringList flock_list(flock_targets.c_str());
 			flock_list.rewind();
 			char *flock_entry = nullptr;
 			while ( (flock_entry = flock_list.next()) ) {
 				if (!strcasecmp(flock_entry, "default")) {
-					include_default_flock = true;
+					entry->default_flock = true;
 				} else {
-					auto iter = SubData->flock.insert({flock_entry, SubmitterFlockCounters()});
-					iter.first->second.JobsIdle += job_idle;
-					iter.first->second.WeightedJobsIdle += job_idle_weight;
+					entry->flock_targets.emplace_back(flock_entry);
 				}
 			}
-				// Subtract out overlap with default list of flocked pools.
-			flock_list.rewind();
-			while ( (flock_entry = flock_list.next()) ) {
-				auto iter = scheduler.FlockPools.find(flock_entry);
-				if (iter != scheduler.FlockPools.end()) {
-					SubData->flock[flock_entry].JobsIdle -= job_idle;
-					SubData->flock[flock_entry].WeightedJobsIdle -= job_idle_weight;
-				}
+		}
+	}
+
+	scheduler.apply_job_counts(*entry, 1);
+	job->counted = entry;
+	return 0;
+}
+
+// Add (sign = 1) or take back out (sign = -1) the job counts for one job.
+void
+Scheduler::apply_job_counts(const JobCountsEntry & entry, int sign)
+{
+	SubmitterData * SubData = entry.submitter;
+	OwnerInfo * OwnInfo = entry.owner;
+	int status = entry.status;
+	int cur_hosts = entry.cur_hosts;
+	int max_hosts = entry.max_hosts;
+	QueuedJobCounters & counts = m_queuedCounts;
+
+		// Keep track of unique owners per submitter.
+	if (sign > 0) {
+		SubData->owners.insert(OwnInfo->name);
+	}
+
+	// count of the number of job ads in the queue
+	counts.JobsTotalAds += sign;
+
+	if (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT) {
+		/*
+		 * Not all universes track CurrentHosts and MaxHosts; if there's no information,
+		 * simply increment Running or Idle by 1.
+		 */
+		if ((status == RUNNING || status == TRANSFERRING_OUTPUT) && !cur_hosts) {
+			counts.JobsRunning += sign;
+		} else if ((status == IDLE) && !max_hosts) {
+			counts.JobsIdle += sign;
+		} else {
+			counts.JobsRunning += sign * cur_hosts;
+			counts.JobsIdle += sign * (max_hosts - cur_hosts);
+		}
+
+		if (status == RUNNING || status == TRANSFERRING_OUTPUT) {
+			counts.StatsJobsRunning += sign;
+			add_job_count(counts.StatsRunningSizes, (int64_t)entry.image_size * 1024, sign);
+			if (entry.has_start_date) {
+				add_job_count(counts.StatsStartDates, entry.start_date, sign);
+			} else {
+				counts.StatsJobsNoStartDate += sign;
+			}
+		}
+	} else if (status == HELD) {
+		counts.JobsHeld += sign;
+	} else if (status == REMOVED) {
+		counts.JobsRemoved += sign;
+	}
+
+	// update per-submitter and per-owner counters
+	SubmitterCounters * Counters = &SubData->queued;
+	RealOwnerCounters * OwnerCounts = &OwnInfo->queued;
+
+	// Hits also counts matchrecs, which aren't jobs. (hits is sort of a reference count)
+	Counters->Hits += sign;
+	Counters->JobsCounted += sign;
+
+	OwnerCounts->Hits += sign;
+	OwnerCounts->JobsCounted += sign;
+
+	if ( ! entry.serviced && entry.universe != CONDOR_UNIVERSE_GRID) {
+			// Deal with all the Universes which we do not service, expect
+			// for Globus, which we deal with below.
+		if (entry.universe == CONDOR_UNIVERSE_SCHEDULER)
+		{
+			// Count REMOVED or HELD jobs that are in the process of being
+			// killed. cur_hosts tells us which these are.
+			counts.SchedUniverseJobsRunning += sign * cur_hosts;
+			counts.SchedUniverseJobsIdle += sign * (max_hosts - cur_hosts);
+			OwnerCounts->SchedulerJobsRunning += sign * cur_hosts;
+			OwnerCounts->SchedulerJobsIdle += sign * (max_hosts - cur_hosts);
+			Counters->SchedulerJobsRunning += sign * cur_hosts;
+			Counters->SchedulerJobsIdle += sign * (max_hosts - cur_hosts);
+		}
+		if (entry.universe == CONDOR_UNIVERSE_LOCAL)
+		{
+			// Count REMOVED or HELD jobs that are in the process of being
+			// killed. cur_hosts tells us which these are.
+			counts.LocalUniverseJobsRunning += sign * cur_hosts;
+			counts.LocalUniverseJobsIdle += sign * (max_hosts - cur_hosts);
+			OwnerCounts->LocalJobsRunning += sign * cur_hosts;
+			OwnerCounts->LocalJobsIdle += sign * (max_hosts - cur_hosts);
+			Counters->LocalJobsRunning += sign * cur_hosts;
+			Counters->LocalJobsIdle += sign * (max_hosts - cur_hosts);
+		}
+		if (entry.dedicated_cluster) {
+			add_job_count(m_queuedDedicatedClusters, entry.dedicated_cluster, sign);
+		}
+		return;
+	}
+
+	if (entry.grid) {
+		if (entry.grid_jobs || entry.unmanaged_grid_jobs) {
+			GridJobCounts * gridcounts = GetGridJobCounts(entry.grid_user);
+			ASSERT(gridcounts);
+			gridcounts->GridJobs += sign * entry.grid_jobs;
+			gridcounts->UnmanagedGridJobs += sign * entry.unmanaged_grid_jobs;
+		}
+		if ( ! entry.serviced) {
+			return;
+		}
+	}
+
+	if (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT) {
+		if (entry.has_prio) {
+			add_job_count(SubData->queued_prios, entry.prio, sign);
+		}
+
+			// Update Owners array JobsIdle
+		int job_idle = (max_hosts - cur_hosts);
+		OwnerCounts->JobsIdle += sign * job_idle;
+		Counters->JobsIdle += sign * job_idle;
+		Counters->WeightedJobsIdle += sign * entry.idle_weight;
+
+			// Update per-flock jobs idle, less the overlap with the default list of flocked pools.
+		for (const auto & pool : entry.flock_targets) {
+			add_flock_idle(SubData->queued_flock, pool, sign * job_idle, sign * entry.idle_weight);
+		}
+		for (const auto & pool : entry.flock_targets) {
+			if (FlockPools.find(pool) != FlockPools.end()) {
+				add_flock_idle(SubData->queued_flock, pool, -sign * job_idle, -sign * entry.idle_weight);
 			}
 		}
-		if (include_default_flock) {
-			for (const auto &flock_entry : scheduler.FlockPools) {
-				SubData->flock[flock_entry].JobsIdle += job_idle;
-				SubData->flock[flock_entry].WeightedJobsIdle += job_idle_weight;
+		if (entry.default_flock) {
+			for (const auto & pool : FlockPools) {
+				add_flock_idle(SubData->queued_flock, pool, sign * job_idle, sign * entry.idle_weight);
 			}
 		}
 
@@ -3213,11 +3336,194 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 			// We do it in Scheduler::count_jobs().
 
 	} else if (status == HELD) {
-		OwnerCounts->JobsHeld++;
-		Counters->JobsHeld++;
+		OwnerCounts->JobsHeld += sign;
+		Counters->JobsHeld += sign;
 	}
+}
 
-	return 0;
+void
+Scheduler::jobCountsChanged(const std::set<std::string> & keys)
+{
+	if (m_countAllJobs) {
+		return;
+	}
+	JOB_ID_KEY jid;
+	for (const auto & key : keys) {
+		if ( ! jid.set(key.c_str()) || jid.cluster <= 0) continue; // ignore the header ad and jobsets
+		m_jobCountsDirty.insert(jid);
+	}
+}
+
+void
+Scheduler::uncountJob(JobQueueJob * job)
+{
+	if ( ! job->counted) {
+		return;
+	}
+	if (job->counted->generation == m_jobCountsGeneration) {
+		apply_job_counts(*job->counted, -1);
+	}
+	delete job->counted;
+	job->counted = NULL;
+}
+
+// Start the job counts over from zero, and count every job in the queue.
+void
+Scheduler::count_all_jobs()
+{
+	m_queuedCounts = QueuedJobCounters();
+	m_queuedDedicatedClusters.clear();
+	OtherPoolStats.ResetJobsRunning();
+
+	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
+		it->second.queued.clear_counters();
+	}
+	for (SubmitterDataMap::iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
+		SubmitterData & SubDat = it->second;
+		SubDat.queued.clear_job_counters();
+		SubDat.queued_prios.clear();
+		SubDat.queued_flock.clear();
+	}
+	GridJobOwners.clear();
+
+		// what count_a_job() counted before now is gone, so it must not be taken out again.
+	++m_jobCountsGeneration;
+		// jobs that change while we walk (no-op jobs, for instance) will be counted next time.
+	m_jobCountsDirty.clear();
+	m_countAllJobs = false;
+	m_lastCountAllJobs = time(NULL);
+
+		// inserts/finds an entry in Owners for each job
+		// updates SubmitterCounters: Hits, JobsIdle, WeightedJobsIdle & JobsHeld
+	WalkJobQueue(count_a_job);
+}
+
+// Count again just the jobs that changed since the last count_jobs().
+void
+Scheduler::count_changed_jobs()
+{
+	std::set<JOB_ID_KEY> dirty;
+	dirty.swap(m_jobCountsDirty);
+
+	for (const auto & jid : dirty) {
+		if (jid.proc < 0) {
+				// a change to the cluster ad can change what counts for any of its jobs
+			JobQueueCluster * cad = GetClusterAd(jid.cluster);
+			if ( ! cad) continue;
+			for (JobQueueJob * job = cad->FirstJob(); job; job = cad->NextJob(job)) {
+				count_a_job(job, job->jid, NULL);
+			}
+		} else {
+			JobQueueJob * job = GetJobAd(jid.cluster, jid.proc);
+			if (job) {
+				count_a_job(job, jid, NULL);
+			}
+		}
+	}
+
+	dprintf(D_FULLDEBUG, "count_jobs: counted %d changed jobs and clusters\n", (int)dirty.size());
+}
+
+static std::string
+job_counts_str(const SubmitterCounters & num)
+{
+	std::string str;
+	formatstr(str, "Hits=%d Counted=%d Idle=%d WeightedIdle=%g Held=%d SchedIdle=%d SchedRunning=%d LocalIdle=%d LocalRunning=%d",
+		num.Hits, num.JobsCounted, num.JobsIdle, num.WeightedJobsIdle, num.JobsHeld,
+		num.SchedulerJobsIdle, num.SchedulerJobsRunning, num.LocalJobsIdle, num.LocalJobsRunning);
+	return str;
+}
+
+static std::string
+job_counts_str(const RealOwnerCounters & num)
+{
+	std::string str;
+	formatstr(str, "Hits=%d Counted=%d Idle=%d Held=%d SchedIdle=%d SchedRunning=%d LocalIdle=%d LocalRunning=%d",
+		num.Hits, num.JobsCounted, num.JobsIdle, num.JobsHeld,
+		num.SchedulerJobsIdle, num.SchedulerJobsRunning, num.LocalJobsIdle, num.LocalJobsRunning);
+	return str;
+}
+
+static std::string
+job_counts_str(const QueuedJobCounters & counts)
+{
+	std::string str;
+	formatstr(str, "Total=%d Idle=%d Running=%d Held=%d Removed=%d SchedIdle=%d SchedRunning=%d LocalIdle=%d LocalRunning=%d StatsRunning=%d NoStartDate=%d",
+		counts.JobsTotalAds, counts.JobsIdle, counts.JobsRunning, counts.JobsHeld, counts.JobsRemoved,
+		counts.SchedUniverseJobsIdle, counts.SchedUniverseJobsRunning,
+		counts.LocalUniverseJobsIdle, counts.LocalUniverseJobsRunning,
+		counts.StatsJobsRunning, counts.StatsJobsNoStartDate);
+	for (const auto & it : counts.StatsRunningSizes) { formatstr_cat(str, " Size[%lld]=%d", (long long)it.first, it.second); }
+	for (const auto & it : counts.StatsStartDates) { formatstr_cat(str, " Started[%d]=%d", it.first, it.second); }
+	return str;
+}
+
+// Everything in the job counts, one line per owner, submitter and grid user.
+void
+Scheduler::dump_job_counts(std::map<std::string, std::string> & dump)
+{
+	dump["schedd"] = job_counts_str(m_queuedCounts);
+
+	std::string & dedicated = dump["dedicated"];
+	for (const auto & it : m_queuedDedicatedClusters) { formatstr_cat(dedicated, " %d=%d", it.first, it.second); }
+
+	for (const auto & it : OwnersInfo) {
+		if (it.second.queued.Hits) { dump["owner " + it.first] = job_counts_str(it.second.queued); }
+	}
+	for (const auto & it : Submitters) {
+		const SubmitterData & SubDat = it.second;
+		if ( ! SubDat.queued.Hits) continue;
+		std::string & str = dump["submitter " + it.first];
+		str = job_counts_str(SubDat.queued);
+		for (const auto & prio : SubDat.queued_prios) { formatstr_cat(str, " Prio[%d]=%d", prio.first, prio.second); }
+		std::map<std::string, SubmitterFlockCounters> flock(SubDat.queued_flock.begin(), SubDat.queued_flock.end());
+		for (const auto & pool : flock) {
+			formatstr_cat(str, " Flock[%s]=%d/%d", pool.first.c_str(), pool.second.JobsIdle, pool.second.WeightedJobsIdle);
+		}
+	}
+
+	GridJobOwners.startIterations();
+	UserIdentity userident;
+	GridJobCounts gridcounts;
+	while (GridJobOwners.iterate(userident, gridcounts)) {
+		if ( ! gridcounts.GridJobs && ! gridcounts.UnmanagedGridJobs) continue;
+		std::string key;
+		formatstr(key, "grid %s@%s %s", userident.username().Value(), userident.domain().Value(), userident.auxid().Value());
+		formatstr(dump[key], "GridJobs=%u UnmanagedGridJobs=%u", gridcounts.GridJobs, gridcounts.UnmanagedGridJobs);
+	}
+}
+
+// SCHEDD_ASSERT_JOB_COUNTS: bring the job counts up to date the usual way, then
+// count every job from scratch, and make sure that the two agree.
+void
+Scheduler::check_job_counts()
+{
+	count_changed_jobs();
+
+	std::map<std::string, std::string> incremental;
+	dump_job_counts(incremental);
+
+	count_all_jobs();
+
+	std::map<std::string, std::string> full;
+	dump_job_counts(full);
+
+	if (incremental == full) {
+		return;
+	}
+	for (const auto & it : full) {
+		auto found = incremental.find(it.first);
+		if (found == incremental.end() || found->second != it.second) {
+			dprintf(D_ALWAYS, "Job counts for %s are %s, but should be %s\n", it.first.c_str(),
+				found == incremental.end() ? "missing" : found->second.c_str(), it.second.c_str());
+		}
+	}
+	for (const auto & it : incremental) {
+		if (full.find(it.first) == full.end()) {
+			dprintf(D_ALWAYS, "Job counts for %s are %s, but should be missing\n", it.first.c_str(), it.second.c_str());
+		}
+	}
+	EXCEPT("Job counts kept up to date as jobs changed do not match a count of the whole job queue");
 }
 
 bool
@@ -3936,9 +4242,122 @@ PeriodicExprEval(JobQueueJob *jobad, const JOB_ID_KEY & /*jid*/, void *)
 	return 1;
 }
 
+void
+Scheduler::periodicExprAttrsChanged(const JOB_ID_KEY & jid, const classad::References & attrs)
+{
+	if ( ! m_periodicExprIncremental || m_periodicExprWalkAll || jid.cluster <= 0) {
+		return;
+	}
+	for (const auto & attr : attrs) {
+		if (m_periodicExprRefs.count(attr)) {
+			m_periodicExprDirty.insert(jid);
+			return;
+		}
+	}
+}
+
+void
+Scheduler::periodicExprJobChanged(const JOB_ID_KEY & jid)
+{
+	if ( ! m_periodicExprIncremental || m_periodicExprWalkAll || jid.cluster <= 0) {
+		return;
+	}
+	m_periodicExprDirty.insert(jid);
+}
+
+#ifdef USE_NON_MUTATING_USERPOLICY
+/*
+Work out when the periodic expressions of a job must next be
+evaluated, then evaluate them.
+*/
+static int
+PeriodicExprEvalAndSchedule(JobQueueJob *jobad, const JOB_ID_KEY & jid, void * pvUser)
+{
+	if (jid.cluster <= 0 || jid.proc < 0) return 1;
+	scheduler.schedulePeriodicExprs(jobad, *(UserPolicy*)pvUser, time(NULL));
+	return PeriodicExprEval(jobad, jid, pvUser);
+}
+
+/*
+Learn which attributes the periodic policy of the job depends upon, and
+when the passage of time alone could next change its outcome.
+*/
+void
+Scheduler::schedulePeriodicExprs(JobQueueJob * job, UserPolicy & policy, time_t now)
+{
+	int step = (int)PeriodicExprInterval.getMinInterval();
+	int horizon = MAX(step, (int)PeriodicExprInterval.getMaxInterval());
+
+	time_t deadline;
+	int flags = policy.PeriodicPolicyReferences(*job, m_periodicExprRefs);
+	if (flags & PERIODIC_POLICY_VOLATILE) {
+		deadline = now + step;
+	} else {
+		deadline = policy.NextPeriodicPolicyChange(*job, now, step, horizon);
+	}
+
+	job->policy_deadline = deadline;
+	m_periodicExprDeadlines.push(std::make_pair(deadline, job->jid));
+}
+
+/*
+Evaluate the periodic user policy expressions of just the jobs
+that changed in a way the policy depends upon, or whose deadline
+has passed.  Returns the number of jobs evaluated.
+*/
+int
+Scheduler::EvalChangedPeriodicExprs(UserPolicy & policy)
+{
+	std::set<JOB_ID_KEY> due;
+	due.swap(m_periodicExprDirty);
+
+	time_t now = time(NULL);
+	while ( ! m_periodicExprDeadlines.empty() && m_periodicExprDeadlines.top().first <= now) {
+		const std::pair<time_t, JOB_ID_KEY> & top = m_periodicExprDeadlines.top();
+		JobQueueJob * job = GetJobAd(top.second.cluster, top.second.proc);
+		// jobs that were evaluated again since this deadline was set have a newer one.
+		if (job && job->policy_deadline == top.first) {
+			due.insert(top.second);
+		}
+		m_periodicExprDeadlines.pop();
+	}
+
+	int num_evaluated = 0;
+	std::vector<JOB_ID_KEY> jids;
+	for (const auto & jid : due) {
+		jids.clear();
+		if (jid.proc < 0) {
+				// a change to the cluster ad can change the policy of any of its jobs
+			JobQueueCluster * cad = GetClusterAd(jid.cluster);
+			if ( ! cad) continue;
+			for (JobQueueJob * job = cad->FirstJob(); job; job = cad->NextJob(job)) {
+				jids.push_back(job->jid);
+			}
+		} else {
+			jids.push_back(jid);
+		}
+		// evaluating a job can remove it from the queue, so look each one up again.
+		for (const auto & id : jids) {
+			JobQueueJob * job = GetJobAd(id.cluster, id.proc);
+			if (job) {
+				PeriodicExprEvalAndSchedule(job, id, &policy);
+				++num_evaluated;
+			}
+		}
+	}
+	return num_evaluated;
+}
+#endif
+
 /*
 For all of the jobs in the queue, evaluate the 
 periodic user policy expressions.
+
+When PERIODIC_EXPR_INCREMENTAL is true, the whole queue is walked
+only after a reconfig.  That walk learns which attributes each policy
+refers to and when the passage of time could next change its outcome.
+After that, only jobs that changed one of those attributes in a
+transaction, or whose deadline has passed, are evaluated again.
 */
 
 void
@@ -3949,8 +4368,27 @@ Scheduler::PeriodicExprHandler( void )
 	UserPolicy policy;
 #ifdef USE_NON_MUTATING_USERPOLICY
 	policy.Init();
-#endif
+	if ( ! m_periodicExprIncremental) {
+		WalkJobQueue2(PeriodicExprEval, &policy);
+	} else if ( ! m_periodicExprWalkAll) {
+		int num_evaluated = EvalChangedPeriodicExprs(policy);
+		dprintf(D_FULLDEBUG, "Evaluated periodic expressions of %d changed jobs\n", num_evaluated);
+	} else {
+		m_periodicExprWalkAll = false;
+		m_periodicExprDirty.clear();
+		m_periodicExprDeadlines = decltype(m_periodicExprDeadlines)();
+			// the attributes that decide whether the schedd is responsible for the policy of a job
+		m_periodicExprRefs.clear();
+		m_periodicExprRefs.insert(ATTR_JOB_STATUS);
+		m_periodicExprRefs.insert(ATTR_JOB_UNIVERSE);
+		m_periodicExprRefs.insert(ATTR_HOLD_REASON_CODE);
+		m_periodicExprRefs.insert(ATTR_JOB_MANAGED);
+		m_periodicExprRefs.insert(ATTR_GRID_JOB_ID);
+		WalkJobQueue3(PeriodicExprEvalAndSchedule, &policy, WalkJobQ_PeriodicExprEval_runtime);
+	}
+#else
 	WalkJobQueue2(PeriodicExprEval, &policy);
+#endif
 
 	PeriodicExprInterval.setFinishTimeNow();
 
@@ -9359,6 +9797,29 @@ Scheduler::spawnShadow( shadow_rec* srec )
 
 	wants_reconnect = srec->is_reconnect;
 
+		// Serial jobs may share a multiplexed shadow with other jobs
+		// of the same owner.
+	bool multiplex = false;
+	if( m_shadowMultiplex && mrec &&
+		( universe == CONDOR_UNIVERSE_VANILLA ||
+		  universe == CONDOR_UNIVERSE_JAVA ||
+		  universe == CONDOR_UNIVERSE_VM ) )
+	{
+		bool wantPS = false;
+		GetAttributeBool( job_id->cluster, job_id->proc,
+						  ATTR_WANT_PARALLEL_SCHEDULING, &wantPS );
+		multiplex = !wantPS;
+	}
+	if( multiplex ) {
+		int mux_pid = findMultiplexedShadow( srec );
+		if( mux_pid ) {
+			if( assignMultiplexedShadow( srec, mux_pid ) ) {
+				shadowStarted( srec );
+			}
+			return;
+		}
+	}
+
 #ifdef WIN32
 		// nothing to choose on NT, there's only 1 shadow
 	shadow_path = param("SHADOW");
@@ -9429,6 +9890,9 @@ Scheduler::spawnShadow( shadow_rec* srec )
 
 	sh_is_dc = shadow_obj->isDC();
 	bool sh_reads_file = shadow_obj->provides( ATTR_HAS_JOB_AD_FROM_FILE );
+	if( multiplex && ! shadow_obj->provides( ATTR_HAS_SHADOW_MULTIPLEX ) ) {
+		multiplex = false;
+	}
 	shadow_path = strdup( shadow_obj->path() );
 
 	delete( shadow_obj );
@@ -9460,6 +9924,10 @@ Scheduler::spawnShadow( shadow_rec* srec )
 				args.AppendArg("--reconnect");
 			}
 
+			if( multiplex ) {
+				args.AppendArg("--multiplex");
+			}
+
 			// pass the public ip/port of the schedd (used w/ reconnect)
 			// We need this even if we are not currently in reconnect mode,
 			// because the shadow may go into reconnect mode at any time.
@@ -9515,9 +9983,42 @@ Scheduler::spawnShadow( shadow_rec* srec )
 		return;
 	}
 
+	if( multiplex && sh_is_dc && sh_reads_file ) {
+			// this shadow will host more jobs, so key it by pid in
+			// m_multiplexedShadows rather than shadowsByPid
+		shadowsByPid->remove( srec->pid );
+		srec->multiplexed = true;
+		MultiplexedShadow &mux = m_multiplexedShadows[srec->pid];
+		GetAttributeString( job_id->cluster, job_id->proc, ATTR_OWNER, mux.owner );
+		mux.jobs.insert( srec );
+	}
+
+	shadowStarted( srec );
+
+		// if this is a shadow for an MPI job, we need to tell the
+		// dedicated scheduler we finally spawned it so it can update
+		// some of its own data structures, too.
+	bool sendToDS = false;
+	GetAttributeBool(job_id->cluster, job_id->proc, ATTR_WANT_PARALLEL_SCHEDULING, &sendToDS);
+
+	if( (sendToDS || universe == CONDOR_UNIVERSE_MPI ) ||
+	    (universe == CONDOR_UNIVERSE_PARALLEL) ){
+		dedicated_scheduler.shadowSpawned( srec );
+	}
+}
+
+
+void
+Scheduler::shadowStarted( shadow_rec* srec )
+{
+	match_rec* mrec = srec->match;
+	PROC_ID* job_id = &srec->job_id;
+	bool wants_reconnect = srec->is_reconnect;
+
 	dprintf( D_ALWAYS, "Started shadow for job %d.%d on %s, "
-			 "(shadow pid = %d)\n", job_id->cluster, job_id->proc,
-			 mrec->description(), srec->pid );
+			 "(shadow pid = %d%s)\n", job_id->cluster, job_id->proc,
+			 mrec->description(), srec->pid,
+			 srec->multiplexed ? ", multiplexed" : "" );
 
     //time_t now = time(NULL);
     time_t now = stats.Tick();
@@ -9549,17 +10050,175 @@ Scheduler::spawnShadow( shadow_rec* srec )
 		SetAttributeInt( job_id->cluster, job_id->proc, 
 						 ATTR_LAST_JOB_LEASE_RENEWAL, (int)time(0) );
 	}
+}
 
-		// if this is a shadow for an MPI job, we need to tell the
-		// dedicated scheduler we finally spawned it so it can update
-		// some of its own data structures, too.
-	bool sendToDS = false;
-	GetAttributeBool(job_id->cluster, job_id->proc, ATTR_WANT_PARALLEL_SCHEDULING, &sendToDS);
 
-	if( (sendToDS || universe == CONDOR_UNIVERSE_MPI ) ||
-	    (universe == CONDOR_UNIVERSE_PARALLEL) ){
-		dedicated_scheduler.shadowSpawned( srec );
+	// Returns the pid of a multiplexed shadow that is running jobs of
+	// this job's owner and can take another one, or 0 if there is none.
+int
+Scheduler::findMultiplexedShadow( shadow_rec* srec )
+{
+	std::string owner;
+	GetAttributeString( srec->job_id.cluster, srec->job_id.proc, ATTR_OWNER, owner );
+
+	std::map<int, MultiplexedShadow>::iterator it;
+	for( it = m_multiplexedShadows.begin(); it != m_multiplexedShadows.end(); ++it ) {
+		MultiplexedShadow &mux = it->second;
+		if( mux.accepting && mux.owner == owner &&
+			(int)mux.jobs.size() < m_shadowMultiplexMaxJobs &&
+			daemonCore->Is_Pid_Alive( it->first ) )
+		{
+			return it->first;
+		}
+	}
+	return 0;
+}
+
+
+class DCShadowMuxStartMsg: public DCMsg {
+public:
+	DCShadowMuxStartMsg(int pid, PROC_ID proc, bool reconnect, ClassAd *job_ad):
+		DCMsg(SHADOW_MUX_START_JOB),
+		m_pid(pid),
+		m_proc(proc),
+		m_reconnect(reconnect),
+		m_job_ad(job_ad),
+		m_accepted(0)
+	{
+	}
+
+	virtual ~DCShadowMuxStartMsg()
+	{
+		delete m_job_ad;
+	}
+
+	virtual bool writeMsg( DCMessenger *, Sock *sock )
+	{
+		if( !sock->put( (int)m_reconnect ) ||
+			!putClassAd( sock, *m_job_ad ) )
+		{
+			sockFailed( sock );
+			return false;
+		}
+		return true;
+	}
+
+	virtual MessageClosureEnum messageSent(
+				DCMessenger *messenger, Sock *sock )
+	{
+		messenger->startReceiveMsg( this, sock );
+		return MESSAGE_CONTINUING;
+	}
+
+	virtual bool readMsg( DCMessenger *, Sock *sock )
+	{
+		if( !sock->get( m_accepted ) ) {
+			sockFailed( sock );
+			return false;
+		}
+		return true;
+	}
+
+	virtual MessageClosureEnum messageReceived(
+				DCMessenger *messenger, Sock *sock )
+	{
+		if( ! m_accepted ) {
+			scheduler.multiplexedShadowRefused( m_proc, m_pid );
+		}
+		return DCMsg::messageReceived( messenger, sock );
+	}
+
+	virtual void messageSendFailed( DCMessenger *messenger )
+	{
+		scheduler.multiplexedShadowRefused( m_proc, m_pid );
+		DCMsg::messageSendFailed( messenger );
+	}
+
+	virtual void messageReceiveFailed( DCMessenger *messenger )
+	{
+		scheduler.multiplexedShadowRefused( m_proc, m_pid );
+		DCMsg::messageReceiveFailed( messenger );
+	}
+
+private:
+	int m_pid;
+	PROC_ID m_proc;
+	bool m_reconnect;
+	ClassAd *m_job_ad;
+	int m_accepted;
+};
+
+
+	// Hand the job of srec to the multiplexed shadow pid instead of
+	// spawning a new shadow.  Returns false (after cleaning up srec)
+	// if the job could not be handed off.
+bool
+Scheduler::assignMultiplexedShadow( shadow_rec* srec, int pid )
+{
+	PROC_ID* job_id = &srec->job_id;
+
+	srec->pid = 0;
+	add_shadow_rec( srec );
+	time_t now = stats.Tick();
+	stats.ShadowsRunning = numShadows;
+	OtherPoolStats.Tick(now);
+
+		// expand $$ stuff and persist expansions, as spawnJobHandlerRaw() does
+	ClassAd *job_ad = GetExpandedJobAd( *job_id, true );
+	if( ! job_ad ) {
+		dprintf( D_ALWAYS, "ERROR: Failed to get classad for job "
+				 "%d.%d, can't hand it to a shadow, aborting\n",
+				 job_id->cluster, job_id->proc );
+		mark_job_stopped( job_id );
+		delete_shadow_rec( srec );
+		return false;
+	}
+
+	const char *addr = daemonCore->InfoCommandSinfulString( pid );
+	if( ! addr ) {
+		dprintf( D_ALWAYS, "ERROR: no address for multiplexed shadow "
+				 "pid %d\n", pid );
+		delete job_ad;
+		m_multiplexedShadows[pid].accepting = false;
+		mark_job_stopped( job_id );
+		delete_shadow_rec( srec );
+		return false;
+	}
+
+	srec->pid = pid;
+	srec->multiplexed = true;
+	m_multiplexedShadows[pid].jobs.insert( srec );
+
+	ClassAd *machine_ad = srec->match ? srec->match->my_match_ad : NULL;
+	setNextJobDelay( job_ad, machine_ad );
+
+	classy_counted_ptr<Daemon> shadow = new Daemon( DT_ANY, addr );
+	classy_counted_ptr<DCShadowMuxStartMsg> msg =
+		new DCShadowMuxStartMsg( pid, *job_id, srec->is_reconnect, job_ad );
+	msg->setStreamType( Stream::reli_sock );
+	shadow->sendMsg( msg.get() );
+	return true;
+}
+
+
+	// A multiplexed shadow did not take the job we handed it.  The job
+	// never started, so treat it as if its shadow exited that way, and
+	// stop giving that shadow more jobs.
+void
+Scheduler::multiplexedShadowRefused( PROC_ID job_id, int pid )
+{
+	std::map<int, MultiplexedShadow>::iterator it = m_multiplexedShadows.find( pid );
+	if( it != m_multiplexedShadows.end() ) {
+		it->second.accepting = false;
+	}
+
+	shadow_rec *srec = FindSrecByProcID( job_id );
+	if( ! srec || ! srec->multiplexed || srec->pid != pid ) {
+		return;
 	}
+	dprintf( D_ALWAYS, "Multiplexed shadow pid %d did not take job %d.%d\n",
+			 pid, job_id.cluster, job_id.proc );
+	shadow_exit( srec, JOB_NOT_STARTED << 8 );
 }
 
 
@@ -10615,6 +11274,13 @@ Scheduler::display_shadow_recs()
 				r->match ? r->match->peer : "localhost",
 				cur_hosts, status);
 	}
+	std::map<int, MultiplexedShadow>::iterator mux;
+	for( mux = m_multiplexedShadows.begin(); mux != m_multiplexedShadows.end(); ++mux ) {
+		dprintf( D_FULLDEBUG, ".. %d, multiplexed, owner=%s, %d jobs%s\n",
+				 mux->first, mux->second.owner.c_str(),
+				 (int)mux->second.jobs.size(),
+				 mux->second.accepting ? "" : ", not accepting" );
+	}
 	dprintf( D_FULLDEBUG, "..................\n\n" );
 }
 
@@ -10631,7 +11297,8 @@ shadow_rec::shadow_rec():
 	reconnect_done(false),
 	keepClaimAttributes(false),
 	recycle_shadow_stream(NULL),
-	exit_already_handled(false)
+	exit_already_handled(false),
+	multiplexed(false)
 {
 	prev_job_id.proc = -1;
 	prev_job_id.cluster = -1;
@@ -11305,10 +11972,17 @@ Scheduler::delete_shadow_rec( shadow_rec *rec )
 		RemoveShadowRecFromMrec(rec);
 	}
 
-	if( pid ) {
+	if( rec->multiplexed ) {
+		std::map<int, MultiplexedShadow>::iterator mux = m_multiplexedShadows.find( pid );
+		if( mux != m_multiplexedShadows.end() ) {
+			mux->second.jobs.erase( rec );
+		}
+	} else if( pid ) {
 		shadowsByPid->remove(pid);
 	}
 	shadowsByProcID->remove(rec->job_id);
+		// the schedd is not responsible for the policy of jobs that have a shadow
+	periodicExprJobChanged(rec->job_id);
 	if ( rec->conn_fd != -1 ) {
 		close(rec->conn_fd);
 	}
@@ -11535,7 +12209,17 @@ Scheduler::preempt( int n, bool force_sched_jobs )
 			 force_sched_jobs  ? " forcing scheduler/local univ preemptions" : "",
 			 ExitWhenDone ? " for a graceful shutdown" : "" );
 
+		// jobs hosted by multiplexed shadows are not in shadowsByPid,
+		// so gather everything we might preempt up front
+	std::vector<shadow_rec*> srecs;
 	shadowsByPid->startIterations();
+	while( shadowsByPid->iterate(rec) == 1 ) {
+		srecs.push_back( rec );
+	}
+	std::map<int, MultiplexedShadow>::iterator mux;
+	for( mux = m_multiplexedShadows.begin(); mux != m_multiplexedShadows.end(); ++mux ) {
+		srecs.insert( srecs.end(), mux->second.jobs.begin(), mux->second.jobs.end() );
+	}
 
 	/* Now we loop until we are out of shadows or until we've preempted
 	 * `n' shadows.  Note that the behavior of this loop is slightly 
@@ -11544,7 +12228,8 @@ Scheduler::preempt( int n, bool force_sched_jobs )
 	 * ExitWhenDone is False, we will preempt n minus the number of shadows we
 	 * have previously told to preempt but are still waiting for them to exit.
 	 */
-	while (shadowsByPid->iterate(rec) == 1 && n > 0) {
+	for( size_t i = 0; i < srecs.size() && n > 0; i++ ) {
+		rec = srecs[i];
 		if( is_alive(rec) ) {
 			if( rec->preempted ) {
 				if( ! ExitWhenDone ) {
@@ -11890,7 +12575,71 @@ set_job_status(int cluster, int proc, int status)
 void
 Scheduler::child_exit(int pid, int status)
 {
-	shadow_rec*     srec;
+	if( m_multiplexedShadows.find( pid ) != m_multiplexedShadows.end() ) {
+		multiplexed_shadow_exit( pid, status );
+		return;
+	}
+
+	shadow_rec *srec = FindSrecByPid(pid);
+	ASSERT(srec);
+	shadow_exit( srec, status );
+}
+
+
+	// A multiplexed shadow process exited.  A job that made it crash
+	// was reported with MULTIPLEXED_SHADOW_JOB_EXIT before the shadow
+	// exited, so the jobs it still hosts are bystanders: we detach from
+	// them as if we were shutting down, and spawn new shadows that
+	// reconnect to their starters.  Jobs that cannot reconnect (no
+	// claim, or an expired lease) go back to idle without an exception
+	// being charged to them.
+void
+Scheduler::multiplexed_shadow_exit(int pid, int status)
+{
+	std::set<shadow_rec*> jobs;
+	jobs.swap( m_multiplexedShadows[pid].jobs );
+	m_multiplexedShadows.erase( pid );
+
+	if( WIFSIGNALED(status) ) {
+		dprintf( D_ALWAYS, "Multiplexed shadow pid %d died with %s, "
+				 "%d jobs still hosted by it\n", pid,
+				 daemonCore->GetExceptionString(status), (int)jobs.size() );
+	} else {
+		dprintf( D_ALWAYS, "Multiplexed shadow pid %d exited with status "
+				 "%d, %d jobs still hosted by it\n", pid,
+				 WEXITSTATUS(status), (int)jobs.size() );
+	}
+
+	std::set<shadow_rec*>::iterator it;
+	for( it = jobs.begin(); it != jobs.end(); ++it ) {
+		shadow_rec *srec = *it;
+		if( ExitWhenDone ) {
+				// we stopped the shadow ourselves while shutting down
+			shadow_exit( srec, status );
+			continue;
+		}
+		if( srec->exit_already_handled || srec->removed || ! srec->match ) {
+				// nothing to reconnect to
+			shadow_exit( srec, JOB_SHOULD_REQUEUE << 8 );
+			continue;
+		}
+
+		PROC_ID job_id = srec->job_id;
+		dprintf( D_ALWAYS, "Reconnecting job %d.%d, which was hosted by "
+				 "multiplexed shadow pid %d\n", job_id.cluster, job_id.proc,
+				 pid );
+		srec->keepClaimAttributes = true;
+		delete_shadow_rec( srec );
+		stats.JobsRestartReconnectsAttempting += 1;
+		enqueueReconnectJob( job_id );
+	}
+}
+
+
+void
+Scheduler::shadow_exit(shadow_rec* srec, int status)
+{
+	int             pid = srec->pid;
 	int             StartJobsFlag=TRUE;
 	PROC_ID	        job_id;
 	bool            srec_was_local_universe = false;
@@ -11901,9 +12650,6 @@ Scheduler::child_exit(int pid, int status)
 	// AsyncXfer: Should this match be held idle waiting for a paired match?
 	bool            paired_match_wait = false;
 
-	srec = FindSrecByPid(pid);
-	ASSERT(srec);
-
 	if( srec->match ) {
 		match_rec *mrec = srec->match;
 
@@ -11970,7 +12716,7 @@ Scheduler::child_exit(int pid, int status)
  		// scheduler universe process
 		daemonCore->Kill_Family( pid );
 		scheduler_univ_job_exit(pid,status,srec);
-		delete_shadow_rec( pid );
+		delete_shadow_rec( srec );
 		// even though this will get set correctly in
 		// count_jobs(), try to keep it accurate here, too.
 		if( SchedUniverseJobsRunning > 0 ) {
@@ -12046,7 +12792,7 @@ Scheduler::child_exit(int pid, int status)
 
 		// We always want to delete the shadow record regardless
 		// of how the job exited
-		delete_shadow_rec( pid );
+		delete_shadow_rec( srec );
 
 	} 
 
@@ -13284,6 +14030,9 @@ Scheduler::Init()
 	/* Value specified in kilobytes */
 	ShadowSizeEstimate = param_integer( "SHADOW_SIZE_ESTIMATE",DEFAULT_SHADOW_SIZE );
 
+	m_shadowMultiplex = param_boolean( "SHADOW_MULTIPLEX", false );
+	m_shadowMultiplexMaxJobs = param_integer( "SHADOW_MULTIPLEX_MAX_JOBS", 100, 1 );
+
 	alive_interval = param_integer("ALIVE_INTERVAL",300,0);
 	if( alive_interval > leaseAliveInterval ) {
 			// adjust alive_interval to shortest interval of jobs in the queue
@@ -13547,6 +14296,17 @@ Scheduler::Init()
 	}
 	m_use_slot_weights = param_boolean("SCHEDD_USE_SLOT_WEIGHT", true);
 
+		// the job counts depend on the slot weight, flocking and job prio knobs,
+		// so count every job again after a reconfig.
+	m_countAllJobs = true;
+	m_countAllJobsInterval = param_integer("SCHEDD_JOB_COUNTS_RECOUNT_INTERVAL", 60*30, 0);
+	m_checkJobCounts = param_boolean("SCHEDD_ASSERT_JOB_COUNTS", false);
+
+		// the SYSTEM_PERIODIC_* expressions may have changed, so the next
+		// periodic evaluation learns what every job depends upon again.
+	m_periodicExprIncremental = param_boolean("PERIODIC_EXPR_INCREMENTAL", false);
+	m_periodicExprWalkAll = true;
+
 	char *sw = param("SCHEDD_SLOT_WEIGHT");
 	if (sw) {
 		ParseClassAdRvalExpr(sw, slotWeightOfJob);
@@ -13707,6 +14467,12 @@ Scheduler::Register()
 			"RecycleShadow", this, DAEMON, D_COMMAND,
 			true /*force authentication*/);
 
+	 daemonCore->Register_CommandWithPayload(MULTIPLEXED_SHADOW_JOB_EXIT,
+			"MULTIPLEXED_SHADOW_JOB_EXIT",
+			(CommandHandlercpp)&Scheduler::MultiplexedShadowJobExit,
+			"MultiplexedShadowJobExit", this, DAEMON, D_COMMAND,
+			true /*force authentication*/);
+
 		 // Commands used by the startd are registered at READ
 		 // level rather than something like DAEMON or WRITE in order
 		 // to reduce the level of authority that the schedd must
@@ -13894,7 +14660,7 @@ Scheduler::RegisterTimers()
         }
         cleanid =
             daemonCore->Register_Timer(QueueCleanInterval,QueueCleanInterval,
-            CleanJobQueue,"CleanJobQueue");
+            PeriodicCleanJobQueue,"PeriodicCleanJobQueue");
     }
     oldQueueCleanInterval = QueueCleanInterval;
 
@@ -14128,6 +14894,13 @@ Scheduler::shutdown_fast()
 					sig, rec->pid,
 					rec->job_id.cluster, rec->job_id.proc );
 	}
+	std::map<int, MultiplexedShadow>::iterator mux;
+	for( mux = m_multiplexedShadows.begin(); mux != m_multiplexedShadows.end(); ++mux ) {
+		daemonCore->Send_Signal(mux->first,SIGKILL);
+		dprintf( D_ALWAYS, "Sent signal %d to multiplexed shadow [pid %d] "
+				 "hosting %d jobs\n", SIGKILL, mux->first,
+				 (int)mux->second.jobs.size() );
+	}
 
 	// Shut down the cron logic
 	if( CronJobMgr ) {
@@ -15001,7 +15774,11 @@ Scheduler::sendAlives()
 				DelMrec( mrec );
 				jobExitCode( srec->job_id, JOB_RECONNECT_FAILED );
 				srec->exit_already_handled = true;
-				daemonCore->Send_Signal( srec->pid, SIGKILL );
+				if( srec->multiplexed ) {
+					sendSignalToShadow( srec->pid, SIGKILL, srec->job_id );
+				} else {
+					daemonCore->Send_Signal( srec->pid, SIGKILL );
+				}
 			}
 		}
 	}
@@ -16802,9 +17579,101 @@ private:
 	int m_sig;
 };
 
+	// A signal for one job hosted by a multiplexed shadow.  The shadow
+	// process must keep running for its other jobs, so we send it a
+	// command naming the job instead of a process signal.
+class DCShadowMuxSignalMsg: public DCMsg {
+public:
+	DCShadowMuxSignalMsg(pid_t pid, int sig, PROC_ID proc):
+		DCMsg(SHADOW_MUX_SIGNAL_JOB),
+		m_pid(pid),
+		m_sig(sig),
+		m_proc(proc)
+	{
+	}
+
+	virtual bool writeMsg( DCMessenger *, Sock *sock )
+	{
+		if( !sock->put( m_proc.cluster ) ||
+			!sock->put( m_proc.proc ) ||
+			!sock->put( m_sig ) )
+		{
+			sockFailed( sock );
+			return false;
+		}
+		return true;
+	}
+
+	virtual bool readMsg( DCMessenger *, Sock *sock )
+	{
+		if( !sock->get( m_proc.cluster ) ||
+			!sock->get( m_proc.proc ) ||
+			!sock->get( m_sig ) )
+		{
+			sockFailed( sock );
+			return false;
+		}
+		return true;
+	}
+
+	virtual MessageClosureEnum messageSent(
+				DCMessenger *messenger, Sock *sock )
+	{
+		shadow_rec *srec = scheduler.FindSrecByProcID( m_proc );
+		if( srec && srec->multiplexed && srec->pid == m_pid ) {
+			switch(m_sig)
+			{
+			case DC_SIGSUSPEND:
+			case DC_SIGCONTINUE:
+				break;
+			case SIGKILL:
+					// the shadow drops the job without reporting
+					// back, as if its process had been killed
+				scheduler.shadow_exit( srec, SIGKILL );
+				break;
+			default:
+				srec->preempt_pending = false;
+				srec->preempted = true;
+			}
+		}
+		return DCMsg::messageSent(messenger,sock);
+	}
+
+	virtual void messageSendFailed( DCMessenger *messenger )
+	{
+		shadow_rec *srec = scheduler.FindSrecByProcID( m_proc );
+		if( srec && srec->multiplexed && srec->pid == m_pid ) {
+			if( m_sig == SIGKILL ) {
+				scheduler.shadow_exit( srec, SIGKILL );
+			} else {
+				srec->preempt_pending = false;
+			}
+		}
+		DCMsg::messageSendFailed( messenger );
+	}
+
+private:
+	pid_t m_pid;
+	int m_sig;
+	PROC_ID m_proc;
+};
+
 void
 Scheduler::sendSignalToShadow(pid_t pid,int sig,PROC_ID proc)
 {
+	shadow_rec *srec = FindSrecByProcID( proc );
+	if( srec && srec->multiplexed && srec->pid == pid ) {
+		const char *addr = daemonCore->InfoCommandSinfulString( pid );
+		if( addr ) {
+			classy_counted_ptr<Daemon> shadow = new Daemon( DT_ANY, addr );
+			classy_counted_ptr<DCShadowMuxSignalMsg> msg =
+				new DCShadowMuxSignalMsg( pid, sig, proc );
+			msg->setStreamType( Stream::reli_sock );
+			shadow->sendMsg( msg.get() );
+			return;
+		}
+	}
+
 	classy_counted_ptr<DCShadowKillMsg> msg = new DCShadowKillMsg(pid,sig,proc);
 	daemonCore->Send_Signal_nonblocking(msg.get());
 
@@ -17065,6 +17934,65 @@ Scheduler::finishRecycleShadow(shadow_rec *srec)
 	delete stream;
 }
 
+int
+Scheduler::MultiplexedShadowJobExit(int /*cmd*/, Stream *stream)
+{
+		// This is called by a multiplexed shadow when one of the jobs
+		// it hosts is done.  The shadow process keeps running, so this
+		// stands in for the reaper for that one job.
+	int shadow_pid = 0;
+	int exit_reason = 0;
+	PROC_ID job_id;
+	Sock *sock = (Sock *)stream;
+
+		// force authentication
+	sock->decode();
+	if( !sock->triedAuthentication() ) {
+		CondorError errstack;
+		if( ! SecMan::authenticate_sock(sock, WRITE, &errstack) ||
+			! sock->getFullyQualifiedUser() )
+		{
+			dprintf( D_ALWAYS,
+					 "MultiplexedShadowJobExit(): authentication failed: %s\n",
+					 errstack.getFullText().c_str() );
+			return FALSE;
+		}
+	}
+
+	stream->decode();
+	if( !stream->get( shadow_pid ) ||
+		!stream->get( job_id.cluster ) ||
+		!stream->get( job_id.proc ) ||
+		!stream->get( exit_reason ) ||
+		!stream->end_of_message() )
+	{
+		dprintf(D_ALWAYS,
+			"MultiplexedShadowJobExit() failed to receive job exit reason "
+			"from shadow\n");
+		return FALSE;
+	}
+
+	shadow_rec *srec = FindSrecByProcID( job_id );
+	bool known = srec && srec->multiplexed && srec->pid == shadow_pid;
+
+	stream->encode();
+	if( !stream->put( (int)known ) || !stream->end_of_message() ) {
+		dprintf(D_ALWAYS,
+			"MultiplexedShadowJobExit() failed to reply to shadow %d\n",
+			shadow_pid);
+	}
+
+	if( !known ) {
+		dprintf(D_ALWAYS, "MultiplexedShadowJobExit() called by shadow %d "
+				"for job %d.%d, which it does not host\n",
+				shadow_pid, job_id.cluster, job_id.proc);
+		return FALSE;
+	}
+
+	shadow_exit( srec, exit_reason << 8 );
+	return TRUE;
+}
+
 int
 Scheduler::FindGManagerPid(PROC_ID job_id)
 {
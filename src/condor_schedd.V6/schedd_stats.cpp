@@ -86,6 +86,10 @@ static const time_t default_job_hist_lifes[] = {
       (time_t) 8 * 24*60*60, (time_t)16 * 24*60*60,  //  8 Day  16 Day,
       };
 static const char default_lifes_set[] = "30Sec, 1Min, 3Min, 10Min, 30Min, 1Hr, 3Hr, 6Hr, 12Hr, 1Day, 2Day, 4Day, 8Day, 16Day";
+static const int default_group_commit_sizes[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256 };
+static const char default_group_commit_sizes_set[] = "1, 2, 4, 8, 16, 32, 64, 128, 256";
+static const double default_sync_times[] = { 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 5.0 };
+static const char default_sync_times_set[] = "1Ms, 2Ms, 5Ms, 10Ms, 20Ms, 50Ms, 100Ms, 200Ms, 500Ms, 1Sec, 2Sec, 5Sec";
 
 void ScheddJobCounters::InitJobCounters(StatisticsPool &Pool, int base_verbosity)
 {
@@ -192,6 +196,14 @@ void ScheddStatistics::InitMain()
    SCHEDD_STATS_ADD_RECENT(Pool, ShadowsRecycled,           IF_VERBOSEPUB);
    SCHEDD_STATS_ADD_RECENT(Pool, ShadowsReconnections,      IF_VERBOSEPUB);
 
+   JobQueueGroupCommitSize.set_levels(default_group_commit_sizes, COUNTOF(default_group_commit_sizes));
+   JobQueueSyncTime.set_levels(default_sync_times, COUNTOF(default_sync_times));
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueueCommits,           IF_BASICPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueueGroupCommitSize,   IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueueSyncTime,          IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, BulkSubmitProcs,           IF_BASICPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, BulkSubmitRuntime,         IF_VERBOSEPUB);
+
    SCHEDD_STATS_ADD_VAL(Pool, ShadowsRunning,               IF_BASICPUB);
    SCHEDD_STATS_PUB_PEAK(Pool, ShadowsRunning,              IF_BASICPUB);
 
@@ -289,10 +301,20 @@ void ScheddStatistics::Publish(ClassAd & ad, int flags) const
       ad.Assign("StatsLifetime", (int)StatsLifetime);
       ad.Assign("JobsSizesHistogramBuckets", default_sizes_set);
       ad.Assign("JobsRuntimesHistogramBuckets", default_lifes_set);
+      if (flags & IF_VERBOSEPUB) {
+         ad.Assign("JobQueueGroupCommitSizeHistogramBuckets", default_group_commit_sizes_set);
+         ad.Assign("JobQueueSyncTimeHistogramBuckets", default_sync_times_set);
+      }
       if (flags & IF_VERBOSEPUB)
          ad.Assign("StatsLastUpdateTime", (int)StatsLastUpdateTime);
       if (flags & IF_RECENTPUB) {
          ad.Assign("RecentStatsLifetime", (int)RecentStatsLifetime);
+         if (RecentStatsLifetime > 0) {
+            ad.Assign("RecentJobQueueCommitRate", (double)JobQueueCommits.recent / RecentStatsLifetime);
+         }
+         if (BulkSubmitRuntime.recent > 0) {
+            ad.Assign("RecentBulkSubmitRate", BulkSubmitProcs.recent / BulkSubmitRuntime.recent);
+         }
          if (flags & IF_VERBOSEPUB) {
             ad.Assign("RecentWindowMax", (int)RecentWindowMax);
             ad.Assign("RecentStatsTickTime", (int)RecentStatsTickTime);
@@ -131,6 +131,15 @@ typedef struct ScheddStatistics : public ScheddJobCounters {
    //stats_entry_recent<int> ShadowExceptions;     // number of times shadows have excepted
    stats_entry_recent<int> ShadowsReconnections; // number of times shadows have reconnected
 
+   // job queue log commits, and the syncs done for them when SCHEDD_JOB_QUEUE_GROUP_COMMIT is enabled
+   stats_entry_recent<int> JobQueueCommits;                       // number of durable job queue transactions
+   stats_entry_recent_histogram<int> JobQueueGroupCommitSize;     // number of transactions made durable by each sync
+   stats_entry_recent_histogram<double> JobQueueSyncTime;         // time spent in each sync of the job queue log
+
+   // procs created by the CONDOR_BulkSubmit command, and the time spent creating them
+   stats_entry_recent<int> BulkSubmitProcs;
+   stats_entry_recent<double> BulkSubmitRuntime;
+
 
    // non-published values
    time_t InitTime;            // last time we init'ed the structure
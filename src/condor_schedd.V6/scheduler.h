@@ -89,6 +89,7 @@ class JobQueueJob;
 extern int updateSchedDInterval( JobQueueJob*, const JOB_ID_KEY&, void* );
 
 class JobQueueCluster;
+class UserPolicy;
 
 //typedef std::set<JOB_ID_KEY> JOB_ID_SET;
 class LocalJobRec {
@@ -142,6 +143,7 @@ struct shadow_rec
 	PROC_ID			prev_job_id;
 	Stream*			recycle_shadow_stream;
 	bool			exit_already_handled;
+	bool			multiplexed;	// pid is a shadow hosting many jobs
 
 	shadow_rec();
 	~shadow_rec();
@@ -228,6 +230,11 @@ struct SubmitterData {
   bool empty() const { return name.empty(); }
   SubmitterCounters num;
   std::unordered_map<std::string, SubmitterFlockCounters> flock; // Per-pool flock information
+  // the part of num, flock and PrioSet that comes from jobs in the queue. These are kept
+  // up to date as jobs change, and copied into num, flock and PrioSet by count_jobs()
+  SubmitterCounters queued;
+  std::unordered_map<std::string, SubmitterFlockCounters> queued_flock;
+  std::map<int, int> queued_prios; // number of jobs at each priority
   std::unordered_set<std::string> owners; // Number of unique owners observed using this submitter.
   time_t LastHitTime; // records the last time we incremented num.Hit, use to expire Owners
   // Time of most recent change in flocking level or
@@ -288,6 +295,7 @@ struct OwnerInfo {
   const char * Name() const { return name.empty() ? "" : name.c_str(); }
   bool empty() const { return name.empty(); }
   RealOwnerCounters num; // job counts by OWNER rather than by submitter
+  RealOwnerCounters queued; // the counts in num as of the last time a job changed, copied into num by count_jobs()
   LiveJobCounters live; // job counts that are always up-to-date with the committed job state
   time_t LastHitTime; // records the last time we incremented num.Hit, use to expire OwnerInfo
   OwnerInfo() : LastHitTime(0) { }
@@ -403,6 +411,52 @@ struct GridJobCounts {
 	unsigned int UnmanagedGridJobs;
 };
 
+// The job counts that count_a_job() adds up for the schedd as a whole. These are kept
+// up to date as jobs change, and copied into the Scheduler's counters by count_jobs()
+struct QueuedJobCounters {
+	int JobsRunning{0};
+	int JobsIdle{0};
+	int JobsHeld{0};
+	int JobsRemoved{0};
+	int JobsTotalAds{0};
+	int SchedUniverseJobsIdle{0};
+	int SchedUniverseJobsRunning{0};
+	int LocalUniverseJobsIdle{0};
+	int LocalUniverseJobsRunning{0};
+	// running jobs, for stats.JobsRunning, JobsRunningSizes and JobsRunningRuntimes.
+	// the histograms are rebuilt from these maps because the runtimes change with the clock
+	int StatsJobsRunning{0};
+	int StatsJobsNoStartDate{0};
+	std::map<int64_t, int> StatsRunningSizes;  // image size in bytes -> number of jobs
+	std::map<int, int> StatsStartDates;        // JobStartDate -> number of jobs
+};
+
+// What count_a_job() added to the job counters for a single job, so that it can be
+// taken back out again when the job changes or leaves the queue.
+struct JobCountsEntry {
+	unsigned int generation{0}; // entries from before the last full count were cleared with it
+	SubmitterData * submitter{nullptr};
+	OwnerInfo * owner{nullptr};
+	int status{0};
+	int universe{0};
+	int cur_hosts{0};
+	int max_hosts{0};
+	bool serviced{false};       // the schedd does matchmaking for this job
+	int image_size{0};
+	bool has_start_date{false};
+	int start_date{0};
+	int dedicated_cluster{0};   // idle parallel cluster for the DedicatedScheduler
+	bool grid{false};
+	UserIdentity grid_user;
+	int grid_jobs{0};
+	int unmanaged_grid_jobs{0};
+	bool has_prio{false};
+	int prio{0};
+	int idle_weight{0};
+	bool default_flock{false};
+	std::vector<std::string> flock_targets; // FlockTo entries other than "default"
+};
+
 enum MrecStatus {
     M_UNCLAIMED,
 	M_STARTD_CONTACT_LIMBO,  // after contacting startd; before recv'ing reply
@@ -556,6 +610,12 @@ class Scheduler : public Service
 	friend	int		NewProc(int cluster_id);
 	friend	int		count_a_job(JobQueueJob*, const JOB_ID_KEY&, void* );
 //	friend	void	job_prio(ClassAd *);
+
+		// Tell count_jobs() which ads a committed transaction touched,
+		// so that only those jobs are counted again.
+	void			jobCountsChanged(const std::set<std::string> & keys);
+		// Take a job out of the job counts when it leaves the queue.
+	void			uncountJob(JobQueueJob * job);
 	void			AddRunnableLocalJobs();
 	bool			IsLocalJobEligibleToRun(JobQueueJob* job);
 	friend	int		updateSchedDInterval(JobQueueJob*, const JOB_ID_KEY&, void* );
@@ -573,12 +633,22 @@ class Scheduler : public Service
 	int				spoolJobFilesReaper(int,int);	
 	int				transferJobFilesReaper(int,int);
 	void			PeriodicExprHandler( void );
+		// Tell the periodic policy evaluation which ads a transaction is about
+		// to change; attrs are the attributes the transaction sets for that ad.
+	bool			periodicExprsIncremental() const { return m_periodicExprIncremental; }
+	void			periodicExprAttrsChanged(const JOB_ID_KEY & jid, const classad::References & attrs);
+	void			periodicExprJobChanged(const JOB_ID_KEY & jid);
+	void			schedulePeriodicExprs(JobQueueJob * job, UserPolicy & policy, time_t now);
+	int				EvalChangedPeriodicExprs(UserPolicy & policy);
 	void			addCronTabClassAd( JobQueueJob* );
 	void			addCronTabClusterId( int );
 	void			indexAJob(JobQueueJob* job, bool loading_job_queue=false);
 	void			removeJobFromIndexes(const JOB_ID_KEY& job_id, int job_prio=0);
 	int				RecycleShadow(int cmd, Stream *stream);
 	void			finishRecycleShadow(shadow_rec *srec);
+	int				MultiplexedShadowJobExit(int cmd, Stream *stream);
+	void			multiplexedShadowRefused(PROC_ID job_id, int pid);
+	void			shadow_exit(shadow_rec *srec, int status);
 
 	int				requestSandboxLocation(int mode, Stream* s);
 	int			FindGManagerPid(PROC_ID job_id);
@@ -617,6 +687,9 @@ class Scheduler : public Service
 	void			StartJobHandler();
 	void			addRunnableJob( shadow_rec* );
 	void			spawnShadow( shadow_rec* );
+	int				findMultiplexedShadow( shadow_rec* );
+	bool			assignMultiplexedShadow( shadow_rec*, int pid );
+	void			shadowStarted( shadow_rec* );
 	void			spawnLocalStarter( shadow_rec* );
 	bool			claimLocalStartd();
 	bool			isStillRunnable( int cluster, int proc, int &status ); 
@@ -973,6 +1046,11 @@ private:
 
 	// utility functions
 	int			count_jobs();
+	void		count_all_jobs();
+	void		count_changed_jobs();
+	void		apply_job_counts(const JobCountsEntry & entry, int sign);
+	void		check_job_counts();
+	void		dump_job_counts(std::map<std::string, std::string> & dump);
 	bool		fill_submitter_ad(ClassAd & pAd, const SubmitterData & Owner, const std::string &pool_name, int flock_level);
 	int			make_ad_list(ClassAdList & ads, ClassAd * pQueryAd=NULL);
 	int			handleMachineAdsQuery( Stream * stream, ClassAd & queryAd );
@@ -988,6 +1066,7 @@ private:
 	OwnerInfo * get_ownerinfo(JobQueueJob * job);
 	void		remove_unused_owners();
 	void			child_exit(int, int);
+	void			multiplexed_shadow_exit(int pid, int status);
 	// AFAICT, reapers should be be registered void to begin with.
 	int				child_exit_from_reaper(int a, int b) { child_exit(a, b); return 0; }
 	void			scheduler_univ_job_exit(int pid, int status, shadow_rec * srec);
@@ -1067,6 +1146,18 @@ private:
 	HashTable <PROC_ID, match_rec *> *matchesByJobID;
 	HashTable <int, shadow_rec *> *shadowsByPid;
 	HashTable <PROC_ID, shadow_rec *> *shadowsByProcID;
+
+		// Shadows that host many jobs (SHADOW_MULTIPLEX).  Their shadow
+		// records are not in shadowsByPid, since they share a pid.
+	struct MultiplexedShadow {
+		std::string owner;
+		std::set<shadow_rec*> jobs;
+		bool accepting;
+		MultiplexedShadow() : accepting(true) {}
+	};
+	std::map<int, MultiplexedShadow> m_multiplexedShadows; // keyed by pid
+	bool			m_shadowMultiplex;        // SHADOW_MULTIPLEX
+	int				m_shadowMultiplexMaxJobs; // SHADOW_MULTIPLEX_MAX_JOBS
 	HashTable <int, ExtArray<PROC_ID> *> *spoolJobFileWorkers;
 	int				numMatches;
 	int				numShadows;
@@ -1074,6 +1165,25 @@ private:
 	std::unordered_set<std::string> FlockPools; // Names of all "default" flocked collectors.
 	std::unordered_map<std::string, std::unique_ptr<DCCollector>> FlockExtra; // User-provided flock targets.
 
+		// job counts kept up to date as jobs change, see count_jobs()
+	QueuedJobCounters m_queuedCounts;
+	std::map<int, int> m_queuedDedicatedClusters; // cluster id -> number of idle jobs
+	std::set<JOB_ID_KEY> m_jobCountsDirty; // jobs (and clusters) to count again
+	bool			m_countAllJobs;        // the next count_jobs() must walk the whole queue
+	unsigned int	m_jobCountsGeneration; // bumped each time the whole queue is counted from scratch
+	time_t			m_lastCountAllJobs;
+	int				m_countAllJobsInterval; // SCHEDD_JOB_COUNTS_RECOUNT_INTERVAL
+	bool			m_checkJobCounts;       // SCHEDD_ASSERT_JOB_COUNTS
+
+		// incremental evaluation of the periodic policy expressions, see PeriodicExprHandler()
+	bool			m_periodicExprIncremental; // PERIODIC_EXPR_INCREMENTAL
+	bool			m_periodicExprWalkAll;     // the next PeriodicExprHandler() must walk the whole queue
+	classad::References m_periodicExprRefs;    // attributes that some job's periodic policy depends upon
+	std::set<JOB_ID_KEY> m_periodicExprDirty;  // jobs (and clusters) whose policy inputs changed
+	std::priority_queue<std::pair<time_t, JOB_ID_KEY>,
+		std::vector<std::pair<time_t, JOB_ID_KEY> >,
+		std::greater<std::pair<time_t, JOB_ID_KEY> > > m_periodicExprDeadlines;
+
 	PoolSubmitterMap		SubmitterMap;  // Map between remote pools and advertised submitters
 
 	int				MinFlockLevel;
@@ -59,8 +59,11 @@ BaseShadow::BaseShadow() {
 	core_file_name = NULL;
 	scheddAddr = NULL;
 	job_updater = NULL;
-	ASSERT( !myshadow_ptr );	// make cetain we're only instantiated once
+		// make certain we're only instantiated once, unless this
+		// process hosts many jobs
+	ASSERT( !myshadow_ptr || multiplexShadow );
 	myshadow_ptr = this;
+	m_exit_reported = false;
 	exception_already_logged = false;
 	began_execution = FALSE;
 	reconnect_e_factor = 0.0;
@@ -79,7 +82,9 @@ BaseShadow::BaseShadow() {
 }
 
 BaseShadow::~BaseShadow() {
-	myshadow_ptr = NULL;
+	if( myshadow_ptr == this ) {
+		myshadow_ptr = NULL;
+	}
 	if (jobAd) FreeJobAd(jobAd);
 	if (gjid) free(gjid); 
 	if (scheddAddr) free(scheddAddr);
@@ -222,6 +227,10 @@ BaseShadow::baseInit( ClassAd *job_ad, const char* schedd_addr, const char *xfer
 
 		// change directory; hold on failure
 	if ( cdToIwd() == -1 ) {
+		if( m_exit_reported ) {
+				// multiplexed: the job is held and only it is gone
+			return;
+		}
 		EXCEPT("Could not cd to initial working directory");
 	}
 
@@ -233,8 +242,9 @@ BaseShadow::baseInit( ClassAd *job_ad, const char* schedd_addr, const char *xfer
 		if (pending == TRUE) {
 			// If the classad of this job "thinks" that this job should be
 			// finished already, let's enact that belief.
-			// This function does not return.
+			// This function does not return (unless multiplexed).
 			this->terminateJob(US_TERMINATE_PENDING);
+			return;
 		}
 	}
 
@@ -332,6 +342,57 @@ int BaseShadow::cdToIwd() {
 }
 
 
+void
+BaseShadow::makeCurrent( void )
+{
+	Shadow = this;
+	myshadow_ptr = this;
+
+#if ! defined(WIN32)
+	priv_state p = PRIV_UNKNOWN;
+	if( m_RunAsNobody ) {
+		p = set_root_priv();
+	}
+#endif
+
+	if( chdir(iwd.c_str()) < 0 ) {
+		dprintf( D_ALWAYS, "Failed to change to initial working "
+				 "directory %s: %s\n", iwd.c_str(), strerror(errno) );
+	}
+
+#if ! defined(WIN32)
+	if( m_RunAsNobody ) {
+		set_priv(p);
+	}
+#endif
+}
+
+
+bool
+BaseShadow::ownsService( Service *s ) const
+{
+	return s == this || s == job_updater;
+}
+
+
+void
+BaseShadow::DC_Exit( int reason )
+{
+	if( ! multiplexShadow ) {
+			// does not return
+		::DC_Exit( reason );
+	}
+
+		// Other jobs live in this process, so only this job leaves.
+		// Callers may still be on the stack, so main deletes us later.
+	if( m_exit_reported ) {
+		return;
+	}
+	m_exit_reported = true;
+	multiplexedShadowExit( this, reason );
+}
+
+
 void
 BaseShadow::shutDownFast( int reason ) {
 	m_force_fast_starter_shutdown = true;
@@ -344,6 +405,7 @@ BaseShadow::shutDown( int reason )
 		// exit now if there is no job ad
 	if ( !getJobAd() ) {
 		DC_Exit( reason );
+		return;
 	}
 	
 		// if we are being called from the exception handler, return
@@ -420,6 +482,7 @@ BaseShadow::holdJob( const char* reason, int hold_reason_code, int hold_reason_s
 	if( ! jobAd ) {
 		dprintf( D_ALWAYS, "In HoldJob() w/ NULL JobAd!\n" );
 		DC_Exit( JOB_SHOULD_HOLD );
+		return;
 	}
 
 		// cleanup this shadow (kill starters, etc)
@@ -479,6 +542,7 @@ BaseShadow::mockTerminateJob( std::string exit_reason,
 		dprintf(D_ALWAYS, "BaseShadow::mockTerminateJob(): NULL JobAd! "
 			"Holding Job!");
 		DC_Exit( JOB_SHOULD_HOLD );
+		return;
 	}
 
 	// Insert the various exit attributes into our job ad.
@@ -544,6 +608,7 @@ BaseShadow::retryJobCleanup( void )
 		        "; Forcing job requeue!\n",
 		        m_max_cleanup_retries);
 		DC_Exit(JOB_SHOULD_REQUEUE);
+		return;
 	}
 	ASSERT(m_cleanup_retry_tid == -1);
 	m_cleanup_retry_tid = daemonCore->Register_Timer(m_cleanup_retry_delay, 0,
@@ -625,6 +690,7 @@ BaseShadow::terminateJob( update_style_t kind ) // has a default argument of US_
 		emailTerminateEvent( reason, kind );
 
 		DC_Exit( reason );
+		return;
 	}
 
 	// the default path when kind == US_NORMAL
@@ -718,7 +784,7 @@ BaseShadow::terminateJob( update_style_t kind ) // has a default argument of US_
 		return;
 	}
 
-	// does not return.
+	// does not return, unless this shadow is multiplexed.
 	DC_Exit( reason );
 }
 
@@ -746,6 +812,7 @@ BaseShadow::evictJob( int reason )
 	if( ! jobAd ) {
 		dprintf( D_ALWAYS, "In evictJob() w/ NULL JobAd!\n" );
 		DC_Exit( reason );
+		return;
 	}
 
 		// cleanup this shadow (kill starters, etc)
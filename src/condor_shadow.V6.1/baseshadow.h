@@ -114,7 +114,6 @@ class BaseShadow : public Service
 			about it, and exit with a special status. 
 			@param reason Why we gave up (for UserLog, dprintf, etc)
 		*/
-	PREFAST_NORETURN
 	void reconnectFailed( const char* reason ); 
 
 	virtual bool shouldAttemptReconnect(RemoteResource *) { return true;};
@@ -127,6 +126,28 @@ class BaseShadow : public Service
 			@param reason The reason the job exited (JOB_BLAH_BLAH)
 		 */
 	virtual void shutDown( int reason );
+
+		/** Leave with the given exit reason.  Normally this exits the
+			process and does not return.  In a multiplexed shadow, the
+			reason is reported to the schedd for this job alone, this
+			object is deleted once we are back in the event loop, and
+			the call returns.
+			@param reason The reason the job exited (JOB_BLAH_BLAH)
+		 */
+	void DC_Exit( int reason );
+
+		/** In a multiplexed shadow, make this the job that the
+			process-wide state (the Shadow pointer, the dprintf
+			header and the current directory) refers to.
+		 */
+	void makeCurrent( void );
+
+		/** Whether a DaemonCore handler with the given Service object
+			acts for this job (used to pick the current job in a
+			multiplexed shadow).
+			@param s The Service object of the handler
+		 */
+	virtual bool ownsService( Service *s ) const;
 		/** Forces the starter to shutdown fast as well.<p>
 			@param reason The reason the job exited (JOB_BLAH_BLAH)
 		 */
@@ -470,6 +491,9 @@ class BaseShadow : public Service
 		*/
 	void checkSwap( void );
 
+		/// True once DC_Exit() has handed off our exit reason.
+	bool m_exit_reported;
+
 	// config file parameters
 	int reconnect_ceiling;
 	double reconnect_e_factor;
@@ -517,6 +541,13 @@ extern void dumpClassad( const char*, ClassAd*, int );
 // Returns false if no new job found.
 extern bool recycleShadow(int previous_job_exit_reason);
 
+// Report the exit reason of one job hosted by a multiplexed shadow
+// and schedule that job's shadow object for deletion.
+extern void multiplexedShadowExit(BaseShadow *shadow, int exit_reason);
+
+// True if this process hosts many jobs (--multiplex).
+extern bool multiplexShadow;
+
 // fix the update ad from the starter to work around starter bugs.
 extern void fix_update_ad(ClassAd & update_ad);
 
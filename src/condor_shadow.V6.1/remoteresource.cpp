@@ -800,6 +800,9 @@ RemoteResource::handleSysCalls( Stream * /* sock */ )
 
 	syscall_sock = claim_sock;
 	thisRemoteResource = this;
+	if( multiplexShadow ) {
+		shadow->makeCurrent();
+	}
 
 	if (do_REMOTE_syscall() < 0) {
 		shadow->dprintf(D_SYSCALLS,"Shadow: do_REMOTE_syscall returned < 0\n");
@@ -2161,6 +2164,7 @@ RemoteResource::reconnect( void )
 		formatstr( reason, "Job disconnected too long: %s (%d seconds) expired",
 		           ATTR_JOB_LEASE_DURATION, lease_duration );
 		shadow->reconnectFailed( reason.Value() );
+		return;
 	}
 	dprintf( D_ALWAYS, "%s remaining: %d\n", ATTR_JOB_LEASE_DURATION,
 			 remaining );
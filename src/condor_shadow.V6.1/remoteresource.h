@@ -267,6 +267,12 @@ class RemoteResource : public Service {
 
 	void initFileTransfer();
 
+		/// Whether a DaemonCore handler's Service object belongs to us
+		/// (ourself or our file transfer object).
+	bool ownsService( Service *s ) const {
+		return s == this || s == &filetrans;
+	}
+
 	virtual void resourceExit( int reason_for_exit, int exit_status );
 	virtual void updateFromStarter( ClassAd* update_ad );
 	virtual void incrementJobCompletionCount();
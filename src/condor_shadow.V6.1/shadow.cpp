@@ -29,7 +29,7 @@
 
 extern "C" char* d_format_time(double);
 
-UniShadow::UniShadow() : delayedExitReason( -1 ) {
+UniShadow::UniShadow() : delayedExitReason( -1 ), exitLeaseTid( -1 ) {
 		// pass RemoteResource ourself, so it knows where to go if
 		// it has to call something like shutDown().
 	remRes = new RemoteResource( this );
@@ -37,8 +37,11 @@ UniShadow::UniShadow() : delayedExitReason( -1 ) {
 
 UniShadow::~UniShadow() {
 	if ( remRes ) delete remRes;
-	daemonCore->Cancel_Command( SHADOW_UPDATEINFO );
-	daemonCore->Cancel_Command( CREDD_GET_CRED );
+	if ( exitLeaseTid != -1 ) daemonCore->Cancel_Timer( exitLeaseTid );
+	if ( ! multiplexShadow ) {
+		daemonCore->Cancel_Command( SHADOW_UPDATEINFO );
+		daemonCore->Cancel_Command( CREDD_GET_CRED );
+	}
 }
 
 
@@ -121,6 +124,13 @@ UniShadow::init( ClassAd* job_ad, const char* schedd_addr, const char *xfer_queu
 	
 		// In this case we just pass the pointer along...
 	remRes->setJobAd( jobAd );
+
+		// A multiplexed shadow registers CREDD_GET_CRED once for all
+		// of its jobs, and does not talk to starters old enough to
+		// need SHADOW_UPDATEINFO.
+	if( multiplexShadow ) {
+		return;
+	}
 	
 		// Register command which gets updates from the starter
 		// on the job's image size, cpu usage, etc.  Each kind of
@@ -579,7 +589,10 @@ UniShadow::exitAfterEvictingJob( int reason ) {
 	} else {
 		this->delayedExitReason = reason;
 		remRes->setExitReason( reason );
-		daemonCore->Register_Timer( 20, 0,
+		if( exitLeaseTid != -1 ) {
+			daemonCore->Cancel_Timer( exitLeaseTid );
+		}
+		exitLeaseTid = daemonCore->Register_Timer( 20, 0,
 				(TimerHandlercpp)&UniShadow::exitLeaseHandler,
 				"exit lease handler", this );
 	}
@@ -594,8 +607,15 @@ UniShadow::exitDelayed( int &reason ) {
 	return false;
 }
 
+bool
+UniShadow::ownsService( Service *s ) const {
+	return BaseShadow::ownsService( s ) ||
+		( remRes && remRes->ownsService( s ) );
+}
+
 void
-UniShadow::exitLeaseHandler() const {
+UniShadow::exitLeaseHandler() {
+	exitLeaseTid = -1;
 	DC_Exit( delayedExitReason );
 }
 
@@ -175,9 +175,10 @@ class UniShadow : public BaseShadow
 	virtual int JobResume(int sig);
 
 	virtual void exitAfterEvictingJob( int reason );
+	virtual bool ownsService( Service *s ) const;
 	virtual bool exitDelayed( int &reason );
 
-	void exitLeaseHandler( void ) const;
+	void exitLeaseHandler( void );
 
  protected:
 
@@ -188,6 +189,7 @@ class UniShadow : public BaseShadow
  private:
 	RemoteResource *remRes;
 	int delayedExitReason;
+	int exitLeaseTid;
 
 	void requestJobRemoval();
 };
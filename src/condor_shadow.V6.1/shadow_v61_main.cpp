@@ -31,6 +31,9 @@
 #include "dc_schedd.h"
 #include "spool_version.h"
 #include "file_transfer.h"
+#include "store_cred.h"
+#include <map>
+#include <vector>
 
 BaseShadow *Shadow = NULL;
 
@@ -45,6 +48,18 @@ static const char * xfer_queue_contact_info = NULL;
 bool sendUpdatesToSchedd = true;
 static time_t shadow_worklife_expires = 0;
 
+	// With --multiplex, this process hosts one shadow object per job
+	// on a single DaemonCore loop, and the schedd hands it more jobs
+	// with SHADOW_MUX_START_JOB.  The Shadow global then names the
+	// job currently being serviced.
+bool multiplexShadow = false;
+static std::map<PROC_ID, BaseShadow*> multiplexedShadows;
+static std::vector<BaseShadow*> exitedShadows;
+static int reap_shadows_tid = -1;
+static int idle_check_tid = -1;
+static bool multiplex_shutting_down = false;
+static int last_exit_reason = JOB_EXITED;
+
 static void
 usage( int argc, char* argv[] )
 {
@@ -61,6 +76,30 @@ extern "C" {
 int
 ExceptCleanup(int, int, const char *buf)
 {
+  if( multiplexShadow ) {
+		// Only the job being serviced failed.  Tell the schedd which
+		// one before we exit, so it reconnects the others to their
+		// starters instead of failing them too.
+	std::map<PROC_ID, BaseShadow*>::iterator it;
+	for( it = multiplexedShadows.begin(); it != multiplexedShadows.end(); ++it ) {
+		if( it->second == Shadow ) {
+			BaseShadow::myshadow_ptr = it->second;
+			BaseShadow::log_except(buf);
+			if( sendUpdatesToSchedd && schedd_addr ) {
+				classy_counted_ptr<DCSchedd> schedd = new DCSchedd( schedd_addr );
+				classy_counted_ptr<MultiplexedShadowJobExitMsg> msg =
+					new MultiplexedShadowJobExitMsg( it->first.cluster,
+						it->first.proc, JOB_EXCEPTION );
+				msg->setStreamType( Stream::reli_sock );
+				msg->setTimeout( 20 );
+				msg->setDeadlineTimeout( 20 );
+				schedd->sendBlockingMsg( msg.get() );
+			}
+			break;
+		}
+	}
+	return 0;
+  }
   BaseShadow::log_except(buf);
   return 0;
 }
@@ -133,6 +172,11 @@ parseArgs( int argc, char *argv[] )
 			continue;
 		}
 
+		if (strcmp(opt, "--multiplex") == 0) {
+			multiplexShadow = true;
+			continue;
+		}
+
 			// the only other argument we understand is the
 			// filename we should read our ClassAd from, "-" for
 			// STDIN.  There's no further checking we need to do 
@@ -260,10 +304,34 @@ initShadow( ClassAd* ad )
 				 CondorUniverseName(universe) );
 		EXCEPT( "Universe not supported" );
 	}
+	if( multiplexShadow ) {
+		PROC_ID job_id;
+		job_id.cluster = cluster;
+		job_id.proc = proc;
+		multiplexedShadows[job_id] = Shadow;
+	}
 	Shadow->init( ad, schedd_addr, xfer_queue_contact_info );
 }
 
 
+	// In a multiplexed shadow, a job that has already left (e.g. it
+	// went on hold during init) must not be started.
+static bool
+shadowHasExited( BaseShadow *shadow )
+{
+	if( ! multiplexShadow ) {
+		return false;
+	}
+	std::map<PROC_ID, BaseShadow*>::iterator it;
+	for( it = multiplexedShadows.begin(); it != multiplexedShadows.end(); ++it ) {
+		if( it->second == shadow ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
 void startShadow( ClassAd *ad )
 {
 		// see if the SchedD punched a DAEMON-level authorization
@@ -282,6 +350,9 @@ void startShadow( ClassAd *ad )
 	}
 
 	initShadow( ad );
+	if( shadowHasExited(Shadow) ) {
+		return;
+	}
 
 	bool wantClaiming = false;
 	ad->LookupBool(ATTR_CLAIM_STARTD, wantClaiming);
@@ -300,6 +371,9 @@ void startShadow( ClassAd *ad )
 			Shadow->logDataflowJobSkippedEvent(); // Must get called before Shadow->shutDown
 			dprintf(D_ALWAYS, "Job %d.%d is a dataflow job, skipping\n", cluster, proc);
 			Shadow->shutDown( JOB_EXITED );
+			if( shadowHasExited(Shadow) ) {
+				return;
+			}
 		}
 		else {
 			Shadow->updateJobAttr(ATTR_DATAFLOW_JOB_SKIPPED, "false");
@@ -332,35 +406,452 @@ int handleJobRemoval(Service*,int sig)
 }
 
 
+static void reapExitedShadows();
+static void checkMultiplexedShadowIdle();
+
+	// Called by DaemonCore before each C++ timer, socket, pipe, reaper
+	// or command handler in a multiplexed shadow, so that the job the
+	// handler's object belongs to (the shadow itself, its remote
+	// resource, file transfer object or job updater) is the current
+	// one while the handler runs.
+static void
+multiplexedServiceContext( Service *s )
+{
+	if( Shadow && Shadow->ownsService( s ) ) {
+		return;
+	}
+	std::map<PROC_ID, BaseShadow*>::iterator it;
+	for( it = multiplexedShadows.begin(); it != multiplexedShadows.end(); ++it ) {
+		if( it->second->ownsService( s ) ) {
+			it->second->makeCurrent();
+			return;
+		}
+	}
+}
+
+	// A job hosted by a multiplexed shadow was killed by the schedd:
+	// drop it without reporting anything, as if its process had died.
+static void
+dropMultiplexedShadow( BaseShadow *shadow )
+{
+	std::map<PROC_ID, BaseShadow*>::iterator it;
+	for( it = multiplexedShadows.begin(); it != multiplexedShadows.end(); ++it ) {
+		if( it->second == shadow ) {
+			multiplexedShadows.erase( it );
+			break;
+		}
+	}
+	exitedShadows.push_back( shadow );
+	if( reap_shadows_tid == -1 ) {
+		reap_shadows_tid = daemonCore->Register_Timer( 0,
+			reapExitedShadows, "reapExitedShadows" );
+	}
+}
+
+
+static int
+signalShadow( BaseShadow *shadow, int sig )
+{
+	int iRet = 0;
+
+	if( multiplexShadow ) {
+		shadow->makeCurrent();
+	}
+
+	switch (sig)
+	{
+		case SIGUSR1: // remove the job
+			iRet =  shadow->handleJobRemoval(sig);
+			break;
+		case DC_SIGSUSPEND: // send down a signal to suspend the job
+			dprintf( D_ALWAYS, "***SUSPEND THE JOB\n");
+			iRet =  shadow->JobSuspend(sig);
+			break;
+		case DC_SIGCONTINUE: // send down a signal to continue the job
+			dprintf( D_ALWAYS, "***CONTINUE THE JOB\n");
+			iRet =  shadow->JobResume(sig);
+			break;
+		case UPDATE_JOBAD:
+			iRet =  shadow->handleUpdateJobAd(sig);
+			break;
+			// The rest stand in for process signals, and only arrive
+			// for one job of a multiplexed shadow.
+		case SIGTERM:
+			shadow->gracefulShutDown();
+			break;
+		case SIGQUIT:
+			shadow->shutDownFast( JOB_NOT_CKPTED );
+			break;
+		case SIGKILL:
+			dropMultiplexedShadow( shadow );
+			break;
+		default: 
+			break;
+	}
+	return iRet;
+}
+
+
 int handleSignals(int sig)
 {
 	int iRet =0;
-	if( Shadow ) 
+	if( multiplexShadow ) {
+			// signals sent to the process are meant for every job;
+			// the handlers may remove jobs from the map, so walk a copy
+		std::map<PROC_ID, BaseShadow*> shadows = multiplexedShadows;
+		std::map<PROC_ID, BaseShadow*>::iterator it;
+		for( it = shadows.begin(); it != shadows.end(); ++it ) {
+			iRet = signalShadow( it->second, sig );
+		}
+	}
+	else if( Shadow ) 
 	{
-		
-		switch (sig)
+		iRet = signalShadow( Shadow, sig );
+	}
+	return iRet;
+}
+
+
+	// The schedd hands a multiplexed shadow another job.  We reply
+	// whether we took it so the schedd can fall back to spawning a
+	// new shadow.
+int
+handleMultiplexedStartJob( int, Stream *stream )
+{
+	int reconnect = 0;
+	ClassAd *ad = new ClassAd;
+
+	stream->decode();
+	if( !stream->get( reconnect ) ||
+		!getClassAd( stream, *ad ) ||
+		!stream->end_of_message() )
+	{
+		dprintf( D_ALWAYS, "Failed to receive job for multiplexed shadow\n" );
+		delete ad;
+		return FALSE;
+	}
+
+	int universe = CONDOR_UNIVERSE_VANILLA;
+	bool wantPS = false;
+	ad->LookupInteger( ATTR_JOB_UNIVERSE, universe );
+	ad->LookupBool( ATTR_WANT_PARALLEL_SCHEDULING, wantPS );
+
+	int accept = 1;
+	if( multiplex_shutting_down ||
+		( shadow_worklife_expires && time(NULL) > shadow_worklife_expires ) ||
+		wantPS ||
+		( universe != CONDOR_UNIVERSE_VANILLA &&
+		  universe != CONDOR_UNIVERSE_JAVA &&
+		  universe != CONDOR_UNIVERSE_VM ) )
+	{
+		accept = 0;
+	}
+
+	stream->encode();
+	if( !stream->put( accept ) ||
+		!stream->end_of_message() )
+	{
+		dprintf( D_ALWAYS, "Failed to reply to SHADOW_MUX_START_JOB\n" );
+		accept = 0;
+	}
+	if( ! accept ) {
+		delete ad;
+		return TRUE;
+	}
+
+	ad->LookupInteger( ATTR_CLUSTER_ID, cluster );
+	ad->LookupInteger( ATTR_PROC_ID, proc );
+	dprintf( D_ALWAYS, "Multiplexed shadow taking job %d.%d (%d jobs hosted)\n",
+			 cluster, proc, (int)multiplexedShadows.size() + 1 );
+
+	is_reconnect = reconnect != 0;
+	startShadow( ad );
+	return TRUE;
+}
+
+
+int
+handleMultiplexedSignalJob( int, Stream *stream )
+{
+	PROC_ID job_id;
+	int sig = 0;
+
+	stream->decode();
+	if( !stream->get( job_id.cluster ) ||
+		!stream->get( job_id.proc ) ||
+		!stream->get( sig ) ||
+		!stream->end_of_message() )
+	{
+		dprintf( D_ALWAYS, "Failed to receive SHADOW_MUX_SIGNAL_JOB\n" );
+		return FALSE;
+	}
+
+	std::map<PROC_ID, BaseShadow*>::iterator it = multiplexedShadows.find( job_id );
+	if( it == multiplexedShadows.end() ) {
+		dprintf( D_FULLDEBUG, "Ignoring signal %d for job %d.%d, which "
+				 "this shadow is not hosting\n",
+				 sig, job_id.cluster, job_id.proc );
+		return TRUE;
+	}
+	signalShadow( it->second, sig );
+	return TRUE;
+}
+
+
+	// Reports the exits of a multiplexed shadow's jobs to the schedd
+	// without blocking the event loop, so the other jobs keep being
+	// serviced.  A failed report is retried with a growing delay.  If
+	// we give up on one, only that job is lost: we take no new jobs and
+	// exit with JOB_EXCEPTION once the rest are done, and the schedd's
+	// reaper then tries to reconnect the jobs it still thinks we host,
+	// which are just the unreported ones, and requeues them when that
+	// fails.
+class MultiplexedExitReporter : public Service {
+public:
+	MultiplexedExitReporter() : m_retry_tid(-1), m_failed(0) {}
+
+	void report( PROC_ID job_id, int exit_reason );
+	bool busy() const { return ! m_reports.empty(); }
+	int failed() const { return m_failed; }
+
+private:
+	static const int REPORT_TIMEOUT = 30;
+	static const int MAX_TRIES = 6;
+	static const int RETRY_DELAY = 5;
+	static const int MAX_RETRY_DELAY = 120;
+
+	struct Report {
+		int exit_reason;
+		int tries;
+		time_t retry_time; // 0 while a report is in flight
+	};
+
+	void send( PROC_ID job_id );
+	void reportDone( DCMsgCallback *cb );
+	void retry();
+	void scheduleRetry();
+
+	std::map<PROC_ID, Report> m_reports;
+	int m_retry_tid;
+	int m_failed;
+};
+
+static MultiplexedExitReporter exitReporter;
+
+void
+MultiplexedExitReporter::report( PROC_ID job_id, int exit_reason )
+{
+	Report &r = m_reports[job_id];
+	r.exit_reason = exit_reason;
+	r.tries = 0;
+	send( job_id );
+}
+
+void
+MultiplexedExitReporter::send( PROC_ID job_id )
+{
+	ASSERT( schedd_addr );
+
+	Report &r = m_reports[job_id];
+	r.tries++;
+	r.retry_time = 0;
+
+	classy_counted_ptr<DCSchedd> schedd = new DCSchedd( schedd_addr );
+	classy_counted_ptr<MultiplexedShadowJobExitMsg> msg =
+		new MultiplexedShadowJobExitMsg( job_id.cluster, job_id.proc,
+										 r.exit_reason );
+	msg->setStreamType( Stream::reli_sock );
+	msg->setTimeout( REPORT_TIMEOUT );
+	msg->setDeadlineTimeout( REPORT_TIMEOUT );
+	classy_counted_ptr<DCMsgCallback> cb = new DCMsgCallback(
+		(DCMsgCallback::CppFunction)&MultiplexedExitReporter::reportDone,
+		this );
+	msg->setCallback( cb );
+	schedd->sendMsg( msg.get() );
+}
+
+void
+MultiplexedExitReporter::reportDone( DCMsgCallback *cb )
+{
+	MultiplexedShadowJobExitMsg *msg =
+		static_cast<MultiplexedShadowJobExitMsg *>( cb->getMessage() );
+	PROC_ID job_id;
+	job_id.cluster = msg->cluster();
+	job_id.proc = msg->proc();
+
+	std::map<PROC_ID, Report>::iterator it = m_reports.find( job_id );
+	if( it == m_reports.end() ) {
+		return;
+	}
+
+	if( msg->deliveryStatus() == DCMsg::DELIVERY_SUCCEEDED ) {
+		if( ! msg->knownJob() ) {
+			dprintf( D_FULLDEBUG, "Schedd no longer knows job %d.%d\n",
+					 job_id.cluster, job_id.proc );
+		}
+		m_reports.erase( it );
+	}
+	else if( it->second.tries >= MAX_TRIES ) {
+		dprintf( D_ALWAYS, "Giving up on reporting exit of job %d.%d "
+				 "after %d tries: %s\n", job_id.cluster, job_id.proc,
+				 it->second.tries, msg->getErrorStackText().c_str() );
+		m_reports.erase( it );
+		m_failed++;
+		multiplex_shutting_down = true;
+	}
+	else {
+		int delay = RETRY_DELAY << ( it->second.tries - 1 );
+		if( delay > MAX_RETRY_DELAY ) {
+			delay = MAX_RETRY_DELAY;
+		}
+		dprintf( D_ALWAYS, "Failed to report exit of job %d.%d: %s; "
+				 "retrying in %d seconds\n", job_id.cluster, job_id.proc,
+				 msg->getErrorStackText().c_str(), delay );
+		it->second.retry_time = time(NULL) + delay;
+		scheduleRetry();
+	}
+
+	checkMultiplexedShadowIdle();
+}
+
+void
+MultiplexedExitReporter::retry()
+{
+	m_retry_tid = -1;
+
+	time_t now = time(NULL);
+	std::vector<PROC_ID> due;
+	std::map<PROC_ID, Report>::iterator it;
+	for( it = m_reports.begin(); it != m_reports.end(); ++it ) {
+		if( it->second.retry_time && it->second.retry_time <= now ) {
+			due.push_back( it->first );
+		}
+	}
+	for( size_t i = 0; i < due.size(); i++ ) {
+		send( due[i] );
+	}
+
+	scheduleRetry();
+}
+
+void
+MultiplexedExitReporter::scheduleRetry()
+{
+	time_t next = 0;
+	std::map<PROC_ID, Report>::iterator it;
+	for( it = m_reports.begin(); it != m_reports.end(); ++it ) {
+		if( it->second.retry_time &&
+			( ! next || it->second.retry_time < next ) )
 		{
-			case SIGUSR1: // remove the job
-				iRet =  Shadow->handleJobRemoval(sig);
-				break;
-			case DC_SIGSUSPEND: // send down a signal to suspend the job
-				dprintf( D_ALWAYS, "***SUSPEND THE JOB\n");
-				iRet =  Shadow->JobSuspend(sig);
-				break;
-			case DC_SIGCONTINUE: // send down a signal to continue the job
-				dprintf( D_ALWAYS, "***CONTINUE THE JOB\n");
-				iRet =  Shadow->JobResume(sig);
-				break;
-			case UPDATE_JOBAD:
-				iRet =  Shadow->handleUpdateJobAd(sig);
-				break;
-			default: 
-				break;
-				
+			next = it->second.retry_time;
 		}
-		
 	}
-	return iRet;
+
+	if( m_retry_tid != -1 ) {
+		daemonCore->Cancel_Timer( m_retry_tid );
+		m_retry_tid = -1;
+	}
+	if( next ) {
+		time_t now = time(NULL);
+		m_retry_tid = daemonCore->Register_Timer(
+			next > now ? (unsigned)(next - now) : 0,
+			(TimerHandlercpp)&MultiplexedExitReporter::retry,
+			"MultiplexedExitReporter::retry", this );
+	}
+}
+
+
+void
+multiplexedShadowExit( BaseShadow *shadow, int exit_reason )
+{
+	PROC_ID job_id;
+	bool found = false;
+	std::map<PROC_ID, BaseShadow*>::iterator it;
+	for( it = multiplexedShadows.begin(); it != multiplexedShadows.end(); ++it ) {
+		if( it->second == shadow ) {
+			job_id = it->first;
+			multiplexedShadows.erase( it );
+			found = true;
+			break;
+		}
+	}
+	if( ! found ) {
+			// already dropped
+		return;
+	}
+
+	dprintf( D_ALWAYS, "Job %d.%d leaving multiplexed shadow with exit "
+			 "reason %d (%d jobs still hosted)\n", job_id.cluster,
+			 job_id.proc, exit_reason, (int)multiplexedShadows.size() );
+	last_exit_reason = exit_reason;
+
+	if( sendUpdatesToSchedd ) {
+		exitReporter.report( job_id, exit_reason );
+	}
+
+	exitedShadows.push_back( shadow );
+	if( reap_shadows_tid == -1 ) {
+		reap_shadows_tid = daemonCore->Register_Timer( 0,
+			reapExitedShadows, "reapExitedShadows" );
+	}
+}
+
+
+static void
+reapExitedShadows()
+{
+	reap_shadows_tid = -1;
+
+	std::vector<BaseShadow*> shadows;
+	shadows.swap( exitedShadows );
+	for( size_t i = 0; i < shadows.size(); i++ ) {
+		if( Shadow == shadows[i] ) {
+			Shadow = NULL;
+		}
+		delete shadows[i];
+	}
+
+	checkMultiplexedShadowIdle();
+}
+
+
+static void
+checkMultiplexedShadowIdleTimer()
+{
+	idle_check_tid = -1;
+	checkMultiplexedShadowIdle();
+}
+
+
+	// An empty multiplexed shadow stays around for more jobs until its
+	// worklife runs out or we are asked to shut down, but never exits
+	// before the schedd has heard about every job that left.
+static void
+checkMultiplexedShadowIdle()
+{
+	if( ! multiplexedShadows.empty() || ! exitedShadows.empty() ||
+		exitReporter.busy() )
+	{
+		return;
+	}
+
+	time_t now = time(NULL);
+	if( multiplex_shutting_down || ! sendUpdatesToSchedd ||
+		( shadow_worklife_expires && now > shadow_worklife_expires ) )
+	{
+		dprintf( D_ALWAYS, "Multiplexed shadow has no more jobs; exiting.\n" );
+		if( exitReporter.failed() ) {
+				// requeue the jobs whose exits we could not report
+			::DC_Exit( JOB_EXCEPTION );
+		}
+		::DC_Exit( sendUpdatesToSchedd ? JOB_EXITED : last_exit_reason );
+	}
+
+	if( shadow_worklife_expires && idle_check_tid == -1 ) {
+		idle_check_tid = daemonCore->Register_Timer(
+			(int)(shadow_worklife_expires - now) + 1,
+			checkMultiplexedShadowIdleTimer, "checkMultiplexedShadowIdle" );
+	}
 }
 
 
@@ -409,6 +900,22 @@ main_init(int argc, char *argv[])
 
 	parseArgs( argc, argv );
 
+	if( multiplexShadow ) {
+		daemonCore->Set_Service_Context_Hook( multiplexedServiceContext );
+		daemonCore->Register_Command( SHADOW_MUX_START_JOB,
+			"SHADOW_MUX_START_JOB", &handleMultiplexedStartJob,
+			"handleMultiplexedStartJob", DAEMON );
+		daemonCore->Register_Command( SHADOW_MUX_SIGNAL_JOB,
+			"SHADOW_MUX_SIGNAL_JOB", &handleMultiplexedSignalJob,
+			"handleMultiplexedSignalJob", DAEMON );
+			// Register command which the starter uses to fetch a
+			// user's Kerberos/AFS auth credential.  A single shadow
+			// registers this in UniShadow::init().
+		daemonCore->Register_Command( CREDD_GET_CRED, "CREDD_GET_CRED",
+			&cred_get_cred_handler, "cred_get_cred_handler", DAEMON,
+			D_COMMAND, true /*force authentication*/ );
+	}
+
 	CheckSpoolVersion(SPOOL_MIN_VERSION_SHADOW_SUPPORTS,SPOOL_CUR_VERSION_SHADOW_SUPPORTS);
 
 	ClassAd* ad = readJobAd();
@@ -422,6 +929,14 @@ main_init(int argc, char *argv[])
 void
 main_config()
 {
+	if( multiplexShadow ) {
+		std::map<PROC_ID, BaseShadow*>::iterator it;
+		for( it = multiplexedShadows.begin(); it != multiplexedShadows.end(); ++it ) {
+			it->second->makeCurrent();
+			it->second->config();
+		}
+		return;
+	}
 	Shadow->config();
 }
 
@@ -429,12 +944,34 @@ main_config()
 void
 main_shutdown_fast()
 {
+	if( multiplexShadow ) {
+		multiplex_shutting_down = true;
+		std::map<PROC_ID, BaseShadow*> shadows = multiplexedShadows;
+		std::map<PROC_ID, BaseShadow*>::iterator it;
+		for( it = shadows.begin(); it != shadows.end(); ++it ) {
+			it->second->makeCurrent();
+			it->second->shutDownFast( JOB_NOT_CKPTED );
+		}
+		checkMultiplexedShadowIdle();
+		return;
+	}
 	Shadow->shutDownFast( JOB_NOT_CKPTED );
 }
 
 void
 main_shutdown_graceful()
 {
+	if( multiplexShadow ) {
+		multiplex_shutting_down = true;
+		std::map<PROC_ID, BaseShadow*> shadows = multiplexedShadows;
+		std::map<PROC_ID, BaseShadow*>::iterator it;
+		for( it = shadows.begin(); it != shadows.end(); ++it ) {
+			it->second->makeCurrent();
+			it->second->gracefulShutDown();
+		}
+		checkMultiplexedShadowIdle();
+		return;
+	}
 	Shadow->gracefulShutDown();
 }
 
@@ -470,6 +1007,7 @@ printClassAd( void )
 	printf( "%s = True\n", ATTR_HAS_RECONNECT );
 	printf( "%s = True\n", ATTR_HAS_JOB_AD_FROM_FILE );
 	printf( "%s = True\n", ATTR_HAS_VM );
+	printf( "%s = True\n", ATTR_HAS_SHADOW_MULTIPLEX );
 	printf( "%s = \"%s\"\n", ATTR_VERSION, CondorVersion() );
 }
 
@@ -497,6 +1035,11 @@ recycleShadow(int previous_job_exit_reason)
 	if( previous_job_exit_reason != JOB_EXITED ) {
 		return false;
 	}
+	if( multiplexShadow ) {
+			// other jobs share this process; the schedd gives us new
+			// jobs with SHADOW_MUX_START_JOB instead
+		return false;
+	}
 	if( shadow_worklife_expires && time(NULL) > shadow_worklife_expires ) {
 		return false;
 	}
@@ -311,6 +311,12 @@ Resource::Resource( CpuAttributes* cap, int rid, bool multiple_slots, Resource*
 
 	update_tid = -1;
 
+	r_update_base_public = NULL;
+	r_update_base_private = NULL;
+	r_update_base_seq = -1;
+	r_update_base_time = 0;
+	r_update_base_connections = 0;
+
 	r_cpu_busy = 0;
 	r_cpu_busy_start_time = 0;
 	r_last_compute_condor_load = resmgr->now();
@@ -350,6 +356,8 @@ Resource::~Resource()
 		update_tid = -1;
 	}
 
+	reset_update_base();
+
 #if HAVE_JOB_HOOKS
 	if (m_next_fetch_work_tid != -1) {
 		if (daemonCore->Cancel_Timer(m_next_fetch_work_tid) < 0 ) {
@@ -1319,6 +1327,9 @@ Resource::reconfig( void )
 	}
 	m_hook_keyword_initialized = false;
 #endif /* HAVE_JOB_HOOKS */
+
+		// Start the next update over from a full ad
+	reset_update_base();
 }
 
 
@@ -1536,9 +1547,36 @@ Resource::do_update( void )
 #endif
 #endif
 
-		// Send class ads to collector(s)
-	rval = resmgr->send_update( UPDATE_STARTD_AD, &public_ad,
-								&private_ad, true );
+	ClassAd public_delta;
+	ClassAd private_delta;
+	if( make_update_deltas(public_ad, private_ad, public_delta, private_delta) ) {
+		rval = resmgr->send_update( UPDATE_STARTD_AD_DELTA, &public_delta,
+									&private_delta, true );
+	} else {
+			// Keep what we send as the base for later deltas
+		ClassAd *base_public = NULL;
+		ClassAd *base_private = NULL;
+		if( send_delta_updates ) {
+			base_public = new ClassAd(public_ad);
+			base_private = new ClassAd(private_ad);
+		}
+
+			// Send class ads to collector(s)
+		rval = resmgr->send_update( UPDATE_STARTD_AD, &public_ad,
+									&private_ad, true );
+
+		reset_update_base();
+		if( rval && base_public ) {
+			r_update_base_public = base_public;
+			r_update_base_private = base_private;
+			public_ad.LookupInteger( ATTR_UPDATE_SEQUENCE_NUMBER, r_update_base_seq );
+			r_update_base_time = resmgr->now();
+			r_update_base_connections = DCCollector::updateConnections();
+		} else {
+			delete base_public;
+			delete base_private;
+		}
+	}
 	if( rval ) {
 		dprintf( D_FULLDEBUG, "Sent update to %d collector(s)\n", rval );
 	} else {
@@ -1550,6 +1588,99 @@ Resource::do_update( void )
 	update_tid = -1;
 }
 
+// Add the names of the attributes that differ between ad and base.
+static void
+diff_update_ad( ClassAd &ad, ClassAd &base, classad::References &changed )
+{
+	for( auto itr = ad.begin(); itr != ad.end(); ++itr ) {
+		ExprTree *base_expr = base.Lookup( itr->first );
+		if( ! base_expr || ! itr->second->SameAs( base_expr ) ) {
+			changed.insert( itr->first );
+		}
+	}
+	for( auto itr = base.begin(); itr != base.end(); ++itr ) {
+		if( ! ad.Lookup( itr->first ) ) {
+			changed.insert( itr->first );
+		}
+	}
+}
+
+// Put the current value of each changed attribute into delta, and list
+// the ones that are gone.
+static void
+fill_update_delta( ClassAd &ad, const classad::References &changed, ClassAd &delta )
+{
+	std::string removed;
+	for( const auto &attr : changed ) {
+		ExprTree *expr = ad.Lookup( attr );
+		if( expr ) {
+			delta.Insert( attr, expr->Copy() );
+		} else {
+			if( ! removed.empty() ) { removed += ","; }
+			removed += attr;
+		}
+	}
+	if( ! removed.empty() ) {
+		delta.Assign( ATTR_DELTA_REMOVED_ATTRIBUTES, removed );
+	}
+}
+
+// Build delta updates for the collector from the ads we would otherwise
+// send in full.  The deltas are cumulative since the last full update,
+// so the collector can apply one even if it missed the ones before it.
+// Returns false if it's time to send full ads instead.
+bool
+Resource::make_update_deltas( ClassAd &public_ad, ClassAd &private_ad,
+							  ClassAd &public_delta, ClassAd &private_delta )
+{
+	if( ! send_delta_updates || ! r_update_base_public || r_update_base_seq < 0 ) {
+		return false;
+	}
+	if( resmgr->now() - r_update_base_time >= full_update_interval ) {
+		return false;
+	}
+		// A new connection may be to a collector that has restarted
+		// and no longer has the base ads.
+	if( DCCollector::updateConnections() != r_update_base_connections ) {
+		dprintf( D_FULLDEBUG, "Reconnected to collector(s), sending full update\n" );
+		return false;
+	}
+
+	diff_update_ad( public_ad, *r_update_base_public, r_update_changed_public );
+	diff_update_ad( private_ad, *r_update_base_private, r_update_changed_private );
+
+		// Once most of the ad has changed, a new base is cheaper
+	if( r_update_changed_public.size() * 2 > (size_t)public_ad.size() ) {
+		return false;
+	}
+
+	fill_update_delta( public_ad, r_update_changed_public, public_delta );
+	fill_update_delta( private_ad, r_update_changed_private, private_delta );
+
+		// What the collector needs to find the ad and its sequence
+	const char *keys[] = { ATTR_NAME, ATTR_MY_TYPE, ATTR_TARGET_TYPE, ATTR_MACHINE,
+						   ATTR_MY_ADDRESS, ATTR_STARTD_IP_ADDR };
+	for( const char *attr : keys ) {
+		CopyAttribute( attr, public_delta, public_ad );
+	}
+	public_delta.Assign( ATTR_DELTA_BASE_SEQUENCE_NUMBER, r_update_base_seq );
+	private_delta.Assign( ATTR_DELTA_BASE_SEQUENCE_NUMBER, r_update_base_seq );
+
+	dprintf( D_FULLDEBUG, "Sending delta update of %d of %d attributes\n",
+			 (int)r_update_changed_public.size(), (int)public_ad.size() );
+	return true;
+}
+
+void
+Resource::reset_update_base( void )
+{
+	delete r_update_base_public; r_update_base_public = NULL;
+	delete r_update_base_private; r_update_base_private = NULL;
+	r_update_base_seq = -1;
+	r_update_changed_public.clear();
+	r_update_changed_private.clear();
+}
+
 // build a slot ad from whole cloth, used for updating the collector, etc
 // it is an ERROR to pass r_classad as input ad here!!
 void Resource::publish_single_slot_ad(ClassAd & ad, time_t cur_time, Purpose purpose)
@@ -421,6 +421,20 @@ private:
 
 	int			update_tid;	// DaemonCore timer id for update delay
 
+		// The last full ads we sent to the collector, which delta
+		// updates (STARTD_SEND_DELTA_UPDATES) are relative to.
+	ClassAd*	r_update_base_public;
+	ClassAd*	r_update_base_private;
+	long long	r_update_base_seq;
+	time_t		r_update_base_time;
+	unsigned long r_update_base_connections;
+		// Every attribute that has differed from the base since it was sent
+	classad::References r_update_changed_public;
+	classad::References r_update_changed_private;
+	bool	make_update_deltas( ClassAd &public_ad, ClassAd &private_ad,
+								ClassAd &public_delta, ClassAd &private_delta );
+	void	reset_update_base( void );
+
 	int		r_cpu_busy;
 	time_t	r_cpu_busy_start_time;
 	time_t	r_last_compute_condor_load;
@@ -57,6 +57,8 @@ ResMgr*	resmgr;			// Pointer to the resource manager object
 int	polling_interval = 0;	// Interval for polling when there are resources in use
 int	update_interval = 0;	// Interval to update CM
 int	update_offset = 0;		// Interval offset to update CM
+bool	send_delta_updates = false;	// Send only changed attributes to CM
+int	full_update_interval = 0;	// Max interval between full updates
 
 // String Lists
 StringList *startd_job_attrs = NULL;
@@ -510,6 +512,8 @@ init_params( int first_time)
 
 	update_interval = param_integer( "UPDATE_INTERVAL", 300, 1 );
 	update_offset = param_integer( "UPDATE_OFFSET", 0, 0 );
+	send_delta_updates = param_boolean( "STARTD_SEND_DELTA_UPDATES", false );
+	full_update_interval = param_integer( "STARTD_FULL_UPDATE_INTERVAL", 900, 0 );
 
 	if( accountant_host ) {
 		free( accountant_host );
@@ -137,6 +137,7 @@ const char * DashDryRunOutName = NULL;
 int		DumpSubmitHash = 0;
 int		DumpSubmitDigest = 0;
 int		MaxProcsPerCluster;
+int		BulkSubmitMaxProcs = 0; // max procs per BulkSubmit message, 0 to create procs one NewProc at a time
 int	  ClusterId = -1;
 int	  ProcId = -1;
 int		ClustersCreated = 0;
@@ -230,6 +231,11 @@ int  check_sub_file(void*pv, SubmitHash * sub, _submit_file_role role, const cha
 bool is_crlf_shebang(const char * path);
 int  SendLastExecutable();
 static int MySendJobAttributes(const JOB_ID_KEY & key, const classad::ClassAd & ad, SetAttributeFlags_t saflags);
+static bool UseBulkSubmit();
+static int BulkNextProcId(int cluster_id);
+static int BulkQueueJob(const JOB_ID_KEY & key, const classad::ClassAd & ad);
+static int BulkFlushJobs();
+static void print_new_proc_error(int rval);
 int  DoUnitTests(int options);
 
 char *username = NULL;
@@ -927,6 +933,7 @@ main( int argc, const char *argv[] )
 	}
 
 	MaxProcsPerCluster = param_integer("SUBMIT_MAX_PROCS_IN_CLUSTER", 0, 0);
+	BulkSubmitMaxProcs = param_integer("SUBMIT_BULK_MAX_PROCS", 1000, 0);
 
 	// the -dry argument takes a qualifier that I'm hijacking to do queue parsing unit tests for now the 8.3 series.
 	if (DashDryRun > 0x10) { exit(DoUnitTests(DashDryRun)); }
@@ -1129,6 +1136,9 @@ main( int argc, const char *argv[] )
 	// we can't disconnect from something if we haven't connected to it: since
 	// we are dumping to a file, we don't actually open a connection to the schedd
 	if (MyQ) {
+		// send any procs still waiting to go in a bulk submit message
+		BulkFlushJobs();
+
 		CondorError errstack;
 		if ( !MyQ->disconnect(true, errstack) ) {
 			fprintf(stderr, "\nERROR: Failed to commit job submission into the queue.\n");
@@ -2315,6 +2325,9 @@ int allocate_a_cluster()
 		exit(1);
 	}
 
+	// the procs of the current cluster must be created before we start a new one.
+	BulkFlushJobs();
+
 	if ((ClusterId = MyQ->get_NewCluster()) < 0) {
 		fprintf(stderr, "\nERROR: Failed to create cluster\n");
 		if ( ClusterId == -2 ) {
@@ -2385,20 +2398,17 @@ int queue_item(int num, StringList & vars, char * item, int item_index, int opti
 			exit(1);
 		}
 
-		ProcId = MyQ->get_NewProc (ClusterId);
+		// when using bulk submit, the proc is created by the schedd when the batch is sent
+		// so we assign the proc id that the schedd will give it.
+		bool bulk = UseBulkSubmit();
+		if (bulk) {
+			ProcId = BulkNextProcId(ClusterId);
+		} else {
+			ProcId = MyQ->get_NewProc (ClusterId);
+		}
 
 		if ( ProcId < 0 ) {
-			fprintf(stderr, "\nERROR: Failed to create proc\n");
-			if ( ProcId == -2 ) {
-				fprintf(stderr,
-				"Number of submitted jobs would exceed MAX_JOBS_SUBMITTED\n");
-			} else if( ProcId == -3 ) {
-				fprintf(stderr,
-				"Number of submitted jobs would exceed MAX_JOBS_PER_OWNER\n");
-			} else if( ProcId == -4 ) {
-				fprintf(stderr,
-				"Number of submitted jobs would exceed MAX_JOBS_PER_SUBMISSION\n");
-			}
+			print_new_proc_error(ProcId);
 			DoCleanup(0,0,NULL);
 			exit(1);
 		}
@@ -2432,14 +2442,16 @@ int queue_item(int num, StringList & vars, char * item, int item_index, int opti
 
 			// before sending proc0 ad, send the cluster ad
 			classad::ClassAd * cad = job->GetChainedParentAd();
-			if (cad) {
+			if (cad && ! bulk) {
 				rval = MySendJobAttributes(JOB_ID_KEY(jid.cluster, -1), *cad, setattrflags);
 			}
 		}
 		NewExecutable = false;
 
-		// now send the proc ad
-		if (rval >= 0) {
+		// now send the proc ad, or add it (and the cluster ad for proc 0) to the bulk submit batch
+		if (bulk) {
+			rval = BulkQueueJob(jid, *job);
+		} else if (rval >= 0) {
 			rval = MySendJobAttributes(jid, *job, setattrflags);
 		}
 		switch( rval ) {
@@ -3156,6 +3168,144 @@ static int MySendJobAttributes(const JOB_ID_KEY & key, const classad::ClassAd &
 }
 
 
+static void print_new_proc_error(int rval)
+{
+	fprintf(stderr, "\nERROR: Failed to create proc\n");
+	if ( rval == -2 ) {
+		fprintf(stderr,
+		"Number of submitted jobs would exceed MAX_JOBS_SUBMITTED\n");
+	} else if( rval == -3 ) {
+		fprintf(stderr,
+		"Number of submitted jobs would exceed MAX_JOBS_PER_OWNER\n");
+	} else if( rval == -4 ) {
+		fprintf(stderr,
+		"Number of submitted jobs would exceed MAX_JOBS_PER_SUBMISSION\n");
+	}
+}
+
+// procs waiting to be sent to the schedd in a single BulkSubmit message.
+// the cluster ad is sent whole, the proc ads are sent as a table with a column
+// for each attribute that any proc in the batch sets.
+static struct {
+	int cluster = -1;
+	int first_proc = 0;    // proc id of rows[0]
+	int next_proc = 0;     // proc id to assign to the next job
+	bool has_cluster_ad = false;
+	classad::ClassAd cluster_ad;
+	std::vector<std::string> columns;
+	std::map<std::string, size_t, classad::CaseIgnLTStr> column_index;
+	std::vector< std::vector<std::string> > rows;
+} BulkBatch;
+
+static bool UseBulkSubmit()
+{
+	return BulkSubmitMaxProcs > 0 && MyQ && MyQ->has_bulk_submit();
+}
+
+// the schedd gives out proc ids in order starting at 0 for each new cluster
+static int BulkNextProcId(int cluster_id)
+{
+	if (BulkBatch.cluster != cluster_id) {
+		BulkBatch.cluster = cluster_id;
+		BulkBatch.first_proc = BulkBatch.next_proc = 0;
+	}
+	return BulkBatch.next_proc++;
+}
+
+// add a job to the bulk submit batch, this applies the same rules for which attributes go
+// into the cluster ad and proc ad as MySendJobAttributes.  when the job is proc 0, its chained
+// parent is the cluster ad and is added to the batch as well.
+static int BulkQueueJob(const JOB_ID_KEY & key, const classad::ClassAd & ad)
+{
+	if (key.proc == 0) {
+		const classad::ClassAd * cad = ad.GetChainedParentAd();
+		if (cad) {
+			for (auto it = cad->begin(); it != cad->end(); ++it) {
+				int forced = IsForcedProcAttribute(it->first.c_str());
+				if (forced && forced != -1) continue;
+				if ( ! it->second) {
+					fprintf(stderr, "\nERROR: Null attribute name or value for job %d\n", key.cluster);
+					return -1;
+				}
+				BulkBatch.cluster_ad.Insert(it->first, it->second->Copy());
+			}
+			BulkBatch.has_cluster_ad = true;
+		}
+	}
+
+	std::vector<std::string> row(BulkBatch.columns.size());
+	auto set_cell = [&row](const std::string & attr, const std::string & value) {
+		size_t col;
+		auto found = BulkBatch.column_index.find(attr);
+		if (found == BulkBatch.column_index.end()) {
+			col = BulkBatch.columns.size();
+			BulkBatch.columns.push_back(attr);
+			BulkBatch.column_index[attr] = col;
+		} else {
+			col = found->second;
+		}
+		if (col >= row.size()) { row.resize(col + 1); }
+		row[col] = value;
+	};
+
+	// as in MySendJobAttributes, JobStatus always goes into the proc ad even when it comes from the cluster ad
+	int status = IDLE;
+	if ( ! ad.EvaluateAttrInt(ATTR_JOB_STATUS, status)) { status = IDLE; }
+	set_cell(ATTR_JOB_STATUS, std::to_string(status));
+
+	classad::ClassAdUnParser unparser;
+	unparser.SetOldClassAd( true, true );
+	std::string rhs;
+	for (auto it = ad.begin(); it != ad.end(); ++it) {
+		int forced = IsForcedProcAttribute(it->first.c_str());
+		if (forced && forced != 1) continue;
+		if ( ! it->second) {
+			fprintf(stderr, "\nERROR: Null attribute name or value for job %d.%d\n", key.cluster, key.proc);
+			return -1;
+		}
+		rhs.clear();
+		unparser.Unparse(rhs, it->second);
+		set_cell(it->first, rhs);
+	}
+
+	BulkBatch.rows.push_back(std::move(row));
+	if ((int)BulkBatch.rows.size() >= BulkSubmitMaxProcs) {
+		return BulkFlushJobs();
+	}
+	return 0;
+}
+
+// send the bulk submit batch (if any) to the schedd, exits on failure as a failed NewProc would.
+static int BulkFlushJobs()
+{
+	if (BulkBatch.rows.empty() && ! BulkBatch.has_cluster_ad)
+		return 0;
+
+	int num_procs = (int)BulkBatch.rows.size();
+	int rval = MyQ->send_BulkSubmit(BulkBatch.cluster, BulkBatch.first_proc,
+		BulkBatch.has_cluster_ad ? &BulkBatch.cluster_ad : NULL,
+		BulkBatch.columns, BulkBatch.rows, setattrflags);
+	if (rval != num_procs) {
+		if (rval < -1) {
+			print_new_proc_error(rval);
+		} else {
+			fprintf(stderr, "\nERROR: Failed to queue jobs %d.%d through %d.%d (%d)\n",
+				BulkBatch.cluster, BulkBatch.first_proc, BulkBatch.cluster, BulkBatch.first_proc + num_procs - 1, errno);
+		}
+		DoCleanup(0,0,NULL);
+		exit(1);
+	}
+
+	BulkBatch.first_proc += num_procs;
+	BulkBatch.has_cluster_ad = false;
+	BulkBatch.cluster_ad.Clear();
+	BulkBatch.columns.clear();
+	BulkBatch.column_index.clear();
+	BulkBatch.rows.clear();
+	return 0;
+}
+
+
 // If our effective and real gids are different (b/c the submit binary
 // is setgid) set umask(002) so that stdout, stderr and the user log
 // files are created writable by group condor.  This way, people who
@@ -68,6 +68,10 @@ public:
 	virtual bool allows_late_materialize() { return true; }
 	virtual int set_Factory(int cluster, int qnum, const char * filename, const char * text);
 	virtual int send_Itemdata(int cluster, SubmitForeachArgs & o);
+	virtual bool has_bulk_submit() { return false; }
+	virtual int send_BulkSubmit(int cluster, int first_proc, const classad::ClassAd * cluster_ad,
+		const std::vector<std::string> & columns, const std::vector< std::vector<std::string> > & proc_rows,
+		SetAttributeFlags_t flags = 0);
 
 	// set a file that send_Itemdata should "echo" items into. If this file is not set
 	// items are sent but not echoed.
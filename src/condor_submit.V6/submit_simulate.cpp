@@ -160,6 +160,36 @@ int SimScheddQ::set_Factory(int cluster_id, int qnum, const char * filename, con
 	return 0;
 }
 
+// the simulated schedd does not advertise BulkSubmit, but if asked it replays the batch as individual calls.
+int SimScheddQ::send_BulkSubmit(int cluster_id, int first_proc, const classad::ClassAd * cluster_ad,
+	const std::vector<std::string> & columns, const std::vector< std::vector<std::string> > & proc_rows,
+	SetAttributeFlags_t flags)
+{
+	ASSERT(cluster_id == cluster);
+	if (cluster_ad) {
+		classad::ClassAdUnParser unparser;
+		unparser.SetOldClassAd( true, true );
+		std::string rhs;
+		set_AttributeInt(cluster_id, -1, ATTR_CLUSTER_ID, cluster_id, flags);
+		for (auto it = cluster_ad->begin(); it != cluster_ad->end(); ++it) {
+			rhs.clear();
+			unparser.Unparse(rhs, it->second);
+			set_Attribute(cluster_id, -1, it->first.c_str(), rhs.c_str(), flags);
+		}
+	}
+	for (size_t row = 0; row < proc_rows.size(); ++row) {
+		int proc_id = get_NewProc(cluster_id);
+		ASSERT(proc_id == first_proc + (int)row);
+		set_AttributeInt(cluster_id, proc_id, ATTR_PROC_ID, proc_id, flags);
+		const std::vector<std::string> & cells = proc_rows[row];
+		for (size_t ix = 0; ix < cells.size() && ix < columns.size(); ++ix) {
+			if (cells[ix].empty()) continue;
+			set_Attribute(cluster_id, proc_id, columns[ix].c_str(), cells[ix].c_str(), flags);
+		}
+	}
+	return (int)proc_rows.size();
+}
+
 bool SimScheddQ::echo_Itemdata(const char * filename)
 {
 	echo_itemdata_filepath = filename;
@@ -46,6 +46,7 @@
 #include "classad_helpers.h" // for initStringListFromAttrs
 #include "history_utils.h"
 #include "backward_file_reader.h"
+#include "history_index.h"
 #include <fcntl.h>  // for O_BINARY
 
 void Usage(const char* name, int iExitCode=1);
@@ -111,6 +112,7 @@ static void readHistoryRemote(classad::ExprTree *constraintExpr, bool want_start
 static void readHistoryFromFiles(bool fileisuserlog, const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr);
 static void readHistoryFromFileOld(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr);
 static void readHistoryFromFileEx(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr, bool read_backwards);
+static bool readHistoryFromIndex(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr, bool read_backwards);
 static void printJobAds(ClassAdList & jobs);
 static void printJob(ClassAd & ad);
 
@@ -1402,6 +1404,11 @@ static void readHistoryFromFileEx(const char *JobHistoryFileName, const char* co
 		return;
 	}
 
+	// if the history file has an index that lets us skip ads that cannot match, use it.
+	if (readHistoryFromIndex(JobHistoryFileName, constraint, constraintExpr, read_backwards)) {
+		return;
+	}
+
 	// the old function doesn't work for backwards, but it does work for forwards so go ahead and call it.
 	//
 	if ( ! read_backwards) {
@@ -1483,6 +1490,128 @@ static void readHistoryFromFileEx(const char *JobHistoryFileName, const char* co
 	reader.Close();
 }
 
+// read the job ad that the index entry refers to from the history file
+//
+static bool readHistoryAdAt(FILE * fp, const HistoryIndexEntry & entry, ClassAd & ad)
+{
+	ad.Clear();
+	if (fseek(fp, entry.offset, SEEK_SET) != 0) {
+		return false;
+	}
+	std::string line;
+	while (ftell(fp) < entry.offset + entry.length && readLine(line, fp)) {
+		chomp(line);
+		// the banner is at the end of the job information
+		if (starts_with(line.c_str(), "*** ")) {
+			break;
+		}
+		const char * psz = line.c_str();
+		while (*psz == ' ' || *psz == '\t') ++psz;
+		if ( ! *psz || *psz == '#') {
+			continue;
+		}
+		if ( ! ad.Insert(line)) {
+			dprintf(D_ALWAYS,"condor_history: failed to create classad; bad expr = '%s'\n", line.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+// Use the index of the history file to answer the query when the index holds all of the attributes
+// that the constraint refers to, or when the constraint puts a lower bound on CompletionDate.
+// In the first case only the ads that match are read from the history file, in the second case
+// we can binary search the index for the first ad that could match (or stop reading backwards there)
+// returns false if there is no usable index, in which case the caller should read the history file.
+//
+static bool readHistoryFromIndex(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr, bool read_backwards)
+{
+	bool has_constraint = constraint && constraint[0] && constraintExpr;
+	if ( ! has_constraint) {
+		return false; // every ad must be read anyway
+	}
+
+	HistoryIndexReader index;
+	if ( ! index.Open(JobHistoryFileName)) {
+		return false;
+	}
+
+	ClassAd empty;
+	classad::References refs;
+	GetExprReferences(constraintExpr, empty, &refs, &refs);
+	bool constraint_indexed = index.Covers(refs);
+	bool since_indexed = false;
+	if (sinceExpr) {
+		refs.clear();
+		GetExprReferences(sinceExpr, empty, &refs, &refs);
+		since_indexed = index.Covers(refs);
+	}
+	time_t lower_bound = 0;
+	bool has_bound = ConstraintCompletionDateLowerBound(constraintExpr, lower_bound);
+	if ( ! constraint_indexed && ! has_bound) {
+		return false;
+	}
+
+	FILE * fp = safe_fopen_wrapper_follow(JobHistoryFileName, "rb");
+	if ( ! fp) {
+		fprintf(stderr,"Error opening history file %s: %s\n", JobHistoryFileName, strerror(errno));
+		exit(1);
+	}
+
+	// an ad is always written after it completes, so ads written before the lower bound cannot match.
+	if (has_bound && ! read_backwards) {
+		index.SeekTime(lower_bound);
+	}
+
+	HistoryIndexEntry entry;
+	ClassAd indexAd, ad;
+	while (read_backwards ? index.Prev(entry) : index.Next(entry)) {
+		if ((specifiedMatch > 0 && matchCount >= specifiedMatch) || (maxAds > 0 && adCount >= maxAds))
+			break;
+		if (abort_transfer)
+			break;
+		if (has_bound && read_backwards && entry.written < lower_bound)
+			break;
+
+		bool indexAd_ok = index.MakeAd(entry, indexAd);
+		bool have_ad = false;
+		++adCount;
+
+		if (sinceExpr) {
+			bool since;
+			if (since_indexed && indexAd_ok) {
+				since = EvalExprBool(&indexAd, sinceExpr);
+			} else {
+				if ( ! readHistoryAdAt(fp, entry, ad)) {
+					printf( "\t*** Warning: Bad history file; skipping malformed ad(s)\n" );
+					continue;
+				}
+				have_ad = true;
+				since = EvalExprBool(&ad, sinceExpr);
+			}
+			if (since) {
+				maxAds = adCount; // this will force us to stop scanning
+				break;
+			}
+		}
+
+		if (constraint_indexed && indexAd_ok && ! EvalExprBool(&indexAd, constraintExpr)) {
+			continue;
+		}
+		if ( ! have_ad && ! readHistoryAdAt(fp, entry, ad)) {
+			printf( "\t*** Warning: Bad history file; skipping malformed ad(s)\n" );
+			continue;
+		}
+		if (EvalExprBool(&ad, constraintExpr)) {
+			printJob(ad);
+			matchCount++; // if control reached here, match has occured
+		}
+	}
+
+	fclose(fp);
+	return true;
+}
+
 // !!! ENTRIES IN THIS TABLE MUST BE SORTED BY THE FIRST FIELD !!
 static const CustomFormatFnTableItem LocalPrintFormats[] = {
 	{ "DATE",            ATTR_Q_DATE, 0, format_int_date, NULL },
@@ -0,0 +1,375 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+/* Test the binary ClassAd encoding of classad_binary.h, and compare how
+   long it takes to send ads over a socket with it and as text.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_classad.h"
+#include "classad_binary.h"
+#include "classad_oldnew.h"
+#include "reli_sock.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+
+static const char *slot_text =
+	"[ Name = \"slot1@node0042.cs.wisc.edu\"; Machine = \"node0042.cs.wisc.edu\";"
+	"  MyType = \"Machine\"; Arch = \"X86_64\"; OpSys = \"LINUX\"; State = \"Unclaimed\";"
+	"  Activity = \"Idle\"; Cpus = 8; Memory = 16384; Disk = 5000000; LoadAvg = 0.125;"
+	"  Mips = 31416; KFlops = 1234567; TotalCpus = 8.0; HasFileTransfer = true;"
+	"  HasVM = false; KeyboardIdle = 1200; EnteredCurrentState = 1623456789;"
+	"  JobStarts = -7; CondorLoadAvg = 1.0E-3; Offline = undefined; Broken = error;"
+	"  FileSystemDomain = \"cs.wisc.edu\"; Rank = 0.0;"
+	"  StartdIpAddr = \"<128.105.1.42:9618?addrs=128.105.1.42-9618&noUDP>\";"
+	"  Start = (KeyboardIdle > 15 * 60) && (LoadAvg < 0.3 || State == \"Unclaimed\")"
+	"    && TARGET.ImageSize <= Memory * 1024 && TARGET.Owner =!= \"mallory\";"
+	"  Requirements = START && (WithinResourceLimits =?= true);"
+	"  WithinResourceLimits = (MY.Cpus > 0 && TARGET.RequestCpus <= MY.Cpus"
+	"    && ifThenElse(TARGET.RequestMemory is undefined, true, TARGET.RequestMemory <= MY.Memory));"
+	"  IsWakeAble = false; SlotWeight = Cpus; MachineResources = \"Cpus Memory Disk Swap\";"
+	"  ChildCpus = { 1, 2, 5 }; ChildState = { \"Claimed\", \"Idle\" };"
+	"  Nested = [ a = 1; b = \"two\"; c = a + 1 ]; Picked = Nested.c + ChildCpus[1];"
+	"  Absolute = .Cpus; Shift = -Cpus >>> 2; Ternary = Cpus > 4 ? \"big\" : \"small\";"
+	"  Quoted = \"say \\\"hello\\\" and \\\\ back\" ]";
+
+	// helper functions
+static classad::ClassAd *make_slot_ad(int id);
+static bool round_trip(classad::ClassAd &ad, std::unordered_map<std::string, int> &sent,
+	std::vector<std::string> &received, classad::ClassAd &out, size_t &size, std::string &error);
+
+	// test functions
+static bool test_round_trip(void);
+static bool test_names_interned(void);
+static bool test_out_of_sync(void);
+static bool test_sender_restart(void);
+static bool test_truncated(void);
+static bool test_corrupted(void);
+static bool test_benchmark(void);
+
+bool OTEST_ClassAdBinary(void) {
+		// beginning junk
+	emit_object("ClassAdBinary");
+	emit_comment("An ad sent in the binary encoding must arrive the same as "
+		"the ad that was sent.  The last test reports how long it takes to "
+		"send slot ads over a socket in each encoding.");
+
+		// driver to run the tests and all required setup
+	FunctionDriver driver;
+	driver.register_function(test_round_trip);
+	driver.register_function(test_names_interned);
+	driver.register_function(test_out_of_sync);
+	driver.register_function(test_sender_restart);
+	driver.register_function(test_truncated);
+	driver.register_function(test_corrupted);
+	driver.register_function(test_benchmark);
+
+		// run the tests
+	return driver.do_all_functions();
+}
+
+static classad::ClassAd *make_slot_ad(int id) {
+	classad::ClassAdParser parser;
+	classad::ClassAd *ad = parser.ParseClassAd(slot_text);
+	if ( ! ad) {
+		return NULL;
+	}
+	for (int ii = 0; ii < 60; ++ii) {
+		std::string attr;
+		formatstr(attr, "Monitor%dCount", ii);
+		ad->InsertAttr(attr, (long long)ii * id);
+		formatstr(attr, "Monitor%dName", ii);
+		ad->InsertAttr(attr, attr.c_str());
+	}
+	ad->InsertAttr("SlotID", id);
+	return ad;
+}
+
+static bool round_trip(classad::ClassAd &ad, std::unordered_map<std::string, int> &sent,
+	std::vector<std::string> &received, classad::ClassAd &out, size_t &size, std::string &error)
+{
+	std::string buf;
+	ClassAdBinaryWriter writer(sent, buf);
+	for (auto itr = ad.begin(); itr != ad.end(); ++itr) {
+		writer.Add(itr->first, itr->second);
+	}
+	size = buf.size();
+	ClassAdBinaryReader reader(received);
+	out.Clear();
+	if ( ! reader.Read(buf.data(), buf.size(), out, false)) {
+		error = reader.Error();
+		return false;
+	}
+	error.clear();
+	return true;
+}
+
+static bool test_round_trip() {
+	emit_test("Does an ad with every kind of literal and expression arrive "
+		"the same as it was sent?");
+	classad::ClassAd *ad = make_slot_ad(1);
+	if ( ! ad) {
+		FAIL;
+	}
+	classad::abstime_t at = { 1623456789, -5*3600 };
+	ad->Insert("AbsTime", classad::Literal::MakeAbsTime(&at));
+	ad->Insert("RelTime", classad::Literal::MakeRelTime((time_t)90061));
+
+	std::unordered_map<std::string, int> sent;
+	std::vector<std::string> received;
+	classad::ClassAd out;
+	size_t size = 0;
+	std::string error;
+	bool ok = round_trip(*ad, sent, received, out, size, error);
+
+	std::string sent_str, received_str;
+	classad::ClassAdUnParser unparser;
+	for (auto itr = ad->begin(); itr != ad->end(); ++itr) {
+		classad::ExprTree *tree = out.Lookup(itr->first);
+		if ( ! tree || ! tree->SameAs(itr->second)) {
+			sent_str.clear(); received_str.clear();
+			unparser.Unparse(sent_str, itr->second);
+			if (tree) unparser.Unparse(received_str, tree);
+			emit_param(itr->first.c_str(), "%s / %s", sent_str.c_str(), received_str.c_str());
+			ok = false;
+		}
+	}
+	emit_output_expected_header();
+	emit_param("Attributes", "%d", ad->size());
+	emit_output_actual_header();
+	emit_param("Attributes", "%d", out.size());
+	emit_param("Error", "%s", error.c_str());
+	if (out.size() != ad->size()) {
+		ok = false;
+	}
+	delete ad;
+	if ( ! ok) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_names_interned() {
+	emit_test("Is a second ad with the same attribute names sent with indexes "
+		"instead of names?");
+	classad::ClassAd *ad1 = make_slot_ad(1);
+	classad::ClassAd *ad2 = make_slot_ad(2);
+	std::unordered_map<std::string, int> sent;
+	std::vector<std::string> received;
+	classad::ClassAd out;
+	size_t first = 0, second = 0;
+	std::string error;
+	bool ok = ad1 && ad2 &&
+		round_trip(*ad1, sent, received, out, first, error) &&
+		round_trip(*ad2, sent, received, out, second, error) &&
+		out.SameAs(ad2);
+	emit_output_expected_header();
+	emit_param("Names", "%d / %d", (int)sent.size(), (int)sent.size());
+	emit_param("Second size", "less than first");
+	emit_output_actual_header();
+	emit_param("Names", "%d / %d", (int)sent.size(), (int)received.size());
+	emit_param("Sizes", "%d / %d", (int)first, (int)second);
+	delete ad1;
+	delete ad2;
+	if ( ! ok || second >= first || sent.size() != received.size()) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_out_of_sync() {
+	emit_test("Is an ad that refers to names the receiver never saw rejected?");
+	classad::ClassAd *ad = make_slot_ad(1);
+	std::unordered_map<std::string, int> sent;
+	std::vector<std::string> received, fresh;
+	classad::ClassAd out;
+	size_t size = 0;
+	std::string error;
+	bool first_ok = ad && round_trip(*ad, sent, received, out, size, error);
+	bool second_ok = ad && round_trip(*ad, sent, fresh, out, size, error);
+	emit_output_expected_header();
+	emit_param("Second read", "fails");
+	emit_output_actual_header();
+	emit_param("Second read", "%s", second_ok ? "succeeds" : error.c_str());
+	delete ad;
+	if ( ! first_ok || second_ok) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_sender_restart() {
+	emit_test("Can a receiver with a full table read an ad from a sender that "
+		"started a new one?");
+	classad::ClassAd *ad = make_slot_ad(1);
+	std::unordered_map<std::string, int> sent, restarted;
+	std::vector<std::string> received;
+	classad::ClassAd out;
+	size_t size = 0;
+	std::string error;
+	bool ok = ad &&
+		round_trip(*ad, sent, received, out, size, error) &&
+		round_trip(*ad, restarted, received, out, size, error) &&
+		out.SameAs(ad);
+	emit_output_actual_header();
+	emit_param("Error", "%s", error.c_str());
+	delete ad;
+	if ( ! ok) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_truncated() {
+	emit_test("Is every truncation of an encoded ad rejected or read without "
+		"crashing?");
+	classad::ClassAd *ad = make_slot_ad(1);
+	if ( ! ad) {
+		FAIL;
+	}
+	std::unordered_map<std::string, int> sent;
+	std::string buf;
+	ClassAdBinaryWriter writer(sent, buf);
+	for (auto itr = ad->begin(); itr != ad->end(); ++itr) {
+		writer.Add(itr->first, itr->second);
+	}
+	delete ad;
+
+	int rejected = 0;
+	for (size_t len = 0; len < buf.size(); ++len) {
+		std::vector<std::string> received;
+		classad::ClassAd out;
+		ClassAdBinaryReader reader(received);
+		if ( ! reader.Read(buf.data(), len, out, false)) {
+			++rejected;
+		}
+	}
+	emit_output_actual_header();
+	emit_param("Rejected", "%d of %d", rejected, (int)buf.size());
+	if (rejected == 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_corrupted() {
+	emit_test("Is every single byte corruption of an encoded ad with each "
+		"kind of operator rejected or read without crashing?");
+	classad::ClassAdParser parser;
+	classad::ClassAd *ad = parser.ParseClassAd("[ A = (B + -C) ? D[0] : !E ]");
+	if ( ! ad) {
+		FAIL;
+	}
+	std::unordered_map<std::string, int> sent;
+	std::string buf;
+	ClassAdBinaryWriter writer(sent, buf);
+	for (auto itr = ad->begin(); itr != ad->end(); ++itr) {
+		writer.Add(itr->first, itr->second);
+	}
+	delete ad;
+
+	int rejected = 0, tried = 0;
+	for (size_t pos = 0; pos < buf.size(); ++pos) {
+		for (int val = 0; val < 256; ++val) {
+			if ((unsigned char)buf[pos] == val) {
+				continue;
+			}
+			std::string bad = buf;
+			bad[pos] = (char)val;
+			std::vector<std::string> received;
+			classad::ClassAd out;
+			ClassAdBinaryReader reader(received);
+			if ( ! reader.Read(bad.data(), bad.size(), out, false)) {
+				++rejected;
+			}
+			++tried;
+		}
+	}
+	emit_output_actual_header();
+	emit_param("Rejected", "%d of %d", rejected, tried);
+	if (rejected == 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool send_ads(bool binary, classad::ClassAd **ads, int num_ads, int iterations,
+	double &seconds, float &bytes)
+{
+	ReliSock sender, receiver;
+	if ( ! sender.connect_socketpair(receiver)) {
+		return false;
+	}
+	sender.timeout(20);
+	receiver.timeout(20);
+	sender.classad_wire_state().use_binary = binary ? 1 : 0;
+
+	bool ok = true;
+	double begin = now_double();
+	for (int ii = 0; ii < iterations && ok; ++ii) {
+		classad::ClassAd *ad = ads[ii % num_ads];
+		classad::ClassAd out;
+		sender.encode();
+		receiver.decode();
+		ok = putClassAd(&sender, *ad) && sender.end_of_message() &&
+			getClassAd(&receiver, out) && receiver.end_of_message();
+		if (ok && ii < num_ads) {
+			ok = out.SameAs(ad);
+		}
+	}
+	seconds = now_double() - begin;
+	bytes = sender.get_bytes_sent();
+	return ok;
+}
+
+static bool test_benchmark() {
+	emit_test("How long does it take to send slot ads over a socket as text "
+		"and in the binary encoding?");
+	const int num_ads = 16;
+	const int iterations = 5000;
+	classad::ClassAd *ads[num_ads];
+	for (int ii = 0; ii < num_ads; ++ii) {
+		ads[ii] = make_slot_ad(ii);
+	}
+
+	double text_time = 0, binary_time = 0;
+	float text_bytes = 0, binary_bytes = 0;
+	int num_attrs = ads[0] ? ads[0]->size() : 0;
+	bool text_ok = send_ads(false, ads, num_ads, iterations, text_time, text_bytes);
+	bool binary_ok = send_ads(true, ads, num_ads, iterations, binary_time, binary_bytes);
+	for (int ii = 0; ii < num_ads; ++ii) {
+		delete ads[ii];
+	}
+
+	emit_input_header();
+	emit_param("Ads", "%d", iterations);
+	emit_param("Attributes", "%d", num_attrs);
+	emit_output_actual_header();
+	emit_param("Text", "%.3f seconds, %.0f ads/sec, %.0f bytes/ad", text_time,
+		iterations / text_time, text_bytes / iterations);
+	emit_param("Binary", "%.3f seconds, %.0f ads/sec, %.0f bytes/ad", binary_time,
+		iterations / binary_time, binary_bytes / iterations);
+	if ( ! text_ok || ! binary_ok) {
+		FAIL;
+	}
+	PASS;
+}
@@ -0,0 +1,293 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+/* Test that a classad::CompiledExpr evaluates the same as the tree it
+   was compiled from, and compare how long the two take.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "classad/classad_distribution.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+
+using namespace classad;
+
+static const char *job_text =
+	"[ Owner = \"alice\"; RequestCpus = 1; RequestMemory = 2048;"
+	"  RequestDisk = 100000; ImageSize = 1500; JobUniverse = 5;"
+	"  Requirements = TARGET.Arch == \"X86_64\" && TARGET.OpSys == \"LINUX\""
+	"    && TARGET.Disk >= RequestDisk && TARGET.Memory >= RequestMemory"
+	"    && TARGET.Cpus >= RequestCpus && (TARGET.HasFileTransfer || TARGET.FileSystemDomain == \"cs.wisc.edu\");"
+	"  Rank = TARGET.Mips * 2 + TARGET.KFlops / 1000 + (TARGET.Memory > 4096 ? 10 : 0);"
+	"  Loop = Loop + 1 ]";
+
+static const char *machine_text =
+	"[ Arch = \"X86_64\"; OpSys = \"LINUX\"; Cpus = 8; Memory = 16384;"
+	"  Disk = 5000000; Mips = 3000; KFlops = 1200000; HasFileTransfer = true;"
+	"  FileSystemDomain = \"cs.wisc.edu\"; State = \"Unclaimed\"; LoadAvg = 0.25;"
+	"  KeyboardIdle = 1200; Rank = 0;"
+	"  Start = (KeyboardIdle > 15 * 60) && (LoadAvg < 0.3 || State == \"Unclaimed\")"
+	"    && TARGET.ImageSize <= Memory * 1024 && TARGET.Owner =!= \"mallory\" ]";
+
+	// expressions evaluated in the job, with the machine as TARGET
+static const char *job_exprs[] = {
+	"Requirements",
+	"Rank",
+	"1 + 2 * 3 == 7 && RequestCpus == 1",
+	"TARGET.NoSuchAttr > 3 || TARGET.Cpus > 1",
+	"TARGET.NoSuchAttr > 3 && TARGET.Cpus > 1",
+	"NoSuchAttr =?= undefined",
+	"MY.RequestMemory + TARGET.Memory",
+	"TARGET.Cpus > 2 ? \"big\" : \"small\"",
+	"TARGET.NoSuchAttr ? 1 : 2",
+	"(RequestMemory > 10 ? TARGET.NoSuchAttr : 5) =?= undefined",
+	"ifThenElse(TARGET.HasFileTransfer, strcat(Owner, \"@\", TARGET.FileSystemDomain), \"none\")",
+	"{10, 20, 30}[1] + RequestCpus",
+	"TARGET.Memory / 0",
+	"-RequestDisk + !false",
+	"Owner.Something",
+	"Loop",
+	"\"abc\" < \"abd\" && error || true",
+};
+
+	// expressions evaluated in the machine, with the job as TARGET
+static const char *machine_exprs[] = {
+	"Start",
+	"Start && TARGET.Requirements",
+	"MY.Rank + TARGET.Rank",
+};
+
+static ClassAd *job = NULL;
+static ClassAd *machine = NULL;
+static MatchClassAd *match = NULL;
+
+	// helper functions
+static bool setup_ads();
+static void cleanup_ads();
+static bool same_result(ClassAd *scope, const char *text, std::string &tree_str, std::string &compiled_str);
+
+	// test functions
+static bool test_job_exprs(void);
+static bool test_machine_exprs(void);
+static bool test_constant_folding(void);
+static bool test_recompile(void);
+static bool test_benchmark(void);
+
+bool OTEST_CompiledExpr(void) {
+		// beginning junk
+	emit_object("CompiledExpr");
+	emit_comment("An expression compiled for the ClassAd stack machine must "
+		"evaluate exactly as the tree it was compiled from.  The last test "
+		"reports how long each takes to evaluate the same Requirements.");
+
+		// driver to run the tests and all required setup
+	FunctionDriver driver;
+	driver.register_function(test_job_exprs);
+	driver.register_function(test_machine_exprs);
+	driver.register_function(test_constant_folding);
+	driver.register_function(test_recompile);
+	driver.register_function(test_benchmark);
+
+		// run the tests
+	if ( ! setup_ads()) {
+		cleanup_ads();
+		return false;
+	}
+	bool result = driver.do_all_functions();
+	cleanup_ads();
+	return result;
+}
+
+static bool setup_ads() {
+	ClassAdParser parser;
+	job = parser.ParseClassAd(job_text);
+	machine = parser.ParseClassAd(machine_text);
+	if ( ! job || ! machine) {
+		return false;
+	}
+	match = new MatchClassAd(job, machine);
+	return true;
+}
+
+static void cleanup_ads() {
+	if (match) {
+		match->RemoveLeftAd();
+		match->RemoveRightAd();
+		delete match;
+	}
+	delete job;
+	delete machine;
+	match = NULL; job = NULL; machine = NULL;
+}
+
+static bool same_result(ClassAd *scope, const char *text, std::string &tree_str, std::string &compiled_str) {
+	ClassAdParser parser;
+	ClassAdUnParser unparser;
+	ExprTree *tree = parser.ParseExpression(text);
+	if ( ! tree) {
+		tree_str = "parse error";
+		return false;
+	}
+	tree->SetParentScope(scope);
+
+	Value tree_val, compiled_val;
+	CompiledExpr compiled;
+	compiled.Compile(tree);
+	bool tree_ok = scope->EvaluateExpr(tree, tree_val);
+	bool compiled_ok = compiled.Evaluate(scope, compiled_val);
+	delete tree;
+
+	tree_str.clear();
+	compiled_str.clear();
+	unparser.Unparse(tree_str, tree_val);
+	unparser.Unparse(compiled_str, compiled_val);
+	if ( ! tree_ok) tree_str += " (failed)";
+	if ( ! compiled_ok) compiled_str += " (failed)";
+	return tree_ok == compiled_ok && tree_str == compiled_str;
+}
+
+static bool test_job_exprs() {
+	emit_test("Do expressions evaluated in a matched job ad give the same "
+		"result compiled as they do as trees?");
+	bool all_same = true;
+	for (size_t i = 0; i < sizeof(job_exprs)/sizeof(job_exprs[0]); i++) {
+		std::string tree_str, compiled_str;
+		bool same = same_result(job, job_exprs[i], tree_str, compiled_str);
+		emit_param(job_exprs[i], "%s / %s", tree_str.c_str(), compiled_str.c_str());
+		all_same = all_same && same;
+	}
+	if ( ! all_same) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_machine_exprs() {
+	emit_test("Do expressions evaluated in a matched machine ad give the same "
+		"result compiled as they do as trees?");
+	bool all_same = true;
+	for (size_t i = 0; i < sizeof(machine_exprs)/sizeof(machine_exprs[0]); i++) {
+		std::string tree_str, compiled_str;
+		bool same = same_result(machine, machine_exprs[i], tree_str, compiled_str);
+		emit_param(machine_exprs[i], "%s / %s", tree_str.c_str(), compiled_str.c_str());
+		all_same = all_same && same;
+	}
+	if ( ! all_same) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_constant_folding() {
+	emit_test("Are operators on literals folded into constants?");
+	ClassAdParser parser;
+	ExprTree *tree = parser.ParseExpression("(KeyboardIdle > 15 * 60) && LoadAvg < 1.0 / 4 + 0.05");
+	CompiledExpr compiled;
+	compiled.Compile(tree);
+	std::string listing;
+	compiled.Dump(listing);
+	emit_input_header();
+	emit_param("Listing", "\n%s", listing.c_str());
+	emit_output_expected_header();
+	emit_param("NumFoldedConstants", "2");
+	emit_output_actual_header();
+	emit_param("NumFoldedConstants", "%d", compiled.NumFoldedConstants());
+	int folded = compiled.NumFoldedConstants();
+	delete tree;
+	if (folded != 2) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_recompile() {
+	emit_test("Does compiling again replace the previous program?");
+	ClassAdParser parser;
+	ExprTree *first = parser.ParseExpression("TARGET.Cpus * 2");
+	ExprTree *second = parser.ParseExpression("RequestMemory + 1");
+	CompiledExpr compiled;
+	Value val;
+	long long result = 0;
+	compiled.Compile(first);
+	compiled.Compile(second);
+	bool ok = compiled.Evaluate(job, val) && val.IsIntegerValue(result);
+	emit_output_expected_header();
+	emit_param("Result", "2049");
+	emit_output_actual_header();
+	emit_param("Result", "%lld", result);
+	bool same_source = compiled.GetSource() == second;
+	delete first;
+	delete second;
+	if ( ! ok || result != 2049 || ! same_source) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_benchmark() {
+	emit_test("How long do the job's Requirements and the machine's Start take "
+		"to evaluate as trees and compiled?");
+	const int iterations = 100000;
+	ExprTree *reqs = job->Lookup("Requirements");
+	ExprTree *start = machine->Lookup("Start");
+	CompiledExpr compiled_reqs, compiled_start;
+	compiled_reqs.Compile(reqs);
+	compiled_start.Compile(start);
+
+	int tree_matches = 0, compiled_matches = 0;
+	bool b;
+	Value val;
+
+	double begin = now_double();
+	for (int i = 0; i < iterations; i++) {
+		if (job->EvaluateExpr(reqs, val) && val.IsBooleanValue(b) && b &&
+			machine->EvaluateExpr(start, val) && val.IsBooleanValue(b) && b) {
+			tree_matches++;
+		}
+	}
+	double tree_time = now_double() - begin;
+
+	begin = now_double();
+	for (int i = 0; i < iterations; i++) {
+		if (compiled_reqs.Evaluate(job, val) && val.IsBooleanValue(b) && b &&
+			compiled_start.Evaluate(machine, val) && val.IsBooleanValue(b) && b) {
+			compiled_matches++;
+		}
+	}
+	double compiled_time = now_double() - begin;
+
+	emit_input_header();
+	emit_param("Iterations", "%d", iterations);
+	emit_param("Instructions", "%d + %d", (int)compiled_reqs.NumInstructions(),
+		(int)compiled_start.NumInstructions());
+	emit_output_expected_header();
+	emit_param("Matches", "%d", iterations);
+	emit_output_actual_header();
+	emit_param("Tree matches", "%d", tree_matches);
+	emit_param("Compiled matches", "%d", compiled_matches);
+	emit_param("Tree seconds", "%.3f", tree_time);
+	emit_param("Compiled seconds", "%.3f", compiled_time);
+	if (tree_matches != iterations || compiled_matches != iterations) {
+		FAIL;
+	}
+	PASS;
+}
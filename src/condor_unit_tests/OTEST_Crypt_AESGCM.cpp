@@ -0,0 +1,282 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+/* Test the AES-GCM CEDAR cipher, which keeps its keyed cipher contexts
+   in the Condor_Crypto_State between messages.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_crypt_aesgcm.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+
+#include <openssl/evp.h>
+
+#define TEST_IV_SIZE 16
+#define TEST_MAC_SIZE 16
+
+static const unsigned char test_key[32] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f };
+
+	// helper functions
+static void fill_message(std::vector<unsigned char> &msg, int seed);
+static bool encrypt_fresh_context(StreamCryptoState &ss,
+	const unsigned char *aad, int aad_len,
+	const unsigned char *input, int input_len,
+	std::vector<unsigned char> &output);
+
+	// test functions
+static bool test_round_trip(void);
+static bool test_tampered_message(void);
+static bool test_matches_fresh_context(void);
+static bool test_throughput(void);
+
+bool OTEST_Crypt_AESGCM(void) {
+		// beginning junk
+	emit_object("Crypt_AESGCM");
+	emit_comment("The AES-GCM cipher used by CEDAR.  The cipher contexts "
+		"are keyed once per Condor_Crypto_State and reused for every "
+		"message on the stream.");
+
+		// driver to run the tests and all required setup
+	FunctionDriver driver;
+	driver.register_function(test_round_trip);
+	driver.register_function(test_tampered_message);
+	driver.register_function(test_matches_fresh_context);
+	driver.register_function(test_throughput);
+
+		// run the tests
+	return driver.do_all_functions();
+}
+
+static void fill_message(std::vector<unsigned char> &msg, int seed) {
+	for(size_t i = 0; i < msg.size(); i++) {
+		msg[i] = (unsigned char)((i * 31 + seed * 7) & 0xff);
+	}
+}
+
+	// Encrypt one message the way Condor_Crypt_AESGCM::encrypt() used to:
+	// with a newly allocated and keyed context.  Advances ss like encrypt().
+static bool encrypt_fresh_context(StreamCryptoState &ss,
+	const unsigned char *aad, int aad_len,
+	const unsigned char *input, int input_len,
+	std::vector<unsigned char> &output)
+{
+	bool sending_IV = (ss.m_ctr_enc == 0);
+	int offset = sending_IV ? TEST_IV_SIZE : 0;
+	output.resize(input_len + offset + TEST_MAC_SIZE);
+
+	uint32_t ctr = htonl(ntohl(ss.m_iv_enc.ctr.pkt) + ss.m_ctr_enc);
+	unsigned char iv[TEST_IV_SIZE];
+	memcpy(iv, &ctr, sizeof(ctr));
+	memcpy(iv + sizeof(ctr), ss.m_iv_enc.iv + sizeof(ctr), TEST_IV_SIZE - sizeof(ctr));
+	if (sending_IV) {
+		memcpy(&output[0], iv, TEST_IV_SIZE);
+	}
+
+	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+	int len = 0;
+	bool ok = ctx &&
+		1 == EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) &&
+		1 == EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, TEST_IV_SIZE, NULL) &&
+		1 == EVP_EncryptInit_ex(ctx, NULL, NULL, test_key, iv) &&
+		1 == EVP_EncryptUpdate(ctx, NULL, &len, aad, aad_len) &&
+		1 == EVP_EncryptUpdate(ctx, &output[offset], &len, input, input_len) &&
+		1 == EVP_EncryptFinal_ex(ctx, &output[offset] + len, &len) &&
+		1 == EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TEST_MAC_SIZE,
+			&output[offset + input_len]);
+	EVP_CIPHER_CTX_free(ctx);
+	if (ok) {
+		ss.m_ctr_enc++;
+	}
+	return ok;
+}
+
+static bool test_round_trip() {
+	emit_test("Do many messages encrypted on one crypto state decrypt on "
+		"another with the same key?");
+	KeyInfo key(test_key, sizeof(test_key), CONDOR_AESGCM, 0);
+	Condor_Crypto_State sender(CONDOR_AESGCM, key);
+	Condor_Crypto_State receiver(CONDOR_AESGCM, key);
+	Condor_Crypt_AESGCM crypt;
+
+	const int num_msgs = 50;
+	int failures = 0;
+	unsigned char aad[5] = { 1, 0, 0, 0, 0 };
+	for(int i = 0; i < num_msgs; i++) {
+		std::vector<unsigned char> msg(1 + i * 97);
+		fill_message(msg, i);
+		aad[4] = (unsigned char)i;
+		std::vector<unsigned char> cipher(
+			crypt.ciphertext_size_with_cs(msg.size(), &sender.m_stream_crypto_state));
+		std::vector<unsigned char> plain(cipher.size());
+		int plain_len = plain.size();
+		if (!crypt.encrypt(&sender, aad, sizeof(aad), &msg[0], msg.size(),
+				&cipher[0], cipher.size()) ||
+			!crypt.decrypt(&receiver, aad, sizeof(aad), &cipher[0], cipher.size(),
+				&plain[0], plain_len) ||
+			plain_len != (int)msg.size() ||
+			memcmp(&plain[0], &msg[0], msg.size()) != 0)
+		{
+			failures++;
+		}
+	}
+	emit_output_expected_header();
+	emit_param("Failures", "0");
+	emit_output_actual_header();
+	emit_param("Failures", "%d", failures);
+	if(failures != 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_tampered_message() {
+	emit_test("Is a tampered message rejected without disturbing the "
+		"messages after it?");
+	KeyInfo key(test_key, sizeof(test_key), CONDOR_AESGCM, 0);
+	Condor_Crypto_State sender(CONDOR_AESGCM, key);
+	Condor_Crypto_State receiver(CONDOR_AESGCM, key);
+	Condor_Crypt_AESGCM crypt;
+
+	unsigned char aad[5] = { 0, 0, 0, 0, 0 };
+	std::vector<unsigned char> msg(1000);
+	fill_message(msg, 3);
+	std::vector<unsigned char> first(
+		crypt.ciphertext_size_with_cs(msg.size(), &sender.m_stream_crypto_state));
+	crypt.encrypt(&sender, aad, sizeof(aad), &msg[0], msg.size(), &first[0], first.size());
+	std::vector<unsigned char> second(
+		crypt.ciphertext_size_with_cs(msg.size(), &sender.m_stream_crypto_state));
+	crypt.encrypt(&sender, aad, sizeof(aad), &msg[0], msg.size(), &second[0], second.size());
+
+	std::vector<unsigned char> plain(first.size());
+	int plain_len = plain.size();
+	bool first_ok = crypt.decrypt(&receiver, aad, sizeof(aad), &first[0],
+		first.size(), &plain[0], plain_len);
+
+	second[100] ^= 0x01;
+	plain_len = plain.size();
+	bool tampered_ok = crypt.decrypt(&receiver, aad, sizeof(aad), &second[0],
+		second.size(), &plain[0], plain_len);
+
+	second[100] ^= 0x01;
+	plain_len = plain.size();
+	bool second_ok = crypt.decrypt(&receiver, aad, sizeof(aad), &second[0],
+		second.size(), &plain[0], plain_len) &&
+		memcmp(&plain[0], &msg[0], msg.size()) == 0;
+
+	emit_output_expected_header();
+	emit_param("First", "TRUE");
+	emit_param("Tampered", "FALSE");
+	emit_param("Second", "TRUE");
+	emit_output_actual_header();
+	emit_param("First", "%s", tfstr(first_ok));
+	emit_param("Tampered", "%s", tfstr(tampered_ok));
+	emit_param("Second", "%s", tfstr(second_ok));
+	if(!first_ok || tampered_ok || !second_ok) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_matches_fresh_context() {
+	emit_test("Does the reused context produce the same ciphertext as a "
+		"newly keyed context for every message?");
+	KeyInfo key(test_key, sizeof(test_key), CONDOR_AESGCM, 0);
+	Condor_Crypto_State sender(CONDOR_AESGCM, key);
+	StreamCryptoState fresh = sender.m_stream_crypto_state;
+	Condor_Crypt_AESGCM crypt;
+
+	const int num_msgs = 20;
+	int mismatches = 0;
+	unsigned char aad[5] = { 0, 0, 0, 0, 0 };
+	for(int i = 0; i < num_msgs; i++) {
+		std::vector<unsigned char> msg(4096);
+		fill_message(msg, i);
+		std::vector<unsigned char> reused(
+			crypt.ciphertext_size_with_cs(msg.size(), &sender.m_stream_crypto_state));
+		std::vector<unsigned char> expected;
+		if (!crypt.encrypt(&sender, aad, sizeof(aad), &msg[0], msg.size(),
+				&reused[0], reused.size()) ||
+			!encrypt_fresh_context(fresh, aad, sizeof(aad), &msg[0], msg.size(),
+				expected) ||
+			reused != expected)
+		{
+			mismatches++;
+		}
+	}
+	emit_output_expected_header();
+	emit_param("Mismatches", "0");
+	emit_output_actual_header();
+	emit_param("Mismatches", "%d", mismatches);
+	if(mismatches != 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_throughput() {
+	emit_test("How fast are 4 KB messages encrypted with a newly keyed "
+		"context per message and with the reused context?");
+	const int num_msgs = 20000;
+	const int msg_size = 4096;
+	KeyInfo key(test_key, sizeof(test_key), CONDOR_AESGCM, 0);
+	Condor_Crypto_State sender(CONDOR_AESGCM, key);
+	StreamCryptoState fresh = sender.m_stream_crypto_state;
+	Condor_Crypt_AESGCM crypt;
+
+	unsigned char aad[5] = { 0, 0, 0, 0, 0 };
+	std::vector<unsigned char> msg(msg_size);
+	fill_message(msg, 1);
+	std::vector<unsigned char> cipher(msg_size + TEST_IV_SIZE + TEST_MAC_SIZE);
+
+	int failures = 0;
+	double starttime = now_double();
+	for(int i = 0; i < num_msgs; i++) {
+		if (!encrypt_fresh_context(fresh, aad, sizeof(aad), &msg[0], msg_size, cipher)) {
+			failures++;
+		}
+	}
+	double freshtime = now_double();
+	for(int i = 0; i < num_msgs; i++) {
+		if (!crypt.encrypt(&sender, aad, sizeof(aad), &msg[0], msg_size,
+				&cipher[0], cipher.size())) {
+			failures++;
+		}
+	}
+	double endtime = now_double();
+
+	double mbytes = (double)num_msgs * msg_size / (1024 * 1024);
+	emit_output_expected_header();
+	emit_param("Failures", "0");
+	emit_output_actual_header();
+	emit_param("Failures", "%d", failures);
+	emit_param("Per-message context MB/s", "%f", mbytes / (freshtime - starttime));
+	emit_param("Reused context MB/s", "%f", mbytes / (endtime - freshtime));
+	if(failures != 0) {
+		FAIL;
+	}
+	PASS;
+}
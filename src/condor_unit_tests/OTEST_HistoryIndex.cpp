@@ -0,0 +1,277 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+/* Test the history file index.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_classad.h"
+#include "compat_classad_util.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+#include "history_index.h"
+
+static std::string history_file;
+
+static void setup(void);
+static void cleanup(void);
+
+	// test functions
+static bool test_index_filename(void);
+static bool test_round_trip(void);
+static bool test_prev(void);
+static bool test_not_literal(void);
+static bool test_stale_index(void);
+static bool test_lower_bound(void);
+static bool test_no_lower_bound(void);
+
+bool OTEST_HistoryIndex(void) {
+		// beginning junk
+	emit_object("HistoryIndex");
+	emit_comment("The sidecar index that condor_history uses to find ads in a history file.");
+
+	setup();
+
+		// driver to run the tests and all required setup
+	FunctionDriver driver;
+	driver.register_function(test_index_filename);
+	driver.register_function(test_round_trip);
+	driver.register_function(test_prev);
+	driver.register_function(test_not_literal);
+	driver.register_function(test_stale_index);
+	driver.register_function(test_lower_bound);
+	driver.register_function(test_no_lower_bound);
+
+		// run the tests
+	bool test_passed = driver.do_all_functions();
+
+	cleanup();
+	return test_passed;
+}
+
+// write three job ads to a history file along with their index
+static void setup() {
+	formatstr(history_file, "testhistory%d", getpid());
+
+	FILE * fp = safe_fopen_wrapper_follow(history_file.c_str(), "w");
+	HistoryIndexWriter writer;
+	writer.Open(history_file.c_str(), 0);
+
+	const char * owners[] = { "alice", "bob", "alice" };
+	for (int proc = 0; proc < 3; ++proc) {
+		ClassAd ad;
+		ad.Assign("ClusterId", 10);
+		ad.Assign("ProcId", proc);
+		ad.Assign("Owner", owners[proc]);
+		ad.Assign("CompletionDate", 1000 + proc);
+		if (proc == 2) {
+			ad.AssignExpr("Owner", "strcat(\"al\", \"ice\")");
+		}
+
+		long offset = ftell(fp);
+		fPrintAd(fp, ad);
+		fprintf(fp, "*** Offset = 0 ClusterId = 10 ProcId = %d Owner = \"%s\" CompletionDate = %d\n",
+			proc, owners[proc], 1000 + proc);
+		fflush(fp);
+		writer.Append(ad, offset, ftell(fp) - offset);
+	}
+	writer.Close();
+	fclose(fp);
+}
+
+static void cleanup() {
+	std::string index_file = history_file + HISTORY_INDEX_SUFFIX;
+	unlink(history_file.c_str());
+	unlink(index_file.c_str());
+}
+
+static bool test_index_filename() {
+	emit_test("Does IsHistoryIndexFilename recognise only names ending in the index suffix?");
+	bool idx = IsHistoryIndexFilename("history.20210101T000000" HISTORY_INDEX_SUFFIX);
+	bool backup = IsHistoryIndexFilename("history.20210101T000000");
+	emit_output_expected_header();
+	emit_param("Index", "true");
+	emit_param("Backup", "false");
+	emit_output_actual_header();
+	emit_param("Index", "%s", idx ? "true" : "false");
+	emit_param("Backup", "%s", backup ? "true" : "false");
+	if ( ! idx || backup) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_round_trip() {
+	emit_test("Does the reader return the entries the writer wrote, in order, with their indexed values?");
+	HistoryIndexReader reader;
+	bool opened = reader.Open(history_file.c_str());
+	int count = 0, incomplete = 0;
+	bool contiguous = true;
+	std::string procs, owners;
+	filesize_t expected_offset = 0;
+	HistoryIndexEntry entry;
+	ClassAd ad;
+	while (opened && reader.Next(entry)) {
+		if (entry.offset != expected_offset) contiguous = false;
+		expected_offset = entry.offset + entry.length;
+		procs += entry.values[1];
+		// the last ad has an Owner expression, so it can't be made from the index
+		if (reader.MakeAd(entry, ad)) {
+			std::string owner;
+			ad.LookupString("Owner", owner);
+			owners += owner;
+		} else {
+			++incomplete;
+		}
+		++count;
+	}
+	emit_output_expected_header();
+	emit_param("Opened", "true");
+	emit_param("Count", "3");
+	emit_param("Contiguous", "true");
+	emit_param("Procs", "012");
+	emit_param("Owners", "alicebob");
+	emit_param("Incomplete", "1");
+	emit_output_actual_header();
+	emit_param("Opened", "%s", opened ? "true" : "false");
+	emit_param("Count", "%d", count);
+	emit_param("Contiguous", "%s", contiguous ? "true" : "false");
+	emit_param("Procs", "%s", procs.c_str());
+	emit_param("Owners", "%s", owners.c_str());
+	emit_param("Incomplete", "%d", incomplete);
+	if ( ! opened || count != 3 || ! contiguous || procs != "012" || owners != "alicebob" || incomplete != 1) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_prev() {
+	emit_test("Does Prev return the entries from last to first?");
+	HistoryIndexReader reader;
+	bool opened = reader.Open(history_file.c_str());
+	std::string procs;
+	HistoryIndexEntry entry;
+	while (opened && reader.Prev(entry)) {
+		procs += entry.values[1];
+	}
+	emit_output_expected_header();
+	emit_param("Procs", "210");
+	emit_output_actual_header();
+	emit_param("Procs", "%s", procs.c_str());
+	if ( ! opened || procs != "210") {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_not_literal() {
+	emit_test("Is an attribute that is not a literal marked so that the full ad will be read?");
+	HistoryIndexReader reader;
+	bool opened = reader.Open(history_file.c_str());
+	HistoryIndexEntry entry;
+	bool found = opened && reader.Prev(entry);
+	ClassAd ad;
+	bool complete = found && reader.MakeAd(entry, ad);
+	emit_output_expected_header();
+	emit_param("Found", "true");
+	emit_param("MakeAd", "false");
+	emit_output_actual_header();
+	emit_param("Found", "%s", found ? "true" : "false");
+	emit_param("MakeAd", "%s", complete ? "true" : "false");
+	if ( ! found || complete) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_stale_index() {
+	emit_test("Is an index that does not end at the end of the history file ignored?");
+	std::string stale_file = history_file + "stale";
+	std::string stale_index = stale_file + HISTORY_INDEX_SUFFIX;
+
+	// an index whose only entry ends before the end of the history file
+	FILE * fp = safe_fopen_wrapper_follow(stale_file.c_str(), "w");
+	fprintf(fp, "ClusterId = 11\n*** Offset = 0\n");
+	fclose(fp);
+	fp = safe_fopen_wrapper_follow(stale_index.c_str(), "w");
+	fprintf(fp, "HistoryIndex 1\tClusterId\n0\t10\t100\t11\n");
+	fclose(fp);
+
+	HistoryIndexReader reader;
+	bool opened = reader.Open(stale_file.c_str());
+	unlink(stale_file.c_str());
+	unlink(stale_index.c_str());
+
+	emit_output_expected_header();
+	emit_param("Opened", "false");
+	emit_output_actual_header();
+	emit_param("Opened", "%s", opened ? "true" : "false");
+	if (opened) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_lower_bound() {
+	emit_test("Is a lower bound on CompletionDate found in the top level && clauses of a constraint?");
+	classad::ExprTree * tree = NULL;
+	ParseClassAdRvalExpr("Owner == \"alice\" && (1500 <= CompletionDate) && CompletionDate > 1000 + 200", tree);
+	time_t bound = 0;
+	bool found = ConstraintCompletionDateLowerBound(tree, bound);
+	delete tree;
+	emit_output_expected_header();
+	emit_param("Found", "true");
+	emit_param("Bound", "1500");
+	emit_output_actual_header();
+	emit_param("Found", "%s", found ? "true" : "false");
+	emit_param("Bound", "%lld", (long long)bound);
+	if ( ! found || bound != 1500) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_no_lower_bound() {
+	emit_test("Are constraints that do not bound CompletionDate from below rejected?");
+	const char * constraints[] = {
+		"CompletionDate < 1500",
+		"Owner == \"alice\" || CompletionDate > 1500",
+		"CompletionDate > QDate",
+	};
+	int found = 0;
+	for (size_t ix = 0; ix < COUNTOF(constraints); ++ix) {
+		classad::ExprTree * tree = NULL;
+		ParseClassAdRvalExpr(constraints[ix], tree);
+		time_t bound = 0;
+		if (ConstraintCompletionDateLowerBound(tree, bound)) ++found;
+		delete tree;
+	}
+	emit_output_expected_header();
+	emit_param("Found", "0");
+	emit_output_actual_header();
+	emit_param("Found", "%d", found);
+	if (found) {
+		FAIL;
+	}
+	PASS;
+}
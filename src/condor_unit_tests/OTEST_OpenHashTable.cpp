@@ -0,0 +1,394 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+/* Test the OpenHashTable implementation, and compare its speed and size
+   with HashTable.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "OpenHashTable.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+
+#include <set>
+#include <vector>
+
+	// a key shaped like the job queue's JOB_ID_KEY
+struct TestJobKey {
+	int cluster;
+	int proc;
+	TestJobKey() : cluster(0), proc(0) {}
+	TestJobKey(int c, int p) : cluster(c), proc(p) {}
+	bool operator==(const TestJobKey &rhs) const {
+		return cluster == rhs.cluster && proc == rhs.proc;
+	}
+};
+
+	// helper functions
+static size_t intHash(const int &myInt);
+static size_t jobKeyHash(const TestJobKey &key);
+
+	// test functions
+static bool test_insert_lookup_remove(void);
+static bool test_update(void);
+static bool test_remove_while_iterating(void);
+static bool test_concurrent_iterators(void);
+static bool test_iterator_entry_removed(void);
+static bool test_iterator_full_table(void);
+static bool test_copy(void);
+static bool test_benchmark_job_keys(void);
+static bool test_benchmark_string_keys(void);
+
+bool OTEST_OpenHashTable(void) {
+		// beginning junk
+	emit_object("OpenHashTable");
+	emit_comment("An open addressing hash table with the same interface as "
+		"HashTable, used for the collector ad tables and DAGMan node names.");
+
+		// driver to run the tests and all required setup
+	FunctionDriver driver;
+	driver.register_function(test_insert_lookup_remove);
+	driver.register_function(test_update);
+	driver.register_function(test_remove_while_iterating);
+	driver.register_function(test_concurrent_iterators);
+	driver.register_function(test_iterator_entry_removed);
+	driver.register_function(test_iterator_full_table);
+	driver.register_function(test_copy);
+	driver.register_function(test_benchmark_job_keys);
+	driver.register_function(test_benchmark_string_keys);
+
+		// run the tests
+	return driver.do_all_functions();
+}
+
+static size_t intHash(const int &myInt) {
+	return myInt;
+}
+
+static size_t jobKeyHash(const TestJobKey &key) {
+	return (size_t)key.cluster * 1013 + key.proc;
+}
+
+static bool test_insert_lookup_remove() {
+	emit_test("Are inserted entries found, and removed entries not found, "
+		"as the table grows and is filled with tombstones?");
+	OpenHashTable<int, int> table(intHash);
+	int errors = 0;
+	for (int i = 0; i < 10000; i++) {
+		if (table.insert(i, i * 2) != 0) errors++;
+	}
+	if (table.insert(5, 0) != -1) errors++;
+	for (int i = 0; i < 10000; i += 2) {
+		if (table.remove(i) != 0) errors++;
+	}
+	if (table.remove(0) != -1) errors++;
+	for (int i = 0; i < 10000; i++) {
+		int value = -1;
+		int rval = table.lookup(i, value);
+		if ((i % 2) ? (rval != 0 || value != i * 2) : (rval != -1)) errors++;
+		if (table.exists(i) != rval) errors++;
+	}
+	emit_output_expected_header();
+	emit_param("Errors", "0");
+	emit_param("numElems", "5000");
+	emit_output_actual_header();
+	emit_param("Errors", "%d", errors);
+	emit_param("numElems", "%d", table.getNumElements());
+	if (errors != 0 || table.getNumElements() != 5000) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_update() {
+	emit_test("Does insert() with update replace the value of an existing "
+		"key, and lookup() of a pointer change it in place?");
+	OpenHashTable<int, int> table(intHash);
+	table.insert(7, 1);
+	int rval = table.insert(7, 2, true);
+	int *pval = NULL;
+	table.lookup(7, pval);
+	if (pval) *pval = 3;
+	int value = -1;
+	table.lookup(7, value);
+	emit_output_expected_header();
+	emit_param("insert()'s RETURN", "0");
+	emit_param("Value", "3");
+	emit_param("numElems", "1");
+	emit_output_actual_header();
+	emit_param("insert()'s RETURN", "%d", rval);
+	emit_param("Value", "%d", value);
+	emit_param("numElems", "%d", table.getNumElements());
+	if (rval != 0 || value != 3 || table.getNumElements() != 1) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_remove_while_iterating() {
+	emit_test("Does iterate() visit every entry once when the current entry "
+		"is removed during the iteration?");
+	OpenHashTable<int, int> table(intHash);
+	for (int i = 0; i < 1000; i++) {
+		table.insert(i, i);
+	}
+	int visited = 0;
+	int key, value;
+	table.startIterations();
+	while (table.iterate(key, value)) {
+		visited++;
+		table.remove(key);
+	}
+	emit_output_expected_header();
+	emit_param("Visited", "1000");
+	emit_param("numElems", "0");
+	emit_output_actual_header();
+	emit_param("Visited", "%d", visited);
+	emit_param("numElems", "%d", table.getNumElements());
+	if (visited != 1000 || table.getNumElements() != 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_concurrent_iterators() {
+	emit_test("Do two iterators and startIterations() walk the table "
+		"independently of each other?");
+	OpenHashTable<int, int> table(intHash);
+	for (int i = 0; i < 500; i++) {
+		table.insert(i, i);
+	}
+	int outer = 0, inner = 0, cursor = 0;
+	int value;
+	table.startIterations();
+	for (OpenHashTable<int, int>::iterator it = table.begin(); it != table.end(); ++it) {
+		outer++;
+		if (table.iterate(value)) cursor++;
+		if (outer == 250) {
+			for (OpenHashTable<int, int>::iterator it2 = table.begin(); it2 != table.end(); ++it2) {
+				inner++;
+			}
+		}
+	}
+	emit_output_expected_header();
+	emit_param("Outer", "500");
+	emit_param("Inner", "500");
+	emit_param("Cursor", "500");
+	emit_output_actual_header();
+	emit_param("Outer", "%d", outer);
+	emit_param("Inner", "%d", inner);
+	emit_param("Cursor", "%d", cursor);
+	if (outer != 500 || inner != 500 || cursor != 500) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_iterator_entry_removed() {
+	emit_test("Does an iterator whose entry is removed move to an entry it "
+		"has not seen yet?");
+	OpenHashTable<int, int> table(intHash);
+	for (int i = 0; i < 100; i++) {
+		table.insert(i, i);
+	}
+	std::set<int> seen;
+	int duplicates = 0;
+	OpenHashTable<int, int>::iterator it = table.begin();
+	while (it != table.end()) {
+		int key = (*it).first;
+		if ( ! seen.insert(key).second) duplicates++;
+		table.remove(key);
+	}
+	emit_output_expected_header();
+	emit_param("Seen", "100");
+	emit_param("Duplicates", "0");
+	emit_output_actual_header();
+	emit_param("Seen", "%d", (int)seen.size());
+	emit_param("Duplicates", "%d", duplicates);
+	if (seen.size() != 100 || duplicates != 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_iterator_full_table() {
+	emit_test("Does an iterator keep its entry when inserts fill the table "
+		"and force it to grow?");
+	OpenHashTable<int, int> table(intHash);
+	table.insert(-1, -1);
+	OpenHashTable<int, int>::iterator it = table.begin();
+	int size_before = table.getTableSize();
+	int errors = 0;
+	for (int i = 0; i < 1000; i++) {
+		if (table.insert(i, i) != 0) errors++;
+		if ((*it).first != -1) errors++;
+	}
+	for (int i = -1; i < 1000; i++) {
+		if (table.exists(i) != 0) errors++;
+	}
+	emit_output_expected_header();
+	emit_param("Errors", "0");
+	emit_param("Grew", "TRUE");
+	emit_output_actual_header();
+	emit_param("Errors", "%d", errors);
+	emit_param("Grew", "%s", tfstr(table.getTableSize() > size_before));
+	if (errors != 0 || table.getTableSize() <= size_before) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_copy() {
+	emit_test("Is a copy of the table independent of the original?");
+	OpenHashTable<int, int> table(intHash);
+	for (int i = 0; i < 100; i++) {
+		table.insert(i, i);
+	}
+	OpenHashTable<int, int> copy(table);
+	OpenHashTable<int, int> assigned(intHash);
+	assigned = table;
+	table.remove(10);
+	copy.insert(10, 20, true);
+	int value = -1;
+	copy.lookup(10, value);
+	emit_output_expected_header();
+	emit_param("Original", "99");
+	emit_param("Copy", "100");
+	emit_param("Assigned", "100");
+	emit_param("Copy value", "20");
+	emit_output_actual_header();
+	emit_param("Original", "%d", table.getNumElements());
+	emit_param("Copy", "%d", copy.getNumElements());
+	emit_param("Assigned", "%d", assigned.getNumElements());
+	emit_param("Copy value", "%d", value);
+	if (table.getNumElements() != 99 || copy.getNumElements() != 100 ||
+		assigned.getNumElements() != 100 || value != 20 || assigned.exists(10) != 0)
+	{
+		FAIL;
+	}
+	PASS;
+}
+
+	// insert the keys in order, look them up in a scattered order, iterate
+	// over them and then remove them, returning the time each of those took
+	// in ns per key, and the bytes per key used by the table itself.
+template <class Table, class Key>
+static bool time_table(Table &table, const std::vector<Key> &keys, double ns[4])
+{
+	bool ok = true;
+	int num = (int)keys.size();
+	double times[5];
+	times[0] = now_double();
+	for (int i = 0; i < num; i++) {
+		ok = (table.insert(keys[i], (void*)(intptr_t)(i + 1)) == 0) && ok;
+	}
+	times[1] = now_double();
+	void *value = NULL;
+	for (int j = 0; j < num; j++) {
+		int i = (int)(((long long)j * 7919) % num);
+		ok = (table.lookup(keys[i], value) == 0 && value == (void*)(intptr_t)(i + 1)) && ok;
+	}
+	times[2] = now_double();
+	int count = 0;
+	table.startIterations();
+	while (table.iterate(value)) {
+		count++;
+	}
+	times[3] = now_double();
+	for (int j = 0; j < num; j++) {
+		int i = (int)(((long long)j * 7919) % num);
+		ok = (table.remove(keys[i]) == 0) && ok;
+	}
+	times[4] = now_double();
+	for (int i = 0; i < 4; i++) {
+		ns[i] = (times[i+1] - times[i]) * 1e9 / num;
+	}
+	return ok && count == num && table.getNumElements() == 0;
+}
+
+template <class Key>
+static bool compare_tables(const std::vector<Key> &keys, size_t (*hashfcn)(const Key &))
+{
+	emit_comment("Times are in ns per key.  HashTable memory does not count "
+		"the malloc overhead of each HashBucket, neither one counts memory "
+		"the keys point to.");
+	static const char * const ops[4] = { "insert", "lookup", "iterate", "remove" };
+	double chained_ns[4], open_ns[4];
+	double chained_bytes, open_bytes;
+	bool chained_ok, open_ok;
+	{
+		HashTable<Key, void*> chained(hashfcn);
+		chained_ok = time_table(chained, keys, chained_ns);
+		chained_bytes = (double)chained.getTableSize() * sizeof(void*) / keys.size() +
+			sizeof(HashBucket<Key, void*>);
+	}
+	{
+		OpenHashTable<Key, void*> open(hashfcn);
+		open_ok = time_table(open, keys, open_ns);
+		open_bytes = (double)open.getTableSize() * (sizeof(Key) + sizeof(void*) + 1) / keys.size();
+	}
+
+	emit_output_expected_header();
+	emit_param("HashTable OK", "TRUE");
+	emit_param("OpenHashTable OK", "TRUE");
+	emit_output_actual_header();
+	emit_param("HashTable OK", "%s", tfstr(chained_ok));
+	emit_param("OpenHashTable OK", "%s", tfstr(open_ok));
+	for (int i = 0; i < 4; i++) {
+		emit_param(ops[i], "HashTable %.1f, OpenHashTable %.1f", chained_ns[i], open_ns[i]);
+	}
+	emit_param("bytes per key", "HashTable %.1f, OpenHashTable %.1f", chained_bytes, open_bytes);
+	return chained_ok && open_ok;
+}
+
+static bool test_benchmark_job_keys() {
+	emit_test("How long do insert, lookup, iterate and remove take for 1 "
+		"million job ids in HashTable and OpenHashTable, and how much memory "
+		"does each use?");
+	emit_comment("Job ids are inserted in order, which HashTable handles "
+		"well, so the job queue and other integer keyed tables stay on it.");
+	std::vector<TestJobKey> keys;
+	for (int i = 0; i < 1000000; i++) {
+		keys.push_back(TestJobKey(1 + i / 100, i % 100));
+	}
+	if ( ! compare_tables(keys, jobKeyHash)) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_benchmark_string_keys() {
+	emit_test("How long do insert, lookup, iterate and remove take for 1 "
+		"million slot names in HashTable and OpenHashTable, and how much "
+		"memory does each use?");
+	std::vector<MyString> keys;
+	for (int i = 0; i < 1000000; i++) {
+		MyString name;
+		name.formatstr("slot%d@exec%06d.example.org", 1 + i % 8, i / 8);
+		keys.push_back(name);
+	}
+	size_t (*hashfcn)(const MyString &) = hashFunction;
+	if ( ! compare_tables(keys, hashfcn)) {
+		FAIL;
+	}
+	PASS;
+}
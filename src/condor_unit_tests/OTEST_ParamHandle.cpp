@@ -0,0 +1,131 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+/* Test the cached param handles and the param lookup counter.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+
+static param_bool_handle test_bool_knob("UNIT_TEST_PARAM_HANDLE_BOOL", true);
+static param_int_handle test_int_knob("UNIT_TEST_PARAM_HANDLE_INT", 7, 0, 100);
+static param_double_handle test_double_knob("UNIT_TEST_PARAM_HANDLE_DOUBLE", 0.5);
+
+	// test functions
+static bool test_defaults(void);
+static bool test_param_insert_refreshes(void);
+static bool test_live_value_refreshes(void);
+static bool test_get_does_not_lookup(void);
+
+bool OTEST_ParamHandle(void) {
+		// beginning junk
+	emit_object("ParamHandle");
+	emit_comment("Typed param handles that cache the parsed value of a config knob.");
+
+		// driver to run the tests and all required setup
+	FunctionDriver driver;
+	driver.register_function(test_defaults);
+	driver.register_function(test_param_insert_refreshes);
+	driver.register_function(test_live_value_refreshes);
+	driver.register_function(test_get_does_not_lookup);
+
+		// run the tests
+	return driver.do_all_functions();
+}
+
+static bool test_defaults() {
+	emit_test("Do handles for knobs that are not set return their defaults?");
+	bool bval = test_bool_knob.get();
+	int ival = test_int_knob.get();
+	double dval = test_double_knob.get();
+	emit_output_expected_header();
+	emit_param("Bool", "true");
+	emit_param("Int", "7");
+	emit_param("Double", "0.5");
+	emit_output_actual_header();
+	emit_param("Bool", "%s", bval ? "true" : "false");
+	emit_param("Int", "%d", ival);
+	emit_param("Double", "%g", dval);
+	if ( ! bval || ival != 7 || fabs(dval - 0.5) > 1e-9) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_param_insert_refreshes() {
+	emit_test("Does param_insert update the handles for that knob?");
+	param_insert("UNIT_TEST_PARAM_HANDLE_BOOL", "false");
+	param_insert("UNIT_TEST_PARAM_HANDLE_INT", "42");
+	bool bval = test_bool_knob.get();
+	int ival = test_int_knob.get();
+	emit_output_expected_header();
+	emit_param("Bool", "false");
+	emit_param("Int", "42");
+	emit_output_actual_header();
+	emit_param("Bool", "%s", bval ? "true" : "false");
+	emit_param("Int", "%d", ival);
+	if (bval || ival != 42) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_live_value_refreshes() {
+	emit_test("Does set_live_param_value update the handle, and does putting the old value back restore it?");
+	const char * old_value = set_live_param_value("UNIT_TEST_PARAM_HANDLE_DOUBLE", "2.25");
+	double live = test_double_knob.get();
+	set_live_param_value("UNIT_TEST_PARAM_HANDLE_DOUBLE", old_value);
+	double restored = test_double_knob.get();
+	emit_output_expected_header();
+	emit_param("Live", "2.25");
+	emit_param("Restored", "0.5");
+	emit_output_actual_header();
+	emit_param("Live", "%g", live);
+	emit_param("Restored", "%g", restored);
+	if (fabs(live - 2.25) > 1e-9 || fabs(restored - 0.5) > 1e-9) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_get_does_not_lookup() {
+	emit_test("Does get() read the cached value without a param lookup, while param() is counted?");
+	unsigned int before = param_lookup_count();
+	for (int ii = 0; ii < 100; ++ii) {
+		(void)test_int_knob.get();
+	}
+	unsigned int after_get = param_lookup_count();
+	(void)param_integer("UNIT_TEST_PARAM_HANDLE_INT", 7);
+	unsigned int after_param = param_lookup_count();
+	emit_output_expected_header();
+	emit_param("Lookups by get()", "0");
+	emit_param("Lookups by param_integer()", "1");
+	emit_output_actual_header();
+	emit_param("Lookups by get()", "%u", after_get - before);
+	emit_param("Lookups by param_integer()", "%u", after_param - after_get);
+	if (after_get != before || after_param - after_get != 1) {
+		FAIL;
+	}
+	PASS;
+}
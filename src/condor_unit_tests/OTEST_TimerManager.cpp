@@ -0,0 +1,210 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+/* Test the DaemonCore TimerManager outside of a running daemon.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_daemon_core.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+
+static std::string fired;
+
+	// helper functions
+static void handler_a() { fired += 'a'; }
+static void handler_b() { fired += 'b'; }
+static void handler_c() { fired += 'c'; }
+static void handler_add_due() {
+	fired += 'd';
+	TimerManager::GetTimerManager().NewTimer(0, handler_c, "handler_c");
+}
+
+	// test functions
+static bool test_fire_order(void);
+static bool test_timer_never(void);
+static bool test_reset_and_cancel(void);
+static bool test_added_while_firing(void);
+static bool test_insert_cancel_timing(void);
+
+bool OTEST_TimerManager(void) {
+		// beginning junk
+	emit_object("TimerManager");
+	emit_comment("The timer queue used by DaemonCore.  These tests run without "
+		"a daemonCore object, so only the queue itself is exercised.");
+
+		// driver to run the tests and all required setup
+	FunctionDriver driver;
+	driver.register_function(test_fire_order);
+	driver.register_function(test_timer_never);
+	driver.register_function(test_reset_and_cancel);
+	driver.register_function(test_added_while_firing);
+	driver.register_function(test_insert_cancel_timing);
+
+		// run the tests
+	return driver.do_all_functions();
+}
+
+static bool test_fire_order() {
+	emit_test("Do due timers fire in order of when, then in order of insertion?");
+	TimerManager &tm = TimerManager::GetTimerManager();
+	tm.CancelAllTimers();
+	fired.clear();
+	int id_b = tm.NewTimer(0, handler_b, "handler_b");
+	tm.NewTimer(0, handler_c, "handler_c");
+	tm.NewTimer(1000, handler_a, "handler_a");
+		// move b behind c, as if it had reset itself to zero
+	tm.ResetTimer(id_b, 0);
+	int num_fired = 0;
+	int next = tm.Timeout(&num_fired);
+	emit_output_expected_header();
+	emit_param("Fired", "cb");
+	emit_param("Next", "> 0");
+	emit_output_actual_header();
+	emit_param("Fired", "%s", fired.c_str());
+	emit_param("Next", "%d", next);
+	tm.CancelAllTimers();
+	if(fired != "cb" || num_fired != 2 || next <= 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_timer_never() {
+	emit_test("Does a TIMER_NEVER timer stay queued without firing?");
+	TimerManager &tm = TimerManager::GetTimerManager();
+	tm.CancelAllTimers();
+	fired.clear();
+	int id = tm.NewTimer(TIMER_NEVER, handler_a, "handler_a");
+	tm.NewTimer(0, handler_b, "handler_b", TIMER_NEVER);
+	tm.Timeout();
+	time_t never_when = tm.GetNextRuntime(id);
+	emit_output_expected_header();
+	emit_param("Fired", "b");
+	emit_param("GetNextRuntime", "%ld", (long)TIME_T_NEVER);
+	emit_output_actual_header();
+	emit_param("Fired", "%s", fired.c_str());
+	emit_param("GetNextRuntime", "%ld", (long)never_when);
+	int cancel_result = tm.CancelTimer(id);
+	tm.CancelAllTimers();
+	if(fired != "b" || never_when != TIME_T_NEVER || cancel_result != 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_reset_and_cancel() {
+	emit_test("Do ResetTimer() and CancelTimer() reorder and remove timers?");
+	TimerManager &tm = TimerManager::GetTimerManager();
+	tm.CancelAllTimers();
+	fired.clear();
+	int id_a = tm.NewTimer(1000, handler_a, "handler_a");
+	int id_b = tm.NewTimer(0, handler_b, "handler_b");
+	int id_c = tm.NewTimer(2000, handler_c, "handler_c");
+	tm.ResetTimer(id_a, 0);
+	tm.ResetTimer(id_b, 500);
+	int cancel_c = tm.CancelTimer(id_c);
+	int cancel_again = tm.CancelTimer(id_c);
+	tm.Timeout();
+	emit_output_expected_header();
+	emit_param("Fired", "a");
+	emit_param("CancelTimer()", "0, then -1");
+	emit_output_actual_header();
+	emit_param("Fired", "%s", fired.c_str());
+	emit_param("CancelTimer()", "%d, then %d", cancel_c, cancel_again);
+	bool b_queued = tm.GetNextRuntime(id_b) != 0;
+	bool a_gone = tm.GetNextRuntime(id_a) == 0;
+	tm.CancelAllTimers();
+	if(fired != "a" || cancel_c != 0 || cancel_again != -1 || !b_queued || !a_gone) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_added_while_firing() {
+	emit_test("Is a due timer registered by a handler deferred to the next Timeout()?");
+	TimerManager &tm = TimerManager::GetTimerManager();
+	tm.CancelAllTimers();
+	fired.clear();
+	tm.NewTimer(0, handler_add_due, "handler_add_due");
+	tm.NewTimer(0, handler_a, "handler_a");
+	int next = tm.Timeout();
+	std::string first = fired;
+	tm.Timeout();
+	emit_output_expected_header();
+	emit_param("First Timeout()", "da");
+	emit_param("Second Timeout()", "dac");
+	emit_param("Next", "0");
+	emit_output_actual_header();
+	emit_param("First Timeout()", "%s", first.c_str());
+	emit_param("Second Timeout()", "%s", fired.c_str());
+	emit_param("Next", "%d", next);
+	tm.CancelAllTimers();
+	if(first != "da" || fired != "dac" || next != 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_insert_cancel_timing() {
+	emit_test("How long does it take to insert, reset and cancel one million timers?");
+	const int num_timers = 1000000;
+	TimerManager &tm = TimerManager::GetTimerManager();
+	tm.CancelAllTimers();
+	std::vector<int> ids;
+	ids.reserve(num_timers);
+		// a cheap deterministic LCG, so runs are comparable
+	unsigned int rnd = 12345;
+	double starttime = now_double();
+	for(int i = 0; i < num_timers; i++) {
+		rnd = rnd * 1103515245 + 12345;
+		ids.push_back(tm.NewTimer(60 + (rnd >> 8) % 86400, handler_a, "bench"));
+	}
+	double inserttime = now_double();
+	for(int i = 0; i < num_timers; i += 2) {
+		rnd = rnd * 1103515245 + 12345;
+		tm.ResetTimer(ids[i], 60 + (rnd >> 8) % 86400);
+	}
+	double resettime = now_double();
+	int failures = 0;
+	for(int i = 0; i < num_timers; i++) {
+		rnd = rnd * 1103515245 + 12345;
+		int j = i + (rnd >> 8) % (num_timers - i);
+		std::swap(ids[i], ids[j]);
+		if(tm.CancelTimer(ids[i]) != 0) {
+			failures++;
+		}
+	}
+	double endtime = now_double();
+	emit_output_expected_header();
+	emit_param("Cancel failures", "0");
+	emit_output_actual_header();
+	emit_param("Cancel failures", "%d", failures);
+	emit_param("Insert Time", "%f", inserttime - starttime);
+	emit_param("Reset Time", "%f", resettime - inserttime);
+	emit_param("Cancel Time", "%f", endtime - resettime);
+	if(failures != 0) {
+		FAIL;
+	}
+	PASS;
+}
@@ -454,6 +454,13 @@ void create_empty_file(const char *file)
 	cut_assert_z( fclose(f) );
 }
 
+double now_double()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
 #ifdef WIN32
 int gettimeofday(struct timeval *tv, struct ttimezone *tz)
 {
@@ -198,6 +198,9 @@ void cut_assert_null_impl(void *value, const char *expr, const char *file, int l
 /* Creates an empty file */
 void create_empty_file(const char *file);
 
+/* Returns the current time in seconds, for timing tests */
+double now_double();
+
 #ifdef WIN32
 #if defined(_MSC_VER) || defined(_MSC_EXTENSIONS)
   #define DELTA_EPOCH_IN_MICROSECS  11644473600000000Ui64
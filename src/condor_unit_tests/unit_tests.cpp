@@ -63,6 +63,13 @@ bool OTEST_TmpDir(void);
 bool OTEST_StatInfo(void);
 bool OTEST_condor_sockaddr();
 bool OTEST_ranger();
+bool OTEST_TimerManager(void);
+bool OTEST_CompiledExpr(void);
+bool OTEST_ClassAdBinary(void);
+bool OTEST_Crypt_AESGCM(void);
+bool OTEST_OpenHashTable(void);
+bool OTEST_ParamHandle(void);
+bool OTEST_HistoryIndex(void);
 
 	// function map that maps testing function names to testing functions
 const static struct {
@@ -98,6 +105,13 @@ const static struct {
 	map(OTEST_StatInfo),
 	map(OTEST_condor_sockaddr),
 	map(OTEST_ranger),
+	map(OTEST_TimerManager),
+	map(OTEST_CompiledExpr),
+	map(OTEST_ClassAdBinary),
+	map(OTEST_Crypt_AESGCM),
+	map(OTEST_OpenHashTable),
+	map(OTEST_ParamHandle),
+	map(OTEST_HistoryIndex),
 };
 int function_map_num_elems = sizeof(function_map) / sizeof(function_map[0]);
 
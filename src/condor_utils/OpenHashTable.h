@@ -0,0 +1,618 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef OPEN_HASH_H
+#define OPEN_HASH_H
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "HashTable.h"
+
+#include <utility>
+#include <vector>
+
+// An open addressing (linear probing) hash table with the same interface
+// as HashTable<Index,Value>.  Entries live in one flat array of slots, so
+// there is no allocation per entry and a lookup usually touches a single
+// cache line of slots.  A parallel array holds one control byte per slot,
+// which is either empty, deleted, or 7 bits of the key's hash, so most
+// probes that would miss never have to compare keys.
+//
+// Removing an entry leaves a deleted marker (a tombstone) behind and never
+// moves other entries, so iterators and the startIterations() cursor stay
+// valid across remove().  Growing the table moves every entry, so it is
+// put off while any iterator is alive, unless the table is completely
+// full.  A pointer returned by lookup(Index, Value*&) is good until the
+// next insert().
+//
+// Index and Value must be default constructible and assignable, and Index
+// must be a class on which == works.
+
+template <class Index, class Value> class OpenHashTable;
+
+template< class Index, class Value >
+class OpenHashIterator : std::iterator<std::input_iterator_tag, std::pair<Index, Value> >
+{
+public:
+	OpenHashIterator(const OpenHashIterator &original)
+		: m_parent(original.m_parent), m_idx(original.m_idx)
+	{
+		m_parent->register_iterator(this);
+	}
+
+	OpenHashIterator & operator=(const OpenHashIterator &rhs) {
+		if (m_parent != rhs.m_parent) {
+			m_parent->remove_iterator(this);
+			m_parent = rhs.m_parent;
+			m_parent->register_iterator(this);
+		}
+		m_idx = rhs.m_idx;
+		return *this;
+	}
+
+	~OpenHashIterator() {
+		m_parent->remove_iterator(this);
+	}
+
+	std::pair<Index, Value> operator *() const {
+		if (m_idx < 0) { return std::pair<Index, Value>(Index(), Value()); }
+		return std::pair<Index, Value>(m_parent->m_slots[m_idx].index, m_parent->m_slots[m_idx].value);
+	}
+
+	std::pair<Index, Value> operator ->() const {
+		return **this;
+	}
+
+	/*
+	 * Move the iterator forward by one entry in the hashtable.
+	 * Unlike the '++' operator, this has no side-effects outside
+	 * this object.
+	 */
+	void advance() {
+		if (m_idx < 0) { return; }
+		m_idx = m_parent->next_full_slot(m_idx + 1);
+	}
+
+	OpenHashIterator & operator++() {
+		advance();
+		return *this;
+	}
+
+	OpenHashIterator operator++(int) {
+		// Note the copy constructor has the side-effect of
+		// registering a new iterator with the parent.  Do not
+		// call this from within the parent table itself.
+		OpenHashIterator<Index,Value> result = *this;
+		advance();
+		return result;
+	}
+
+	bool operator==(const OpenHashIterator &rhs) const {
+		return m_parent == rhs.m_parent && m_idx == rhs.m_idx;
+	}
+	bool operator!=(const OpenHashIterator &rhs) const { return !(*this == rhs); }
+
+private:
+	friend class OpenHashTable<Index, Value>;
+
+	OpenHashIterator(OpenHashTable<Index, Value> *parent, int idx)
+	  : m_parent(parent), m_idx(idx)
+	{
+		if (m_idx >= 0) { m_idx = m_parent->next_full_slot(m_idx); }
+		m_parent->register_iterator(this);
+	}
+
+	OpenHashTable<Index, Value> *m_parent;
+	int m_idx; // slot of the current entry, -1 at the end
+};
+
+template <class Index, class Value>
+class OpenHashTable {
+ public:
+  typedef OpenHashIterator<Index, Value> iterator;
+  friend class OpenHashIterator<Index, Value>;
+
+  OpenHashTable( size_t (*hashfcn)( const Index &index ) );
+  OpenHashTable( const OpenHashTable &copy);
+  const OpenHashTable& operator=(const OpenHashTable &copy);
+  ~OpenHashTable();
+
+  int insert(const Index &index, const Value &value, bool update = false);
+  int lookup(const Index &index, Value &value) const;
+  int lookup(const Index &index, Value* &value) const;
+	  // returns 0 if exists, -1 otherwise
+  int exists(const Index &index) const;
+  int remove(const Index &index);
+  int getNumElements( ) const { return numElems; }
+  int getTableSize( ) const { return tableSize; }
+  int clear();
+
+  void startIterations (void);
+  int  iterate (Value &value);
+  int  getCurrentKey (Index &index);
+  int  iterate (Index &index, Value &value);
+  int  iterate_nocopy(const Index ** pindex, Value ** pvalue);
+	  // ix_bucket is set to the slot of each entry and ix_item to how far
+	  // that slot is from the one the entry hashes to.
+  int  iterate_stats(int & ix_bucket, int & ix_item);
+
+	  // each iterator has its own position, so any number of them may be
+	  // used at once, along with startIterations()/iterate().
+  iterator begin() {return iterator(this, 0);}
+  iterator end() {return iterator(this, -1);}
+
+  /*
+  Walk the table, calling walkfunc() on every member.
+  If walkfunc() ever returns zero, the walk is stopped.
+  Returns true if all walkfuncs() succeed, false
+  if stopped. Walk() is provided so that multiple walks
+  can be done even if a startIterations() is in progress.
+  */
+  int walk( int (*walkfunc) ( Value value ) );
+
+ private:
+  struct Slot {
+    Index index;
+    Value value;
+  };
+  enum { SLOT_EMPTY = 0x80, SLOT_DELETED = 0xFE, MIN_TABLE_SIZE = 8 };
+
+  void register_iterator(iterator* it);
+  void remove_iterator(iterator* it);
+
+  void copy_deep(const OpenHashTable<Index, Value> &copy);
+  uint64_t hash_of(const Index &index) const { return (uint64_t)hashfcn(index); }
+  static int home_slot(uint64_t h, int mask);
+  static unsigned char tag_of(uint64_t h) { return (unsigned char)((h * 0x9e3779b97f4a7c15ULL) >> 57); }
+  int find_slot(const Index &index) const;
+  int next_full_slot(int idx) const;
+  int needs_resizing(bool forced = false) const;
+  void resize_hash_table(int newsize = -1);
+
+  int tableSize;                 // number of slots, always a power of 2
+  int numElems;                  // number of entries in the table
+  int numDeleted;                // number of tombstones in the table
+  unsigned char *ctrl;           // SLOT_EMPTY, SLOT_DELETED or a hash tag
+  Slot *m_slots;
+  size_t (*hashfcn)(const Index &index);  // user-provided hash function
+  int currentSlot;               // startIterations() cursor, -1 if none
+  std::vector<iterator*> activeIterators;
+};
+
+template <class Index, class Value>
+OpenHashTable<Index,Value>::OpenHashTable( size_t (*hashF)( const Index &index ) )
+	: tableSize(MIN_TABLE_SIZE), numElems(0), numDeleted(0)
+	, hashfcn(hashF), currentSlot(-1)
+{
+  // You MUST specify a hash function.
+  ASSERT(hashfcn != 0);
+
+  ctrl = new unsigned char[tableSize];
+  memset(ctrl, SLOT_EMPTY, tableSize);
+  m_slots = new Slot[tableSize];
+}
+
+template <class Index, class Value>
+OpenHashTable<Index,Value>::OpenHashTable( const OpenHashTable<Index,Value>& copy ) {
+  copy_deep(copy);
+}
+
+template <class Index, class Value>
+const OpenHashTable<Index,Value>& OpenHashTable<Index,Value>::operator=( const OpenHashTable<Index,Value>& copy ) {
+  if (this != &copy) {
+    clear();
+    delete [] ctrl;
+    delete [] m_slots;
+    copy_deep(copy);
+  }
+  return *this;
+}
+
+template <class Index, class Value>
+OpenHashTable<Index,Value>::~OpenHashTable()
+{
+  delete [] ctrl;
+  delete [] m_slots;
+}
+
+template <class Index, class Value>
+void
+OpenHashTable<Index,Value>::register_iterator(iterator* it) {
+	activeIterators.push_back(it);
+}
+
+template <class Index, class Value>
+void
+OpenHashTable<Index,Value>::remove_iterator(iterator* dead_it) {
+	for (typename std::vector<iterator*>::iterator it = activeIterators.begin();
+		it != activeIterators.end();
+		++it)
+	{
+		if (dead_it == *it) {
+			activeIterators.erase(it);
+			break;
+		}
+	}
+	if (needs_resizing()) {
+		resize_hash_table();
+	}
+}
+
+// Copy the slots, but not the iterators (they belong to the other table).
+template <class Index, class Value>
+void OpenHashTable<Index,Value>::copy_deep( const OpenHashTable<Index,Value>& copy ) {
+  tableSize = copy.tableSize;
+  numElems = copy.numElems;
+  numDeleted = copy.numDeleted;
+  hashfcn = copy.hashfcn;
+  currentSlot = copy.currentSlot;
+  ctrl = new unsigned char[tableSize];
+  memcpy(ctrl, copy.ctrl, tableSize);
+  m_slots = new Slot[tableSize];
+  for (int i = 0; i < tableSize; i++) {
+    if ( ! (ctrl[i] & 0x80)) {
+      m_slots[i] = copy.m_slots[i];
+    }
+  }
+}
+
+// The hash functions in HashTable.h are not very random in their low bits
+// (hashFuncInt returns its argument), which would make long runs of full
+// slots, so mix all of the bits into the ones used to pick the slot.  The
+// tag is taken from the high bits of a multiplicative hash of the value.
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::home_slot(uint64_t h, int mask)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (int)(h & (uint64_t)mask);
+}
+
+// Returns the slot holding index, or -1.
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::find_slot(const Index &index) const
+{
+  if (numElems == 0) {
+    return -1;
+  }
+  uint64_t h = hash_of(index);
+  unsigned char tag = tag_of(h);
+  int mask = tableSize - 1;
+  for (int idx = home_slot(h, mask); ; idx = (idx + 1) & mask) {
+    unsigned char c = ctrl[idx];
+    if (c == tag && m_slots[idx].index == index) {
+      return idx;
+    }
+    if (c == SLOT_EMPTY) {
+      return -1;
+    }
+  }
+}
+
+// Returns the first slot at or after idx that holds an entry, or -1.
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::next_full_slot(int idx) const
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // look at 8 control bytes at a time, the full ones have the high bit clear
+  while (idx + 8 <= tableSize) {
+    uint64_t word;
+    memcpy(&word, ctrl + idx, sizeof(word));
+    uint64_t full = ~word & 0x8080808080808080ULL;
+    if (full) {
+      return idx + (__builtin_ctzll(full) >> 3);
+    }
+    idx += 8;
+  }
+#endif
+  for ( ; idx < tableSize; idx++) {
+    if ( ! (ctrl[idx] & 0x80)) {
+      return idx;
+    }
+  }
+  return -1;
+}
+
+// Insert entry into hash table mapping Index to Value.
+// Returns 0 if OK, -1 if update is false (the default)
+// and the item already exists.
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::insert(const Index &index, const Value &value, bool update)
+{
+  uint64_t h = hash_of(index);
+  unsigned char tag = tag_of(h);
+  int mask = tableSize - 1;
+  int reuse = -1;
+  int idx;
+  for (idx = home_slot(h, mask); ; idx = (idx + 1) & mask) {
+    unsigned char c = ctrl[idx];
+    if (c == tag && m_slots[idx].index == index) {
+      if ( ! update) {
+        return -1;
+      }
+      m_slots[idx].value = value;
+      return 0;
+    }
+    if (c == SLOT_EMPTY) {
+      break;
+    }
+    if (c == SLOT_DELETED && reuse < 0) {
+      reuse = idx;
+    }
+  }
+
+  if (reuse >= 0) {
+    idx = reuse;
+    numDeleted--;
+  }
+  ctrl[idx] = tag;
+  m_slots[idx].index = index;
+  m_slots[idx].value = value;
+  numElems++;
+
+  if (needs_resizing()) {
+    resize_hash_table();
+  } else if (needs_resizing(true)) {
+      // we are out of empty slots and iterators are active, the iterators
+      // will be moved to the same entries in the new table.
+    dprintf(D_FULLDEBUG, "OpenHashTable: growing full table with %d active iterators\n",
+            (int)activeIterators.size());
+    resize_hash_table();
+  }
+  return 0;
+}
+
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::lookup(const Index &index, Value &value) const
+{
+  int idx = find_slot(index);
+  if (idx < 0) {
+    return -1;
+  }
+  value = m_slots[idx].value;
+  return 0;
+}
+
+// This lookup() is the same as above, but it returns a pointer to the
+// value in the table.  The pointer is invalidated by the next insert().
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::lookup(const Index &index, Value* &value) const
+{
+  int idx = find_slot(index);
+  if (idx < 0) {
+    return -1;
+  }
+  value = (Value *) &(m_slots[idx].value);
+  return 0;
+}
+
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::exists(const Index &index) const
+{
+  return find_slot(index) < 0 ? -1 : 0;
+}
+
+// Delete Index entry from hash table. Return OK (0) if index was found.
+// Else return -1.
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::remove(const Index &index)
+{
+  int idx = find_slot(index);
+  if (idx < 0) {
+    return -1;
+  }
+
+    // a tombstone is only needed if a probe may have to pass this slot
+  if (ctrl[(idx + 1) & (tableSize - 1)] == SLOT_EMPTY) {
+    ctrl[idx] = SLOT_EMPTY;
+  } else {
+    ctrl[idx] = SLOT_DELETED;
+    numDeleted++;
+  }
+  m_slots[idx].index = Index();
+  m_slots[idx].value = Value();
+  numElems--;
+
+    // Iterators that point at this entry must move forward.  The current
+    // iterator may be dereferenced before being incremented.  Hence, it
+    // must point at a valid object and it must not return a value already seen.
+    // The startIterations() cursor is left alone, the next iterate()
+    // continues from the slot after it.
+  for (typename std::vector<iterator*>::iterator it = activeIterators.begin();
+       it != activeIterators.end();
+       ++it)
+  {
+    if ((*it)->m_idx == idx) {
+      (*it)->advance();
+    }
+  }
+  return 0;
+}
+
+// Clear hash table, keeping its size.
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::clear()
+{
+  for (int i = 0; i < tableSize; i++) {
+    if ( ! (ctrl[i] & 0x80)) {
+      m_slots[i].index = Index();
+      m_slots[i].value = Value();
+    }
+  }
+  memset(ctrl, SLOT_EMPTY, tableSize);
+  numElems = 0;
+  numDeleted = 0;
+  currentSlot = -1;
+
+	// Change all existing iterators to point at the end.
+  for (typename std::vector<iterator*>::iterator it = activeIterators.begin();
+       it != activeIterators.end();
+       ++it)
+  {
+    (*it)->m_idx = -1;
+  }
+  return 0;
+}
+
+template <class Index, class Value>
+void OpenHashTable<Index,Value>::startIterations (void)
+{
+  currentSlot = -1;
+}
+
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::iterate (Value &v)
+{
+  currentSlot = next_full_slot(currentSlot + 1);
+  if (currentSlot < 0) {
+    return 0;
+  }
+  v = m_slots[currentSlot].value;
+  return 1;
+}
+
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::getCurrentKey (Index &index)
+{
+  if (currentSlot < 0 || (ctrl[currentSlot] & 0x80)) return -1;
+  index = m_slots[currentSlot].index;
+  return 0;
+}
+
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::iterate (Index &index, Value &v)
+{
+  currentSlot = next_full_slot(currentSlot + 1);
+  if (currentSlot < 0) {
+    return 0;
+  }
+  index = m_slots[currentSlot].index;
+  v = m_slots[currentSlot].value;
+  return 1;
+}
+
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::iterate_nocopy (const Index **pindex, Value ** pv)
+{
+  currentSlot = next_full_slot(currentSlot + 1);
+  if (currentSlot < 0) {
+    return 0;
+  }
+  *pindex = &m_slots[currentSlot].index;
+  *pv = &m_slots[currentSlot].value;
+  return 1;
+}
+
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::iterate_stats (int & ix_bucket, int & ix_item)
+{
+  currentSlot = next_full_slot(currentSlot + 1);
+  if (currentSlot < 0) {
+    ix_bucket = -1;
+    ix_item = tableSize;
+    return 0;
+  }
+  int home = home_slot(hash_of(m_slots[currentSlot].index), tableSize - 1);
+  ix_bucket = currentSlot;
+  ix_item = (currentSlot - home) & (tableSize - 1);
+  return 1;
+}
+
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::walk( int (*walkfunc) ( Value value ) )
+{
+  for (int i = 0; i < tableSize; i++) {
+    if ( ! (ctrl[i] & 0x80)) {
+      if ( ! walkfunc(m_slots[i].value)) return 0;
+    }
+  }
+  return 1;
+}
+
+// Determine if the hash table should be rebuilt, either because it is more
+// than 3/4 full of entries and tombstones or, when forced, because there
+// is no empty slot left to end a probe.
+template <class Index, class Value>
+int OpenHashTable<Index,Value>::needs_resizing(bool forced) const
+{
+  int used = numElems + numDeleted;
+  if (forced) {
+    return used >= tableSize - 1;
+  }
+    // Resizing moves the entries out from under active iterators.
+  if (activeIterators.size()) return 0;
+  return used * 4 >= tableSize * 3;
+}
+
+// Rebuild the table at the given size, or by default at double the size if
+// it is at least half full of entries and otherwise at the same size, which
+// just clears out the tombstones.
+template <class Index, class Value>
+void OpenHashTable<Index,Value>::resize_hash_table(int newsize)
+{
+  if (newsize <= 0) {
+    newsize = tableSize;
+    if ((numElems + 1) * 2 > tableSize) {
+      newsize *= 2;
+    }
+  }
+  if (newsize < MIN_TABLE_SIZE) newsize = MIN_TABLE_SIZE;
+
+  unsigned char *new_ctrl = new unsigned char[newsize];
+  memset(new_ctrl, SLOT_EMPTY, newsize);
+  Slot *new_slots = new Slot[newsize];
+  int mask = newsize - 1;
+
+  int cursor = -1;
+  std::vector<int> iter_slots(activeIterators.size(), -1);
+  for (int i = 0; i < tableSize; i++) {
+    if (ctrl[i] & 0x80) {
+      continue;
+    }
+    uint64_t h = hash_of(m_slots[i].index);
+    int idx = home_slot(h, mask);
+    while (new_ctrl[idx] != SLOT_EMPTY) {
+      idx = (idx + 1) & mask;
+    }
+    new_ctrl[idx] = tag_of(h);
+    std::swap(new_slots[idx].index, m_slots[i].index);
+    std::swap(new_slots[idx].value, m_slots[i].value);
+
+    if (i == currentSlot) { cursor = idx; }
+    for (size_t ii = 0; ii < activeIterators.size(); ii++) {
+      if (activeIterators[ii]->m_idx == i) { iter_slots[ii] = idx; }
+    }
+  }
+
+  delete [] ctrl;
+  delete [] m_slots;
+  ctrl = new_ctrl;
+  m_slots = new_slots;
+  tableSize = newsize;
+  numDeleted = 0;
+  currentSlot = cursor;
+  for (size_t ii = 0; ii < activeIterators.size(); ii++) {
+    activeIterators[ii]->m_idx = iter_slots[ii];
+  }
+}
+
+#endif // OPEN_HASH_H
@@ -317,6 +317,45 @@ CheckEvents::CheckAllJobs(MyString &errorMsg)
 
 //-----------------------------------------------------------------------------
 
+bool
+CheckEvents::GetEventCounts(const CondorID &id, EventCounts &counts) const
+{
+	JobInfo *info = NULL;
+	if ( jobHash.lookup(id, info) != 0 ) {
+		return false;
+	}
+
+	counts.submitCount = info->submitCount;
+	counts.errorCount = info->errorCount;
+	counts.abortCount = info->abortCount;
+	counts.termCount = info->termCount;
+	counts.postScriptCount = info->postScriptCount;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void
+CheckEvents::SetEventCounts(const CondorID &id, const EventCounts &counts)
+{
+	JobInfo *info = NULL;
+	if ( jobHash.lookup(id, info) != 0 ) {
+		info = new JobInfo();
+		if ( jobHash.insert(id, info) != 0 ) {
+			delete info;
+			return;
+		}
+	}
+
+	info->submitCount = counts.submitCount;
+	info->errorCount = counts.errorCount;
+	info->abortCount = counts.abortCount;
+	info->termCount = counts.termCount;
+	info->postScriptCount = counts.postScriptCount;
+}
+
+//-----------------------------------------------------------------------------
+
 const char *
 CheckEvents::ResultToString(check_event_result_t resultIn)
 {
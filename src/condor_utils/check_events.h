@@ -123,6 +123,30 @@ class CheckEvents {
 	*/
 	check_event_result_t CheckAllJobs(MyString &errorMsg);
 
+		// The counts of the events we've seen for one job, so that they
+		// can be saved and restored (DAGMan does this when it recovers
+		// from a checkpoint instead of re-reading the whole log).
+	struct EventCounts {
+		int		submitCount;
+		int		errorCount;
+		int		abortCount;
+		int		termCount;
+		int		postScriptCount;
+	};
+
+	/** Get the event counts for a job.
+		@param The job's ID.
+		@param The event counts (set only if we return true).
+		@return true if we've seen any events for the job.
+	*/
+	bool GetEventCounts(const CondorID &id, EventCounts &counts) const;
+
+	/** Set the event counts for a job, replacing any we already have.
+		@param The job's ID.
+		@param The event counts.
+	*/
+	void SetEventCounts(const CondorID &id, const EventCounts &counts);
+
 	/** Convert a check_event_result_t to the corresponding string.
 		@param The result.
 		@return The corresponding string.
@@ -29,9 +29,12 @@
 #include "condor_email.h"
 
 #include "classadHistory.h"
+#include "history_index.h"
 
 static FILE *HistoryFile_fp = NULL;
 static int HistoryFile_RefCount = 0;
+static HistoryIndexWriter HistoryIndex;
+static bool HistoryIndex_Opened = false; // true once we have tried to open the index for the open history file
 
 char* JobHistoryFileName = NULL;
 char* JobHistoryParamName = NULL;
@@ -40,6 +43,7 @@ bool        DoDailyHistoryRotation = true;
 bool        DoMonthlyHistoryRotation = true;
 filesize_t  MaxHistoryFileSize = 20 * 1024 * 1024; // 20MB;
 int         NumberBackupHistoryFiles = 2;
+bool        DoHistoryIndex = true;
 char*       PerJobHistoryDir = NULL;
 
 static void MaybeRotateHistory(int size_to_append);
@@ -82,6 +86,7 @@ InitJobHistoryFile(const char *history_param, const char *per_job_history_param)
     NumberBackupHistoryFiles = param_integer("MAX_HISTORY_ROTATIONS", 
                                           2,  // default
                                           1); // minimum
+    DoHistoryIndex = param_boolean("ENABLE_HISTORY_INDEX", true);
 
     if (DoHistoryRotation) {
         dprintf(D_ALWAYS, "History file rotation is enabled.\n");
@@ -144,6 +149,12 @@ AppendHistory(ClassAd* ad)
 	  failed = true;
   } else {
 	  int offset = findHistoryOffset(LogFile);
+	  // findHistoryOffset leaves us at the end of the file, which is where this ad will start
+	  filesize_t ad_offset = ftell(LogFile);
+	  if (DoHistoryIndex && ! HistoryIndex_Opened) {
+		  HistoryIndex_Opened = true;
+		  HistoryIndex.Open(JobHistoryFileName, ad_offset);
+	  }
 	  if (!fPrintAd(LogFile, *ad)) {
 		  dprintf(D_ALWAYS, 
 				  "ERROR: failed to write job class ad to history file %s\n",
@@ -169,6 +180,9 @@ AppendHistory(ClassAd* ad)
                       "*** Offset = %d ClusterId = %d ProcId = %d Owner = \"%s\" CompletionDate = %d\n",
 				  offset, cluster, proc, owner.c_str(), completion);
 		  fflush( LogFile );
+		  if (HistoryIndex.IsOpen()) {
+			  HistoryIndex.Append(*ad, ad_offset, ftell(LogFile) - ad_offset);
+		  }
       }
   }
 
@@ -329,6 +343,8 @@ RelinquishHistoryFile(FILE *fp) {
 static void
 CloseJobHistoryFile() {
 	ASSERT( HistoryFile_RefCount == 0 );
+	HistoryIndex.Close();
+	HistoryIndex_Opened = false;
 	if( HistoryFile_fp ) {
 		fclose( HistoryFile_fp );
 		HistoryFile_fp = NULL;
@@ -491,6 +507,11 @@ MaybeDeleteOneHistoryBackup(void)
                     dprintf(D_ALWAYS, "Failed to delete %s\n", oldest_history_filename);
                     num_backups = 0; // prevent looping forever
                 }
+                // the index of the backup, if any, goes with it
+                std::string index_filename;
+                formatstr(index_filename, "%s%c%s%s", history_dir, DIR_DELIM_CHAR,
+                          oldest_history_filename, HISTORY_INDEX_SUFFIX);
+                unlink(index_filename.c_str());
             } else {
                 dprintf(D_ALWAYS, "Failed to find/delete %s\n", oldest_history_filename);
                 num_backups = 0; // prevent looping forever
@@ -519,7 +540,8 @@ IsHistoryFilename(const char *filename, time_t *backup_time)
     history_base_length = strlen(history_base);
 
     if (   !strncmp(filename, history_base, history_base_length)
-        && filename[history_base_length] == '.') {
+        && filename[history_base_length] == '.'
+        && !IsHistoryIndexFilename(filename)) {
         // The filename begins correctly, now see if it ends in an 
         // ISO time
         struct tm file_time;
@@ -571,6 +593,20 @@ RotateHistory(void)
         dprintf(D_ALWAYS, "Failed to rotate history file to %s\n",
                 rotated_history_name.Value());
         dprintf(D_ALWAYS, "Because rotation failed, the history file may get very large.\n");
+    } else {
+        // the index describes the rotated file now, so it is rotated along with it.
+        MyString index_name(JobHistoryFileName);
+        index_name += HISTORY_INDEX_SUFFIX;
+        StatInfo index_stat_info(index_name.Value());
+        if (index_stat_info.Error() == SIGood) {
+            MyString rotated_index_name(rotated_history_name);
+            rotated_index_name += HISTORY_INDEX_SUFFIX;
+            if (rotate_file(index_name.Value(), rotated_index_name.Value())) {
+                dprintf(D_ALWAYS, "Failed to rotate history index to %s, removing it\n",
+                        rotated_index_name.Value());
+                unlink(index_name.Value());
+            }
+        }
     }
 
     return;
@@ -27,6 +27,7 @@ extern bool        DoDailyHistoryRotation;
 extern bool        DoMonthlyHistoryRotation;
 extern filesize_t  MaxHistoryFileSize;
 extern int         NumberBackupHistoryFiles;
+extern bool        DoHistoryIndex;
 extern char*       PerJobHistoryDir;
 extern char* JobHistoryFileName;
 
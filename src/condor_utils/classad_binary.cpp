@@ -0,0 +1,626 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "classad_binary.h"
+#include "stl_string_utils.h"
+#include "classad/classadCache.h" // for CachedExprEnvelope
+
+using namespace classad;
+
+// Each expression starts with one of these tags.
+enum {
+	TAG_UNDEFINED = 0,
+	TAG_ERROR,
+	TAG_TRUE,
+	TAG_FALSE,
+	TAG_INTEGER,	// zig-zag varint
+	TAG_REAL,		// 8 bytes, little endian
+	TAG_STRING,		// varint length, then the bytes
+	TAG_ABSTIME,	// zig-zag varint seconds and offset
+	TAG_RELTIME,	// 8 bytes, little endian
+	TAG_ATTRREF,	// flags, [scope expr], name
+	TAG_OPERATION,	// op kind, mask of operands present, operands
+	TAG_FUNCTION,	// name, varint count, arguments
+	TAG_LIST,		// varint count, items
+	TAG_CLASSAD,	// varint count, then name and expr for each attribute
+	TAG_TEXT,		// unparsed old ClassAd expression, as a string
+};
+
+// Each name starts with one of these, or with the index of an interned
+// name plus NAME_INDEX.
+enum {
+	NAME_INLINE = 0,	// a string that is not interned
+	NAME_DEFINE = 1,	// a string that is added to the table
+	NAME_INDEX = 2,
+};
+
+#define ATTRREF_ABSOLUTE 0x01
+#define ATTRREF_SCOPED   0x02
+
+// expressions nested deeper than this are rejected by the reader
+static const int max_expr_depth = 1000;
+
+// strings literals at least this long go through the ClassAd cache,
+// as they would when getClassAdEx() receives them as text
+static const size_t always_cache_string_size = 128;
+
+static void put_varint(std::string &buf, unsigned long long val)
+{
+	while (val >= 0x80) {
+		buf += (char)(val | 0x80);
+		val >>= 7;
+	}
+	buf += (char)val;
+}
+
+static void put_signed(std::string &buf, long long val)
+{
+	put_varint(buf, ((unsigned long long)val << 1) ^ (unsigned long long)(val >> 63));
+}
+
+static void put_real(std::string &buf, double val)
+{
+	uint64_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	for (int ii = 0; ii < 8; ++ii) {
+		buf += (char)(bits >> (8*ii));
+	}
+}
+
+static void put_string(std::string &buf, const char *str, size_t len)
+{
+	put_varint(buf, len);
+	buf.append(str, len);
+}
+
+static bool get_varint(const char *&ptr, const char *end, unsigned long long &val)
+{
+	val = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (ptr >= end) {
+			return false;
+		}
+		unsigned char ch = *ptr++;
+		val |= (unsigned long long)(ch & 0x7f) << shift;
+		if ( ! (ch & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool get_signed(const char *&ptr, const char *end, long long &val)
+{
+	unsigned long long uval;
+	if ( ! get_varint(ptr, end, uval)) {
+		return false;
+	}
+	val = (long long)(uval >> 1) ^ -(long long)(uval & 1);
+	return true;
+}
+
+static bool get_real(const char *&ptr, const char *end, double &val)
+{
+	if (end - ptr < 8) {
+		return false;
+	}
+	uint64_t bits = 0;
+	for (int ii = 0; ii < 8; ++ii) {
+		bits |= (uint64_t)(unsigned char)ptr[ii] << (8*ii);
+	}
+	ptr += 8;
+	memcpy(&val, &bits, sizeof(val));
+	return true;
+}
+
+static bool get_string(const char *&ptr, const char *end, const char *&str, size_t &len)
+{
+	unsigned long long ulen;
+	if ( ! get_varint(ptr, end, ulen) || ulen > (unsigned long long)(end - ptr)) {
+		return false;
+	}
+	str = ptr;
+	len = (size_t)ulen;
+	ptr += len;
+	return true;
+}
+
+// The operands an operator of the given kind must have, as a mask of the
+// same form the writer puts after the operator.
+static int operand_mask(Operation::OpKind op)
+{
+	switch (op) {
+	case Operation::UNARY_PLUS_OP:
+	case Operation::UNARY_MINUS_OP:
+	case Operation::LOGICAL_NOT_OP:
+	case Operation::BITWISE_NOT_OP:
+	case Operation::PARENTHESES_OP:
+		return 1;
+	case Operation::TERNARY_OP:
+		return 1 | 2 | 4;
+	default:
+		return 1 | 2;
+	}
+}
+
+
+ClassAdBinaryWriter::ClassAdBinaryWriter(std::unordered_map<std::string, int> &names_in, std::string &buf_in)
+	: names(names_in)
+	, buf(buf_in)
+	, count(0)
+{
+	unparser.SetOldClassAd(true, true);
+	buf.clear();
+	put_varint(buf, CLASSAD_BINARY_VERSION);
+	put_varint(buf, names.size());
+}
+
+void ClassAdBinaryWriter::Add(const std::string &attr, const ExprTree *expr)
+{
+	PutName(attr);
+	PutExpr(expr);
+	++count;
+}
+
+void ClassAdBinaryWriter::Add(const std::string &attr, long long value)
+{
+	PutName(attr);
+	buf += (char)TAG_INTEGER;
+	put_signed(buf, value);
+	++count;
+}
+
+void ClassAdBinaryWriter::PutName(const std::string &name)
+{
+	std::unordered_map<std::string, int>::const_iterator it = names.find(name);
+	if (it != names.end()) {
+		put_varint(buf, it->second + NAME_INDEX);
+		return;
+	}
+	if (names.size() < CLASSAD_BINARY_MAX_NAMES) {
+		int index = (int)names.size();
+		names[name] = index;
+		put_varint(buf, NAME_DEFINE);
+	} else {
+		put_varint(buf, NAME_INLINE);
+	}
+	put_string(buf, name.data(), name.size());
+}
+
+void ClassAdBinaryWriter::PutText(const ExprTree *expr)
+{
+	std::string text;
+	unparser.Unparse(text, expr);
+	buf += (char)TAG_TEXT;
+	put_string(buf, text.data(), text.size());
+}
+
+void ClassAdBinaryWriter::PutExpr(const ExprTree *expr)
+{
+	expr = expr->self();	// look through cache envelopes
+
+	switch (expr->GetKind()) {
+	case ExprTree::LITERAL_NODE: {
+		Value::NumberFactor factor;
+		const Value &val = static_cast<const Literal*>(expr)->getValue(factor);
+		if (factor != Value::NO_FACTOR) {
+			break;
+		}
+		switch (val.GetType()) {
+		case Value::UNDEFINED_VALUE:
+			buf += (char)TAG_UNDEFINED;
+			return;
+		case Value::ERROR_VALUE:
+			buf += (char)TAG_ERROR;
+			return;
+		case Value::BOOLEAN_VALUE: {
+			bool b = false;
+			val.IsBooleanValue(b);
+			buf += (char)(b ? TAG_TRUE : TAG_FALSE);
+			return;
+		}
+		case Value::INTEGER_VALUE: {
+			long long i = 0;
+			val.IsIntegerValue(i);
+			buf += (char)TAG_INTEGER;
+			put_signed(buf, i);
+			return;
+		}
+		case Value::REAL_VALUE: {
+			double d = 0;
+			val.IsRealValue(d);
+			buf += (char)TAG_REAL;
+			put_real(buf, d);
+			return;
+		}
+		case Value::STRING_VALUE: {
+			const char *str = NULL;
+			int len = 0;
+			val.IsStringValue(str);
+			val.IsStringValue(len);
+			buf += (char)TAG_STRING;
+			put_string(buf, str, len);
+			return;
+		}
+		case Value::ABSOLUTE_TIME_VALUE: {
+			abstime_t at;
+			val.IsAbsoluteTimeValue(at);
+			buf += (char)TAG_ABSTIME;
+			put_signed(buf, at.secs);
+			put_signed(buf, at.offset);
+			return;
+		}
+		case Value::RELATIVE_TIME_VALUE: {
+			double secs = 0;
+			val.IsRelativeTimeValue(secs);
+			buf += (char)TAG_RELTIME;
+			put_real(buf, secs);
+			return;
+		}
+		default:
+			break;
+		}
+		break;
+	}
+
+	case ExprTree::ATTRREF_NODE: {
+		ExprTree *scope = NULL;
+		std::string name;
+		bool absolute = false;
+		static_cast<const AttributeReference*>(expr)->GetComponents(scope, name, absolute);
+		buf += (char)TAG_ATTRREF;
+		buf += (char)((absolute ? ATTRREF_ABSOLUTE : 0) | (scope ? ATTRREF_SCOPED : 0));
+		if (scope) {
+			PutExpr(scope);
+		}
+		PutName(name);
+		return;
+	}
+
+	case ExprTree::OP_NODE: {
+		Operation::OpKind op;
+		ExprTree *args[3] = { NULL, NULL, NULL };
+		static_cast<const Operation*>(expr)->GetComponents(op, args[0], args[1], args[2]);
+		int mask = (args[0] ? 1 : 0) | (args[1] ? 2 : 0) | (args[2] ? 4 : 0);
+		buf += (char)TAG_OPERATION;
+		buf += (char)op;
+		buf += (char)mask;
+		for (int ii = 0; ii < 3; ++ii) {
+			if (args[ii]) {
+				PutExpr(args[ii]);
+			}
+		}
+		return;
+	}
+
+	case ExprTree::FN_CALL_NODE: {
+		std::string name;
+		std::vector<ExprTree*> args;
+		static_cast<const FunctionCall*>(expr)->GetComponents(name, args);
+		buf += (char)TAG_FUNCTION;
+		PutName(name);
+		put_varint(buf, args.size());
+		for (size_t ii = 0; ii < args.size(); ++ii) {
+			PutExpr(args[ii]);
+		}
+		return;
+	}
+
+	case ExprTree::EXPR_LIST_NODE: {
+		std::vector<ExprTree*> items;
+		static_cast<const ExprList*>(expr)->GetComponents(items);
+		buf += (char)TAG_LIST;
+		put_varint(buf, items.size());
+		for (size_t ii = 0; ii < items.size(); ++ii) {
+			PutExpr(items[ii]);
+		}
+		return;
+	}
+
+	case ExprTree::CLASSAD_NODE: {
+		const ClassAd *ad = static_cast<const ClassAd*>(expr);
+		buf += (char)TAG_CLASSAD;
+		put_varint(buf, ad->size());
+		for (AttrList::const_iterator it = ad->begin(); it != ad->end(); ++it) {
+			PutName(it->first);
+			PutExpr(it->second);
+		}
+		return;
+	}
+
+	default:
+		break;
+	}
+
+		// anything we don't have a tag for is sent as text
+	PutText(expr);
+}
+
+
+ClassAdBinaryReader::ClassAdBinaryReader(std::vector<std::string> &names_in)
+	: names(names_in)
+	, ptr(NULL)
+	, end(NULL)
+{
+	parser.SetOldClassAd(true);
+	unparser.SetOldClassAd(true, true);
+}
+
+bool ClassAdBinaryReader::Fail(const char *what)
+{
+	formatstr(error, "%s, with %d bytes left", what, (int)(end - ptr));
+	return false;
+}
+
+bool ClassAdBinaryReader::Read(const char *data, size_t len, ClassAd &ad, bool use_cache)
+{
+	ptr = data;
+	end = data + len;
+	error.clear();
+
+	unsigned long long version, base;
+	if ( ! get_varint(ptr, end, version) || ! get_varint(ptr, end, base)) {
+		return Fail("truncated header");
+	}
+	if (version != CLASSAD_BINARY_VERSION) {
+		formatstr(error, "unsupported version %llu", version);
+		return false;
+	}
+		// The sender's table can be smaller than ours if it started
+		// over (for instance a socket that was handed to a new process),
+		// but it must never have names we didn't see.
+	if (base > names.size()) {
+		formatstr(error, "attribute names out of sync (sender has %llu, we have %d)",
+			base, (int)names.size());
+		return false;
+	}
+	names.resize(base);
+
+	bool cache = use_cache && ClassAdGetExpressionCaching();
+	std::string attr, rhs;
+	while (ptr < end) {
+		if ( ! GetName(attr)) {
+			return false;
+		}
+		ExprTree *tree = GetExpr(0);
+		if ( ! tree) {
+			return false;
+		}
+
+			// Share expressions through the cache as getClassAd() does.
+			// The cache is keyed on the unparsed text, but unparsing is
+			// much cheaper than the parse that a cache hit saves.
+		if (cache && attr[0] != '\'') {
+			bool cache_it = true;
+			if (tree->GetKind() == ExprTree::LITERAL_NODE) {
+				Value::NumberFactor factor;
+				int cch = 0;
+				cache_it = static_cast<Literal*>(tree)->getValue(factor).IsStringValue(cch) &&
+					(size_t)cch >= always_cache_string_size;
+			}
+			if (cache_it) {
+				rhs.clear();
+				unparser.Unparse(rhs, tree);
+				CachedExprEnvelope *penv = CachedExprEnvelope::check_hit(attr, rhs);
+				if (penv) {
+					delete tree;
+					tree = penv;
+				} else {
+					tree = CachedExprEnvelope::cache(attr, tree, rhs);
+				}
+			}
+		}
+
+		if ( ! ad.Insert(attr, tree)) {
+			formatstr(error, "failed to insert %s", attr.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ClassAdBinaryReader::GetName(std::string &name)
+{
+	unsigned long long token;
+	if ( ! get_varint(ptr, end, token)) {
+		return Fail("truncated name");
+	}
+	if (token >= NAME_INDEX) {
+		token -= NAME_INDEX;
+		if (token >= names.size()) {
+			return Fail("unknown attribute name index");
+		}
+		name = names[token];
+		return true;
+	}
+
+	const char *str;
+	size_t len;
+	if ( ! get_string(ptr, end, str, len)) {
+		return Fail("truncated name");
+	}
+	name.assign(str, len);
+	if (token == NAME_DEFINE) {
+		names.push_back(name);
+	}
+	return true;
+}
+
+ExprTree *ClassAdBinaryReader::GetExpr(int depth)
+{
+	if (depth > max_expr_depth) {
+		Fail("expression nested too deeply");
+		return NULL;
+	}
+	if (ptr >= end) {
+		Fail("truncated expression");
+		return NULL;
+	}
+
+	int tag = (unsigned char)*ptr++;
+	switch (tag) {
+	case TAG_UNDEFINED:
+		return Literal::MakeUndefined();
+	case TAG_ERROR:
+		return Literal::MakeError();
+	case TAG_TRUE:
+		return Literal::MakeBool(true);
+	case TAG_FALSE:
+		return Literal::MakeBool(false);
+
+	case TAG_INTEGER: {
+		long long i;
+		if ( ! get_signed(ptr, end, i)) break;
+		return Literal::MakeLong(i);
+	}
+
+	case TAG_REAL: {
+		double d;
+		if ( ! get_real(ptr, end, d)) break;
+		return Literal::MakeReal(d);
+	}
+
+	case TAG_STRING: {
+		const char *str;
+		size_t len;
+		if ( ! get_string(ptr, end, str, len)) break;
+		return Literal::MakeString(str, len);
+	}
+
+	case TAG_ABSTIME: {
+		long long secs, offset;
+		if ( ! get_signed(ptr, end, secs) || ! get_signed(ptr, end, offset)) break;
+		abstime_t at;
+		at.secs = (time_t)secs;
+		at.offset = (int)offset;
+		Value val;
+		val.SetAbsoluteTimeValue(at);
+		return Literal::MakeLiteral(val);
+	}
+
+	case TAG_RELTIME: {
+		double secs;
+		if ( ! get_real(ptr, end, secs)) break;
+		Value val;
+		val.SetRelativeTimeValue(secs);
+		return Literal::MakeLiteral(val);
+	}
+
+	case TAG_ATTRREF: {
+		if (ptr >= end) break;
+		int flags = (unsigned char)*ptr++;
+		ExprTree *scope = NULL;
+		if (flags & ATTRREF_SCOPED) {
+			scope = GetExpr(depth + 1);
+			if ( ! scope) return NULL;
+		}
+		std::string name;
+		if ( ! GetName(name)) {
+			delete scope;
+			return NULL;
+		}
+		return AttributeReference::MakeAttributeReference(scope, name, (flags & ATTRREF_ABSOLUTE) != 0);
+	}
+
+	case TAG_OPERATION: {
+		if (end - ptr < 2) break;
+		int op = (unsigned char)*ptr++;
+		int mask = (unsigned char)*ptr++;
+		if (op < Operation::__FIRST_OP__ || op > Operation::__LAST_OP__) {
+			Fail("invalid operator");
+			return NULL;
+		}
+		if (mask != operand_mask((Operation::OpKind)op)) {
+			Fail("wrong number of operands for operator");
+			return NULL;
+		}
+		ExprTree *args[3] = { NULL, NULL, NULL };
+		for (int ii = 0; ii < 3; ++ii) {
+			if (mask & (1 << ii)) {
+				args[ii] = GetExpr(depth + 1);
+				if ( ! args[ii]) {
+					delete args[0]; delete args[1];
+					return NULL;
+				}
+			}
+		}
+		return Operation::MakeOperation((Operation::OpKind)op, args[0], args[1], args[2]);
+	}
+
+	case TAG_FUNCTION:
+	case TAG_LIST: {
+		std::string name;
+		if (tag == TAG_FUNCTION && ! GetName(name)) {
+			return NULL;
+		}
+		unsigned long long num;
+		if ( ! get_varint(ptr, end, num) || num > (unsigned long long)(end - ptr)) break;
+		std::vector<ExprTree*> items;
+		items.reserve(num);
+		for (unsigned long long ii = 0; ii < num; ++ii) {
+			ExprTree *item = GetExpr(depth + 1);
+			if ( ! item) {
+				for (size_t jj = 0; jj < items.size(); ++jj) { delete items[jj]; }
+				return NULL;
+			}
+			items.push_back(item);
+		}
+		if (tag == TAG_FUNCTION) {
+			return FunctionCall::MakeFunctionCall(name, items);
+		}
+		return ExprList::MakeExprList(items);
+	}
+
+	case TAG_CLASSAD: {
+		unsigned long long num;
+		if ( ! get_varint(ptr, end, num) || num > (unsigned long long)(end - ptr)) break;
+		ClassAd *ad = new ClassAd();
+		std::string name;
+		for (unsigned long long ii = 0; ii < num; ++ii) {
+			ExprTree *item = NULL;
+			if ( ! GetName(name) || ! (item = GetExpr(depth + 1))) {
+				delete ad;
+				return NULL;
+			}
+			ad->Insert(name, item);
+		}
+		return ad;
+	}
+
+	case TAG_TEXT: {
+		const char *str;
+		size_t len;
+		if ( ! get_string(ptr, end, str, len)) break;
+		ExprTree *tree = parser.ParseExpression(std::string(str, len));
+		if ( ! tree) {
+			Fail("unparsable expression");
+		}
+		return tree;
+	}
+
+	default:
+		Fail("unknown tag");
+		return NULL;
+	}
+
+	Fail("truncated expression");
+	return NULL;
+}
@@ -0,0 +1,117 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _ClassAdBinary_H
+#define _ClassAdBinary_H
+
+/*
+  The binary encoding of ClassAds that putClassAd() and getClassAd() use
+  on a ReliSock when the peer supports it.  Instead of an unparsed
+  "name = expr" line per attribute, an ad is sent as a single block:
+
+    version, base, then for each attribute: name, value
+
+  Literals are sent as typed values, and other expressions as a prefix
+  walk of their tree, so that neither end has to unparse or parse them.
+  Attribute names (including those referred to in expressions) are
+  interned: the first time a name is sent on a connection it is added to
+  the sender's table, and the receiver adds it to its own copy; after
+  that only the index is sent.  base is the size of the sender's table
+  when the ad was written, which lets the receiver notice if the two
+  tables have fallen out of step.
+*/
+
+#include "classad/classad_distribution.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// sent in place of the number of expressions to announce a binary ad
+#define CLASSAD_BINARY_MARKER   (-0x41444231)
+#define CLASSAD_BINARY_VERSION  1
+
+// names after this many are sent inline rather than interned
+#define CLASSAD_BINARY_MAX_NAMES 4096
+
+class ClassAdBinaryWriter
+{
+public:
+	/** Start writing a binary ad into buf, which is cleared.
+		@param names the names already sent on this connection, which
+			is updated as new names are written.
+		@param buf the buffer to append the encoded ad to.
+	*/
+	ClassAdBinaryWriter(std::unordered_map<std::string, int> &names, std::string &buf);
+
+	/// Append an attribute and its expression.
+	void Add(const std::string &attr, const classad::ExprTree *expr);
+
+	/// Append an attribute with an integer value.
+	void Add(const std::string &attr, long long value);
+
+	/// Number of attributes appended so far.
+	int Count() const { return count; }
+
+private:
+	void PutName(const std::string &name);
+	void PutExpr(const classad::ExprTree *expr);
+	void PutText(const classad::ExprTree *expr);
+
+	std::unordered_map<std::string, int> &names;
+	std::string &buf;
+	classad::ClassAdUnParser unparser;
+	int count;
+};
+
+class ClassAdBinaryReader
+{
+public:
+	/**
+		@param names the names received so far on this connection,
+			which is updated as new names are read.
+	*/
+	ClassAdBinaryReader(std::vector<std::string> &names);
+
+	/** Decode a binary ad, inserting its attributes into ad.
+		@param data the encoded ad.
+		@param len the size of data.
+		@param ad the ad to insert into.
+		@param use_cache insert expressions via the ClassAd cache, as
+			getClassAd() does for unparsed text.
+		@return false if the data is invalid; see Error().
+	*/
+	bool Read(const char *data, size_t len, classad::ClassAd &ad, bool use_cache);
+
+	/// Why the last Read() failed.
+	const std::string & Error() const { return error; }
+
+private:
+	bool GetName(std::string &name);
+	classad::ExprTree *GetExpr(int depth);
+	bool Fail(const char *what);
+
+	std::vector<std::string> &names;
+	const char *ptr;
+	const char *end;
+	classad::ClassAdParser parser;
+	classad::ClassAdUnParser unparser;
+	std::string error;
+};
+
+#endif
@@ -109,6 +109,11 @@ public:
   */
   void CommitNondurableTransaction(const char * comment=NULL) { ClassAdLog<K,AD>::CommitNondurableTransaction(comment); }
 
+  /** Commit a transaction, leaving the sync to the group commit thread
+    @return nothing
+  */
+  void CommitDeferredSyncTransaction(const char * comment=NULL) { ClassAdLog<K,AD>::CommitDeferredSyncTransaction(comment); }
+
   /** Abort a transaction
     @return true if a transaction aborted, false if no transaction active
   */
@@ -150,6 +155,14 @@ public:
 		// This means doing both a flush and fsync.
   void ForceLog() { ClassAdLog<K,AD>::ForceLog(); }
 
+		// Group commit, see ClassAdLog::EnableGroupCommit
+  void EnableGroupCommit(int window_ms, int notify_fd) { ClassAdLog<K,AD>::EnableGroupCommit(window_ms, notify_fd); }
+  void DisableGroupCommit() { ClassAdLog<K,AD>::DisableGroupCommit(); }
+  bool GroupCommitEnabled() const { return ClassAdLog<K,AD>::GroupCommitEnabled(); }
+  bool SyncPending() { return ClassAdLog<K,AD>::SyncPending(); }
+  void WhenDurable(std::function<void()> fn) { ClassAdLog<K,AD>::WhenDurable(fn); }
+  void ProcessCompletedSyncs(std::vector<ClassAdLogGroupCommit::Batch> * batches = NULL) { ClassAdLog<K,AD>::ProcessCompletedSyncs(batches); }
+
   ///
   Transaction* getActiveTransaction() { return ClassAdLog<K,AD>::getActiveTransaction(); }
   ///
@@ -170,6 +183,12 @@ public:
   */
   bool TruncLog() { return ClassAdLog<K,AD>::TruncLog(); }
 
+  /** Rotate the log in the background, see ClassAdLog::BeginBackgroundTruncLog
+  */
+  bool BeginBackgroundTruncLog() { return ClassAdLog<K,AD>::BeginBackgroundTruncLog(); }
+  bool PollBackgroundTruncLog(bool * rotated = NULL) { return ClassAdLog<K,AD>::PollBackgroundTruncLog(rotated); }
+  bool BackgroundTruncLogInProgress() const { return ClassAdLog<K,AD>::BackgroundTruncLogInProgress(); }
+
   void SetMaxHistoricalLogs(int max) { ClassAdLog<K,AD>::SetMaxHistoricalLogs(max); }
   int GetMaxHistoricalLogs() { return ClassAdLog<K,AD>::GetMaxHistoricalLogs(); }
 
@@ -30,6 +30,7 @@
 #include "classad_merge.h"
 #include "condor_fsync.h"
 #include "condor_attributes.h"
+#include "condor_blkng_full_disk_io.h"
 
 #if defined(HAVE_DLOPEN)
 #include "ClassAdLogPlugin.h"
@@ -209,6 +210,128 @@ int FlushClassAdLog(FILE* fp, bool force)
 }
 
 
+extern bool condor_fsync_on;
+
+ClassAdLogGroupCommit::ClassAdLogGroupCommit(int window_ms, int notify_fd)
+	: m_window_ms(window_ms)
+	, m_notify_fd(notify_fd)
+	, m_fd(-1)
+	, m_requested(0)
+	, m_synced(0)
+	, m_errno(0)
+	, m_stop(false)
+	, m_sync_now(false)
+{
+	m_thread = std::thread(&ClassAdLogGroupCommit::Run, this);
+}
+
+ClassAdLogGroupCommit::~ClassAdLogGroupCommit()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stop = true;
+	}
+	m_requested_cond.notify_all();
+	m_thread.join();
+}
+
+unsigned long ClassAdLogGroupCommit::RequestSync(int fd)
+{
+	unsigned long seq;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_fd = fd;
+		seq = ++m_requested;
+	}
+	m_requested_cond.notify_all();
+	return seq;
+}
+
+unsigned long ClassAdLogGroupCommit::RequestedSequence()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_requested;
+}
+
+unsigned long ClassAdLogGroupCommit::SyncedSequence()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_synced;
+}
+
+void ClassAdLogGroupCommit::WaitForSync()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	unsigned long target = m_requested;
+	m_sync_now = true;
+	m_requested_cond.notify_all();
+	m_synced_cond.wait(lock, [this, target]{ return m_synced >= target; });
+}
+
+int ClassAdLogGroupCommit::TakeCompleted(std::vector<Batch> * batches)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (batches) {
+		batches->insert(batches->end(), m_completed.begin(), m_completed.end());
+	}
+	m_completed.clear();
+	return m_errno;
+}
+
+// the I/O thread.  it must not call dprintf or anything else that is not thread safe.
+void ClassAdLogGroupCommit::Run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_requested_cond.wait(lock, [this]{ return m_stop || m_requested > m_synced; });
+		if (m_requested == m_synced) {
+			break; // stopping, and nothing left to sync
+		}
+
+		// give other commits a chance to join this sync.  WaitForSync and the
+		// destructor cut the window short.
+		if (m_window_ms > 0) {
+			m_requested_cond.wait_for(lock, std::chrono::milliseconds(m_window_ms),
+				[this]{ return m_stop || m_sync_now; });
+		}
+		m_sync_now = false;
+
+		unsigned long target = m_requested;
+		int fd = m_fd;
+		lock.unlock();
+
+		auto begin = std::chrono::steady_clock::now();
+		int rval = 0;
+		if (condor_fsync_on && fd >= 0) {
+#ifdef HAVE_FDATASYNC
+			rval = fdatasync(fd);
+#else
+			rval = fsync(fd);
+#endif
+		}
+		int err = (rval < 0) ? (errno ? errno : -1) : 0;
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+		lock.lock();
+		if (err && ! m_errno) {
+			m_errno = err;
+		}
+		Batch batch;
+		batch.commits = (int)(target - m_synced);
+		batch.sync_time = elapsed.count();
+		m_completed.push_back(batch);
+		m_synced = target;
+		m_synced_cond.notify_all();
+
+		if (m_notify_fd >= 0) {
+			// the pipe is non-blocking, if it is full the reader has a wakeup pending anyway.
+			char ch = 'S';
+			if (write(m_notify_fd, &ch, 1) < 0) { /* ignore */ }
+		}
+	}
+}
+
+
 bool SaveHistoricalClassAdLogs(
 	const char * filename,
 	const unsigned long max_historical_logs,
@@ -253,6 +376,8 @@ bool SaveHistoricalClassAdLogs(
 }
 
 
+static bool RotateClassAdLog(const char * tmp_filename, const char * filename, FILE* &log_fp, MyString & errmsg);
+
 bool TruncateClassAdLog(
 	const char * filename,	        // in
 	LoggableClassAdTable & la,      // in
@@ -307,10 +432,25 @@ bool TruncateClassAdLog(
 	}
 
 	fclose(new_log_fp);	// avoid sharing violation on move
-	if (rotate_file(tmp_log_filename.Value(), filename) < 0) {
+	if ( ! RotateClassAdLog(tmp_log_filename.Value(), filename, log_fp, errmsg)) {
+		return false;
+	}
+
+	// we successfully wrote and rotated, so we can update our sequence number
+	historical_sequence_number = future_sequence_number;
+	return true;
+}
+
+// move a newly written log over the current one, which must already be closed,
+// then reopen it for appending.  if the rename fails the current log is reopened
+// and false is returned.
+static bool
+RotateClassAdLog(const char * tmp_filename, const char * filename, FILE* &log_fp, MyString & errmsg)
+{
+	if (rotate_file(tmp_filename, filename) < 0) {
 		errmsg.formatstr("failed to rotate job queue log!\n");
 
-		unlink(tmp_log_filename.Value());
+		unlink(tmp_filename);
 
 		int log_fd = safe_open_wrapper_follow(filename, O_RDWR | O_APPEND | O_LARGEFILE | _O_NOINHERIT, 0600);
 		if (log_fd < 0) {
@@ -326,9 +466,6 @@ bool TruncateClassAdLog(
 		return false;
 	}
 
-	// we successfully wrote and rotated, so we can update our sequence number
-	historical_sequence_number = future_sequence_number;
-
 #ifndef WIN32
 	// POSIX does not provide any durability guarantees for rename().  Instead, we must
 	// open the parent directory and invoke fsync there.
@@ -373,6 +510,214 @@ bool TruncateClassAdLog(
 }
 
 
+ClassAdLogCompaction::ClassAdLogCompaction()
+	: m_pid(0)
+	, m_result_fd(-1)
+	, m_ready(false)
+	, m_tail_offset(0)
+	, m_sequence_number(0)
+{
+}
+
+ClassAdLogCompaction::~ClassAdLogCompaction()
+{
+	Abort();
+}
+
+bool ClassAdLogCompaction::Start(
+	const char * filename,
+	FILE * log_fp,
+	LoggableClassAdTable & la,
+	const ConstructLogEntry & maker,
+	unsigned long sequence_number,
+	time_t original_log_birthdate,
+	MyString & errmsg)
+{
+#ifdef WIN32
+	errmsg = "background log rotation is not supported on this platform";
+	return false;
+#else
+	if (InProgress()) {
+		errmsg = "a background rotation is already in progress";
+		return false;
+	}
+
+	// everything up to the current end of the log is in the table, which
+	// the child sees exactly as it is now.  records appended from here on
+	// make up the tail that Finish copies onto the snapshot.
+	if (fflush(log_fp) != 0) {
+		errmsg.formatstr("flush of %s failed, errno = %d", filename, errno);
+		return false;
+	}
+	m_tail_offset = lseek(fileno(log_fp), 0, SEEK_END);
+	if (m_tail_offset < 0) {
+		errmsg.formatstr("failed to find the end of %s, errno = %d", filename, errno);
+		return false;
+	}
+
+	m_tmp_filename.formatstr("%s.compact", filename);
+	int snapshot_fd = safe_create_replace_if_exists(m_tmp_filename.Value(), O_RDWR | O_CREAT | O_LARGEFILE | _O_NOINHERIT, 0600);
+	if (snapshot_fd < 0) {
+		errmsg.formatstr("safe_create_replace_if_exists(%s) failed with errno %d (%s)",
+			m_tmp_filename.Value(), errno, strerror(errno));
+		return false;
+	}
+
+	int result_pipe[2];
+	if (pipe(result_pipe) < 0) {
+		errmsg.formatstr("pipe() failed with errno %d (%s)", errno, strerror(errno));
+		close(snapshot_fd);
+		unlink(m_tmp_filename.Value());
+		return false;
+	}
+
+	int pid = fork();
+	if (pid < 0) {
+		errmsg.formatstr("fork() failed with errno %d (%s)", errno, strerror(errno));
+		close(result_pipe[0]);
+		close(result_pipe[1]);
+		close(snapshot_fd);
+		unlink(m_tmp_filename.Value());
+		return false;
+	}
+
+	if (pid == 0) {
+		// the child writes the snapshot, reports the result, and exits without
+		// running any destructors or flushing any of the parent's buffers.
+		close(result_pipe[0]);
+		char result = '0';
+		FILE * snapshot_fp = fdopen(snapshot_fd, "w");
+		if (snapshot_fp) {
+			MyString child_errmsg;
+			if (WriteClassAdLogState(snapshot_fp, m_tmp_filename.Value(),
+					sequence_number, original_log_birthdate,
+					la, maker, child_errmsg) && fclose(snapshot_fp) == 0) {
+				result = '1';
+			}
+		}
+		if (write(result_pipe[1], &result, 1) < 0) { /* the parent will see EOF */ }
+		_exit(result == '1' ? 0 : 1);
+	}
+
+	close(snapshot_fd);
+	close(result_pipe[1]);
+	fcntl(result_pipe[0], F_SETFL, O_NONBLOCK);
+	m_result_fd = result_pipe[0];
+	m_pid = pid;
+	m_ready = false;
+	m_sequence_number = sequence_number;
+	return true;
+#endif
+}
+
+int ClassAdLogCompaction::Poll(MyString & errmsg)
+{
+	if (m_ready) {
+		return 1;
+	}
+	if (m_pid <= 0) {
+		errmsg = "no background rotation is in progress";
+		return -1;
+	}
+
+	char result = 0;
+	ssize_t cb = read(m_result_fd, &result, 1);
+	if (cb < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+		return 0;
+	}
+
+	// the child is done, one way or another.  DaemonCore will normally reap it,
+	// but reap it here too in case we are not running under DaemonCore.
+	close(m_result_fd);
+	m_result_fd = -1;
+#ifndef WIN32
+	waitpid(m_pid, NULL, WNOHANG);
+#endif
+	m_pid = 0;
+
+	if (cb == 1 && result == '1') {
+		m_ready = true;
+		return 1;
+	}
+
+	errmsg.formatstr("the child process failed to write %s", m_tmp_filename.Value());
+	unlink(m_tmp_filename.Value());
+	return -1;
+}
+
+bool ClassAdLogCompaction::Finish(const char * filename, FILE* &log_fp, MyString & errmsg)
+{
+	if ( ! m_ready) {
+		errmsg = "the background rotation is not ready";
+		return false;
+	}
+	m_ready = false;
+
+	if (fflush(log_fp) != 0) {
+		errmsg.formatstr("flush of %s failed, errno = %d", filename, errno);
+		unlink(m_tmp_filename.Value());
+		return false;
+	}
+
+	// copy the records appended to the live log since the fork onto the snapshot
+	int snapshot_fd = safe_open_wrapper_follow(m_tmp_filename.Value(), O_WRONLY | O_APPEND | O_LARGEFILE | _O_NOINHERIT, 0600);
+	if (snapshot_fd < 0) {
+		errmsg.formatstr("failed to open %s, errno = %d", m_tmp_filename.Value(), errno);
+		unlink(m_tmp_filename.Value());
+		return false;
+	}
+
+	bool copied = true;
+	int log_fd = fileno(log_fp);
+	off_t offset = m_tail_offset;
+	char buf[64*1024];
+	for (;;) {
+		ssize_t cb = pread(log_fd, buf, sizeof(buf), offset);
+		if (cb == 0) {
+			break;
+		}
+		if (cb < 0 || full_write(snapshot_fd, buf, cb) != cb) {
+			errmsg.formatstr("failed to copy the tail of %s to %s, errno = %d", filename, m_tmp_filename.Value(), errno);
+			copied = false;
+			break;
+		}
+		offset += cb;
+	}
+	if (copied && condor_fdatasync(snapshot_fd) < 0) {
+		errmsg.formatstr("fdatasync of %s failed, errno = %d", m_tmp_filename.Value(), errno);
+		copied = false;
+	}
+	close(snapshot_fd);
+	if ( ! copied) {
+		unlink(m_tmp_filename.Value());
+		return false;
+	}
+
+	fclose(log_fp);
+	log_fp = NULL;
+	return RotateClassAdLog(m_tmp_filename.Value(), filename, log_fp, errmsg);
+}
+
+void ClassAdLogCompaction::Abort()
+{
+#ifndef WIN32
+	if (m_pid > 0) {
+		kill(m_pid, SIGKILL);
+		waitpid(m_pid, NULL, 0);
+	}
+#endif
+	if (m_result_fd >= 0) {
+		close(m_result_fd);
+	}
+	if (m_pid > 0 || m_ready) {
+		unlink(m_tmp_filename.Value());
+	}
+	m_result_fd = -1;
+	m_pid = 0;
+	m_ready = false;
+}
+
+
 bool AddAttrNamesFromLogTransaction(
 	Transaction* active_transaction,
 	const char * key,
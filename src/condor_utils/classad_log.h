@@ -47,6 +47,12 @@
 #include "log_transaction.h"
 #include "stopwatch.h"
 
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
 extern const char *EMPTY_CLASSAD_TYPE_NAME;
 
 // This class is used to abstract creation and destruction of 
@@ -79,6 +85,94 @@ const ConstructClassAdLogTableEntry<ClassAd*> DefaultMakeClassAdLogTableEntry;
 extern const ConstructClassAdLogTableEntry<ClassAd*> DefaultMakeClassAdLogTableEntry;
 #endif
 
+// Group commit for a ClassAdLog.  Durable transactions are written and flushed
+// by the caller, but the fdatasync is done on a dedicated I/O thread, and all of
+// the transactions requested within window_ms of the first one share that sync.
+// Each time a sync completes a byte is written to notify_fd (if >= 0) so that the
+// owner of the log can call ClassAdLog::ProcessCompletedSyncs from its main loop.
+class ClassAdLogGroupCommit {
+public:
+	struct Batch {
+		int    commits;   // number of transactions made durable by this sync
+		double sync_time; // seconds spent in fdatasync
+	};
+
+	ClassAdLogGroupCommit(int window_ms, int notify_fd);
+	~ClassAdLogGroupCommit(); // waits for any requested sync before returning
+
+	// request a sync of fd covering everything written to it so far.
+	// returns the sequence number of the request.
+	unsigned long RequestSync(int fd);
+	unsigned long RequestedSequence();
+	unsigned long SyncedSequence();
+
+	// block until every sync requested so far has completed.
+	void WaitForSync();
+
+	// move the batches that completed since the last call into batches (which may be NULL)
+	// returns the errno of the first failed sync, or 0 if all of them succeeded.
+	int TakeCompleted(std::vector<Batch> * batches);
+
+	int WindowMs() const { return m_window_ms; }
+
+private:
+	void Run();
+
+	std::mutex m_mutex;
+	std::condition_variable m_requested_cond;
+	std::condition_variable m_synced_cond;
+	std::thread m_thread;
+	int  m_window_ms;
+	int  m_notify_fd;
+	int  m_fd;
+	unsigned long m_requested;
+	unsigned long m_synced;
+	int  m_errno;
+	bool m_stop;
+	bool m_sync_now;
+	std::vector<Batch> m_completed;
+};
+
+class LoggableClassAdTable;
+
+// Background compaction of a ClassAdLog.  A forked child writes a snapshot of
+// the table to <log>.compact while the parent keeps appending to the live log.
+// Once the child is done, Finish copies the records appended to the live log
+// since the fork onto the end of the snapshot and rotates it into place.
+class ClassAdLogCompaction {
+public:
+	ClassAdLogCompaction();
+	~ClassAdLogCompaction(); // Abort()s a compaction that is still in progress
+
+	// fork the child that writes the snapshot.  returns false if it could not be started.
+	bool Start(const char * filename, FILE * log_fp,
+		LoggableClassAdTable & la, const ConstructLogEntry & maker,
+		unsigned long sequence_number, time_t original_log_birthdate,
+		MyString & errmsg);
+
+	// returns 0 while the child is still writing the snapshot, 1 when it
+	// has been written successfully, and -1 if the child failed.
+	int Poll(MyString & errmsg);
+
+	// splice the tail of the live log onto the snapshot and rotate it into place.
+	// log_fp is closed and reopened, it is left NULL if the log could not be reopened.
+	bool Finish(const char * filename, FILE* &log_fp, MyString & errmsg);
+
+	// kill the child and remove the partial snapshot.
+	void Abort();
+
+	bool InProgress() const { return m_pid > 0 || m_ready; }
+	unsigned long SequenceNumber() const { return m_sequence_number; }
+
+private:
+	int    m_pid;
+	int    m_result_fd;     // the child writes its result here just before exiting
+	bool   m_ready;         // the child has written the snapshot
+	off_t  m_tail_offset;   // size of the live log at the time of the fork
+	unsigned long m_sequence_number;
+	MyString m_tmp_filename;
+};
+
 template <typename K, typename AD>
 class ClassAdLog {
 public:
@@ -133,10 +227,26 @@ public:
 	void AppendLog(LogRecord *log);	// perform a log operation
 	bool TruncLog();				// clean log file on disk
 
+		// Clean the log file in the background (see ClassAdLogCompaction).
+		// Returns false if the compaction could not be started, in which
+		// case the caller may use TruncLog instead.
+	bool BeginBackgroundTruncLog();
+		// Check on a background compaction, and once the child has written
+		// the snapshot, splice it into place.  Returns true while the
+		// compaction is still in progress, once it is done rotated is set
+		// to whether the log was actually rotated.
+	bool PollBackgroundTruncLog(bool * rotated = NULL);
+	bool BackgroundTruncLogInProgress() const { return m_compaction != NULL; }
+
 	void BeginTransaction();
 	bool AbortTransaction();
 	void CommitTransaction(const char * comment = NULL);
 	void CommitNondurableTransaction(const char * comment = NULL);
+		// Commit a durable transaction, but when group commit is enabled
+		// return before it is synced and leave the fsync to the I/O thread.
+		// Only for a caller that holds back its acknowledgement with
+		// WhenDurable, every other durable commit is synced before returning.
+	void CommitDeferredSyncTransaction(const char * comment = NULL);
 	bool InTransaction() { return active_transaction != NULL; }
 	int SetTransactionTriggers(int mask);
 	int GetTransactionTriggers();
@@ -171,6 +281,31 @@ public:
 		// This means doing both a flush and fsync.
 	void ForceLog();
 
+		// Turn on group commit.  Transactions committed with
+		// CommitDeferredSyncTransaction are flushed, but the fsync is left to
+		// an I/O thread that shares one fsync between all the commits made
+		// within window_ms.  CommitTransaction still syncs before returning.
+		// A byte is written to notify_fd whenever a sync completes, the
+		// caller should then call ProcessCompletedSyncs().
+	void EnableGroupCommit(int window_ms, int notify_fd);
+		// Wait for pending syncs and go back to fsync on every durable commit.
+	void DisableGroupCommit();
+	bool GroupCommitEnabled() const { return m_group_commit != NULL; }
+
+		// true if a transaction has been committed with
+		// CommitDeferredSyncTransaction that ProcessCompletedSyncs
+		// has not yet seen on disk.
+	bool SyncPending();
+
+		// call fn once every transaction committed so far is on disk.
+		// fn is called right away if there is nothing waiting to be synced,
+		// otherwise it is called from ProcessCompletedSyncs.
+	void WhenDurable(std::function<void()> fn);
+
+		// run the WhenDurable callbacks for commits that are now on disk
+		// and optionally return the completed sync batches for statistics.
+	void ProcessCompletedSyncs(std::vector<ClassAdLogGroupCommit::Batch> * batches = NULL);
+
 	bool AdExistsInTableOrTransaction(const K& key);
 
 	// returns 1 and sets val if corresponding SetAttribute found
@@ -230,6 +365,7 @@ protected:
 
 private:
 	void LogState(FILE* fp);
+	void CommitActiveTransaction(const char * comment, bool defer_sync);
 	FILE* log_fp;
 
 	char const *logFilename() { return log_filename_buf.Value(); }
@@ -240,6 +376,11 @@ private:
 	time_t m_original_log_birthdate;
 	int m_nondurable_level;
 
+	ClassAdLogGroupCommit * m_group_commit;
+	unsigned long m_durable_sequence; // group commit sequence last seen on disk by ProcessCompletedSyncs
+	std::deque< std::pair<unsigned long, std::function<void()> > > m_durable_callbacks;
+	ClassAdLogCompaction * m_compaction;
+
 	bool SaveHistoricalLogs();
 };
 
@@ -504,6 +645,9 @@ ClassAdLog<K,AD>::ClassAdLog(const char *filename,int max_historical_logs_arg,co
 	log_filename_buf = filename;
 	active_transaction = NULL;
 	m_nondurable_level = 0;
+	m_group_commit = NULL;
+	m_durable_sequence = 0;
+	m_compaction = NULL;
 
 	bool open_read_only = max_historical_logs_arg < 0;
 	if (open_read_only) { max_historical_logs_arg = -max_historical_logs_arg; }
@@ -543,6 +687,9 @@ ClassAdLog<K,AD>::ClassAdLog(const ConstructLogEntry* maker)
 	active_transaction = NULL;
 	log_fp = NULL;
 	m_nondurable_level = 0;
+	m_group_commit = NULL;
+	m_durable_sequence = 0;
+	m_compaction = NULL;
 	max_historical_logs = 0;
 	historical_sequence_number = 0;
 }
@@ -552,6 +699,12 @@ ClassAdLog<K,AD>::~ClassAdLog()
 {
 	if (active_transaction) delete active_transaction;
 
+	// the group commit thread does a final sync before it exits.
+	delete m_group_commit;
+	m_group_commit = NULL;
+	delete m_compaction;
+	m_compaction = NULL;
+
 	// cache the effective table entry maker for use in the loop.
 	const ConstructLogEntry & dtor = this->GetTableEntryMaker();
 
@@ -619,6 +772,70 @@ ClassAdLog<K,AD>::ForceLog()
 	}
 }
 
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::EnableGroupCommit(int window_ms, int notify_fd)
+{
+	if (m_group_commit) {
+		if (m_group_commit->WindowMs() == window_ms) {
+			return;
+		}
+		DisableGroupCommit();
+	}
+	m_group_commit = new ClassAdLogGroupCommit(window_ms, notify_fd);
+	m_durable_sequence = 0;
+}
+
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::DisableGroupCommit()
+{
+	if ( ! m_group_commit) {
+		return;
+	}
+	m_group_commit->WaitForSync();
+	ProcessCompletedSyncs();
+	delete m_group_commit;
+	m_group_commit = NULL;
+}
+
+template <typename K, typename AD>
+bool
+ClassAdLog<K,AD>::SyncPending()
+{
+	return m_group_commit && m_group_commit->RequestedSequence() > m_durable_sequence;
+}
+
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::WhenDurable(std::function<void()> fn)
+{
+	if ( ! SyncPending()) {
+		fn();
+		return;
+	}
+	m_durable_callbacks.emplace_back(m_group_commit->RequestedSequence(), fn);
+}
+
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::ProcessCompletedSyncs(std::vector<ClassAdLogGroupCommit::Batch> * batches)
+{
+	unsigned long synced = (unsigned long)-1;
+	if (m_group_commit) {
+		int err = m_group_commit->TakeCompleted(batches);
+		if (err) {
+			EXCEPT("fdatasync of %s failed, errno = %d", logFilename(), err);
+		}
+		synced = m_durable_sequence = m_group_commit->SyncedSequence();
+	}
+	while ( ! m_durable_callbacks.empty() && m_durable_callbacks.front().first <= synced) {
+		std::function<void()> fn = m_durable_callbacks.front().second;
+		m_durable_callbacks.pop_front();
+		fn();
+	}
+}
+
 template <typename K, typename AD>
 bool
 ClassAdLog<K,AD>::SaveHistoricalLogs()
@@ -637,6 +854,18 @@ ClassAdLog<K,AD>::TruncLog()
 		return false;
 	}
 
+	// a compaction in the background would be out of date once we are done
+	if (m_compaction) {
+		dprintf(D_ALWAYS, "Abandoning background rotation of ClassAd log %s\n", logFilename());
+		delete m_compaction;
+		m_compaction = NULL;
+	}
+
+	// the group commit thread may still be syncing the log we are about to replace
+	if (m_group_commit) {
+		m_group_commit->WaitForSync();
+	}
+
 	MyString errmsg;
 	ClassAdLogTable<K,AD> la(table); // this gives the ability to add & remove table items.
 	bool rotated = TruncateClassAdLog(logFilename(),
@@ -654,6 +883,84 @@ ClassAdLog<K,AD>::TruncLog()
 	return rotated;
 }
 
+template <typename K, typename AD>
+bool
+ClassAdLog<K,AD>::BeginBackgroundTruncLog()
+{
+	if (m_compaction) {
+		return true;
+	}
+	if ( ! log_fp) {
+		return false;
+	}
+
+	MyString errmsg;
+	ClassAdLogTable<K,AD> la(table);
+	m_compaction = new ClassAdLogCompaction();
+	if ( ! m_compaction->Start(logFilename(), log_fp,
+			la, this->GetTableEntryMaker(),
+			historical_sequence_number + 1, m_original_log_birthdate,
+			errmsg)) {
+		dprintf(D_ALWAYS, "Cannot rotate ClassAd log %s in the background: %s\n", logFilename(), errmsg.Value());
+		delete m_compaction;
+		m_compaction = NULL;
+		return false;
+	}
+
+	dprintf(D_ALWAYS, "Rotating ClassAd log %s in the background\n", logFilename());
+	return true;
+}
+
+template <typename K, typename AD>
+bool
+ClassAdLog<K,AD>::PollBackgroundTruncLog(bool * rotated_out)
+{
+	if (rotated_out) { *rotated_out = false; }
+	if ( ! m_compaction) {
+		return false;
+	}
+
+	MyString errmsg;
+	int rval = m_compaction->Poll(errmsg);
+	if (rval == 0) {
+		return true;
+	}
+	if (rval < 0) {
+		dprintf(D_ALWAYS, "Background rotation of ClassAd log %s failed: %s\n", logFilename(), errmsg.Value());
+		delete m_compaction;
+		m_compaction = NULL;
+		return false;
+	}
+
+	if ( ! SaveHistoricalLogs()) {
+		dprintf(D_ALWAYS, "Skipping log rotation, because saving of historical log failed for %s.\n", logFilename());
+		delete m_compaction;
+		m_compaction = NULL;
+		return false;
+	}
+
+	// the group commit thread may still be syncing the log we are about to replace
+	if (m_group_commit) {
+		m_group_commit->WaitForSync();
+	}
+
+	bool rotated = m_compaction->Finish(logFilename(), log_fp, errmsg);
+	if ( ! log_fp) {
+		EXCEPT("%s", errmsg.Value());
+	}
+	if (rotated) {
+		if (rotated_out) { *rotated_out = true; }
+		historical_sequence_number = m_compaction->SequenceNumber();
+		dprintf(D_ALWAYS, "Finished rotating ClassAd log %s in the background\n", logFilename());
+	}
+	if ( ! errmsg.empty()) {
+		dprintf(D_ALWAYS, "%s\n", errmsg.Value());
+	}
+	delete m_compaction;
+	m_compaction = NULL;
+	return false;
+}
+
 template <typename K, typename AD>
 void
 ClassAdLog<K,AD>::LogState(FILE *fp)
@@ -712,6 +1019,20 @@ ClassAdLog<K,AD>::AbortTransaction()
 template <typename K, typename AD>
 void
 ClassAdLog<K,AD>::CommitTransaction(const char * comment /*=NULL*/)
+{
+	CommitActiveTransaction(comment, false);
+}
+
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::CommitDeferredSyncTransaction(const char * comment /*=NULL*/)
+{
+	CommitActiveTransaction(comment, true);
+}
+
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::CommitActiveTransaction(const char * comment, bool defer_sync)
 {
 	// Sometimes we do a CommitTransaction() when we don't know if there was
 	// an active transaction.  This is allowed.
@@ -722,7 +1043,14 @@ ClassAdLog<K,AD>::CommitTransaction(const char * comment /*=NULL*/)
 		active_transaction->AppendLog(log);
 		bool nondurable = m_nondurable_level > 0;
 		ClassAdLogTable<K,AD> la(table);
-		active_transaction->Commit(log_fp, logFilename(), &la, nondurable );
+		if ( ! nondurable && defer_sync && m_group_commit && log_fp) {
+			// write and flush now, the group commit thread does the fdatasync
+			active_transaction->Commit(log_fp, logFilename(), &la, true);
+			FlushLog();
+			m_group_commit->RequestSync(fileno(log_fp));
+		} else {
+			active_transaction->Commit(log_fp, logFilename(), &la, nondurable );
+		}
 	}
 	delete active_transaction;
 	active_transaction = NULL;
@@ -18,6 +18,7 @@
  ***************************************************************/
 
 #include "condor_common.h"
+#include <atomic>
 #include "stream.h"
 #include "reli_sock.h"
 #include "condor_classad.h"
@@ -30,12 +31,16 @@ using namespace std;
 #include "classad/classad_distribution.h"
 #include "classad_oldnew.h"
 #include "compat_classad.h"
+#include "classad_binary.h"
 
 // local helper functions, options are one or more of PUT_CLASSAD_* flags
 int _putClassAd(Stream *sock, const classad::ClassAd& ad, int options,
 	const classad::References *encrypted_attrs);
 int _putClassAd(Stream *sock, const classad::ClassAd& ad, int options,
 	const classad::References &whitelist, const classad::References *encrypted_attrs);
+int _putClassAdBinary(Stream *sock, const classad::ClassAd& ad, int options,
+	const classad::References *whitelist, const classad::References *encrypted_attrs);
+bool _getClassAdBinary(Stream *sock, classad::ClassAd& ad, bool use_cache);
 int _mergeStringListIntoWhitelist(StringList & list_in, classad::References & whitelist_out);
 
 
@@ -77,7 +82,14 @@ bool getClassAd( Stream *sock, classad::ClassAd& ad )
 	// at least numExprs are coming, but we may add
 	// my, target, and a couple extra right away
 
-	ad.rehash(numExprs + 5);
+	if (numExprs == CLASSAD_BINARY_MARKER) {
+		if ( ! _getClassAdBinary(sock, ad, true)) {
+			return false;
+		}
+		numExprs = 0;
+	} else {
+		ad.rehash(numExprs + 5);
+	}
 
 		// pack exprs into classad
 	for( int i = 0 ; i < numExprs ; i++ ) {
@@ -255,7 +267,12 @@ bool getClassAdEx( Stream *sock, classad::ClassAd& ad, int options)
 	// my, target, and a couple extra right away
 	// Auth (id,method) update(total,seq,lost,history)
 
-	if ( ! (options & GET_CLASSAD_NO_CLEAR)) {
+	if (numExprs == CLASSAD_BINARY_MARKER) {
+		if ( ! _getClassAdBinary(sock, ad, use_cache)) {
+			return false;
+		}
+		numExprs = 0;
+	} else if ( ! (options & GET_CLASSAD_NO_CLEAR)) {
 		ad.rehash(numExprs + 2 + 7);
 	}
 
@@ -437,6 +454,26 @@ getClassAdNoTypes( Stream *sock, classad::ClassAd& ad )
  		return false;
 	}
 
+	if (numExprs == CLASSAD_BINARY_MARKER) {
+		if ( ! _getClassAdBinary(sock, ad, false)) {
+			return false;
+		}
+			// the text form can't carry these names, see below
+		std::vector<std::string> limits;
+		for (auto itr = ad.begin(); itr != ad.end(); ++itr) {
+			if (strncmp(itr->first.c_str(), "ConcurrencyLimit.", 17) == 0) {
+				limits.push_back(itr->first);
+			}
+		}
+		for (auto & attr : limits) {
+			std::string renamed = attr;
+			renamed[16] = '_';
+			ExprTree *tree = ad.Remove(attr);
+			ad.Insert(renamed, tree);
+		}
+		return true;
+	}
+
 		// pack exprs into classad
 	buffer = "[";
 	for( int i = 0 ; i < numExprs ; i++ ) {
@@ -541,6 +578,9 @@ int mergeProjectionFromQueryAd(classad::ClassAd & queryAd, const char * attr_pro
 int putClassAd ( Stream *sock, const classad::ClassAd& ad )
 {
 	int options = 0;
+	if (peerAcceptsBinaryClassAds(sock)) {
+		return _putClassAdBinary(sock, ad, options, nullptr, nullptr);
+	}
 	return _putClassAd(sock, ad, options, nullptr);
 }
 
@@ -568,12 +608,15 @@ int putClassAd (Stream *sock, const classad::ClassAd& ad, int options, const cla
 		whitelist = &expanded_whitelist;
 	}
 
+	bool binary = peerAcceptsBinaryClassAds(sock);
 	bool non_blocking = (options & PUT_CLASSAD_NON_BLOCKING) != 0;
 	ReliSock* rsock = static_cast<ReliSock*>(sock);
 	if (non_blocking && rsock)
 	{
 		BlockingModeGuard guard(rsock, true);
-		if (whitelist) {
+		if (binary) {
+			retval = _putClassAdBinary(sock, ad, options, whitelist, encrypted_attrs);
+		} else if (whitelist) {
 			retval = _putClassAd(sock, ad, options, *whitelist, encrypted_attrs);
 		} else {
 			retval = _putClassAd(sock, ad, options, encrypted_attrs);
@@ -583,7 +626,9 @@ int putClassAd (Stream *sock, const classad::ClassAd& ad, int options, const cla
 	}
 	else // normal blocking mode put
 	{
-		if (whitelist) {
+		if (binary) {
+			retval = _putClassAdBinary(sock, ad, options, whitelist, encrypted_attrs);
+		} else if (whitelist) {
 			retval = _putClassAd(sock, ad, options, *whitelist, encrypted_attrs);
 		} else {
 			retval = _putClassAd(sock, ad, options, encrypted_attrs);
@@ -818,3 +863,161 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options, const cl
 
 	return _putClassAdTrailingInfo(sock, ad, send_server_time, excludeTypes);
 }
+
+// set from ENABLE_BINARY_CLASSAD_ENCODING by ClassAdReconfig() on the main
+// thread, since ads are also sent from the collector's query threads.
+static std::atomic<bool> binary_classad_encoding(false);
+
+void setBinaryClassAdEncoding(bool enable)
+{
+	binary_classad_encoding = enable;
+}
+
+bool peerAcceptsBinaryClassAds(Stream *sock)
+{
+	if ( ! sock || sock->type() != Stream::reli_sock) {
+		return false;
+	}
+	ReliSock::ClassAdWireState &wire = static_cast<ReliSock*>(sock)->classad_wire_state();
+	if (wire.use_binary < 0) {
+			// the peer tells us in the security handshake whether it can
+			// read binary ads, until then we don't know who we are talking to
+		if ( ! sock->get_peer_binary_classads()) {
+			return false;
+		}
+		wire.use_binary = binary_classad_encoding;
+	}
+	return wire.use_binary > 0;
+}
+
+// Send the ad as a single block in the binary encoding, see classad_binary.h.
+// Attributes that must be sent with put_secret() follow the block as text.
+//
+int _putClassAdBinary(Stream *sock, const classad::ClassAd& ad, int options,
+	const classad::References *whitelist, const classad::References *encrypted_attrs)
+{
+	bool excludeTypes = (options & PUT_CLASSAD_NO_TYPES) == PUT_CLASSAD_NO_TYPES;
+	bool exclude_private = (options & PUT_CLASSAD_NO_PRIVATE) == PUT_CLASSAD_NO_PRIVATE;
+	bool crypto_is_noop = sock->prepare_crypto_for_secret_is_noop();
+
+	ReliSock::ClassAdWireState &wire = static_cast<ReliSock*>(sock)->classad_wire_state();
+	std::string buf;
+	buf.reserve(8192);
+	ClassAdBinaryWriter writer(wire.sent_names, buf);
+
+	classad::ClassAdUnParser unp;
+	unp.SetOldClassAd( true, true );
+	std::vector<std::string> secrets;
+
+	auto add_attr = [&](const std::string &attr, const classad::ExprTree *expr) {
+		if (publish_server_timeMangled && strcasecmp(attr.c_str(), ATTR_SERVER_TIME) == 0) {
+			return; // we send our own below
+		}
+		if (ClassAdAttributeIsPrivate(attr) ||
+			(encrypted_attrs && (encrypted_attrs->find(attr) != encrypted_attrs->end())))
+		{
+			if (exclude_private) {
+				return;
+			}
+			if ( ! crypto_is_noop) {
+				secrets.emplace_back(attr);
+				secrets.back() += " = ";
+				unp.Unparse(secrets.back(), expr);
+				return;
+			}
+		}
+		writer.Add(attr, expr);
+	};
+
+	if (whitelist) {
+		for (auto attr = whitelist->begin(); attr != whitelist->end(); ++attr) {
+			classad::ExprTree const *expr = ad.Lookup(*attr);
+			if (expr) {
+				add_attr(*attr, expr);
+			}
+		}
+	} else {
+			// chained attributes first, so the ad's own attributes replace them
+		const classad::ClassAd *chainedAd = ad.GetChainedParentAd();
+		if (chainedAd) {
+			for (auto itor = chainedAd->begin(); itor != chainedAd->end(); ++itor) {
+				add_attr(itor->first, itor->second);
+			}
+		}
+		for (auto itor = ad.begin(); itor != ad.end(); ++itor) {
+			add_attr(itor->first, itor->second);
+		}
+	}
+
+	if (publish_server_timeMangled) {
+		writer.Add(ATTR_SERVER_TIME, (long long)time(NULL));
+	}
+
+	sock->encode( );
+	int marker = CLASSAD_BINARY_MARKER;
+	int len = (int)buf.size();
+	int num_secrets = (int)secrets.size();
+	if ( ! sock->code(marker) || ! sock->code(len) ||
+		sock->put_bytes(buf.data(), len) != len ||
+		! sock->code(num_secrets))
+	{
+		return false;
+	}
+	for (auto & secret : secrets) {
+		if ( ! sock->put_secret(secret.c_str())) {
+			return false;
+		}
+	}
+
+	return _putClassAdTrailingInfo(sock, ad, false, excludeTypes);
+}
+
+// Receive the rest of an ad sent by _putClassAdBinary(), after the marker.
+//
+bool _getClassAdBinary(Stream *sock, classad::ClassAd& ad, bool use_cache)
+{
+	if (sock->type() != Stream::reli_sock) {
+		dprintf(D_ALWAYS, "getClassAd FAILED: binary ad received on a %s socket\n",
+			sock->type() == Stream::safe_sock ? "UDP" : "non-TCP");
+		return false;
+	}
+	ReliSock::ClassAdWireState &wire = static_cast<ReliSock*>(sock)->classad_wire_state();
+
+	int len = 0;
+	if ( ! sock->code(len) || len < 0) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get size of binary ad\n");
+		return false;
+	}
+	std::string buf;
+	buf.resize(len);
+	if (len && sock->get_bytes(&buf[0], len) != len) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get binary ad\n");
+		return false;
+	}
+
+	ClassAdBinaryReader reader(wire.received_names);
+	if ( ! reader.Read(buf.data(), buf.size(), ad, use_cache)) {
+		dprintf(D_ALWAYS, "getClassAd FAILED to decode binary ad from %s: %s\n",
+			sock->peer_description(), reader.Error().c_str());
+		return false;
+	}
+
+	int num_secrets = 0;
+	if ( ! sock->code(num_secrets)) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get number of encrypted expressions\n");
+		return false;
+	}
+	for (int ii = 0; ii < num_secrets; ++ii) {
+		const char *strptr = NULL;
+		int cb = 0;
+		if ( ! sock->get_secret(strptr, cb) || ! strptr) {
+			dprintf(D_FULLDEBUG, "getClassAd Failed to read encrypted ClassAd expression.\n");
+			return false;
+		}
+		if ( ! InsertLongFormAttrValue(ad, strptr, use_cache)) {
+			dprintf(D_ALWAYS, "getClassAd FAILED to insert secret %s\n", strptr);
+			return false;
+		}
+	}
+	return true;
+}
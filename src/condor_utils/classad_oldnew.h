@@ -81,6 +81,16 @@ int putClassAd (Stream *sock, const classad::ClassAd& ad, int options,
 #define PUT_CLASSAD_NON_BLOCKING        0x04 // use non-blocking sematics. returns 2 of this would have blocked.
 #define PUT_CLASSAD_NO_EXPAND_WHITELIST 0x08 // use the whitelist argument as-is, (default is to expand internal references before using it)
 
+/** Returns true if ClassAds sent on this stream use the binary encoding
+ *  of classad_binary.h rather than text.  This is only true on a ReliSock
+ *  whose peer said in the security handshake that it can decode it, and
+ *  only if ENABLE_BINARY_CLASSAD_ENCODING is true.  getClassAd() accepts both.
+ */
+bool peerAcceptsBinaryClassAds(Stream *sock);
+
+/** Turn the binary encoding on or off, for ClassAdReconfig(). */
+void setBinaryClassAdEncoding(bool enable);
+
 // fetch the given attribute from the queryAd and convert it into a set of attributes
 //   the attribute should be a string value containing a comma and/or space separated list of attributes (like StringList)
 //   if allow_list is true, then attribute is permitted to be a classad list of strings each of which is an attribute of the projection.
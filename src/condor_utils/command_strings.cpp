@@ -148,6 +148,7 @@ const struct Translation DCTranslation[] = {
 	{ "DC_INVALIDATE_KEY", DC_INVALIDATE_KEY },
 	{ "FILETRANS_UPLOAD", FILETRANS_UPLOAD },
 	{ "FILETRANS_DOWNLOAD", FILETRANS_DOWNLOAD },
+	{ "FILETRANS_STREAM", FILETRANS_STREAM },
 //	{ "PW_SETPASS", PW_SETPASS },					/* Not used */
 //	{ "PW_GETPASS", PW_GETPASS },					/* Not used */
 //	{ "PW_CLEARPASS", PW_CLEARPASS },				/* Not used */
@@ -306,6 +307,7 @@ const struct Translation CollectorTranslation[] = {
 	{ "QUERY_GRID_ADS", QUERY_GRID_ADS },
 	{ "INVALIDATE_GRID_ADS", INVALIDATE_GRID_ADS },
 	{ "MERGE_STARTD_AD", MERGE_STARTD_AD },
+	{ "UPDATE_STARTD_AD_DELTA", UPDATE_STARTD_AD_DELTA },
 	{ "UPDATE_ACCOUNTING_AD", UPDATE_ACCOUNTING_AD },
 	{ "QUERY_ACCOUNTING_ADS", QUERY_ACCOUNTING_ADS },
 	{ "INVALIDATE_ACCOUNTING_ADS", INVALIDATE_ACCOUNTING_ADS },
@@ -101,7 +101,10 @@ bool IsAMatch( ClassAd *ad1, ClassAd *ad2 );
 
 bool IsAHalfMatch( ClassAd *my, ClassAd *target );
 
-bool ParallelIsAMatch(ClassAd *ad1, std::vector<ClassAd*> &candidates, std::vector<ClassAd*> &matches, int threads, bool halfMatch = false);
+// Match ad1 against each of the candidates using up to the given number
+// of threads, appending the ones that match to matches.  If ranks is
+// non-NULL, it gets ad1's Rank of each of the matches, in the same order.
+bool ParallelIsAMatch(ClassAd *ad1, std::vector<ClassAd*> &candidates, std::vector<ClassAd*> &matches, int threads, bool halfMatch = false, std::vector<double> *ranks = NULL);
 
 void AddClassAdXMLFileHeader(std::string &buffer);
 void AddClassAdXMLFileFooter(std::string &buffer);
@@ -1180,6 +1180,9 @@ real_config(const char* host, int wantsQuiet, int config_options, const char * r
 		// Re-initialize the ClassAd compat data (in case if CLASSAD_USER_LIBS is set).
 	ClassAdReconfig();
 
+		// now that the config is loaded, update the cached values of the param handles.
+	param_handle::refresh_all();
+
 	return true;
 }
 
@@ -1950,6 +1953,7 @@ param_insert(const char * name, const char * value)
 	MACRO_EVAL_CONTEXT ctx;
 	init_macro_eval_context(ctx);
 	insert_macro(name, value, ConfigMacroSet, WireMacro, ctx);
+	param_handle::refresh_named(name);
 }
 
 // set the value of a param equal to the given pointer. if the param is
@@ -1976,6 +1980,7 @@ const char * set_live_param_value(const char * name, const char * live_value)
 	} else {
 		pitem->raw_value = live_value;
 	}
+	param_handle::refresh_named(name);
 	return old_value;
 }
 
@@ -2095,6 +2100,57 @@ char *param_with_context(const char *name, const char *subsys, const char *local
 	return param_ctx(name, ctx);
 }
 
+// count of calls to param_ctx, published by DaemonCore so that knobs that are looked up
+// on every request show up in the daemon statistics.
+static std::atomic<unsigned int> param_lookups(0);
+
+unsigned int param_lookup_count()
+{
+	return param_lookups.load(std::memory_order_relaxed);
+}
+
+// the list of all param handles, this is a function static so that handles
+// declared at file scope in other modules can be constructed in any order.
+static param_handle * & param_handle_list()
+{
+	static param_handle * head = NULL;
+	return head;
+}
+
+param_handle::param_handle(const char * name)
+	: m_name(name)
+	, m_next(param_handle_list())
+	, m_loaded(false)
+{
+	param_handle_list() = this;
+}
+
+param_handle::~param_handle()
+{
+	for (param_handle ** pp = &param_handle_list(); *pp; pp = &(*pp)->m_next) {
+		if (*pp == this) {
+			*pp = m_next;
+			break;
+		}
+	}
+}
+
+void param_handle::refresh_all()
+{
+	for (param_handle * ph = param_handle_list(); ph; ph = ph->m_next) {
+		ph->load();
+	}
+}
+
+void param_handle::refresh_named(const char * name)
+{
+	for (param_handle * ph = param_handle_list(); ph; ph = ph->m_next) {
+		if (MATCH == strcasecmp(ph->m_name, name)) {
+			ph->load();
+		}
+	}
+}
+
 char*
 param_ctx(const char* name, MACRO_EVAL_CONTEXT & ctx)
 {
@@ -2113,6 +2169,8 @@ param_ctx(const char* name, MACRO_EVAL_CONTEXT & ctx)
 	}
 #endif
 
+	param_lookups.fetch_add(1, std::memory_order_relaxed);
+
 	const char * pval = lookup_macro(name, ConfigMacroSet, ctx);
 	if ( ! pval || ! pval[0]) {
 		// If we don't find any value at all, return NULL
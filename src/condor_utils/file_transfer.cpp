@@ -44,6 +44,7 @@
 #include "condor_url.h"
 #include "my_popen.h"
 #include "file_transfer_stats.h"
+#include "file_transfer_streams.h"
 #include "utc_time.h"
 #include "data_reuse.h"
 #include "AWSv4-utils.h"
@@ -289,6 +290,7 @@ FileTransfer::~FileTransfer()
 		delete last_download_catalog;
 	}
 	if (TransSock) free(TransSock);
+	CloseDataStreams();
 	stopServer();
 	// Do not delete the TransThreadTable. There may be other FileTransfer
 	// objects out there planning to use it.
@@ -934,6 +936,9 @@ FileTransfer::Init(
 		daemonCore->Register_Command(FILETRANS_DOWNLOAD,"FILETRANS_DOWNLOAD",
 				&FileTransfer::HandleCommands,
 				"FileTransfer::HandleCommands()",WRITE);
+		daemonCore->Register_Command(FILETRANS_STREAM,"FILETRANS_STREAM",
+				&FileTransfer::HandleCommands,
+				"FileTransfer::HandleCommands()",WRITE);
 		ReaperId = daemonCore->Register_Reaper("FileTransfer::Reaper",
 							&FileTransfer::Reaper,
 							"FileTransfer::Reaper()");
@@ -1121,6 +1126,8 @@ FileTransfer::DownloadFiles(bool blocking)
 			EXCEPT("FileTransfer: DownloadFiles called on server side");
 		}
 
+		OpenDataStreams();
+
 		sock.timeout(clientSockTimeout);
 
 		if (IsDebugLevel(D_COMMAND)) {
@@ -1495,6 +1502,8 @@ FileTransfer::UploadFiles(bool blocking, bool final_transfer)
 			return 1;
 		}
 
+		OpenDataStreams();
+
 		sock.timeout(clientSockTimeout);
 
 		if (IsDebugLevel(D_COMMAND)) {
@@ -1549,6 +1558,81 @@ FileTransfer::UploadFiles(bool blocking, bool final_transfer)
 	return( retval );
 }
 
+void
+FileTransfer::OpenDataStreams()
+{
+	CloseDataStreams();
+
+	int wanted = 0;
+	jobAd.LookupInteger(ATTR_PARALLEL_TRANSFER_STREAMS, wanted);
+	int max_streams = param_integer("MAX_PARALLEL_TRANSFER_STREAMS", 4);
+	if ( wanted > max_streams ) {
+		dprintf( D_FULLDEBUG, "FileTransfer: limiting %s=%d to "
+				 "MAX_PARALLEL_TRANSFER_STREAMS=%d\n",
+				 ATTR_PARALLEL_TRANSFER_STREAMS, wanted, max_streams );
+		wanted = max_streams;
+	}
+	if ( wanted < 2 || !PeerDoesParallelStreams ) {
+		return;
+	}
+
+		// The tag lets the server tell our streams from any left over
+		// from an earlier transfer.
+	formatstr( m_data_stream_tag, "%x#%x%x", (unsigned)time(NULL),
+			   get_csrng_int(), get_csrng_int() );
+
+	Daemon d( DT_ANY, TransSock );
+	for ( int i = 0; i < wanted; i++ ) {
+		ReliSock *sock = new ReliSock;
+		sock->timeout(clientSockTimeout);
+
+		CondorError err_stack;
+		int accepted = 0;
+		if ( !d.connectSock(sock,0) ||
+			 !d.startCommand(FILETRANS_STREAM, sock, clientSockTimeout, &err_stack, NULL, false, m_sec_session_id) )
+		{
+			dprintf( D_ALWAYS, "FileTransfer: failed to open transfer stream "
+					 "%d to %s: %s\n", i + 1, TransSock,
+					 err_stack.getFullText().c_str() );
+			delete sock;
+			break;
+		}
+
+		sock->encode();
+		if ( !sock->put_secret(TransKey) ||
+			 !sock->put(m_data_stream_tag) ||
+			 !sock->end_of_message() )
+		{
+			dprintf( D_ALWAYS, "FileTransfer: failed to send transfer stream "
+					 "%d request to %s\n", i + 1, TransSock );
+			delete sock;
+			break;
+		}
+		sock->decode();
+		if ( !sock->code(accepted) || !sock->end_of_message() || !accepted ) {
+				// The server has as many as it will take.
+			dprintf( D_FULLDEBUG, "FileTransfer: server %s did not accept "
+					 "transfer stream %d\n", TransSock, i + 1 );
+			delete sock;
+			break;
+		}
+		m_data_streams.push_back(sock);
+	}
+
+	dprintf( D_FULLDEBUG, "FileTransfer: opened %d of %d transfer streams to %s\n",
+			 (int)m_data_streams.size(), wanted, TransSock );
+}
+
+void
+FileTransfer::CloseDataStreams()
+{
+	for ( ReliSock *sock : m_data_streams ) {
+		delete sock;
+	}
+	m_data_streams.clear();
+	m_data_stream_tag.clear();
+}
+
 int
 FileTransfer::HandleCommands(int command, Stream *s)
 {
@@ -1636,6 +1720,33 @@ FileTransfer::HandleCommands(int command, Stream *s)
 		case FILETRANS_DOWNLOAD:
 			transobject->Download(sock,ServerShouldBlock);
 			break;
+		case FILETRANS_STREAM:
+			{
+			std::string tag;
+			if ( !sock->get(tag) || !sock->end_of_message() ) {
+				dprintf(D_FULLDEBUG,
+					"FileTransfer::HandleCommands failed to read stream tag\n");
+				return 0;
+			}
+			if ( tag != transobject->m_data_stream_tag ) {
+					// A new transfer; drop the streams of any old one.
+				transobject->CloseDataStreams();
+				transobject->m_data_stream_tag = tag;
+			}
+
+			int max_streams = param_integer("MAX_PARALLEL_TRANSFER_STREAMS", 4);
+			int accepted = transobject->ActiveTransferTid < 0 &&
+				(int)transobject->m_data_streams.size() < max_streams;
+
+			sock->encode();
+			if ( !sock->code(accepted) || !sock->end_of_message() || !accepted ) {
+				return 0;
+			}
+			dprintf(D_FULLDEBUG, "FileTransfer: accepted transfer stream %d from %s\n",
+				(int)transobject->m_data_streams.size() + 1, sock->peer_description());
+			transobject->m_data_streams.push_back(sock);
+			return KEEP_STREAM;
+			}
 		default:
 			dprintf(D_ALWAYS,
 				"FileTransfer::HandleCommands: unrecognized command %d\n",
@@ -1667,6 +1778,7 @@ FileTransfer::Reaper(int pid, int exit_status)
 	}
 	transobject->ActiveTransferTid = -1;
 	TransThreadTable->remove(pid);
+	transobject->CloseDataStreams();
 
 	transobject->Info.duration = time(NULL)-transobject->TransferStart;
 	transobject->Info.in_progress = false;
@@ -1935,6 +2047,7 @@ FileTransfer::Download(ReliSock *s, bool blocking)
 	if (blocking) {
 
 		int status = DoDownload( &Info.bytes, (ReliSock *) s );
+		CloseDataStreams();
 		Info.duration = time(NULL)-TransferStart;
 		Info.success = ( status >= 0 );
 		Info.in_progress = false;
@@ -2030,6 +2143,7 @@ FileTransfer::AddDownloadFilenameRemaps(char const *remaps) {
 */
 
 #define return_and_resetpriv(i)                     \
+    streams.reset();                                \
     if( saved_priv != PRIV_UNKNOWN )                \
         _set_priv(saved_priv,__FILE__,__LINE__,1);  \
     if ( m_reuse_dir && !reservation_id.empty() ) { \
@@ -2074,8 +2188,13 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 	DCTransferQueue xfer_queue(m_xfer_queue_contact_info);
 	CondorError errstack;
 
+		// Files our peer sends over the extra data connections, if any.
+	std::unique_ptr<FileTransferStreams> streams;
+	int main_sock_timeout = 0;
+
 	priv_state saved_priv = PRIV_UNKNOWN;
 	*total_bytes = 0;
+	m_stream_stats.clear();
 
 	downloadStartTime = condor_gettimestamp_double();
 
@@ -2138,6 +2257,8 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 //	dprintf(D_FULLDEBUG,"TODD filetransfer DoDownload final_transfer=%d\n",final_transfer);
 
 	filesize_t sandbox_size = 0;
+	int peer_data_streams = 0;
+	std::string peer_data_stream_tag;
 	if( PeerDoesXferInfo ) {
 		ClassAd xfer_info;
 		if( !getClassAd(s,xfer_info) ) {
@@ -2145,6 +2266,8 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 			return_and_resetpriv( -1 );
 		}
 		xfer_info.LookupInteger(ATTR_SANDBOX_SIZE,sandbox_size);
+		xfer_info.LookupInteger("TransferStreams",peer_data_streams);
+		xfer_info.LookupString("TransferStreamTag",peer_data_stream_tag);
 	}
 
 	if( !s->end_of_message() ) {
@@ -2152,6 +2275,31 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 		return_and_resetpriv( -1 );
 	}
 
+	if( peer_data_streams > 0 ) {
+			// Our peer wants to stripe files across the extra
+			// connections; make sure we have the same ones.
+		int accepted = peer_data_streams == (int)m_data_streams.size() &&
+			peer_data_stream_tag == m_data_stream_tag;
+		if( !accepted ) {
+			dprintf(D_ALWAYS,"DoDownload: have %d of the %d transfer streams "
+				"our peer opened; receiving all files on the main connection\n",
+				peer_data_stream_tag == m_data_stream_tag ? (int)m_data_streams.size() : 0,
+				peer_data_streams);
+		}
+		s->encode();
+		if( !s->code(accepted) || !s->end_of_message() ) {
+			dprintf(D_FULLDEBUG,"DoDownload: exiting at %d\n",__LINE__);
+			return_and_resetpriv( -1 );
+		}
+		s->decode();
+		if( accepted ) {
+			streams.reset(new FileTransferStreams(m_data_streams, true));
+				// The main connection may sit idle while the streams
+				// carry the data.
+			main_sock_timeout = s->timeout(0);
+		}
+	}
+
 	if( !final_transfer && IsServer() ) {
 		SpooledJobFiles::createJobSpoolDirectory(&jobAd,desired_priv_state);
 	}
@@ -2343,6 +2491,18 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 			s->decode();
 		}
 
+			// Our peer says which stream, if any, carries a plain file.
+		int data_stream = 0;
+		if( streams && (xfer_command == TransferCommand::XferFile ||
+						xfer_command == TransferCommand::EnableEncryption ||
+						xfer_command == TransferCommand::DisableEncryption) )
+		{
+			if( !s->code(data_stream) || data_stream < 0 || data_stream > streams->size() ) {
+				dprintf(D_FULLDEBUG,"DoDownload: exiting at %d\n",__LINE__);
+				return_and_resetpriv( -1 );
+			}
+		}
+
 		UpdateXferStatus(XFER_STATUS_ACTIVE);
 
 		filesize_t this_file_max_bytes = -1;
@@ -2389,7 +2549,8 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 		thisFileStats.TransferFileBytes = 0;
 		thisFileStats.TransferFileName = filename.Value();
 		thisFileStats.TransferProtocol = "cedar";
-		thisFileStats.TransferStartTime = condor_gettimestamp_double();
+		double transfer_start = condor_gettimestamp_double();
+		thisFileStats.TransferStartTime = transfer_start;
 		thisFileStats.TransferType = "download";
 
 		// Create a ClassAd we'll use to store stats from a file transfer
@@ -2400,6 +2561,28 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 		// deferred until the end of the loop.
 		isDeferredTransfer = false;
 
+		if( data_stream > 0 ) {
+				// The file follows on one of the data streams; the rest
+				// of what we do for it happens once that is done.
+			FileTransferStreams::Job *job = new FileTransferStreams::Job;
+			job->fullname = fullname.Value();
+			job->filename = filename.Value();
+			job->stream = data_stream;
+			job->encrypt = s->get_encryption();
+			job->with_permissions = TransferFilePermissions;
+			job->max_bytes = this_file_max_bytes;
+			if( should_reuse ) {
+				job->reuse_index = iter - reuse_info.begin();
+			}
+			streams->Submit(job, 0);
+
+			if( !s->end_of_message() ) {
+				return_and_resetpriv( -1 );
+			}
+			numFiles++;
+			continue;
+		}
+
 		if (xfer_command == TransferCommand::Other) {
 			// filename already received:
 			// .  verify that it is the same as FileName attribute in following classad
@@ -2860,8 +3043,10 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 		}
 
 		elapsed = time(NULL)-start;
-		thisFileStats.TransferEndTime = condor_gettimestamp_double();
-		thisFileStats.ConnectionTimeSeconds = thisFileStats.TransferEndTime - thisFileStats.TransferStartTime;
+		double transfer_end = condor_gettimestamp_double();
+		thisFileStats.TransferEndTime = transfer_end;
+			// TransferStartTime and TransferEndTime are whole seconds
+		thisFileStats.ConnectionTimeSeconds = transfer_end - transfer_start;
 
 		if( rc < 0 ) {
 			int the_error = errno;
@@ -2994,6 +3179,86 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 	}
 	// End of the main download loop
 
+	if( streams ) {
+			// Wait for the files on the data streams, and finish up
+			// each one as the loop above would have.
+		for( auto &job : streams->Finish() ) {
+			rc = job->rc;
+			if( rc == 0 && job->reuse_index >= 0 ) {
+				auto &info = reuse_info[job->reuse_index];
+				CondorError err;
+				if( !m_reuse_dir->CacheFile(job->fullname.c_str(), info.checksum(),
+					info.checksum_type(), reservation_id, err) )
+				{
+					dprintf(D_FULLDEBUG, "Failed to save file %s for reuse: %s\n",
+						job->fullname.c_str(), err.getFullText().c_str());
+					if (!strcmp(err.subsys(), "DataReuse") && err.code() == 11) {
+						rc = -1;
+					}
+				}
+			}
+
+			if( rc < 0 ) {
+				int the_error = job->error;
+				error_buf.formatstr("%s at %s failed to receive file %s",
+				                  get_mySubSystem()->getName(),
+								  s->my_ip_str(),job->fullname.c_str());
+				download_success = false;
+				hold_code = CONDOR_HOLD_CODE_DownloadFileError;
+				hold_subcode = the_error;
+				if( rc == GET_FILE_OPEN_FAILED || rc == GET_FILE_WRITE_FAILED ) {
+					error_buf.replaceString("receive","write to");
+					error_buf.formatstr_cat(": (errno %d) %s",the_error,strerror(the_error));
+					try_again = false;
+				} else {
+						// Unlike the main connection, a broken stream
+						// leaves the protocol intact, so we can still
+						// report this in the ack.
+					try_again = true;
+				}
+				dprintf(D_ALWAYS,"DoDownload: %s (stream %d)\n",error_buf.Value(),job->stream);
+			}
+
+			if ( rc == 0 && ExecFile && !file_strcmp( condor_basename( ExecFile ), job->filename.c_str() ) ) {
+				if ( chmod( job->fullname.c_str(), 0755 ) < 0 ) {
+					dprintf( D_ALWAYS, "Failed to set execute bit on %s, errno=%d (%s)\n",
+							 job->fullname.c_str(), errno, strerror(errno) );
+				}
+			}
+
+			if ( rc == 0 && want_fsync ) {
+				struct utimbuf timewrap;
+				time_t current_time = time(NULL);
+				timewrap.actime = current_time;
+				timewrap.modtime = current_time;
+				utime(job->fullname.c_str(),&timewrap);
+			}
+
+			*total_bytes += job->bytes;
+
+			FileTransferStats thisFileStats;
+			thisFileStats.TransferFileName = job->filename;
+			thisFileStats.TransferProtocol = "cedar";
+			thisFileStats.TransferType = "download";
+			thisFileStats.TransferStartTime = job->start_time;
+			thisFileStats.TransferEndTime = job->end_time;
+			thisFileStats.ConnectionTimeSeconds = job->end_time - job->start_time;
+			thisFileStats.TransferFileBytes = job->bytes;
+			thisFileStats.TransferTotalBytes = job->bytes;
+			thisFileStats.TransferSuccess = rc == 0;
+
+			ClassAd thisFileStatsAd;
+			thisFileStats.Publish(thisFileStatsAd);
+			thisFileStatsAd.InsertAttr("TransferStream", job->stream);
+			OutputFileTransferStats(thisFileStatsAd);
+		}
+
+		m_stream_stats.clear();
+		streams->GetStats(m_stream_stats);
+		streams.reset();
+		s->timeout(main_sock_timeout);
+	}
+
         // Release transfer queue slot after file has been put but before the
         // final transfer ACKs are done.  In the future where multifile transfers
         // plugins are used in DoDownload, this would allow DoDownload side to
@@ -3114,6 +3379,7 @@ FileTransfer::DoDownload( filesize_t *total_bytes, ReliSock *s)
 		std::string full_stats;
 		formatstr(full_stats, "File Transfer Download: JobId: %d.%d files: %d bytes: %lld seconds: %.2f dest: %s %s\n",
 			cluster, proc, numFiles, (long long)*total_bytes, (downloadEndTime - downloadStartTime), s->peer_ip_str(), (stats ? stats : ""));
+		full_stats += m_stream_stats;
 		Info.tcp_stats = full_stats.c_str();
 		dprintf(D_STATS, "%s", full_stats.c_str());
 	}
@@ -3338,6 +3604,7 @@ FileTransfer::Upload(ReliSock *s, bool blocking)
 
 	if (blocking) {
 		int status = DoUpload( &Info.bytes, (ReliSock *)s);
+		CloseDataStreams();
 		Info.duration = time(NULL)-TransferStart;
 		Info.success = (Info.bytes >= 0) && (status == 0);
 		Info.in_progress = false;
@@ -3718,6 +3985,10 @@ FileTransfer::DoUpload(filesize_t *total_bytes, ReliSock *s)
 		// Declaration to make the return_and_reset_priv macro happy.
         std::string reservation_id;
 
+		// Files we send over the extra data connections, if any.
+	std::unique_ptr<FileTransferStreams> streams;
+	int main_sock_timeout = 0;
+
 
 	// use an error stack to keep track of failures when invoke plugins,
 	// perhaps more of this can be instrumented with it later.
@@ -3756,6 +4027,7 @@ FileTransfer::DoUpload(filesize_t *total_bytes, ReliSock *s)
 	uploadStartTime = condor_gettimestamp_double();
 
 	*total_bytes = 0;
+	m_stream_stats.clear();
 	dprintf(D_FULLDEBUG,"entering FileTransfer::DoUpload\n");
 	dprintf(D_FULLDEBUG,"DoUpload: Output URL plugins %s be run\n",
 		should_invoke_output_plugins ? "will" : "will not");
@@ -3808,9 +4080,14 @@ FileTransfer::DoUpload(filesize_t *total_bytes, ReliSock *s)
 		dprintf(D_FULLDEBUG,"DoUpload: exiting at %d\n",__LINE__);
 		return_and_resetpriv( -1 );
 	}
+	bool offer_data_streams = PeerDoesXferInfo && !m_data_streams.empty();
 	if( PeerDoesXferInfo ) {
 		ClassAd xfer_info;
 		xfer_info.Assign(ATTR_SANDBOX_SIZE,sandbox_size);
+		if( offer_data_streams ) {
+			xfer_info.Assign("TransferStreams",(int)m_data_streams.size());
+			xfer_info.Assign("TransferStreamTag",m_data_stream_tag);
+		}
 		if( !putClassAd(s,xfer_info) ) {
 			dprintf(D_FULLDEBUG,"DoUpload: failed to send xfer_info; exiting at %d\n",__LINE__);
 			return_and_resetpriv( -1 );
@@ -3821,6 +4098,26 @@ FileTransfer::DoUpload(filesize_t *total_bytes, ReliSock *s)
 		return_and_resetpriv( -1 );
 	}
 
+	if( offer_data_streams ) {
+		int accepted = 0;
+		s->decode();
+		if( !s->code(accepted) || !s->end_of_message() ) {
+			dprintf(D_FULLDEBUG,"DoUpload: exiting at %d\n",__LINE__);
+			return_and_resetpriv( -1 );
+		}
+		s->encode();
+		if( accepted ) {
+			streams.reset(new FileTransferStreams(m_data_streams, false));
+				// The main connection may sit idle while the streams
+				// carry the data.
+			main_sock_timeout = s->timeout(0);
+		} else {
+			dprintf(D_ALWAYS,"DoUpload: peer declined our %d transfer streams; "
+				"sending all files on the main connection\n",
+				(int)m_data_streams.size());
+		}
+	}
+
 	std::string tag;
 	if (jobAd.EvaluateAttrString(ATTR_USER, tag))
 	{
@@ -4173,6 +4470,7 @@ FileTransfer::DoUpload(filesize_t *total_bytes, ReliSock *s)
 			try_again = false; // put job on hold
 			hold_code = CONDOR_HOLD_CODE_UploadFileError;
 			hold_subcode = EPERM;
+			streams.reset();
 			return ExitDoUpload(total_bytes,numFiles, s,saved_priv,socket_default_crypto,
 			                    upload_success,do_upload_ack,do_download_ack,
 								try_again,hold_code,hold_subcode,
@@ -4405,7 +4703,36 @@ FileTransfer::DoUpload(filesize_t *total_bytes, ReliSock *s)
 			this_file_max_bytes = 0;
 		}
 
-		if ( file_command == TransferCommand::Other) {
+			// Plain files may go over one of the data streams, but only
+			// when nothing about them needs to be decided file by file:
+			// no go-ahead to wait for and no byte limit to enforce.
+		int data_stream = 0;
+		if( streams && (file_command == TransferCommand::XferFile ||
+						file_command == TransferCommand::EnableEncryption ||
+						file_command == TransferCommand::DisableEncryption) )
+		{
+			if( can_defer_uploads && this_file_max_bytes < 0 &&
+				!fail_because_mkdir_not_supported && !fail_because_symlink_not_supported )
+			{
+				data_stream = streams->Choose();
+			}
+			if( !s->code(data_stream) ) {
+				dprintf(D_FULLDEBUG,"DoUpload: exiting at %d\n",__LINE__);
+				return_and_resetpriv( -1 );
+			}
+		}
+
+		if ( data_stream > 0 ) {
+			FileTransferStreams::Job *job = new FileTransferStreams::Job;
+			job->fullname = fullname.Value();
+			job->filename = dest_filename.Value();
+			job->stream = data_stream;
+			job->encrypt = s->get_encryption();
+			job->with_permissions = TransferFilePermissions;
+			streams->Submit(job, fileitem.fileSize());
+			bytes = 0;
+			rc = 0;
+		} else if ( file_command == TransferCommand::Other) {
 			// new-style, send classad
 
 			ClassAd file_info;
@@ -4634,6 +4961,7 @@ FileTransfer::DoUpload(filesize_t *total_bytes, ReliSock *s)
 
 				// for the more interesting reasons why the transfer failed,
 				// we can try again and see what happens.
+				streams.reset();
 				return ExitDoUpload(total_bytes,numFiles, s,saved_priv,
 								socket_default_crypto,upload_success,
 								do_upload_ack,do_download_ack,
@@ -4669,6 +4997,39 @@ FileTransfer::DoUpload(filesize_t *total_bytes, ReliSock *s)
 			Info.addSpooledFile( dest_filename.Value() );
 		}
 	}
+
+	if( streams ) {
+			// Wait for the files on the data streams, and treat their
+			// failures as the loop above would have.
+		for( auto &job : streams->Finish() ) {
+			*total_bytes += job->bytes;
+			if( job->rc >= 0 ) {
+				continue;
+			}
+			int the_error = job->error;
+			error_desc.formatstr("error sending %s",job->fullname.c_str());
+			if( job->rc == PUT_FILE_OPEN_FAILED ) {
+				error_desc.replaceString("sending","reading from");
+				error_desc.formatstr_cat(": (errno %d) %s",the_error,strerror(the_error));
+			}
+			dprintf(D_ALWAYS,"DoUpload: %s (stream %d)\n",error_desc.Value(),job->stream);
+			if( !first_failed_file_transfer_happened ) {
+				first_failed_file_transfer_happened = true;
+				first_failed_upload_success = false;
+				first_failed_try_again = job->rc != PUT_FILE_OPEN_FAILED;
+				first_failed_hold_code = CONDOR_HOLD_CODE_UploadFileError;
+				first_failed_hold_subcode = the_error;
+				first_failed_error_desc = error_desc;
+				first_failed_line_number = __LINE__;
+			}
+		}
+
+		m_stream_stats.clear();
+		streams->GetStats(m_stream_stats);
+		streams.reset();
+		s->timeout(main_sock_timeout);
+	}
+
 	// Release transfer queue slot after file has been put but before the
 	// final transfer statistics are done.  The remote side (typically, the starter),
 	// currently does multifile transfer plugins during this time and we do not want
@@ -5158,6 +5519,7 @@ FileTransfer::ExitDoUpload(const filesize_t *total_bytes, int numFiles, ReliSock
 		std::string full_stats;
 		formatstr(full_stats, "File Transfer Upload: JobId: %d.%d files: %d bytes: %lld seconds: %.2f dest: %s %s\n",
 			cluster, proc, numFiles, (long long)*total_bytes, (uploadEndTime - uploadStartTime), s->peer_ip_str(), (stats ? stats : ""));
+		full_stats += m_stream_stats;
 		Info.tcp_stats = full_stats.c_str();
 		dprintf(D_STATS, "%s", full_stats.c_str());
 	}
@@ -5349,6 +5711,7 @@ FileTransfer::setPeerVersion( const CondorVersionInfo &peer_version )
 
 	PeerDoesReuseInfo = peer_version.built_since_version(8,9,4);
 	PeerDoesS3Urls = peer_version.built_since_version(8,9,4);
+	PeerDoesParallelStreams = peer_version.built_since_version(9,1,0);
 }
 
 
@@ -407,6 +407,7 @@ class FileTransfer final: public Service {
 	bool PeerDoesXferInfo{false};
 	bool PeerDoesReuseInfo{false};
 	bool PeerDoesS3Urls{false};
+	bool PeerDoesParallelStreams{false};
 	bool TransferUserLog{false};
 	char* Iwd{nullptr};
 	StringList* ExceptionFiles{nullptr};
@@ -476,6 +477,11 @@ class FileTransfer final: public Service {
 	TransferQueueContactInfo m_xfer_queue_contact_info;
 	MyString m_jobid; // what job we are working on, for informational purposes
 	char *m_sec_session_id{nullptr};
+		// Extra connections that file data may be striped across, and
+		// the tag that ties them to one transfer; see file_transfer_streams.h
+	std::vector<ReliSock *> m_data_streams;
+	std::string m_data_stream_tag;
+	std::string m_stream_stats;
 	std::string m_cred_dir;
 	std::string m_job_ad;
 	std::string m_machine_ad;
@@ -488,6 +494,11 @@ class FileTransfer final: public Service {
 	// Object to manage reuse of any data locally.
 	htcondor::DataReuseDirectory *m_reuse_dir{nullptr};
 
+	// Called by the client before it starts a transfer.  Opens as many
+	// of the job's parallel_transfer_streams as the server will take.
+	void OpenDataStreams();
+	void CloseDataStreams();
+
 	// called to construct the catalog of files in a direcotry
 	bool BuildFileCatalog(time_t spool_time = 0, const char* iwd = NULL, FileCatalogHashTable **catalog = NULL);
 
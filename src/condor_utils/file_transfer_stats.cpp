@@ -48,6 +48,10 @@ void FileTransferStats::Publish(classad::ClassAd &ad) const {
     ad.InsertAttr("TransferSuccess", TransferSuccess);
     ad.InsertAttr("TransferTotalBytes", TransferTotalBytes);
 
+    // Throughput achieved while moving the file's data
+    if (ConnectionTimeSeconds > 0 && TransferFileBytes > 0)
+        ad.InsertAttr("TransferBytesPerSecond", TransferFileBytes / ConnectionTimeSeconds);
+
     // The following statistics only appear if they have a value set
     if (!HttpCacheHitOrMiss.empty())
         ad.InsertAttr("HttpCacheHitOrMiss", HttpCacheHitOrMiss);
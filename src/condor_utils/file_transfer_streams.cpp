@@ -0,0 +1,373 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "file_transfer_streams.h"
+#include "limit_directory_access.h"
+#include "safe_open.h"
+#include "stl_string_utils.h"
+#include "utc_time.h"
+
+#if defined(WIN32)
+#define SHUT_RDWR SD_BOTH
+#endif
+
+	// Files queued per stream before Submit() waits for the threads.
+static const int MAX_QUEUED_PER_STREAM = 16;
+
+FileTransferStreams::FileTransferStreams(const std::vector<ReliSock *> &socks, bool downloading)
+	: m_max_pending(MAX_QUEUED_PER_STREAM * (int)socks.size())
+	, m_downloading(downloading)
+{
+		// The threads log, and dprintf() only locks when told to.
+	dprintf_make_thread_safe();
+
+		// param() is not thread safe, so look the knob up here for the
+		// threads' put_file() and get_file().
+	bool zero_copy = param_boolean("ENABLE_ZERO_COPY_FILE_TRANSFER", true);
+
+	for (ReliSock *sock : socks) {
+		std::unique_ptr<Stream> stream(new Stream);
+		stream->sock = sock;
+		sock->set_zero_copy(zero_copy);
+		if (downloading) {
+			sock->decode();
+		} else {
+			sock->encode();
+		}
+		m_streams.emplace_back(std::move(stream));
+	}
+	for (auto &stream : m_streams) {
+		stream->thread = std::thread(&FileTransferStreams::Run, this, stream.get());
+	}
+}
+
+FileTransferStreams::~FileTransferStreams()
+{
+	Abort();
+	for (auto &stream : m_streams) {
+		if (stream->thread.joinable()) {
+			stream->thread.join();
+		}
+	}
+		// Don't leave partly received files behind if we gave up before
+		// Finish().
+	if (!m_finished) {
+		for (auto &job : m_jobs) {
+			Cleanup(job.get());
+		}
+	}
+}
+
+int
+FileTransferStreams::Choose() const
+{
+	int best = 0;
+	for (int ii = 1; ii < size(); ++ii) {
+		if (m_streams[ii]->assigned < m_streams[best]->assigned) {
+			best = ii;
+		}
+	}
+	return best + 1;
+}
+
+void
+FileTransferStreams::Submit(Job *job, filesize_t size)
+{
+	ASSERT(job->stream >= 1 && job->stream <= this->size());
+	Stream *stream = m_streams[job->stream - 1].get();
+
+	std::unique_lock<std::mutex> guard(m_lock);
+	while (m_pending >= m_max_pending) {
+		m_idle.wait(guard);
+	}
+	guard.unlock();
+
+	Open(job);
+
+	guard.lock();
+	m_jobs.emplace_back(job);
+	stream->assigned += size;
+	stream->queue.push_back(job);
+	m_pending++;
+	m_wakeup.notify_all();
+}
+
+std::vector<std::unique_ptr<FileTransferStreams::Job>> &
+FileTransferStreams::Finish()
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+	while (m_pending > 0) {
+		m_idle.wait(guard);
+	}
+	guard.unlock();
+
+	if (!m_finished) {
+		m_finished = true;
+		for (auto &job : m_jobs) {
+			Cleanup(job.get());
+		}
+	}
+	return m_jobs;
+}
+
+void
+FileTransferStreams::Abort()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	if (m_stopping) {
+		return;
+	}
+	m_stopping = true;
+	for (auto &stream : m_streams) {
+			// The thread may be in the middle of using the socket, so
+			// shut it down rather than closing it; that makes any
+			// blocked read or write fail without pulling the ReliSock
+			// out from under the thread.
+		if (!stream->broken && stream->sock->get_file_desc() != INVALID_SOCKET) {
+			shutdown(stream->sock->get_file_desc(), SHUT_RDWR);
+		}
+		stream->broken = true;
+	}
+	m_wakeup.notify_all();
+}
+
+void
+FileTransferStreams::GetStats(std::string &stats) const
+{
+	for (int ii = 0; ii < size(); ++ii) {
+		const Stream *stream = m_streams[ii].get();
+		formatstr_cat(stats, "File Transfer Stream %d: files: %d bytes: %lld seconds: %.2f\n",
+			ii + 1, stream->files, (long long)stream->bytes, stream->seconds);
+	}
+}
+
+void
+FileTransferStreams::Open(Job *job)
+{
+	const char *path = job->fullname.c_str();
+	errno = 0;
+	if (!allow_shadow_access(path)) {
+		errno = EACCES;
+	}
+	else if (m_downloading) {
+		job->fd = safe_open_wrapper_follow(path,
+			O_WRONLY | O_CREAT | O_TRUNC | _O_BINARY | _O_SEQUENTIAL | O_LARGEFILE, 0600);
+	}
+	else {
+		job->fd = safe_open_wrapper_follow(path,
+			O_RDONLY | O_LARGEFILE | _O_BINARY | _O_SEQUENTIAL, 0);
+	}
+	if (job->fd < 0) {
+		job->open_error = errno;
+		dprintf(D_ALWAYS, "FileTransfer stream %d: failed to open %s, errno = %d (%s)\n",
+			job->stream, path, job->open_error, strerror(job->open_error));
+		return;
+	}
+	job->opened = true;
+
+#ifndef WIN32
+	struct stat st;
+	if (!m_downloading && job->with_permissions && fstat(job->fd, &st) == 0) {
+		job->mode = (condor_mode_t)st.st_mode;
+	}
+#endif
+}
+
+void
+FileTransferStreams::Cleanup(Job *job)
+{
+	if (!m_downloading || !job->opened || job->fullname == NULL_FILE) {
+		return;
+	}
+	const char *path = job->fullname.c_str();
+	if (job->rc < 0) {
+		if (unlink(path) < 0) {
+			dprintf(D_FULLDEBUG, "FileTransfer stream %d: failed to unlink %s, errno = %d (%s)\n",
+				job->stream, path, errno, strerror(errno));
+		}
+		return;
+	}
+#ifndef WIN32
+	if (job->with_permissions && job->mode != NULL_FILE_PERMISSIONS &&
+		chmod(path, (mode_t)job->mode) < 0)
+	{
+		job->error = errno;
+		dprintf(D_ALWAYS, "FileTransfer stream %d: failed to chmod %s, errno = %d (%s)\n",
+			job->stream, path, job->error, strerror(job->error));
+		job->rc = -1;
+	}
+#endif
+}
+
+void
+FileTransferStreams::Run(Stream *stream)
+{
+	for (;;) {
+		Job *job = nullptr;
+		{
+			std::unique_lock<std::mutex> guard(m_lock);
+			while (stream->queue.empty() && !m_stopping) {
+				m_wakeup.wait(guard);
+			}
+			if (stream->queue.empty()) {
+				return;
+			}
+			job = stream->queue.front();
+			stream->queue.pop_front();
+		}
+
+		Transfer(stream, job);
+
+		std::lock_guard<std::mutex> guard(m_lock);
+		stream->files++;
+		stream->bytes += job->bytes;
+		stream->seconds += job->end_time - job->start_time;
+		m_pending--;
+			// Finish() waits for none to be left, Submit() for room.
+		m_idle.notify_all();
+	}
+}
+
+void
+FileTransferStreams::Transfer(Stream *stream, Job *job)
+{
+	job->start_time = condor_gettimestamp_double();
+
+	bool broken;
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		broken = stream->broken;
+	}
+	if (broken) {
+			// An earlier file on this stream failed part way, so we
+			// don't know where the next one starts.
+		if (job->fd >= 0) {
+			close(job->fd);
+			job->fd = -1;
+		}
+		job->rc = -1;
+		job->end_time = job->start_time;
+		return;
+	}
+
+	ReliSock *sock = stream->sock;
+	filesize_t bytes = 0;
+	int rc;
+	if (!sock->set_crypto_mode(job->encrypt)) {
+		dprintf(D_ALWAYS, "FileTransfer stream %d: failed to set crypto mode for %s\n",
+			job->stream, job->fullname.c_str());
+		rc = -1;
+	}
+	else if (m_downloading) {
+		rc = Receive(sock, job, bytes);
+	}
+	else {
+		rc = Send(sock, job, bytes);
+	}
+	job->error = errno;
+
+	if (job->fd >= 0) {
+		if (close(job->fd) < 0 && m_downloading && rc == 0) {
+			job->error = errno;
+			dprintf(D_ALWAYS, "FileTransfer stream %d: failed to close %s, errno = %d (%s)\n",
+				job->stream, job->fullname.c_str(), job->error, strerror(job->error));
+			rc = GET_FILE_WRITE_FAILED;
+		}
+		job->fd = -1;
+	}
+
+		// A file that could not be opened or written was still sent
+		// or consumed in full, so the stream can carry on.
+	bool in_sync = rc == 0 || rc == PUT_FILE_OPEN_FAILED ||
+		rc == GET_FILE_OPEN_FAILED || rc == GET_FILE_WRITE_FAILED;
+	if (in_sync && !sock->end_of_message()) {
+		in_sync = false;
+		if (rc == 0) {
+			rc = -1;
+		}
+	}
+
+	if (!in_sync) {
+		dprintf(D_ALWAYS, "FileTransfer stream %d: failed to %s %s (rc=%d); "
+			"giving up on this stream\n", job->stream,
+			m_downloading ? "receive" : "send", job->fullname.c_str(), rc);
+		std::lock_guard<std::mutex> guard(m_lock);
+		if (!stream->broken) {
+				// Let our peer know, rather than leave it waiting.
+			shutdown(sock->get_file_desc(), SHUT_RDWR);
+			stream->broken = true;
+		}
+	}
+
+	job->rc = rc;
+	job->bytes = bytes;
+	job->end_time = condor_gettimestamp_double();
+}
+
+	// put_file_with_permissions() and put_file(), on the descriptor that
+	// Open() got.
+int
+FileTransferStreams::Send(ReliSock *sock, Job *job, filesize_t &bytes)
+{
+	if (job->with_permissions) {
+		condor_mode_t mode = job->fd < 0 ? NULL_FILE_PERMISSIONS : job->mode;
+		if (!sock->code(mode) || !sock->end_of_message()) {
+			dprintf(D_ALWAYS, "FileTransfer stream %d: failed to send permissions of %s\n",
+				job->stream, job->fullname.c_str());
+			return -1;
+		}
+	}
+	if (job->fd < 0) {
+			// Keep the stream in step by sending an empty file.
+		int rc = sock->put_empty_file(&bytes);
+		if (rc < 0) {
+			return rc;
+		}
+		errno = job->open_error;
+		return PUT_FILE_OPEN_FAILED;
+	}
+	return sock->put_file(&bytes, job->fd, 0, job->max_bytes);
+}
+
+	// get_file_with_permissions() and get_file(), on the descriptor that
+	// Open() got.  The permissions are set by Cleanup().
+int
+FileTransferStreams::Receive(ReliSock *sock, Job *job, filesize_t &bytes)
+{
+	if (job->with_permissions) {
+		if (!sock->code(job->mode) || !sock->end_of_message()) {
+			dprintf(D_ALWAYS, "FileTransfer stream %d: failed to receive permissions of %s\n",
+				job->stream, job->fullname.c_str());
+			return -1;
+		}
+	}
+	if (job->fd < 0) {
+			// Read and throw away the data, to stay in step.
+		int rc = sock->get_file(&bytes, GET_FILE_NULL_FD, false, false, job->max_bytes);
+		if (rc < 0) {
+			return rc;
+		}
+		errno = job->open_error;
+		return GET_FILE_OPEN_FAILED;
+	}
+	return sock->get_file(&bytes, job->fd, false, false, job->max_bytes);
+}
@@ -0,0 +1,140 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __FILE_TRANSFER_STREAMS_H__
+#define __FILE_TRANSFER_STREAMS_H__
+
+/*
+  Extra connections that FileTransfer stripes file data across.
+
+  The FileTransfer client opens the connections (FILETRANS_STREAM) before
+  the command that starts the transfer, and the server keeps them with
+  the FileTransfer object that the transfer key names.  All of the
+  protocol (file names, go-aheads, acks) still goes over the main
+  connection; for a plain file, the uploader says on the main connection
+  which stream the file's data will follow on, and the file itself is
+  sent with put_file() on that stream by a thread that owns it.  Each
+  stream carries its files in the order they were assigned, so the
+  downloader only has to queue each file on the same stream.
+
+  Everything that depends on the priv state or the config is done on the
+  main thread: files are opened when they are queued and finished up in
+  Finish(), so the threads only ever see open descriptors.
+*/
+
+#include "reli_sock.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FileTransferStreams
+{
+public:
+		// A file assigned to a stream, and what happened to it.
+	struct Job {
+		std::string fullname;		// local file to send or write
+		std::string filename;		// name sent on the wire, for stats
+		int stream{0};				// 1-based
+		bool encrypt{false};
+		bool with_permissions{false};
+		filesize_t max_bytes{-1};
+		int reuse_index{-1};		// for the downloader's data reuse
+
+		int fd{-1};					// open until the thread is done with it
+		bool opened{false};
+		int open_error{0};			// errno, if the file couldn't be opened
+		condor_mode_t mode{NULL_FILE_PERMISSIONS};	// with_permissions only
+
+		int rc{0};					// from put_file() or get_file()
+		int error{0};				// errno, if rc < 0
+		filesize_t bytes{0};
+		double start_time{0};
+		double end_time{0};
+	};
+
+		/** Start a thread for each socket.  The sockets stay owned by
+			the caller and must outlive this object.
+			@param downloading true to receive files, false to send them
+		*/
+	FileTransferStreams(const std::vector<ReliSock *> &socks, bool downloading);
+
+		/// Abort() and wait for the threads.
+	~FileTransferStreams();
+
+	int size() const { return (int)m_streams.size(); }
+
+		/// The stream with the fewest bytes assigned so far.
+	int Choose() const;
+
+		/** Open job->fullname under the current priv state and queue
+			it on job->stream.  size is used by Choose().  Waits while
+			too many files are already queued, to bound the open fds.
+		*/
+	void Submit(Job *job, filesize_t size);
+
+		/** Wait for every queued file to be done, then, under the current
+			priv state, set the permissions of files that were received
+			and remove those that failed.
+			@return the jobs in the order they were submitted.
+		*/
+	std::vector<std::unique_ptr<Job>> &Finish();
+
+		/// Shut the sockets down, so that the threads give up.
+	void Abort();
+
+		/// One line per stream: files, bytes and seconds spent.
+	void GetStats(std::string &stats) const;
+
+private:
+	struct Stream {
+		ReliSock *sock{nullptr};
+		std::deque<Job *> queue;
+		std::thread thread;
+		bool broken{false};
+		filesize_t assigned{0};
+		int files{0};
+		filesize_t bytes{0};
+		double seconds{0};
+	};
+
+	void Open(Job *job);
+	void Run(Stream *stream);
+	void Transfer(Stream *stream, Job *job);
+	int Send(ReliSock *sock, Job *job, filesize_t &bytes);
+	int Receive(ReliSock *sock, Job *job, filesize_t &bytes);
+	void Cleanup(Job *job);
+
+	std::vector<std::unique_ptr<Stream>> m_streams;
+	std::vector<std::unique_ptr<Job>> m_jobs;
+	std::mutex m_lock;
+	std::condition_variable m_wakeup;
+	std::condition_variable m_idle;
+	int m_pending{0};
+	int m_max_pending;
+	bool m_stopping{false};
+	bool m_finished{false};
+	bool m_downloading;
+};
+
+#endif
@@ -1234,7 +1234,7 @@ public:
       }
    void Unpublish(ClassAd & ad, const char * pattr) { ad.Delete(pattr); }
 
-   T Add(T val);
+   T Add(T val, int count = 1); // count is how many samples of val to add
    T Remove(T val);
    stats_histogram<T>& Accumulate(const stats_histogram<T>& sh);
 
@@ -1347,12 +1347,12 @@ stats_histogram<T>& stats_histogram<T>::operator=(const stats_histogram<T>& sh)
 GCC_DIAG_ON(float-equal)
 
 template<class T>
-T stats_histogram<T>::Add(T val)
+T stats_histogram<T>::Add(T val, int count)
 {
     int ix = 0;
     while (ix < cLevels && val >= levels[ix])
         ++ix;
-    data[ix] += 1;
+    data[ix] += count;
     /* the above code should give the same result as this...
      if(val < levels[0]){
         data[0] += 1;
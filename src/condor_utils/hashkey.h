@@ -29,7 +29,7 @@
 #include "condor_classad.h"
 #include "condor_sockaddr.h"
 
-#include "HashTable.h"
+#include "OpenHashTable.h"
 
 // this is the tuple that we will be hashing on
 class AdNameHashKey
@@ -47,7 +47,7 @@ class AdNameHashKey
 size_t adNameHashFunction (const AdNameHashKey &);
 
 // type for the hash tables ...
-typedef HashTable <AdNameHashKey, ClassAd *> CollectorHashTable;
+typedef OpenHashTable <AdNameHashKey, ClassAd *> CollectorHashTable;
 typedef HashTable <MyString, CollectorHashTable *> GenericAdHashTable;
 
 // functions to make the hashkeys
@@ -0,0 +1,500 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_config.h"
+#include "condor_debug.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "compat_classad_util.h"
+#include "stl_string_utils.h"
+#include "backward_file_reader.h"
+#include "directory.h"      // for StatInfo
+#include "history_index.h"
+
+#define HISTORY_INDEX_HEADER "HistoryIndex 1"
+
+bool IsHistoryIndexFilename(const char * filename)
+{
+	if ( ! filename) return false;
+	size_t cch = strlen(filename);
+	size_t cchSuffix = sizeof(HISTORY_INDEX_SUFFIX)-1;
+	return cch > cchSuffix && MATCH == strcmp(filename + cch - cchSuffix, HISTORY_INDEX_SUFFIX);
+}
+
+void GetHistoryIndexAttrs(std::vector<std::string> & attrs)
+{
+	attrs.clear();
+	attrs.push_back(ATTR_CLUSTER_ID);
+	attrs.push_back(ATTR_PROC_ID);
+	attrs.push_back(ATTR_OWNER);
+	attrs.push_back(ATTR_COMPLETION_DATE);
+
+	std::string extra;
+	if (param(extra, "HISTORY_INDEX_ATTRS")) {
+		StringTokenIterator it(extra);
+		for (const char * attr = it.first(); attr; attr = it.next()) {
+			bool dup = false;
+			for (auto & a : attrs) {
+				if (MATCH == strcasecmp(a.c_str(), attr)) { dup = true; break; }
+			}
+			if ( ! dup) attrs.push_back(attr);
+		}
+	}
+}
+
+// split a line of the index into tab separated fields
+static void split_index_line(const std::string & line, std::vector<std::string> & fields)
+{
+	fields.clear();
+	size_t start = 0;
+	for (;;) {
+		size_t tab = line.find('\t', start);
+		if (tab == std::string::npos) {
+			fields.push_back(line.substr(start));
+			break;
+		}
+		fields.push_back(line.substr(start, tab - start));
+		start = tab + 1;
+	}
+}
+
+// read the header line of the index and return the attribute names from it
+static bool read_index_header(FILE * fp, std::vector<std::string> & attrs)
+{
+	std::string line;
+	if ( ! readLine(line, fp)) {
+		return false;
+	}
+	chomp(line);
+	std::vector<std::string> fields;
+	split_index_line(line, fields);
+	if (fields.empty() || fields[0] != HISTORY_INDEX_HEADER) {
+		return false;
+	}
+	attrs.assign(fields.begin()+1, fields.end());
+	return true;
+}
+
+// --------------------------------------------------------------------------
+// HistoryIndexWriter
+// --------------------------------------------------------------------------
+
+bool HistoryIndexWriter::Open(const char * history_filename, filesize_t history_size)
+{
+	Close();
+	m_filename = history_filename;
+	m_filename += HISTORY_INDEX_SUFFIX;
+	m_last_written = 0;
+
+	if (history_size > 0) {
+		// we can only keep appending to an existing index if it describes all of the history file.
+		HistoryIndexReader reader;
+		if ( ! reader.Open(history_filename)) {
+			if (0 == unlink(m_filename.c_str())) {
+				dprintf(D_ALWAYS, "Removed stale history index %s\n", m_filename.c_str());
+			}
+			return false;
+		}
+		m_attrs = reader.Attrs();
+		m_last_written = reader.LastWritten();
+		reader.Close();
+
+		m_fp = safe_fopen_wrapper_follow(m_filename.c_str(), "a");
+		if ( ! m_fp) {
+			dprintf(D_ALWAYS, "ERROR opening history index %s: %s\n", m_filename.c_str(), strerror(errno));
+			return false;
+		}
+	} else {
+		GetHistoryIndexAttrs(m_attrs);
+		m_fp = safe_fopen_wrapper_follow(m_filename.c_str(), "w", 0644);
+		if ( ! m_fp) {
+			dprintf(D_ALWAYS, "ERROR creating history index %s: %s\n", m_filename.c_str(), strerror(errno));
+			return false;
+		}
+		fputs(HISTORY_INDEX_HEADER, m_fp);
+		for (auto & attr : m_attrs) {
+			fprintf(m_fp, "\t%s", attr.c_str());
+		}
+		fputc('\n', m_fp);
+		if (fflush(m_fp) != 0) {
+			dprintf(D_ALWAYS, "ERROR writing history index %s: %s\n", m_filename.c_str(), strerror(errno));
+			Remove();
+			return false;
+		}
+	}
+
+	m_history_end = history_size;
+	return true;
+}
+
+bool HistoryIndexWriter::Append(ClassAd & ad, filesize_t offset, filesize_t length)
+{
+	if ( ! m_fp) {
+		return false;
+	}
+	if (offset != m_history_end || length <= 0) {
+		dprintf(D_ALWAYS, "History index %s does not match the history file, removing it\n", m_filename.c_str());
+		Remove();
+		return false;
+	}
+
+	// keep the written times in order, even if the clock steps backward
+	time_t now = time(NULL);
+	if (now < m_last_written) now = m_last_written;
+
+	std::string line;
+	formatstr(line, "%lld\t%lld\t%lld", (long long)offset, (long long)length, (long long)now);
+
+	std::string buf;
+	classad::Value val;
+	for (auto & attr : m_attrs) {
+		line += '\t';
+		classad::ExprTree * tree = ad.Lookup(attr);
+		if ( ! tree) {
+			continue;
+		}
+		if ( ! ExprTreeIsLiteral(tree, val)) {
+			line += HISTORY_INDEX_NOT_LITERAL;
+			continue;
+		}
+		buf.clear();
+		ClassAdValueToString(val, buf);
+		if (buf.empty() || buf.find_first_of("\t\r\n") != std::string::npos) {
+			line += HISTORY_INDEX_NOT_LITERAL;
+		} else {
+			line += buf;
+		}
+	}
+	line += '\n';
+
+	if (fputs(line.c_str(), m_fp) < 0 || fflush(m_fp) != 0) {
+		dprintf(D_ALWAYS, "ERROR writing history index %s: %s\n", m_filename.c_str(), strerror(errno));
+		Remove();
+		return false;
+	}
+
+	m_history_end = offset + length;
+	m_last_written = now;
+	return true;
+}
+
+void HistoryIndexWriter::Close()
+{
+	if (m_fp) {
+		fclose(m_fp);
+		m_fp = NULL;
+	}
+}
+
+void HistoryIndexWriter::Remove()
+{
+	Close();
+	if ( ! m_filename.empty()) {
+		unlink(m_filename.c_str());
+	}
+}
+
+// --------------------------------------------------------------------------
+// HistoryIndexReader
+// --------------------------------------------------------------------------
+
+bool HistoryIndexReader::Open(const char * history_filename)
+{
+	Close();
+	m_filename = history_filename;
+	m_filename += HISTORY_INDEX_SUFFIX;
+
+	m_fp = safe_fopen_wrapper_follow(m_filename.c_str(), "rb");
+	if ( ! m_fp) {
+		return false;
+	}
+	if ( ! read_index_header(m_fp, m_attrs)) {
+		dprintf(D_FULLDEBUG, "History index %s has an invalid header, ignoring it\n", m_filename.c_str());
+		Close();
+		return false;
+	}
+	m_data_start = ftell(m_fp);
+	fseek(m_fp, 0, SEEK_END);
+	m_size = ftell(m_fp);
+
+	StatInfo si(history_filename);
+	if (si.Error() != SIGood) {
+		Close();
+		return false;
+	}
+	filesize_t history_size = si.GetFileSize();
+
+	// the first entry must be for the start of the history file, and the last entry for the end of it.
+	filesize_t first_offset = 0, last_end = 0;
+	if (m_size > m_data_start) {
+		HistoryIndexEntry entry;
+		filesize_t next_pos;
+		if ( ! ReadEntryAt(m_data_start, entry, &next_pos)) {
+			Close();
+			return false;
+		}
+		first_offset = entry.offset;
+
+		BackwardFileReader reader(m_filename, O_RDONLY);
+		std::string line;
+		while (reader.PrevLine(line) && line.empty()) {}
+		if (reader.LastError() || ! ParseEntry(line, entry)) {
+			Close();
+			return false;
+		}
+		last_end = entry.offset + entry.length;
+		m_last_written = entry.written;
+	}
+	if (first_offset != 0 || last_end != history_size) {
+		dprintf(D_FULLDEBUG, "History index %s does not match %s, ignoring it\n", m_filename.c_str(), history_filename);
+		Close();
+		return false;
+	}
+
+	fseek(m_fp, m_data_start, SEEK_SET);
+	return true;
+}
+
+void HistoryIndexReader::Close()
+{
+	if (m_fp) {
+		fclose(m_fp);
+		m_fp = NULL;
+	}
+	delete m_bwreader;
+	m_bwreader = NULL;
+	m_data_start = m_size = 0;
+	m_last_written = 0;
+}
+
+bool HistoryIndexReader::Covers(const classad::References & refs) const
+{
+	for (auto & ref : refs) {
+		bool found = false;
+		for (auto & attr : m_attrs) {
+			if (MATCH == strcasecmp(attr.c_str(), ref.c_str())) { found = true; break; }
+		}
+		if ( ! found) return false;
+	}
+	return true;
+}
+
+bool HistoryIndexReader::MakeAd(const HistoryIndexEntry & entry, ClassAd & ad) const
+{
+	ad.Clear();
+	for (size_t ix = 0; ix < m_attrs.size() && ix < entry.values.size(); ++ix) {
+		const std::string & value = entry.values[ix];
+		if (value.empty()) {
+			continue;
+		}
+		if (value == HISTORY_INDEX_NOT_LITERAL || ! ad.AssignExpr(m_attrs[ix], value.c_str())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool HistoryIndexReader::ParseEntry(const std::string & line, HistoryIndexEntry & entry) const
+{
+	std::vector<std::string> fields;
+	split_index_line(line, fields);
+	if (fields.size() != m_attrs.size() + 3) {
+		return false;
+	}
+	char * pend = NULL;
+	entry.offset = strtoll(fields[0].c_str(), &pend, 10);
+	if (*pend) return false;
+	entry.length = strtoll(fields[1].c_str(), &pend, 10);
+	if (*pend) return false;
+	entry.written = (time_t)strtoll(fields[2].c_str(), &pend, 10);
+	if (*pend) return false;
+	entry.values.assign(fields.begin()+3, fields.end());
+	return true;
+}
+
+// return the offset of the first line that starts at or after pos
+filesize_t HistoryIndexReader::LineStartAtOrAfter(filesize_t pos)
+{
+	if (pos <= m_data_start) {
+		return m_data_start;
+	}
+	// if the character before pos is a newline, pos is the start of a line
+	if (fseek(m_fp, pos-1, SEEK_SET) != 0) {
+		return m_size;
+	}
+	int ch;
+	while ((ch = fgetc(m_fp)) != EOF && ch != '\n') {}
+	if (ch == EOF) {
+		return m_size;
+	}
+	return ftell(m_fp);
+}
+
+bool HistoryIndexReader::ReadEntryAt(filesize_t pos, HistoryIndexEntry & entry, filesize_t * next_pos)
+{
+	std::string line;
+	if (fseek(m_fp, pos, SEEK_SET) != 0 || ! readLine(line, m_fp)) {
+		return false;
+	}
+	if (next_pos) *next_pos = ftell(m_fp);
+	chomp(line);
+	return ParseEntry(line, entry);
+}
+
+bool HistoryIndexReader::SeekTime(time_t when)
+{
+	if ( ! m_fp) {
+		return false;
+	}
+
+	// lo is always the start of an entry, and every entry before it was written before when.
+	// hi is the start of an entry that was written at or after when, or the end of the index.
+	filesize_t lo = m_data_start, hi = m_size;
+	HistoryIndexEntry entry;
+	filesize_t next_pos;
+	while (hi - lo > 4096) {
+		filesize_t pos = LineStartAtOrAfter(lo + (hi - lo)/2);
+		if (pos >= hi) {
+			break;
+		}
+		if ( ! ReadEntryAt(pos, entry, &next_pos)) {
+			return false;
+		}
+		if (entry.written < when) {
+			lo = next_pos;
+		} else {
+			hi = pos;
+		}
+	}
+
+	// the remaining range is small, so just scan it
+	filesize_t pos = lo;
+	while (pos < hi) {
+		if ( ! ReadEntryAt(pos, entry, &next_pos)) {
+			return false;
+		}
+		if (entry.written >= when) {
+			break;
+		}
+		pos = next_pos;
+	}
+
+	return fseek(m_fp, pos, SEEK_SET) == 0;
+}
+
+bool HistoryIndexReader::Next(HistoryIndexEntry & entry)
+{
+	if ( ! m_fp || ftell(m_fp) >= m_size) {
+		return false;
+	}
+	std::string line;
+	if ( ! readLine(line, m_fp)) {
+		return false;
+	}
+	chomp(line);
+	return ParseEntry(line, entry);
+}
+
+bool HistoryIndexReader::Prev(HistoryIndexEntry & entry)
+{
+	if ( ! m_fp) {
+		return false;
+	}
+	if ( ! m_bwreader) {
+		m_bwreader = new BackwardFileReader(m_filename, O_RDONLY);
+		if (m_bwreader->LastError()) {
+			return false;
+		}
+	}
+	std::string line;
+	while (m_bwreader->PrevLine(line)) {
+		if (line.empty()) {
+			continue;
+		}
+		// stop when we get back to the header
+		if (starts_with(line, HISTORY_INDEX_HEADER)) {
+			return false;
+		}
+		return ParseEntry(line, entry);
+	}
+	return false;
+}
+
+// --------------------------------------------------------------------------
+// Constraint analysis
+// --------------------------------------------------------------------------
+
+// returns true if expr has no attribute references and evaluates to a number
+static bool eval_constant_time(classad::ExprTree * expr, time_t & value)
+{
+	ClassAd empty;
+	classad::References refs;
+	if ( ! GetExprReferences(expr, empty, &refs, &refs) || ! refs.empty()) {
+		return false;
+	}
+	classad::Value val;
+	long long ival;
+	if ( ! EvalExprTree(expr, &empty, NULL, val) || ! val.IsNumber(ival)) {
+		return false;
+	}
+	value = (time_t)ival;
+	return true;
+}
+
+bool ConstraintCompletionDateLowerBound(classad::ExprTree * tree, time_t & lower_bound)
+{
+	if ( ! tree) return false;
+	tree = SkipExprParens(tree);
+	if (tree->GetKind() != classad::ExprTree::OP_NODE) {
+		return false;
+	}
+
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((const classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+
+	if (op == classad::Operation::LOGICAL_AND_OP) {
+		// either side of an && can bound the result, use the larger bound
+		time_t b1 = 0, b2 = 0;
+		bool has1 = ConstraintCompletionDateLowerBound(t1, b1);
+		bool has2 = ConstraintCompletionDateLowerBound(t2, b2);
+		if ( ! has1 && ! has2) return false;
+		lower_bound = has1 ? b1 : b2;
+		if (has1 && has2 && b2 > b1) lower_bound = b2;
+		return true;
+	}
+
+	// normalize to CompletionDate <op> <expr>
+	classad::ExprTree * bound_expr = NULL;
+	std::string attr;
+	if (ExprTreeIsAttrRef(SkipExprParens(t1), attr) && MATCH == strcasecmp(attr.c_str(), ATTR_COMPLETION_DATE)) {
+		if (op == classad::Operation::GREATER_THAN_OP || op == classad::Operation::GREATER_OR_EQUAL_OP) {
+			bound_expr = t2;
+		}
+	} else if (ExprTreeIsAttrRef(SkipExprParens(t2), attr) && MATCH == strcasecmp(attr.c_str(), ATTR_COMPLETION_DATE)) {
+		if (op == classad::Operation::LESS_THAN_OP || op == classad::Operation::LESS_OR_EQUAL_OP) {
+			bound_expr = t1;
+		}
+	}
+	if ( ! bound_expr) {
+		return false;
+	}
+	return eval_constant_time(bound_expr, lower_bound);
+}
@@ -0,0 +1,143 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2021, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _HISTORY_INDEX_H_
+#define _HISTORY_INDEX_H_
+
+#include "condor_classad.h"
+#include <string>
+#include <vector>
+
+class BackwardFileReader;
+
+// A history index is a sidecar file written next to a history file, it has the name of the
+// history file with HISTORY_INDEX_SUFFIX appended.  It has one line for each job ad in the
+// history file, in the order that the ads were written, so that condor_history can find the
+// ads that match a query without reading and parsing all of them.
+//
+// The first line names the indexed attributes
+//    HistoryIndex 1 <attr> <attr> ...
+// and each line after that describes one job ad
+//    <offset> <length> <written> <value> <value> ...
+// offset and length are the byte range of the ad and its "***" banner in the history file,
+// written is the time the ad was appended, and each value is the evaluated value of the attribute
+// named in the same column of the header.  A value is empty if the ad did not have the attribute,
+// and is HISTORY_INDEX_NOT_LITERAL if the attribute was an expression rather than a literal, since
+// the value of an expression can depend on when it is evaluated.  Fields are separated by tabs.
+//
+// written never decreases from one line to the next, so the index can be binary searched
+// by time.  Since a job completes before its ad is written, CompletionDate <= written.
+// An index always describes its history file from the first byte, an index that does not
+// end at the end of the history file is stale and is not used.
+//
+#define HISTORY_INDEX_SUFFIX ".idx"
+#define HISTORY_INDEX_NOT_LITERAL "*"
+
+// returns true if the filename ends with HISTORY_INDEX_SUFFIX
+bool IsHistoryIndexFilename(const char * filename);
+
+// the attributes that are always indexed, HISTORY_INDEX_ATTRS adds to these.
+void GetHistoryIndexAttrs(std::vector<std::string> & attrs);
+
+struct HistoryIndexEntry {
+	filesize_t offset;
+	filesize_t length;
+	time_t written;
+	std::vector<std::string> values; // unparsed values, in the order of the index attributes
+
+	HistoryIndexEntry() : offset(0), length(0), written(0) {}
+};
+
+// Appends entries to the index of the history file. used by AppendHistory.
+class HistoryIndexWriter {
+public:
+	HistoryIndexWriter() : m_fp(NULL), m_history_end(0), m_last_written(0) {}
+	~HistoryIndexWriter() { Close(); }
+
+	// open the index for the given history file, history_size is the current size of the history file.
+	// an existing index is kept if it ends at history_size, otherwise it is removed.  A new index is only
+	// created when the history file is empty, so an existing history file is not indexed until it is rotated.
+	bool Open(const char * history_filename, filesize_t history_size);
+	bool IsOpen() const { return m_fp != NULL; }
+	// add an entry for an ad that was written to the history file at offset.
+	// on failure the index is removed, since it no longer describes the history file.
+	bool Append(ClassAd & ad, filesize_t offset, filesize_t length);
+	void Close();
+	// close and delete the index
+	void Remove();
+	const char * Filename() const { return m_filename.c_str(); }
+
+private:
+	FILE * m_fp;
+	std::string m_filename;
+	std::vector<std::string> m_attrs;
+	filesize_t m_history_end; // size of the history file as of the last entry
+	time_t m_last_written;
+};
+
+// Reads the index of a history file. used by condor_history, and so by remote history queries.
+class HistoryIndexReader {
+public:
+	HistoryIndexReader() : m_fp(NULL), m_bwreader(NULL), m_data_start(0), m_size(0), m_last_written(0) {}
+	~HistoryIndexReader() { Close(); }
+
+	// open the index of the given history file, returns false if there is no index or if it
+	// does not describe the whole history file.
+	bool Open(const char * history_filename);
+	void Close();
+
+	const std::vector<std::string> & Attrs() const { return m_attrs; }
+	// returns true if every attribute in refs is indexed, so an expression that only refers
+	// to those attributes evaluates the same against MakeAd() as it does against the full job ad.
+	bool Covers(const classad::References & refs) const;
+	// fill ad with the indexed attributes of the entry. returns false if one of the attributes
+	// was not a literal when the entry was written, in which case the full job ad must be read
+	bool MakeAd(const HistoryIndexEntry & entry, ClassAd & ad) const;
+	// the written time of the last entry in the index when it was opened
+	time_t LastWritten() const { return m_last_written; }
+
+	// position Next() at the first entry written at or after the given time
+	bool SeekTime(time_t when);
+	// position Next() at the first entry
+	bool Rewind() { return SeekTime(0); }
+	// return the next entry in the order they were written
+	bool Next(HistoryIndexEntry & entry);
+	// return entries in reverse order, starting from the last one in the index.
+	bool Prev(HistoryIndexEntry & entry);
+
+private:
+	bool ParseEntry(const std::string & line, HistoryIndexEntry & entry) const;
+	filesize_t LineStartAtOrAfter(filesize_t pos);
+	bool ReadEntryAt(filesize_t pos, HistoryIndexEntry & entry, filesize_t * next_pos);
+
+	FILE * m_fp;
+	BackwardFileReader * m_bwreader;
+	std::string m_filename;
+	std::vector<std::string> m_attrs;
+	filesize_t m_data_start; // offset of the first entry in the index
+	filesize_t m_size;       // size of the index when it was opened
+	time_t m_last_written;
+};
+
+// returns true and sets lower_bound when the constraint can only match ads with a CompletionDate
+// at or after lower_bound.  This looks for top level && clauses of the form CompletionDate > <expr>
+// or CompletionDate >= <expr> where <expr> does not refer to any attributes.
+bool ConstraintCompletionDateLowerBound(classad::ExprTree * constraint, time_t & lower_bound);
+
+#endif
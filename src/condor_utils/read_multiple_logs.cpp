@@ -27,10 +27,15 @@
 #include "condor_getcwd.h"
 
 #include <iostream>
+#include <set>
 #include "classad/classad_distribution.h"
 
 #include "fs_util.h"
 
+#if defined( LINUX )
+#include <sys/inotify.h>
+#endif /* defined( LINUX ) */
+
 #define DEBUG_LOG_FILES 0 //TEMP
 #if DEBUG_LOG_FILES
 #  define D_LOG_FILES D_ALWAYS
@@ -42,10 +47,24 @@ using namespace std;
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// How often (in seconds) to check the status of log files that we are
+// watching with inotify, in case inotify missed a change.
+static const int LOG_FULL_CHECK_INTERVAL = 10;
+
 ReadMultipleUserLogs::ReadMultipleUserLogs() :
 	allLogFiles(hashFunction),
-	activeLogFiles(hashFunction)
+	activeLogFiles(hashFunction),
+	m_inotify_fd(-1),
+	m_last_full_check(0)
 {
+#if defined( LINUX )
+	m_inotify_fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if ( m_inotify_fd == -1 ) {
+		dprintf( D_FULLDEBUG, "ReadMultipleUserLogs: inotify_init1() "
+					"failed: %s (%d), will poll log files\n",
+					strerror( errno ), errno );
+	}
+#endif /* defined( LINUX ) */
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -58,6 +77,11 @@ ReadMultipleUserLogs::~ReadMultipleUserLogs()
 					activeLogFileCount());
 	}
 	cleanup();
+
+	if ( m_inotify_fd != -1 ) {
+		close( m_inotify_fd );
+		m_inotify_fd = -1;
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -155,9 +179,26 @@ ReadMultipleUserLogs::GetLogStatus()
 	LogFileMonitor *monitor;
 	ReadUserLog::FileStatus status = ReadUserLog::LOG_STATUS_NOCHANGE;
 
+	// Only the log files that inotify says have changed need to be
+	// stat'ed, unless it's time to check them all.
+	bool check_all = readLogNotifications();
+	time_t now = time( NULL );
+	if ( now - m_last_full_check >= LOG_FULL_CHECK_INTERVAL ||
+				now < m_last_full_check ) {
+		check_all = true;
+	}
+	if ( check_all ) {
+		m_last_full_check = now;
+	}
+
 	// Iterate over all the log files and check their statuses.
 	activeLogFiles.startIterations();
 	while ( activeLogFiles.iterate( monitor ) ) {
+		if ( !check_all && monitor->watchDesc != -1 &&
+					!monitor->statusDirty ) {
+			continue;
+		}
+		monitor->statusDirty = false;
 		ReadUserLog::FileStatus fs = monitor->readUserLog->CheckFileStatus();
 		// If a log files has grown, we want to return ReadUserLog::LOG_STATUS_GROWN
 		// Do not exit the loop early, since checking the file status also
@@ -236,6 +277,7 @@ ReadMultipleUserLogs::cleanup()
 	allLogFiles.startIterations();
 	LogFileMonitor *monitor;
 	while ( allLogFiles.iterate( monitor ) ) {
+		unwatchLogFile( monitor );
 		delete monitor;
 	}
 	allLogFiles.clear();
@@ -243,6 +285,116 @@ ReadMultipleUserLogs::cleanup()
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void
+ReadMultipleUserLogs::watchLogFile( LogFileMonitor *monitor )
+{
+	monitor->statusDirty = true;
+#if defined( LINUX )
+	if ( m_inotify_fd == -1 || monitor->watchDesc != -1 ) {
+		return;
+	}
+	monitor->watchDesc = inotify_add_watch( m_inotify_fd,
+				monitor->logFile.Value(),
+				IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF );
+	if ( monitor->watchDesc == -1 ) {
+		dprintf( D_FULLDEBUG, "ReadMultipleUserLogs: inotify_add_watch(%s) "
+					"failed: %s (%d), will poll it\n",
+					monitor->logFile.Value(), strerror( errno ), errno );
+	}
+#endif /* defined( LINUX ) */
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void
+ReadMultipleUserLogs::unwatchLogFile( LogFileMonitor *monitor )
+{
+#if defined( LINUX )
+	if ( m_inotify_fd != -1 && monitor->watchDesc != -1 ) {
+		inotify_rm_watch( m_inotify_fd, monitor->watchDesc );
+	}
+#endif /* defined( LINUX ) */
+	monitor->watchDesc = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool
+ReadMultipleUserLogs::readLogNotifications()
+{
+#if defined( LINUX )
+	if ( m_inotify_fd == -1 ) {
+		return true;
+	}
+
+	bool lost_track = false;
+	std::set<int> changed;
+	std::set<int> removed;
+
+	// Magic from 'man inotify'.
+	char buf[ sizeof(struct inotify_event) + NAME_MAX + 1 ]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	while ( true ) {
+		ssize_t len = read( m_inotify_fd, buf, sizeof( buf ) );
+		if ( len == -1 ) {
+			if ( errno != EAGAIN && errno != EINTR ) {
+				dprintf( D_ALWAYS, "ReadMultipleUserLogs: failed to read "
+							"inotify events: %s (%d)\n",
+							strerror( errno ), errno );
+				lost_track = true;
+			}
+			if ( errno != EINTR ) {
+				break;
+			}
+			continue;
+		}
+		if ( len <= 0 ) {
+			break;
+		}
+
+		char *ptr = buf;
+		while ( ptr < buf + len ) {
+			const struct inotify_event *event =
+						(const struct inotify_event *)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+			if ( event->mask & IN_Q_OVERFLOW ) {
+				lost_track = true;
+			}
+			if ( event->mask & IN_IGNORED ) {
+				removed.insert( event->wd );
+			}
+			changed.insert( event->wd );
+		}
+	}
+
+	if ( changed.empty() ) {
+		return lost_track;
+	}
+
+	LogFileMonitor *monitor;
+	activeLogFiles.startIterations();
+	while ( activeLogFiles.iterate( monitor ) ) {
+		if ( monitor->watchDesc == -1 ) {
+			continue;
+		}
+		if ( changed.count( monitor->watchDesc ) ) {
+			monitor->statusDirty = true;
+		}
+			// The kernel dropped the watch (the log was deleted or its
+			// file system unmounted), so poll this log from now on.
+		if ( removed.count( monitor->watchDesc ) ) {
+			monitor->watchDesc = -1;
+		}
+	}
+
+	return lost_track;
+#else
+	return true;
+#endif /* defined( LINUX ) */
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 ULogEventOutcome
 ReadMultipleUserLogs::readEventFromLog( LogFileMonitor *monitor )
 {
@@ -736,6 +888,8 @@ ReadMultipleUserLogs::monitorLogFile( MyString logfile,
 						"file %s (%s) to active list\n", logfile.Value(),
 						fileID.Value() );
 		}
+
+		watchLogFile( monitor );
 	}
 
 	monitor->refCount++;
@@ -745,6 +899,95 @@ ReadMultipleUserLogs::monitorLogFile( MyString logfile,
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Note: logfile is not passed as a reference because we need a local
+// copy to modify anyhow.
+bool
+ReadMultipleUserLogs::getLogFileState( MyString logfile,
+			ReadUserLog::FileState &state, CondorError &errstack )
+{
+	dprintf( D_LOG_FILES, "ReadMultipleUserLogs::getLogFileState(%s)\n",
+				logfile.Value() );
+
+	MyString fileID;
+	if ( !GetFileID( logfile, fileID, errstack ) ) {
+		errstack.push( "ReadMultipleUserLogs", UTIL_ERR_LOG_FILE,
+					"Error getting file ID in getLogFileState()" );
+		return false;
+	}
+
+	LogFileMonitor *monitor;
+	if ( activeLogFiles.lookup( fileID, monitor ) != 0 ) {
+		errstack.pushf( "ReadMultipleUserLogs", UTIL_ERR_LOG_FILE,
+					"Log file %s (%s) is not being monitored",
+					logfile.Value(), fileID.Value() );
+		return false;
+	}
+
+	if ( monitor->lastLogEvent ) {
+		errstack.pushf( "ReadMultipleUserLogs", UTIL_ERR_LOG_FILE,
+					"Log file %s has an unconsumed event",
+					logfile.Value() );
+		return false;
+	}
+
+	if ( !monitor->readUserLog->GetFileState( state ) ) {
+		errstack.pushf( "ReadMultipleUserLogs", UTIL_ERR_LOG_FILE,
+					"Error getting state for log file %s",
+					logfile.Value() );
+		return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Note: logfile is not passed as a reference because we need a local
+// copy to modify anyhow.
+bool
+ReadMultipleUserLogs::setLogFileState( MyString logfile,
+			const ReadUserLog::FileState &state, CondorError &errstack )
+{
+	dprintf( D_LOG_FILES, "ReadMultipleUserLogs::setLogFileState(%s)\n",
+				logfile.Value() );
+
+	MyString fileID;
+	if ( !GetFileID( logfile, fileID, errstack ) ) {
+		errstack.push( "ReadMultipleUserLogs", UTIL_ERR_LOG_FILE,
+					"Error getting file ID in setLogFileState()" );
+		return false;
+	}
+
+	LogFileMonitor *monitor;
+	if ( activeLogFiles.lookup( fileID, monitor ) != 0 ) {
+		errstack.pushf( "ReadMultipleUserLogs", UTIL_ERR_LOG_FILE,
+					"Log file %s (%s) is not being monitored",
+					logfile.Value(), fileID.Value() );
+		return false;
+	}
+
+	ReadUserLog *reader = new ReadUserLog( state );
+	if ( !reader->isInitialized() ) {
+		errstack.pushf( "ReadMultipleUserLogs", UTIL_ERR_LOG_FILE,
+					"Unable to restore state of log file %s",
+					logfile.Value() );
+		delete reader;
+		return false;
+	}
+
+	delete monitor->readUserLog;
+	monitor->readUserLog = reader;
+
+	delete monitor->lastLogEvent;
+	monitor->lastLogEvent = NULL;
+
+	monitor->statusDirty = true;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 // Note: logfile is not passed as a reference because we need a local
 // copy to modify anyhow.
 bool
@@ -813,6 +1056,8 @@ ReadMultipleUserLogs::unmonitorLogFile( MyString logfile,
 		delete monitor->readUserLog;
 		monitor->readUserLog = NULL;
 
+		unwatchLogFile( monitor );
+
 			// Now we remove this file from the "active" list, so
 			// we don't check it the next time we get an event.
 		if ( activeLogFiles.remove( fileID ) != 0 ) {
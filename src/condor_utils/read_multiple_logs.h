@@ -170,6 +170,8 @@ public:
 			If any of the files has grown, return ReadUserLog::LOG_STATUS_GROWN
 			If any of the files is in error state, return ReadUserLog::LOG_STATUS_ERROR
 			Otherwise, return ReadUserLog::LOG_STATUS_NOCHANGE
+			On Linux, only the files that inotify says have changed are
+			stat'ed, except for a periodic check of all of them.
 		 */
 	ReadUserLog::FileStatus GetLogStatus();
 
@@ -195,6 +197,31 @@ public:
 		*/
 	bool unmonitorLogFile(MyString logfile, CondorError &errstack);
 
+		/** Get the state of the reader of a monitored log file, so that
+			reading can later resume from the same place (see
+			setLogFileState()).  Fails if an event has been read from
+			the log that hasn't been returned by readEvent() yet.
+			@param the log file
+			@param the state, which must have been initialized with
+				ReadUserLog::InitFileState()
+			@param a CondorError object to hold any error information
+			@return true if successful, false if failed
+		*/
+	bool getLogFileState(MyString logfile, ReadUserLog::FileState &state,
+				CondorError &errstack);
+
+		/** Make the next event read from a monitored log file be the
+			one after the given saved state.  Any event that has been
+			read from the log but not returned by readEvent() is dropped.
+			@param the log file
+			@param the state from getLogFileState()
+			@param a CondorError object to hold any error information
+			@return true if successful, false if failed (the log file
+				is still read from where it was in that case)
+		*/
+	bool setLogFileState(MyString logfile,
+				const ReadUserLog::FileState &state, CondorError &errstack);
+
 		/** Returns the number of log files we're actively monitoring
 			at the present time.
 		 */
@@ -221,7 +248,7 @@ private:
 	struct LogFileMonitor {
 		LogFileMonitor( const MyString &file ) : logFile(file), refCount(0),
 					readUserLog(NULL), state(NULL), stateError(false),
-					lastLogEvent(NULL) {}
+					lastLogEvent(NULL), watchDesc(-1), statusDirty(true) {}
 
 		~LogFileMonitor() {
 			delete readUserLog;
@@ -259,8 +286,25 @@ private:
 
 			// The last event we read from this log.
 		ULogEvent	*lastLogEvent;
+
+			// The inotify watch on this log, or -1 if it isn't watched.
+		int			watchDesc;
+
+			// True iff the log may have changed since we last checked
+			// its status.
+		bool		statusDirty;
 	};
 
+		// Start and stop watching a log file for changes.
+	void watchLogFile( LogFileMonitor *monitor );
+	void unwatchLogFile( LogFileMonitor *monitor );
+
+		/** Mark the log files that inotify says have changed as dirty.
+			@return true if we lost track of changes, so every log file
+				needs to be checked.
+		*/
+	bool readLogNotifications();
+
 		// allLogFiles contains pointers to all of the LogFileMonitors
 		// we know about; activeLogFiles contains just the active ones
 		// (to make it easier to read events).  Note that active log files
@@ -272,6 +316,14 @@ private:
 
 	HashTable<MyString, LogFileMonitor *>	activeLogFiles;
 
+		// The inotify descriptor that watches all of the active log
+		// files, or -1.
+	int m_inotify_fd;
+
+		// When we last checked the status of every log file, watched or
+		// not, in case a change was missed (e.g., on NFS).
+	time_t m_last_full_check;
+
 	// For instantiation in programs that use this class.
 #define MULTI_LOG_HASH_INSTANCE template class \
 		HashTable<MyString, ReadMultipleUserLogs::LogFileMonitor *>
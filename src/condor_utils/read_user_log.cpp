@@ -31,8 +31,16 @@
 #include "read_user_log_state.h"
 #include "user_log_header.h"
 
+#if !defined(WIN32)
+#include <sys/mman.h>
+#endif
+
 static const char SynchDelimiter[] = "...\n";
 
+// The most of a log file that we will map into memory at one time when
+// reading it through a memory mapping.
+const size_t MAX_LOG_MAP_SIZE = 64 * 1024 * 1024;
+
 // Values for min scores
 const int SCORE_THRESH_RESTORE		= 10;
 const int SCORE_THRESH_FWSEARCH		= 4;
@@ -374,6 +382,14 @@ ReadUserLog::InternalInitialize ( int max_rotations,
 	}
 # endif
 
+	// Read the log through a memory mapping?  There is no point when
+	// the file (and so the mapping) is closed between operations.
+# if defined(WIN32)
+	m_use_mmap = false;
+# else
+	m_use_mmap = !m_close_file && param_boolean( "ENABLE_USERLOG_MMAP", true );
+# endif
+
 	// Now, open the file, setup locks, read the header, etc.
 	if ( restore ) {
 		dprintf( D_FULLDEBUG, "init: ReOpening file %s\n",
@@ -434,6 +450,8 @@ ReadUserLog::CloseLogFile( bool force )
 {
 	if ( force || m_close_file ) {
 
+		unmapLogFile();
+
 		if ( m_lock && m_lock->isLocked() ) {
 			m_lock->release();
 			m_lock_rot = -1;
@@ -974,7 +992,7 @@ ReadUserLog::readEventWithLock (ULogEvent *& event, bool store_state, FileLockBa
 
 	// Store off our current offset
 	if (  ( ULOG_OK == outcome ) && ( store_state )  )  {
-		long	pos = ftell( m_fp );
+		long	pos = getOffset();
 		if ( pos > 0 ) {
 			m_state->Offset( pos );
 		}
@@ -985,7 +1003,11 @@ ReadUserLog::readEventWithLock (ULogEvent *& event, bool store_state, FileLockBa
 			m_state->LogRecordNo( starting_recno + starting_event - 1 );
 		}
 		m_state->EventNumInc();
-		m_state->StatFile( m_fd );
+			// when reading through the mapping, the file is stat'ed
+			// whenever it is remapped, so it doesn't need to be done here
+		if ( m_map_pos < 0 ) {
+			m_state->StatFile( m_fd );
+		}
 	}
 
 	// Close the file between operations
@@ -1095,6 +1117,19 @@ ReadUserLog::readEventNormal( ULogEvent *& event, FileLockBase *lock )
 	int    retval1, retval2;
 	bool   got_sync_line = false;
 
+	if ( m_use_mmap ) {
+		event = NULL;
+		ULogEventOutcome outcome = readEventMapped( event );
+		if ( outcome != ULOG_UNK_ERROR || event ) {
+			return outcome;
+		}
+		// We couldn't map the file, so read it with stdio from now on
+		dprintf( D_FULLDEBUG, "ReadUserLog: can't map %s, reading it "
+				 "without mmap\n", m_state->CurPath() );
+		unmapLogFile();
+		m_use_mmap = false;
+	}
+
 	Lock();
 
 	// store file position so that if we are unable to read the event, we can
@@ -1282,6 +1317,204 @@ ReadUserLog::readEventNormal( ULogEvent *& event, FileLockBase *lock )
 	/* UNREACHED */
 }
 
+ULogEventOutcome
+ReadUserLog::readEventMapped( ULogEvent *& event )
+{
+	event = NULL;
+	if ( !m_fp ) {
+		return ULOG_UNK_ERROR;
+	}
+
+	int64_t pos = m_map_pos;
+	if ( pos < 0 ) {
+		pos = ftell( m_fp );
+		if ( pos < 0 ) {
+			return ULOG_UNK_ERROR;
+		}
+	}
+
+	const char *data = NULL;
+	size_t len = 0;
+	int found = mapEvent( pos, data, len );
+	if ( found < 0 ) {
+		return ULOG_UNK_ERROR;
+	}
+	if ( found == 0 ) {
+		// No complete event yet; a partially written event will be
+		// picked up once the writer finishes it.
+		return ULOG_NO_EVENT;
+	}
+
+	// From here on, the mapping has the current position
+	m_map_pos = pos + len;
+
+	// The event parsers read from a FILE, so give them one over the
+	// mapped event.  The event is complete, so a parse failure means
+	// that the event is bad, and it is skipped.
+	FILE *efp = fmemopen( const_cast<char *>(data), len, "r" );
+	if ( !efp ) {
+		dprintf( D_ALWAYS, "ReadUserLog: fmemopen() failed: %d (%s)\n",
+				 errno, strerror(errno) );
+		m_map_pos = pos;
+		return ULOG_UNK_ERROR;
+	}
+
+	int eventnumber = -1;
+	bool got_sync_line = false;
+	int retval1 = fscanf( efp, "%d", &eventnumber );
+	if ( retval1 == 1 ) {
+		event = instantiateEvent( (ULogEventNumber) eventnumber );
+	}
+	if ( !event ) {
+		dprintf( D_FULLDEBUG, "ReadUserLog: unable to read event number "
+				 "at offset %lld\n", (long long)pos );
+		fclose( efp );
+		return ULOG_RD_ERROR;
+	}
+	int retval2 = event->getEvent( efp, got_sync_line );
+	fclose( efp );
+
+	if ( !retval2 ) {
+		dprintf( D_FULLDEBUG, "ReadUserLog: error reading event at "
+				 "offset %lld\n", (long long)pos );
+		delete event;
+		event = NULL;
+		return ULOG_RD_ERROR;
+	}
+
+	return ULOG_OK;
+}
+
+// Returns a pointer to the character after the "..." delimiter line that
+// ends the event starting at data, or NULL if the event is incomplete.
+static const char *
+findEventEnd( const char *data, size_t len )
+{
+	const char *end = data + len;
+	const char *p = data;
+	while ( p < end ) {
+		// memmem is vectorized in glibc, so this scans much faster than
+		// reading line by line.
+		const char *dots = (const char *)memmem( p, end - p, "\n...", 4 );
+		if ( !dots ) {
+			return NULL;
+		}
+		const char *eol = dots + 4;
+		if ( eol < end && *eol == '\r' ) {
+			++eol;
+		}
+		if ( eol >= end ) {
+			return NULL;
+		}
+		if ( *eol == '\n' ) {
+			return eol + 1;
+		}
+		p = dots + 1;
+	}
+	return NULL;
+}
+
+int
+ReadUserLog::mapEvent( int64_t offset, const char *& data, size_t & len )
+{
+#if defined(WIN32)
+	return -1;
+#else
+	// Touching a mapped page past the end of the file raises SIGBUS, so
+	// check the size before every scan.  If the file has shrunk under
+	// the mapping (it was truncated or rewritten in place), read it with
+	// stdio, which copes with that, from now on.
+	StatWrapper sw;
+	if ( sw.Stat( m_fd ) ) {
+		dprintf( D_FULLDEBUG, "ReadUserLog: fstat failed: %d\n",
+				 sw.GetErrno() );
+		return -1;
+	}
+	int64_t size = sw.GetBuf()->st_size;
+	if ( m_map && size < m_map_start + (int64_t)m_map_size ) {
+		dprintf( D_FULLDEBUG, "ReadUserLog: %s shrank to %lld bytes "
+				 "while mapped\n", m_state->CurPath(), (long long)size );
+		return -1;
+	}
+
+	for ( int pass = 0; pass < 2; ++pass ) {
+		if ( m_map && offset >= m_map_start &&
+			 offset < m_map_start + (int64_t)m_map_size ) {
+			const char *start = m_map + (offset - m_map_start);
+			size_t avail = (size_t)(m_map_start + m_map_size - offset);
+			const char *end = findEventEnd( start, avail );
+			if ( end ) {
+				data = start;
+				len = end - start;
+				return 1;
+			}
+		}
+		if ( pass ) {
+			break;
+		}
+
+		// Map from the event to the current end of the file.
+		if ( m_map && offset >= m_map_start &&
+			 size <= m_map_start + (int64_t)m_map_size ) {
+			return 0;	// nothing new since we mapped it
+		}
+		if ( size <= offset ) {
+			return 0;
+		}
+
+		int64_t page = getpagesize();
+		int64_t map_start = offset - (offset % page);
+		size_t map_size = (size_t)(size - map_start);
+		if ( map_size > MAX_LOG_MAP_SIZE ) {
+			map_size = MAX_LOG_MAP_SIZE;
+		}
+
+		if ( m_map ) {
+			munmap( m_map, m_map_size );
+			m_map = NULL;
+			m_map_size = 0;
+		}
+		void *map = mmap( NULL, map_size, PROT_READ, MAP_SHARED, m_fd,
+						  (off_t)map_start );
+		if ( map == MAP_FAILED ) {
+			dprintf( D_FULLDEBUG, "ReadUserLog: mmap failed: %d (%s)\n",
+					 errno, strerror(errno) );
+			return -1;
+		}
+		m_map = (char *)map;
+		m_map_start = map_start;
+		m_map_size = map_size;
+		m_state->StatFile( m_fd );
+	}
+
+	// An event that doesn't fit in the largest mapping we are willing to
+	// make can only be read with stdio.
+	if ( m_map_size == MAX_LOG_MAP_SIZE && offset == m_map_start ) {
+		return -1;
+	}
+	return 0;
+#endif
+}
+
+void
+ReadUserLog::unmapLogFile( void )
+{
+	if ( m_map_pos >= 0 ) {
+		if ( m_fp ) {
+			fseek( m_fp, m_map_pos, SEEK_SET );
+		}
+		m_map_pos = -1;
+	}
+#if !defined(WIN32)
+	if ( m_map ) {
+		munmap( m_map, m_map_size );
+	}
+#endif
+	m_map = NULL;
+	m_map_size = 0;
+	m_map_start = 0;
+}
+
 // Static method for initializing a file state
 bool
 ReadUserLog::InitFileState( ReadUserLog::FileState &state )
@@ -1416,6 +1649,12 @@ ReadUserLog::clear( void )
 	m_lock = NULL;
 	m_lock_rot = -1;
 
+	m_use_mmap = false;
+	m_map = NULL;
+	m_map_size = 0;
+	m_map_start = 0;
+	m_map_pos = -1;
+
 	m_close_file = false;
 	m_read_only = false;
 	m_enable_close = true;
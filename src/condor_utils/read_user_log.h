@@ -257,8 +257,8 @@ class ReadUserLog
 
 	/** These methods only do anything useful for anything other
 	    than job event logs (which do not rotate). */
-	size_t getOffset() const { return ftell(m_fp); }
-	void setOffset(size_t offset) { fseek(m_fp, offset, SEEK_SET); }
+	size_t getOffset() const { return (m_map_pos >= 0) ? (size_t)m_map_pos : ftell(m_fp); }
+	void setOffset(size_t offset) { m_map_pos = -1; fseek(m_fp, offset, SEEK_SET); }
 
 	/** Methods to serialize the state.
 		Always use InitFileState() to initialize this structure.
@@ -418,6 +418,30 @@ class ReadUserLog
     */
     ULogEventOutcome readEventNormal (ULogEvent * & event, FileLockBase *lock);
 
+    /** Read the next event from the old style log file through a memory
+		mapping of the file.  Only complete events (those followed by the
+		"..." delimiter) are parsed, so no lock is needed and a partially
+		written event is simply left for the next call.
+        @param event pointer to be set to new object
+        @return the outcome of attempting to read the log, or
+		 ULOG_UNK_ERROR with event left NULL if the file can't be mapped
+    */
+    ULogEventOutcome readEventMapped (ULogEvent * & event);
+
+	/** Find the complete event that starts at the given file offset in
+		the mapped file, mapping (or remapping) the file as needed.
+		@param offset of the start of the event
+		@param set to the start of the event in memory
+		@param set to the length of the event, including the delimiter
+		@return 1 if found, 0 if there is no complete event, -1 on error
+	 */
+	int mapEvent( int64_t offset, const char *& data, size_t & len );
+
+	/** Remove the memory mapping of the file, and move the file pointer
+		to the position of the last event read through it.
+	 */
+	void unmapLogFile( void );
+
 	/** Reopen the log file
 		@param Restore from state?
 		@return the outcome of the re-open attempt
@@ -475,6 +499,15 @@ class ReadUserLog
     FileLockBase		*m_lock;		  /** The log file lock */
 	int					 m_lock_rot;	  /** Lock managing what rotation #? */
 
+	bool				 m_use_mmap;	  /** Read through a memory mapping? */
+	char				*m_map;			  /** The mapped part of the file */
+	size_t				 m_map_size;	  /** Size of the mapping */
+	int64_t				 m_map_start;	  /** File offset of the mapping */
+	int64_t				 m_map_pos;		  /** File offset of the next event
+											  when reading through the
+											  mapping, -1 when m_fp has the
+											  current position */
+
 	/* Error history data */
 	mutable ErrorType	 m_error;		/** Type of latest error (think errno) */
 	mutable unsigned	 m_line_num;	/** Line number of latest error */
@@ -25,6 +25,12 @@
 #include "selector.h"
 #include "condor_threads.h"
 
+#include <algorithm>
+
+#ifdef CONDOR_HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifndef SELECTOR_USE_POLL
 #define POLLIN 1
 #define POLLOUT 2
@@ -71,12 +77,21 @@ Selector::Selector()
 	save_write_fds = NULL;
 	save_except_fds = NULL;
 
+	m_epfd = -1;
+	m_epoll_pid = 0;
+	m_num_watched = 0;
+
 	reset();
 }
 
 Selector::~Selector()
 {
 	free( read_fds );
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd != -1 && m_epoll_pid == getpid() ) {
+		close( m_epfd );
+	}
+#endif
 }
 
 void
@@ -120,6 +135,15 @@ Selector::reset()
 	timeout_wanted = false;
 	timeout.tv_sec = timeout.tv_usec = 0;
 
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd != -1 ) {
+			// persistent mode: the interest set stays registered in the
+			// kernel, we only forget the results of the last execute().
+		epoll_clear_ready();
+		return;
+	}
+#endif
+
 	max_fd = -1;
 	if ( save_read_fds != NULL ) {
 #if defined(WIN32)
@@ -213,6 +237,11 @@ Selector::add_fd( int fd, IO_FUNC interest )
 	}
 #endif
 
+	if ( m_epfd != -1 ) {
+		set_fd_interest( fd, m_interest[fd] | (1 << interest) );
+		return;
+	}
+
 
 	if(IsDebugLevel(D_DAEMONCORE)) {
 		char *fd_description = describe_fd(fd);
@@ -287,6 +316,11 @@ Selector::delete_fd( int fd, IO_FUNC interest )
 	}
 #endif
 
+	if ( m_epfd != -1 ) {
+		set_fd_interest( fd, m_interest[fd] & ~(1 << interest) );
+		return;
+	}
+
 	init_fd_sets();
 	m_single_shot = SINGLE_SHOT_SKIP;
 
@@ -341,6 +375,19 @@ Selector::execute()
 	struct timeval timeout_copy;
 	struct timeval	*tp;
 
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd != -1 ) {
+		if( timeout_wanted ) {
+			timeout_copy = timeout;
+			tp = &timeout_copy;
+		} else {
+			tp = NULL;
+		}
+		epoll_execute( tp );
+		return;
+	}
+#endif
+
 	if ( m_single_shot == SINGLE_SHOT_SKIP ) {
 		memcpy( read_fds, save_read_fds, fd_set_size * sizeof(fd_set) );
 		memcpy( write_fds, save_write_fds, fd_set_size * sizeof(fd_set) );
@@ -421,6 +468,13 @@ Selector::fd_ready( int fd, IO_FUNC interest )
 	}
 #endif
 
+	if ( m_epfd != -1 ) {
+		if ( fd < 0 || fd >= (int)m_revents.size() ) {
+			return false;
+		}
+		return (m_revents[fd] & (1 << interest)) != 0;
+	}
+
 	switch( interest ) {
 
 	  case IO_READ:
@@ -471,8 +525,10 @@ Selector::display()
 	// TODO This function doesn't properly handle situations where
 	//   poll() is used to query a single fd. Currently, it's only
 	//   called in DaemonCore::Driver(), where we should always be
-	//   in select() mode.
-	init_fd_sets();
+	//   in select() or persistent mode.
+	if ( m_epfd == -1 ) {
+		init_fd_sets();
+	}
 
 	switch( state ) {
 
@@ -497,6 +553,35 @@ Selector::display()
 		break;
 	}
 
+	if ( m_epfd != -1 ) {
+		dprintf( D_ALWAYS, "Persistent (epoll) selector, %d fds watched\n",
+				 m_num_watched );
+		dprintf( D_ALWAYS, "Watched FD's {" );
+		for ( int fd = 0; fd < (int)m_interest.size(); fd++ ) {
+			if ( m_interest[fd] ) {
+				dprintf( D_ALWAYS | D_NOHEADER, "%d:%d ", fd, m_interest[fd] );
+			}
+		}
+		dprintf( D_ALWAYS | D_NOHEADER, "}\n" );
+		if ( state == FDS_READY ) {
+			dprintf( D_ALWAYS, "Ready FD's {" );
+			for ( size_t i = 0; i < m_ready_fds.size(); i++ ) {
+				int fd = m_ready_fds[i];
+				dprintf( D_ALWAYS | D_NOHEADER, "%d:%d ", fd, m_revents[fd] );
+			}
+			dprintf( D_ALWAYS | D_NOHEADER, "} = %d\n", (int)m_ready_fds.size() );
+		}
+		if( timeout_wanted ) {
+			dprintf( D_ALWAYS,
+				"Timeout = %ld.%06ld seconds\n", (long) timeout.tv_sec,
+				(long) timeout.tv_usec
+			);
+		} else {
+			dprintf( D_ALWAYS, "Timeout not wanted\n" );
+		}
+		return;
+	}
+
 	dprintf( D_ALWAYS, "max_fd = %d\n", max_fd );
 
 	dprintf( D_ALWAYS, "Selection FD's\n" );
@@ -522,6 +607,283 @@ Selector::display()
 
 }
 
+bool
+Selector::enable_persistent()
+{
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd != -1 ) {
+		return true;
+	}
+	if ( ! epoll_create_fd() ) {
+		return false;
+	}
+	m_interest.assign( fd_select_size(), 0 );
+	m_revents.assign( fd_select_size(), 0 );
+	m_ready_fds.clear();
+	m_no_poll_fds.clear();
+	m_num_watched = 0;
+	reset();
+	return true;
+#else
+	return false;
+#endif
+}
+
+void
+Selector::set_fd_interest( int fd, int interest_mask, bool force )
+{
+	if ( m_epfd == -1 ) {
+		if ( interest_mask & IO_READ_MASK ) {
+			add_fd( fd, IO_READ );
+		}
+		if ( interest_mask & IO_WRITE_MASK ) {
+			add_fd( fd, IO_WRITE );
+		}
+		if ( interest_mask & IO_EXCEPT_MASK ) {
+			add_fd( fd, IO_EXCEPT );
+		}
+		return;
+	}
+
+#ifdef CONDOR_HAVE_EPOLL
+	if ( fd < 0 || fd >= (int)m_interest.size() ) {
+		EXCEPT( "Selector::set_fd_interest(): fd %d outside valid range 0-%d",
+				fd, (int)m_interest.size()-1 );
+	}
+	int old_mask = m_interest[fd];
+	if ( old_mask == interest_mask && ! force ) {
+		return;
+	}
+	epoll_update( fd, old_mask, interest_mask, force );
+#endif
+}
+
+void
+Selector::forget_fd( int fd )
+{
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd == -1 || fd < 0 || fd >= (int)m_interest.size() ) {
+		return;
+	}
+	if ( m_interest[fd] ) {
+		epoll_update( fd, m_interest[fd], 0, false );
+	}
+		// the fd may have been in the ready list of the last execute()
+	m_revents[fd] = 0;
+#else
+	(void)fd;
+#endif
+}
+
+int
+Selector::num_ready() const
+{
+	if ( m_epfd != -1 ) {
+		return (int)m_ready_fds.size();
+	}
+	return _select_retval > 0 ? _select_retval : 0;
+}
+
+#ifdef CONDOR_HAVE_EPOLL
+
+static uint32_t
+io_mask_to_epoll( int mask )
+{
+	uint32_t events = 0;
+	if ( mask & Selector::IO_READ_MASK ) {
+		events |= EPOLLIN;
+	}
+	if ( mask & Selector::IO_WRITE_MASK ) {
+		events |= EPOLLOUT;
+	}
+	if ( mask & Selector::IO_EXCEPT_MASK ) {
+		events |= EPOLLPRI;
+	}
+	return events;
+}
+
+bool
+Selector::epoll_create_fd()
+{
+	m_epfd = epoll_create1( EPOLL_CLOEXEC );
+	if ( m_epfd == -1 ) {
+		dprintf( D_ALWAYS, "Selector: epoll_create1 failed, using select(): %s (errno=%d)\n",
+				 strerror(errno), errno );
+		return false;
+	}
+	m_epoll_pid = getpid();
+	return true;
+}
+
+void
+Selector::epoll_check_owner()
+{
+	if ( m_epoll_pid == getpid() ) {
+		return;
+	}
+
+		// A child created by fork() without exec shares our epoll
+		// instance with the parent, so any change we make would also
+		// change what the parent is waiting on.  Build our own
+		// instance from the cached interest set before touching it.
+	close( m_epfd );
+	if ( ! epoll_create_fd() ) {
+		EXCEPT( "Selector: failed to recreate epoll fd after fork" );
+	}
+	m_no_poll_fds.clear();
+	m_num_watched = 0;
+	for ( int fd = 0; fd < (int)m_interest.size(); fd++ ) {
+		if ( m_interest[fd] ) {
+			int mask = m_interest[fd];
+			m_interest[fd] = 0;
+			epoll_update( fd, 0, mask, true );
+		}
+	}
+}
+
+void
+Selector::epoll_update( int fd, int old_mask, int new_mask, bool force )
+{
+	if ( m_epoll_pid != getpid() ) {
+		epoll_check_owner();
+		old_mask = m_interest[fd];
+		force = true;
+	}
+
+	struct epoll_event event;
+	memset( &event, 0, sizeof(event) );
+	event.events = io_mask_to_epoll( new_mask );
+	event.data.fd = fd;
+
+	int rc = 0;
+	if ( new_mask == 0 ) {
+		rc = epoll_ctl( m_epfd, EPOLL_CTL_DEL, fd, &event );
+			// ENOENT/EBADF here just means the kernel already dropped it
+			// (e.g. the fd was closed before being cancelled).
+	} else if ( old_mask == 0 || force ) {
+		rc = epoll_ctl( m_epfd, EPOLL_CTL_ADD, fd, &event );
+		if ( rc == -1 && errno == EEXIST ) {
+			rc = epoll_ctl( m_epfd, EPOLL_CTL_MOD, fd, &event );
+		}
+	} else {
+		rc = epoll_ctl( m_epfd, EPOLL_CTL_MOD, fd, &event );
+		if ( rc == -1 && errno == ENOENT ) {
+				// the kernel forgot this fd because it was closed
+				// and the number reused; register it afresh.
+			rc = epoll_ctl( m_epfd, EPOLL_CTL_ADD, fd, &event );
+		}
+	}
+
+		// epoll refuses descriptors that are always ready, such as plain
+		// files.  select() would report those ready on every call, so
+		// we emulate that in epoll_execute().
+	bool no_poll = ( rc == -1 && errno == EPERM && new_mask != 0 );
+	std::vector<int>::iterator it = std::find( m_no_poll_fds.begin(), m_no_poll_fds.end(), fd );
+	if ( it != m_no_poll_fds.end() && ( ! no_poll ) ) {
+		m_no_poll_fds.erase( it );
+	} else if ( it == m_no_poll_fds.end() && no_poll ) {
+		m_no_poll_fds.push_back( fd );
+	}
+
+	if ( rc == -1 && ! no_poll && new_mask != 0 ) {
+		dprintf( D_ALWAYS, "Selector: epoll_ctl failed for fd %d: %s (errno=%d)\n",
+				 fd, strerror(errno), errno );
+	}
+
+	if ( old_mask && ! new_mask ) {
+		m_num_watched--;
+	} else if ( new_mask && ! old_mask ) {
+		m_num_watched++;
+	}
+	m_interest[fd] = (unsigned char)new_mask;
+
+	if (IsDebugLevel(D_DAEMONCORE)) {
+		dprintf(D_DAEMONCORE | D_VERBOSE, "selector %p fd %d interest %d -> %d\n",
+				this, fd, old_mask, new_mask);
+	}
+}
+
+void
+Selector::epoll_clear_ready()
+{
+	for ( size_t i = 0; i < m_ready_fds.size(); i++ ) {
+		m_revents[m_ready_fds[i]] = 0;
+	}
+	m_ready_fds.clear();
+}
+
+void
+Selector::epoll_execute( struct timeval *tp )
+{
+	int max_events = m_num_watched > 0 ? m_num_watched : 1;
+	if ( (int)(m_event_buf.size() / sizeof(struct epoll_event)) < max_events ) {
+		m_event_buf.resize( max_events * sizeof(struct epoll_event) );
+	}
+	struct epoll_event *events = (struct epoll_event *)&m_event_buf[0];
+
+	epoll_check_owner();
+
+	int timeout_ms = -1;
+	if ( tp && tp->tv_sec < INT_MAX / 1000 - 1 ) {
+		timeout_ms = (int)(1000*tp->tv_sec + (tp->tv_usec + 999)/1000);
+	}
+	if ( ! m_no_poll_fds.empty() ) {
+		timeout_ms = 0;
+	}
+
+	epoll_clear_ready();
+	_select_retval = -2;
+
+	start_thread_safe("select");
+	int nfds = epoll_wait( m_epfd, events, max_events, timeout_ms );
+	_select_errno = errno;
+	stop_thread_safe("select");
+
+	if( nfds < 0 ) {
+		_select_retval = nfds;
+		if( _select_errno == EINTR ) {
+			state = SIGNALLED;
+			return;
+		}
+		state = FAILED;
+		return;
+	}
+	_select_errno = 0;
+
+	for ( int i = 0; i < nfds; i++ ) {
+		int fd = events[i].data.fd;
+		uint32_t ev = events[i].events;
+		unsigned char mask = 0;
+			// select() reports errors and hangups as readable and
+			// writable, so do the same here.
+		if ( ev & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR) ) {
+			mask |= IO_READ_MASK;
+		}
+		if ( ev & (EPOLLOUT | EPOLLHUP | EPOLLERR) ) {
+			mask |= IO_WRITE_MASK;
+		}
+		if ( ev & EPOLLPRI ) {
+			mask |= IO_EXCEPT_MASK;
+		}
+		if ( mask && ! m_revents[fd] ) {
+			m_ready_fds.push_back( fd );
+		}
+		m_revents[fd] |= mask;
+	}
+	for ( size_t i = 0; i < m_no_poll_fds.size(); i++ ) {
+		int fd = m_no_poll_fds[i];
+		if ( ! m_revents[fd] ) {
+			m_ready_fds.push_back( fd );
+		}
+		m_revents[fd] |= m_interest[fd];
+	}
+
+	_select_retval = (int)m_ready_fds.size();
+	state = m_ready_fds.empty() ? TIMED_OUT : FDS_READY;
+}
+
+#endif /* CONDOR_HAVE_EPOLL */
+
 void
 display_fd_set( const char *msg, fd_set *set, int max, bool try_dup )
 {
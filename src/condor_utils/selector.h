@@ -22,6 +22,7 @@
 #define SELECTOR_H
 
 #include "condor_common.h"
+#include <vector>
 
 #ifdef CONDOR_HAVE_POLL
 #define SELECTOR_USE_POLL 1
@@ -49,6 +50,13 @@ public:
 		IO_READ, IO_WRITE, IO_EXCEPT
 	};
 
+		// Bit mask form of IO_FUNC, used by set_fd_interest()
+	enum IO_MASK {
+		IO_READ_MASK = (1 << IO_READ),
+		IO_WRITE_MASK = (1 << IO_WRITE),
+		IO_EXCEPT_MASK = (1 << IO_EXCEPT)
+	};
+
 	enum SELECTOR_STATE {
 		VIRGIN, FDS_READY, TIMED_OUT, SIGNALLED, FAILED
 	};
@@ -69,10 +77,50 @@ public:
 	bool fd_ready( int fd, IO_FUNC interest );
 	void display();
 
+		/** Switch this selector to a persistent (epoll) backend.
+			In persistent mode the interest set lives in the kernel:
+			reset() only clears the results of the last execute(),
+			and set_fd_interest() only makes a system call when the
+			interest for an fd actually changes, so execute() costs
+			O(ready fds) rather than O(registered fds).
+			Returns false (and stays in select mode) if the platform
+			does not support it.
+		*/
+	bool enable_persistent();
+	bool is_persistent() const { return m_epfd != -1; }
+
+		/** Set the interest for fd to the given IO_MASK bits; a mask
+			of 0 removes it.  In select mode this is the same as
+			calling add_fd() for each bit.  If force is true, the
+			kernel registration is refreshed even if our cached
+			interest is unchanged (use this when fd may be a newly
+			opened descriptor that reused a number).
+		*/
+	void set_fd_interest( int fd, int interest_mask, bool force = false );
+
+		/// Drop any persistent interest in fd.  Must be called before fd
+		/// is closed.  No-op in select mode.
+	void forget_fd( int fd );
+
+		/// Number of fds reported ready by the last execute()
+	int num_ready() const;
+
+		/// In persistent mode, the fds reported ready by the last
+		/// execute(), so callers need not ask fd_ready() of every fd.
+	const std::vector<int> & ready_fds() const { return m_ready_fds; }
+
 private:
 
 	void init_fd_sets();
 
+#ifdef CONDOR_HAVE_EPOLL
+	bool epoll_create_fd();
+	void epoll_check_owner();
+	void epoll_update( int fd, int old_mask, int new_mask, bool force );
+	void epoll_execute( struct timeval *tp );
+	void epoll_clear_ready();
+#endif
+
 	enum SINGLE_SHOT {
 		SINGLE_SHOT_VIRGIN, SINGLE_SHOT_OK, SINGLE_SHOT_SKIP
 	};
@@ -95,6 +143,16 @@ private:
 #else
 	struct fake_pollfd m_poll;
 #endif
+
+		// persistent (epoll) state; m_epfd is -1 in select mode
+	int		m_epfd;
+	pid_t	m_epoll_pid;		// process that created m_epfd
+	int		m_num_watched;
+	std::vector<unsigned char> m_interest;	// IO_MASK bits, indexed by fd
+	std::vector<unsigned char> m_revents;	// IO_MASK bits, indexed by fd
+	std::vector<int> m_ready_fds;			// fds set in m_revents
+	std::vector<int> m_no_poll_fds;			// fds epoll refused (e.g. plain files)
+	std::vector<char> m_event_buf;			// struct epoll_event array
 };
 
 void display_fd_set( const char *msg, fd_set *set, int max,
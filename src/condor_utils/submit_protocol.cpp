@@ -133,6 +133,9 @@ int ActualScheddQ::init_capabilities() {
 				late_ver = 1;
 			}
 		}
+
+		has_bulk = false;
+		capabilities.LookupBool("BulkSubmit", has_bulk);
 	}
 	return rval;
 }
@@ -145,6 +148,10 @@ bool ActualScheddQ::allows_late_materialize() {
 	init_capabilities();
 	return allows_late;
 }
+bool ActualScheddQ::has_bulk_submit() {
+	init_capabilities();
+	return has_bulk;
+}
 int ActualScheddQ::get_Capabilities(ClassAd & caps) {
 	int rval = init_capabilities();
 	if (rval == 0) {
@@ -165,6 +172,13 @@ int ActualScheddQ::set_Factory(int cluster, int qnum, const char * filename, con
 	return SetJobFactory(cluster, qnum, filename, text);
 }
 
+int ActualScheddQ::send_BulkSubmit(int cluster, int first_proc, const classad::ClassAd * cluster_ad,
+	const std::vector<std::string> & columns, const std::vector< std::vector<std::string> > & proc_rows,
+	SetAttributeFlags_t flags)
+{
+	return BulkSubmit(cluster, first_proc, cluster_ad, columns, proc_rows, flags);
+}
+
 // helper function used as 3rd argument to SendMaterializeData.
 // it treats pv as a pointer to SubmitForeachArgs, calls next() on it and then formats the
 // resulting rowdata for SendMaterializeData to use.  This could be a free function
@@ -20,6 +20,10 @@ public:
 	virtual bool allows_late_materialize() = 0;
 	virtual int set_Factory(int cluster, int qnum, const char * filename, const char * text) = 0;
 	virtual int send_Itemdata(int cluster, SubmitForeachArgs & o) = 0;
+	virtual bool has_bulk_submit() = 0;
+	virtual int send_BulkSubmit(int cluster, int first_proc, const classad::ClassAd * cluster_ad,
+		const std::vector<std::string> & columns, const std::vector< std::vector<std::string> > & proc_rows,
+		SetAttributeFlags_t flags = 0) = 0;
 
 	// helper function used as 3rd argument to SendMaterializeData.
 	// it treats pv as a pointer to SubmitForeachArgs, calls next() on it and then formats the
@@ -39,7 +43,7 @@ enum {
 
 class ActualScheddQ : public AbstractScheddQ {
 public:
-	ActualScheddQ() : qmgr(NULL), tried_to_get_capabilities(false), has_late(false), allows_late(false), late_ver(0) {}
+	ActualScheddQ() : qmgr(NULL), tried_to_get_capabilities(false), has_late(false), allows_late(false), has_bulk(false), late_ver(0) {}
 	virtual ~ActualScheddQ();
 	virtual int get_NewCluster();
 	virtual int get_NewProc(int cluster_id);
@@ -55,6 +59,10 @@ public:
 	virtual bool allows_late_materialize(); // capabilities check ffor late materialize enabled.
 	virtual int set_Factory(int cluster, int qnum, const char * filename, const char * text);
 	virtual int send_Itemdata(int cluster, SubmitForeachArgs & o);
+	virtual bool has_bulk_submit(); // capabilities check for the BulkSubmit command
+	virtual int send_BulkSubmit(int cluster, int first_proc, const classad::ClassAd * cluster_ad,
+		const std::vector<std::string> & columns, const std::vector< std::vector<std::string> > & proc_rows,
+		SetAttributeFlags_t flags = 0);
 
 	bool Connect(DCSchedd & MySchedd, CondorError & errstack);
 private:
@@ -63,6 +71,7 @@ private:
 	bool tried_to_get_capabilities;
 	bool has_late; // set in Connect based on the version in DCSchedd
 	bool allows_late;
+	bool has_bulk; // set in init_capabilities
 	char late_ver;
 	int init_capabilities();
 };
\ No newline at end of file
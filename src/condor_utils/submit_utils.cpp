@@ -5004,6 +5004,7 @@ static const SimpleSubmitKeyword prunable_keywords[] = {
 	// formerly SetTransferFiles
 	{SUBMIT_KEY_MaxTransferInputMB, ATTR_MAX_TRANSFER_INPUT_MB, SimpleSubmitKeyword::f_as_expr},
 	{SUBMIT_KEY_MaxTransferOutputMB, ATTR_MAX_TRANSFER_OUTPUT_MB, SimpleSubmitKeyword::f_as_expr},
+	{SUBMIT_KEY_ParallelTransferStreams, ATTR_PARALLEL_TRANSFER_STREAMS, SimpleSubmitKeyword::f_as_int},
 
 	{SUBMIT_KEY_ManifestDesired, ATTR_JOB_MANIFEST_DESIRED, SimpleSubmitKeyword::f_as_bool},
 	{SUBMIT_KEY_ManifestDir, ATTR_JOB_MANIFEST_DIR, SimpleSubmitKeyword::f_as_string},
@@ -415,6 +415,249 @@ void UserPolicy::ResetTriggers()
 	m_fire_expr = NULL;
 }
 
+// Add the attributes that tree refers to to refs, following references into
+// the other attributes of the ad. indirect is true while walking the value of
+// a referenced attribute rather than the policy expression itself.
+static int
+PolicyExprReferences(ClassAd &ad, classad::ExprTree *tree, classad::References &refs, bool indirect)
+{
+	if ( ! tree) return 0;
+
+	int flags = 0;
+	const int time_flag = indirect ? PERIODIC_POLICY_VOLATILE : PERIODIC_POLICY_TIME;
+
+	switch (tree->GetKind()) {
+	case classad::ExprTree::ATTRREF_NODE: {
+		classad::ExprTree *base = NULL;
+		std::string name, scope;
+		bool absolute = false;
+		((classad::AttributeReference*)tree)->GetComponents(base, name, absolute);
+		if (base) {
+			if ( ! ExprTreeIsAttrRef(base, scope)) {
+				return PolicyExprReferences(ad, base, refs, indirect);
+			}
+			// there is no target ad when the schedd evaluates policy
+			if (strcasecmp(scope.c_str(), "target") == MATCH) {
+				return 0;
+			}
+			// for a nested ad, depend on the whole attribute that holds it
+			if (strcasecmp(scope.c_str(), "my") != MATCH && strcasecmp(scope.c_str(), "self") != MATCH) {
+				name = scope;
+			}
+		}
+		if (strcasecmp(name.c_str(), ATTR_CURRENT_TIME) == MATCH && ! ad.Lookup(name)) {
+			return time_flag;
+		}
+		if (refs.insert(name).second) {
+			flags |= PolicyExprReferences(ad, ad.Lookup(name), refs, true);
+		}
+		break;
+	}
+
+	case classad::ExprTree::OP_NODE: {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		flags |= PolicyExprReferences(ad, t1, refs, indirect);
+		flags |= PolicyExprReferences(ad, t2, refs, indirect);
+		flags |= PolicyExprReferences(ad, t3, refs, indirect);
+		break;
+	}
+
+	case classad::ExprTree::FN_CALL_NODE: {
+		std::string fnName;
+		std::vector<classad::ExprTree*> args;
+		((classad::FunctionCall*)tree)->GetComponents(fnName, args);
+		const char * fn = fnName.c_str();
+		if (strcasecmp(fn, "time") == MATCH) {
+			flags |= time_flag;
+		} else if (strcasecmp(fn, "currentTime") == MATCH ||
+				strcasecmp(fn, "random") == MATCH ||
+				strcasecmp(fn, "eval") == MATCH ||
+				strcasecmp(fn, "localTimeZoneOffset") == MATCH ||
+				(strcasecmp(fn, "formatTime") == MATCH && args.empty())) {
+			flags |= PERIODIC_POLICY_VOLATILE;
+		}
+		for (auto it = args.begin(); it != args.end(); ++it) {
+			flags |= PolicyExprReferences(ad, *it, refs, indirect);
+		}
+		break;
+	}
+
+	case classad::ExprTree::CLASSAD_NODE: {
+		std::vector< std::pair<std::string, classad::ExprTree*> > attrs;
+		((classad::ClassAd*)tree)->GetComponents(attrs);
+		for (auto it = attrs.begin(); it != attrs.end(); ++it) {
+			flags |= PolicyExprReferences(ad, it->second, refs, indirect);
+		}
+		break;
+	}
+
+	case classad::ExprTree::EXPR_LIST_NODE: {
+		std::vector<classad::ExprTree*> list;
+		((classad::ExprList*)tree)->GetComponents(list);
+		for (auto it = list.begin(); it != list.end(); ++it) {
+			flags |= PolicyExprReferences(ad, *it, refs, indirect);
+		}
+		break;
+	}
+
+	case classad::ExprTree::EXPR_ENVELOPE:
+		flags |= PolicyExprReferences(ad, SkipExprEnvelope(tree), refs, indirect);
+		break;
+
+	default:
+		break;
+	}
+
+	return flags;
+}
+
+// Returns a copy of tree in which calls to time() are replaced by references
+// to CurrentTime, so that the expression can be evaluated as of another time
+// by binding CurrentTime in an ad chained to the job.
+static classad::ExprTree *
+BindPolicyTimeRefs(classad::ExprTree *tree)
+{
+	if ( ! tree) return NULL;
+
+	switch (tree->GetKind()) {
+	case classad::ExprTree::OP_NODE: {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		return classad::Operation::MakeOperation(op, BindPolicyTimeRefs(t1), BindPolicyTimeRefs(t2), BindPolicyTimeRefs(t3));
+	}
+
+	case classad::ExprTree::FN_CALL_NODE: {
+		std::string fnName;
+		std::vector<classad::ExprTree*> args;
+		((classad::FunctionCall*)tree)->GetComponents(fnName, args);
+		if (strcasecmp(fnName.c_str(), "time") == MATCH && args.empty()) {
+			return classad::AttributeReference::MakeAttributeReference(NULL, ATTR_CURRENT_TIME);
+		}
+		for (auto it = args.begin(); it != args.end(); ++it) {
+			*it = BindPolicyTimeRefs(*it);
+		}
+		return classad::FunctionCall::MakeFunctionCall(fnName, args);
+	}
+
+	case classad::ExprTree::ATTRREF_NODE: {
+		classad::ExprTree *base = NULL;
+		std::string name, scope;
+		bool absolute = false;
+		((classad::AttributeReference*)tree)->GetComponents(base, name, absolute);
+		if (base && ! ExprTreeIsAttrRef(base, scope)) {
+			return classad::AttributeReference::MakeAttributeReference(BindPolicyTimeRefs(base), name, absolute);
+		}
+		return tree->Copy();
+	}
+
+	case classad::ExprTree::EXPR_ENVELOPE:
+		return BindPolicyTimeRefs(SkipExprEnvelope(tree));
+
+	default:
+		return tree->Copy();
+	}
+}
+
+// evaluate a bound policy expression as of time t, returning 0 or 1 for a
+// false or true result, 2 for undefined and 3 for anything else.
+static int
+ProbePolicyExpr(ClassAd &probe, classad::ExprTree *expr, time_t t)
+{
+	probe.InsertAttr(ATTR_CURRENT_TIME, (long long)t);
+
+	long long ival = 0;
+	classad::Value val;
+	if ( ! probe.EvaluateExpr(expr, val)) {
+		return 3;
+	}
+	if (val.IsNumber(ival)) {
+		return ival != 0;
+	}
+	return val.IsUndefinedValue() ? 2 : 3;
+}
+
+int UserPolicy::PeriodicPolicyReferences(ClassAd &ad, classad::References &refs)
+{
+	classad::References seen;
+	seen.insert(ATTR_JOB_STATUS);
+	seen.insert(ATTR_TIMER_REMOVE_CHECK);
+
+	int flags = 0;
+	const char * attrs[] = { ATTR_PERIODIC_HOLD_CHECK, ATTR_PERIODIC_RELEASE_CHECK, ATTR_PERIODIC_REMOVE_CHECK };
+	for (size_t ix = 0; ix < COUNTOF(attrs); ++ix) {
+		seen.insert(attrs[ix]);
+		flags |= PolicyExprReferences(ad, ad.Lookup(attrs[ix]), seen, false);
+	}
+	flags |= PolicyExprReferences(ad, m_sys_periodic_hold, seen, false);
+	flags |= PolicyExprReferences(ad, m_sys_periodic_release, seen, false);
+	flags |= PolicyExprReferences(ad, m_sys_periodic_remove, seen, false);
+
+	refs.insert(seen.begin(), seen.end());
+	return flags;
+}
+
+time_t UserPolicy::NextPeriodicPolicyChange(ClassAd &ad, time_t now, int step, int horizon)
+{
+	if (horizon < 1) horizon = 1;
+	if (step < 1 || step > horizon) step = horizon;
+	time_t deadline = now + horizon;
+
+	// the timer remove fires once its time has passed
+	long long timer_remove = -1;
+	if (ad.LookupInteger(ATTR_TIMER_REMOVE_CHECK, timer_remove) && timer_remove >= now && timer_remove < deadline) {
+		deadline = (time_t)timer_remove + 1;
+	}
+
+	ExprTree * exprs[] = {
+		ad.Lookup(ATTR_PERIODIC_HOLD_CHECK),
+		ad.Lookup(ATTR_PERIODIC_RELEASE_CHECK),
+		ad.Lookup(ATTR_PERIODIC_REMOVE_CHECK),
+		m_sys_periodic_hold,
+		m_sys_periodic_release,
+		m_sys_periodic_remove,
+	};
+
+	ClassAd probe;
+	probe.ChainToAd(&ad);
+
+	for (size_t ix = 0; ix < COUNTOF(exprs); ++ix) {
+		classad::References refs;
+		if ( ! exprs[ix] || ! (PolicyExprReferences(ad, exprs[ix], refs, false) & PERIODIC_POLICY_TIME)) {
+			continue;
+		}
+
+		classad::ExprTree * bound = BindPolicyTimeRefs(exprs[ix]);
+		int initial = ProbePolicyExpr(probe, bound, now);
+
+		// sample until the value changes, then find the first second at which it does.
+		time_t lo = now;
+		for (time_t t = now + step; lo < deadline; t += step) {
+			time_t hi = MIN(t, deadline);
+			if (ProbePolicyExpr(probe, bound, hi) == initial) {
+				lo = hi;
+				continue;
+			}
+			while (hi - lo > 1) {
+				time_t mid = lo + (hi - lo) / 2;
+				if (ProbePolicyExpr(probe, bound, mid) == initial) {
+					lo = mid;
+				} else {
+					hi = mid;
+				}
+			}
+			deadline = hi;
+			break;
+		}
+		delete bound;
+	}
+
+	probe.Unchain();
+	return deadline;
+}
+
 #else
 
 void UserPolicy::Init(ClassAd *ad)
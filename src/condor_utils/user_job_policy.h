@@ -120,6 +120,9 @@ extern const char ATTR_USER_ERROR_REASON[];
 
 enum { STAYS_IN_QUEUE = 0, REMOVE_FROM_QUEUE, HOLD_IN_QUEUE, UNDEFINED_EVAL, RELEASE_FROM_HOLD };
 enum { PERIODIC_ONLY = 0, PERIODIC_THEN_EXIT };
+/* how the periodic policy of a job depends on the current time, returned by
+	UserPolicy::PeriodicPolicyReferences() */
+enum { PERIODIC_POLICY_TIME = 0x01, PERIODIC_POLICY_VOLATILE = 0x02 };
 
 /* ok, here is the first set of expressions that should be available
 	in the classad when it is given to Init():
@@ -232,6 +235,24 @@ class UserPolicy
 		   occurred, then false is returned. */
 		bool FiringReason(MyString &reason,int &reason_code,int &reason_subcode);
 
+	#ifdef USE_NON_MUTATING_USERPOLICY
+		/* Add the names of the attributes that the PERIODIC_ONLY result of
+			AnalyzePolicy() depends upon to refs, following references into
+			other attributes of the ad. Returns PERIODIC_POLICY_TIME if an
+			expression uses time() or CurrentTime directly, and
+			PERIODIC_POLICY_VOLATILE if the result may change with time in a way
+			that NextPeriodicPolicyChange() cannot predict (time used by a
+			referenced attribute, random(), eval() and the like). */
+		int PeriodicPolicyReferences(ClassAd &ad, classad::References &refs);
+
+		/* Returns the earliest time in (now, now+horizon] at which a time
+			dependent periodic expression changes value, or now+horizon if
+			none do. The expressions are sampled every step seconds and the
+			first change is then located to the second, so no change is missed
+			that polling every step seconds would have caught. */
+		time_t NextPeriodicPolicyChange(ClassAd &ad, time_t now, int step, int horizon);
+	#endif
+
 	private: /* functions */
 		/* This function inserts the five of the six (all but TimerRemove) user
 			job policy expressions with default values into the classad if they